@@ -1,12 +1,18 @@
-// Magic3D.cpp : ̨Ӧóڵ㡣
+// Magic3D.cpp : 定义控制台应用程序的入口点。
 //
 
 #include "stdafx.h"
 #include "../Src/Common/MagicFramework.h"
+#include "../Src/Common/ScriptBatchRunner.h"
 #pragma comment( linker,"/subsystem:\"windows\" /entry:\"mainCRTStartup\"" ) //hide cmd windows
 
 int _tmain(int argc, _TCHAR* argv[])
 {
+    // Magic3D.exe -batch script.lua inputDir outputDir [workerCount]: run the script over inputDir without GUI
+    if (argc >= 5 && _tcscmp(argv[1], _T("-batch")) == 0)
+    {
+        return MagicCore::ScriptBatchRunner::RunCommandLine(argc, argv);
+    }
     MagicCore::MagicFramework magicFrame;
     magicFrame.Init();
     magicFrame.Run();
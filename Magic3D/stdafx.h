@@ -1,6 +1,6 @@
-// stdafx.h : ׼ϵͳļİļ
-// Ǿʹõĵ
-// ضĿİļ
+// stdafx.h : 标准系统包含文件的包含文件，
+// 或是经常使用但不常更改的
+// 特定于项目的包含文件
 //
 
 #pragma once
@@ -8,7 +8,7 @@
 //#include "targetver.h"
 
 
-// TODO: ڴ˴óҪͷļ
+// TODO: 在此处引用程序需要的其他头文件
 #include <windows.h>
 
 #include <stdio.h>
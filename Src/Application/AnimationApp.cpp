@@ -4,6 +4,7 @@
 #include "AnimationAppUI.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "DeformWorker.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
@@ -19,6 +20,9 @@ namespace MagicApp
         mDeformType(DT_NONE),
         mDeformPointList(NULL),
         mDeformMesh(NULL),
+        mpDeformWorker(NULL),
+        mDeformedCoords(),
+        mDeformedNormals(),
         mControlIds(),
         mIsDeformationInitialised(false),
         mPickControlId(-1),
@@ -37,6 +41,7 @@ namespace MagicApp
     {
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
+        GPPFREEPOINTER(mpDeformWorker);
         GPPFREEPOINTER(mDeformPointList);
         GPPFREEPOINTER(mDeformMesh);
     }
@@ -48,8 +53,11 @@ namespace MagicApp
         ClearMeshData();
         ClearPointCloudData();
         mRightMouseType = DEFORM;
+        GPPFREEPOINTER(mpDeformWorker);
         GPPFREEPOINTER(mDeformPointList);
         GPPFREEPOINTER(mDeformMesh);
+        std::vector<GPP::Vector3>().swap(mDeformedCoords);
+        std::vector<GPP::Vector3>().swap(mDeformedNormals);
         std::vector<GPP::Int>().swap(mControlIds);
         std::vector<int>().swap(mControlFlags);
         std::vector<GPP::Vector3>().swap(mTargetControlCoords);
@@ -64,6 +72,10 @@ namespace MagicApp
         mTargetControlIds.clear();
         mTargetControlCoords.clear();
         mControlIds.clear();
+        if (mpDeformWorker)
+        {
+            mpDeformWorker->Stop();
+        }
         GPPFREEPOINTER(mDeformPointList);
     }
     
@@ -76,6 +88,10 @@ namespace MagicApp
         mTargetControlIds.clear();
         mTargetControlCoords.clear();
         mControlIds.clear();
+        if (mpDeformWorker)
+        {
+            mpDeformWorker->Stop();
+        }
         GPPFREEPOINTER(mDeformMesh);
     }
 
@@ -94,6 +110,7 @@ namespace MagicApp
 
     bool AnimationApp::Update(double timeElapsed)
     {
+        ApplyDeformResult();
         return true;
     }
 
@@ -253,14 +270,19 @@ namespace MagicApp
         Ogre::Matrix4 worldMInverse = worldM.inverse();
         targetCoord = worldMInverse * targetCoord;
         mPickTargetCoord = GPP::Vector3(targetCoord[0], targetCoord[1], targetCoord[2]);
+        if (mpDeformWorker == NULL || !mpDeformWorker->IsStarted())
+        {
+            MessageBox(NULL, "三维模型变形失败", "温馨提示", MB_OK);
+            mPickControlId = -1;
+            return;
+        }
         std::vector<GPP::Vector3> targetCoords;
-        targetCoords.push_back(mPickTargetCoord);  
-        GPP::ErrorCode res = GPP_NO_ERROR;
+        targetCoords.push_back(mPickTargetCoord);
+        std::vector<GPP::Int> targetIds;
+        std::vector<bool> controlFixFlags;
         if (mDeformPointList)
         {
-            std::vector<int> controlIndex;
-            controlIndex.push_back(mPickControlId);
-            std::vector<bool> controlFixFlags;
+            targetIds.push_back(mPickControlId);
             controlFixFlags.reserve(mControlFlags.size());
             for (std::vector<int>::iterator itr = mControlFlags.begin(); itr != mControlFlags.end(); ++itr)
             {
@@ -273,26 +295,60 @@ namespace MagicApp
                     controlFixFlags.push_back(0);
                 }
             }
-            res = mDeformPointList->Deform(controlIndex, targetCoords, controlFixFlags);
         }
         else if (mDeformMesh)
         {
-            std::vector<int> targetVertexIds;
-            targetVertexIds.push_back(mControlIds.at(mPickControlId));
-            if (isAccurate)
+            targetIds.push_back(mControlIds.at(mPickControlId));
+        }
+        // Fast solve while dragging, the accurate one on release replaces any pending fast target
+        mpDeformWorker->PostDeform(targetIds, targetCoords, controlFixFlags, isAccurate);
+    }
+
+    void AnimationApp::ApplyDeformResult()
+    {
+        if (mpDeformWorker == NULL)
+        {
+            return;
+        }
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        if (!mpDeformWorker->FetchResult(mDeformedCoords, mDeformedNormals, res))
+        {
+            return;
+        }
+        if (res != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "三维模型变形失败", "温馨提示", MB_OK);
+            mPickControlId = -1;
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        if (triMesh && mDeformMesh && mDeformedCoords.size() == triMesh->GetVertexCount())
+        {
+            GPP::Int vertexCount = triMesh->GetVertexCount();
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
             {
-                res = mDeformMesh->Deform(targetVertexIds, targetCoords, GPP::DEFORM_MESH_TYPE_ACCURATE);
+                triMesh->SetVertexCoord(vid, mDeformedCoords.at(vid));
+                triMesh->SetVertexNormal(vid, mDeformedNormals.at(vid));
             }
-            else
+        }
+        else if (pointCloud && mDeformPointList && mDeformedCoords.size() == pointCloud->GetPointCount())
+        {
+            GPP::Int pointCount = pointCloud->GetPointCount();
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                pointCloud->SetPointCoord(pid, mDeformedCoords.at(pid));
+            }
+            if (pointCloud->HasNormal() && mDeformedNormals.size() == pointCount)
             {
-                res = mDeformMesh->Deform(targetVertexIds, targetCoords, GPP::DEFORM_MESH_TYPE_FAST);
+                for (GPP::Int pid = 0; pid < pointCount; pid++)
+                {
+                    pointCloud->SetPointNormal(pid, mDeformedNormals.at(pid));
+                }
             }
-            ModelManager::Get()->GetMesh()->UpdateNormal();
         }
-        if (res != GPP_NO_ERROR)
+        else
         {
-            MessageBox(NULL, "άģͱʧ", "ܰʾ", MB_OK);
-            mPickControlId = -1;
             return;
         }
         UpdateModelRendering();
@@ -522,7 +578,7 @@ namespace MagicApp
                 ModelManager::Get()->ClearPointCloud();
                 if (ModelManager::Get()->ImportMesh(fileName) == false)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                     return false;
                 }
                     
@@ -543,7 +599,7 @@ namespace MagicApp
                 ModelManager::Get()->ClearMesh();
                 if (ModelManager::Get()->ImportPointCloud(fileName) == false)
                 {
-                    MessageBox(NULL, "Ƶʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云导入失败", "温馨提示", MB_OK);
                     return false;
                 }
 
@@ -583,13 +639,13 @@ namespace MagicApp
             mDeformType = DT_VERTEX;
             if (ModelManager::Get()->GetPointCloud() != NULL)
             {
-                MessageBox(NULL, "ֻ֧", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点变形只支持网格类型", "温馨提示", MB_OK);
                 mpUI->ShowVertexBar(false);
                 mDeformType = DT_NONE;
             }
             else if (ModelManager::Get()->GetMesh() == NULL)
             {
-                MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
                 mpUI->ShowVertexBar(false);
                 mDeformType = DT_NONE;
             }
@@ -618,7 +674,7 @@ namespace MagicApp
             }
             else
             {
-                MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
                 mpUI->ShowControlBar(false);
                 mDeformType = DT_NONE;
             }
@@ -632,16 +688,16 @@ namespace MagicApp
 
         if (pointCloud == NULL && triMesh == NULL)
         {
-            MessageBox(NULL, "ȵƻģ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入点云或者网格模型", "温馨提示", MB_OK);
             return;
         }
         GPP::ErrorCode res = GPP_NO_ERROR;
         if (pointCloud)
         {
-            res = mDeformPointList->Init(pointCloud, controlPointCount);
+            res = mpDeformWorker->StartPointCloud(mDeformPointList, pointCloud, controlPointCount);
             if (res == GPP_NO_ERROR)
             {
-                mDeformPointList->GetControlIds(mControlIds);
+                mpDeformWorker->GetControlIds(mControlIds);
             }
             mIsDeformationInitialised = true;
         }
@@ -666,12 +722,12 @@ namespace MagicApp
         }
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "γʼʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "变形初始化失败", "温馨提示", MB_OK);
             return;
         }
         mControlFlags = std::vector<int>(mControlIds.size(), 1);
@@ -696,21 +752,21 @@ namespace MagicApp
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = mDeformMesh->Init(triMesh, vertexFixFlags);
+            GPP::ErrorCode res = mpDeformWorker->StartMesh(mDeformMesh, triMesh, vertexFixFlags);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 if (res == GPP_INVALID_INPUT)
                 {
-                    MessageBox(NULL, "ͨûй̶", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格有连通区域没有固定点", "温馨提示", MB_OK);
                 }
                 else
                 {
-                    MessageBox(NULL, "γʼʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "变形初始化失败", "温馨提示", MB_OK);
                 }
                 return;
             }
@@ -726,13 +782,14 @@ namespace MagicApp
         }
         if (!mIsDeformationInitialised)
         {
-            MessageBox(NULL, "ûгʼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "变形没有初始化", "温馨提示", MB_OK);
             return;
         }
-        GPP::ErrorCode res = GPP_NO_ERROR;
+        std::vector<GPP::Int> targetIds;
+        std::vector<bool> controlFixFlags;
         if (mDeformPointList)
         {
-            std::vector<bool> controlFixFlags;
+            targetIds = mTargetControlIds;
             controlFixFlags.reserve(mControlFlags.size());
             for (std::vector<int>::iterator itr = mControlFlags.begin(); itr != mControlFlags.end(); ++itr)
             {
@@ -745,28 +802,20 @@ namespace MagicApp
                     controlFixFlags.push_back(0);
                 }
             }
-            res = mDeformPointList->Deform(mTargetControlIds, mTargetControlCoords, controlFixFlags);
         }
         else if (mDeformMesh)
         {
-            std::vector<int> targetVertexIds;
             for (std::vector<int>::iterator itr = mTargetControlIds.begin(); itr != mTargetControlIds.end(); ++itr)
             {
-                targetVertexIds.push_back(mControlIds.at(*itr));
+                targetIds.push_back(mControlIds.at(*itr));
             }
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            res = mDeformMesh->Deform(targetVertexIds, mTargetControlCoords, GPP::DEFORM_MESH_TYPE_ACCURATE);
-            ModelManager::Get()->GetMesh()->UpdateNormal();
         }
-        if (res != GPP_NO_ERROR)
-        {
-            MessageBox(NULL, "άģͱʧ", "ܰʾ", MB_OK);
-            return;
-        }
-        UpdateModelRendering();
-        UpdateControlRendering();
+        mpDeformWorker->PostDeform(targetIds, mTargetControlCoords, controlFixFlags, true);
+        mpDeformWorker->WaitIdle();
+        ApplyDeformResult();
     }
 
     void AnimationApp::SelectFreeControlPoint()
@@ -776,7 +825,7 @@ namespace MagicApp
         if (mFirstAlert)
         {
             mFirstAlert = false;
-            MessageBox(NULL, "ҼѡƵģʽ(+)ѡťƶƵģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入框选控制点模式(+)，点击选择按钮返回移动控制点模式", "温馨提示", MB_OK);
         }
     }
         
@@ -787,7 +836,7 @@ namespace MagicApp
         if (mFirstAlert)
         {
             mFirstAlert = false;
-            MessageBox(NULL, "ҼѡƵģʽ(-)ѡťƶƵģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入框选控制点模式(-)，点击选择按钮返回移动控制点模式", "温馨提示", MB_OK);
         }
     }
 
@@ -795,7 +844,7 @@ namespace MagicApp
     //{
     //    if (!mIsDeformationInitialised)
     //    {
-    //        MessageBox(NULL, "ûгʼ", "ܰʾ", MB_OK);
+    //        MessageBox(NULL, "变形没有初始化", "温馨提示", MB_OK);
     //        return;
     //    }
     //    mRightMouseType = DEFORM;
@@ -819,6 +868,10 @@ namespace MagicApp
         light->setSpecularColour(0.5, 0.5, 0.5);
 
         InitViewTool();
+        if (mpDeformWorker == NULL)
+        {
+            mpDeformWorker = new DeformWorker;
+        }
 
         if (ModelManager::Get()->GetMesh() != NULL)
         {
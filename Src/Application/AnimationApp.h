@@ -11,6 +11,7 @@ namespace MagicCore
 namespace MagicApp
 {
     class AnimationAppUI;
+    class DeformWorker;
     class AnimationApp : public AppBase
     {
         enum CommandType
@@ -62,6 +63,7 @@ namespace MagicApp
         void PickControlPoint(int mouseCoordX, int mouseCoordY);
         void DragControlPoint(int mouseCoordX, int mouseCoordY, bool mouseReleased);
         void UpdateDeformation(int mouseCoordX, int mouseCoordY, bool isAccurate);
+        void ApplyDeformResult(void);
         void SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void UpdateRectangleRendering(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void ClearRectangleRendering(void);
@@ -82,6 +84,9 @@ namespace MagicApp
         DeformType mDeformType;
         GPP::DeformPointList* mDeformPointList;
         GPP::DeformMesh* mDeformMesh;
+        DeformWorker* mpDeformWorker;
+        std::vector<GPP::Vector3> mDeformedCoords;
+        std::vector<GPP::Vector3> mDeformedNormals;
         std::vector<GPP::Int> mControlIds;
         bool mIsDeformationInitialised;
         int mPickControlId;
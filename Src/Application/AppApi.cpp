@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "AppApi.h"
 #include "ModelManager.h"
+#include "ModelRegistry.h"
 #include "MagicMesh.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
@@ -21,6 +22,42 @@
 
 namespace MagicApp
 {
+    static const int MODEL_IS_IN_USE = -3;
+
+    static bool IsModelSwitchAllowed()
+    {
+        AppBase* pApp = AppManager::Get()->GetCurrentApp();
+        if (pApp == NULL || dynamic_cast<Homepage*>(pApp) != NULL)
+        {
+            return true;
+        }
+        InfoLog << "AppApi: models can only be stashed or switched in Homepage" << std::endl;
+        return false;
+    }
+
+    // Oldest stashed model of the type, a switched out model gets a new handle and goes to the end
+    static GPP::Int GetFirstStashedModel(bool isPointCloud)
+    {
+        ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
+        std::vector<GPP::Int> handles;
+        modelRegistry->GetHandles(handles);
+        for (std::vector<GPP::Int>::iterator itr = handles.begin(); itr != handles.end(); ++itr)
+        {
+            if (modelRegistry->IsPointCloud(*itr) == isPointCloud)
+            {
+                return *itr;
+            }
+        }
+        return -1;
+    }
+
+    static void RefreshModelRendering()
+    {
+        if (AppManager::Get()->GetCurrentApp() != NULL)
+        {
+            AppManager::Get()->SwitchCurrentApp("Homepage");
+        }
+    }
 
     bool AppApi::EnterApp(const char* appName)
     {
@@ -88,4 +125,109 @@ namespace MagicApp
         return triMesh;
     }
 
+    int AppApi::StashMesh()
+    {
+        if (!IsModelSwitchAllowed())
+        {
+            return MODEL_IS_IN_USE;
+        }
+        GPP::Int handle = ModelManager::Get()->StashMesh();
+        RefreshModelRendering();
+        return handle;
+    }
+
+    int AppApi::SwitchMesh(int handle)
+    {
+        if (!IsModelSwitchAllowed())
+        {
+            return MODEL_IS_IN_USE;
+        }
+        GPP::Int stashedHandle = -1;
+        if (!ModelManager::Get()->SwitchMesh(handle, &stashedHandle))
+        {
+            return -2;
+        }
+        RefreshModelRendering();
+        return stashedHandle;
+    }
+
+    int AppApi::StashPointCloud()
+    {
+        if (!IsModelSwitchAllowed())
+        {
+            return MODEL_IS_IN_USE;
+        }
+        GPP::Int handle = ModelManager::Get()->StashPointCloud();
+        RefreshModelRendering();
+        return handle;
+    }
+
+    int AppApi::SwitchPointCloud(int handle)
+    {
+        if (!IsModelSwitchAllowed())
+        {
+            return MODEL_IS_IN_USE;
+        }
+        GPP::Int stashedHandle = -1;
+        if (!ModelManager::Get()->SwitchPointCloud(handle, &stashedHandle))
+        {
+            return -2;
+        }
+        RefreshModelRendering();
+        return stashedHandle;
+    }
+
+    int AppApi::SwitchNextMesh()
+    {
+        return SwitchMesh(GetFirstStashedModel(false));
+    }
+
+    int AppApi::SwitchNextPointCloud()
+    {
+        return SwitchPointCloud(GetFirstStashedModel(true));
+    }
+
+    void AppApi::ReleaseModel(int handle)
+    {
+        ModelManager::Get()->ReleaseModel(handle);
+    }
+
+    void AppApi::SetModelMemoryBudget(int megaByteCount)
+    {
+        if (megaByteCount > 0)
+        {
+            ModelManager::Get()->GetModelRegistry()->SetMemoryBudget(GPP::ULongInt(megaByteCount) * 1024 * 1024);
+        }
+    }
+
+    int AppApi::ListModels()
+    {
+        ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
+        std::vector<GPP::Int> handles;
+        modelRegistry->GetHandles(handles);
+        InfoLog << "AppApi::ListModels " << handles.size() << " models, resident " << modelRegistry->GetResidentByteCount()
+            << " bytes, spilled " << modelRegistry->GetSpillByteCount() << " bytes" << std::endl;
+        for (std::vector<GPP::Int>::iterator itr = handles.begin(); itr != handles.end(); ++itr)
+        {
+            InfoLog << "  " << *itr << (modelRegistry->IsPointCloud(*itr) ? " point cloud " : " mesh ")
+                << (modelRegistry->IsResident(*itr) ? "resident " : "spilled ") << modelRegistry->GetName(*itr) << std::endl;
+        }
+        return handles.size();
+    }
+
+    int AppApi::GetModelHandle(int index)
+    {
+        std::vector<GPP::Int> handles;
+        ModelManager::Get()->GetModelRegistry()->GetHandles(handles);
+        return (index >= 0 && index < int(handles.size())) ? handles.at(index) : -1;
+    }
+
+    const char* AppApi::GetModelName(int handle)
+    {
+        // Lua copies the returned string right away
+        static std::string modelName;
+        modelName = ModelManager::Get()->GetModelRegistry()->GetName(handle);
+        return modelName.c_str();
+    }
+
 }
\ No newline at end of file
@@ -15,5 +15,26 @@ namespace MagicApp
         static MagicApp::MeshShopApp* GetMeshShopApp();
         static MagicApp::ReliefApp*   GetReliefApp();
 
+        // Keep models open in ModelManager's registry and switch between them without importing again.
+        // Switch returns the handle of the stashed current model, -1 if there was none, -2 if handle is not valid.
+        // Stash and switch return -3 outside Homepage: the other apps keep rendering and selection state of the current model.
+        // Homepage is entered again after a stash or switch, so it renders the new current model
+        static int StashMesh();
+        static int SwitchMesh(int handle);
+        static int StashPointCloud();
+        static int SwitchPointCloud(int handle);
+        // Switch to the stashed mesh (point cloud) that was stashed first, so repeated calls cycle through them. -2 if there is none
+        static int SwitchNextMesh();
+        static int SwitchNextPointCloud();
+        // Release a stashed model that is not needed any more
+        static void ReleaseModel(int handle);
+        static void SetModelMemoryBudget(int megaByteCount);
+        // Log handle, type, state and name of every stashed model. Return the model count
+        static int ListModels();
+        // Handle of the index th stashed model, -1 if index is out of range
+        static int GetModelHandle(int index);
+        // Empty if handle is not valid
+        static const char* GetModelName(int handle);
+
     };
 }
\ No newline at end of file
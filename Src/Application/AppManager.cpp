@@ -1,6 +1,8 @@
 #include "AppManager.h"
 #include "../Common/ToolKit.h"
 #include "Homepage.h"
+#include "ModelExporter.h"
+#include <windows.h>
 
 namespace MagicApp
 {
@@ -31,6 +33,11 @@ namespace MagicApp
         {
             mpCurrentApp->Update(timeElapsed);
         }
+        // Exports return once the file is opened, the write thread reports later failures here
+        if (ModelExporter::Get()->PopWriteError() != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "模型文件写入失败", "温馨提示", MB_OK);
+        }
     }
 
     void AppManager::EnterApp(AppBase* pApp, std::string name)
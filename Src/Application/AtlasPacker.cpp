@@ -0,0 +1,531 @@
+#include "AtlasPacker.h"
+#include "../Common/ParallelTool.h"
+#include <algorithm>
+#include <math.h>
+
+namespace MagicApp
+{
+    static const GPP::Int CHART_FRAME_SIZE = 6;
+    static const GPP::Int DENSITY_SEARCH_COUNT = 8;
+
+    struct SkylineNode
+    {
+        GPP::Int mX;
+        GPP::Int mY;
+        GPP::Int mWidth;
+    };
+
+    // Lowest top position of a width x height rectangle on the skyline, ties go to the left. Return false if it does not fit
+    static bool FindSkylinePosition(const std::vector<SkylineNode>& skyline, GPP::Int imageSize, GPP::Int width, GPP::Int height,
+        GPP::Int& bestIndex, GPP::Int& bestY)
+    {
+        bestIndex = -1;
+        bestY = imageSize;
+        GPP::Int nodeCount = skyline.size();
+        for (GPP::Int nodeId = 0; nodeId < nodeCount; nodeId++)
+        {
+            GPP::Int x = skyline.at(nodeId).mX;
+            if (x + width > imageSize)
+            {
+                break;
+            }
+            GPP::Int y = 0;
+            GPP::Int widthLeft = width;
+            for (GPP::Int coverId = nodeId; widthLeft > 0; coverId++)
+            {
+                const SkylineNode& node = skyline.at(coverId);
+                if (node.mY > y)
+                {
+                    y = node.mY;
+                }
+                widthLeft -= node.mWidth;
+            }
+            if (y + height <= imageSize && (bestIndex == -1 || y < bestY))
+            {
+                bestIndex = nodeId;
+                bestY = y;
+            }
+        }
+        return bestIndex != -1;
+    }
+
+    static void AddSkylineLevel(std::vector<SkylineNode>& skyline, GPP::Int nodeId, GPP::Int width, GPP::Int top)
+    {
+        SkylineNode newNode;
+        newNode.mX = skyline.at(nodeId).mX;
+        newNode.mY = top;
+        newNode.mWidth = width;
+        skyline.insert(skyline.begin() + nodeId, newNode);
+        // Cut the nodes under the new one
+        GPP::Int right = newNode.mX + width;
+        GPP::Int nextId = nodeId + 1;
+        while (nextId < skyline.size() && skyline.at(nextId).mX < right)
+        {
+            SkylineNode& node = skyline.at(nextId);
+            GPP::Int nodeRight = node.mX + node.mWidth;
+            if (nodeRight <= right)
+            {
+                skyline.erase(skyline.begin() + nextId);
+            }
+            else
+            {
+                node.mWidth = nodeRight - right;
+                node.mX = right;
+                break;
+            }
+        }
+        // Merge levels with the same height
+        for (GPP::Int mergeId = 0; mergeId + 1 < skyline.size(); )
+        {
+            if (skyline.at(mergeId).mY == skyline.at(mergeId + 1).mY)
+            {
+                skyline.at(mergeId).mWidth += skyline.at(mergeId + 1).mWidth;
+                skyline.erase(skyline.begin() + mergeId + 1);
+            }
+            else
+            {
+                mergeId++;
+            }
+        }
+    }
+
+    static GPP::Real CrossValue(const std::vector<GPP::Real>& points, GPP::Int originId, GPP::Int pointId0, GPP::Int pointId1)
+    {
+        return (points.at(pointId0 * 2) - points.at(originId * 2)) * (points.at(pointId1 * 2 + 1) - points.at(originId * 2 + 1)) -
+            (points.at(pointId0 * 2 + 1) - points.at(originId * 2 + 1)) * (points.at(pointId1 * 2) - points.at(originId * 2));
+    }
+
+    class PointLess
+    {
+    public:
+        explicit PointLess(const std::vector<GPP::Real>* points) :
+            mpPoints(points)
+        {
+        }
+
+        bool operator()(GPP::Int pointId0, GPP::Int pointId1) const
+        {
+            if (mpPoints->at(pointId0 * 2) != mpPoints->at(pointId1 * 2))
+            {
+                return mpPoints->at(pointId0 * 2) < mpPoints->at(pointId1 * 2);
+            }
+            return mpPoints->at(pointId0 * 2 + 1) < mpPoints->at(pointId1 * 2 + 1);
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpPoints;
+    };
+
+    // Monotone chain, counter clockwise without the repeated first point
+    static void ConvexHull(const std::vector<GPP::Real>& points, std::vector<GPP::Int>& hullIds)
+    {
+        GPP::Int pointCount = points.size() / 2;
+        std::vector<GPP::Int> sortedIds(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            sortedIds.at(pid) = pid;
+        }
+        std::sort(sortedIds.begin(), sortedIds.end(), PointLess(&points));
+        hullIds.assign(pointCount * 2, -1);
+        GPP::Int hullSize = 0;
+        for (GPP::Int sid = 0; sid < pointCount; sid++)
+        {
+            while (hullSize >= 2 && CrossValue(points, hullIds.at(hullSize - 2), hullIds.at(hullSize - 1), sortedIds.at(sid)) <= 0)
+            {
+                hullSize--;
+            }
+            hullIds.at(hullSize++) = sortedIds.at(sid);
+        }
+        GPP::Int lowerSize = hullSize + 1;
+        for (GPP::Int sid = pointCount - 2; sid >= 0; sid--)
+        {
+            while (hullSize >= lowerSize && CrossValue(points, hullIds.at(hullSize - 2), hullIds.at(hullSize - 1), sortedIds.at(sid)) <= 0)
+            {
+                hullSize--;
+            }
+            hullIds.at(hullSize++) = sortedIds.at(sid);
+        }
+        hullIds.resize(hullSize > 1 ? hullSize - 1 : hullSize);
+    }
+
+    class MeasureChartTask : public MagicCore::ParallelTask
+    {
+    public:
+        MeasureChartTask(AtlasPacker* atlasPacker, const std::vector<GPP::ITriMesh*>* chartMeshes,
+            const std::vector<std::vector<GPP::Real> >* chartTexCoords) :
+            mpAtlasPacker(atlasPacker),
+            mpChartMeshes(chartMeshes),
+            mpChartTexCoords(chartTexCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int chartId = startId; chartId < endId; chartId++)
+            {
+                mpAtlasPacker->MeasureChart(chartId, mpChartMeshes->at(chartId), mpChartTexCoords->at(chartId));
+            }
+        }
+
+    private:
+        AtlasPacker* mpAtlasPacker;
+        const std::vector<GPP::ITriMesh*>* mpChartMeshes;
+        const std::vector<std::vector<GPP::Real> >* mpChartTexCoords;
+    };
+
+    class ChartAreaGreater
+    {
+    public:
+        ChartAreaGreater(const std::vector<GPP::Real>* chartFrames, const std::vector<GPP::Real>* chartScales) :
+            mpChartFrames(chartFrames),
+            mpChartScales(chartScales)
+        {
+        }
+
+        bool operator()(GPP::Int chartId0, GPP::Int chartId1) const
+        {
+            return BoxArea(chartId0) > BoxArea(chartId1);
+        }
+
+    private:
+        GPP::Real BoxArea(GPP::Int chartId) const
+        {
+            GPP::Real scale = mpChartScales->at(chartId);
+            return mpChartFrames->at(chartId * CHART_FRAME_SIZE + 4) * mpChartFrames->at(chartId * CHART_FRAME_SIZE + 5) * scale * scale;
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpChartFrames;
+        const std::vector<GPP::Real>* mpChartScales;
+    };
+
+    AtlasPacker::AtlasPacker() :
+        mImageSize(4096),
+        mPadding(4),
+        mTexelDensity(0),
+        mMaxPageCount(1),
+        mChartFrames(),
+        mChartScales(),
+        mChartMeshAreas(),
+        mChartOrder(),
+        mChartPageIds(),
+        mChartPixelCoords(),
+        mChartTurnFlags(),
+        mPageCount(0),
+        mUsedTexelDensity(0),
+        mCoverage(0)
+    {
+    }
+
+    AtlasPacker::~AtlasPacker()
+    {
+    }
+
+    void AtlasPacker::SetImageSize(GPP::Int imageSize, GPP::Int padding)
+    {
+        mImageSize = imageSize;
+        mPadding = padding;
+    }
+
+    void AtlasPacker::SetTexelDensity(GPP::Real texelDensity)
+    {
+        mTexelDensity = texelDensity;
+    }
+
+    void AtlasPacker::SetMaxPageCount(GPP::Int maxPageCount)
+    {
+        mMaxPageCount = maxPageCount;
+    }
+
+    GPP::ErrorCode AtlasPacker::Pack(const std::vector<GPP::ITriMesh*>& chartMeshes, std::vector<std::vector<GPP::Real> >& chartTexCoords)
+    {
+        mChartPageIds.clear();
+        mPageCount = 0;
+        mUsedTexelDensity = 0;
+        mCoverage = 0;
+        GPP::Int chartCount = chartMeshes.size();
+        if (chartCount == 0 || chartTexCoords.size() != chartCount || mImageSize <= mPadding * 2)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (mTexelDensity <= 0 && mMaxPageCount <= 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            if (chartMeshes.at(chartId) == NULL || chartTexCoords.at(chartId).size() != chartMeshes.at(chartId)->GetVertexCount() * 2)
+            {
+                return GPP_INVALID_INPUT;
+            }
+        }
+        mChartFrames.resize(chartCount * CHART_FRAME_SIZE);
+        mChartScales.resize(chartCount);
+        mChartMeshAreas.resize(chartCount);
+        MeasureChartTask measureTask(this, &chartMeshes, &chartTexCoords);
+        MagicCore::ParallelTool::ParallelFor(chartCount, &measureTask, 1);
+        mChartOrder.resize(chartCount);
+        GPP::Real meshArea = 0;
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            mChartOrder.at(chartId) = chartId;
+            meshArea += mChartMeshAreas.at(chartId);
+        }
+        std::stable_sort(mChartOrder.begin(), mChartOrder.end(), ChartAreaGreater(&mChartFrames, &mChartScales));
+
+        GPP::Real texelDensity = mTexelDensity;
+        if (texelDensity > 0)
+        {
+            if (!PlaceCharts(texelDensity, mMaxPageCount))
+            {
+                return GPP_INVALID_RESULT;
+            }
+        }
+        else
+        {
+            if (meshArea < GPP::REAL_TOL)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            // Charts can not cover more than the pages, shrink until they fit then bisect between the fit and the fail density
+            GPP::Real failDensity = sqrt(mMaxPageCount * GPP::Real(mImageSize) * GPP::Real(mImageSize) / meshArea);
+            GPP::Real fitDensity = 0;
+            texelDensity = failDensity;
+            while (texelDensity * sqrt(meshArea) > 1.0)
+            {
+                if (PlaceCharts(texelDensity, mMaxPageCount))
+                {
+                    fitDensity = texelDensity;
+                    break;
+                }
+                failDensity = texelDensity;
+                texelDensity *= 0.8;
+            }
+            if (fitDensity <= 0)
+            {
+                return GPP_INVALID_RESULT;
+            }
+            for (GPP::Int searchId = 0; searchId < DENSITY_SEARCH_COUNT; searchId++)
+            {
+                texelDensity = (fitDensity + failDensity) / 2.0;
+                if (PlaceCharts(texelDensity, mMaxPageCount))
+                {
+                    fitDensity = texelDensity;
+                }
+                else
+                {
+                    failDensity = texelDensity;
+                }
+            }
+            texelDensity = fitDensity;
+            PlaceCharts(texelDensity, mMaxPageCount);
+        }
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            TransformChart(chartId, texelDensity, chartTexCoords.at(chartId));
+        }
+        mUsedTexelDensity = texelDensity;
+        mCoverage = meshArea * texelDensity * texelDensity / (GPP::Real(mPageCount) * mImageSize * mImageSize);
+        return GPP_NO_ERROR;
+    }
+
+    const std::vector<GPP::Int>& AtlasPacker::GetChartPageIds() const
+    {
+        return mChartPageIds;
+    }
+
+    GPP::Int AtlasPacker::GetPageCount() const
+    {
+        return mPageCount;
+    }
+
+    GPP::Real AtlasPacker::GetTexelDensity() const
+    {
+        return mUsedTexelDensity;
+    }
+
+    GPP::Real AtlasPacker::GetCoverage() const
+    {
+        return mCoverage;
+    }
+
+    void AtlasPacker::MeasureChart(GPP::Int chartId, const GPP::ITriMesh* chartMesh, const std::vector<GPP::Real>& texCoords)
+    {
+        GPP::Real meshArea = 0;
+        GPP::Real texArea = 0;
+        GPP::Int triangleCount = chartMesh->GetTriangleCount();
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            chartMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Vector3 coord0 = chartMesh->GetVertexCoord(vertexIds[0]);
+            meshArea += (chartMesh->GetVertexCoord(vertexIds[1]) - coord0).CrossProduct(chartMesh->GetVertexCoord(vertexIds[2]) - coord0).Length() / 2.0;
+            texArea += fabs(CrossValue(texCoords, vertexIds[0], vertexIds[1], vertexIds[2])) / 2.0;
+        }
+        mChartMeshAreas.at(chartId) = meshArea;
+        mChartScales.at(chartId) = texArea > GPP::REAL_TOL ? sqrt(meshArea / texArea) : 0;
+
+        // The smallest bounding box has one side on a hull edge
+        std::vector<GPP::Int> hullIds;
+        ConvexHull(texCoords, hullIds);
+        GPP::Int hullSize = hullIds.size();
+        GPP::Real* frame = &(mChartFrames.at(chartId * CHART_FRAME_SIZE));
+        frame[0] = 1;
+        frame[1] = 0;
+        frame[2] = 0;
+        frame[3] = 0;
+        frame[4] = 0;
+        frame[5] = 0;
+        GPP::Real bestArea = -1;
+        for (GPP::Int edgeId = 0; edgeId < hullSize; edgeId++)
+        {
+            GPP::Int pointId0 = hullIds.at(edgeId);
+            GPP::Int pointId1 = hullIds.at((edgeId + 1) % hullSize);
+            GPP::Real dirX = texCoords.at(pointId1 * 2) - texCoords.at(pointId0 * 2);
+            GPP::Real dirY = texCoords.at(pointId1 * 2 + 1) - texCoords.at(pointId0 * 2 + 1);
+            GPP::Real dirLength = sqrt(dirX * dirX + dirY * dirY);
+            if (dirLength < GPP::REAL_TOL)
+            {
+                continue;
+            }
+            dirX /= dirLength;
+            dirY /= dirLength;
+            GPP::Real minX = GPP::REAL_LARGE;
+            GPP::Real minY = GPP::REAL_LARGE;
+            GPP::Real maxX = -GPP::REAL_LARGE;
+            GPP::Real maxY = -GPP::REAL_LARGE;
+            for (GPP::Int hullId = 0; hullId < hullSize; hullId++)
+            {
+                GPP::Int pointId = hullIds.at(hullId);
+                GPP::Real x = texCoords.at(pointId * 2) * dirX + texCoords.at(pointId * 2 + 1) * dirY;
+                GPP::Real y = texCoords.at(pointId * 2 + 1) * dirX - texCoords.at(pointId * 2) * dirY;
+                minX = x < minX ? x : minX;
+                minY = y < minY ? y : minY;
+                maxX = x > maxX ? x : maxX;
+                maxY = y > maxY ? y : maxY;
+            }
+            GPP::Real area = (maxX - minX) * (maxY - minY);
+            if (bestArea < 0 || area < bestArea)
+            {
+                bestArea = area;
+                frame[0] = dirX;
+                frame[1] = dirY;
+                frame[2] = minX;
+                frame[3] = minY;
+                frame[4] = maxX - minX;
+                frame[5] = maxY - minY;
+            }
+        }
+    }
+
+    bool AtlasPacker::PlaceCharts(GPP::Real texelDensity, GPP::Int maxPageCount)
+    {
+        GPP::Int chartCount = mChartOrder.size();
+        mChartPageIds.assign(chartCount, -1);
+        mChartPixelCoords.assign(chartCount * 2, 0);
+        mChartTurnFlags.assign(chartCount, false);
+        mPageCount = 0;
+        std::vector<std::vector<SkylineNode> > pageSkylines;
+        SkylineNode emptyNode;
+        emptyNode.mX = 0;
+        emptyNode.mY = 0;
+        emptyNode.mWidth = mImageSize;
+        for (GPP::Int orderId = 0; orderId < chartCount; orderId++)
+        {
+            GPP::Int chartId = mChartOrder.at(orderId);
+            GPP::Real pixelScale = mChartScales.at(chartId) * texelDensity;
+            GPP::Int width = GPP::Int(ceil(mChartFrames.at(chartId * CHART_FRAME_SIZE + 4) * pixelScale)) + mPadding * 2;
+            GPP::Int height = GPP::Int(ceil(mChartFrames.at(chartId * CHART_FRAME_SIZE + 5) * pixelScale)) + mPadding * 2;
+            if (width < 1)
+            {
+                width = 1;
+            }
+            if (height < 1)
+            {
+                height = 1;
+            }
+            if (width > mImageSize || height > mImageSize)
+            {
+                return false;
+            }
+            GPP::Int pageId = 0;
+            GPP::Int nodeId = -1;
+            GPP::Int y = 0;
+            bool isTurned = false;
+            for (; pageId <= mPageCount; pageId++)
+            {
+                if (pageId == mPageCount)
+                {
+                    if (maxPageCount > 0 && mPageCount >= maxPageCount)
+                    {
+                        return false;
+                    }
+                    pageSkylines.push_back(std::vector<SkylineNode>(1, emptyNode));
+                    mPageCount++;
+                }
+                std::vector<SkylineNode>& skyline = pageSkylines.at(pageId);
+                GPP::Int uprightId = -1;
+                GPP::Int uprightY = 0;
+                GPP::Int turnedId = -1;
+                GPP::Int turnedY = 0;
+                FindSkylinePosition(skyline, mImageSize, width, height, uprightId, uprightY);
+                if (width != height)
+                {
+                    FindSkylinePosition(skyline, mImageSize, height, width, turnedId, turnedY);
+                }
+                if (turnedId != -1 && (uprightId == -1 || turnedY + width < uprightY + height))
+                {
+                    nodeId = turnedId;
+                    y = turnedY;
+                    isTurned = true;
+                    break;
+                }
+                if (uprightId != -1)
+                {
+                    nodeId = uprightId;
+                    y = uprightY;
+                    break;
+                }
+                if (pageId == mPageCount - 1 && skyline.size() == 1 && skyline.at(0).mY == 0)
+                {
+                    // Does not fit in an empty page
+                    return false;
+                }
+            }
+            std::vector<SkylineNode>& skyline = pageSkylines.at(pageId);
+            mChartPageIds.at(chartId) = pageId;
+            mChartPixelCoords.at(chartId * 2) = skyline.at(nodeId).mX;
+            mChartPixelCoords.at(chartId * 2 + 1) = y;
+            mChartTurnFlags.at(chartId) = isTurned;
+            AddSkylineLevel(skyline, nodeId, isTurned ? height : width, y + (isTurned ? width : height));
+        }
+        return true;
+    }
+
+    void AtlasPacker::TransformChart(GPP::Int chartId, GPP::Real texelDensity, std::vector<GPP::Real>& texCoords) const
+    {
+        const GPP::Real* frame = &(mChartFrames.at(chartId * CHART_FRAME_SIZE));
+        GPP::Real pixelScale = mChartScales.at(chartId) * texelDensity;
+        GPP::Real boxHeight = frame[5] * pixelScale;
+        GPP::Real originX = mChartPixelCoords.at(chartId * 2) + mPadding;
+        GPP::Real originY = mChartPixelCoords.at(chartId * 2 + 1) + mPadding;
+        bool isTurned = mChartTurnFlags.at(chartId);
+        GPP::Real pixelToTex = 1.0 / mImageSize;
+        GPP::Int pointCount = texCoords.size() / 2;
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Real u = texCoords.at(pid * 2);
+            GPP::Real v = texCoords.at(pid * 2 + 1);
+            GPP::Real x = (u * frame[0] + v * frame[1] - frame[2]) * pixelScale;
+            GPP::Real y = (v * frame[0] - u * frame[1] - frame[3]) * pixelScale;
+            if (isTurned)
+            {
+                GPP::Real turnedX = boxHeight - y;
+                y = x;
+                x = turnedX;
+            }
+            texCoords.at(pid * 2) = (originX + x) * pixelToTex;
+            texCoords.at(pid * 2 + 1) = (originY + y) * pixelToTex;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Packs unfolded charts into square texture pages with a skyline bottom-left heuristic.
+    // Every chart is scaled to one texel density and turned to its smallest bounding box (hull edge directions are tried for all charts in parallel).
+    // Charts are placed largest area first, upright or turned by 90 degrees, with padding pixels on each side. A chart that does not fit opens a new page.
+    // USAGE: 1. atlasPacker.SetImageSize(4096, 4); atlasPacker.SetMaxPageCount(1);
+    //        2. atlasPacker.Pack(chartMeshes, chartTexCoords); chartTexCoords are moved into page coordinates [0, 1]
+    //        3. atlasPacker.GetChartPageIds(); atlasPacker.GetTexelDensity(); atlasPacker.GetCoverage();
+    class AtlasPacker
+    {
+    public:
+        AtlasPacker();
+        ~AtlasPacker();
+
+        // imageSize: page width and height in pixels. padding: empty pixels kept on each side of a chart
+        void SetImageSize(GPP::Int imageSize, GPP::Int padding);
+        // texelDensity: pixels per model unit length. <= 0 chooses the largest density that fits in max page count pages
+        void SetTexelDensity(GPP::Real texelDensity);
+        // maxPageCount <= 0 is no limit, which needs a texel density
+        void SetMaxPageCount(GPP::Int maxPageCount);
+
+        // chartMeshes: model of each chart, chartTexCoords: 2 values per chart vertex
+        GPP::ErrorCode Pack(const std::vector<GPP::ITriMesh*>& chartMeshes, std::vector<std::vector<GPP::Real> >& chartTexCoords);
+
+        const std::vector<GPP::Int>& GetChartPageIds(void) const;
+        GPP::Int GetPageCount(void) const;
+        // Density used by the last Pack
+        GPP::Real GetTexelDensity(void) const;
+        // Chart pixel area / page pixel area
+        GPP::Real GetCoverage(void) const;
+
+    private:
+        void MeasureChart(GPP::Int chartId, const GPP::ITriMesh* chartMesh, const std::vector<GPP::Real>& texCoords);
+        bool PlaceCharts(GPP::Real texelDensity, GPP::Int maxPageCount);
+        void TransformChart(GPP::Int chartId, GPP::Real texelDensity, std::vector<GPP::Real>& texCoords) const;
+        friend class MeasureChartTask;
+
+    private:
+        GPP::Int mImageSize;
+        GPP::Int mPadding;
+        GPP::Real mTexelDensity;
+        GPP::Int mMaxPageCount;
+        // Chart frame: texture coordinates are turned by (cos, sin), moved by -min and scaled to model length by mChartScales
+        std::vector<GPP::Real> mChartFrames;
+        std::vector<GPP::Real> mChartScales;
+        std::vector<GPP::Real> mChartMeshAreas;
+        std::vector<GPP::Int> mChartOrder;
+        std::vector<GPP::Int> mChartPageIds;
+        std::vector<GPP::Int> mChartPixelCoords;
+        std::vector<bool> mChartTurnFlags;
+        GPP::Int mPageCount;
+        GPP::Real mUsedTexelDensity;
+        GPP::Real mCoverage;
+    };
+}
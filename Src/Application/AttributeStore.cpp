@@ -0,0 +1,192 @@
+#include "AttributeStore.h"
+#include "../Common/LogSystem.h"
+
+namespace MagicApp
+{
+    const char* IMAGE_COLOR_ID_CHANNEL = "ImageColorId";
+    const char* IMAGE_COLOR_ID_FLAG_CHANNEL = "ImageColorIdFlag";
+    const char* COLOR_ID_CHANNEL = "ColorId";
+    const char* CLOUD_ID_CHANNEL = "CloudId";
+
+    AttributeStore::AttributeStore() :
+        mChannels(),
+        mChannelLoaders()
+    {
+    }
+
+    AttributeStore::~AttributeStore()
+    {
+        Clear();
+    }
+
+    bool AttributeStore::HasChannel(const std::string& name) const
+    {
+        return mChannels.find(name) != mChannels.end() || mChannelLoaders.find(name) != mChannelLoaders.end();
+    }
+
+    void AttributeStore::RemoveChannel(const std::string& name)
+    {
+        RemoveChannelLoader(name);
+        std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.find(name);
+        if (itr != mChannels.end())
+        {
+            GPPFREEPOINTER(itr->second);
+            mChannels.erase(itr);
+        }
+    }
+
+    void AttributeStore::Clear()
+    {
+        for (std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->second);
+        }
+        mChannels.clear();
+        for (std::map<std::string, AttributeChannelLoader*>::iterator itr = mChannelLoaders.begin(); itr != mChannelLoaders.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->second);
+        }
+        mChannelLoaders.clear();
+    }
+
+    void AttributeStore::Swap(AttributeStore& store)
+    {
+        mChannels.swap(store.mChannels);
+        mChannelLoaders.swap(store.mChannelLoaders);
+    }
+
+    void AttributeStore::GetChannelNames(std::vector<std::string>& names) const
+    {
+        names.clear();
+        for (std::map<std::string, AttributeChannelBase*>::const_iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            names.push_back(itr->first);
+        }
+        for (std::map<std::string, AttributeChannelLoader*>::const_iterator itr = mChannelLoaders.begin(); itr != mChannelLoaders.end(); ++itr)
+        {
+            names.push_back(itr->first);
+        }
+    }
+
+    void AttributeStore::GetLoadedChannelNames(std::vector<std::string>& names) const
+    {
+        names.clear();
+        for (std::map<std::string, AttributeChannelBase*>::const_iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            names.push_back(itr->first);
+        }
+    }
+
+    void AttributeStore::AddChannelLoader(const std::string& name, AttributeChannelLoader* loader)
+    {
+        RemoveChannel(name);
+        mChannelLoaders[name] = loader;
+    }
+
+    void AttributeStore::LoadAllChannels()
+    {
+        while (!mChannelLoaders.empty())
+        {
+            LoadChannel(mChannelLoaders.begin()->first);
+        }
+    }
+
+    void AttributeStore::LoadChannel(const std::string& name)
+    {
+        std::map<std::string, AttributeChannelLoader*>::iterator itr = mChannelLoaders.find(name);
+        if (itr == mChannelLoaders.end())
+        {
+            return;
+        }
+        // Take the loader out first, Load adds the channel through this store
+        AttributeChannelLoader* loader = itr->second;
+        mChannelLoaders.erase(itr);
+        loader->Load(name, this);
+        GPPFREEPOINTER(loader);
+    }
+
+    void AttributeStore::RemoveChannelLoader(const std::string& name)
+    {
+        std::map<std::string, AttributeChannelLoader*>::iterator itr = mChannelLoaders.find(name);
+        if (itr != mChannelLoaders.end())
+        {
+            GPPFREEPOINTER(itr->second);
+            mChannelLoaders.erase(itr);
+        }
+    }
+
+    void AttributeStore::SwapElements(GPP::Int id0, GPP::Int id1)
+    {
+        for (std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            itr->second->Swap(id0, id1);
+        }
+    }
+
+    void AttributeStore::PopbackElements(GPP::Int popCount)
+    {
+        for (std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            itr->second->Popback(popCount);
+        }
+    }
+
+    void AttributeStore::ResizeElements(GPP::Int elementCount)
+    {
+        for (std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            itr->second->Resize(elementCount);
+        }
+    }
+
+    void AttributeStore::CopyElement(GPP::Int fromId, GPP::Int toId)
+    {
+        for (std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            itr->second->Copy(fromId, toId);
+        }
+    }
+
+    void AttributeStore::ReorderElements(const std::vector<GPP::Int>& oldIds)
+    {
+        LoadAllChannels();
+        for (std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            itr->second->Reorder(oldIds);
+        }
+    }
+
+    void AttributeStore::RemoveUnmatchedChannels(GPP::Int elementCount)
+    {
+        std::map<std::string, AttributeChannelLoader*>::iterator loaderItr = mChannelLoaders.begin();
+        while (loaderItr != mChannelLoaders.end())
+        {
+            if (loaderItr->second->GetSize() != elementCount)
+            {
+                InfoLog << "AttributeStore::RemoveUnmatchedChannels drop " << loaderItr->first << " size " << loaderItr->second->GetSize()
+                    << " element count " << elementCount << std::endl;
+                GPPFREEPOINTER(loaderItr->second);
+                mChannelLoaders.erase(loaderItr++);
+            }
+            else
+            {
+                ++loaderItr;
+            }
+        }
+        std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.begin();
+        while (itr != mChannels.end())
+        {
+            if (itr->second->GetSize() != elementCount)
+            {
+                InfoLog << "AttributeStore::RemoveUnmatchedChannels drop " << itr->first << " size " << itr->second->GetSize()
+                    << " element count " << elementCount << std::endl;
+                GPPFREEPOINTER(itr->second);
+                mChannels.erase(itr++);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+    }
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include "GPP.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MagicApp
+{
+    // Channel names used by the apps
+    extern const char* IMAGE_COLOR_ID_CHANNEL;      // GPP::ImageColorId
+    extern const char* IMAGE_COLOR_ID_FLAG_CHANNEL; // int
+    extern const char* COLOR_ID_CHANNEL;            // int
+    extern const char* CLOUD_ID_CHANNEL;            // int
+
+    class AttributeChannelBase
+    {
+    public:
+        virtual ~AttributeChannelBase() {}
+        virtual GPP::Int GetSize(void) const = 0;
+        virtual void Swap(GPP::Int id0, GPP::Int id1) = 0;
+        virtual void Popback(GPP::Int popCount) = 0;
+        virtual void Resize(GPP::Int size) = 0;
+        virtual void Copy(GPP::Int fromId, GPP::Int toId) = 0;
+        virtual void Reorder(const std::vector<GPP::Int>& oldIds) = 0;
+    };
+
+    // One value per element, new elements get the default value
+    template<class T>
+    class AttributeChannel : public AttributeChannelBase
+    {
+    public:
+        explicit AttributeChannel(const T& defaultValue) :
+            mValues(),
+            mDefaultValue(defaultValue)
+        {
+        }
+
+        std::vector<T>& GetValues(void)
+        {
+            return mValues;
+        }
+
+        const std::vector<T>& GetValues(void) const
+        {
+            return mValues;
+        }
+
+        virtual GPP::Int GetSize() const
+        {
+            return mValues.size();
+        }
+
+        virtual void Swap(GPP::Int id0, GPP::Int id1)
+        {
+            T temp = mValues.at(id0);
+            mValues.at(id0) = mValues.at(id1);
+            mValues.at(id1) = temp;
+        }
+
+        virtual void Popback(GPP::Int popCount)
+        {
+            if (popCount <= 0)
+            {
+                return;
+            }
+            GPP::Int valueCount = mValues.size();
+            mValues.erase(mValues.end() - (popCount < valueCount ? popCount : valueCount), mValues.end());
+        }
+
+        virtual void Resize(GPP::Int size)
+        {
+            mValues.resize(size, mDefaultValue);
+        }
+
+        virtual void Copy(GPP::Int fromId, GPP::Int toId)
+        {
+            mValues.at(toId) = mValues.at(fromId);
+        }
+
+        virtual void Reorder(const std::vector<GPP::Int>& oldIds)
+        {
+            std::vector<T> values(oldIds.size());
+            GPP::Int valueCount = oldIds.size();
+            for (GPP::Int vid = 0; vid < valueCount; vid++)
+            {
+                values.at(vid) = mValues.at(oldIds.at(vid));
+            }
+            mValues.swap(values);
+        }
+
+    private:
+        std::vector<T> mValues;
+        T mDefaultValue;
+    };
+
+    class AttributeStore;
+
+    // Fills one channel of a store on its first use, so channels that are never read are never decoded
+    class AttributeChannelLoader
+    {
+    public:
+        virtual ~AttributeChannelLoader() {}
+        virtual GPP::Int GetSize(void) const = 0;
+        // Add the channel called name to store
+        virtual void Load(const std::string& name, AttributeStore* store) = 0;
+    };
+
+    // Named, typed per element side channels of one model (a value per point or per vertex).
+    // Each channel is stored as its own array and handed out by pointer, never copied.
+    // MagicPointCloud and MagicMesh forward point/vertex swaps, popbacks and inserts to the store, so channels stay in sync with the geometry.
+    // USAGE: 1. std::vector<int>& colorIds = attributes->AddChannel<int>(COLOR_ID_CHANNEL, -1); or attributes->SwapChannel(COLOR_ID_CHANNEL, colorIds, -1);
+    //        2. std::vector<int>* colorIds = attributes->GetChannel<int>(COLOR_ID_CHANNEL);  // NULL if there is no such channel
+    //        3. MagicMesh magicMesh(triMesh); magicMesh.SetAttributes(attributes);
+    //        4. attributes->AddChannelLoader(COLOR_ID_CHANNEL, loader);  // the channel is loaded by the first GetChannel
+    class AttributeStore
+    {
+    public:
+        AttributeStore();
+        ~AttributeStore();
+
+        // Return the channel values. A missing channel, or one of another type, is created empty
+        template<class T>
+        std::vector<T>& AddChannel(const std::string& name, const T& defaultValue)
+        {
+            LoadChannel(name);
+            std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.find(name);
+            if (itr != mChannels.end())
+            {
+                AttributeChannel<T>* channel = dynamic_cast<AttributeChannel<T>*>(itr->second);
+                if (channel)
+                {
+                    return channel->GetValues();
+                }
+                GPPFREEPOINTER(itr->second);
+                mChannels.erase(itr);
+            }
+            AttributeChannel<T>* channel = new AttributeChannel<T>(defaultValue);
+            mChannels[name] = channel;
+            return channel->GetValues();
+        }
+
+        // Move values into the channel without copying. values gets the previous channel values
+        template<class T>
+        void SwapChannel(const std::string& name, std::vector<T>& values, const T& defaultValue)
+        {
+            RemoveChannelLoader(name);
+            AddChannel<T>(name, defaultValue).swap(values);
+        }
+
+        // NULL if there is no channel name with type T
+        template<class T>
+        std::vector<T>* GetChannel(const std::string& name)
+        {
+            LoadChannel(name);
+            std::map<std::string, AttributeChannelBase*>::iterator itr = mChannels.find(name);
+            if (itr == mChannels.end())
+            {
+                return NULL;
+            }
+            AttributeChannel<T>* channel = dynamic_cast<AttributeChannel<T>*>(itr->second);
+            return channel ? &(channel->GetValues()) : NULL;
+        }
+
+        template<class T>
+        const std::vector<T>* GetChannel(const std::string& name) const
+        {
+            const_cast<AttributeStore*>(this)->LoadChannel(name);
+            std::map<std::string, AttributeChannelBase*>::const_iterator itr = mChannels.find(name);
+            if (itr == mChannels.end())
+            {
+                return NULL;
+            }
+            const AttributeChannel<T>* channel = dynamic_cast<const AttributeChannel<T>*>(itr->second);
+            return channel ? &(channel->GetValues()) : NULL;
+        }
+
+        // NULL if the channel is missing or has not elementCount values
+        template<class T>
+        std::vector<T>* GetChannel(const std::string& name, GPP::Int elementCount)
+        {
+            std::vector<T>* values = GetChannel<T>(name);
+            return (values && GPP::Int(values->size()) == elementCount) ? values : NULL;
+        }
+
+        bool HasChannel(const std::string& name) const;
+        void RemoveChannel(const std::string& name);
+        void Clear(void);
+        // Exchange all channels and loaders with store, nothing is copied
+        void Swap(AttributeStore& store);
+        // Loaded and not yet loaded channels
+        void GetChannelNames(std::vector<std::string>& names) const;
+        // Only channels that are in memory, getting them does not load anything
+        void GetLoadedChannelNames(std::vector<std::string>& names) const;
+
+        // The store owns loader. An existing channel called name is replaced
+        void AddChannelLoader(const std::string& name, AttributeChannelLoader* loader);
+        void LoadAllChannels(void);
+
+        // Element operations applied to every loaded channel. They are called once per element,
+        // so call LoadAllChannels once before a batch of them (MagicMesh and MagicPointCloud SetAttributes do)
+        void SwapElements(GPP::Int id0, GPP::Int id1);
+        void PopbackElements(GPP::Int popCount);
+        void ResizeElements(GPP::Int elementCount);
+        void CopyElement(GPP::Int fromId, GPP::Int toId);
+        // The new element i is the old element oldIds[i]. Deleting is a reorder with the kept ids. Loads all channels first
+        void ReorderElements(const std::vector<GPP::Int>& oldIds);
+        // Drop and log channels whose size is not elementCount, they belong to an older model.
+        // Their data is lost, so call it only when the model has really been replaced
+        void RemoveUnmatchedChannels(GPP::Int elementCount);
+
+    private:
+        AttributeStore(const AttributeStore&);
+        AttributeStore& operator = (const AttributeStore&);
+        void LoadChannel(const std::string& name);
+        void RemoveChannelLoader(const std::string& name);
+
+    private:
+        std::map<std::string, AttributeChannelBase*> mChannels;
+        std::map<std::string, AttributeChannelLoader*> mChannelLoaders;
+    };
+}
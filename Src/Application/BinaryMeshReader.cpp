@@ -0,0 +1,705 @@
+#include "BinaryMeshReader.h"
+#include "VertexWelder.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <windows.h>
+#include <sstream>
+#include <string.h>
+
+namespace MagicApp
+{
+    static const GPP::Int STL_HEADER_SIZE = 84;
+    static const GPP::Int STL_RECORD_SIZE = 50;
+
+    enum PlyType
+    {
+        PLY_NONE = 0,
+        PLY_INT8,
+        PLY_UINT8,
+        PLY_INT16,
+        PLY_UINT16,
+        PLY_INT32,
+        PLY_UINT32,
+        PLY_FLOAT32,
+        PLY_FLOAT64
+    };
+
+    struct PlyProperty
+    {
+        std::string mName;
+        PlyType mType;
+        PlyType mCountType;
+        GPP::Int mOffset;
+    };
+
+    struct PlyElement
+    {
+        std::string mName;
+        GPP::Int mCount;
+        GPP::Int mRecordSize;
+        std::vector<PlyProperty> mProperties;
+    };
+
+    static PlyType ParsePlyType(const std::string& typeName)
+    {
+        if (typeName == "char" || typeName == "int8") return PLY_INT8;
+        if (typeName == "uchar" || typeName == "uint8") return PLY_UINT8;
+        if (typeName == "short" || typeName == "int16") return PLY_INT16;
+        if (typeName == "ushort" || typeName == "uint16") return PLY_UINT16;
+        if (typeName == "int" || typeName == "int32") return PLY_INT32;
+        if (typeName == "uint" || typeName == "uint32") return PLY_UINT32;
+        if (typeName == "float" || typeName == "float32") return PLY_FLOAT32;
+        if (typeName == "double" || typeName == "float64") return PLY_FLOAT64;
+        return PLY_NONE;
+    }
+
+    static GPP::Int GetPlyTypeSize(PlyType type)
+    {
+        switch (type)
+        {
+        case PLY_INT8:
+        case PLY_UINT8:
+            return 1;
+        case PLY_INT16:
+        case PLY_UINT16:
+            return 2;
+        case PLY_INT32:
+        case PLY_UINT32:
+        case PLY_FLOAT32:
+            return 4;
+        case PLY_FLOAT64:
+            return 8;
+        default:
+            return 0;
+        }
+    }
+
+    // Records are not aligned, so values are copied out byte by byte
+    static GPP::Real ReadPlyValue(const char* data, PlyType type)
+    {
+        switch (type)
+        {
+        case PLY_INT8:
+            return GPP::Real(*(const signed char*)data);
+        case PLY_UINT8:
+            return GPP::Real(*(const unsigned char*)data);
+        case PLY_INT16:
+            {
+                short value;
+                memcpy(&value, data, sizeof(short));
+                return GPP::Real(value);
+            }
+        case PLY_UINT16:
+            {
+                unsigned short value;
+                memcpy(&value, data, sizeof(unsigned short));
+                return GPP::Real(value);
+            }
+        case PLY_INT32:
+            {
+                int value;
+                memcpy(&value, data, sizeof(int));
+                return GPP::Real(value);
+            }
+        case PLY_UINT32:
+            {
+                unsigned int value;
+                memcpy(&value, data, sizeof(unsigned int));
+                return GPP::Real(value);
+            }
+        case PLY_FLOAT32:
+            {
+                float value;
+                memcpy(&value, data, sizeof(float));
+                return GPP::Real(value);
+            }
+        case PLY_FLOAT64:
+            {
+                double value;
+                memcpy(&value, data, sizeof(double));
+                return GPP::Real(value);
+            }
+        default:
+            return 0;
+        }
+    }
+
+    static const PlyProperty* FindPlyProperty(const PlyElement& element, const char* name0, const char* name1)
+    {
+        for (std::vector<PlyProperty>::const_iterator itr = element.mProperties.begin(); itr != element.mProperties.end(); ++itr)
+        {
+            if (itr->mName == name0 || (name1 != NULL && itr->mName == name1))
+            {
+                return &(*itr);
+            }
+        }
+        return NULL;
+    }
+
+    class StlDecodeTask : public MagicCore::ParallelTask
+    {
+    public:
+        StlDecodeTask(const char* fileData, std::vector<GPP::Real>* pointCoords) :
+            mpFileData(fileData),
+            mpPointCoords(pointCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            float recordCoords[9];
+            for (int fid = startId; fid < endId; fid++)
+            {
+                // normal, 3 vertices and the attribute byte count. The normal is recomputed
+                const char* record = mpFileData + STL_HEADER_SIZE + GPP::ULongInt(fid) * STL_RECORD_SIZE;
+                memcpy(recordCoords, record + 12, sizeof(float) * 9);
+                GPP::Real* pointCoords = &(mpPointCoords->at(fid * 9));
+                for (int cid = 0; cid < 9; cid++)
+                {
+                    pointCoords[cid] = recordCoords[cid];
+                }
+            }
+        }
+
+    private:
+        const char* mpFileData;
+        std::vector<GPP::Real>* mpPointCoords;
+    };
+
+    class PlyVertexTask : public MagicCore::ParallelTask
+    {
+    public:
+        PlyVertexTask(const char* elementData, GPP::Int recordSize, const PlyProperty** properties, GPP::Real normalScale, GPP::Real colorScale,
+            std::vector<GPP::Real>* vertexCoords, std::vector<GPP::Real>* vertexNormals, std::vector<GPP::Real>* vertexColors) :
+            mpElementData(elementData),
+            mRecordSize(recordSize),
+            mpProperties(properties),
+            mNormalScale(normalScale),
+            mColorScale(colorScale),
+            mpVertexCoords(vertexCoords),
+            mpVertexNormals(vertexNormals),
+            mpVertexColors(vertexColors)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            bool hasNormal = !mpVertexNormals->empty();
+            bool hasColor = !mpVertexColors->empty();
+            for (int vid = startId; vid < endId; vid++)
+            {
+                const char* record = mpElementData + GPP::ULongInt(vid) * mRecordSize;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    const PlyProperty* coordProperty = mpProperties[axis];
+                    mpVertexCoords->at(vid * 3 + axis) = ReadPlyValue(record + coordProperty->mOffset, coordProperty->mType);
+                    if (hasNormal)
+                    {
+                        const PlyProperty* normalProperty = mpProperties[3 + axis];
+                        mpVertexNormals->at(vid * 3 + axis) = ReadPlyValue(record + normalProperty->mOffset, normalProperty->mType) * mNormalScale;
+                    }
+                    if (hasColor)
+                    {
+                        const PlyProperty* colorProperty = mpProperties[6 + axis];
+                        mpVertexColors->at(vid * 3 + axis) = ReadPlyValue(record + colorProperty->mOffset, colorProperty->mType) * mColorScale;
+                    }
+                }
+            }
+        }
+
+    private:
+        const char* mpElementData;
+        GPP::Int mRecordSize;
+        const PlyProperty** mpProperties;
+        GPP::Real mNormalScale;
+        GPP::Real mColorScale;
+        std::vector<GPP::Real>* mpVertexCoords;
+        std::vector<GPP::Real>* mpVertexNormals;
+        std::vector<GPP::Real>* mpVertexColors;
+    };
+
+    class PlyFaceTask : public MagicCore::ParallelTask
+    {
+    public:
+        PlyFaceTask(const char* elementData, GPP::Int recordSize, const PlyProperty* indexProperty, GPP::Int vertexCount,
+            std::vector<GPP::Int>* triangleVertexIds) :
+            mpElementData(elementData),
+            mRecordSize(recordSize),
+            mpIndexProperty(indexProperty),
+            mVertexCount(vertexCount),
+            mpTriangleVertexIds(triangleVertexIds),
+            mThreadInvalidCounts(MagicCore::ParallelTool::GetThreadCount(), 0)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int countSize = GetPlyTypeSize(mpIndexProperty->mCountType);
+            GPP::Int indexSize = GetPlyTypeSize(mpIndexProperty->mType);
+            for (int fid = startId; fid < endId; fid++)
+            {
+                const char* listData = mpElementData + GPP::ULongInt(fid) * mRecordSize + mpIndexProperty->mOffset;
+                if (GPP::Int(ReadPlyValue(listData, mpIndexProperty->mCountType)) != 3)
+                {
+                    mThreadInvalidCounts.at(threadId)++;
+                    continue;
+                }
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    GPP::Real vertexId = ReadPlyValue(listData + countSize + localId * indexSize, mpIndexProperty->mType);
+                    if (vertexId < 0 || vertexId >= mVertexCount)
+                    {
+                        mThreadInvalidCounts.at(threadId)++;
+                        vertexId = 0;
+                    }
+                    mpTriangleVertexIds->at(fid * 3 + localId) = GPP::Int(vertexId);
+                }
+            }
+        }
+
+        GPP::Int GetInvalidCount(void) const
+        {
+            GPP::Int invalidCount = 0;
+            for (std::vector<GPP::Int>::const_iterator itr = mThreadInvalidCounts.begin(); itr != mThreadInvalidCounts.end(); ++itr)
+            {
+                invalidCount += *itr;
+            }
+            return invalidCount;
+        }
+
+    private:
+        const char* mpElementData;
+        GPP::Int mRecordSize;
+        const PlyProperty* mpIndexProperty;
+        GPP::Int mVertexCount;
+        std::vector<GPP::Int>* mpTriangleVertexIds;
+        std::vector<GPP::Int> mThreadInvalidCounts;
+    };
+
+    BinaryMeshReader::BinaryMeshReader() :
+        mpFileHandle(NULL),
+        mpMappingHandle(NULL),
+        mpFileData(NULL),
+        mFileSize(0),
+        mVertexCoords(),
+        mVertexNormals(),
+        mVertexColors(),
+        mTriangleVertexIds(),
+        mReadTime(0),
+        mWeldTime(0),
+        mBuildTime(0)
+    {
+    }
+
+    BinaryMeshReader::~BinaryMeshReader()
+    {
+        UnmapFile();
+    }
+
+    GPP::TriMesh* BinaryMeshReader::ImportTriMesh(const std::string& fileName)
+    {
+        Clear();
+        mReadTime = 0;
+        mWeldTime = 0;
+        mBuildTime = 0;
+        double startTime = MagicCore::ToolKit::GetTime();
+        if (!MapFile(fileName))
+        {
+            return NULL;
+        }
+        bool isStl = DecodeStl();
+        bool isDecoded = isStl || DecodePly(false);
+        UnmapFile();
+        mReadTime = MagicCore::ToolKit::GetTime() - startTime;
+        if (!isDecoded || (isStl && !WeldPoints()))
+        {
+            Clear();
+            return NULL;
+        }
+        GPP::TriMesh* triMesh = BuildTriMesh();
+        Clear();
+        return triMesh;
+    }
+
+    GPP::PointCloud* BinaryMeshReader::ImportPointCloud(const std::string& fileName)
+    {
+        Clear();
+        mReadTime = 0;
+        mWeldTime = 0;
+        mBuildTime = 0;
+        double startTime = MagicCore::ToolKit::GetTime();
+        if (!MapFile(fileName))
+        {
+            return NULL;
+        }
+        bool isDecoded = DecodePly(true);
+        UnmapFile();
+        mReadTime = MagicCore::ToolKit::GetTime() - startTime;
+        if (!isDecoded)
+        {
+            Clear();
+            return NULL;
+        }
+        GPP::PointCloud* pointCloud = BuildPointCloud();
+        Clear();
+        return pointCloud;
+    }
+
+    double BinaryMeshReader::GetReadTime() const
+    {
+        return mReadTime;
+    }
+
+    double BinaryMeshReader::GetWeldTime() const
+    {
+        return mWeldTime;
+    }
+
+    double BinaryMeshReader::GetBuildTime() const
+    {
+        return mBuildTime;
+    }
+
+    bool BinaryMeshReader::MapFile(const std::string& fileName)
+    {
+        HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        mpFileHandle = fileHandle;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+        {
+            UnmapFile();
+            return false;
+        }
+        mFileSize = GPP::ULongInt(fileSize.QuadPart);
+        mpMappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mpMappingHandle == NULL)
+        {
+            UnmapFile();
+            return false;
+        }
+        mpFileData = (const char*)MapViewOfFile(mpMappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (mpFileData == NULL)
+        {
+            UnmapFile();
+            return false;
+        }
+        return true;
+    }
+
+    void BinaryMeshReader::UnmapFile()
+    {
+        if (mpFileData != NULL)
+        {
+            UnmapViewOfFile(mpFileData);
+            mpFileData = NULL;
+        }
+        if (mpMappingHandle != NULL)
+        {
+            CloseHandle(mpMappingHandle);
+            mpMappingHandle = NULL;
+        }
+        if (mpFileHandle != NULL)
+        {
+            CloseHandle(mpFileHandle);
+            mpFileHandle = NULL;
+        }
+        mFileSize = 0;
+    }
+
+    bool BinaryMeshReader::DecodeStl()
+    {
+        // A binary STL is exactly header + triangle count * record size
+        if (mFileSize < STL_HEADER_SIZE)
+        {
+            return false;
+        }
+        unsigned int triangleCount = 0;
+        memcpy(&triangleCount, mpFileData + 80, sizeof(unsigned int));
+        if (triangleCount == 0 || triangleCount > GPP::INT_LARGE / 9 ||
+            mFileSize != STL_HEADER_SIZE + GPP::ULongInt(triangleCount) * STL_RECORD_SIZE)
+        {
+            return false;
+        }
+        mVertexCoords.resize(GPP::ULongInt(triangleCount) * 9);
+        StlDecodeTask decodeTask(mpFileData, &mVertexCoords);
+        MagicCore::ParallelTool::ParallelFor(triangleCount, &decodeTask);
+        return true;
+    }
+
+    bool BinaryMeshReader::DecodePly(bool isPointCloud)
+    {
+        GPP::ULongInt headerEnd = 0;
+        const char* endTag = "end_header";
+        GPP::ULongInt searchSize = mFileSize < 65536 ? mFileSize : 65536;
+        for (GPP::ULongInt pos = 0; pos + 10 < searchSize; pos++)
+        {
+            if (memcmp(mpFileData + pos, endTag, 10) == 0)
+            {
+                headerEnd = pos + 10;
+                while (headerEnd < mFileSize && mpFileData[headerEnd] != '\n')
+                {
+                    headerEnd++;
+                }
+                headerEnd++;
+                break;
+            }
+        }
+        if (headerEnd == 0 || headerEnd > mFileSize || memcmp(mpFileData, "ply", 3) != 0)
+        {
+            return false;
+        }
+        std::istringstream headerStream(std::string(mpFileData, size_t(headerEnd)));
+        std::string line;
+        std::vector<PlyElement> elements;
+        bool isLittleEndian = false;
+        while (std::getline(headerStream, line))
+        {
+            std::istringstream lineStream(line);
+            std::string keyword;
+            lineStream >> keyword;
+            if (keyword == "format")
+            {
+                std::string format;
+                lineStream >> format;
+                isLittleEndian = (format == "binary_little_endian");
+            }
+            else if (keyword == "element")
+            {
+                PlyElement element;
+                element.mCount = 0;
+                element.mRecordSize = 0;
+                lineStream >> element.mName >> element.mCount;
+                elements.push_back(element);
+            }
+            else if (keyword == "property" && !elements.empty())
+            {
+                PlyElement& element = elements.back();
+                PlyProperty property;
+                std::string typeName;
+                lineStream >> typeName;
+                property.mOffset = element.mRecordSize;
+                property.mCountType = PLY_NONE;
+                if (typeName == "list")
+                {
+                    // Only triangle faces have a fixed record size: count + 3 indices
+                    std::string countTypeName, indexTypeName;
+                    lineStream >> countTypeName >> indexTypeName;
+                    property.mCountType = ParsePlyType(countTypeName);
+                    property.mType = ParsePlyType(indexTypeName);
+                    element.mRecordSize += GetPlyTypeSize(property.mCountType) + GetPlyTypeSize(property.mType) * 3;
+                }
+                else
+                {
+                    property.mType = ParsePlyType(typeName);
+                    element.mRecordSize += GetPlyTypeSize(property.mType);
+                }
+                lineStream >> property.mName;
+                if (property.mType == PLY_NONE || (typeName == "list" && (property.mCountType == PLY_NONE || element.mName != "face")))
+                {
+                    return false;
+                }
+                element.mProperties.push_back(property);
+            }
+        }
+        if (!isLittleEndian)
+        {
+            return false;
+        }
+
+        const PlyElement* vertexElement = NULL;
+        const PlyElement* faceElement = NULL;
+        const char* vertexData = NULL;
+        const char* faceData = NULL;
+        GPP::ULongInt dataPos = headerEnd;
+        for (std::vector<PlyElement>::const_iterator itr = elements.begin(); itr != elements.end(); ++itr)
+        {
+            if (itr->mName == "vertex")
+            {
+                vertexElement = &(*itr);
+                vertexData = mpFileData + dataPos;
+            }
+            else if (itr->mName == "face")
+            {
+                faceElement = &(*itr);
+                faceData = mpFileData + dataPos;
+            }
+            dataPos += GPP::ULongInt(itr->mCount) * itr->mRecordSize;
+        }
+        if (vertexElement == NULL || vertexElement->mCount <= 0 || dataPos > mFileSize)
+        {
+            return false;
+        }
+        if (!isPointCloud && (faceElement == NULL || faceElement->mCount <= 0 || faceElement->mCount > GPP::INT_LARGE / 3))
+        {
+            return false;
+        }
+        // x y z, nx ny nz, red green blue
+        const PlyProperty* vertexProperties[9] = {
+            FindPlyProperty(*vertexElement, "x", NULL), FindPlyProperty(*vertexElement, "y", NULL), FindPlyProperty(*vertexElement, "z", NULL),
+            FindPlyProperty(*vertexElement, "nx", NULL), FindPlyProperty(*vertexElement, "ny", NULL), FindPlyProperty(*vertexElement, "nz", NULL),
+            FindPlyProperty(*vertexElement, "red", "r"), FindPlyProperty(*vertexElement, "green", "g"), FindPlyProperty(*vertexElement, "blue", "b") };
+        if (vertexProperties[0] == NULL || vertexProperties[1] == NULL || vertexProperties[2] == NULL)
+        {
+            return false;
+        }
+        GPP::Int vertexCount = vertexElement->mCount;
+        mVertexCoords.resize(vertexCount * 3);
+        GPP::Real normalScale = 1.0;
+        if (vertexProperties[3] != NULL && vertexProperties[4] != NULL && vertexProperties[5] != NULL)
+        {
+            mVertexNormals.resize(vertexCount * 3);
+            if (vertexProperties[3]->mType == PLY_INT8)
+            {
+                // Compact normals written by ModelExporter
+                normalScale = 1.0 / 127.0;
+            }
+        }
+        GPP::Real colorScale = 1.0;
+        if (vertexProperties[6] != NULL && vertexProperties[7] != NULL && vertexProperties[8] != NULL)
+        {
+            mVertexColors.resize(vertexCount * 3);
+            if (vertexProperties[6]->mType == PLY_UINT8)
+            {
+                colorScale = 1.0 / 255.0;
+            }
+            else if (vertexProperties[6]->mType == PLY_UINT16)
+            {
+                colorScale = 1.0 / 65535.0;
+            }
+        }
+        PlyVertexTask vertexTask(vertexData, vertexElement->mRecordSize, vertexProperties, normalScale, colorScale,
+            &mVertexCoords, &mVertexNormals, &mVertexColors);
+        MagicCore::ParallelTool::ParallelFor(vertexCount, &vertexTask);
+        if (isPointCloud)
+        {
+            return true;
+        }
+        const PlyProperty* indexProperty = FindPlyProperty(*faceElement, "vertex_indices", "vertex_index");
+        if (indexProperty == NULL || indexProperty->mCountType == PLY_NONE)
+        {
+            return false;
+        }
+        mTriangleVertexIds.resize(faceElement->mCount * 3);
+        PlyFaceTask faceTask(faceData, faceElement->mRecordSize, indexProperty, vertexCount, &mTriangleVertexIds);
+        MagicCore::ParallelTool::ParallelFor(faceElement->mCount, &faceTask);
+        if (faceTask.GetInvalidCount() > 0)
+        {
+            // Polygon faces or bad indices: let the generic parser handle it
+            return false;
+        }
+        return true;
+    }
+
+    bool BinaryMeshReader::WeldPoints()
+    {
+        VertexWelder vertexWelder;
+        GPP::Int weldCount = 0;
+        if (vertexWelder.Weld(mVertexCoords, mTriangleVertexIds, weldCount) != GPP_NO_ERROR)
+        {
+            return false;
+        }
+        mWeldTime = vertexWelder.GetWeldTime();
+        // Welded vertices are numbered by their first point, keep that point's coordinate
+        GPP::Int pointCount = mTriangleVertexIds.size();
+        GPP::Int nextWeldId = 0;
+        for (GPP::Int pid = 0; pid < pointCount && nextWeldId < weldCount; pid++)
+        {
+            if (mTriangleVertexIds.at(pid) == nextWeldId)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    mVertexCoords.at(nextWeldId * 3 + axis) = mVertexCoords.at(pid * 3 + axis);
+                }
+                nextWeldId++;
+            }
+        }
+        mVertexCoords.resize(weldCount * 3);
+        return true;
+    }
+
+    GPP::TriMesh* BinaryMeshReader::BuildTriMesh()
+    {
+        double startTime = MagicCore::ToolKit::GetTime();
+        GPP::TriMesh* triMesh = new GPP::TriMesh;
+        GPP::Int vertexCount = mVertexCoords.size() / 3;
+        bool hasNormal = !mVertexNormals.empty();
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            GPP::Vector3 coord(mVertexCoords.at(vid * 3), mVertexCoords.at(vid * 3 + 1), mVertexCoords.at(vid * 3 + 2));
+            if (hasNormal)
+            {
+                triMesh->InsertVertex(coord, GPP::Vector3(mVertexNormals.at(vid * 3), mVertexNormals.at(vid * 3 + 1), mVertexNormals.at(vid * 3 + 2)));
+            }
+            else
+            {
+                triMesh->InsertVertex(coord);
+            }
+        }
+        // Triangles collapsed by welding are dropped
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            GPP::Int vertexId0 = mTriangleVertexIds.at(fid * 3);
+            GPP::Int vertexId1 = mTriangleVertexIds.at(fid * 3 + 1);
+            GPP::Int vertexId2 = mTriangleVertexIds.at(fid * 3 + 2);
+            if (vertexId0 == vertexId1 || vertexId1 == vertexId2 || vertexId2 == vertexId0)
+            {
+                continue;
+            }
+            triMesh->InsertTriangle(vertexId0, vertexId1, vertexId2);
+        }
+        if (!mVertexColors.empty())
+        {
+            triMesh->SetHasVertexColor(true);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                triMesh->SetVertexColor(vid, GPP::Vector3(mVertexColors.at(vid * 3), mVertexColors.at(vid * 3 + 1), mVertexColors.at(vid * 3 + 2)));
+            }
+        }
+        mBuildTime = MagicCore::ToolKit::GetTime() - startTime;
+        return triMesh;
+    }
+
+    GPP::PointCloud* BinaryMeshReader::BuildPointCloud()
+    {
+        double startTime = MagicCore::ToolKit::GetTime();
+        bool hasNormal = !mVertexNormals.empty();
+        bool hasColor = !mVertexColors.empty();
+        GPP::PointCloud* pointCloud = new GPP::PointCloud(hasNormal, hasColor);
+        GPP::Int pointCount = mVertexCoords.size() / 3;
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Vector3 coord(mVertexCoords.at(pid * 3), mVertexCoords.at(pid * 3 + 1), mVertexCoords.at(pid * 3 + 2));
+            if (hasNormal)
+            {
+                pointCloud->InsertPoint(coord, GPP::Vector3(mVertexNormals.at(pid * 3), mVertexNormals.at(pid * 3 + 1), mVertexNormals.at(pid * 3 + 2)));
+            }
+            else
+            {
+                pointCloud->InsertPoint(coord);
+            }
+        }
+        if (hasColor)
+        {
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                pointCloud->SetPointColor(pid, GPP::Vector3(mVertexColors.at(pid * 3), mVertexColors.at(pid * 3 + 1), mVertexColors.at(pid * 3 + 2)));
+            }
+        }
+        mBuildTime = MagicCore::ToolKit::GetTime() - startTime;
+        return pointCloud;
+    }
+
+    void BinaryMeshReader::Clear()
+    {
+        std::vector<GPP::Real>().swap(mVertexCoords);
+        std::vector<GPP::Real>().swap(mVertexNormals);
+        std::vector<GPP::Real>().swap(mVertexColors);
+        std::vector<GPP::Int>().swap(mTriangleVertexIds);
+    }
+}
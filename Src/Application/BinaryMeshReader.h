@@ -0,0 +1,52 @@
+#pragma once
+#include "GPP.h"
+#include <string>
+#include <vector>
+
+namespace MagicApp
+{
+    // Reads binary STL and little endian binary PLY triangle meshes and PLY point clouds from a memory mapped file.
+    // The fixed size vertex and face records are decoded in parallel straight into coordinate, normal, color and index arrays,
+    // STL points are welded with VertexWelder, and the mesh is built from the arrays at the end.
+    // Other formats and layouts (ascii, big endian, polygon faces) return NULL, so the caller can fall back to GPP::Parser.
+    // USAGE: 1. GPP::TriMesh* triMesh = binaryMeshReader.ImportTriMesh("model.stl");
+    //        2. binaryMeshReader.GetReadTime(); binaryMeshReader.GetWeldTime(); binaryMeshReader.GetBuildTime();
+    class BinaryMeshReader
+    {
+    public:
+        BinaryMeshReader();
+        ~BinaryMeshReader();
+
+        GPP::TriMesh* ImportTriMesh(const std::string& fileName);
+        // PLY only, faces are ignored
+        GPP::PointCloud* ImportPointCloud(const std::string& fileName);
+
+        double GetReadTime(void) const;
+        double GetWeldTime(void) const;
+        double GetBuildTime(void) const;
+
+    private:
+        bool MapFile(const std::string& fileName);
+        void UnmapFile(void);
+        bool DecodeStl(void);
+        bool DecodePly(bool isPointCloud);
+        bool WeldPoints(void);
+        GPP::TriMesh* BuildTriMesh(void);
+        GPP::PointCloud* BuildPointCloud(void);
+        void Clear(void);
+
+    private:
+        void* mpFileHandle;
+        void* mpMappingHandle;
+        const char* mpFileData;
+        GPP::ULongInt mFileSize;
+        // 3 values per vertex, normals and colors are empty if the file has none
+        std::vector<GPP::Real> mVertexCoords;
+        std::vector<GPP::Real> mVertexNormals;
+        std::vector<GPP::Real> mVertexColors;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        double mReadTime;
+        double mWeldTime;
+        double mBuildTime;
+    };
+}
@@ -0,0 +1,464 @@
+#include "BoundaryLoopTracker.h"
+#include "MeshAdjacency.h"
+#include <algorithm>
+
+namespace MagicApp
+{
+    BoundaryLoopTracker::BoundaryLoopTracker() :
+        mpTriMesh(NULL),
+        mMeshVersion(0),
+        mVertexCount(0),
+        mTriangleCount(0),
+        mBoundaryEdges(),
+        mLoops(),
+        mDirtyLoopIds(),
+        mDirtyVertexIds(),
+        mNextLoopStamp(0)
+    {
+    }
+
+    BoundaryLoopTracker::~BoundaryLoopTracker()
+    {
+    }
+
+    GPP::ErrorCode BoundaryLoopTracker::Init(const GPP::ITriMesh* triMesh, const MeshAdjacency* adjacency, GPP::Int meshVersion,
+        const std::vector<std::vector<GPP::Int> >* seedLoops)
+    {
+        Clear();
+        if (triMesh == NULL || adjacency == NULL || !adjacency->IsBuiltFrom(triMesh, meshVersion))
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mpTriMesh = triMesh;
+        GPP::Int edgeCount = adjacency->GetEdgeCount();
+        GPP::Int edgeVertexIds[2];
+        GPP::Int faceVertexIds[3];
+        for (GPP::Int eid = 0; eid < edgeCount; eid++)
+        {
+            if (!adjacency->IsBoundaryEdge(eid))
+            {
+                continue;
+            }
+            adjacency->GetEdgeVertexIds(eid, edgeVertexIds);
+            triMesh->GetTriangleVertexIds(adjacency->GetEdgeFaceIds(eid)[0], faceVertexIds);
+            // Keep the direction of the triangle
+            bool isForward = false;
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                if (faceVertexIds[fvid] == edgeVertexIds[0] && faceVertexIds[(fvid + 1) % 3] == edgeVertexIds[1])
+                {
+                    isForward = true;
+                    break;
+                }
+            }
+            if (isForward)
+            {
+                InsertBoundaryEdge(edgeVertexIds[0], edgeVertexIds[1]);
+            }
+            else
+            {
+                InsertBoundaryEdge(edgeVertexIds[1], edgeVertexIds[0]);
+            }
+        }
+        if (seedLoops)
+        {
+            for (std::vector<std::vector<GPP::Int> >::const_iterator itr = seedLoops->begin(); itr != seedLoops->end(); ++itr)
+            {
+                SeedLoop(*itr);
+            }
+        }
+        TraceDirtyVertices();
+        mMeshVersion = meshVersion;
+        mVertexCount = triMesh->GetVertexCount();
+        mTriangleCount = triMesh->GetTriangleCount();
+
+        return GPP_NO_ERROR;
+    }
+
+    bool BoundaryLoopTracker::IsBuiltFrom(const GPP::ITriMesh* triMesh, GPP::Int meshVersion) const
+    {
+        return triMesh != NULL && mpTriMesh == triMesh && mMeshVersion == meshVersion &&
+            mVertexCount == triMesh->GetVertexCount() && mTriangleCount == triMesh->GetTriangleCount();
+    }
+
+    void BoundaryLoopTracker::Clear()
+    {
+        mpTriMesh = NULL;
+        mMeshVersion = 0;
+        mVertexCount = 0;
+        mTriangleCount = 0;
+        mBoundaryEdges.clear();
+        mLoops.clear();
+        mDirtyLoopIds.clear();
+        mDirtyVertexIds.clear();
+    }
+
+    GPP::ErrorCode BoundaryLoopTracker::AppendTriangles(GPP::Int fromTriangleId, GPP::Int meshVersion)
+    {
+        if (mpTriMesh == NULL || fromTriangleId != mTriangleCount || mVertexCount > mpTriMesh->GetVertexCount())
+        {
+            Clear();
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = mpTriMesh->GetVertexCount();
+        GPP::Int triangleCount = mpTriMesh->GetTriangleCount();
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = fromTriangleId; fid < triangleCount; fid++)
+        {
+            mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+            if (vertexIds[0] < 0 || vertexIds[0] >= vertexCount || vertexIds[1] < 0 || vertexIds[1] >= vertexCount ||
+                vertexIds[2] < 0 || vertexIds[2] >= vertexCount)
+            {
+                Clear();
+                return GPP_INVALID_INPUT;
+            }
+            AddTriangle(vertexIds);
+        }
+        ReleaseDirtyLoops();
+        TraceDirtyVertices();
+        mMeshVersion = meshVersion;
+        mVertexCount = vertexCount;
+        mTriangleCount = triangleCount;
+
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode BoundaryLoopTracker::RemoveVertices(const std::vector<bool>& deleteFlags)
+    {
+        if (mpTriMesh == NULL || GPP::Int(deleteFlags.size()) != mVertexCount || mVertexCount != mpTriMesh->GetVertexCount() ||
+            mTriangleCount != mpTriMesh->GetTriangleCount())
+        {
+            Clear();
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+            if (deleteFlags.at(vertexIds[0]) || deleteFlags.at(vertexIds[1]) || deleteFlags.at(vertexIds[2]))
+            {
+                RemoveTriangle(vertexIds);
+            }
+        }
+        ReleaseDirtyLoops();
+
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode BoundaryLoopTracker::RemapVertices(const std::vector<GPP::Int>& oldToNewIds, GPP::Int meshVersion)
+    {
+        if (mpTriMesh == NULL || GPP::Int(oldToNewIds.size()) != mVertexCount)
+        {
+            Clear();
+            return GPP_INVALID_INPUT;
+        }
+        ReleaseDirtyLoops();
+        BoundaryEdgeMap boundaryEdges;
+        for (BoundaryEdgeMap::iterator itr = mBoundaryEdges.begin(); itr != mBoundaryEdges.end(); ++itr)
+        {
+            BoundaryEdge boundaryEdge = itr->second;
+            GPP::Int fromVertexId = oldToNewIds.at(itr->first);
+            boundaryEdge.mToVertexId = oldToNewIds.at(boundaryEdge.mToVertexId);
+            if (fromVertexId < 0 || boundaryEdge.mToVertexId < 0)
+            {
+                // A half edge of a deleted vertex survived, the deletion does not match RemoveVertices
+                Clear();
+                return GPP_INVALID_INPUT;
+            }
+            boundaryEdges.insert(std::make_pair(fromVertexId, boundaryEdge));
+        }
+        mBoundaryEdges.swap(boundaryEdges);
+        for (std::vector<BoundaryLoop>::iterator loopItr = mLoops.begin(); loopItr != mLoops.end(); ++loopItr)
+        {
+            bool isRenumbered = false;
+            for (std::vector<GPP::Int>::iterator vItr = loopItr->mVertexIds.begin(); vItr != loopItr->mVertexIds.end(); ++vItr)
+            {
+                GPP::Int newId = oldToNewIds.at(*vItr);
+                isRenumbered = isRenumbered || newId != *vItr;
+                *vItr = newId;
+            }
+            if (isRenumbered)
+            {
+                // Same shape, but a caller copy of the vertex ids is out of date
+                loopItr->mStamp = mNextLoopStamp++;
+            }
+        }
+        std::set<GPP::Int> dirtyVertexIds;
+        for (std::set<GPP::Int>::iterator itr = mDirtyVertexIds.begin(); itr != mDirtyVertexIds.end(); ++itr)
+        {
+            GPP::Int newId = oldToNewIds.at(*itr);
+            if (newId >= 0)
+            {
+                dirtyVertexIds.insert(newId);
+            }
+        }
+        mDirtyVertexIds.swap(dirtyVertexIds);
+        TraceDirtyVertices();
+        mMeshVersion = meshVersion;
+        mVertexCount = mpTriMesh->GetVertexCount();
+        mTriangleCount = mpTriMesh->GetTriangleCount();
+
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int BoundaryLoopTracker::GetLoopCount() const
+    {
+        return mLoops.size();
+    }
+
+    const std::vector<GPP::Int>& BoundaryLoopTracker::GetLoopVertexIds(GPP::Int loopId) const
+    {
+        return mLoops.at(loopId).mVertexIds;
+    }
+
+    GPP::Real BoundaryLoopTracker::GetLoopPerimeter(GPP::Int loopId) const
+    {
+        return mLoops.at(loopId).mPerimeter;
+    }
+
+    GPP::Real BoundaryLoopTracker::GetLoopArea(GPP::Int loopId) const
+    {
+        return mLoops.at(loopId).mArea;
+    }
+
+    GPP::Int BoundaryLoopTracker::GetLoopStamp(GPP::Int loopId) const
+    {
+        return mLoops.at(loopId).mStamp;
+    }
+
+    void BoundaryLoopTracker::GetLoops(std::vector<std::vector<GPP::Int> >& loops) const
+    {
+        loops.resize(mLoops.size());
+        for (GPP::Int loopId = 0; loopId < GPP::Int(mLoops.size()); loopId++)
+        {
+            loops.at(loopId) = mLoops.at(loopId).mVertexIds;
+        }
+    }
+
+    GPP::Int BoundaryLoopTracker::GetBoundaryEdgeCount() const
+    {
+        return mBoundaryEdges.size();
+    }
+
+    BoundaryLoopTracker::BoundaryEdgeMap::iterator BoundaryLoopTracker::FindBoundaryEdge(GPP::Int fromVertexId, GPP::Int toVertexId)
+    {
+        std::pair<BoundaryEdgeMap::iterator, BoundaryEdgeMap::iterator> range = mBoundaryEdges.equal_range(fromVertexId);
+        for (BoundaryEdgeMap::iterator itr = range.first; itr != range.second; ++itr)
+        {
+            if (itr->second.mToVertexId == toVertexId)
+            {
+                return itr;
+            }
+        }
+        return mBoundaryEdges.end();
+    }
+
+    void BoundaryLoopTracker::InsertBoundaryEdge(GPP::Int fromVertexId, GPP::Int toVertexId)
+    {
+        BoundaryEdge boundaryEdge;
+        boundaryEdge.mToVertexId = toVertexId;
+        boundaryEdge.mLoopId = -1;
+        mBoundaryEdges.insert(std::make_pair(fromVertexId, boundaryEdge));
+        mDirtyVertexIds.insert(fromVertexId);
+    }
+
+    void BoundaryLoopTracker::EraseBoundaryEdge(BoundaryEdgeMap::iterator itr)
+    {
+        if (itr->second.mLoopId >= 0)
+        {
+            mDirtyLoopIds.insert(itr->second.mLoopId);
+        }
+        mBoundaryEdges.erase(itr);
+    }
+
+    void BoundaryLoopTracker::AddTriangle(const GPP::Int vertexIds[3])
+    {
+        for (int fvid = 0; fvid < 3; fvid++)
+        {
+            GPP::Int fromVertexId = vertexIds[fvid];
+            GPP::Int toVertexId = vertexIds[(fvid + 1) % 3];
+            // The opposite boundary half edge becomes an interior edge
+            BoundaryEdgeMap::iterator itr = FindBoundaryEdge(toVertexId, fromVertexId);
+            if (itr != mBoundaryEdges.end())
+            {
+                EraseBoundaryEdge(itr);
+            }
+            else
+            {
+                InsertBoundaryEdge(fromVertexId, toVertexId);
+            }
+        }
+    }
+
+    void BoundaryLoopTracker::RemoveTriangle(const GPP::Int vertexIds[3])
+    {
+        for (int fvid = 0; fvid < 3; fvid++)
+        {
+            GPP::Int fromVertexId = vertexIds[fvid];
+            GPP::Int toVertexId = vertexIds[(fvid + 1) % 3];
+            BoundaryEdgeMap::iterator itr = FindBoundaryEdge(fromVertexId, toVertexId);
+            if (itr != mBoundaryEdges.end())
+            {
+                EraseBoundaryEdge(itr);
+            }
+            else
+            {
+                InsertBoundaryEdge(toVertexId, fromVertexId);
+            }
+        }
+    }
+
+    void BoundaryLoopTracker::SetLoopEdges(GPP::Int loopId, GPP::Int edgeLoopId)
+    {
+        const std::vector<GPP::Int>& vertexIds = mLoops.at(loopId).mVertexIds;
+        GPP::Int loopSize = vertexIds.size();
+        for (GPP::Int lvid = 0; lvid < loopSize; lvid++)
+        {
+            BoundaryEdgeMap::iterator itr = FindBoundaryEdge(vertexIds.at(lvid), vertexIds.at((lvid + 1) % loopSize));
+            if (itr != mBoundaryEdges.end() && itr->second.mLoopId == loopId)
+            {
+                itr->second.mLoopId = edgeLoopId;
+            }
+        }
+    }
+
+    bool BoundaryLoopTracker::SeedLoop(const std::vector<GPP::Int>& vertexIds)
+    {
+        GPP::Int loopSize = vertexIds.size();
+        if (loopSize < 2)
+        {
+            return false;
+        }
+        // FindHoles may list a loop against the triangles, the tracker keeps it with the triangles and the same start vertex
+        BoundaryEdgeMap::iterator firstItr = FindBoundaryEdge(vertexIds.at(0), vertexIds.at(1));
+        bool isForward = firstItr != mBoundaryEdges.end() && firstItr->second.mLoopId < 0;
+        BoundaryLoop loop;
+        loop.mVertexIds.reserve(loopSize);
+        loop.mVertexIds.push_back(vertexIds.at(0));
+        for (GPP::Int lvid = 1; lvid < loopSize; lvid++)
+        {
+            loop.mVertexIds.push_back(isForward ? vertexIds.at(lvid) : vertexIds.at(loopSize - lvid));
+        }
+        GPP::Int loopId = mLoops.size();
+        std::vector<BoundaryEdgeMap::iterator> claimedItrs;
+        claimedItrs.reserve(loopSize);
+        for (GPP::Int lvid = 0; lvid < loopSize; lvid++)
+        {
+            BoundaryEdgeMap::iterator itr = FindBoundaryEdge(loop.mVertexIds.at(lvid), loop.mVertexIds.at((lvid + 1) % loopSize));
+            if (itr == mBoundaryEdges.end() || itr->second.mLoopId >= 0)
+            {
+                for (std::vector<BoundaryEdgeMap::iterator>::iterator claimedItr = claimedItrs.begin(); claimedItr != claimedItrs.end(); ++claimedItr)
+                {
+                    (*claimedItr)->second.mLoopId = -1;
+                }
+                return false;
+            }
+            itr->second.mLoopId = loopId;
+            claimedItrs.push_back(itr);
+        }
+        UpdateLoopMetrics(loop);
+        loop.mStamp = mNextLoopStamp++;
+        mLoops.push_back(loop);
+        return true;
+    }
+
+    void BoundaryLoopTracker::ReleaseDirtyLoops()
+    {
+        // From the largest id, so the last loop moved into a released slot is never a dirty one
+        for (std::set<GPP::Int>::reverse_iterator itr = mDirtyLoopIds.rbegin(); itr != mDirtyLoopIds.rend(); ++itr)
+        {
+            GPP::Int loopId = *itr;
+            SetLoopEdges(loopId, -1);
+            mDirtyVertexIds.insert(mLoops.at(loopId).mVertexIds.begin(), mLoops.at(loopId).mVertexIds.end());
+            GPP::Int lastLoopId = mLoops.size() - 1;
+            if (loopId != lastLoopId)
+            {
+                SetLoopEdges(lastLoopId, loopId);
+                mLoops.at(loopId).mVertexIds.swap(mLoops.at(lastLoopId).mVertexIds);
+                mLoops.at(loopId).mPerimeter = mLoops.at(lastLoopId).mPerimeter;
+                mLoops.at(loopId).mArea = mLoops.at(lastLoopId).mArea;
+                mLoops.at(loopId).mStamp = mLoops.at(lastLoopId).mStamp;
+            }
+            mLoops.pop_back();
+        }
+        mDirtyLoopIds.clear();
+    }
+
+    void BoundaryLoopTracker::TraceDirtyVertices()
+    {
+        for (std::set<GPP::Int>::iterator vItr = mDirtyVertexIds.begin(); vItr != mDirtyVertexIds.end(); ++vItr)
+        {
+            std::pair<BoundaryEdgeMap::iterator, BoundaryEdgeMap::iterator> range = mBoundaryEdges.equal_range(*vItr);
+            for (BoundaryEdgeMap::iterator itr = range.first; itr != range.second; ++itr)
+            {
+                if (itr->second.mLoopId < 0)
+                {
+                    TraceLoop(itr);
+                }
+            }
+        }
+        mDirtyVertexIds.clear();
+    }
+
+    void BoundaryLoopTracker::TraceLoop(BoundaryEdgeMap::iterator startItr)
+    {
+        GPP::Int loopId = mLoops.size();
+        mLoops.push_back(BoundaryLoop());
+        BoundaryLoop& loop = mLoops.back();
+        BoundaryEdgeMap::iterator itr = startItr;
+        while (itr != mBoundaryEdges.end())
+        {
+            itr->second.mLoopId = loopId;
+            loop.mVertexIds.push_back(itr->first);
+            // Next untraced half edge, a non-manifold boundary vertex has more than one
+            std::pair<BoundaryEdgeMap::iterator, BoundaryEdgeMap::iterator> range = mBoundaryEdges.equal_range(itr->second.mToVertexId);
+            itr = mBoundaryEdges.end();
+            for (BoundaryEdgeMap::iterator nextItr = range.first; nextItr != range.second; ++nextItr)
+            {
+                if (nextItr->second.mLoopId < 0)
+                {
+                    itr = nextItr;
+                    break;
+                }
+            }
+        }
+        StartLoopAtSimpleVertex(loop);
+        UpdateLoopMetrics(loop);
+        loop.mStamp = mNextLoopStamp++;
+    }
+
+    void BoundaryLoopTracker::StartLoopAtSimpleVertex(BoundaryLoop& loop) const
+    {
+        // A vertex with one outgoing boundary half edge is on this loop only
+        GPP::Int loopSize = loop.mVertexIds.size();
+        for (GPP::Int lvid = 0; lvid < loopSize; lvid++)
+        {
+            if (mBoundaryEdges.count(loop.mVertexIds.at(lvid)) == 1)
+            {
+                std::rotate(loop.mVertexIds.begin(), loop.mVertexIds.begin() + lvid, loop.mVertexIds.end());
+                return;
+            }
+        }
+    }
+
+    void BoundaryLoopTracker::UpdateLoopMetrics(BoundaryLoop& loop) const
+    {
+        loop.mPerimeter = 0;
+        loop.mArea = 0;
+        GPP::Int loopSize = loop.mVertexIds.size();
+        if (loopSize == 0)
+        {
+            return;
+        }
+        GPP::Vector3 originCoord = mpTriMesh->GetVertexCoord(loop.mVertexIds.at(0));
+        GPP::Vector3 areaVector(0, 0, 0);
+        for (GPP::Int lvid = 0; lvid < loopSize; lvid++)
+        {
+            GPP::Vector3 coord = mpTriMesh->GetVertexCoord(loop.mVertexIds.at(lvid)) - originCoord;
+            GPP::Vector3 nextCoord = mpTriMesh->GetVertexCoord(loop.mVertexIds.at((lvid + 1) % loopSize)) - originCoord;
+            loop.mPerimeter += (nextCoord - coord).Length();
+            areaVector += coord.CrossProduct(nextCoord);
+        }
+        loop.mArea = areaVector.Length() / 2.0;
+    }
+}
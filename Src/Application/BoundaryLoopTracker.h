@@ -0,0 +1,97 @@
+#pragma once
+#include "GPP.h"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace MagicApp
+{
+    class MeshAdjacency;
+
+    // Boundary loops (holes) of a triangle mesh, kept up to date by the edits instead of being searched again.
+    // Boundary half edges are stored in the direction of their triangle, so a loop is a chain of them.
+    // Appending or removing a triangle only toggles its three half edges, and only loops that lose a half edge
+    // are traced again. Every loop keeps its perimeter and area, computed when it is traced, and a stamp that changes only when
+    // it is traced again or renumbered, so a caller can redo the work of the changed loops only.
+    // A loop starts at a vertex on no other loop when it has one, so its first vertex is a valid FillHoles seed.
+    // USAGE: 1. if (!tracker.IsBuiltFrom(triMesh, meshVersion)) tracker.Init(triMesh, adjacency, meshVersion, &findHolesLoops);
+    //        2. tracker.GetLoopCount(), tracker.GetLoopVertexIds(loopId), tracker.GetLoopStamp(loopId)
+    //        3. after FillHoles / BridgeEdges: tracker.AppendTriangles(originTriangleCount, newMeshVersion);
+    //        4. tracker.RemoveVertices(deleteFlags); modelCompactor.CompactTriMesh(...); tracker.RemapVertices(oldToNewIds, newMeshVersion);
+    class BoundaryLoopTracker
+    {
+    public:
+        BoundaryLoopTracker();
+        ~BoundaryLoopTracker();
+
+        // adjacency is built from triMesh. seedLoops: loops of GPP::FillMeshHole::FindHoles, they are kept with their start vertex,
+        // in the direction of the triangles. Boundary edges on no valid seed loop are traced
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh, const MeshAdjacency* adjacency, GPP::Int meshVersion = 0,
+            const std::vector<std::vector<GPP::Int> >* seedLoops = NULL);
+        bool IsBuiltFrom(const GPP::ITriMesh* triMesh, GPP::Int meshVersion = 0) const;
+        void Clear(void);
+
+        // Triangles [fromTriangleId, triangle count) are appended, the other triangles are unchanged
+        GPP::ErrorCode AppendTriangles(GPP::Int fromTriangleId, GPP::Int meshVersion);
+        // Call it before the deletion: triangles with a flagged vertex are removed. Loops are not valid until RemapVertices
+        GPP::ErrorCode RemoveVertices(const std::vector<bool>& deleteFlags);
+        // Call it after the deletion, oldToNewIds is -1 for deleted vertices
+        GPP::ErrorCode RemapVertices(const std::vector<GPP::Int>& oldToNewIds, GPP::Int meshVersion);
+
+        GPP::Int GetLoopCount(void) const;
+        const std::vector<GPP::Int>& GetLoopVertexIds(GPP::Int loopId) const;
+        GPP::Real GetLoopPerimeter(GPP::Int loopId) const;
+        // Area of the loop projected to its best fitting plane
+        GPP::Real GetLoopArea(GPP::Int loopId) const;
+        // Unique among all loops this tracker has traced, kept until the loop is traced again or its vertices are renumbered
+        GPP::Int GetLoopStamp(GPP::Int loopId) const;
+        void GetLoops(std::vector<std::vector<GPP::Int> >& loops) const;
+        GPP::Int GetBoundaryEdgeCount(void) const;
+
+    private:
+        struct BoundaryEdge
+        {
+            GPP::Int mToVertexId;
+            GPP::Int mLoopId;
+        };
+
+        struct BoundaryLoop
+        {
+            std::vector<GPP::Int> mVertexIds;
+            GPP::Real mPerimeter;
+            GPP::Real mArea;
+            GPP::Int mStamp;
+        };
+
+        typedef std::multimap<GPP::Int, BoundaryEdge> BoundaryEdgeMap;
+
+        BoundaryEdgeMap::iterator FindBoundaryEdge(GPP::Int fromVertexId, GPP::Int toVertexId);
+        void InsertBoundaryEdge(GPP::Int fromVertexId, GPP::Int toVertexId);
+        void EraseBoundaryEdge(BoundaryEdgeMap::iterator itr);
+        // Toggle the half edges of a triangle
+        void AddTriangle(const GPP::Int vertexIds[3]);
+        void RemoveTriangle(const GPP::Int vertexIds[3]);
+        void SetLoopEdges(GPP::Int loopId, GPP::Int edgeLoopId);
+        // Claim the untraced half edges of a FindHoles loop in either direction. False and nothing claimed if one is missing
+        bool SeedLoop(const std::vector<GPP::Int>& vertexIds);
+        // Remove the loops that lost a half edge, their vertices become dirty
+        void ReleaseDirtyLoops(void);
+        // Trace new loops from the untraced half edges of the dirty vertices
+        void TraceDirtyVertices(void);
+        void TraceLoop(BoundaryEdgeMap::iterator startItr);
+        void StartLoopAtSimpleVertex(BoundaryLoop& loop) const;
+        void UpdateLoopMetrics(BoundaryLoop& loop) const;
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mMeshVersion;
+        GPP::Int mVertexCount;
+        GPP::Int mTriangleCount;
+        BoundaryEdgeMap mBoundaryEdges;
+        std::vector<BoundaryLoop> mLoops;
+        std::set<GPP::Int> mDirtyLoopIds;
+        std::set<GPP::Int> mDirtyVertexIds;
+        // Not reset by Clear, so stamps of a rebuilt tracker never repeat
+        GPP::Int mNextLoopStamp;
+    };
+}
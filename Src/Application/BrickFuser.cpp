@@ -0,0 +1,540 @@
+#include "BrickFuser.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <math.h>
+
+namespace MagicApp
+{
+    static const GPP::Int DEFAULT_MAX_BRICK_CELL_COUNT = 256;
+    // Splitting below this edge length costs more in margins than it gains in parallelism
+    static const GPP::Int MIN_BRICK_CELL_COUNT = 32;
+    // Margin in intervals: the blend neighborhood radius plus its growth per blend iteration
+    static const GPP::Real BRICK_MARGIN_BASE = 4.0;
+    static const GPP::Real BRICK_MARGIN_PER_ITERATION = 3.0;
+
+    // Read only view of some points of a point cloud, so a brick can be summed without copying its points
+    class BrickPointCloud : public GPP::IPointCloud
+    {
+    public:
+        BrickPointCloud(const GPP::IPointCloud* pointCloud, const std::vector<GPP::Int>* pointIds) :
+            mpPointCloud(pointCloud),
+            mpPointIds(pointIds)
+        {
+        }
+
+        virtual GPP::Int GetPointCount() const
+        {
+            return mpPointIds->size();
+        }
+
+        virtual GPP::Vector3 GetPointCoord(GPP::Int pid) const
+        {
+            return mpPointCloud->GetPointCoord(mpPointIds->at(pid));
+        }
+
+        virtual void SetPointCoord(GPP::Int pid, const GPP::Vector3& coord)
+        {
+        }
+
+        virtual GPP::Vector3 GetPointNormal(GPP::Int pid) const
+        {
+            return mpPointCloud->GetPointNormal(mpPointIds->at(pid));
+        }
+
+        virtual void SetPointNormal(GPP::Int pid, const GPP::Vector3& normal)
+        {
+        }
+
+        virtual bool HasNormal() const
+        {
+            return mpPointCloud->HasNormal();
+        }
+
+        virtual void SetHasNormal(bool has)
+        {
+        }
+
+        virtual GPP::Int InsertPoint(const GPP::Vector3& coord)
+        {
+            return -1;
+        }
+
+        virtual GPP::Int InsertPoint(const GPP::Vector3& coord, const GPP::Vector3& normal)
+        {
+            return -1;
+        }
+
+        virtual void SwapPoint(GPP::Int pointId0, GPP::Int pointId1)
+        {
+        }
+
+        virtual void PopbackPoints(GPP::Int popCount)
+        {
+        }
+
+        virtual void Clear(void)
+        {
+        }
+
+        virtual ~BrickPointCloud()
+        {
+        }
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        const std::vector<GPP::Int>* mpPointIds;
+    };
+
+    class CollectBrickPointTask : public MagicCore::ParallelTask
+    {
+    public:
+        explicit CollectBrickPointTask(BrickFuser* brickFuser) :
+            mpBrickFuser(brickFuser)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int cloudId = startId; cloudId < endId; cloudId++)
+            {
+                mpBrickFuser->BinCloudPoints(cloudId);
+            }
+        }
+
+    private:
+        BrickFuser* mpBrickFuser;
+    };
+
+    class FuseBrickTask : public MagicCore::ParallelTask
+    {
+    public:
+        FuseBrickTask(BrickFuser* brickFuser, GPP::Int fromBrickId) :
+            mpBrickFuser(brickFuser),
+            mFromBrickId(fromBrickId)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int slotId = startId; slotId < endId; slotId++)
+            {
+                mpBrickFuser->FuseBrick(mFromBrickId + slotId, slotId);
+            }
+        }
+
+    private:
+        BrickFuser* mpBrickFuser;
+        GPP::Int mFromBrickId;
+    };
+
+    BrickFuser::BrickFuser(GPP::Real interval, const GPP::Vector3& bboxMin, const GPP::Vector3& bboxMax, bool hasNormalInfo,
+        GPP::Int blendNeighborCount, GPP::Int blendIterationCount) :
+        mInterval(interval),
+        mBBoxMin(bboxMin),
+        mBBoxMax(bboxMax),
+        mHasNormalInfo(hasNormalInfo),
+        mBlendNeighborCount(blendNeighborCount),
+        mBlendIterationCount(blendIterationCount),
+        mFieldDim(0),
+        mPointClouds(),
+        mPointFields(),
+        mMaxBrickCellCount(DEFAULT_MAX_BRICK_CELL_COUNT),
+        mMaxConcurrentBrickCount(MagicCore::ParallelTool::GetThreadCount()),
+        mBrickSize(),
+        mMargin(0),
+        mBrickPointIds(),
+        mBatchResults(),
+        mFuseTime(0)
+    {
+        mBrickResolution[0] = 1;
+        mBrickResolution[1] = 1;
+        mBrickResolution[2] = 1;
+    }
+
+    BrickFuser::~BrickFuser()
+    {
+        for (std::vector<BrickResult>::iterator itr = mBatchResults.begin(); itr != mBatchResults.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->mpPointCloud);
+        }
+    }
+
+    GPP::ErrorCode BrickFuser::AddPointCloud(const GPP::IPointCloud* pointCloud, const std::vector<GPP::Real>* pointFields, GPP::Int fieldDim)
+    {
+        if (pointCloud == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (pointFields == NULL)
+        {
+            fieldDim = 0;
+        }
+        else if (fieldDim <= 0 || pointFields->size() != pointCloud->GetPointCount() * fieldDim)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (!mPointClouds.empty() && fieldDim != mFieldDim)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mFieldDim = fieldDim;
+        mPointClouds.push_back(pointCloud);
+        mPointFields.push_back(pointFields);
+        return GPP_NO_ERROR;
+    }
+
+    void BrickFuser::SetMaxBrickCellCount(GPP::Int maxBrickCellCount)
+    {
+        mMaxBrickCellCount = maxBrickCellCount < MIN_BRICK_CELL_COUNT ? MIN_BRICK_CELL_COUNT : maxBrickCellCount;
+    }
+
+    void BrickFuser::SetMaxConcurrentBrickCount(GPP::Int maxConcurrentBrickCount)
+    {
+        mMaxConcurrentBrickCount = maxConcurrentBrickCount < 1 ? 1 : maxConcurrentBrickCount;
+    }
+
+    GPP::ErrorCode BrickFuser::Fuse(GPP::PointCloud* fusedPointCloud, std::vector<GPP::Real>* pointFields, std::vector<GPP::Int>* cloudIds,
+        std::vector<GPP::Int>* pointIds, double* progress)
+    {
+        if (fusedPointCloud == NULL || mPointClouds.empty() || mInterval <= 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (mBBoxMax[axis] <= mBBoxMin[axis])
+            {
+                return GPP_INVALID_INPUT;
+            }
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        SplitBricks();
+        fusedPointCloud->Clear();
+        fusedPointCloud->SetHasNormal(mHasNormalInfo);
+        if (pointFields)
+        {
+            pointFields->clear();
+        }
+        if (cloudIds)
+        {
+            cloudIds->clear();
+        }
+        if (pointIds)
+        {
+            pointIds->clear();
+        }
+        GPP::Int brickCount = GetBrickCount();
+        GPP::Int cloudCount = mPointClouds.size();
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        // Every cloud is scanned once, each thread writes only the lists of its clouds
+        mBrickPointIds.clear();
+        mBrickPointIds.resize(brickCount, std::vector<std::vector<GPP::Int> >(cloudCount));
+        CollectBrickPointTask collectTask(this);
+        MagicCore::ParallelTool::ParallelFor(cloudCount, &collectTask, 1);
+        for (GPP::Int fromBrickId = 0; fromBrickId < brickCount; fromBrickId += mMaxConcurrentBrickCount)
+        {
+            GPP::Int toBrickId = fromBrickId + mMaxConcurrentBrickCount;
+            if (toBrickId > brickCount)
+            {
+                toBrickId = brickCount;
+            }
+            GPP::Int slotCount = toBrickId - fromBrickId;
+            mBatchResults.clear();
+            mBatchResults.resize(slotCount);
+            for (GPP::Int slotId = 0; slotId < slotCount; slotId++)
+            {
+                mBatchResults.at(slotId).mpPointCloud = NULL;
+                mBatchResults.at(slotId).mResult = GPP_NO_ERROR;
+            }
+            FuseBrickTask fuseTask(this, fromBrickId);
+            MagicCore::ParallelTool::ParallelFor(slotCount, &fuseTask, 1);
+
+            for (GPP::Int slotId = 0; slotId < slotCount; slotId++)
+            {
+                if (mBatchResults.at(slotId).mResult == GPP_API_IS_NOT_AVAILABLE)
+                {
+                    res = GPP_API_IS_NOT_AVAILABLE;
+                    break;
+                }
+                if (mBatchResults.at(slotId).mResult != GPP_NO_ERROR && res == GPP_NO_ERROR)
+                {
+                    res = mBatchResults.at(slotId).mResult;
+                }
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                break;
+            }
+
+            // Merge in brick order, so the result does not depend on the thread timing
+            for (GPP::Int slotId = 0; slotId < slotCount; slotId++)
+            {
+                BrickResult& brickResult = mBatchResults.at(slotId);
+                if (brickResult.mpPointCloud == NULL)
+                {
+                    continue;
+                }
+                GPP::Int brickPointCount = brickResult.mpPointCloud->GetPointCount();
+                bool hasNormal = mHasNormalInfo && brickResult.mpPointCloud->HasNormal();
+                for (GPP::Int pid = 0; pid < brickPointCount; pid++)
+                {
+                    if (hasNormal)
+                    {
+                        fusedPointCloud->InsertPoint(brickResult.mpPointCloud->GetPointCoord(pid), brickResult.mpPointCloud->GetPointNormal(pid));
+                    }
+                    else
+                    {
+                        fusedPointCloud->InsertPoint(brickResult.mpPointCloud->GetPointCoord(pid));
+                    }
+                }
+                if (pointFields)
+                {
+                    pointFields->insert(pointFields->end(), brickResult.mPointFields.begin(), brickResult.mPointFields.end());
+                }
+                if (cloudIds)
+                {
+                    cloudIds->insert(cloudIds->end(), brickResult.mCloudIds.begin(), brickResult.mCloudIds.end());
+                }
+                if (pointIds)
+                {
+                    pointIds->insert(pointIds->end(), brickResult.mPointIds.begin(), brickResult.mPointIds.end());
+                }
+                GPPFREEPOINTER(brickResult.mpPointCloud);
+            }
+            mBatchResults.clear();
+            if (progress)
+            {
+                *progress = double(toBrickId) / double(brickCount);
+            }
+        }
+        for (std::vector<BrickResult>::iterator itr = mBatchResults.begin(); itr != mBatchResults.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->mpPointCloud);
+        }
+        mBatchResults.clear();
+        mBrickPointIds.clear();
+        mFuseTime = MagicCore::ToolKit::GetTime() - startTime;
+        if (res != GPP_NO_ERROR)
+        {
+            fusedPointCloud->Clear();
+            if (pointFields)
+            {
+                pointFields->clear();
+            }
+            if (cloudIds)
+            {
+                cloudIds->clear();
+            }
+            if (pointIds)
+            {
+                pointIds->clear();
+            }
+        }
+        return res;
+    }
+
+    GPP::Int BrickFuser::GetBrickCount(void) const
+    {
+        return mBrickResolution[0] * mBrickResolution[1] * mBrickResolution[2];
+    }
+
+    double BrickFuser::GetFuseTime(void) const
+    {
+        return mFuseTime;
+    }
+
+    void BrickFuser::SplitBricks(void)
+    {
+        GPP::Vector3 extent = mBBoxMax - mBBoxMin;
+        GPP::Real maxBrickLength = mInterval * mMaxBrickCellCount;
+        GPP::Real minBrickLength = mInterval * MIN_BRICK_CELL_COUNT;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mBrickResolution[axis] = int(ceil(extent[axis] / maxBrickLength));
+            if (mBrickResolution[axis] < 1)
+            {
+                mBrickResolution[axis] = 1;
+            }
+        }
+        // Split the longest brick edge until every thread has a brick
+        GPP::Int threadCount = MagicCore::ParallelTool::GetThreadCount();
+        while (GetBrickCount() < threadCount)
+        {
+            int splitAxis = -1;
+            GPP::Real maxLength = 0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                GPP::Real brickLength = extent[axis] / (mBrickResolution[axis] + 1);
+                if (brickLength >= minBrickLength && brickLength > maxLength)
+                {
+                    maxLength = brickLength;
+                    splitAxis = axis;
+                }
+            }
+            if (splitAxis < 0)
+            {
+                break;
+            }
+            mBrickResolution[splitAxis]++;
+        }
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mBrickSize[axis] = extent[axis] / mBrickResolution[axis];
+        }
+        mMargin = mInterval * (BRICK_MARGIN_BASE + BRICK_MARGIN_PER_ITERATION * mBlendIterationCount);
+    }
+
+    void BrickFuser::GetBrickIndex(GPP::Int brickId, GPP::Int brickIndex[3]) const
+    {
+        brickIndex[0] = brickId % mBrickResolution[0];
+        brickIndex[1] = (brickId / mBrickResolution[0]) % mBrickResolution[1];
+        brickIndex[2] = brickId / (mBrickResolution[0] * mBrickResolution[1]);
+    }
+
+    GPP::Int BrickFuser::GetCoreBrickId(const GPP::Vector3& coord) const
+    {
+        // Outer bricks own everything beyond the bounding box
+        GPP::Int brickIndex[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Int index = GPP::Int(floor((coord[axis] - mBBoxMin[axis]) / mBrickSize[axis]));
+            if (index < 0)
+            {
+                index = 0;
+            }
+            else if (index >= mBrickResolution[axis])
+            {
+                index = mBrickResolution[axis] - 1;
+            }
+            brickIndex[axis] = index;
+        }
+        return brickIndex[0] + mBrickResolution[0] * (brickIndex[1] + mBrickResolution[1] * brickIndex[2]);
+    }
+
+    void BrickFuser::BinCloudPoints(GPP::Int cloudId)
+    {
+        const GPP::IPointCloud* pointCloud = mPointClouds.at(cloudId);
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        GPP::Int resolutionXY = mBrickResolution[0] * mBrickResolution[1];
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Vector3 coord = pointCloud->GetPointCoord(pid);
+            // Range of bricks whose margin box contains the point
+            GPP::Int indexMin[3], indexMax[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                GPP::Real localCoord = coord[axis] - mBBoxMin[axis];
+                indexMin[axis] = GPP::Int(floor((localCoord - mMargin) / mBrickSize[axis]));
+                indexMax[axis] = GPP::Int(floor((localCoord + mMargin) / mBrickSize[axis]));
+                if (indexMin[axis] < 0)
+                {
+                    indexMin[axis] = 0;
+                }
+                if (indexMax[axis] >= mBrickResolution[axis])
+                {
+                    indexMax[axis] = mBrickResolution[axis] - 1;
+                }
+            }
+            for (GPP::Int zid = indexMin[2]; zid <= indexMax[2]; zid++)
+            {
+                for (GPP::Int yid = indexMin[1]; yid <= indexMax[1]; yid++)
+                {
+                    for (GPP::Int xid = indexMin[0]; xid <= indexMax[0]; xid++)
+                    {
+                        mBrickPointIds.at(xid + mBrickResolution[0] * yid + resolutionXY * zid).at(cloudId).push_back(pid);
+                    }
+                }
+            }
+        }
+    }
+
+    void BrickFuser::FuseBrick(GPP::Int brickId, GPP::Int slotId)
+    {
+        BrickResult& brickResult = mBatchResults.at(slotId);
+        std::vector<std::vector<GPP::Int> >& brickPointIds = mBrickPointIds.at(brickId);
+        GPP::Int brickIndex[3];
+        GetBrickIndex(brickId, brickIndex);
+        GPP::Vector3 brickMin, brickMax;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            brickMin[axis] = mBBoxMin[axis] + mBrickSize[axis] * brickIndex[axis] - mMargin;
+            brickMax[axis] = mBBoxMin[axis] + mBrickSize[axis] * (brickIndex[axis] + 1) + mMargin;
+        }
+        // The source point id is appended as the last field, so it comes back with every fused point.
+        // Every thread owns its SumPointCloud, only the point clouds and fields are shared, read only
+        GPP::Int sumFieldDim = mFieldDim + 1;
+        GPP::SumPointCloud sumPointCloud(mInterval, brickMin, brickMax, mHasNormalInfo, mBlendNeighborCount, mBlendIterationCount);
+        std::vector<GPP::Int> sumCloudIds;
+        GPP::Int cloudCount = brickPointIds.size();
+        for (GPP::Int cloudId = 0; cloudId < cloudCount; cloudId++)
+        {
+            const std::vector<GPP::Int>& pointIds = brickPointIds.at(cloudId);
+            if (pointIds.empty())
+            {
+                continue;
+            }
+            GPP::Int pointCount = pointIds.size();
+            std::vector<GPP::Real> sumFields(pointCount * sumFieldDim);
+            const std::vector<GPP::Real>* pointFields = mPointFields.at(cloudId);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                GPP::Int sourceId = pointIds.at(pid);
+                GPP::Int baseId = pid * sumFieldDim;
+                for (GPP::Int fid = 0; fid < mFieldDim; fid++)
+                {
+                    sumFields.at(baseId + fid) = pointFields->at(sourceId * mFieldDim + fid);
+                }
+                sumFields.at(baseId + mFieldDim) = sourceId;
+            }
+            BrickPointCloud brickPointCloud(mPointClouds.at(cloudId), &pointIds);
+            GPP::ErrorCode res = sumPointCloud.UpdateSumFunction(&brickPointCloud, NULL, &sumFields);
+            if (res != GPP_NO_ERROR)
+            {
+                brickResult.mResult = res;
+                return;
+            }
+            sumCloudIds.push_back(cloudId);
+        }
+        brickPointIds.clear();
+        if (sumCloudIds.empty())
+        {
+            return;
+        }
+
+        GPP::PointCloud extractPointCloud;
+        std::vector<GPP::Real> extractFields;
+        std::vector<GPP::Int> extractCloudIds;
+        GPP::ErrorCode res = sumPointCloud.ExtractPointCloud(&extractPointCloud, &extractFields, &extractCloudIds);
+        if (res != GPP_NO_ERROR)
+        {
+            brickResult.mResult = res;
+            return;
+        }
+        sumPointCloud.Clear();
+        GPP::Int extractPointCount = extractPointCloud.GetPointCount();
+        bool hasNormal = mHasNormalInfo && extractPointCloud.HasNormal();
+        brickResult.mpPointCloud = new GPP::PointCloud;
+        brickResult.mpPointCloud->SetHasNormal(hasNormal);
+        for (GPP::Int pid = 0; pid < extractPointCount; pid++)
+        {
+            GPP::Vector3 coord = extractPointCloud.GetPointCoord(pid);
+            if (GetCoreBrickId(coord) != brickId)
+            {
+                continue;
+            }
+            if (hasNormal)
+            {
+                brickResult.mpPointCloud->InsertPoint(coord, extractPointCloud.GetPointNormal(pid));
+            }
+            else
+            {
+                brickResult.mpPointCloud->InsertPoint(coord);
+            }
+            GPP::Int baseId = pid * sumFieldDim;
+            brickResult.mPointFields.insert(brickResult.mPointFields.end(), extractFields.begin() + baseId,
+                extractFields.begin() + baseId + mFieldDim);
+            brickResult.mCloudIds.push_back(sumCloudIds.at(extractCloudIds.at(pid)));
+            brickResult.mPointIds.push_back(GPP::Int(extractFields.at(baseId + mFieldDim)));
+        }
+    }
+}
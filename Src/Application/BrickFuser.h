@@ -0,0 +1,83 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Fuses a point cloud list with one GPP::SumPointCloud per spatial brick instead of one for the whole bounding box.
+    // The bounding box is split into a grid of bricks, every brick sums only the points inside it plus an overlap margin,
+    // and bricks are fused concurrently in batches, so peak memory depends on the brick size and not on the scene size.
+    // A fused point is kept only by the brick whose core (the brick without margin) contains it, which removes the seam duplicates.
+    // The margin is wider than the blend neighborhood, so points near a seam are blended with the same neighbors as in a single sum.
+    // Points are binned to bricks once, as point ids, before the first batch.
+    // Concurrent bricks run separate GPP::SumPointCloud instances at the same time, which assumes that SumPointCloud keeps all of its
+    // state in the instance. SetMaxConcurrentBrickCount(1) runs one instance at a time if that does not hold.
+    // USAGE: 1. BrickFuser brickFuser(interval, bboxMin, bboxMax, hasNormalInfo, 25, 2);
+    //        2. brickFuser.AddPointCloud(pointCloud, &pointFields, fieldDim); ...
+    //        3. brickFuser.Fuse(fusedPointCloud, &fusedFields, &cloudIds, &pointIds);
+    class BrickFuser
+    {
+    public:
+        BrickFuser(GPP::Real interval, const GPP::Vector3& bboxMin, const GPP::Vector3& bboxMax, bool hasNormalInfo,
+            GPP::Int blendNeighborCount = 25, GPP::Int blendIterationCount = 2);
+        ~BrickFuser();
+
+        // pointCloud is not copied and should be valid until Fuse returns.
+        // pointFields has fieldDim values per point, it can be NULL. Every point cloud should have the same fieldDim
+        GPP::ErrorCode AddPointCloud(const GPP::IPointCloud* pointCloud, const std::vector<GPP::Real>* pointFields, GPP::Int fieldDim);
+        // maxBrickCellCount: max brick edge length in intervals. Bricks are split further until there is one brick per thread
+        void SetMaxBrickCellCount(GPP::Int maxBrickCellCount);
+        // Bricks fused at the same time, which bounds the peak memory. Default is the thread count, 1 fuses bricks one by one
+        void SetMaxConcurrentBrickCount(GPP::Int maxConcurrentBrickCount);
+
+        // fusedPointCloud should be blank. pointFields, cloudIds and pointIds can be NULL:
+        // cloudIds are the AddPointCloud order of the source point clouds, pointIds the point ids in them.
+        // progress (can be NULL) is set to the fused brick ratio after every batch
+        GPP::ErrorCode Fuse(GPP::PointCloud* fusedPointCloud, std::vector<GPP::Real>* pointFields, std::vector<GPP::Int>* cloudIds,
+            std::vector<GPP::Int>* pointIds, double* progress = NULL);
+
+        GPP::Int GetBrickCount(void) const;
+        double GetFuseTime(void) const;
+
+    private:
+        struct BrickResult
+        {
+            GPP::PointCloud* mpPointCloud;
+            std::vector<GPP::Real> mPointFields;
+            std::vector<GPP::Int> mCloudIds;
+            std::vector<GPP::Int> mPointIds;
+            GPP::ErrorCode mResult;
+        };
+
+        BrickFuser(const BrickFuser&);
+        BrickFuser& operator = (const BrickFuser&);
+        void SplitBricks(void);
+        void GetBrickIndex(GPP::Int brickId, GPP::Int brickIndex[3]) const;
+        GPP::Int GetCoreBrickId(const GPP::Vector3& coord) const;
+        // Add every point of the cloud to the bricks whose margin box contains it
+        void BinCloudPoints(GPP::Int cloudId);
+        void FuseBrick(GPP::Int brickId, GPP::Int slotId);
+        friend class CollectBrickPointTask;
+        friend class FuseBrickTask;
+
+    private:
+        GPP::Real mInterval;
+        GPP::Vector3 mBBoxMin;
+        GPP::Vector3 mBBoxMax;
+        bool mHasNormalInfo;
+        GPP::Int mBlendNeighborCount;
+        GPP::Int mBlendIterationCount;
+        GPP::Int mFieldDim;
+        std::vector<const GPP::IPointCloud*> mPointClouds;
+        std::vector<const std::vector<GPP::Real>*> mPointFields;
+        GPP::Int mMaxBrickCellCount;
+        GPP::Int mMaxConcurrentBrickCount;
+        GPP::Int mBrickResolution[3];
+        GPP::Vector3 mBrickSize;
+        GPP::Real mMargin;
+        // [brick][cloud]: point ids of every brick, freed once the brick is fused
+        std::vector<std::vector<std::vector<GPP::Int> > > mBrickPointIds;
+        std::vector<BrickResult> mBatchResults;
+        double mFuseTime;
+    };
+}
@@ -0,0 +1,469 @@
+#include "ChartUnfolder.h"
+#include "AtlasPacker.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <algorithm>
+#include <math.h>
+
+namespace MagicApp
+{
+    static GPP::Int FindRoot(std::vector<GPP::Int>& parents, GPP::Int vid)
+    {
+        while (parents.at(vid) != vid)
+        {
+            parents.at(vid) = parents.at(parents.at(vid));
+            vid = parents.at(vid);
+        }
+        return vid;
+    }
+
+    class ChartSizeGreater
+    {
+    public:
+        explicit ChartSizeGreater(const std::vector<std::vector<GPP::Int> >* chartTriangleIds) :
+            mpChartTriangleIds(chartTriangleIds)
+        {
+        }
+
+        bool operator()(GPP::Int chartId0, GPP::Int chartId1) const
+        {
+            return mpChartTriangleIds->at(chartId0).size() > mpChartTriangleIds->at(chartId1).size();
+        }
+
+    private:
+        const std::vector<std::vector<GPP::Int> >* mpChartTriangleIds;
+    };
+
+    class UnfoldChartTask : public MagicCore::ParallelTask
+    {
+    public:
+        UnfoldChartTask(ChartUnfolder* chartUnfolder, GPP::Int isometricIterationCount) :
+            mpChartUnfolder(chartUnfolder),
+            mIsometricIterationCount(isometricIterationCount)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int chartId = startId; chartId < endId; chartId++)
+            {
+                mpChartUnfolder->UnfoldChart(chartId, mIsometricIterationCount);
+            }
+        }
+
+    private:
+        ChartUnfolder* mpChartUnfolder;
+        GPP::Int mIsometricIterationCount;
+    };
+
+    ChartUnfolder::ChartUnfolder() :
+        mpTriMesh(NULL),
+        mChartTriangleIds(),
+        mChartMeshes(),
+        mChartTexCoords(),
+        mChartInfos(),
+        mTexCoords(),
+        mFaceTexIds(),
+        mUnfoldTime(0),
+        mPackTime(0)
+    {
+    }
+
+    ChartUnfolder::~ChartUnfolder()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode ChartUnfolder::Unfold(GPP::ITriMesh* triMesh, GPP::Int isometricIterationCount, AtlasPacker* atlasPacker)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetTriangleCount() == 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mpTriMesh = triMesh;
+        double startTime = MagicCore::ToolKit::GetTime();
+        SplitCharts();
+        if (!BuildChartMeshes())
+        {
+            Clear();
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int chartCount = mChartMeshes.size();
+        mChartTexCoords.resize(chartCount);
+        mChartInfos.resize(chartCount);
+        // Charts are sorted by size, so the big ones start first and the small ones fill the gaps
+        UnfoldChartTask unfoldTask(this, isometricIterationCount);
+        MagicCore::ParallelTool::ParallelFor(chartCount, &unfoldTask, 1);
+        mUnfoldTime = MagicCore::ToolKit::GetTime() - startTime;
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            if (mChartInfos.at(chartId).mResult == GPP_API_IS_NOT_AVAILABLE)
+            {
+                return GPP_API_IS_NOT_AVAILABLE;
+            }
+        }
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            if (mChartInfos.at(chartId).mResult != GPP_NO_ERROR)
+            {
+                return mChartInfos.at(chartId).mResult;
+            }
+        }
+
+        startTime = MagicCore::ToolKit::GetTime();
+        std::vector<GPP::ITriMesh*> chartMeshes(mChartMeshes.begin(), mChartMeshes.end());
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        if (atlasPacker != NULL)
+        {
+            res = atlasPacker->Pack(chartMeshes, mChartTexCoords);
+        }
+        else
+        {
+            res = GPP::UnfoldMesh::PackUVAtlas(chartMeshes, mChartTexCoords);
+        }
+        mPackTime = MagicCore::ToolKit::GetTime() - startTime;
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+
+        GPP::Int texVertexCount = 0;
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            if (mChartTexCoords.at(chartId).size() != mChartMeshes.at(chartId)->GetVertexCount() * 2)
+            {
+                return GPP_INVALID_RESULT;
+            }
+            texVertexCount += mChartMeshes.at(chartId)->GetVertexCount();
+        }
+        mTexCoords.reserve(texVertexCount * 2);
+        mFaceTexIds.resize(mpTriMesh->GetTriangleCount() * 3);
+        GPP::Int texIdOffset = 0;
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            const std::vector<GPP::Real>& chartTexCoords = mChartTexCoords.at(chartId);
+            mTexCoords.insert(mTexCoords.end(), chartTexCoords.begin(), chartTexCoords.end());
+            const GPP::SubTriMesh* chartMesh = mChartMeshes.at(chartId);
+            const std::vector<GPP::Int>& triangleIds = mChartTriangleIds.at(chartId);
+            GPP::Int chartTriangleCount = triangleIds.size();
+            for (GPP::Int localFid = 0; localFid < chartTriangleCount; localFid++)
+            {
+                chartMesh->GetTriangleVertexIds(localFid, vertexIds);
+                GPP::Int fid = triangleIds.at(localFid);
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    mFaceTexIds.at(fid * 3 + localId) = vertexIds[localId] + texIdOffset;
+                }
+            }
+            texIdOffset += chartMesh->GetVertexCount();
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void ChartUnfolder::Clear()
+    {
+        for (std::vector<GPP::SubTriMesh*>::iterator itr = mChartMeshes.begin(); itr != mChartMeshes.end(); ++itr)
+        {
+            GPPFREEPOINTER(*itr);
+        }
+        mChartMeshes.clear();
+        mpTriMesh = NULL;
+        mChartTriangleIds.clear();
+        mChartTexCoords.clear();
+        mChartInfos.clear();
+        mTexCoords.clear();
+        mFaceTexIds.clear();
+        mUnfoldTime = 0;
+        mPackTime = 0;
+    }
+
+    const std::vector<GPP::Real>& ChartUnfolder::GetTexCoords() const
+    {
+        return mTexCoords;
+    }
+
+    const std::vector<GPP::Int>& ChartUnfolder::GetFaceTexIds() const
+    {
+        return mFaceTexIds;
+    }
+
+    const std::vector<ChartUnfolder::ChartInfo>& ChartUnfolder::GetChartInfos() const
+    {
+        return mChartInfos;
+    }
+
+    GPP::Int ChartUnfolder::GetChartCount() const
+    {
+        return mChartInfos.size();
+    }
+
+    GPP::Int ChartUnfolder::GetFlipCount() const
+    {
+        GPP::Int flipCount = 0;
+        for (std::vector<ChartInfo>::const_iterator itr = mChartInfos.begin(); itr != mChartInfos.end(); ++itr)
+        {
+            flipCount += itr->mFlipCount;
+        }
+        return flipCount;
+    }
+
+    double ChartUnfolder::GetUnfoldTime() const
+    {
+        return mUnfoldTime;
+    }
+
+    double ChartUnfolder::GetPackTime() const
+    {
+        return mPackTime;
+    }
+
+    void ChartUnfolder::SplitCharts()
+    {
+        // A split mesh has separate vertices on both sides of a cut, so charts are the vertex connected triangle regions
+        GPP::Int vertexCount = mpTriMesh->GetVertexCount();
+        GPP::Int triangleCount = mpTriMesh->GetTriangleCount();
+        std::vector<GPP::Int> parents(vertexCount);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            parents.at(vid) = vid;
+        }
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Int root0 = FindRoot(parents, vertexIds[0]);
+            for (int localId = 1; localId < 3; localId++)
+            {
+                GPP::Int root = FindRoot(parents, vertexIds[localId]);
+                if (root != root0)
+                {
+                    parents.at(root) = root0;
+                }
+            }
+        }
+        std::vector<GPP::Int> rootChartIds(vertexCount, -1);
+        std::vector<std::vector<GPP::Int> > chartTriangleIds;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Int root = FindRoot(parents, vertexIds[0]);
+            if (rootChartIds.at(root) == -1)
+            {
+                rootChartIds.at(root) = chartTriangleIds.size();
+                chartTriangleIds.push_back(std::vector<GPP::Int>());
+            }
+            chartTriangleIds.at(rootChartIds.at(root)).push_back(fid);
+        }
+        GPP::Int chartCount = chartTriangleIds.size();
+        std::vector<GPP::Int> chartOrder(chartCount);
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            chartOrder.at(chartId) = chartId;
+        }
+        std::stable_sort(chartOrder.begin(), chartOrder.end(), ChartSizeGreater(&chartTriangleIds));
+        mChartTriangleIds.resize(chartCount);
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            mChartTriangleIds.at(chartId).swap(chartTriangleIds.at(chartOrder.at(chartId)));
+        }
+    }
+
+    bool ChartUnfolder::BuildChartMeshes()
+    {
+        GPP::Int chartCount = mChartTriangleIds.size();
+        mChartMeshes.resize(chartCount, NULL);
+        GPP::Int vertexIds[3] = {-1};
+        GPP::Int subVertexIds[3] = {-1};
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            const std::vector<GPP::Int>& triangleIds = mChartTriangleIds.at(chartId);
+            GPP::SubTriMesh* chartMesh = new GPP::SubTriMesh(mpTriMesh, triangleIds, GPP::SubTriMesh::BUILD_SUBTRIMESH_TYPE_BY_TRIANGLES);
+            mChartMeshes.at(chartId) = chartMesh;
+            GPP::Int chartTriangleCount = triangleIds.size();
+            if (chartMesh->GetTriangleCount() != chartTriangleCount)
+            {
+                return false;
+            }
+            // Face tex ids are written back by local triangle id, so the view must keep the input triangle order
+            for (GPP::Int localFid = 0; localFid < chartTriangleCount; localFid++)
+            {
+                mpTriMesh->GetTriangleVertexIds(triangleIds.at(localFid), vertexIds);
+                chartMesh->GetTriangleVertexIds(localFid, subVertexIds);
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    if (!(mpTriMesh->GetVertexCoord(vertexIds[localId]) == chartMesh->GetVertexCoord(subVertexIds[localId])))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    void ChartUnfolder::UnfoldChart(GPP::Int chartId, GPP::Int isometricIterationCount)
+    {
+        double startTime = MagicCore::ToolKit::GetTime();
+        GPP::SubTriMesh* chartMesh = mChartMeshes.at(chartId);
+        ChartInfo& chartInfo = mChartInfos.at(chartId);
+        chartInfo.mTriangleCount = chartMesh->GetTriangleCount();
+        chartInfo.mVertexCount = chartMesh->GetVertexCount();
+        chartInfo.mTime = 0;
+        chartInfo.mAngleDistortion = 0;
+        chartInfo.mAreaDistortion = 0;
+        chartInfo.mFlipCount = 0;
+        std::vector<GPP::Real>& texCoords = mChartTexCoords.at(chartId);
+
+        std::vector<std::vector<GPP::Int> > holeIds;
+        chartInfo.mResult = GPP::FillMeshHole::FindHoles(chartMesh, &holeIds);
+        if (chartInfo.mResult != GPP_NO_ERROR)
+        {
+            return;
+        }
+        GPP::Int longestHoleId = -1;
+        GPP::Int longestHoleSize = 0;
+        GPP::Int holeCount = holeIds.size();
+        for (GPP::Int hid = 0; hid < holeCount; hid++)
+        {
+            if (holeIds.at(hid).size() > longestHoleSize)
+            {
+                longestHoleSize = holeIds.at(hid).size();
+                longestHoleId = hid;
+            }
+        }
+        if (longestHoleSize < 3)
+        {
+            // A closed chart has to be cut before it can be unfolded
+            chartInfo.mResult = GPP_INVALID_INPUT;
+            return;
+        }
+        std::vector<GPP::Int> fixedVertexIndices(2);
+        std::vector<GPP::Real> fixedVertexCoords(4);
+        fixedVertexIndices.at(0) = holeIds.at(longestHoleId).at(0);
+        fixedVertexIndices.at(1) = holeIds.at(longestHoleId).at(longestHoleSize / 2);
+        fixedVertexCoords.at(0) = -1.0;
+        fixedVertexCoords.at(1) = -1.0;
+        fixedVertexCoords.at(2) = 1.0;
+        fixedVertexCoords.at(3) = 1.0;
+        chartInfo.mResult = GPP::UnfoldMesh::ConformalMap(chartMesh, &fixedVertexIndices, &fixedVertexCoords, &texCoords);
+        if (chartInfo.mResult == GPP_NO_ERROR && isometricIterationCount > 0)
+        {
+            chartInfo.mResult = GPP::UnfoldMesh::OptimizeIsometric(chartMesh, &texCoords, isometricIterationCount, NULL);
+        }
+        if (chartInfo.mResult == GPP_NO_ERROR)
+        {
+            OrientChart(chartId);
+            MeasureChart(chartId);
+        }
+        chartInfo.mTime = MagicCore::ToolKit::GetTime() - startTime;
+    }
+
+    void ChartUnfolder::OrientChart(GPP::Int chartId)
+    {
+        const GPP::SubTriMesh* chartMesh = mChartMeshes.at(chartId);
+        std::vector<GPP::Real>& texCoords = mChartTexCoords.at(chartId);
+        GPP::Int triangleCount = chartMesh->GetTriangleCount();
+        GPP::Int vertexIds[3] = {-1};
+        // A conformal map can come out mirrored as a whole, which is a valid chart once mirrored back
+        GPP::Real signedTexArea = 0;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            chartMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Real u1 = texCoords.at(vertexIds[1] * 2) - texCoords.at(vertexIds[0] * 2);
+            GPP::Real v1 = texCoords.at(vertexIds[1] * 2 + 1) - texCoords.at(vertexIds[0] * 2 + 1);
+            GPP::Real u2 = texCoords.at(vertexIds[2] * 2) - texCoords.at(vertexIds[0] * 2);
+            GPP::Real v2 = texCoords.at(vertexIds[2] * 2 + 1) - texCoords.at(vertexIds[0] * 2 + 1);
+            signedTexArea += u1 * v2 - v1 * u2;
+        }
+        if (signedTexArea < 0)
+        {
+            GPP::Int texVertexCount = texCoords.size() / 2;
+            for (GPP::Int vid = 0; vid < texVertexCount; vid++)
+            {
+                texCoords.at(vid * 2) = -texCoords.at(vid * 2);
+            }
+        }
+    }
+
+    void ChartUnfolder::MeasureChart(GPP::Int chartId)
+    {
+        const GPP::SubTriMesh* chartMesh = mChartMeshes.at(chartId);
+        const std::vector<GPP::Real>& texCoords = mChartTexCoords.at(chartId);
+        ChartInfo& chartInfo = mChartInfos.at(chartId);
+        GPP::Int triangleCount = chartMesh->GetTriangleCount();
+        GPP::Int vertexIds[3] = {-1};
+        // The unfolded chart has an arbitrary scale, normalize it by the total area ratio first
+        GPP::Real meshArea = 0;
+        GPP::Real texArea = 0;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            chartMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Vector3 coord0 = chartMesh->GetVertexCoord(vertexIds[0]);
+            meshArea += (chartMesh->GetVertexCoord(vertexIds[1]) - coord0).CrossProduct(chartMesh->GetVertexCoord(vertexIds[2]) - coord0).Length() / 2.0;
+            GPP::Real u1 = texCoords.at(vertexIds[1] * 2) - texCoords.at(vertexIds[0] * 2);
+            GPP::Real v1 = texCoords.at(vertexIds[1] * 2 + 1) - texCoords.at(vertexIds[0] * 2 + 1);
+            GPP::Real u2 = texCoords.at(vertexIds[2] * 2) - texCoords.at(vertexIds[0] * 2);
+            GPP::Real v2 = texCoords.at(vertexIds[2] * 2 + 1) - texCoords.at(vertexIds[0] * 2 + 1);
+            texArea += fabs(u1 * v2 - v1 * u2) / 2.0;
+        }
+        if (meshArea < GPP::REAL_TOL || texArea < GPP::REAL_TOL)
+        {
+            return;
+        }
+        GPP::Real texScale = sqrt(meshArea / texArea);
+        GPP::Real weightSum = 0;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            chartMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Vector3 coord0 = chartMesh->GetVertexCoord(vertexIds[0]);
+            GPP::Vector3 edge1 = chartMesh->GetVertexCoord(vertexIds[1]) - coord0;
+            GPP::Vector3 edge2 = chartMesh->GetVertexCoord(vertexIds[2]) - coord0;
+            GPP::Real u1 = (texCoords.at(vertexIds[1] * 2) - texCoords.at(vertexIds[0] * 2)) * texScale;
+            GPP::Real v1 = (texCoords.at(vertexIds[1] * 2 + 1) - texCoords.at(vertexIds[0] * 2 + 1)) * texScale;
+            GPP::Real u2 = (texCoords.at(vertexIds[2] * 2) - texCoords.at(vertexIds[0] * 2)) * texScale;
+            GPP::Real v2 = (texCoords.at(vertexIds[2] * 2 + 1) - texCoords.at(vertexIds[0] * 2 + 1)) * texScale;
+            if (u1 * v2 - v1 * u2 <= 0)
+            {
+                chartInfo.mFlipCount++;
+                continue;
+            }
+            // Triangle in its own plane: (0, 0), (x1, 0), (x2, y2)
+            GPP::Real x1 = edge1.Length();
+            if (x1 < GPP::REAL_TOL)
+            {
+                continue;
+            }
+            GPP::Real x2 = (edge1 * edge2) / x1;
+            GPP::Real y2 = edge1.CrossProduct(edge2).Length() / x1;
+            if (y2 < GPP::REAL_TOL)
+            {
+                continue;
+            }
+            // Jacobian [a b; c d] from the plane to the texture, and its singular values
+            GPP::Real a = u1 / x1;
+            GPP::Real c = v1 / x1;
+            GPP::Real b = (u2 - a * x2) / y2;
+            GPP::Real d = (v2 - c * x2) / y2;
+            GPP::Real q = sqrt((a + d) * (a + d) + (c - b) * (c - b)) / 2.0;
+            GPP::Real r = sqrt((a - d) * (a - d) + (c + b) * (c + b)) / 2.0;
+            GPP::Real sigmaMax = q + r;
+            GPP::Real sigmaMin = q - r;
+            if (sigmaMin < GPP::REAL_TOL)
+            {
+                continue;
+            }
+            GPP::Real weight = x1 * y2 / 2.0;
+            GPP::Real areaRatio = sigmaMax * sigmaMin;
+            chartInfo.mAngleDistortion += weight * sigmaMax / sigmaMin;
+            chartInfo.mAreaDistortion += weight * (areaRatio > 1.0 ? areaRatio : 1.0 / areaRatio);
+            weightSum += weight;
+        }
+        if (weightSum > GPP::REAL_TOL)
+        {
+            chartInfo.mAngleDistortion /= weightSum;
+            chartInfo.mAreaDistortion /= weightSum;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    class AtlasPacker;
+
+    // Unfolds every connected region of a split mesh as an independent chart and packs them into one atlas.
+    // Charts are SubTriMesh views of the mesh. ConformalMap and OptimizeIsometric run on them concurrently, largest chart first,
+    // and the result has the same layout as GPP::UnfoldMesh::GenerateUVAtlas. Charts are packed by AtlasPacker if one is given, else by PackUVAtlas.
+    // USAGE: 1. chartUnfolder.Unfold(splitTriMesh, 10, &atlasPacker);
+    //        2. chartUnfolder.GetTexCoords(); chartUnfolder.GetFaceTexIds(); chartUnfolder.GetChartInfos();
+    class ChartUnfolder
+    {
+    public:
+        struct ChartInfo
+        {
+            GPP::Int mTriangleCount;
+            GPP::Int mVertexCount;
+            double mTime;
+            // Area weighted mean of max(s1 / s2, s2 / s1) and max(s1 * s2, 1 / (s1 * s2)), 1 is no distortion
+            GPP::Real mAngleDistortion;
+            GPP::Real mAreaDistortion;
+            // Triangles against the majority orientation of the chart
+            GPP::Int mFlipCount;
+            GPP::ErrorCode mResult;
+        };
+
+        ChartUnfolder();
+        ~ChartUnfolder();
+
+        // Every connected region of triMesh should be a disk. triMesh is not modified
+        GPP::ErrorCode Unfold(GPP::ITriMesh* triMesh, GPP::Int isometricIterationCount, AtlasPacker* atlasPacker = NULL);
+        void Clear(void);
+
+        // Same as GenerateUVAtlas: 2 values per texture vertex, 3 texture vertex ids per triangle
+        const std::vector<GPP::Real>& GetTexCoords(void) const;
+        const std::vector<GPP::Int>& GetFaceTexIds(void) const;
+        const std::vector<ChartInfo>& GetChartInfos(void) const;
+        GPP::Int GetChartCount(void) const;
+        GPP::Int GetFlipCount(void) const;
+        double GetUnfoldTime(void) const;
+        double GetPackTime(void) const;
+
+    private:
+        void SplitCharts(void);
+        bool BuildChartMeshes(void);
+        void UnfoldChart(GPP::Int chartId, GPP::Int isometricIterationCount);
+        // Mirror the chart if most of its texture area is clockwise
+        void OrientChart(GPP::Int chartId);
+        void MeasureChart(GPP::Int chartId);
+        friend class UnfoldChartTask;
+
+    private:
+        GPP::ITriMesh* mpTriMesh;
+        std::vector<std::vector<GPP::Int> > mChartTriangleIds;
+        std::vector<GPP::SubTriMesh*> mChartMeshes;
+        std::vector<std::vector<GPP::Real> > mChartTexCoords;
+        std::vector<ChartInfo> mChartInfos;
+        std::vector<GPP::Real> mTexCoords;
+        std::vector<GPP::Int> mFaceTexIds;
+        double mUnfoldTime;
+        double mPackTime;
+    };
+}
@@ -0,0 +1,633 @@
+#include "DeformOperator.h"
+#include "../Common/ParallelTool.h"
+#include <xmmintrin.h>
+#include <malloc.h>
+#include <math.h>
+#include <algorithm>
+
+namespace MagicApp
+{
+    static const GPP::Int DEFORM_WEIGHT_COUNT = 4;
+    static const GPP::Int DEFORM_FIT_COUNT = 16;
+    static const GPP::Int GRID_POINTS_PER_CELL = 4;
+    static const GPP::Int GRID_MAX_RESOLUTION = 256;
+
+    // Uniform grid for k nearest neighbor queries of a fixed point set
+    class NearestPointGrid
+    {
+    public:
+        NearestPointGrid(const std::vector<GPP::Vector3>* coords) :
+            mpCoords(coords),
+            mBBoxMin(),
+            mCellSize(1),
+            mCellStart(),
+            mCellPointIds()
+        {
+            mResolution[0] = mResolution[1] = mResolution[2] = 1;
+            GPP::Int pointCount = coords->size();
+            if (pointCount == 0)
+            {
+                return;
+            }
+            GPP::Vector3 bboxMax = coords->at(0);
+            mBBoxMin = coords->at(0);
+            for (GPP::Int pid = 1; pid < pointCount; pid++)
+            {
+                for (int cid = 0; cid < 3; cid++)
+                {
+                    mBBoxMin[cid] = std::min(mBBoxMin[cid], coords->at(pid)[cid]);
+                    bboxMax[cid] = std::max(bboxMax[cid], coords->at(pid)[cid]);
+                }
+            }
+            GPP::Vector3 extent = bboxMax - mBBoxMin;
+            GPP::Real maxExtent = std::max(extent[0], std::max(extent[1], extent[2]));
+            if (maxExtent < GPP::REAL_TOL)
+            {
+                maxExtent = 1;
+            }
+            GPP::Real volume = 1;
+            for (int cid = 0; cid < 3; cid++)
+            {
+                volume *= std::max(extent[cid], maxExtent * 0.01);
+            }
+            GPP::Real cellCount = GPP::Real(pointCount) / GRID_POINTS_PER_CELL + 1;
+            mCellSize = pow(volume / cellCount, 1.0 / 3.0);
+            if (maxExtent / mCellSize > GRID_MAX_RESOLUTION - 1)
+            {
+                mCellSize = maxExtent / (GRID_MAX_RESOLUTION - 1);
+            }
+            for (int cid = 0; cid < 3; cid++)
+            {
+                mResolution[cid] = std::min(GRID_MAX_RESOLUTION, std::max(GPP::Int(1), GPP::Int(extent[cid] / mCellSize) + 1));
+            }
+            mCellStart.assign(mResolution[0] * mResolution[1] * mResolution[2] + 1, 0);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                mCellStart.at(CellIndex(coords->at(pid)) + 1)++;
+            }
+            for (GPP::Int cellId = 1; cellId < GPP::Int(mCellStart.size()); cellId++)
+            {
+                mCellStart.at(cellId) += mCellStart.at(cellId - 1);
+            }
+            mCellPointIds.resize(pointCount);
+            std::vector<GPP::Int> fillPos(mCellStart.begin(), mCellStart.end() - 1);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                mCellPointIds.at(fillPos.at(CellIndex(coords->at(pid)))++) = pid;
+            }
+        }
+
+        // ids and distanceSquares are sorted by distance, size <= k
+        void FindNearest(const GPP::Vector3& coord, GPP::Int k, std::vector<GPP::Int>& ids, std::vector<GPP::Real>& distanceSquares) const
+        {
+            ids.clear();
+            distanceSquares.clear();
+            if (mCellPointIds.empty() || k <= 0)
+            {
+                return;
+            }
+            GPP::Int cell[3];
+            CellCoord(coord, cell);
+            GPP::Int maxRing = std::max(mResolution[0], std::max(mResolution[1], mResolution[2]));
+            for (GPP::Int ring = 0; ring <= maxRing; ring++)
+            {
+                for (GPP::Int ix = cell[0] - ring; ix <= cell[0] + ring; ix++)
+                {
+                    if (ix < 0 || ix >= mResolution[0])
+                    {
+                        continue;
+                    }
+                    for (GPP::Int iy = cell[1] - ring; iy <= cell[1] + ring; iy++)
+                    {
+                        if (iy < 0 || iy >= mResolution[1])
+                        {
+                            continue;
+                        }
+                        bool isShellRow = (ix == cell[0] - ring || ix == cell[0] + ring || iy == cell[1] - ring || iy == cell[1] + ring);
+                        GPP::Int izStep = isShellRow ? 1 : 2 * ring;
+                        for (GPP::Int iz = cell[2] - ring; iz <= cell[2] + ring; iz += (izStep > 0 ? izStep : 1))
+                        {
+                            if (iz < 0 || iz >= mResolution[2])
+                            {
+                                continue;
+                            }
+                            GPP::Int cellId = (ix * mResolution[1] + iy) * mResolution[2] + iz;
+                            for (GPP::Int cpid = mCellStart.at(cellId); cpid < mCellStart.at(cellId + 1); cpid++)
+                            {
+                                GPP::Int pid = mCellPointIds.at(cpid);
+                                InsertCandidate(pid, (mpCoords->at(pid) - coord).LengthSquared(), k, ids, distanceSquares);
+                            }
+                        }
+                    }
+                }
+                GPP::Real ringDistance = ring * mCellSize;
+                if (GPP::Int(ids.size()) == k && distanceSquares.back() <= ringDistance * ringDistance)
+                {
+                    break;
+                }
+            }
+        }
+
+    private:
+        void CellCoord(const GPP::Vector3& coord, GPP::Int cell[3]) const
+        {
+            for (int cid = 0; cid < 3; cid++)
+            {
+                GPP::Int index = GPP::Int((coord[cid] - mBBoxMin[cid]) / mCellSize);
+                cell[cid] = std::min(mResolution[cid] - 1, std::max(GPP::Int(0), index));
+            }
+        }
+
+        GPP::Int CellIndex(const GPP::Vector3& coord) const
+        {
+            GPP::Int cell[3];
+            CellCoord(coord, cell);
+            return (cell[0] * mResolution[1] + cell[1]) * mResolution[2] + cell[2];
+        }
+
+        static void InsertCandidate(GPP::Int pid, GPP::Real distanceSquare, GPP::Int k, std::vector<GPP::Int>& ids,
+            std::vector<GPP::Real>& distanceSquares)
+        {
+            if (GPP::Int(ids.size()) == k)
+            {
+                if (distanceSquare >= distanceSquares.back())
+                {
+                    return;
+                }
+                ids.pop_back();
+                distanceSquares.pop_back();
+            }
+            GPP::Int insertId = ids.size();
+            ids.push_back(pid);
+            distanceSquares.push_back(distanceSquare);
+            while (insertId > 0 && distanceSquares.at(insertId - 1) > distanceSquare)
+            {
+                ids.at(insertId) = ids.at(insertId - 1);
+                distanceSquares.at(insertId) = distanceSquares.at(insertId - 1);
+                insertId--;
+            }
+            ids.at(insertId) = pid;
+            distanceSquares.at(insertId) = distanceSquare;
+        }
+
+        const std::vector<GPP::Vector3>* mpCoords;
+        GPP::Vector3 mBBoxMin;
+        GPP::Real mCellSize;
+        GPP::Int mResolution[3];
+        std::vector<GPP::Int> mCellStart;
+        std::vector<GPP::Int> mCellPointIds;
+    };
+
+    // Embedded deformation weights: w = (1 - d / dmax)^2 with dmax the distance to the (k+1)th nearest control
+    class ComputeWeightTask : public MagicCore::ParallelTask
+    {
+    public:
+        ComputeWeightTask(const NearestPointGrid* controlGrid, const std::vector<GPP::Vector3>* pointCoords,
+            GPP::Int weightCount, std::vector<GPP::Int>* weightControlIds, std::vector<float>* weights) :
+            mpControlGrid(controlGrid),
+            mpPointCoords(pointCoords),
+            mWeightCount(weightCount),
+            mpWeightControlIds(weightControlIds),
+            mpWeights(weights)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            std::vector<GPP::Int> ids;
+            std::vector<GPP::Real> distanceSquares;
+            for (int pid = startId; pid < endId; pid++)
+            {
+                mpControlGrid->FindNearest(mpPointCoords->at(pid), mWeightCount + 1, ids, distanceSquares);
+                GPP::Int nearCount = std::min(mWeightCount, GPP::Int(ids.size()));
+                GPP::Real maxDistance = sqrt(distanceSquares.back());
+                GPP::Real weightSum = 0;
+                std::vector<GPP::Real> localWeights(mWeightCount, 0);
+                for (GPP::Int nid = 0; nid < nearCount; nid++)
+                {
+                    GPP::Real ratio = maxDistance > GPP::REAL_TOL ? 1.0 - sqrt(distanceSquares.at(nid)) / maxDistance : 0;
+                    localWeights.at(nid) = ratio * ratio;
+                    weightSum += localWeights.at(nid);
+                }
+                if (weightSum < GPP::REAL_TOL)
+                {
+                    localWeights.assign(mWeightCount, 0);
+                    localWeights.at(0) = 1;
+                    weightSum = 1;
+                }
+                for (GPP::Int nid = 0; nid < mWeightCount; nid++)
+                {
+                    // Rows have a fixed width, unused entries keep weight 0 on control 0
+                    mpWeightControlIds->at(pid * mWeightCount + nid) = nid < nearCount ? ids.at(nid) : 0;
+                    mpWeights->at(pid * mWeightCount + nid) = float(localWeights.at(nid) / weightSum);
+                }
+            }
+        }
+
+    private:
+        const NearestPointGrid* mpControlGrid;
+        const std::vector<GPP::Vector3>* mpPointCoords;
+        GPP::Int mWeightCount;
+        std::vector<GPP::Int>* mpWeightControlIds;
+        std::vector<float>* mpWeights;
+    };
+
+    class FitTransformTask : public MagicCore::ParallelTask
+    {
+    public:
+        FitTransformTask(DeformOperator* deformOperator, const std::vector<GPP::Vector3>* deformedFitCoords) :
+            mpDeformOperator(deformOperator),
+            mpDeformedFitCoords(deformedFitCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int controlId = startId; controlId < endId; controlId++)
+            {
+                mpDeformOperator->FitControlTransform(controlId, *mpDeformedFitCoords);
+            }
+        }
+
+    private:
+        DeformOperator* mpDeformOperator;
+        const std::vector<GPP::Vector3>* mpDeformedFitCoords;
+    };
+
+    class ApplyOperatorTask : public MagicCore::ParallelTask
+    {
+    public:
+        ApplyOperatorTask(const float* pointCoords, const float* pointNormals, const float* controlTransforms,
+            const std::vector<GPP::Int>* weightControlIds, const std::vector<float>* weights, GPP::Int weightCount,
+            std::vector<GPP::Vector3>* coords, std::vector<GPP::Vector3>* normals) :
+            mpPointCoords(pointCoords),
+            mpPointNormals(pointNormals),
+            mpControlTransforms(controlTransforms),
+            mpWeightControlIds(weightControlIds),
+            mpWeights(weights),
+            mWeightCount(weightCount),
+            mpCoords(coords),
+            mpNormals(normals)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            float result[4];
+            const GPP::Int* controlIds = &(mpWeightControlIds->at(0));
+            const float* weights = &(mpWeights->at(0));
+            for (int pid = startId; pid < endId; pid++)
+            {
+                __m128 point = _mm_load_ps(mpPointCoords + pid * 4);
+                __m128 pointX = _mm_shuffle_ps(point, point, _MM_SHUFFLE(0, 0, 0, 0));
+                __m128 pointY = _mm_shuffle_ps(point, point, _MM_SHUFFLE(1, 1, 1, 1));
+                __m128 pointZ = _mm_shuffle_ps(point, point, _MM_SHUFFLE(2, 2, 2, 2));
+                __m128 coordSum = _mm_setzero_ps();
+                __m128 normalX, normalY, normalZ;
+                __m128 normalSum = _mm_setzero_ps();
+                if (mpPointNormals)
+                {
+                    __m128 normal = _mm_load_ps(mpPointNormals + pid * 4);
+                    normalX = _mm_shuffle_ps(normal, normal, _MM_SHUFFLE(0, 0, 0, 0));
+                    normalY = _mm_shuffle_ps(normal, normal, _MM_SHUFFLE(1, 1, 1, 1));
+                    normalZ = _mm_shuffle_ps(normal, normal, _MM_SHUFFLE(2, 2, 2, 2));
+                }
+                GPP::Int rowStart = pid * mWeightCount;
+                for (GPP::Int wid = rowStart; wid < rowStart + mWeightCount; wid++)
+                {
+                    const float* transform = mpControlTransforms + controlIds[wid] * 16;
+                    __m128 column0 = _mm_load_ps(transform);
+                    __m128 column1 = _mm_load_ps(transform + 4);
+                    __m128 column2 = _mm_load_ps(transform + 8);
+                    __m128 column3 = _mm_load_ps(transform + 12);
+                    __m128 weight = _mm_set1_ps(weights[wid]);
+                    __m128 rotated = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, pointX), _mm_mul_ps(column1, pointY)), _mm_mul_ps(column2, pointZ));
+                    coordSum = _mm_add_ps(coordSum, _mm_mul_ps(weight, _mm_add_ps(rotated, column3)));
+                    if (mpPointNormals)
+                    {
+                        __m128 rotatedNormal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, normalX), _mm_mul_ps(column1, normalY)),
+                            _mm_mul_ps(column2, normalZ));
+                        normalSum = _mm_add_ps(normalSum, _mm_mul_ps(weight, rotatedNormal));
+                    }
+                }
+                _mm_storeu_ps(result, coordSum);
+                mpCoords->at(pid) = GPP::Vector3(result[0], result[1], result[2]);
+                if (mpPointNormals)
+                {
+                    _mm_storeu_ps(result, normalSum);
+                    GPP::Vector3 normal(result[0], result[1], result[2]);
+                    normal.Normalise();
+                    mpNormals->at(pid) = normal;
+                }
+            }
+        }
+
+    private:
+        const float* mpPointCoords;
+        const float* mpPointNormals;
+        const float* mpControlTransforms;
+        const std::vector<GPP::Int>* mpWeightControlIds;
+        const std::vector<float>* mpWeights;
+        GPP::Int mWeightCount;
+        std::vector<GPP::Vector3>* mpCoords;
+        std::vector<GPP::Vector3>* mpNormals;
+    };
+
+    DeformOperator::DeformOperator() :
+        mPointCount(0),
+        mControlCount(0),
+        mpPointCoords(NULL),
+        mpPointNormals(NULL),
+        mWeightControlIds(),
+        mWeights(),
+        mFitCoords(),
+        mFitStart(),
+        mFitIds(),
+        mControlQuaternions(),
+        mpControlTransforms(NULL)
+    {
+    }
+
+    DeformOperator::~DeformOperator()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode DeformOperator::Compile(const std::vector<GPP::Vector3>& pointCoords, const std::vector<GPP::Vector3>& pointNormals,
+        const std::vector<GPP::Vector3>& controlCoords, const std::vector<GPP::Vector3>& fitCoords)
+    {
+        Clear();
+        if (pointCoords.empty() || controlCoords.empty() || fitCoords.empty())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (!pointNormals.empty() && pointNormals.size() != pointCoords.size())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mPointCount = pointCoords.size();
+        mControlCount = controlCoords.size();
+        mpPointCoords = (float*)_aligned_malloc(sizeof(float) * 4 * mPointCount, 16);
+        for (GPP::Int pid = 0; pid < mPointCount; pid++)
+        {
+            for (int cid = 0; cid < 3; cid++)
+            {
+                mpPointCoords[pid * 4 + cid] = float(pointCoords.at(pid)[cid]);
+            }
+            mpPointCoords[pid * 4 + 3] = 1.0f;
+        }
+        if (!pointNormals.empty())
+        {
+            mpPointNormals = (float*)_aligned_malloc(sizeof(float) * 4 * mPointCount, 16);
+            for (GPP::Int pid = 0; pid < mPointCount; pid++)
+            {
+                for (int cid = 0; cid < 3; cid++)
+                {
+                    mpPointNormals[pid * 4 + cid] = float(pointNormals.at(pid)[cid]);
+                }
+                mpPointNormals[pid * 4 + 3] = 0.0f;
+            }
+        }
+
+        NearestPointGrid controlGrid(&controlCoords);
+        mWeightControlIds.resize(mPointCount * DEFORM_WEIGHT_COUNT);
+        mWeights.resize(mPointCount * DEFORM_WEIGHT_COUNT);
+        ComputeWeightTask weightTask(&controlGrid, &pointCoords, DEFORM_WEIGHT_COUNT, &mWeightControlIds, &mWeights);
+        MagicCore::ParallelTool::ParallelFor(mPointCount, &weightTask);
+
+        mFitCoords = fitCoords;
+        NearestPointGrid fitGrid(&mFitCoords);
+        mFitStart.resize(mControlCount + 1);
+        mFitStart.at(0) = 0;
+        mFitIds.clear();
+        mFitIds.reserve(mControlCount * DEFORM_FIT_COUNT);
+        std::vector<GPP::Int> ids;
+        std::vector<GPP::Real> distanceSquares;
+        for (GPP::Int controlId = 0; controlId < mControlCount; controlId++)
+        {
+            fitGrid.FindNearest(controlCoords.at(controlId), DEFORM_FIT_COUNT, ids, distanceSquares);
+            mFitIds.insert(mFitIds.end(), ids.begin(), ids.end());
+            mFitStart.at(controlId + 1) = mFitIds.size();
+        }
+
+        mControlQuaternions.assign(mControlCount * 4, 0);
+        mpControlTransforms = (float*)_aligned_malloc(sizeof(float) * 16 * mControlCount, 16);
+        for (GPP::Int controlId = 0; controlId < mControlCount; controlId++)
+        {
+            mControlQuaternions.at(controlId * 4) = 1;
+            float* transform = mpControlTransforms + controlId * 16;
+            for (int eid = 0; eid < 16; eid++)
+            {
+                transform[eid] = 0.0f;
+            }
+            transform[0] = transform[5] = transform[10] = 1.0f;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    bool DeformOperator::IsCompiled() const
+    {
+        return mpControlTransforms != NULL;
+    }
+
+    void DeformOperator::Clear()
+    {
+        if (mpPointCoords != NULL)
+        {
+            _aligned_free(mpPointCoords);
+            mpPointCoords = NULL;
+        }
+        if (mpPointNormals != NULL)
+        {
+            _aligned_free(mpPointNormals);
+            mpPointNormals = NULL;
+        }
+        if (mpControlTransforms != NULL)
+        {
+            _aligned_free(mpControlTransforms);
+            mpControlTransforms = NULL;
+        }
+        mPointCount = 0;
+        mControlCount = 0;
+        mWeightControlIds.clear();
+        mWeights.clear();
+        mFitCoords.clear();
+        mFitStart.clear();
+        mFitIds.clear();
+        mControlQuaternions.clear();
+    }
+
+    GPP::ErrorCode DeformOperator::UpdateTransforms(const std::vector<GPP::Vector3>& deformedFitCoords)
+    {
+        if (!IsCompiled())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        if (deformedFitCoords.size() != mFitCoords.size())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        FitTransformTask fitTask(this, &deformedFitCoords);
+        MagicCore::ParallelTool::ParallelFor(mControlCount, &fitTask);
+        return GPP_NO_ERROR;
+    }
+
+    void DeformOperator::Apply(std::vector<GPP::Vector3>& coords, std::vector<GPP::Vector3>& normals) const
+    {
+        if (!IsCompiled())
+        {
+            coords.clear();
+            normals.clear();
+            return;
+        }
+        coords.resize(mPointCount);
+        if (mpPointNormals)
+        {
+            normals.resize(mPointCount);
+        }
+        else
+        {
+            normals.clear();
+        }
+        ApplyOperatorTask applyTask(mpPointCoords, mpPointNormals, mpControlTransforms, &mWeightControlIds, &mWeights,
+            DEFORM_WEIGHT_COUNT, &coords, &normals);
+        MagicCore::ParallelTool::ParallelFor(mPointCount, &applyTask, 4096);
+    }
+
+    GPP::Int DeformOperator::GetPointCount() const
+    {
+        return mPointCount;
+    }
+
+    GPP::Int DeformOperator::GetControlCount() const
+    {
+        return mControlCount;
+    }
+
+    // Rigid fit by Horn's quaternion method: the rotation is the dominant eigenvector of a 4x4 symmetric matrix
+    void DeformOperator::FitControlTransform(GPP::Int controlId, const std::vector<GPP::Vector3>& deformedFitCoords)
+    {
+        GPP::Int fitStart = mFitStart.at(controlId);
+        GPP::Int fitEnd = mFitStart.at(controlId + 1);
+        if (fitEnd == fitStart)
+        {
+            return;
+        }
+        GPP::Vector3 restCenter(0, 0, 0);
+        GPP::Vector3 deformedCenter(0, 0, 0);
+        for (GPP::Int fid = fitStart; fid < fitEnd; fid++)
+        {
+            restCenter += mFitCoords.at(mFitIds.at(fid));
+            deformedCenter += deformedFitCoords.at(mFitIds.at(fid));
+        }
+        restCenter /= GPP::Real(fitEnd - fitStart);
+        deformedCenter /= GPP::Real(fitEnd - fitStart);
+        GPP::Real s[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+        for (GPP::Int fid = fitStart; fid < fitEnd; fid++)
+        {
+            GPP::Vector3 restCoord = mFitCoords.at(mFitIds.at(fid)) - restCenter;
+            GPP::Vector3 deformedCoord = deformedFitCoords.at(mFitIds.at(fid)) - deformedCenter;
+            for (int rid = 0; rid < 3; rid++)
+            {
+                for (int cid = 0; cid < 3; cid++)
+                {
+                    s[rid][cid] += restCoord[rid] * deformedCoord[cid];
+                }
+            }
+        }
+        GPP::Real n[4][4] = {
+            {s[0][0] + s[1][1] + s[2][2], s[1][2] - s[2][1], s[2][0] - s[0][2], s[0][1] - s[1][0]},
+            {s[1][2] - s[2][1], s[0][0] - s[1][1] - s[2][2], s[0][1] + s[1][0], s[2][0] + s[0][2]},
+            {s[2][0] - s[0][2], s[0][1] + s[1][0], -s[0][0] + s[1][1] - s[2][2], s[1][2] + s[2][1]},
+            {s[0][1] - s[1][0], s[2][0] + s[0][2], s[1][2] + s[2][1], -s[0][0] - s[1][1] + s[2][2]}};
+        // Shift to a positive semi-definite matrix, then repeated squaring and a power step from the last rotation
+        GPP::Real shift = 0;
+        for (int rid = 0; rid < 4; rid++)
+        {
+            GPP::Real rowSum = 0;
+            for (int cid = 0; cid < 4; cid++)
+            {
+                rowSum += fabs(n[rid][cid]);
+            }
+            shift = std::max(shift, rowSum);
+        }
+        if (shift < GPP::REAL_TOL)
+        {
+            shift = 1;
+        }
+        for (int rid = 0; rid < 4; rid++)
+        {
+            n[rid][rid] += shift;
+        }
+        GPP::Real square[4][4];
+        for (int squareId = 0; squareId < 10; squareId++)
+        {
+            GPP::Real norm = 0;
+            for (int rid = 0; rid < 4; rid++)
+            {
+                for (int cid = 0; cid < 4; cid++)
+                {
+                    GPP::Real value = 0;
+                    for (int kid = 0; kid < 4; kid++)
+                    {
+                        value += n[rid][kid] * n[kid][cid];
+                    }
+                    square[rid][cid] = value;
+                    norm += value * value;
+                }
+            }
+            norm = sqrt(norm);
+            for (int rid = 0; rid < 4; rid++)
+            {
+                for (int cid = 0; cid < 4; cid++)
+                {
+                    n[rid][cid] = square[rid][cid] / norm;
+                }
+            }
+        }
+        GPP::Real* quaternion = &(mControlQuaternions.at(controlId * 4));
+        for (int iterId = 0; iterId < 4; iterId++)
+        {
+            GPP::Real nextQuaternion[4];
+            GPP::Real length = 0;
+            for (int rid = 0; rid < 4; rid++)
+            {
+                nextQuaternion[rid] = n[rid][0] * quaternion[0] + n[rid][1] * quaternion[1] + n[rid][2] * quaternion[2] + n[rid][3] * quaternion[3];
+                length += nextQuaternion[rid] * nextQuaternion[rid];
+            }
+            length = sqrt(length);
+            if (length < GPP::REAL_TOL)
+            {
+                break;
+            }
+            for (int rid = 0; rid < 4; rid++)
+            {
+                quaternion[rid] = nextQuaternion[rid] / length;
+            }
+        }
+        GPP::Real w = quaternion[0];
+        GPP::Real x = quaternion[1];
+        GPP::Real y = quaternion[2];
+        GPP::Real z = quaternion[3];
+        GPP::Real r[3][3] = {
+            {1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y)},
+            {2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x)},
+            {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)}};
+        // Columns of [R | deformedCenter - R * restCenter]
+        float* transform = mpControlTransforms + controlId * 16;
+        for (int cid = 0; cid < 3; cid++)
+        {
+            for (int rid = 0; rid < 3; rid++)
+            {
+                transform[cid * 4 + rid] = float(r[rid][cid]);
+            }
+            transform[cid * 4 + 3] = 0.0f;
+        }
+        for (int rid = 0; rid < 3; rid++)
+        {
+            GPP::Real translation = deformedCenter[rid] - (r[rid][0] * restCenter[0] + r[rid][1] * restCenter[1] + r[rid][2] * restCenter[2]);
+            transform[12 + rid] = float(translation);
+        }
+        transform[15] = 0.0f;
+    }
+}
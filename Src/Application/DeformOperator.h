@@ -0,0 +1,53 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Control point deformation compiled into a sparse operator: Deformed Coord = Sum(Wij * Mj * OriginCoord).
+    // The control -> point weights (embedded deformation weights of the nearest controls) are built once into fixed-width sparse rows.
+    // Every frame the rigid transform Mj of each control is fitted from a small deformed point set around it,
+    // and the operator is applied to all points with a parallel SSE sparse product.
+    // USAGE: 1. deformOperator.Compile(pointCoords, pointNormals, controlCoords, fitCoords);
+    //        2. deformOperator.UpdateTransforms(deformedFitCoords);
+    //        3. deformOperator.Apply(deformedCoords, deformedNormals);
+    class DeformOperator
+    {
+    public:
+        DeformOperator();
+        ~DeformOperator();
+
+        // pointNormals can be empty. fitCoords: rest coordinates of the points used to fit the control transforms
+        GPP::ErrorCode Compile(const std::vector<GPP::Vector3>& pointCoords, const std::vector<GPP::Vector3>& pointNormals,
+            const std::vector<GPP::Vector3>& controlCoords, const std::vector<GPP::Vector3>& fitCoords);
+        bool IsCompiled(void) const;
+        void Clear(void);
+
+        // deformedFitCoords has the same size as fitCoords in Compile
+        GPP::ErrorCode UpdateTransforms(const std::vector<GPP::Vector3>& deformedFitCoords);
+        // normals is cleared if Compile has no normals
+        void Apply(std::vector<GPP::Vector3>& coords, std::vector<GPP::Vector3>& normals) const;
+
+        GPP::Int GetPointCount(void) const;
+        GPP::Int GetControlCount(void) const;
+
+    private:
+        DeformOperator(const DeformOperator&);
+        DeformOperator& operator = (const DeformOperator&);
+        void FitControlTransform(GPP::Int controlId, const std::vector<GPP::Vector3>& deformedFitCoords);
+        friend class FitTransformTask;
+
+    private:
+        GPP::Int mPointCount;
+        GPP::Int mControlCount;
+        float* mpPointCoords;
+        float* mpPointNormals;
+        std::vector<GPP::Int> mWeightControlIds;
+        std::vector<float> mWeights;
+        std::vector<GPP::Vector3> mFitCoords;
+        std::vector<GPP::Int> mFitStart;
+        std::vector<GPP::Int> mFitIds;
+        std::vector<GPP::Real> mControlQuaternions;
+        float* mpControlTransforms;
+    };
+}
@@ -0,0 +1,471 @@
+#include "DeformWorker.h"
+#include "../Common/LogSystem.h"
+#include <windows.h>
+#include <process.h>
+#include <algorithm>
+#include <math.h>
+
+namespace MagicApp
+{
+    static const GPP::Int DEFORM_OPERATOR_POINT_COUNT = 100000;
+    static const GPP::Int DEFORM_PROXY_POINT_COUNT = 50000;
+    static const int PROXY_VOXEL_ITERATION = 5;
+
+    // One point per occupied voxel, the one nearest to the voxel center. The voxel size is tuned until the occupied
+    // voxel count is close to targetCount. proxyIds is in increasing point id order
+    static void SampleProxyPoints(const GPP::IPointCloud* pointCloud, GPP::Int targetCount, std::vector<GPP::Int>& proxyIds)
+    {
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        GPP::Vector3 bboxMin = pointCloud->GetPointCoord(0);
+        GPP::Vector3 bboxMax = bboxMin;
+        for (GPP::Int pid = 1; pid < pointCount; pid++)
+        {
+            GPP::Vector3 coord = pointCloud->GetPointCoord(pid);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bboxMin[axis] = std::min(bboxMin[axis], coord[axis]);
+                bboxMax[axis] = std::max(bboxMax[axis], coord[axis]);
+            }
+        }
+        GPP::Real diagonal = (bboxMax - bboxMin).Length();
+        GPP::Real minCellSize = (diagonal > GPP::REAL_TOL) ? diagonal * 1.0e-5 : 1.0;
+        // scanned point clouds are surfaces, the occupied voxel count goes like 1 / cellSize^2
+        GPP::Real cellSize = std::max(minCellSize, diagonal / sqrt(GPP::Real(targetCount)));
+        GPP::ULongInt resolution = 0;
+        std::vector<std::pair<GPP::ULongInt, GPP::Int> > voxelPoints(pointCount);
+        GPP::Int voxelCount = 0;
+        for (int iteration = 0; iteration < PROXY_VOXEL_ITERATION; iteration++)
+        {
+            resolution = GPP::ULongInt(diagonal / cellSize) + 2;
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                GPP::Vector3 offset = pointCloud->GetPointCoord(pid) - bboxMin;
+                GPP::ULongInt voxelIndex[3];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    voxelIndex[axis] = GPP::ULongInt(offset[axis] / cellSize);
+                }
+                voxelPoints.at(pid).first = (voxelIndex[0] * resolution + voxelIndex[1]) * resolution + voxelIndex[2];
+                voxelPoints.at(pid).second = pid;
+            }
+            std::sort(voxelPoints.begin(), voxelPoints.end());
+            voxelCount = 0;
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                if (pid == 0 || voxelPoints.at(pid).first != voxelPoints.at(pid - 1).first)
+                {
+                    voxelCount++;
+                }
+            }
+            if (iteration == PROXY_VOXEL_ITERATION - 1 || (voxelCount > targetCount * 0.8 && voxelCount < targetCount * 1.25))
+            {
+                break;
+            }
+            cellSize = std::max(minCellSize, cellSize * sqrt(GPP::Real(voxelCount) / GPP::Real(targetCount)));
+        }
+        proxyIds.clear();
+        proxyIds.reserve(voxelCount);
+        GPP::Int runStart = 0;
+        while (runStart < pointCount)
+        {
+            GPP::ULongInt voxelKey = voxelPoints.at(runStart).first;
+            GPP::Vector3 center(GPP::Real(voxelKey / resolution / resolution) + 0.5, GPP::Real(voxelKey / resolution % resolution) + 0.5,
+                GPP::Real(voxelKey % resolution) + 0.5);
+            center = bboxMin + center * cellSize;
+            GPP::Int nearestId = voxelPoints.at(runStart).second;
+            GPP::Real nearestDistance = (pointCloud->GetPointCoord(nearestId) - center).LengthSquared();
+            GPP::Int runEnd = runStart + 1;
+            for (; runEnd < pointCount && voxelPoints.at(runEnd).first == voxelKey; runEnd++)
+            {
+                GPP::Int pid = voxelPoints.at(runEnd).second;
+                GPP::Real distance = (pointCloud->GetPointCoord(pid) - center).LengthSquared();
+                if (distance < nearestDistance)
+                {
+                    nearestDistance = distance;
+                    nearestId = pid;
+                }
+            }
+            proxyIds.push_back(nearestId);
+            runStart = runEnd;
+        }
+        std::sort(proxyIds.begin(), proxyIds.end());
+    }
+
+    DeformWorker::DeformWorker() :
+        mpDeformMesh(NULL),
+        mpDeformPointList(NULL),
+        mpWorkTriMesh(NULL),
+        mpWorkPointCloud(NULL),
+        mProxyPointIds(),
+        mDeformOperator(),
+        mDeformedProxyCoords(),
+        mPendingRequest(),
+        mHasPendingRequest(false),
+        mIsRunning(false),
+        mIsStopping(false),
+        mBackCoords(),
+        mBackNormals(),
+        mReadyCoords(),
+        mReadyNormals(),
+        mReadyResult(GPP_NO_ERROR),
+        mHasReadyResult(false),
+        mDroppedCount(0),
+        mpLock(NULL),
+        mpRequestEvent(NULL),
+        mpIdleEvent(NULL),
+        mpWorkerThread(NULL)
+    {
+        CRITICAL_SECTION* lock = new CRITICAL_SECTION;
+        InitializeCriticalSection(lock);
+        mpLock = lock;
+        mpRequestEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        mpIdleEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+    }
+
+    DeformWorker::~DeformWorker()
+    {
+        Stop();
+        CloseHandle((HANDLE)mpRequestEvent);
+        CloseHandle((HANDLE)mpIdleEvent);
+        CRITICAL_SECTION* lock = (CRITICAL_SECTION*)mpLock;
+        DeleteCriticalSection(lock);
+        GPPFREEPOINTER(lock);
+        mpLock = NULL;
+    }
+
+    GPP::ErrorCode DeformWorker::StartMesh(GPP::DeformMesh* deformMesh, const GPP::TriMesh* triMesh, const std::vector<bool>& vertexFixFlags)
+    {
+        Stop();
+        if (deformMesh == NULL || triMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mpWorkTriMesh = GPP::CopyTriMesh(triMesh);
+        if (mpWorkTriMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::ErrorCode res = deformMesh->Init(mpWorkTriMesh, vertexFixFlags);
+        if (res != GPP_NO_ERROR)
+        {
+            GPPFREEPOINTER(mpWorkTriMesh);
+            return res;
+        }
+        mpDeformMesh = deformMesh;
+        return StartThread();
+    }
+
+    GPP::ErrorCode DeformWorker::StartPointCloud(GPP::DeformPointList* deformPointList, const GPP::IPointCloud* pointCloud,
+        GPP::Int controlPointCount)
+    {
+        Stop();
+        if (deformPointList == NULL || pointCloud == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        bool hasNormal = pointCloud->HasNormal();
+        // Large point cloud: GPP deforms a voxel sampled proxy, the operator maps it to all points
+        mProxyPointIds.clear();
+        if (pointCount > DEFORM_OPERATOR_POINT_COUNT)
+        {
+            SampleProxyPoints(pointCloud, DEFORM_PROXY_POINT_COUNT, mProxyPointIds);
+            InfoLog << "DeformWorker::StartPointCloud deform " << pointCount << " points through a proxy of " << GPP::Int(mProxyPointIds.size())
+                << " points" << std::endl;
+        }
+        GPP::Int workPointCount = mProxyPointIds.empty() ? pointCount : GPP::Int(mProxyPointIds.size());
+        mpWorkPointCloud = new GPP::PointCloud(hasNormal, false);
+        mpWorkPointCloud->ReservePoint(workPointCount);
+        for (GPP::Int wid = 0; wid < workPointCount; wid++)
+        {
+            GPP::Int pid = mProxyPointIds.empty() ? wid : mProxyPointIds.at(wid);
+            if (hasNormal)
+            {
+                mpWorkPointCloud->InsertPoint(pointCloud->GetPointCoord(pid), pointCloud->GetPointNormal(pid));
+            }
+            else
+            {
+                mpWorkPointCloud->InsertPoint(pointCloud->GetPointCoord(pid));
+            }
+        }
+        GPP::ErrorCode res = deformPointList->Init(mpWorkPointCloud, controlPointCount);
+        if (res != GPP_NO_ERROR)
+        {
+            GPPFREEPOINTER(mpWorkPointCloud);
+            mProxyPointIds.clear();
+            return res;
+        }
+        mpDeformPointList = deformPointList;
+        if (!mProxyPointIds.empty())
+        {
+            std::vector<GPP::Vector3> pointCoords(pointCount);
+            std::vector<GPP::Vector3> pointNormals;
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                pointCoords.at(pid) = pointCloud->GetPointCoord(pid);
+            }
+            if (hasNormal)
+            {
+                pointNormals.resize(pointCount);
+                for (GPP::Int pid = 0; pid < pointCount; pid++)
+                {
+                    pointNormals.at(pid) = pointCloud->GetPointNormal(pid);
+                }
+            }
+            std::vector<GPP::Int> controlIds;
+            deformPointList->GetControlIds(controlIds);
+            std::vector<GPP::Vector3> controlCoords;
+            controlCoords.reserve(controlIds.size());
+            for (std::vector<GPP::Int>::iterator itr = controlIds.begin(); itr != controlIds.end(); ++itr)
+            {
+                controlCoords.push_back(mpWorkPointCloud->GetPointCoord(*itr));
+            }
+            std::vector<GPP::Vector3> proxyCoords(workPointCount);
+            for (GPP::Int wid = 0; wid < workPointCount; wid++)
+            {
+                proxyCoords.at(wid) = mpWorkPointCloud->GetPointCoord(wid);
+            }
+            res = mDeformOperator.Compile(pointCoords, pointNormals, controlCoords, proxyCoords);
+            if (res != GPP_NO_ERROR)
+            {
+                Stop();
+                return res;
+            }
+        }
+        return StartThread();
+    }
+
+    void DeformWorker::GetControlIds(std::vector<GPP::Int>& controlIds)
+    {
+        controlIds.clear();
+        if (mpDeformPointList == NULL)
+        {
+            return;
+        }
+        mpDeformPointList->GetControlIds(controlIds);
+        if (!mProxyPointIds.empty())
+        {
+            for (std::vector<GPP::Int>::iterator itr = controlIds.begin(); itr != controlIds.end(); ++itr)
+            {
+                *itr = mProxyPointIds.at(*itr);
+            }
+        }
+    }
+
+    GPP::ErrorCode DeformWorker::StartThread()
+    {
+        mIsStopping = false;
+        mHasPendingRequest = false;
+        mIsRunning = false;
+        mHasReadyResult = false;
+        mDroppedCount = 0;
+        SetEvent((HANDLE)mpIdleEvent);
+        mpWorkerThread = (void*)_beginthreadex(NULL, 0, WorkerThread, (void*)this, 0, NULL);
+        if (mpWorkerThread == NULL)
+        {
+            Stop();
+            return GPP_INVALID_RESULT;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void DeformWorker::Stop()
+    {
+        if (mpWorkerThread != NULL)
+        {
+            EnterCriticalSection((CRITICAL_SECTION*)mpLock);
+            mIsStopping = true;
+            SetEvent((HANDLE)mpRequestEvent);
+            LeaveCriticalSection((CRITICAL_SECTION*)mpLock);
+            WaitForSingleObject((HANDLE)mpWorkerThread, INFINITE);
+            CloseHandle((HANDLE)mpWorkerThread);
+            mpWorkerThread = NULL;
+        }
+        mpDeformMesh = NULL;
+        mpDeformPointList = NULL;
+        GPPFREEPOINTER(mpWorkTriMesh);
+        GPPFREEPOINTER(mpWorkPointCloud);
+        mProxyPointIds.clear();
+        mDeformOperator.Clear();
+        mDeformedProxyCoords.clear();
+        mHasPendingRequest = false;
+        mIsRunning = false;
+        mHasReadyResult = false;
+        mBackCoords.clear();
+        mBackNormals.clear();
+        mReadyCoords.clear();
+        mReadyNormals.clear();
+        SetEvent((HANDLE)mpIdleEvent);
+    }
+
+    bool DeformWorker::IsStarted() const
+    {
+        return mpWorkerThread != NULL;
+    }
+
+    void DeformWorker::PostDeform(const std::vector<GPP::Int>& targetIds, const std::vector<GPP::Vector3>& targetCoords,
+        const std::vector<bool>& fixFlags, bool isAccurate)
+    {
+        if (mpWorkerThread == NULL)
+        {
+            return;
+        }
+        EnterCriticalSection((CRITICAL_SECTION*)mpLock);
+        if (mHasPendingRequest)
+        {
+            mDroppedCount++;
+        }
+        mPendingRequest.mTargetIds = targetIds;
+        mPendingRequest.mTargetCoords = targetCoords;
+        mPendingRequest.mFixFlags = fixFlags;
+        mPendingRequest.mIsAccurate = isAccurate;
+        mHasPendingRequest = true;
+        ResetEvent((HANDLE)mpIdleEvent);
+        SetEvent((HANDLE)mpRequestEvent);
+        LeaveCriticalSection((CRITICAL_SECTION*)mpLock);
+    }
+
+    bool DeformWorker::FetchResult(std::vector<GPP::Vector3>& coords, std::vector<GPP::Vector3>& normals, GPP::ErrorCode& res)
+    {
+        if (mpWorkerThread == NULL)
+        {
+            return false;
+        }
+        EnterCriticalSection((CRITICAL_SECTION*)mpLock);
+        bool hasResult = mHasReadyResult;
+        if (hasResult)
+        {
+            coords.swap(mReadyCoords);
+            normals.swap(mReadyNormals);
+            res = mReadyResult;
+            mHasReadyResult = false;
+        }
+        LeaveCriticalSection((CRITICAL_SECTION*)mpLock);
+        return hasResult;
+    }
+
+    void DeformWorker::WaitIdle()
+    {
+        if (mpWorkerThread != NULL)
+        {
+            WaitForSingleObject((HANDLE)mpIdleEvent, INFINITE);
+        }
+    }
+
+    GPP::Int DeformWorker::GetDroppedCount() const
+    {
+        return mDroppedCount;
+    }
+
+    GPP::ErrorCode DeformWorker::RunRequest(const DeformRequest& request)
+    {
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        if (mpDeformMesh)
+        {
+            res = mpDeformMesh->Deform(request.mTargetIds, request.mTargetCoords,
+                request.mIsAccurate ? GPP::DEFORM_MESH_TYPE_ACCURATE : GPP::DEFORM_MESH_TYPE_FAST);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            mpWorkTriMesh->UpdateNormal();
+            GPP::Int vertexCount = mpWorkTriMesh->GetVertexCount();
+            mBackCoords.resize(vertexCount);
+            mBackNormals.resize(vertexCount);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                mBackCoords.at(vid) = mpWorkTriMesh->GetVertexCoord(vid);
+                mBackNormals.at(vid) = mpWorkTriMesh->GetVertexNormal(vid);
+            }
+        }
+        else if (mpDeformPointList)
+        {
+            res = mpDeformPointList->Deform(request.mTargetIds, request.mTargetCoords, request.mFixFlags);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            GPP::Int pointCount = mpWorkPointCloud->GetPointCount();
+            if (mDeformOperator.IsCompiled())
+            {
+                mDeformedProxyCoords.resize(pointCount);
+                for (GPP::Int pid = 0; pid < pointCount; pid++)
+                {
+                    mDeformedProxyCoords.at(pid) = mpWorkPointCloud->GetPointCoord(pid);
+                }
+                res = mDeformOperator.UpdateTransforms(mDeformedProxyCoords);
+                if (res == GPP_NO_ERROR)
+                {
+                    mDeformOperator.Apply(mBackCoords, mBackNormals);
+                }
+                return res;
+            }
+            mBackCoords.resize(pointCount);
+            mBackNormals.clear();
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                mBackCoords.at(pid) = mpWorkPointCloud->GetPointCoord(pid);
+            }
+            if (mpWorkPointCloud->HasNormal())
+            {
+                mBackNormals.resize(pointCount);
+                for (GPP::Int pid = 0; pid < pointCount; pid++)
+                {
+                    mBackNormals.at(pid) = mpWorkPointCloud->GetPointNormal(pid);
+                }
+            }
+        }
+        return res;
+    }
+
+    unsigned __stdcall DeformWorker::WorkerThread(void* arg)
+    {
+        DeformWorker* worker = (DeformWorker*)arg;
+        if (worker == NULL)
+        {
+            return 0;
+        }
+        CRITICAL_SECTION* lock = (CRITICAL_SECTION*)worker->mpLock;
+        DeformRequest request;
+        while (true)
+        {
+            WaitForSingleObject((HANDLE)worker->mpRequestEvent, INFINITE);
+            while (true)
+            {
+                EnterCriticalSection(lock);
+                if (worker->mIsStopping)
+                {
+                    LeaveCriticalSection(lock);
+                    return 1;
+                }
+                if (!worker->mHasPendingRequest)
+                {
+                    SetEvent((HANDLE)worker->mpIdleEvent);
+                    LeaveCriticalSection(lock);
+                    break;
+                }
+                request.mTargetIds.swap(worker->mPendingRequest.mTargetIds);
+                request.mTargetCoords.swap(worker->mPendingRequest.mTargetCoords);
+                request.mFixFlags.swap(worker->mPendingRequest.mFixFlags);
+                request.mIsAccurate = worker->mPendingRequest.mIsAccurate;
+                worker->mHasPendingRequest = false;
+                worker->mIsRunning = true;
+                LeaveCriticalSection(lock);
+
+                GPP::ErrorCode res = worker->RunRequest(request);
+
+                EnterCriticalSection(lock);
+                if (res == GPP_NO_ERROR)
+                {
+                    worker->mBackCoords.swap(worker->mReadyCoords);
+                    worker->mBackNormals.swap(worker->mReadyNormals);
+                }
+                worker->mReadyResult = res;
+                worker->mHasReadyResult = true;
+                worker->mIsRunning = false;
+                LeaveCriticalSection(lock);
+            }
+        }
+        return 1;
+    }
+}
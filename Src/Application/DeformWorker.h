@@ -0,0 +1,82 @@
+#pragma once
+#include "GPP.h"
+#include "DeformOperator.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Runs GPP::DeformMesh or GPP::DeformPointList on a private copy of the model in a worker thread.
+    // Posted targets replace each other, so the worker always solves the newest one and stale drags are dropped.
+    // Finished coordinates are double buffered and picked up by the render thread with FetchResult.
+    // A large point cloud is deformed through a proxy, one point per occupied voxel of a grid sized for about 50000 voxels,
+    // so the proxy is spatially uniform whatever the scan order. GPP solves the proxy, then every point of the full cloud
+    // is blended from the rigid transforms of its nearest controls (embedded deformation weights), each transform fitted to
+    // the deformed proxy points around its control, see DeformOperator. It approximates a direct solve on the full cloud.
+    // USAGE: 1. deformWorker.StartMesh(deformMesh, triMesh, vertexFixFlags);
+    //        2. deformWorker.PostDeform(targetIds, targetCoords, fixFlags, false);  // in MouseMoved
+    //        3. if (deformWorker.FetchResult(coords, normals, res)) copy coords into the rendered model;  // in Update
+    class DeformWorker
+    {
+    public:
+        DeformWorker();
+        ~DeformWorker();
+
+        // Copy triMesh and init deformMesh with the copy. deformMesh is only used by the worker until Stop
+        GPP::ErrorCode StartMesh(GPP::DeformMesh* deformMesh, const GPP::TriMesh* triMesh, const std::vector<bool>& vertexFixFlags);
+        // Copy pointCloud and init deformPointList with the copy
+        GPP::ErrorCode StartPointCloud(GPP::DeformPointList* deformPointList, const GPP::IPointCloud* pointCloud, GPP::Int controlPointCount);
+        // Control point ids of the point cloud passed to StartPointCloud
+        void GetControlIds(std::vector<GPP::Int>& controlIds);
+        // Wait for the running deformation, stop the worker and drop the pending target and result
+        void Stop(void);
+        bool IsStarted(void) const;
+
+        // targetIds: vertex ids for DeformMesh, control indices for DeformPointList
+        // fixFlags: control fix flags, only used by DeformPointList
+        void PostDeform(const std::vector<GPP::Int>& targetIds, const std::vector<GPP::Vector3>& targetCoords,
+            const std::vector<bool>& fixFlags, bool isAccurate);
+        // Return false if there is no new result. coords and normals are swapped with the ready buffer
+        bool FetchResult(std::vector<GPP::Vector3>& coords, std::vector<GPP::Vector3>& normals, GPP::ErrorCode& res);
+        // Wait until the pending target is solved
+        void WaitIdle(void);
+        // Posted targets that were replaced before the worker picked them up
+        GPP::Int GetDroppedCount(void) const;
+
+    private:
+        struct DeformRequest
+        {
+            std::vector<GPP::Int> mTargetIds;
+            std::vector<GPP::Vector3> mTargetCoords;
+            std::vector<bool> mFixFlags;
+            bool mIsAccurate;
+        };
+
+        GPP::ErrorCode StartThread(void);
+        GPP::ErrorCode RunRequest(const DeformRequest& request);
+        static unsigned __stdcall WorkerThread(void* arg);
+
+    private:
+        GPP::DeformMesh* mpDeformMesh;
+        GPP::DeformPointList* mpDeformPointList;
+        GPP::TriMesh* mpWorkTriMesh;
+        GPP::PointCloud* mpWorkPointCloud;
+        std::vector<GPP::Int> mProxyPointIds;
+        DeformOperator mDeformOperator;
+        std::vector<GPP::Vector3> mDeformedProxyCoords;
+        DeformRequest mPendingRequest;
+        bool mHasPendingRequest;
+        bool mIsRunning;
+        bool mIsStopping;
+        std::vector<GPP::Vector3> mBackCoords;
+        std::vector<GPP::Vector3> mBackNormals;
+        std::vector<GPP::Vector3> mReadyCoords;
+        std::vector<GPP::Vector3> mReadyNormals;
+        GPP::ErrorCode mReadyResult;
+        bool mHasReadyResult;
+        GPP::Int mDroppedCount;
+        void* mpLock;
+        void* mpRequestEvent;
+        void* mpIdleEvent;
+        void* mpWorkerThread;
+    };
+}
@@ -7,9 +7,20 @@
 #include "../Common/RenderSystem.h"
 #include "../Common/ViewTool.h"
 #include "AppManager.h"
+#include "ModelExporter.h"
+#include "ModelManager.h"
+#include "ModelRegistry.h"
+#include "MeshShopApp.h"
+#include "TsdfVolume.h"
+#include "MarchingCubes.h"
 
 namespace MagicApp
 {
+    // TSDF truncation distance in voxels
+    static const GPP::Real TSDF_TRUNCATION_RATIO = 4.0;
+    // BenchmarkFusion skips the dense SignedDistanceFunction above it
+    static const double MAX_BENCHMARK_DENSE_VOXEL_COUNT = 512.0 * 512.0 * 512.0;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         DepthVideoApp* app = (DepthVideoApp*)arg;
@@ -25,7 +36,8 @@ namespace MagicApp
         mpUI(NULL),
         mpViewTool(NULL),
         mCommandType(CT_NONE),
-        mPointCloudList(),
+        mPointCloudHandles(),
+        mRegisteredTransforms(),
         mObjCenterCoord(),
         mScaleValue(0),
         mSelectCloudIndex(0),
@@ -33,7 +45,10 @@ namespace MagicApp
         mUpdatePointCloudListRendering(false),
         mUpdateUIScrollBar(false),
         mProgressValue(-1),
-        mGroupSize(0)
+        mGroupSize(0),
+        mIsExtractMesh(false),
+        mEnterMeshShop(false),
+        mpFusedTriMesh(NULL)
     {
     }
 
@@ -41,6 +56,7 @@ namespace MagicApp
     {
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
+        GPPFREEPOINTER(mpFusedTriMesh);
     }
 
     bool DepthVideoApp::Enter(void)
@@ -77,7 +93,15 @@ namespace MagicApp
         if (mUpdateUIScrollBar)
         {
             mUpdateUIScrollBar = false;
-            mpUI->SetScrollRange(mPointCloudList.size());
+            mpUI->SetScrollRange(mPointCloudHandles.size());
+        }
+        if (mEnterMeshShop)
+        {
+            mEnterMeshShop = false;
+            ModelManager::Get()->SetMesh(mpFusedTriMesh);
+            ModelManager::Get()->ClearPointCloud();
+            mpFusedTriMesh = NULL;
+            AppManager::Get()->EnterApp(new MeshShopApp, "MeshShopApp");
         }
         return true;
     }
@@ -133,6 +157,10 @@ namespace MagicApp
 
     bool DepthVideoApp::KeyPressed( const OIS::KeyEvent &arg )
     {
+        if (arg.key == OIS::KC_B)
+        {
+            BenchmarkFusion();
+        }
         return true;
     }
 
@@ -183,6 +211,8 @@ namespace MagicApp
         {
             GPP::ResetApiProgress();
             mpUI->StartProgressbar(100);
+            // the worker exports the aligned point clouds, the exporter singleton is created here on the main thread
+            ModelExporter::Get();
             _beginthreadex(NULL, 0, RunThread, (void *)this, 0, NULL);
         }
         else
@@ -195,7 +225,7 @@ namespace MagicApp
                 ImportPointCloud(false);
                 break;
             case MagicApp::DepthVideoApp::CT_ALIGN_POINTCLOUD:
-                AlignPointCloudList(mGroupSize, false);
+                AlignPointCloudList(mGroupSize, mIsExtractMesh, false);
                 break;
             default:
                 break;
@@ -220,29 +250,49 @@ namespace MagicApp
 
     void DepthVideoApp::ClearPointCloudList()
     {
-        for (std::vector<GPP::PointCloud*>::iterator itr = mPointCloudList.begin(); itr != mPointCloudList.end(); ++itr)
+        ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
+        for (std::vector<GPP::Int>::iterator itr = mPointCloudHandles.begin(); itr != mPointCloudHandles.end(); ++itr)
         {
-            GPPFREEPOINTER(*itr);
+            modelRegistry->Release(*itr);
+        }
+        mPointCloudHandles.clear();
+        mRegisteredTransforms.clear();
+    }
+
+    void DepthVideoApp::UnpinPointCloudList(int pinnedCount)
+    {
+        ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
+        for (int cid = 0; cid < pinnedCount; cid++)
+        {
+            modelRegistry->Unpin(mPointCloudHandles.at(cid), false);
         }
-        mPointCloudList.clear();
     }
 
     void DepthVideoApp::UpdatePointCloudListRendering()
     {
-        if (mPointCloudList.size() == 0)
+        if (mPointCloudHandles.size() == 0)
         {
             return;
         }
-        if (mPointCloudList.at(mSelectCloudIndex)->HasNormal())
+        // Only the shown frame has to be in memory
+        ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
+        GPP::Int handle = mPointCloudHandles.at(mSelectCloudIndex);
+        GPP::PointCloud* pointCloud = modelRegistry->PinPointCloud(handle);
+        if (pointCloud == NULL)
         {
-            MagicCore::RenderSystem::Get()->RenderPointCloud("PointCloud_DepthVideoApp", "CookTorrancePoint", mPointCloudList.at(mSelectCloudIndex), 
+            return;
+        }
+        if (pointCloud->HasNormal())
+        {
+            MagicCore::RenderSystem::Get()->RenderPointCloud("PointCloud_DepthVideoApp", "CookTorrancePoint", pointCloud, 
                 MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL);
         }
         else
         {
-            MagicCore::RenderSystem::Get()->RenderPointCloud("PointCloud_DepthVideoApp", "SimplePoint", mPointCloudList.at(mSelectCloudIndex), 
+            MagicCore::RenderSystem::Get()->RenderPointCloud("PointCloud_DepthVideoApp", "SimplePoint", pointCloud, 
                 MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL);
         }
+        modelRegistry->Unpin(handle, false);
     }
 
     void DepthVideoApp::ImportPointCloud(bool isSubThread)
@@ -269,7 +319,8 @@ namespace MagicApp
                 mIsCommandInProgress = true;
                 mSelectCloudIndex = 0;
                 ClearPointCloudList();
-                mPointCloudList.reserve(fileNames.size());
+                mPointCloudHandles.reserve(fileNames.size());
+                ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
                 for (int fileId = 0; fileId < fileNames.size(); fileId++)
                 {
                     GPP::PointCloud* pointCloud = GPP::Parser::ImportPointCloud(fileNames.at(fileId));
@@ -277,7 +328,7 @@ namespace MagicApp
                     { 
                         continue;
                     }
-                    if (mPointCloudList.empty())
+                    if (mPointCloudHandles.empty())
                     {
                         pointCloud->UnifyCoords(2.0, &mScaleValue, &mObjCenterCoord);
                     }
@@ -285,8 +336,8 @@ namespace MagicApp
                     {
                         pointCloud->UnifyCoords(mScaleValue, mObjCenterCoord);
                     }
-                    mPointCloudList.push_back(pointCloud);
-                    if (mPointCloudList.size() == 1)
+                    mPointCloudHandles.push_back(modelRegistry->AddPointCloud(pointCloud, NULL, fileNames.at(fileId)));
+                    if (mPointCloudHandles.size() == 1)
                     {
                         mUpdatePointCloudListRendering = true;
                     }
@@ -298,7 +349,7 @@ namespace MagicApp
         }
     }
 
-    void DepthVideoApp::AlignPointCloudList(int groupSize, bool isSubThread)
+    void DepthVideoApp::AlignPointCloudList(int groupSize, bool isExtractMesh, bool isSubThread)
     {
         if (IsCommandAvaliable() == false)
         {
@@ -308,6 +359,7 @@ namespace MagicApp
         {
             mCommandType = CT_ALIGN_POINTCLOUD;
             mGroupSize = groupSize;
+            mIsExtractMesh = isExtractMesh;
             DoCommand(true);
         }
         else
@@ -329,6 +381,7 @@ namespace MagicApp
                 {
                     groupCount++;
                 }
+                ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
                 for (int groupId = 0; groupId < groupCount; groupId++)
                 {
                     ClearPointCloudList();
@@ -403,83 +456,122 @@ namespace MagicApp
                         GPPFREEPOINTER(lastPointCloud);
                         lastPointCloud = curPointCloud;
 
-                        mPointCloudList.push_back(originPointCloud);
+                        mPointCloudHandles.push_back(modelRegistry->AddPointCloud(originPointCloud, NULL, fileNames.at(depthId)));
                         initTransformList.push_back(transformAcc);
                         // Export point cloud
                         std::string inputModelName = fileNames.at(depthId);
                         size_t dotPos = inputModelName.rfind('.');
                         std::stringstream dumpStream;
-                        dumpStream << inputModelName.substr(0, dotPos) << "_align.asc";
+                        dumpStream << inputModelName.substr(0, dotPos) << "_align.ply";
                         std::string outputModelName;
                         dumpStream >> outputModelName;
-                        GPP::Parser::ExportPointCloud(outputModelName, curPointCloud);
+                        if (ModelExporter::Get()->ExportPointCloudPly(outputModelName, curPointCloud, true) != GPP_NO_ERROR)
+                        {
+                            InfoLog << "Point Cloud " << depthId << " export " << outputModelName << " failed" << std::endl;
+                        }
 
                         mProgressValue = int(depthId * 100.0 / fileCount);
                         mUpdateUIScrollBar = true;
                         mUpdatePointCloudListRendering = true;
                     }
                     GPPFREEPOINTER(lastPointCloud);
-                    if (mPointCloudList.size() < 2)
+                    if (ModelExporter::Get()->Flush() != GPP_NO_ERROR)
+                    {
+                        InfoLog << "DepthVideoApp: write aligned point clouds failed" << std::endl;
+                    }
+                    if (mPointCloudHandles.size() < 2)
                     {
-                        MessageBox(NULL, "ʼƴʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "初始拼接失败", "温馨提示", MB_OK);
                         return;
                     }
                     //mProgressValue = -1;
-                    // Global registrate
+                    // Global registrate, every point cloud of the group is pinned until the fusion is done
+                    int cloudCount = mPointCloudHandles.size();   
                     std::vector<GPP::IPointCloud*> pointCloudList;
-                    for (std::vector<GPP::PointCloud*>::iterator itr = mPointCloudList.begin(); itr != mPointCloudList.end(); ++itr)
+                    for (int cid = 0; cid < cloudCount; cid++)
                     {
-                        pointCloudList.push_back(*itr);
+                        GPP::PointCloud* pointCloud = modelRegistry->PinPointCloud(mPointCloudHandles.at(cid));
+                        if (pointCloud == NULL)
+                        {
+                            UnpinPointCloudList(cid);
+                            MessageBox(NULL, "点云读取失败", "温馨提示", MB_OK);
+                            return;
+                        }
+                        pointCloudList.push_back(pointCloud);
                     }
                     std::vector<GPP::Matrix4x4> resultTransform;
                     GPP::ErrorCode res = GPP::RegistratePointCloud::GlobalRegistrate(&pointCloudList, 10, &resultTransform, 
                         &initTransformList, true, 0);
                     if (res != GPP_NO_ERROR)
                     {
-                        MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
+                        UnpinPointCloudList(cloudCount);
+                        MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
                         return;
                     }
+                    mRegisteredTransforms = resultTransform;
 
-                    int cloudCount = mPointCloudList.size();   
-                    // Fuse point cloud
-                    GPP::Vector3 bboxMin, bboxMax;
-                    res = GPP::CalculatePointCloudListBoundingBox(pointCloudList, &resultTransform, bboxMin, bboxMax);
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "Χмʧ", "ܰʾ", MB_OK);
-                        return;
-                    }
-                    GPP::Vector3 deltaVec(0.1, 0.1, 0.1);
-                    bboxMin -= deltaVec;
-                    bboxMax += deltaVec;
+                    // Fuse point cloud, only blocks near the surface are allocated so there is no bounding box
                     GPP::PointCloudPointList pointList(pointCloudList.at(0));
                     double epsilon = 0;
                     res = GPP::CalculatePointListDensity(&pointList, 4, epsilon);
-                    int resolutionX = int((bboxMax[0] - bboxMin[0]) / epsilon) + 1;
-		            int resolutionY = int((bboxMax[1] - bboxMin[1]) / epsilon) + 1;
-		            int resolutionZ = int((bboxMax[2] - bboxMin[2]) / epsilon) + 1;
-                    InfoLog << "epsilon=" << epsilon << " resX=" << resolutionX << " resY=" << resolutionY << " resZ=" << resolutionZ << std::endl;
-                    GPP::SignedDistanceFunction sdf(resolutionX, resolutionY, resolutionZ, bboxMin, bboxMax);
+                    InfoLog << "epsilon=" << epsilon << std::endl;
+                    TsdfVolume tsdfVolume(epsilon, epsilon * TSDF_TRUNCATION_RATIO);
                     for (int cid = 0; cid < cloudCount; cid++)
                     {
                         //mProgressValue = int(cid * 100.0 / cloudCount);
-                        res = sdf.UpdateFunction(pointCloudList.at(cid), &(resultTransform.at(cid)));
+                        res = tsdfVolume.Integrate(pointCloudList.at(cid), &(resultTransform.at(cid)));
+                        if (res != GPP_NO_ERROR)
+                        {
+                            UnpinPointCloudList(cloudCount);
+                            MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
+                            return;
+                        }
+                    }
+                    UnpinPointCloudList(cloudCount);
+                    InfoLog << "TSDF fuse: " << cloudCount / tsdfVolume.GetIntegrateTime() << " frames/s, blocks=" 
+                        << tsdfVolume.GetBlockCount() << " memory=" << tsdfVolume.GetMemoryByteCount() / 1048576 << "MB" << std::endl;
+                    if (isExtractMesh)
+                    {
+                        GPP::TriMesh* fusedTriMesh = new GPP::TriMesh;
+                        MarchingCubes marchingCubes;
+                        res = marchingCubes.Extract(&tsdfVolume, fusedTriMesh);
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                            GPPFREEPOINTER(fusedTriMesh);
+                            MessageBox(NULL, "网格萃取失败", "温馨提示", MB_OK);
                             return;
                         }
+                        InfoLog << "Marching cubes: " << marchingCubes.GetExtractTime() << "s, vertex=" << fusedTriMesh->GetVertexCount() 
+                            << " triangle=" << fusedTriMesh->GetTriangleCount() << std::endl;
+                        std::stringstream outputStream;
+                        outputStream << "fuse_res_" << groupId << ".ply";
+                        std::string outputModelName;
+                        outputStream >> outputModelName;
+                        res = GPP::Parser::ExportTriMesh(outputModelName, fusedTriMesh);
+                        if (res != GPP_NO_ERROR)
+                        {
+                            MessageBox(NULL, "导出网格失败", "温馨提示", MB_OK);
+                        }
+                        if (groupId + 1 < groupCount)
+                        {
+                            GPPFREEPOINTER(fusedTriMesh);
+                            continue;
+                        }
+                        // The mesh keeps its gradient normals, so no UpdateNormal here
+                        fusedTriMesh->UnifyCoords(2.0);
+                        // ModelManager belongs to the main thread, Update sets the mesh there
+                        mpFusedTriMesh = fusedTriMesh;
+                        mEnterMeshShop = true;
+                        break;
                     }
                     GPP::PointCloud* fusedPointCloud = new GPP::PointCloud;
-                    res = sdf.ExtractPointCloud(fusedPointCloud);
+                    res = tsdfVolume.ExtractPointCloud(fusedPointCloud);
                     if (res != GPP_NO_ERROR)
                     {
-                        MessageBox(NULL, "ȡʧ", "ܰʾ", MB_OK);
+                        GPPFREEPOINTER(fusedPointCloud);
+                        MessageBox(NULL, "点云萃取失败", "温馨提示", MB_OK);
                         return;
                     }
-                    mPointCloudList.push_back(fusedPointCloud);
-                    mUpdateUIScrollBar = true;
-                    mUpdatePointCloudListRendering = true;
                     // save result
                     std::stringstream outputStream;
                     outputStream << "fuse_res_" << groupId << ".asc";
@@ -488,8 +580,11 @@ namespace MagicApp
                     res = GPP::Parser::ExportPointCloud(outputModelName, fusedPointCloud);
                     if (res != GPP_NO_ERROR)
                     {
-                        MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "导出点云失败", "温馨提示", MB_OK);
                     }
+                    mPointCloudHandles.push_back(modelRegistry->AddPointCloud(fusedPointCloud, NULL, outputModelName));
+                    mUpdateUIScrollBar = true;
+                    mUpdatePointCloudListRendering = true;
                 }
             }
             else
@@ -499,9 +594,112 @@ namespace MagicApp
         }
     }
 
+    void DepthVideoApp::BenchmarkFusion()
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        // Imported frames are raw depth frames, only frames registrated by AlignPointCloudList can be fused
+        int cloudCount = mRegisteredTransforms.size();
+        if (cloudCount < 2 || cloudCount > int(mPointCloudHandles.size()))
+        {
+            MessageBox(NULL, "请先拼接点云", "温馨提示", MB_OK);
+            return;
+        }
+        ModelRegistry* modelRegistry = ModelManager::Get()->GetModelRegistry();
+        GPP::Vector3 bboxMin, bboxMax;
+        double epsilon = 0;
+        for (int cid = 0; cid < cloudCount; cid++)
+        {
+            GPP::PointCloud* pointCloud = modelRegistry->PinPointCloud(mPointCloudHandles.at(cid));
+            if (pointCloud == NULL)
+            {
+                MessageBox(NULL, "点云读取失败", "温馨提示", MB_OK);
+                return;
+            }
+            if (cid == 0)
+            {
+                GPP::PointCloudPointList pointList(pointCloud);
+                if (GPP::CalculatePointListDensity(&pointList, 4, epsilon) != GPP_NO_ERROR)
+                {
+                    modelRegistry->Unpin(mPointCloudHandles.at(cid), false);
+                    MessageBox(NULL, "包围盒计算失败", "温馨提示", MB_OK);
+                    return;
+                }
+            }
+            const GPP::Matrix4x4& transform = mRegisteredTransforms.at(cid);
+            int pointCount = pointCloud->GetPointCount();
+            for (int pid = 0; pid < pointCount; pid++)
+            {
+                GPP::Vector3 coord = transform.TransformPoint(pointCloud->GetPointCoord(pid));
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    bboxMin[axis] = ((cid == 0 && pid == 0) || coord[axis] < bboxMin[axis]) ? coord[axis] : bboxMin[axis];
+                    bboxMax[axis] = ((cid == 0 && pid == 0) || coord[axis] > bboxMax[axis]) ? coord[axis] : bboxMax[axis];
+                }
+            }
+            modelRegistry->Unpin(mPointCloudHandles.at(cid), false);
+        }
+        InfoLog << "BenchmarkFusion: frames " << cloudCount << " epsilon " << epsilon << std::endl;
+
+        TsdfVolume tsdfVolume(epsilon, epsilon * TSDF_TRUNCATION_RATIO);
+        for (int cid = 0; cid < cloudCount; cid++)
+        {
+            GPP::PointCloud* pointCloud = modelRegistry->PinPointCloud(mPointCloudHandles.at(cid));
+            if (pointCloud == NULL || tsdfVolume.Integrate(pointCloud, &(mRegisteredTransforms.at(cid))) != GPP_NO_ERROR)
+            {
+                if (pointCloud)
+                {
+                    modelRegistry->Unpin(mPointCloudHandles.at(cid), false);
+                }
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
+                return;
+            }
+            modelRegistry->Unpin(mPointCloudHandles.at(cid), false);
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        GPP::PointCloud extractPointCloud;
+        tsdfVolume.ExtractPointCloud(&extractPointCloud);
+        double extractTime = MagicCore::ToolKit::GetTime() - startTime;
+        GPP::Vector3 extent = bboxMax - bboxMin;
+        double denseVoxelCount = (extent[0] / epsilon + 1) * (extent[1] / epsilon + 1) * (extent[2] / epsilon + 1);
+        InfoLog << "  TsdfVolume: " << cloudCount / tsdfVolume.GetIntegrateTime() << " frames/s, extract " << extractTime 
+            << " points " << extractPointCloud.GetPointCount() << " blocks " << tsdfVolume.GetBlockCount() << " memory "
+            << tsdfVolume.GetMemoryByteCount() / 1048576 << "MB, dense voxels " << denseVoxelCount << std::endl;
+        if (denseVoxelCount > MAX_BENCHMARK_DENSE_VOXEL_COUNT)
+        {
+            InfoLog << "  SignedDistanceFunction: skipped, dense grid is too large" << std::endl;
+            return;
+        }
+
+        int resolutionX = int(extent[0] / epsilon) + 1;
+        int resolutionY = int(extent[1] / epsilon) + 1;
+        int resolutionZ = int(extent[2] / epsilon) + 1;
+        GPP::SignedDistanceFunction sdf(resolutionX, resolutionY, resolutionZ, bboxMin, bboxMax);
+        startTime = MagicCore::ToolKit::GetTime();
+        for (int cid = 0; cid < cloudCount; cid++)
+        {
+            GPP::PointCloud* pointCloud = modelRegistry->PinPointCloud(mPointCloudHandles.at(cid));
+            if (pointCloud == NULL)
+            {
+                return;
+            }
+            GPP::ErrorCode res = sdf.UpdateFunction(pointCloud, &(mRegisteredTransforms.at(cid)));
+            modelRegistry->Unpin(mPointCloudHandles.at(cid), false);
+            if (res != GPP_NO_ERROR)
+            {
+                InfoLog << "  SignedDistanceFunction failed" << std::endl;
+                return;
+            }
+        }
+        double sdfTime = MagicCore::ToolKit::GetTime() - startTime;
+        InfoLog << "  SignedDistanceFunction: " << cloudCount / sdfTime << " frames/s" << std::endl;
+    }
+
     void DepthVideoApp::SetPointCloudIndex(int index)
     {
-        if (index >= mPointCloudList.size())
+        if (index >= mPointCloudHandles.size())
         {
             return;
         }
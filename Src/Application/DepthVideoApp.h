@@ -35,7 +35,9 @@ namespace MagicApp
         void DoCommand(bool isSubThread);
 
         void ImportPointCloud(bool isSubThread = true);
-        void AlignPointCloudList(int groupSize, bool isSubThread = true);
+        // isExtractMesh: extract every fused group as a mesh with MarchingCubes and enter MeshShopApp with the last one,
+        // instead of extracting a point cloud to reconstruct
+        void AlignPointCloudList(int groupSize, bool isExtractMesh = false, bool isSubThread = true);
 
         void SetPointCloudIndex(int index);
         bool IsCommandInProgress(void);
@@ -44,7 +46,11 @@ namespace MagicApp
         void InitViewTool(void);
         bool IsCommandAvaliable(void);
         void ClearPointCloudList(void);
+        // Unpin the first pinnedCount point clouds of the list
+        void UnpinPointCloudList(int pinnedCount);
         void UpdatePointCloudListRendering(void);
+        // Log TsdfVolume and SignedDistanceFunction fusion speed of the registered frames of the last AlignPointCloudList
+        void BenchmarkFusion(void);
 
     private:
         void SetupScene(void);
@@ -55,7 +61,10 @@ namespace MagicApp
         DepthVideoAppUI* mpUI;
         MagicCore::ViewTool* mpViewTool;
         CommandType mCommandType;
-        std::vector<GPP::PointCloud*> mPointCloudList;
+        // Handles of ModelManager's ModelRegistry, frames that are not shown can be evicted to disk
+        std::vector<GPP::Int> mPointCloudHandles;
+        // Global registration of the first frames of mPointCloudHandles, empty until AlignPointCloudList registrates them
+        std::vector<GPP::Matrix4x4> mRegisteredTransforms;
         GPP::Vector3 mObjCenterCoord;
         GPP::Real mScaleValue;
         int mSelectCloudIndex;
@@ -64,5 +73,9 @@ namespace MagicApp
         bool mUpdateUIScrollBar;
         int mProgressValue;
         int mGroupSize;
+        bool mIsExtractMesh;
+        bool mEnterMeshShop;
+        // Fused mesh of the command thread, handed to ModelManager in Update together with mEnterMeshShop
+        GPP::TriMesh* mpFusedTriMesh;
     };
 }
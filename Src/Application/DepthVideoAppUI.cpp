@@ -28,6 +28,7 @@ namespace MagicApp
         mRoot.at(0)->findWidget("But_ImportPointCloud")->castType<MyGUI::Button>()->eventMouseButtonClick += MyGUI::newDelegate(this, &DepthVideoAppUI::ImportPointCloud);
         mRoot.at(0)->findWidget("But_AlignPointCloudList")->castType<MyGUI::Button>()->eventMouseButtonClick += MyGUI::newDelegate(this, &DepthVideoAppUI::AlignPointCloudList);
         mRoot.at(0)->findWidget("But_DoAlignPointCloudList")->castType<MyGUI::Button>()->eventMouseButtonClick += MyGUI::newDelegate(this, &DepthVideoAppUI::DoAlignPointCloudList);
+        mRoot.at(0)->findWidget("But_DoAlignPointCloudListToMesh")->castType<MyGUI::Button>()->eventMouseButtonClick += MyGUI::newDelegate(this, &DepthVideoAppUI::DoAlignPointCloudListToMesh);
 
         mRoot.at(0)->findWidget("But_BackToHomepage")->castType<MyGUI::Button>()->eventMouseButtonClick += MyGUI::newDelegate(this, &DepthVideoAppUI::BackToHomepage);
     }
@@ -102,6 +103,7 @@ namespace MagicApp
         bool isVisible = mRoot.at(0)->findWidget("But_DoAlignPointCloudList")->castType<MyGUI::Button>()->isVisible();
         isVisible = !isVisible;
         mRoot.at(0)->findWidget("But_DoAlignPointCloudList")->castType<MyGUI::Button>()->setVisible(isVisible);
+        mRoot.at(0)->findWidget("But_DoAlignPointCloudListToMesh")->castType<MyGUI::Button>()->setVisible(isVisible);
         mRoot.at(0)->findWidget("Edit_GroupSize")->castType<MyGUI::EditBox>()->setVisible(isVisible);
         if (isVisible)
         {
@@ -125,6 +127,17 @@ namespace MagicApp
         }
     }
 
+    void DepthVideoAppUI::DoAlignPointCloudListToMesh(MyGUI::Widget* pSender)
+    {
+        DepthVideoApp* depthVideoApp = dynamic_cast<DepthVideoApp* >(AppManager::Get()->GetApp("DepthVideoApp"));
+        if (depthVideoApp != NULL)
+        {
+            std::string textString = mRoot.at(0)->findWidget("Edit_GroupSize")->castType<MyGUI::EditBox>()->getOnlyText();
+            int groupCount = std::atoi(textString.c_str());
+            depthVideoApp->AlignPointCloudList(groupCount, true);
+        }
+    }
+
     void DepthVideoAppUI::BackToHomepage(MyGUI::Widget* pSender)
     {
         DepthVideoApp* depthVideoApp = dynamic_cast<DepthVideoApp* >(AppManager::Get()->GetApp("DepthVideoApp"));
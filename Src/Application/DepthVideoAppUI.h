@@ -24,6 +24,7 @@ namespace MagicApp
         void ImportPointCloud(MyGUI::Widget* pSender);
         void AlignPointCloudList(MyGUI::Widget* pSender);
         void DoAlignPointCloudList(MyGUI::Widget* pSender);
+        void DoAlignPointCloudListToMesh(MyGUI::Widget* pSender);
         void BackToHomepage(MyGUI::Widget* pSender);
 
     private:
@@ -0,0 +1,24 @@
+#pragma once
+#include "GPP.h"
+
+namespace MagicApp
+{
+    // Signed distance samples on an integer voxel lattice, grouped in blocks of 8x8x8 voxels.
+    // Block b covers the voxels [b * 8, b * 8 + 8) on every axis. Distances are positive outside the surface.
+    // Read access must be thread safe, MarchingCubes reads the blocks concurrently.
+    class IDistanceVolume
+    {
+    public:
+        static const GPP::Int BLOCK_EDGE_BITS = 3;
+
+        IDistanceVolume() {}
+        virtual GPP::Int GetBlockCount(void) const = 0;
+        virtual void GetBlockCoord(GPP::Int blockId, GPP::Int blockCoord[3]) const = 0;
+        // -1 if the block is not allocated
+        virtual GPP::Int FindBlockId(const GPP::Int blockCoord[3]) const = 0;
+        // false if the voxel is not observed
+        virtual bool GetVoxelDistance(const GPP::Int voxel[3], GPP::Real& distance) const = 0;
+        virtual GPP::Vector3 GetVoxelCoord(const GPP::Int voxel[3]) const = 0;
+        virtual ~IDistanceVolume() {}
+    };
+}
@@ -0,0 +1,989 @@
+#include "HeatGeodesics.h"
+#include "../Common/ParallelTool.h"
+#include <windows.h>
+#include <process.h>
+#include <algorithm>
+#include <math.h>
+
+namespace MagicApp
+{
+    static const GPP::Real DEFAULT_TIME_FACTOR = 1.0;
+
+    SparseLDLT::SparseLDLT() :
+        mDimension(0),
+        mPerm(),
+        mPermInv(),
+        mParent(),
+        mLowerStart(),
+        mLowerRowIds(),
+        mLowerValues(),
+        mDiagonal()
+    {
+    }
+
+    SparseLDLT::~SparseLDLT()
+    {
+    }
+
+    void SparseLDLT::AnalysePattern(const std::vector<GPP::Int>& columnStart, const std::vector<GPP::Int>& rowIds,
+        const std::vector<GPP::Int>& perm)
+    {
+        mDimension = perm.size();
+        mPerm = perm;
+        mPermInv.resize(mDimension);
+        for (GPP::Int k = 0; k < mDimension; k++)
+        {
+            mPermInv.at(mPerm.at(k)) = k;
+        }
+        // elimination tree and column counts of L
+        mParent.assign(mDimension, -1);
+        std::vector<GPP::Int> flags(mDimension, -1);
+        std::vector<GPP::Int> lowerCount(mDimension, 0);
+        for (GPP::Int k = 0; k < mDimension; k++)
+        {
+            flags.at(k) = k;
+            GPP::Int oldId = mPerm.at(k);
+            for (GPP::Int p = columnStart.at(oldId); p < columnStart.at(oldId + 1); p++)
+            {
+                GPP::Int i = mPermInv.at(rowIds.at(p));
+                if (i >= k)
+                {
+                    continue;
+                }
+                for (; flags.at(i) != k; i = mParent.at(i))
+                {
+                    if (mParent.at(i) == -1)
+                    {
+                        mParent.at(i) = k;
+                    }
+                    lowerCount.at(i)++;
+                    flags.at(i) = k;
+                }
+            }
+        }
+        mLowerStart.resize(mDimension + 1);
+        mLowerStart.at(0) = 0;
+        for (GPP::Int k = 0; k < mDimension; k++)
+        {
+            mLowerStart.at(k + 1) = mLowerStart.at(k) + lowerCount.at(k);
+        }
+        mLowerRowIds.resize(mLowerStart.at(mDimension));
+        mLowerValues.resize(mLowerStart.at(mDimension));
+        mDiagonal.resize(mDimension);
+    }
+
+    GPP::ErrorCode SparseLDLT::Factorize(const std::vector<GPP::Int>& columnStart, const std::vector<GPP::Int>& rowIds,
+        const std::vector<GPP::Real>& values)
+    {
+        if (mDimension == 0 || mLowerStart.size() != mDimension + 1)
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        // up-looking factorization, row k of L is computed by a sparse triangular solve
+        std::vector<GPP::Real> rowValues(mDimension, 0);
+        std::vector<GPP::Int> pattern(mDimension);
+        std::vector<GPP::Int> flags(mDimension, -1);
+        std::vector<GPP::Int> lowerCount(mDimension, 0);
+        for (GPP::Int k = 0; k < mDimension; k++)
+        {
+            GPP::Int top = mDimension;
+            flags.at(k) = k;
+            GPP::Int oldId = mPerm.at(k);
+            for (GPP::Int p = columnStart.at(oldId); p < columnStart.at(oldId + 1); p++)
+            {
+                GPP::Int i = mPermInv.at(rowIds.at(p));
+                if (i > k)
+                {
+                    continue;
+                }
+                rowValues.at(i) += values.at(p);
+                GPP::Int len = 0;
+                for (; flags.at(i) != k; i = mParent.at(i))
+                {
+                    pattern.at(len++) = i;
+                    flags.at(i) = k;
+                }
+                while (len > 0)
+                {
+                    pattern.at(--top) = pattern.at(--len);
+                }
+            }
+            GPP::Real diagonal = rowValues.at(k);
+            rowValues.at(k) = 0;
+            for (; top < mDimension; top++)
+            {
+                GPP::Int i = pattern.at(top);
+                GPP::Real yi = rowValues.at(i);
+                rowValues.at(i) = 0;
+                GPP::Int pEnd = mLowerStart.at(i) + lowerCount.at(i);
+                for (GPP::Int p = mLowerStart.at(i); p < pEnd; p++)
+                {
+                    rowValues.at(mLowerRowIds.at(p)) -= mLowerValues.at(p) * yi;
+                }
+                GPP::Real lki = yi / mDiagonal.at(i);
+                diagonal -= lki * yi;
+                mLowerRowIds.at(pEnd) = k;
+                mLowerValues.at(pEnd) = lki;
+                lowerCount.at(i)++;
+            }
+            if (diagonal <= 0)
+            {
+                return GPP_INVALID_RESULT;
+            }
+            mDiagonal.at(k) = diagonal;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void SparseLDLT::Solve(std::vector<GPP::Real>& rhs) const
+    {
+        std::vector<GPP::Real> y(mDimension);
+        for (GPP::Int k = 0; k < mDimension; k++)
+        {
+            y.at(k) = rhs.at(mPerm.at(k));
+        }
+        for (GPP::Int j = 0; j < mDimension; j++)
+        {
+            GPP::Real yj = y[j];
+            for (GPP::Int p = mLowerStart[j]; p < mLowerStart[j + 1]; p++)
+            {
+                y[mLowerRowIds[p]] -= mLowerValues[p] * yj;
+            }
+        }
+        for (GPP::Int j = 0; j < mDimension; j++)
+        {
+            y[j] /= mDiagonal[j];
+        }
+        for (GPP::Int j = mDimension - 1; j >= 0; j--)
+        {
+            GPP::Real yj = y[j];
+            for (GPP::Int p = mLowerStart[j]; p < mLowerStart[j + 1]; p++)
+            {
+                yj -= mLowerValues[p] * y[mLowerRowIds[p]];
+            }
+            y[j] = yj;
+        }
+        for (GPP::Int k = 0; k < mDimension; k++)
+        {
+            rhs.at(mPerm.at(k)) = y.at(k);
+        }
+    }
+
+    GPP::Int SparseLDLT::GetNonZeroCount() const
+    {
+        return mLowerRowIds.size() + mDimension;
+    }
+
+    void SparseLDLT::Clear()
+    {
+        mDimension = 0;
+        mPerm.clear();
+        mPermInv.clear();
+        mParent.clear();
+        mLowerStart.clear();
+        mLowerRowIds.clear();
+        mLowerValues.clear();
+        mDiagonal.clear();
+    }
+
+    struct CoordAxisLess
+    {
+        const std::vector<GPP::Vector3>* mpCoords;
+        int mAxis;
+
+        bool operator()(GPP::Int vertexId0, GPP::Int vertexId1) const
+        {
+            return mpCoords->at(vertexId0)[mAxis] < mpCoords->at(vertexId1)[mAxis];
+        }
+    };
+
+    class FactorizeTask : public MagicCore::ParallelTask
+    {
+    public:
+        FactorizeTask(SparseLDLT** solvers, const std::vector<GPP::Int>* columnStart, const std::vector<GPP::Int>* rowIds,
+            const std::vector<GPP::Real>** values, const std::vector<GPP::Int>* perm) :
+            mpSolvers(solvers),
+            mpColumnStart(columnStart),
+            mpRowIds(rowIds),
+            mpValues(values),
+            mpPerm(perm)
+        {
+            mResults[0] = GPP_NO_ERROR;
+            mResults[1] = GPP_NO_ERROR;
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int sid = startId; sid < endId; sid++)
+            {
+                mpSolvers[sid]->AnalysePattern(*mpColumnStart, *mpRowIds, *mpPerm);
+                mResults[sid] = mpSolvers[sid]->Factorize(*mpColumnStart, *mpRowIds, *(mpValues[sid]));
+            }
+        }
+
+        GPP::ErrorCode mResults[2];
+
+    private:
+        SparseLDLT** mpSolvers;
+        const std::vector<GPP::Int>* mpColumnStart;
+        const std::vector<GPP::Int>* mpRowIds;
+        const std::vector<GPP::Real>** mpValues;
+        const std::vector<GPP::Int>* mpPerm;
+    };
+
+    HeatGeodesics::HeatGeodesics() :
+        mpTriMesh(NULL),
+        mVertexCount(0),
+        mTriangleCount(0),
+        mVertexCoords(),
+        mTriangleVertexIds(),
+        mFaceNormals(),
+        mFaceAreas(),
+        mFaceCotangents(),
+        mVertexAreas(),
+        mVertexFaceStart(),
+        mVertexFaceIds(),
+        mTimeFactor(DEFAULT_TIME_FACTOR),
+        mTimeStep(0),
+        mHeatSolver(),
+        mPoissonSolver(),
+        mFactorState(FACTOR_NONE),
+        mpFactorThread(NULL)
+    {
+    }
+
+    HeatGeodesics::~HeatGeodesics()
+    {
+        Clear();
+    }
+
+    void HeatGeodesics::SetTimeFactor(GPP::Real timeFactor)
+    {
+        if (timeFactor > GPP::REAL_TOL)
+        {
+            mTimeFactor = timeFactor;
+        }
+    }
+
+    GPP::ErrorCode HeatGeodesics::Init(const GPP::ITriMesh* triMesh)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetVertexCount() < 3 || triMesh->GetTriangleCount() < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        CopyMeshData(triMesh);
+        mFactorState = FACTOR_RUNNING;
+        GPP::ErrorCode res = Factorize();
+        mFactorState = (res == GPP_NO_ERROR) ? FACTOR_READY : FACTOR_FAILED;
+        return res;
+    }
+
+    GPP::ErrorCode HeatGeodesics::InitAsync(const GPP::ITriMesh* triMesh)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetVertexCount() < 3 || triMesh->GetTriangleCount() < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        CopyMeshData(triMesh);
+        mFactorState = FACTOR_RUNNING;
+        mpFactorThread = (void*)_beginthreadex(NULL, 0, FactorizeThread, (void*)this, 0, NULL);
+        if (mpFactorThread == NULL)
+        {
+            GPP::ErrorCode res = Factorize();
+            mFactorState = (res == GPP_NO_ERROR) ? FACTOR_READY : FACTOR_FAILED;
+            return res;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    unsigned __stdcall HeatGeodesics::FactorizeThread(void* arg)
+    {
+        HeatGeodesics* heatGeodesics = (HeatGeodesics*)arg;
+        if (heatGeodesics == NULL)
+        {
+            return 0;
+        }
+        GPP::ErrorCode res = heatGeodesics->Factorize();
+        InterlockedExchange(&(heatGeodesics->mFactorState), (res == GPP_NO_ERROR) ? FACTOR_READY : FACTOR_FAILED);
+        return 1;
+    }
+
+    bool HeatGeodesics::IsReady() const
+    {
+        return mFactorState == FACTOR_READY;
+    }
+
+    bool HeatGeodesics::IsBuiltFrom(const GPP::ITriMesh* triMesh) const
+    {
+        return triMesh != NULL && mpTriMesh == triMesh && mFactorState != FACTOR_NONE && mFactorState != FACTOR_FAILED &&
+            mVertexCount == triMesh->GetVertexCount() && mTriangleCount == triMesh->GetTriangleCount();
+    }
+
+    void HeatGeodesics::WaitReady()
+    {
+        if (mpFactorThread != NULL)
+        {
+            WaitForSingleObject((HANDLE)mpFactorThread, INFINITE);
+            CloseHandle((HANDLE)mpFactorThread);
+            mpFactorThread = NULL;
+        }
+    }
+
+    void HeatGeodesics::Clear()
+    {
+        WaitReady();
+        mFactorState = FACTOR_NONE;
+        mpTriMesh = NULL;
+        mVertexCount = 0;
+        mTriangleCount = 0;
+        mVertexCoords.clear();
+        mTriangleVertexIds.clear();
+        mFaceNormals.clear();
+        mFaceAreas.clear();
+        mFaceCotangents.clear();
+        mVertexAreas.clear();
+        mVertexFaceStart.clear();
+        mVertexFaceIds.clear();
+        mTimeStep = 0;
+        mHeatSolver.Clear();
+        mPoissonSolver.Clear();
+    }
+
+    void HeatGeodesics::CopyMeshData(const GPP::ITriMesh* triMesh)
+    {
+        mpTriMesh = triMesh;
+        mVertexCount = triMesh->GetVertexCount();
+        mTriangleCount = triMesh->GetTriangleCount();
+        mVertexCoords.resize(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCoords.at(vid) = triMesh->GetVertexCoord(vid);
+        }
+        mTriangleVertexIds.resize(mTriangleCount * 3);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, &(mTriangleVertexIds.at(fid * 3)));
+        }
+    }
+
+    GPP::ErrorCode HeatGeodesics::Factorize()
+    {
+        // face geometry and cotangent of each corner
+        mFaceNormals.resize(mTriangleCount);
+        mFaceAreas.resize(mTriangleCount);
+        mFaceCotangents.resize(mTriangleCount * 3);
+        mVertexAreas.assign(mVertexCount, 0);
+        std::vector<GPP::Int> faceCount(mVertexCount + 1, 0);
+        GPP::Real edgeLengthSum = 0;
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            const GPP::Int* vertexIds = &(mTriangleVertexIds.at(fid * 3));
+            GPP::Vector3 normal = (mVertexCoords.at(vertexIds[1]) - mVertexCoords.at(vertexIds[0])).CrossProduct(
+                mVertexCoords.at(vertexIds[2]) - mVertexCoords.at(vertexIds[0]));
+            GPP::Real doubleArea = normal.Normalise();
+            mFaceNormals.at(fid) = normal;
+            mFaceAreas.at(fid) = doubleArea / 2.0;
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Vector3 edge0 = mVertexCoords.at(vertexIds[(fvid + 1) % 3]) - mVertexCoords.at(vertexIds[fvid]);
+                GPP::Vector3 edge1 = mVertexCoords.at(vertexIds[(fvid + 2) % 3]) - mVertexCoords.at(vertexIds[fvid]);
+                GPP::Real crossLength = edge0.CrossProduct(edge1).Length();
+                GPP::Real cotangent = edge0 * edge1 / (crossLength > GPP::REAL_TOL ? crossLength : GPP::REAL_TOL);
+                // degenerate triangles would break the factorization
+                mFaceCotangents.at(fid * 3 + fvid) = std::max(-1.0e5, std::min(1.0e5, cotangent));
+                mVertexAreas.at(vertexIds[fvid]) += doubleArea / 6.0;
+                faceCount.at(vertexIds[fvid] + 1)++;
+                edgeLengthSum += edge0.Length();
+            }
+        }
+        GPP::Real meanEdgeLength = edgeLengthSum / (mTriangleCount * 3);
+        if (meanEdgeLength < GPP::REAL_TOL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        // t = h^2 as the heat method prescribes, the distances converge to the exact ones as the mesh is refined
+        mTimeStep = mTimeFactor * meanEdgeLength * meanEdgeLength;
+        mVertexFaceStart.resize(mVertexCount + 1);
+        mVertexFaceStart.at(0) = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexFaceStart.at(vid + 1) = mVertexFaceStart.at(vid) + faceCount.at(vid + 1);
+        }
+        mVertexFaceIds.resize(mTriangleCount * 3);
+        std::vector<GPP::Int> fillPos(mVertexFaceStart.begin(), mVertexFaceStart.end() - 1);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                mVertexFaceIds.at(fillPos.at(mTriangleVertexIds.at(fid * 3 + fvid))++) = fid;
+            }
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            // isolated vertex keeps the matrices positive definite
+            if (mVertexAreas.at(vid) < GPP::REAL_TOL)
+            {
+                mVertexAreas.at(vid) = mTimeStep * 1.0e-3;
+            }
+        }
+
+        std::vector<GPP::Int> columnStart, rowIds;
+        std::vector<GPP::Real> laplaceValues;
+        BuildLaplacian(columnStart, rowIds, laplaceValues);
+        std::vector<GPP::Real> heatValues(laplaceValues.size());
+        std::vector<GPP::Real> poissonValues(laplaceValues.size());
+        // the Poisson matrix is singular, a tiny mass term fixes the constant
+        GPP::Real regularization = 1.0e-6 / mTimeStep;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            for (GPP::Int p = columnStart.at(vid); p < columnStart.at(vid + 1); p++)
+            {
+                heatValues.at(p) = mTimeStep * laplaceValues.at(p);
+                poissonValues.at(p) = laplaceValues.at(p);
+                if (rowIds.at(p) == vid)
+                {
+                    heatValues.at(p) += mVertexAreas.at(vid);
+                    poissonValues.at(p) += regularization * mVertexAreas.at(vid);
+                }
+            }
+        }
+        std::vector<GPP::Int> perm;
+        ComputeFillReducingOrder(columnStart, rowIds, perm);
+        SparseLDLT* solvers[2] = {&mHeatSolver, &mPoissonSolver};
+        const std::vector<GPP::Real>* values[2] = {&heatValues, &poissonValues};
+        FactorizeTask factorizeTask(solvers, &columnStart, &rowIds, values, &perm);
+        MagicCore::ParallelTool::ParallelFor(2, &factorizeTask, 1);
+        if (factorizeTask.mResults[0] != GPP_NO_ERROR)
+        {
+            return factorizeTask.mResults[0];
+        }
+        return factorizeTask.mResults[1];
+    }
+
+    void HeatGeodesics::BuildLaplacian(std::vector<GPP::Int>& columnStart, std::vector<GPP::Int>& rowIds,
+        std::vector<GPP::Real>& values) const
+    {
+        // positive semi-definite cotangent Laplacian, L(i, j) = -(cot(a) + cot(b)) / 2
+        columnStart.resize(mVertexCount + 1);
+        columnStart.at(0) = 0;
+        rowIds.clear();
+        values.clear();
+        rowIds.reserve(mVertexCount * 7);
+        values.reserve(mVertexCount * 7);
+        std::vector<std::pair<GPP::Int, GPP::Real> > entries;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            entries.clear();
+            GPP::Real diagonal = 0;
+            for (GPP::Int p = mVertexFaceStart.at(vid); p < mVertexFaceStart.at(vid + 1); p++)
+            {
+                GPP::Int fid = mVertexFaceIds.at(p);
+                int localId = 0;
+                while (mTriangleVertexIds.at(fid * 3 + localId) != vid)
+                {
+                    localId++;
+                }
+                GPP::Int nextId = (localId + 1) % 3;
+                GPP::Int prevId = (localId + 2) % 3;
+                GPP::Real nextWeight = mFaceCotangents.at(fid * 3 + prevId) / 2.0;
+                GPP::Real prevWeight = mFaceCotangents.at(fid * 3 + nextId) / 2.0;
+                entries.push_back(std::pair<GPP::Int, GPP::Real>(mTriangleVertexIds.at(fid * 3 + nextId), -nextWeight));
+                entries.push_back(std::pair<GPP::Int, GPP::Real>(mTriangleVertexIds.at(fid * 3 + prevId), -prevWeight));
+                diagonal += nextWeight + prevWeight;
+            }
+            entries.push_back(std::pair<GPP::Int, GPP::Real>(vid, diagonal));
+            std::sort(entries.begin(), entries.end());
+            for (std::vector<std::pair<GPP::Int, GPP::Real> >::iterator itr = entries.begin(); itr != entries.end(); ++itr)
+            {
+                if (!rowIds.empty() && GPP::Int(rowIds.size()) > columnStart.at(vid) && rowIds.back() == itr->first)
+                {
+                    values.back() += itr->second;
+                }
+                else
+                {
+                    rowIds.push_back(itr->first);
+                    values.push_back(itr->second);
+                }
+            }
+            columnStart.at(vid + 1) = rowIds.size();
+        }
+    }
+
+    void HeatGeodesics::ComputeFillReducingOrder(const std::vector<GPP::Int>& columnStart, const std::vector<GPP::Int>& rowIds,
+        std::vector<GPP::Int>& perm) const
+    {
+        // geometric nested dissection: the separator of two halves is eliminated after both halves
+        std::vector<GPP::Int> vertexIds(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            vertexIds.at(vid) = vid;
+        }
+        std::vector<GPP::Int> sideFlags(mVertexCount, -1);
+        GPP::Int sideStamp = 0;
+        perm.clear();
+        perm.reserve(mVertexCount);
+        DissectVertices(vertexIds, columnStart, rowIds, sideFlags, sideStamp, perm);
+    }
+
+    void HeatGeodesics::DissectVertices(std::vector<GPP::Int>& vertexIds, const std::vector<GPP::Int>& columnStart,
+        const std::vector<GPP::Int>& rowIds, std::vector<GPP::Int>& sideFlags, GPP::Int& sideStamp, std::vector<GPP::Int>& perm) const
+    {
+        GPP::Int vertexCount = vertexIds.size();
+        if (vertexCount <= 64)
+        {
+            perm.insert(perm.end(), vertexIds.begin(), vertexIds.end());
+            return;
+        }
+        GPP::Vector3 bboxMin = mVertexCoords.at(vertexIds.at(0));
+        GPP::Vector3 bboxMax = bboxMin;
+        for (std::vector<GPP::Int>::iterator itr = vertexIds.begin(); itr != vertexIds.end(); ++itr)
+        {
+            const GPP::Vector3& coord = mVertexCoords.at(*itr);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bboxMin[axis] = std::min(bboxMin[axis], coord[axis]);
+                bboxMax[axis] = std::max(bboxMax[axis], coord[axis]);
+            }
+        }
+        GPP::Vector3 extent = bboxMax - bboxMin;
+        CoordAxisLess axisLess;
+        axisLess.mpCoords = &mVertexCoords;
+        axisLess.mAxis = (extent[0] > extent[1]) ? (extent[0] > extent[2] ? 0 : 2) : (extent[1] > extent[2] ? 1 : 2);
+        GPP::Int halfCount = vertexCount / 2;
+        std::nth_element(vertexIds.begin(), vertexIds.begin() + halfCount, vertexIds.end(), axisLess);
+        sideStamp++;
+        GPP::Int rightStamp = sideStamp;
+        for (GPP::Int vid = halfCount; vid < vertexCount; vid++)
+        {
+            sideFlags.at(vertexIds.at(vid)) = rightStamp;
+        }
+        std::vector<GPP::Int> leftIds, separatorIds;
+        leftIds.reserve(halfCount);
+        for (GPP::Int vid = 0; vid < halfCount; vid++)
+        {
+            GPP::Int curId = vertexIds.at(vid);
+            bool isSeparator = false;
+            for (GPP::Int p = columnStart.at(curId); p < columnStart.at(curId + 1); p++)
+            {
+                if (sideFlags.at(rowIds.at(p)) == rightStamp)
+                {
+                    isSeparator = true;
+                    break;
+                }
+            }
+            if (isSeparator)
+            {
+                separatorIds.push_back(curId);
+            }
+            else
+            {
+                leftIds.push_back(curId);
+            }
+        }
+        std::vector<GPP::Int> rightIds(vertexIds.begin() + halfCount, vertexIds.end());
+        std::vector<GPP::Int>().swap(vertexIds);
+        DissectVertices(leftIds, columnStart, rowIds, sideFlags, sideStamp, perm);
+        DissectVertices(rightIds, columnStart, rowIds, sideFlags, sideStamp, perm);
+        perm.insert(perm.end(), separatorIds.begin(), separatorIds.end());
+    }
+
+    GPP::Vector3 HeatGeodesics::ComputeFaceGradient(GPP::Int faceId, const std::vector<GPP::Real>& fields) const
+    {
+        const GPP::Int* vertexIds = &(mTriangleVertexIds.at(faceId * 3));
+        const GPP::Vector3& normal = mFaceNormals.at(faceId);
+        GPP::Vector3 gradient(0, 0, 0);
+        for (int fvid = 0; fvid < 3; fvid++)
+        {
+            GPP::Vector3 oppositeEdge = mVertexCoords.at(vertexIds[(fvid + 2) % 3]) - mVertexCoords.at(vertexIds[(fvid + 1) % 3]);
+            gradient += normal.CrossProduct(oppositeEdge) * fields.at(vertexIds[fvid]);
+        }
+        GPP::Real area = mFaceAreas.at(faceId);
+        if (area < GPP::REAL_TOL)
+        {
+            return GPP::Vector3(0, 0, 0);
+        }
+        return gradient / (2.0 * area);
+    }
+
+    GPP::ErrorCode HeatGeodesics::ComputeDistanceField(const std::vector<GPP::Int>& sourceIds, std::vector<GPP::Real>& distances) const
+    {
+        if (!IsReady())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        if (sourceIds.empty())
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        // 1. heat flow: (M + tL) u = delta
+        std::vector<GPP::Real> heats(mVertexCount, 0);
+        for (std::vector<GPP::Int>::const_iterator itr = sourceIds.begin(); itr != sourceIds.end(); ++itr)
+        {
+            if (*itr < 0 || *itr >= mVertexCount)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            heats.at(*itr) = 1.0;
+        }
+        mHeatSolver.Solve(heats);
+        // 2. normalized heat gradient and its divergence
+        std::vector<GPP::Real> divergences(mVertexCount, 0);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            GPP::Vector3 direction = ComputeFaceGradient(fid, heats) * -1.0;
+            if (direction.Normalise() < GPP::REAL_TOL * GPP::REAL_TOL)
+            {
+                continue;
+            }
+            const GPP::Int* vertexIds = &(mTriangleVertexIds.at(fid * 3));
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int nextId = (fvid + 1) % 3;
+                GPP::Int prevId = (fvid + 2) % 3;
+                const GPP::Vector3& curCoord = mVertexCoords.at(vertexIds[fvid]);
+                GPP::Vector3 nextEdge = mVertexCoords.at(vertexIds[nextId]) - curCoord;
+                GPP::Vector3 prevEdge = mVertexCoords.at(vertexIds[prevId]) - curCoord;
+                divergences.at(vertexIds[fvid]) += (mFaceCotangents.at(fid * 3 + prevId) * (nextEdge * direction) +
+                    mFaceCotangents.at(fid * 3 + nextId) * (prevEdge * direction)) / 2.0;
+            }
+        }
+        // 3. Poisson: L phi = -div(X), since L is the negative Laplace-Beltrami operator
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            divergences.at(vid) = -divergences.at(vid);
+        }
+        mPoissonSolver.Solve(divergences);
+        GPP::Real minDistance = divergences.at(sourceIds.at(0));
+        for (std::vector<GPP::Int>::const_iterator itr = sourceIds.begin(); itr != sourceIds.end(); ++itr)
+        {
+            minDistance = std::min(minDistance, divergences.at(*itr));
+        }
+        distances.resize(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            distances.at(vid) = std::max(GPP::Real(0), divergences.at(vid) - minDistance);
+        }
+        for (std::vector<GPP::Int>::const_iterator itr = sourceIds.begin(); itr != sourceIds.end(); ++itr)
+        {
+            distances.at(*itr) = 0;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int HeatGeodesics::FindAdjacentFace(GPP::Int vertexId0, GPP::Int vertexId1, GPP::Int excludeFaceId) const
+    {
+        for (GPP::Int p = mVertexFaceStart.at(vertexId0); p < mVertexFaceStart.at(vertexId0 + 1); p++)
+        {
+            GPP::Int fid = mVertexFaceIds.at(p);
+            if (fid == excludeFaceId)
+            {
+                continue;
+            }
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                if (mTriangleVertexIds.at(fid * 3 + fvid) == vertexId1)
+                {
+                    return fid;
+                }
+            }
+        }
+        return -1;
+    }
+
+    GPP::ErrorCode HeatGeodesics::TracePath(const std::vector<GPP::Int>& sourceIds, const std::vector<GPP::Real>& distances,
+        GPP::Int targetId, std::vector<GPP::Vector3>& pathCoords, GPP::Real& pathLength, std::vector<GPP::PointOnEdge>* pathInfos) const
+    {
+        if (!IsReady())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        if (targetId < 0 || targetId >= mVertexCount || distances.size() != mVertexCount || sourceIds.empty())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<bool> isSource(mVertexCount, false);
+        for (std::vector<GPP::Int>::const_iterator itr = sourceIds.begin(); itr != sourceIds.end(); ++itr)
+        {
+            isSource.at(*itr) = true;
+        }
+        std::vector<GPP::PointOnEdge> pointInfos;
+        pointInfos.push_back(GPP::PointOnEdge(targetId, -1, 1.0));
+        // current point is either a vertex (edgeIds[1] == -1) or a point on edge with weight on edgeIds[0]
+        GPP::Int edgeIds[2] = {targetId, -1};
+        GPP::Real edgeWeight = 1.0;
+        GPP::Int lastFaceId = -1;
+        GPP::Int maxStepCount = mVertexCount + mTriangleCount * 2;
+        const GPP::Real weightTol = 1.0e-6;
+        for (GPP::Int step = 0; step < maxStepCount; step++)
+        {
+            if (edgeIds[1] == -1)
+            {
+                GPP::Int curId = edgeIds[0];
+                if (isSource.at(curId))
+                {
+                    break;
+                }
+                GPP::Int nextVertexId = -1;
+                GPP::Int bestFaceId = -1;
+                GPP::Real bestSlope = 0;
+                GPP::PointOnEdge bestPoint;
+                GPP::Real minNeighborDistance = distances.at(curId);
+                const GPP::Vector3& curCoord = mVertexCoords.at(curId);
+                for (GPP::Int p = mVertexFaceStart.at(curId); p < mVertexFaceStart.at(curId + 1); p++)
+                {
+                    GPP::Int fid = mVertexFaceIds.at(p);
+                    const GPP::Int* vertexIds = &(mTriangleVertexIds.at(fid * 3));
+                    int localId = (vertexIds[0] == curId) ? 0 : (vertexIds[1] == curId ? 1 : 2);
+                    GPP::Int vertexIdB = vertexIds[(localId + 1) % 3];
+                    GPP::Int vertexIdC = vertexIds[(localId + 2) % 3];
+                    for (int nid = 0; nid < 2; nid++)
+                    {
+                        GPP::Int neighborId = (nid == 0) ? vertexIdB : vertexIdC;
+                        if (isSource.at(neighborId))
+                        {
+                            nextVertexId = neighborId;
+                            minNeighborDistance = -1;
+                        }
+                        else if (distances.at(neighborId) < minNeighborDistance)
+                        {
+                            nextVertexId = neighborId;
+                            minNeighborDistance = distances.at(neighborId);
+                        }
+                    }
+                    // descent direction inside the wedge of curId: dir = alpha * edgeB + beta * edgeC with alpha, beta >= 0
+                    GPP::Vector3 direction = ComputeFaceGradient(fid, distances) * -1.0;
+                    GPP::Real slope = direction.Length();
+                    if (slope <= bestSlope)
+                    {
+                        continue;
+                    }
+                    GPP::Vector3 edgeB = mVertexCoords.at(vertexIdB) - curCoord;
+                    GPP::Vector3 edgeC = mVertexCoords.at(vertexIdC) - curCoord;
+                    GPP::Real gramBB = edgeB * edgeB, gramBC = edgeB * edgeC, gramCC = edgeC * edgeC;
+                    GPP::Real det = gramBB * gramCC - gramBC * gramBC;
+                    if (det < GPP::REAL_TOL)
+                    {
+                        continue;
+                    }
+                    GPP::Real projB = edgeB * direction, projC = edgeC * direction;
+                    GPP::Real alpha = (gramCC * projB - gramBC * projC) / det;
+                    GPP::Real beta = (gramBB * projC - gramBC * projB) / det;
+                    if (alpha < 0 || beta < 0 || alpha + beta < GPP::REAL_TOL)
+                    {
+                        continue;
+                    }
+                    bestSlope = slope;
+                    bestFaceId = fid;
+                    bestPoint = GPP::PointOnEdge(vertexIdB, vertexIdC, alpha / (alpha + beta));
+                }
+                if (nextVertexId != -1 && isSource.at(nextVertexId))
+                {
+                    edgeIds[0] = nextVertexId;
+                    edgeIds[1] = -1;
+                    lastFaceId = -1;
+                }
+                else if (bestFaceId != -1)
+                {
+                    edgeIds[0] = bestPoint.mVertexIdStart;
+                    edgeIds[1] = bestPoint.mVertexIdEnd;
+                    edgeWeight = bestPoint.mWeight;
+                    lastFaceId = bestFaceId;
+                }
+                else if (nextVertexId != -1)
+                {
+                    // no descent direction in any face, walk along the lowest edge
+                    edgeIds[0] = nextVertexId;
+                    edgeIds[1] = -1;
+                    lastFaceId = -1;
+                }
+                else
+                {
+                    // local minimum of a poor field
+                    break;
+                }
+            }
+            else
+            {
+                GPP::Int faceId = FindAdjacentFace(edgeIds[0], edgeIds[1], lastFaceId);
+                GPP::Int lowerId = distances.at(edgeIds[0]) < distances.at(edgeIds[1]) ? edgeIds[0] : edgeIds[1];
+                if (faceId == -1)
+                {
+                    edgeIds[0] = lowerId;
+                    edgeIds[1] = -1;
+                }
+                else
+                {
+                    const GPP::Int* vertexIds = &(mTriangleVertexIds.at(faceId * 3));
+                    GPP::Int vertexIdC = vertexIds[0];
+                    for (int fvid = 0; fvid < 3; fvid++)
+                    {
+                        if (vertexIds[fvid] != edgeIds[0] && vertexIds[fvid] != edgeIds[1])
+                        {
+                            vertexIdC = vertexIds[fvid];
+                        }
+                    }
+                    // local coordinates: point = coordC + alpha * (coordA - coordC) + beta * (coordB - coordC)
+                    const GPP::Vector3& coordC = mVertexCoords.at(vertexIdC);
+                    GPP::Vector3 edgeA = mVertexCoords.at(edgeIds[0]) - coordC;
+                    GPP::Vector3 edgeB = mVertexCoords.at(edgeIds[1]) - coordC;
+                    GPP::Vector3 direction = ComputeFaceGradient(faceId, distances) * -1.0;
+                    GPP::Real gramAA = edgeA * edgeA, gramAB = edgeA * edgeB, gramBB = edgeB * edgeB;
+                    GPP::Real det = gramAA * gramBB - gramAB * gramAB;
+                    GPP::Real dirAlpha = 0, dirBeta = 0;
+                    if (det > GPP::REAL_TOL)
+                    {
+                        GPP::Real projA = edgeA * direction, projB = edgeB * direction;
+                        dirAlpha = (gramBB * projA - gramAB * projB) / det;
+                        dirBeta = (gramAA * projB - gramAB * projA) / det;
+                    }
+                    if (isSource.at(vertexIdC))
+                    {
+                        edgeIds[0] = vertexIdC;
+                        edgeIds[1] = -1;
+                    }
+                    else if (dirAlpha + dirBeta > -GPP::REAL_TOL)
+                    {
+                        // the field does not flow into faceId, slide to the lower end of the edge
+                        edgeIds[0] = lowerId;
+                        edgeIds[1] = -1;
+                    }
+                    else
+                    {
+                        GPP::Real alpha = edgeWeight;
+                        GPP::Real beta = 1.0 - edgeWeight;
+                        GPP::Real stepAlpha = dirAlpha < 0 ? -alpha / dirAlpha : GPP::REAL_LARGE;
+                        GPP::Real stepBeta = dirBeta < 0 ? -beta / dirBeta : GPP::REAL_LARGE;
+                        if (stepAlpha < stepBeta)
+                        {
+                            edgeIds[0] = edgeIds[1];
+                            edgeWeight = beta + stepAlpha * dirBeta;
+                        }
+                        else
+                        {
+                            edgeWeight = alpha + stepBeta * dirAlpha;
+                        }
+                        edgeIds[1] = vertexIdC;
+                        lastFaceId = faceId;
+                        if (edgeWeight > 1.0 - weightTol)
+                        {
+                            edgeIds[1] = -1;
+                        }
+                        else if (edgeWeight < weightTol)
+                        {
+                            edgeIds[0] = vertexIdC;
+                            edgeIds[1] = -1;
+                        }
+                    }
+                }
+            }
+            if (edgeIds[1] == -1)
+            {
+                edgeWeight = 1.0;
+                lastFaceId = -1;
+            }
+            pointInfos.push_back(GPP::PointOnEdge(edgeIds[0], edgeIds[1], edgeWeight));
+        }
+        if (edgeIds[1] != -1 || !isSource.at(edgeIds[0]))
+        {
+            return GPP_INVALID_RESULT;
+        }
+        std::reverse(pointInfos.begin(), pointInfos.end());
+        pathCoords.resize(pointInfos.size());
+        pathLength = 0;
+        for (GPP::Int pid = 0; pid < GPP::Int(pointInfos.size()); pid++)
+        {
+            const GPP::PointOnEdge& pointInfo = pointInfos.at(pid);
+            if (pointInfo.mVertexIdEnd == -1)
+            {
+                pathCoords.at(pid) = mVertexCoords.at(pointInfo.mVertexIdStart);
+            }
+            else
+            {
+                pathCoords.at(pid) = mVertexCoords.at(pointInfo.mVertexIdStart) * pointInfo.mWeight +
+                    mVertexCoords.at(pointInfo.mVertexIdEnd) * (1.0 - pointInfo.mWeight);
+            }
+            if (pid > 0)
+            {
+                pathLength += (pathCoords.at(pid) - pathCoords.at(pid - 1)).Length();
+            }
+        }
+        if (pathInfos)
+        {
+            pathInfos->swap(pointInfos);
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode HeatGeodesics::ComputeGeodesics(const std::vector<GPP::Int>& sectionVertexIds, bool isSectionClose,
+        std::vector<GPP::Vector3>& pathCoords, GPP::Real& distance, std::vector<GPP::PointOnEdge>* pathInfos) const
+    {
+        if (!IsReady())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        if (sectionVertexIds.size() < 2)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        pathCoords.clear();
+        if (pathInfos)
+        {
+            pathInfos->clear();
+        }
+        distance = 0;
+        GPP::Int sectionCount = isSectionClose ? sectionVertexIds.size() : sectionVertexIds.size() - 1;
+        std::vector<GPP::Int> sourceIds(1);
+        std::vector<GPP::Real> distances;
+        std::vector<GPP::Vector3> sectionCoords;
+        std::vector<GPP::PointOnEdge> sectionInfos;
+        for (GPP::Int sid = 0; sid < sectionCount; sid++)
+        {
+            sourceIds.at(0) = sectionVertexIds.at(sid);
+            GPP::ErrorCode res = ComputeDistanceField(sourceIds, distances);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            GPP::Real sectionLength = 0;
+            res = TracePath(sourceIds, distances, sectionVertexIds.at((sid + 1) % sectionVertexIds.size()),
+                sectionCoords, sectionLength, &sectionInfos);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            distance += sectionLength;
+            // the first point of a section is the last point of the previous one
+            GPP::Int startId = pathCoords.empty() ? 0 : 1;
+            pathCoords.insert(pathCoords.end(), sectionCoords.begin() + startId, sectionCoords.end());
+            if (pathInfos)
+            {
+                pathInfos->insert(pathInfos->end(), sectionInfos.begin() + startId, sectionInfos.end());
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode HeatGeodesics::CheckAccuracy(const std::vector<GPP::Int>& sectionVertexIds, bool isSectionClose,
+        GPP::Real& heatDistance, GPP::Real& exactDistance, GPP::Real& relativeError) const
+    {
+        if (!IsReady() || mpTriMesh == NULL || mpTriMesh->GetVertexCount() != mVertexCount)
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        std::vector<GPP::Vector3> pathCoords;
+        GPP::ErrorCode res = ComputeGeodesics(sectionVertexIds, isSectionClose, pathCoords, heatDistance);
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        res = GPP::MeasureMesh::ComputeExactGeodesics(mpTriMesh, sectionVertexIds, isSectionClose, pathCoords, exactDistance, NULL);
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        relativeError = exactDistance > GPP::REAL_TOL ? fabs(heatDistance - exactDistance) / exactDistance : 0;
+        return GPP_NO_ERROR;
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Sparse LDL^T factorization of a symmetric positive definite matrix with a fill reducing permutation.
+    // Several matrices with the same pattern share one symbolic analysis.
+    class SparseLDLT
+    {
+    public:
+        SparseLDLT();
+        ~SparseLDLT();
+
+        // columnStart, rowIds: full symmetric pattern in CSC format, perm: new id -> old id
+        void AnalysePattern(const std::vector<GPP::Int>& columnStart, const std::vector<GPP::Int>& rowIds,
+            const std::vector<GPP::Int>& perm);
+        GPP::ErrorCode Factorize(const std::vector<GPP::Int>& columnStart, const std::vector<GPP::Int>& rowIds,
+            const std::vector<GPP::Real>& values);
+        // rhs is overwritten by the solution
+        void Solve(std::vector<GPP::Real>& rhs) const;
+        GPP::Int GetNonZeroCount(void) const;
+        void Clear(void);
+
+    private:
+        GPP::Int mDimension;
+        std::vector<GPP::Int> mPerm;
+        std::vector<GPP::Int> mPermInv;
+        std::vector<GPP::Int> mParent;
+        std::vector<GPP::Int> mLowerStart;
+        std::vector<GPP::Int> mLowerRowIds;
+        std::vector<GPP::Real> mLowerValues;
+        std::vector<GPP::Real> mDiagonal;
+    };
+
+    // Heat method geodesic distance (Crane et al. 2013) on a triangle mesh.
+    // The heat flow matrix M + tL and the Poisson matrix L are factorized once, every distance field query
+    // costs two back substitutions, so picking geodesic paths on a large mesh is interactive.
+    // The service keeps a copy of the mesh data and becomes invalid when the mesh is modified.
+    // USAGE: 1. heatGeodesics.InitAsync(triMesh);  // or Init(triMesh) to factorize in the calling thread
+    //        2. if (heatGeodesics.IsReady()) heatGeodesics.ComputeGeodesics(markIds, false, pathCoords, distance);
+    class HeatGeodesics
+    {
+    public:
+        HeatGeodesics();
+        ~HeatGeodesics();
+
+        // The heat flow time step is t = timeFactor * h * h, h is the mean edge length. Default is 1.
+        // A larger factor smooths the distances but lets the heat reach farther on a fine mesh. Set it before Init
+        void SetTimeFactor(GPP::Real timeFactor);
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh);
+        // Copy mesh data and factorize in a background thread. Queries return GPP_NOT_INITIALIZED until it is ready
+        GPP::ErrorCode InitAsync(const GPP::ITriMesh* triMesh);
+        bool IsReady(void) const;
+        // Whether it is (being) built from triMesh and the mesh size is unchanged
+        bool IsBuiltFrom(const GPP::ITriMesh* triMesh) const;
+        void WaitReady(void);
+        void Clear(void);
+
+        // Distance field from one or more source vertices, distances.size() == vertexCount
+        GPP::ErrorCode ComputeDistanceField(const std::vector<GPP::Int>& sourceIds, std::vector<GPP::Real>& distances) const;
+        // Descend the distance field from targetId until a source vertex is reached.
+        // pathCoords goes from the source to targetId. For a vertex point in pathInfos, mVertexIdEnd == -1
+        GPP::ErrorCode TracePath(const std::vector<GPP::Int>& sourceIds, const std::vector<GPP::Real>& distances, GPP::Int targetId,
+            std::vector<GPP::Vector3>& pathCoords, GPP::Real& pathLength, std::vector<GPP::PointOnEdge>* pathInfos = NULL) const;
+        // Same parameters as GPP::MeasureMesh::ComputeExactGeodesics
+        GPP::ErrorCode ComputeGeodesics(const std::vector<GPP::Int>& sectionVertexIds, bool isSectionClose,
+            std::vector<GPP::Vector3>& pathCoords, GPP::Real& distance, std::vector<GPP::PointOnEdge>* pathInfos = NULL) const;
+        // Compare with GPP::MeasureMesh::ComputeExactGeodesics on the same marks, relativeError = |heat - exact| / exact
+        GPP::ErrorCode CheckAccuracy(const std::vector<GPP::Int>& sectionVertexIds, bool isSectionClose,
+            GPP::Real& heatDistance, GPP::Real& exactDistance, GPP::Real& relativeError) const;
+
+    private:
+        void CopyMeshData(const GPP::ITriMesh* triMesh);
+        GPP::ErrorCode Factorize(void);
+        void BuildLaplacian(std::vector<GPP::Int>& columnStart, std::vector<GPP::Int>& rowIds, std::vector<GPP::Real>& values) const;
+        void ComputeFillReducingOrder(const std::vector<GPP::Int>& columnStart, const std::vector<GPP::Int>& rowIds,
+            std::vector<GPP::Int>& perm) const;
+        void DissectVertices(std::vector<GPP::Int>& vertexIds, const std::vector<GPP::Int>& columnStart, const std::vector<GPP::Int>& rowIds,
+            std::vector<GPP::Int>& sideFlags, GPP::Int& sideStamp, std::vector<GPP::Int>& perm) const;
+        GPP::Vector3 ComputeFaceGradient(GPP::Int faceId, const std::vector<GPP::Real>& fields) const;
+        GPP::Int FindAdjacentFace(GPP::Int vertexId0, GPP::Int vertexId1, GPP::Int excludeFaceId) const;
+        static unsigned __stdcall FactorizeThread(void* arg);
+
+    private:
+        enum FactorState
+        {
+            FACTOR_NONE = 0,
+            FACTOR_RUNNING,
+            FACTOR_READY,
+            FACTOR_FAILED
+        };
+
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mVertexCount;
+        GPP::Int mTriangleCount;
+        std::vector<GPP::Vector3> mVertexCoords;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        std::vector<GPP::Vector3> mFaceNormals;
+        std::vector<GPP::Real> mFaceAreas;
+        std::vector<GPP::Real> mFaceCotangents;
+        std::vector<GPP::Real> mVertexAreas;
+        std::vector<GPP::Int> mVertexFaceStart;
+        std::vector<GPP::Int> mVertexFaceIds;
+        GPP::Real mTimeFactor;
+        GPP::Real mTimeStep;
+        SparseLDLT mHeatSolver;
+        SparseLDLT mPoissonSolver;
+        volatile long mFactorState;
+        void* mpFactorThread;
+    };
+}
@@ -3,12 +3,14 @@
 #include "HomepageUI.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "ModelExporter.h"
 #include "PointShopApp.h"
 #include "MeshShopApp.h"
 #include "RegistrationApp.h"
 #include "MeasureApp.h"
 #include "ReliefApp.h"
 #include "DepthVideoApp.h"
+#include "AppApi.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
@@ -126,6 +128,19 @@ namespace MagicApp
         {
             AppManager::Get()->EnterApp(new DepthVideoApp, "DepthVideoApp");
         }
+        else if (arg.key == OIS::KC_L)
+        {
+            AppApi::ListModels();
+        }
+        else if (arg.key == OIS::KC_M)
+        {
+            // Stash the current mesh and show the next open one
+            AppApi::SwitchNextMesh();
+        }
+        else if (arg.key == OIS::KC_P)
+        {
+            AppApi::SwitchNextPointCloud();
+        }
         else if (arg.key == OIS::KC_U)
         {
 #if DEVELOPSTATE
@@ -156,7 +171,7 @@ namespace MagicApp
             mpDumpInfo = GPP::DumpManager::Get()->GetDumpInstance(dumpApiName);
             if (mpDumpInfo == NULL)
             {
-                MessageBox(NULL, "dumpļʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "dump文件打开失败", "温馨提示", MB_OK);
                 return;
             }
             mpDumpInfo->LoadDumpFile(fileName);
@@ -218,18 +233,18 @@ namespace MagicApp
     {
         if (mpDumpInfo == NULL)
         {
-            MessageBox(NULL, "ȵdumpļ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入dump文件", "温馨提示", MB_OK);
             return;
         }
         GPP::ErrorCode res = mpDumpInfo->Run();
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "dumpļִʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump文件执行失败", "温馨提示", MB_OK);
             //return;
         }
         else
         {
-            MessageBox(NULL, "dumpļִгɹ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump文件执行成功", "温馨提示", MB_OK);
         }
 
         if (mpDumpInfo->GetPointCloud(0) != NULL)
@@ -250,7 +265,7 @@ namespace MagicApp
             UpdateModelRendering();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(copiedTriMesh) == false)
             {
-                MessageBox(NULL, "зνṹ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格有非流形结构", "温馨提示", MB_OK);
             }
         }
     }
@@ -299,7 +314,7 @@ namespace MagicApp
             ModelManager::Get()->ClearMesh();
             if (ModelManager::Get()->ImportPointCloud(fileName) == false)
             {
-                MessageBox(NULL, "Ƶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败", "温馨提示", MB_OK);
                 return;
             }
             mpUI->SetModelInfo(ModelManager::Get()->GetPointCloud()->GetPointCount(), 0);
@@ -316,7 +331,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -337,7 +352,7 @@ namespace MagicApp
                 size_t dotPos = fileName.rfind('.');
                 if (dotPos == std::string::npos)
                 {
-                    MessageBox(NULL, "ļ׺", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "请输入文件后缀名", "温馨提示", MB_OK);
                     return;
                 }
                 GPP::ErrorCode res = GPP_NO_ERROR;
@@ -346,16 +361,16 @@ namespace MagicApp
                     GPP::Real scaleValue = ModelManager::Get()->GetScaleValue();
                     GPP::Vector3 objCenterCoord = ModelManager::Get()->GetObjCenterCoord();
                     triMesh->UnifyCoords(1.0 / scaleValue, objCenterCoord * (-scaleValue));
-                    res = GPP::Parser::ExportTriMesh(fileName, triMesh);
+                    res = ModelExporter::Get()->ExportTriMesh(fileName, triMesh);
                     triMesh->UnifyCoords(scaleValue, objCenterCoord);
                 }
                 else
                 {
-                    res = GPP::Parser::ExportTriMesh(fileName, triMesh);
+                    res = ModelExporter::Get()->ExportTriMesh(fileName, triMesh);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "񵼳ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格导出失败", "温馨提示", MB_OK);
                 }
             }
         }
@@ -371,7 +386,7 @@ namespace MagicApp
                     size_t dotPos = fileName.rfind('.');
                     if (dotPos == std::string::npos)
                     {
-                        MessageBox(NULL, "ļ׺", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "请输入文件后缀名", "温馨提示", MB_OK);
                         return;
                     }
                     GPP::ErrorCode res = GPP_NO_ERROR;
@@ -380,16 +395,16 @@ namespace MagicApp
                         GPP::Real scaleValue = ModelManager::Get()->GetScaleValue();
                         GPP::Vector3 objCenterCoord = ModelManager::Get()->GetObjCenterCoord();
                         pointCloud->UnifyCoords(1.0 / scaleValue, objCenterCoord * (-scaleValue));
-                        res = GPP::Parser::ExportPointCloud(fileName, pointCloud);
+                        res = ModelExporter::Get()->ExportPointCloud(fileName, pointCloud);
                         pointCloud->UnifyCoords(scaleValue, objCenterCoord);
                     }
                     else
                     {
-                        res = GPP::Parser::ExportPointCloud(fileName, pointCloud);
+                        res = ModelExporter::Get()->ExportPointCloud(fileName, pointCloud);
                     }
                     if (res != GPP_NO_ERROR)
                     {
-                        MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "导出点云失败", "温馨提示", MB_OK);
                     }
                 }
             }
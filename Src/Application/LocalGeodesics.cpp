@@ -0,0 +1,335 @@
+#include "LocalGeodesics.h"
+#include <queue>
+#include <functional>
+
+namespace MagicApp
+{
+    static const GPP::Real INIT_REGION_SCALE = 1.25;
+    static const GPP::Real REGION_EXPAND_SCALE = 1.5;
+    static const int MAX_REGION_EXPAND_COUNT = 5;
+
+    LocalGeodesics::LocalGeodesics() :
+        mpTriMesh(NULL),
+        mVertexCount(0),
+        mTriangleCount(0),
+        mVertexFaceStart(),
+        mVertexFaceIds(),
+        mStartDistances(),
+        mEndDistances(),
+        mStartTouchedIds(),
+        mEndTouchedIds(),
+        mFaceFlags(),
+        mLastRegionVertexCount(0)
+    {
+    }
+
+    LocalGeodesics::~LocalGeodesics()
+    {
+    }
+
+    GPP::ErrorCode LocalGeodesics::Init(const GPP::ITriMesh* triMesh)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetTriangleCount() < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mpTriMesh = triMesh;
+        mVertexCount = triMesh->GetVertexCount();
+        mTriangleCount = triMesh->GetTriangleCount();
+        mVertexFaceStart.assign(mVertexCount + 1, 0);
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                mVertexFaceStart.at(vertexIds[fvid] + 1)++;
+            }
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexFaceStart.at(vid + 1) += mVertexFaceStart.at(vid);
+        }
+        mVertexFaceIds.resize(mTriangleCount * 3);
+        std::vector<GPP::Int> fillPos(mVertexFaceStart.begin(), mVertexFaceStart.end() - 1);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                mVertexFaceIds.at(fillPos.at(vertexIds[fvid])++) = fid;
+            }
+        }
+        mStartDistances.assign(mVertexCount, GPP::REAL_LARGE);
+        mEndDistances.assign(mVertexCount, GPP::REAL_LARGE);
+        mFaceFlags.assign(mTriangleCount, 0);
+        return GPP_NO_ERROR;
+    }
+
+    bool LocalGeodesics::IsBuiltFrom(const GPP::ITriMesh* triMesh) const
+    {
+        return triMesh != NULL && mpTriMesh == triMesh && mVertexCount == triMesh->GetVertexCount() &&
+            mTriangleCount == triMesh->GetTriangleCount();
+    }
+
+    void LocalGeodesics::Clear()
+    {
+        mpTriMesh = NULL;
+        mVertexCount = 0;
+        mTriangleCount = 0;
+        mVertexFaceStart.clear();
+        mVertexFaceIds.clear();
+        mStartDistances.clear();
+        mEndDistances.clear();
+        mStartTouchedIds.clear();
+        mEndTouchedIds.clear();
+        mFaceFlags.clear();
+        mLastRegionVertexCount = 0;
+    }
+
+    GPP::Int LocalGeodesics::GetLastRegionVertexCount() const
+    {
+        return mLastRegionVertexCount;
+    }
+
+    GPP::ErrorCode LocalGeodesics::ComputeExactGeodesics(const std::vector<GPP::Int>& sectionVertexIds, bool isSectionClose,
+        std::vector<GPP::Vector3>& pathPointPositions, GPP::Real& distance, std::vector<GPP::PointOnEdge>* pathPointInfos)
+    {
+        if (mpTriMesh == NULL)
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        if (sectionVertexIds.size() < 2)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        for (std::vector<GPP::Int>::const_iterator itr = sectionVertexIds.begin(); itr != sectionVertexIds.end(); ++itr)
+        {
+            if (*itr < 0 || *itr >= mVertexCount)
+            {
+                return GPP_INVALID_INPUT;
+            }
+        }
+        pathPointPositions.clear();
+        if (pathPointInfos)
+        {
+            pathPointInfos->clear();
+        }
+        distance = 0;
+        GPP::Int sectionCount = isSectionClose ? sectionVertexIds.size() : sectionVertexIds.size() - 1;
+        std::vector<GPP::Vector3> sectionPositions;
+        std::vector<GPP::PointOnEdge> sectionInfos;
+        for (GPP::Int sid = 0; sid < sectionCount; sid++)
+        {
+            GPP::Real sectionDistance = 0;
+            GPP::ErrorCode res = ComputeSectionGeodesics(sectionVertexIds.at(sid), sectionVertexIds.at((sid + 1) % sectionVertexIds.size()),
+                sectionPositions, sectionDistance, sectionInfos);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            distance += sectionDistance;
+            // the first point of a section is the last point of the previous one
+            GPP::Int startId = pathPointPositions.empty() ? 0 : 1;
+            if (GPP::Int(sectionPositions.size()) > startId)
+            {
+                pathPointPositions.insert(pathPointPositions.end(), sectionPositions.begin() + startId, sectionPositions.end());
+            }
+            if (pathPointInfos && GPP::Int(sectionInfos.size()) > startId)
+            {
+                pathPointInfos->insert(pathPointInfos->end(), sectionInfos.begin() + startId, sectionInfos.end());
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode LocalGeodesics::ComputeSectionGeodesics(GPP::Int startId, GPP::Int endId, std::vector<GPP::Vector3>& pathPointPositions,
+        GPP::Real& distance, std::vector<GPP::PointOnEdge>& pathPointInfos)
+    {
+        pathPointPositions.clear();
+        pathPointInfos.clear();
+        distance = 0;
+        if (startId == endId)
+        {
+            pathPointPositions.push_back(mpTriMesh->GetVertexCoord(startId));
+            pathPointInfos.push_back(GPP::PointOnEdge(startId, -1, 1.0));
+            return GPP_NO_ERROR;
+        }
+        GPP::Real graphDistance = GrowGraphDistance(startId, endId, GPP::REAL_LARGE, mStartDistances, mStartTouchedIds);
+        ResetGraphDistance(mStartDistances, mStartTouchedIds);
+        if (graphDistance >= GPP::REAL_LARGE)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Real regionScale = INIT_REGION_SCALE;
+        std::vector<GPP::Int> regionFaceIds;
+        std::vector<GPP::Int> subSectionIds(2);
+        GPP::Int vertexIds[3];
+        for (int expandId = 0; expandId < MAX_REGION_EXPAND_COUNT; expandId++)
+        {
+            // region: dist(start, v) + dist(v, end) <= regionScale * dist(start, end)
+            GPP::Real maxDistance = graphDistance * regionScale;
+            GrowGraphDistance(startId, -1, maxDistance, mStartDistances, mStartTouchedIds);
+            GrowGraphDistance(endId, -1, maxDistance, mEndDistances, mEndTouchedIds);
+            regionFaceIds.clear();
+            mLastRegionVertexCount = 0;
+            for (std::vector<GPP::Int>::iterator itr = mStartTouchedIds.begin(); itr != mStartTouchedIds.end(); ++itr)
+            {
+                if (mStartDistances.at(*itr) + mEndDistances.at(*itr) > maxDistance)
+                {
+                    continue;
+                }
+                mLastRegionVertexCount++;
+                for (GPP::Int p = mVertexFaceStart.at(*itr); p < mVertexFaceStart.at(*itr + 1); p++)
+                {
+                    GPP::Int fid = mVertexFaceIds.at(p);
+                    if (mFaceFlags.at(fid) != 0)
+                    {
+                        continue;
+                    }
+                    mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+                    bool isInRegion = true;
+                    for (int fvid = 0; fvid < 3; fvid++)
+                    {
+                        if (mStartDistances.at(vertexIds[fvid]) + mEndDistances.at(vertexIds[fvid]) > maxDistance)
+                        {
+                            isInRegion = false;
+                            break;
+                        }
+                    }
+                    if (isInRegion)
+                    {
+                        mFaceFlags.at(fid) = 1;
+                        regionFaceIds.push_back(fid);
+                    }
+                }
+            }
+            bool isWholeMesh = (GPP::Int(regionFaceIds.size()) == mTriangleCount);
+            GPP::SubTriangleList subTriangles(mpTriMesh, regionFaceIds, GPP::SubTriangleList::BUILD_SUBTRIANGLE_LIST_TYPE_BY_TRIANGLES);
+            subSectionIds.at(0) = subTriangles.VertexIdToSubTriMeshId(startId);
+            subSectionIds.at(1) = subTriangles.VertexIdToSubTriMeshId(endId);
+            GPP::ErrorCode res = GPP_INVALID_INPUT;
+            if (subSectionIds.at(0) >= 0 && subSectionIds.at(1) >= 0)
+            {
+                res = GPP::MeasureMesh::_ComputeExactGeodesics(&subTriangles, subSectionIds, false, pathPointPositions, distance, &pathPointInfos);
+            }
+            bool isTouchBoundary = false;
+            if (res == GPP_NO_ERROR)
+            {
+                for (std::vector<GPP::PointOnEdge>::iterator itr = pathPointInfos.begin(); itr != pathPointInfos.end(); ++itr)
+                {
+                    itr->mVertexIdStart = subTriangles.SubTriMeshIdToVertexId(itr->mVertexIdStart);
+                    if (itr->mVertexIdEnd >= 0)
+                    {
+                        itr->mVertexIdEnd = subTriangles.SubTriMeshIdToVertexId(itr->mVertexIdEnd);
+                    }
+                }
+                // a vertex of the path, or both ends of a crossed edge, lying on the region boundary means the
+                // geodesic may be blocked by the region
+                for (std::vector<GPP::PointOnEdge>::iterator itr = pathPointInfos.begin(); itr != pathPointInfos.end() && !isWholeMesh; ++itr)
+                {
+                    GPP::Int checkIds[2] = {itr->mVertexIdStart, itr->mVertexIdEnd};
+                    int boundaryCount = 0;
+                    int checkCount = (checkIds[1] >= 0) ? 2 : 1;
+                    for (int cid = 0; cid < checkCount; cid++)
+                    {
+                        for (GPP::Int p = mVertexFaceStart.at(checkIds[cid]); p < mVertexFaceStart.at(checkIds[cid] + 1); p++)
+                        {
+                            if (mFaceFlags.at(mVertexFaceIds.at(p)) == 0)
+                            {
+                                boundaryCount++;
+                                break;
+                            }
+                        }
+                    }
+                    if (boundaryCount == checkCount && !(checkCount == 1 && (checkIds[0] == startId || checkIds[0] == endId)))
+                    {
+                        isTouchBoundary = true;
+                        break;
+                    }
+                }
+            }
+            for (std::vector<GPP::Int>::iterator itr = regionFaceIds.begin(); itr != regionFaceIds.end(); ++itr)
+            {
+                mFaceFlags.at(*itr) = 0;
+            }
+            ResetGraphDistance(mStartDistances, mStartTouchedIds);
+            ResetGraphDistance(mEndDistances, mEndTouchedIds);
+            if (res == GPP_NO_ERROR && !isTouchBoundary)
+            {
+                return GPP_NO_ERROR;
+            }
+            if (isWholeMesh)
+            {
+                return res;
+            }
+            regionScale *= REGION_EXPAND_SCALE;
+        }
+        // region is still not large enough, use the whole mesh
+        mLastRegionVertexCount = mVertexCount;
+        std::vector<GPP::Int> sectionVertexIds(2);
+        sectionVertexIds.at(0) = startId;
+        sectionVertexIds.at(1) = endId;
+        return GPP::MeasureMesh::ComputeExactGeodesics(mpTriMesh, sectionVertexIds, false, pathPointPositions, distance, &pathPointInfos);
+    }
+
+    GPP::Real LocalGeodesics::GrowGraphDistance(GPP::Int sourceId, GPP::Int targetId, GPP::Real maxDistance,
+        std::vector<GPP::Real>& distances, std::vector<GPP::Int>& touchedIds)
+    {
+        typedef std::pair<GPP::Real, GPP::Int> DistanceItem;
+        std::priority_queue<DistanceItem, std::vector<DistanceItem>, std::greater<DistanceItem> > candidates;
+        distances.at(sourceId) = 0;
+        touchedIds.push_back(sourceId);
+        candidates.push(DistanceItem(0, sourceId));
+        GPP::Int vertexIds[3];
+        while (!candidates.empty())
+        {
+            DistanceItem curItem = candidates.top();
+            candidates.pop();
+            GPP::Int curId = curItem.second;
+            if (curItem.first > distances.at(curId))
+            {
+                continue;
+            }
+            if (curId == targetId)
+            {
+                return curItem.first;
+            }
+            GPP::Vector3 curCoord = mpTriMesh->GetVertexCoord(curId);
+            for (GPP::Int p = mVertexFaceStart.at(curId); p < mVertexFaceStart.at(curId + 1); p++)
+            {
+                mpTriMesh->GetTriangleVertexIds(mVertexFaceIds.at(p), vertexIds);
+                for (int fvid = 0; fvid < 3; fvid++)
+                {
+                    GPP::Int neighborId = vertexIds[fvid];
+                    if (neighborId == curId)
+                    {
+                        continue;
+                    }
+                    GPP::Real neighborDistance = curItem.first + (mpTriMesh->GetVertexCoord(neighborId) - curCoord).Length();
+                    if (neighborDistance > maxDistance || neighborDistance >= distances.at(neighborId))
+                    {
+                        continue;
+                    }
+                    if (distances.at(neighborId) >= GPP::REAL_LARGE)
+                    {
+                        touchedIds.push_back(neighborId);
+                    }
+                    distances.at(neighborId) = neighborDistance;
+                    candidates.push(DistanceItem(neighborDistance, neighborId));
+                }
+            }
+        }
+        return (targetId >= 0) ? distances.at(targetId) : GPP::REAL_LARGE;
+    }
+
+    void LocalGeodesics::ResetGraphDistance(std::vector<GPP::Real>& distances, std::vector<GPP::Int>& touchedIds)
+    {
+        for (std::vector<GPP::Int>::iterator itr = touchedIds.begin(); itr != touchedIds.end(); ++itr)
+        {
+            distances.at(*itr) = GPP::REAL_LARGE;
+        }
+        touchedIds.clear();
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Exact geodesics computed on a region of interest around each section instead of the whole mesh.
+    // The region is the set of vertices whose graph distances to both end points sum up to less than
+    // regionScale times the graph distance between them. It is wrapped as a GPP::SubTriangleList and passed to
+    // GPP::MeasureMesh::_ComputeExactGeodesics. If the path touches the region boundary, the region is enlarged and
+    // the section is computed again, so the cost depends on the path length rather than the mesh size.
+    // USAGE: 1. localGeodesics.Init(triMesh);
+    //        2. localGeodesics.ComputeExactGeodesics(markIds, false, pathCoords, distance, &pathInfos);
+    class LocalGeodesics
+    {
+    public:
+        LocalGeodesics();
+        ~LocalGeodesics();
+
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh);
+        bool IsBuiltFrom(const GPP::ITriMesh* triMesh) const;
+        void Clear(void);
+
+        // Same parameters as GPP::MeasureMesh::ComputeExactGeodesics
+        GPP::ErrorCode ComputeExactGeodesics(const std::vector<GPP::Int>& sectionVertexIds, bool isSectionClose,
+            std::vector<GPP::Vector3>& pathPointPositions, GPP::Real& distance, std::vector<GPP::PointOnEdge>* pathPointInfos);
+
+        // Region vertex count of the last computed section
+        GPP::Int GetLastRegionVertexCount(void) const;
+
+    private:
+        GPP::ErrorCode ComputeSectionGeodesics(GPP::Int startId, GPP::Int endId, std::vector<GPP::Vector3>& pathPointPositions,
+            GPP::Real& distance, std::vector<GPP::PointOnEdge>& pathPointInfos);
+        // Dijkstra on mesh edges from sourceId, stopped at maxDistance. Returns the distance of targetId or REAL_LARGE
+        GPP::Real GrowGraphDistance(GPP::Int sourceId, GPP::Int targetId, GPP::Real maxDistance, std::vector<GPP::Real>& distances,
+            std::vector<GPP::Int>& touchedIds);
+        void ResetGraphDistance(std::vector<GPP::Real>& distances, std::vector<GPP::Int>& touchedIds);
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mVertexCount;
+        GPP::Int mTriangleCount;
+        std::vector<GPP::Int> mVertexFaceStart;
+        std::vector<GPP::Int> mVertexFaceIds;
+        std::vector<GPP::Real> mStartDistances;
+        std::vector<GPP::Real> mEndDistances;
+        std::vector<GPP::Int> mStartTouchedIds;
+        std::vector<GPP::Int> mEndTouchedIds;
+        std::vector<GPP::Int> mFaceFlags;
+        GPP::Int mLastRegionVertexCount;
+    };
+}
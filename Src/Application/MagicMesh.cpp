@@ -4,9 +4,7 @@ namespace MagicApp
 {
     MagicMesh::MagicMesh(GPP::ITriMesh* triMesh) :
         mTriMesh(triMesh),
-        mImageColorIds(NULL),
-        mColorIds(NULL),
-        mImageColorIdFlags(NULL)
+        mpAttributes(NULL)
     {
     }
 
@@ -62,12 +60,21 @@ namespace MagicApp
 
     GPP::Int MagicMesh::InsertVertex(const GPP::Vector3& coord)
     {
-        return mTriMesh->InsertVertex(coord);
+        GPP::Int vertexId = mTriMesh->InsertVertex(coord);
+        if (mpAttributes)
+        {
+            mpAttributes->ResizeElements(mTriMesh->GetVertexCount());
+        }
+        return vertexId;
     }
 
     void MagicMesh::Clear()
     {
         mTriMesh->Clear();
+        if (mpAttributes)
+        {
+            mpAttributes->ResizeElements(0);
+        }
     }
 
     GPP::Int MagicMesh::InsertTriangle(GPP::Int vertexId0, GPP::Int vertexId1, GPP::Int vertexId2)
@@ -78,41 +85,18 @@ namespace MagicApp
     void MagicMesh::SwapVertex(GPP::Int vertexId0, GPP::Int vertexId1)
     {
         mTriMesh->SwapVertex(vertexId0, vertexId1);
-        if (mImageColorIds)
-        {
-            GPP::ImageColorId temp = mImageColorIds->at(vertexId0);
-            mImageColorIds->at(vertexId0) = mImageColorIds->at(vertexId1);
-            mImageColorIds->at(vertexId1) = temp;
-        }
-        if (mColorIds)
-        {
-            GPP::Int temp = mColorIds->at(vertexId0);
-            mColorIds->at(vertexId0) = mColorIds->at(vertexId1);
-            mColorIds->at(vertexId1) = temp;
-        }
-        if (mImageColorIdFlags)
+        if (mpAttributes)
         {
-            bool temp = mImageColorIdFlags->at(vertexId0);
-            mImageColorIdFlags->at(vertexId0) = mImageColorIdFlags->at(vertexId1);
-            mImageColorIdFlags->at(vertexId1) = temp;
+            mpAttributes->SwapElements(vertexId0, vertexId1);
         }
     }
 
     void MagicMesh::PopbackVertices(GPP::Int popCount)
     {
-        GPP::Int vertexCount = mTriMesh->GetVertexCount();
         mTriMesh->PopbackVertices(popCount);
-        if (mImageColorIds)
-        {
-            mImageColorIds->erase(mImageColorIds->begin() + vertexCount - popCount, mImageColorIds->end());
-        }
-        if (mColorIds)
+        if (mpAttributes)
         {
-            mColorIds->erase(mColorIds->begin() + vertexCount - popCount, mColorIds->end());
-        }
-        if (mImageColorIdFlags)
-        {
-            mImageColorIdFlags->erase(mImageColorIdFlags->begin() + vertexCount - popCount, mImageColorIdFlags->end());
+            mpAttributes->PopbackElements(popCount);
         }
     }
 
@@ -134,23 +118,17 @@ namespace MagicApp
     MagicMesh::~MagicMesh()
     {
         mTriMesh = NULL;
-        mImageColorIds = NULL;
-        mColorIds = NULL;
-        mImageColorIdFlags = NULL;
-    }
-
-    void MagicMesh::SetImageColorIds(std::vector<GPP::ImageColorId>* imageColorIds)
-    {
-        mImageColorIds = imageColorIds;
+        mpAttributes = NULL;
     }
 
-    void MagicMesh::SetColorIds(std::vector<int>* colorIds)
+    void MagicMesh::SetAttributes(AttributeStore* attributes)
     {
-        mColorIds = colorIds;
-    }
-
-    void MagicMesh::SetImageColorIdFlags(std::vector<int>* flags)
-    {
-        mImageColorIdFlags = flags;
+        mpAttributes = attributes;
+        if (mpAttributes)
+        {
+            mpAttributes->RemoveUnmatchedChannels(mTriMesh->GetVertexCount());
+            // The forwarded element operations do not load channels, load them once here
+            mpAttributes->LoadAllChannels();
+        }
     }
 }
@@ -1,8 +1,10 @@
 #pragma once
 #include "GPP.h"
+#include "AttributeStore.h"
 
 namespace MagicApp
 {
+    // Forwards to triMesh and keeps the vertex channels of an AttributeStore in sync with vertex swaps, popbacks and inserts
     class MagicMesh : public GPP::ITriMesh
     {
     public:
@@ -41,14 +43,12 @@ namespace MagicApp
 
         virtual ~MagicMesh();
 
-        void SetImageColorIds(std::vector<GPP::ImageColorId>* imageColorIds);
-        void SetColorIds(std::vector<int>* colorIds);
-        void SetImageColorIdFlags(std::vector<int>* flags);
+        // Attach attributes so vertex edits are forwarded to every channel.
+        // Channels whose size is not the vertex count are stale and are removed (and logged)
+        void SetAttributes(AttributeStore* attributes);
 
     private:
         GPP::ITriMesh* mTriMesh;
-        std::vector<GPP::ImageColorId>* mImageColorIds;
-        std::vector<int>* mColorIds;
-        std::vector<int>* mImageColorIdFlags;
+        AttributeStore* mpAttributes;
     };
 }
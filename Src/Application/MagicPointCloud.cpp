@@ -4,9 +4,7 @@ namespace MagicApp
 {
     MagicPointCloud::MagicPointCloud(GPP::IPointCloud* pointCloud) :
         mPointCloud(pointCloud),
-        mImageColorIds(NULL),
-        mColorIds(NULL),
-        mCloudIds(NULL)
+        mpAttributes(NULL)
     {
     }
 
@@ -47,76 +45,60 @@ namespace MagicApp
 
     GPP::Int MagicPointCloud::InsertPoint(const GPP::Vector3& coord)
     {
-        return mPointCloud->InsertPoint(coord);
+        GPP::Int pointId = mPointCloud->InsertPoint(coord);
+        if (mpAttributes)
+        {
+            mpAttributes->ResizeElements(mPointCloud->GetPointCount());
+        }
+        return pointId;
     }
 
     GPP::Int MagicPointCloud::InsertPoint(const GPP::Vector3& coord, const GPP::Vector3& normal)
     {
-        return mPointCloud->InsertPoint(coord, normal);
+        GPP::Int pointId = mPointCloud->InsertPoint(coord, normal);
+        if (mpAttributes)
+        {
+            mpAttributes->ResizeElements(mPointCloud->GetPointCount());
+        }
+        return pointId;
     }
 
     void MagicPointCloud::SwapPoint(GPP::Int pointId0, GPP::Int pointId1)
     {
         mPointCloud->SwapPoint(pointId0, pointId1);
-        if (mImageColorIds)
-        {
-            GPP::ImageColorId temp = mImageColorIds->at(pointId0);
-            mImageColorIds->at(pointId0) = mImageColorIds->at(pointId1);
-            mImageColorIds->at(pointId1) = temp;
-        }
-        if (mColorIds)
+        if (mpAttributes)
         {
-            GPP::Int temp = mColorIds->at(pointId0);
-            mColorIds->at(pointId0) = mColorIds->at(pointId1);
-            mColorIds->at(pointId1) = temp;
-        }
-        if (mCloudIds)
-        {
-            GPP::Int temp = mCloudIds->at(pointId0);
-            mCloudIds->at(pointId0) = mCloudIds->at(pointId1);
-            mCloudIds->at(pointId1) = temp;
+            mpAttributes->SwapElements(pointId0, pointId1);
         }
     }
 
     void MagicPointCloud::PopbackPoints(GPP::Int popCount)
     {
-        int pointCount = mPointCloud->GetPointCount();
         mPointCloud->PopbackPoints(popCount);
-        if (mImageColorIds)
-        {
-            mImageColorIds->erase(mImageColorIds->begin() + pointCount - popCount, mImageColorIds->end());
-        }
-        if (mColorIds)
-        {
-            mColorIds->erase(mColorIds->begin() + pointCount - popCount, mColorIds->end());
-        }
-        if (mCloudIds)
+        if (mpAttributes)
         {
-            mCloudIds->erase(mCloudIds->begin() + pointCount - popCount, mCloudIds->end());
+            mpAttributes->PopbackElements(popCount);
         }
     }
 
     void MagicPointCloud::Clear()
     {
         mPointCloud->Clear();
-        mImageColorIds = NULL;
-        mColorIds = NULL;
-        mCloudIds = NULL;
-    }
-
-    void MagicPointCloud::SetImageColorIds(std::vector<GPP::ImageColorId>* imageColorIds)
-    {
-        mImageColorIds = imageColorIds;
-    }
-
-    void MagicPointCloud::SetColorIds(std::vector<int>* colorIds)
-    {
-        mColorIds = colorIds;
+        if (mpAttributes)
+        {
+            mpAttributes->ResizeElements(0);
+        }
     }
 
-    void MagicPointCloud::SetCloudIds(std::vector<int>* cloudIds)
+    void MagicPointCloud::SetAttributes(AttributeStore* attributes)
     {
-        mCloudIds = cloudIds;
+        mpAttributes = attributes;
+        if (mpAttributes)
+        {
+            mpAttributes->RemoveUnmatchedChannels(mPointCloud->GetPointCount());
+            // The forwarded element operations do not load channels, load them once here
+            mpAttributes->LoadAllChannels();
+        }
     }
 
     MagicPointCloud::~MagicPointCloud()
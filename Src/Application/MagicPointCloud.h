@@ -1,8 +1,10 @@
 #pragma once
 #include "GPP.h"
+#include "AttributeStore.h"
 
 namespace MagicApp
 {
+    // Forwards to pointCloud and keeps the point channels of an AttributeStore in sync with point swaps, popbacks and inserts
     class MagicPointCloud : public GPP::IPointCloud
     {
     public:
@@ -27,14 +29,12 @@ namespace MagicApp
 
         virtual ~MagicPointCloud();
 
-        void SetImageColorIds(std::vector<GPP::ImageColorId>* imageColorIds);
-        void SetColorIds(std::vector<int>* colorIds);
-        void SetCloudIds(std::vector<int>* cloudIds);
+        // Attach attributes so point edits are forwarded to every channel.
+        // Channels whose size is not the point count are stale and are removed (and logged)
+        void SetAttributes(AttributeStore* attributes);
 
     private:
         GPP::IPointCloud* mPointCloud;
-        std::vector<GPP::ImageColorId>* mImageColorIds;
-        std::vector<int>* mColorIds;
-        std::vector<int>* mCloudIds;
+        AttributeStore* mpAttributes;
     };
 }
@@ -0,0 +1,435 @@
+#include "MarchingCubes.h"
+#include "DistanceVolume.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <algorithm>
+#include <map>
+
+namespace MagicApp
+{
+    static const GPP::Int BLOCK_EDGE_BITS = IDistanceVolume::BLOCK_EDGE_BITS;
+    static const GPP::Int BLOCK_EDGE = 1 << BLOCK_EDGE_BITS;
+    static const GPP::Int BLOCK_EDGE_MASK = BLOCK_EDGE - 1;
+    static const GPP::Int BLOCK_VOXEL_COUNT = BLOCK_EDGE * BLOCK_EDGE * BLOCK_EDGE;
+    // Corners of the cube faces, counterclockwise seen from outside. Corner c is at (c & 1, (c >> 1) & 1, c >> 2)
+    static const GPP::Int CUBE_FACE_CORNERS[6][4] = {
+        {0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}
+    };
+
+    static GPP::Int GetCornerOffset(GPP::Int cornerId, int axis)
+    {
+        return (cornerId >> axis) & 1;
+    }
+
+    static GPP::Int GetLocalVoxelId(const GPP::Int voxel[3])
+    {
+        return (voxel[0] & BLOCK_EDGE_MASK) | ((voxel[1] & BLOCK_EDGE_MASK) << BLOCK_EDGE_BITS) |
+            ((voxel[2] & BLOCK_EDGE_MASK) << (BLOCK_EDGE_BITS * 2));
+    }
+
+    class PolygonizeBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        explicit PolygonizeBlockTask(MarchingCubes* marchingCubes) :
+            mpMarchingCubes(marchingCubes)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                mpMarchingCubes->PolygonizeBlock(blockId);
+            }
+        }
+
+    private:
+        MarchingCubes* mpMarchingCubes;
+    };
+
+    class ResolveTriangleTask : public MagicCore::ParallelTask
+    {
+    public:
+        explicit ResolveTriangleTask(MarchingCubes* marchingCubes) :
+            mpMarchingCubes(marchingCubes)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                mpMarchingCubes->ResolveBlockTriangles(blockId);
+            }
+        }
+
+    private:
+        MarchingCubes* mpMarchingCubes;
+    };
+
+    MarchingCubes::MarchingCubes() :
+        mTriangleTable(),
+        mpVolume(NULL),
+        mBlockMeshes(),
+        mBlockVertexStart(),
+        mExtractTime(0)
+    {
+        BuildTriangleTable();
+    }
+
+    MarchingCubes::~MarchingCubes()
+    {
+    }
+
+    GPP::ErrorCode MarchingCubes::Extract(const IDistanceVolume* volume, GPP::TriMesh* triMesh)
+    {
+        if (volume == NULL || triMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        mpVolume = volume;
+        GPP::Int blockCount = volume->GetBlockCount();
+        mBlockMeshes.clear();
+        mBlockMeshes.resize(blockCount);
+        PolygonizeBlockTask polygonizeTask(this);
+        MagicCore::ParallelTool::ParallelFor(blockCount, &polygonizeTask);
+
+        mBlockVertexStart.resize(blockCount + 1);
+        mBlockVertexStart.at(0) = 0;
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            mBlockVertexStart.at(blockId + 1) = mBlockVertexStart.at(blockId) + mBlockMeshes.at(blockId).mCoords.size();
+        }
+        ResolveTriangleTask resolveTask(this);
+        MagicCore::ParallelTool::ParallelFor(blockCount, &resolveTask);
+
+        // Vertices on edges that no complete cell uses are dropped
+        GPP::Int vertexCount = mBlockVertexStart.at(blockCount);
+        std::vector<GPP::Int> vertexMeshIds(vertexCount, -1);
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            const std::vector<GPP::Int>& triangleVertexIds = mBlockMeshes.at(blockId).mTriangleVertexIds;
+            for (std::vector<GPP::Int>::const_iterator itr = triangleVertexIds.begin(); itr != triangleVertexIds.end(); ++itr)
+            {
+                vertexMeshIds.at(*itr) = 0;
+            }
+        }
+        triMesh->Clear();
+        GPP::Int meshVertexCount = 0;
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            BlockMesh& blockMesh = mBlockMeshes.at(blockId);
+            GPP::Int blockVertexCount = blockMesh.mCoords.size();
+            GPP::Int vertexStart = mBlockVertexStart.at(blockId);
+            for (GPP::Int localId = 0; localId < blockVertexCount; localId++)
+            {
+                if (vertexMeshIds.at(vertexStart + localId) < 0)
+                {
+                    continue;
+                }
+                triMesh->InsertVertex(blockMesh.mCoords.at(localId), blockMesh.mNormals.at(localId));
+                vertexMeshIds.at(vertexStart + localId) = meshVertexCount;
+                meshVertexCount++;
+            }
+            std::vector<GPP::Vector3>().swap(blockMesh.mCoords);
+            std::vector<GPP::Vector3>().swap(blockMesh.mNormals);
+        }
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            const std::vector<GPP::Int>& triangleVertexIds = mBlockMeshes.at(blockId).mTriangleVertexIds;
+            GPP::Int triangleCount = triangleVertexIds.size() / 3;
+            for (GPP::Int tid = 0; tid < triangleCount; tid++)
+            {
+                GPP::Int vertexIds[3] = {vertexMeshIds.at(triangleVertexIds.at(tid * 3)), vertexMeshIds.at(triangleVertexIds.at(tid * 3 + 1)),
+                    vertexMeshIds.at(triangleVertexIds.at(tid * 3 + 2))};
+                GPP::Int faceId = triMesh->InsertTriangle(vertexIds[0], vertexIds[1], vertexIds[2]);
+                GPP::Vector3 coord0 = triMesh->GetVertexCoord(vertexIds[0]);
+                GPP::Vector3 faceNormal = (triMesh->GetVertexCoord(vertexIds[1]) - coord0).CrossProduct(triMesh->GetVertexCoord(vertexIds[2]) - coord0);
+                faceNormal.Normalise();
+                triMesh->SetTriangleNormal(faceId, faceNormal);
+            }
+        }
+        mBlockMeshes.clear();
+        mBlockVertexStart.clear();
+        mpVolume = NULL;
+        mExtractTime = MagicCore::ToolKit::GetTime() - startTime;
+        if (triMesh->GetTriangleCount() == 0)
+        {
+            return GPP_INVALID_RESULT;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    double MarchingCubes::GetExtractTime(void) const
+    {
+        return mExtractTime;
+    }
+
+    void MarchingCubes::BuildTriangleTable(void)
+    {
+        GPP::Int edgeIds[8][8];
+        GPP::Int edgeCount = 0;
+        for (GPP::Int cornerId = 0; cornerId < 8; cornerId++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (GetCornerOffset(cornerId, axis) == 0)
+                {
+                    GPP::Int upperCornerId = cornerId | (1 << axis);
+                    mEdgeCorners[edgeCount][0] = cornerId;
+                    mEdgeCorners[edgeCount][1] = upperCornerId;
+                    mEdgeAxes[edgeCount] = axis;
+                    edgeIds[cornerId][upperCornerId] = edgeCount;
+                    edgeIds[upperCornerId][cornerId] = edgeCount;
+                    edgeCount++;
+                }
+            }
+        }
+        mTriangleTable.clear();
+        mTriangleTable.resize(256);
+        for (GPP::Int config = 0; config < 256; config++)
+        {
+            // On every face, a segment goes from an edge entering the inside to the next edge leaving it,
+            // so every inside corner of an ambiguous face gets its own segment
+            std::map<GPP::Int, GPP::Int> segments;
+            for (GPP::Int faceId = 0; faceId < 6; faceId++)
+            {
+                const GPP::Int* faceCorners = CUBE_FACE_CORNERS[faceId];
+                bool isInside[4];
+                for (GPP::Int localId = 0; localId < 4; localId++)
+                {
+                    isInside[localId] = ((config >> faceCorners[localId]) & 1) != 0;
+                }
+                for (GPP::Int localId = 0; localId < 4; localId++)
+                {
+                    GPP::Int nextId = (localId + 1) % 4;
+                    if (isInside[localId] || !isInside[nextId])
+                    {
+                        continue;
+                    }
+                    GPP::Int exitId = nextId;
+                    while (isInside[(exitId + 1) % 4])
+                    {
+                        exitId = (exitId + 1) % 4;
+                    }
+                    GPP::Int entryEdgeId = edgeIds[faceCorners[localId]][faceCorners[nextId]];
+                    GPP::Int exitEdgeId = edgeIds[faceCorners[exitId]][faceCorners[(exitId + 1) % 4]];
+                    segments[entryEdgeId] = exitEdgeId;
+                }
+            }
+            // The segments of all faces chain into closed polygons, which are split into fans
+            std::vector<GPP::Int>& triangleEdges = mTriangleTable.at(config);
+            while (!segments.empty())
+            {
+                std::vector<GPP::Int> polygon;
+                GPP::Int edgeId = segments.begin()->first;
+                while (segments.find(edgeId) != segments.end())
+                {
+                    polygon.push_back(edgeId);
+                    GPP::Int nextEdgeId = segments[edgeId];
+                    segments.erase(edgeId);
+                    edgeId = nextEdgeId;
+                }
+                GPP::Int polygonSize = polygon.size();
+                for (GPP::Int localId = 1; localId + 1 < polygonSize; localId++)
+                {
+                    triangleEdges.push_back(polygon.at(0));
+                    triangleEdges.push_back(polygon.at(localId));
+                    triangleEdges.push_back(polygon.at(localId + 1));
+                }
+            }
+        }
+        // The winding follows the face orientation, flip it if the triangle of a single inside corner faces that corner
+        const std::vector<GPP::Int>& cornerTriangle = mTriangleTable.at(1);
+        GPP::Vector3 edgeMids[3];
+        for (int localId = 0; localId < 3; localId++)
+        {
+            GPP::Int edgeId = cornerTriangle.at(localId);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                edgeMids[localId][axis] = (GetCornerOffset(mEdgeCorners[edgeId][0], axis) + GetCornerOffset(mEdgeCorners[edgeId][1], axis)) * 0.5;
+            }
+        }
+        GPP::Vector3 cornerNormal = (edgeMids[1] - edgeMids[0]).CrossProduct(edgeMids[2] - edgeMids[0]);
+        if (cornerNormal * GPP::Vector3(1, 1, 1) < 0)
+        {
+            for (GPP::Int config = 0; config < 256; config++)
+            {
+                std::vector<GPP::Int>& triangleEdges = mTriangleTable.at(config);
+                GPP::Int triangleCount = triangleEdges.size() / 3;
+                for (GPP::Int tid = 0; tid < triangleCount; tid++)
+                {
+                    std::swap(triangleEdges.at(tid * 3 + 1), triangleEdges.at(tid * 3 + 2));
+                }
+            }
+        }
+    }
+
+    void MarchingCubes::PolygonizeBlock(GPP::Int blockId)
+    {
+        BlockMesh& blockMesh = mBlockMeshes.at(blockId);
+        GPP::Int blockCoord[3];
+        mpVolume->GetBlockCoord(blockId, blockCoord);
+        GPP::Int voxel[3];
+        GPP::Int neighborVoxel[3];
+        GPP::Int ownerBlockCoord[3];
+        // Vertices of the edges owned by this block, in edge slot order
+        for (GPP::Int localId = 0; localId < BLOCK_VOXEL_COUNT; localId++)
+        {
+            voxel[0] = (blockCoord[0] << BLOCK_EDGE_BITS) + (localId & BLOCK_EDGE_MASK);
+            voxel[1] = (blockCoord[1] << BLOCK_EDGE_BITS) + ((localId >> BLOCK_EDGE_BITS) & BLOCK_EDGE_MASK);
+            voxel[2] = (blockCoord[2] << BLOCK_EDGE_BITS) + (localId >> (BLOCK_EDGE_BITS * 2));
+            GPP::Real distance = 0;
+            if (!mpVolume->GetVoxelDistance(voxel, distance))
+            {
+                continue;
+            }
+            for (int axis = 0; axis < 3; axis++)
+            {
+                neighborVoxel[0] = voxel[0];
+                neighborVoxel[1] = voxel[1];
+                neighborVoxel[2] = voxel[2];
+                neighborVoxel[axis]++;
+                GPP::Real neighborDistance = 0;
+                if (!mpVolume->GetVoxelDistance(neighborVoxel, neighborDistance) || (distance < 0) == (neighborDistance < 0))
+                {
+                    continue;
+                }
+                GPP::Real ratio = distance / (distance - neighborDistance);
+                GPP::Vector3 coord = mpVolume->GetVoxelCoord(voxel);
+                coord += (mpVolume->GetVoxelCoord(neighborVoxel) - coord) * ratio;
+                GPP::Vector3 normal = GetVoxelGradient(voxel) * (1.0 - ratio) + GetVoxelGradient(neighborVoxel) * ratio;
+                if (normal.Normalise() < GPP::REAL_TOL)
+                {
+                    normal = GPP::Vector3(0, 0, 0);
+                    normal[axis] = distance > neighborDistance ? -1.0 : 1.0;
+                }
+                blockMesh.mCoords.push_back(coord);
+                blockMesh.mNormals.push_back(normal);
+                blockMesh.mEdgeSlots.push_back(localId * 3 + axis);
+            }
+        }
+        // Cells whose lower corner is in this block
+        for (GPP::Int localId = 0; localId < BLOCK_VOXEL_COUNT; localId++)
+        {
+            voxel[0] = (blockCoord[0] << BLOCK_EDGE_BITS) + (localId & BLOCK_EDGE_MASK);
+            voxel[1] = (blockCoord[1] << BLOCK_EDGE_BITS) + ((localId >> BLOCK_EDGE_BITS) & BLOCK_EDGE_MASK);
+            voxel[2] = (blockCoord[2] << BLOCK_EDGE_BITS) + (localId >> (BLOCK_EDGE_BITS * 2));
+            GPP::Int config = 0;
+            bool isComplete = true;
+            for (GPP::Int cornerId = 0; cornerId < 8; cornerId++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    neighborVoxel[axis] = voxel[axis] + GetCornerOffset(cornerId, axis);
+                }
+                GPP::Real distance = 0;
+                if (!mpVolume->GetVoxelDistance(neighborVoxel, distance))
+                {
+                    isComplete = false;
+                    break;
+                }
+                if (distance < 0)
+                {
+                    config |= (1 << cornerId);
+                }
+            }
+            if (!isComplete)
+            {
+                continue;
+            }
+            const std::vector<GPP::Int>& triangleEdges = mTriangleTable.at(config);
+            for (std::vector<GPP::Int>::const_iterator itr = triangleEdges.begin(); itr != triangleEdges.end(); ++itr)
+            {
+                GPP::Int lowerCornerId = mEdgeCorners[*itr][0];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    neighborVoxel[axis] = voxel[axis] + GetCornerOffset(lowerCornerId, axis);
+                    ownerBlockCoord[axis] = neighborVoxel[axis] >> BLOCK_EDGE_BITS;
+                }
+                GPP::Int ownerBlockId = blockId;
+                if (ownerBlockCoord[0] != blockCoord[0] || ownerBlockCoord[1] != blockCoord[1] || ownerBlockCoord[2] != blockCoord[2])
+                {
+                    ownerBlockId = mpVolume->FindBlockId(ownerBlockCoord);
+                }
+                blockMesh.mCornerEdges.push_back(ownerBlockId);
+                blockMesh.mCornerEdges.push_back(GetLocalVoxelId(neighborVoxel) * 3 + mEdgeAxes[*itr]);
+            }
+        }
+    }
+
+    void MarchingCubes::ResolveBlockTriangles(GPP::Int blockId)
+    {
+        BlockMesh& blockMesh = mBlockMeshes.at(blockId);
+        GPP::Int cornerCount = blockMesh.mCornerEdges.size() / 2;
+        blockMesh.mTriangleVertexIds.reserve(cornerCount);
+        for (GPP::Int triangleCornerId = 0; triangleCornerId < cornerCount; triangleCornerId += 3)
+        {
+            GPP::Int vertexIds[3];
+            bool isValid = true;
+            for (GPP::Int localId = 0; localId < 3; localId++)
+            {
+                GPP::Int ownerBlockId = blockMesh.mCornerEdges.at((triangleCornerId + localId) * 2);
+                GPP::Int edgeSlot = blockMesh.mCornerEdges.at((triangleCornerId + localId) * 2 + 1);
+                if (ownerBlockId < 0)
+                {
+                    isValid = false;
+                    break;
+                }
+                // Owner blocks only append to their own mesh in PolygonizeBlock, here they are read only
+                const std::vector<GPP::Int>& edgeSlots = mBlockMeshes.at(ownerBlockId).mEdgeSlots;
+                std::vector<GPP::Int>::const_iterator slotItr = std::lower_bound(edgeSlots.begin(), edgeSlots.end(), edgeSlot);
+                if (slotItr == edgeSlots.end() || *slotItr != edgeSlot)
+                {
+                    isValid = false;
+                    break;
+                }
+                vertexIds[localId] = mBlockVertexStart.at(ownerBlockId) + GPP::Int(slotItr - edgeSlots.begin());
+            }
+            if (isValid)
+            {
+                blockMesh.mTriangleVertexIds.push_back(vertexIds[0]);
+                blockMesh.mTriangleVertexIds.push_back(vertexIds[1]);
+                blockMesh.mTriangleVertexIds.push_back(vertexIds[2]);
+            }
+        }
+        std::vector<GPP::Int>().swap(blockMesh.mCornerEdges);
+    }
+
+    GPP::Vector3 MarchingCubes::GetVoxelGradient(const GPP::Int voxel[3]) const
+    {
+        // Central differences, one sided where a neighbor is not observed
+        GPP::Vector3 gradient(0, 0, 0);
+        GPP::Real distance = 0;
+        bool hasDistance = mpVolume->GetVoxelDistance(voxel, distance);
+        GPP::Vector3 voxelCoord = mpVolume->GetVoxelCoord(voxel);
+        GPP::Int neighborVoxel[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            neighborVoxel[0] = voxel[0];
+            neighborVoxel[1] = voxel[1];
+            neighborVoxel[2] = voxel[2];
+            neighborVoxel[axis] = voxel[axis] + 1;
+            GPP::Real upperDistance = 0;
+            bool hasUpper = mpVolume->GetVoxelDistance(neighborVoxel, upperDistance);
+            GPP::Real spacing = mpVolume->GetVoxelCoord(neighborVoxel)[axis] - voxelCoord[axis];
+            neighborVoxel[axis] = voxel[axis] - 1;
+            GPP::Real lowerDistance = 0;
+            bool hasLower = mpVolume->GetVoxelDistance(neighborVoxel, lowerDistance);
+            if (hasUpper && hasLower)
+            {
+                gradient[axis] = (upperDistance - lowerDistance) * 0.5 / spacing;
+            }
+            else if (hasUpper && hasDistance)
+            {
+                gradient[axis] = (upperDistance - distance) / spacing;
+            }
+            else if (hasLower && hasDistance)
+            {
+                gradient[axis] = (distance - lowerDistance) / spacing;
+            }
+        }
+        return gradient;
+    }
+}
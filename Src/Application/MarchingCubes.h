@@ -0,0 +1,57 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    class IDistanceVolume;
+
+    // Extracts the zero surface of a blocked distance volume (TsdfVolume) as an indexed mesh, instead of extracting a point cloud
+    // and reconstructing it again. Blocks are polygonized in parallel. A vertex is created once, by the block that owns the
+    // lower voxel of its edge, and the triangles of the neighbor blocks find it through the owner block, so shared edges
+    // are not duplicated. Vertex normals are the distance gradients. Cells with an unobserved corner are skipped.
+    // The triangle table is generated from the cube faces with the inside corners kept apart, so neighbor cells always agree.
+    // USAGE: 1. MarchingCubes marchingCubes;
+    //        2. marchingCubes.Extract(&tsdfVolume, triMesh);
+    class MarchingCubes
+    {
+    public:
+        MarchingCubes();
+        ~MarchingCubes();
+
+        // triMesh should be blank
+        GPP::ErrorCode Extract(const IDistanceVolume* volume, GPP::TriMesh* triMesh);
+        double GetExtractTime(void) const;
+
+    private:
+        struct BlockMesh
+        {
+            std::vector<GPP::Vector3> mCoords;
+            std::vector<GPP::Vector3> mNormals;
+            // Edge slot (local voxel id * 3 + axis) of every vertex, increasing
+            std::vector<GPP::Int> mEdgeSlots;
+            // Owner block id and edge slot of every triangle corner
+            std::vector<GPP::Int> mCornerEdges;
+            std::vector<GPP::Int> mTriangleVertexIds;
+        };
+
+        MarchingCubes(const MarchingCubes&);
+        MarchingCubes& operator = (const MarchingCubes&);
+        void BuildTriangleTable(void);
+        void PolygonizeBlock(GPP::Int blockId);
+        void ResolveBlockTriangles(GPP::Int blockId);
+        GPP::Vector3 GetVoxelGradient(const GPP::Int voxel[3]) const;
+        friend class PolygonizeBlockTask;
+        friend class ResolveTriangleTask;
+
+    private:
+        // Edge ids of the triangles of every cube configuration, 3 per triangle
+        std::vector<std::vector<GPP::Int> > mTriangleTable;
+        GPP::Int mEdgeCorners[12][2];
+        GPP::Int mEdgeAxes[12];
+        const IDistanceVolume* mpVolume;
+        std::vector<BlockMesh> mBlockMeshes;
+        std::vector<GPP::Int> mBlockVertexStart;
+        double mExtractTime;
+    };
+}
@@ -4,6 +4,9 @@
 #include "MeasureAppUI.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "MeshDistanceTree.h"
+#include "HeatGeodesics.h"
+#include "LocalGeodesics.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
@@ -16,6 +19,8 @@
 
 namespace MagicApp
 {
+    static const GPP::Real MAX_HEAT_TIME_FACTOR = 64.0;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         MeasureApp* app = (MeasureApp*)arg;
@@ -45,6 +50,7 @@ namespace MagicApp
         mGeodesicAccuracy(0.5),
         mIsFlatRenderingMode(true),
         mpRefTriMesh(NULL),
+        mpRefDistanceTree(NULL),
         mUpdateRefModelRendering(false),
         mMinCurvature(),
         mMaxCurvature(),
@@ -53,7 +59,13 @@ namespace MagicApp
         mDisplayPrincipalCurvature(0),
         mCurvatureWeight(0),
         mIsGeodesicsClose(false),
-        mCurvatureType(0)
+        mCurvatureType(0),
+        mpHeatGeodesics(NULL),
+        mIsHeatGeodesicsMode(false),
+        mHeatTimeFactor(1.0),
+        mpLocalGeodesics(NULL),
+        mIsLocalGeodesicsMode(false),
+        mRenderVersion(0)
     {
     }
 
@@ -63,6 +75,10 @@ namespace MagicApp
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
         GPPFREEPOINTER(mpRefTriMesh);
+        GPPFREEPOINTER(mpRefDistanceTree);
+        GPPFREEPOINTER(mpHeatGeodesics);
+        GPPFREEPOINTER(mpLocalGeodesics);
+        mIsLocalGeodesicsMode = false;
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
 #endif
@@ -169,6 +185,10 @@ namespace MagicApp
                 if (pickedId != -1)
                 {
                     mMarkIds.push_back(pickedId);
+                    if (mIsHeatGeodesicsMode)
+                    {
+                        ComputeHeatGeodesics();
+                    }
                     UpdateMarkRendering();
                 }
             }
@@ -196,6 +216,22 @@ namespace MagicApp
         {
             mIsGeodesicsClose = false;
         }
+        else if (arg.key == OIS::KC_H)
+        {
+            SwitchHeatGeodesicsMode();
+        }
+        else if (arg.key == OIS::KC_J)
+        {
+            CheckHeatGeodesicsAccuracy();
+        }
+        else if (arg.key == OIS::KC_T)
+        {
+            SwitchHeatTimeFactor();
+        }
+        else if (arg.key == OIS::KC_G)
+        {
+            SwitchLocalGeodesicsMode();
+        }
         else if (arg.key == OIS::KC_Q)
         {
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -264,7 +300,7 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "NormalProjectLineOnMesh Failed", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "NormalProjectLineOnMesh Failed", "温馨提示", MB_OK);
                     //return true;
                 }
                 for (int pid = 0; pid < pathPointInfos.size(); pid++)
@@ -336,6 +372,11 @@ namespace MagicApp
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
         GPPFREEPOINTER(mpRefTriMesh);
+        GPPFREEPOINTER(mpRefDistanceTree);
+        GPPFREEPOINTER(mpHeatGeodesics);
+        mIsHeatGeodesicsMode = false;
+        GPPFREEPOINTER(mpLocalGeodesics);
+        mIsLocalGeodesicsMode = false;
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
 #endif
@@ -395,7 +436,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -498,7 +539,9 @@ namespace MagicApp
                 material->setCullingMode(Ogre::CullingMode::CULL_CLOCKWISE);
             }
         }
-        mUpdateModelRendering = true;
+        // Only the layout is switched if the mesh is not changed since the last rendering
+        UpdateModelRendering(mUpdateModelRendering);
+        mUpdateModelRendering = false;
     }
 
     bool MeasureApp::ImportModel()
@@ -515,7 +558,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return false;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -535,6 +578,15 @@ namespace MagicApp
             mpPickTool = new MagicCore::PickTool;
             mpPickTool->SetPickParameter(MagicCore::PM_POINT, true, NULL, triMesh, "ModelNode");
             GPPFREEPOINTER(mpRefTriMesh);
+            GPPFREEPOINTER(mpRefDistanceTree);
+            GPPFREEPOINTER(mpHeatGeodesics);
+            GPPFREEPOINTER(mpLocalGeodesics);
+            if (mIsHeatGeodesicsMode)
+            {
+                mpHeatGeodesics = new HeatGeodesics;
+                mpHeatGeodesics->SetTimeFactor(mHeatTimeFactor);
+                mpHeatGeodesics->InitAsync(triMesh);
+            }
             UpdateRefModelRendering();
             return true;
         }
@@ -549,7 +601,7 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵҪ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要测量的网格", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -559,10 +611,11 @@ namespace MagicApp
             mpUI->SetGeodesicsInfo(0);
             ModelManager::Get()->ClearPointCloud();
             GPPFREEPOINTER(mpRefTriMesh);
+            GPPFREEPOINTER(mpRefDistanceTree);
             mpRefTriMesh = GPP::Parser::ImportTriMesh(fileName);
             if (mpRefTriMesh == NULL)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return false;
             }
             mpRefTriMesh->UnifyCoords(ModelManager::Get()->GetScaleValue(), ModelManager::Get()->GetObjCenterCoord());
@@ -587,8 +640,15 @@ namespace MagicApp
         }
         mGeodesicsOnVertices.clear();
         mMarkPoints.clear();
+        if (mIsHeatGeodesicsMode)
+        {
+            ComputeHeatGeodesics();
+        }
         UpdateMarkRendering();
-        mpUI->SetGeodesicsInfo(0);
+        if (!mIsHeatGeodesicsMode)
+        {
+            mpUI->SetGeodesicsInfo(0);
+        }
     }
 
     void MeasureApp::ComputeApproximateGeodesics(bool isSubThread)
@@ -600,12 +660,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -623,12 +683,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
@@ -651,17 +711,17 @@ namespace MagicApp
         int vertexCount = triMesh->GetVertexCount();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             return;
         }
         else if (mMinCurvature.size() != vertexCount)
         {
-            MessageBox(NULL, "ȸ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给网格计算主曲率", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -684,12 +744,12 @@ namespace MagicApp
                 maxDistance, &maxDirDistance);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -702,12 +762,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -766,7 +826,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
             return;
         }
 #if MAKEDUMPFILE
@@ -775,12 +835,12 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, mGeodesicsOnVertices, mIsGeodesicsClose, GPP::ONE_RADIAN * 60, 0.2, 10);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ϵĲŻʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "顶点上的测地线优化失败", "温馨提示", MB_OK);
             return;
         }
         mMarkPoints.clear();
@@ -792,6 +852,154 @@ namespace MagicApp
         mUpdateMarkRendering = true;
     }
  
+    void MeasureApp::SwitchHeatGeodesicsMode()
+    {
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL)
+        {
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
+            return;
+        }
+        mIsHeatGeodesicsMode = !mIsHeatGeodesicsMode;
+        InfoLog << "Heat geodesics mode: " << mIsHeatGeodesicsMode << std::endl;
+        if (!mIsHeatGeodesicsMode)
+        {
+            return;
+        }
+        if (mpHeatGeodesics == NULL || !mpHeatGeodesics->IsBuiltFrom(triMesh))
+        {
+            // factorization runs in background, marks picked before it is ready are connected by the next pick
+            GPPFREEPOINTER(mpHeatGeodesics);
+            mpHeatGeodesics = new HeatGeodesics;
+            mpHeatGeodesics->SetTimeFactor(mHeatTimeFactor);
+            GPP::ErrorCode res = mpHeatGeodesics->InitAsync(triMesh);
+            if (res != GPP_NO_ERROR)
+            {
+                GPPFREEPOINTER(mpHeatGeodesics);
+                mIsHeatGeodesicsMode = false;
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
+                return;
+            }
+        }
+        ComputeHeatGeodesics();
+        UpdateMarkRendering();
+    }
+
+    void MeasureApp::ComputeHeatGeodesics()
+    {
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL || mpHeatGeodesics == NULL || !mpHeatGeodesics->IsBuiltFrom(triMesh))
+        {
+            return;
+        }
+        if (!mpHeatGeodesics->IsReady())
+        {
+            InfoLog << "Heat geodesics is not ready" << std::endl;
+            return;
+        }
+        mMarkPoints.clear();
+        if (mMarkIds.size() < 2)
+        {
+            mpUI->SetGeodesicsInfo(0);
+            return;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        std::vector<GPP::Vector3> pathPoints;
+        GPP::Real distance = 0;
+        GPP::ErrorCode res = mpHeatGeodesics->ComputeGeodesics(mMarkIds, mIsGeodesicsClose, pathPoints, distance);
+        if (res != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
+            return;
+        }
+        InfoLog << "Heat geodesics: " << MagicCore::ToolKit::GetTime() - startTime << " distance " << distance << std::endl;
+        mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
+        mMarkPoints.swap(pathPoints);
+    }
+
+    void MeasureApp::CheckHeatGeodesicsAccuracy()
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL || mMarkIds.size() < 2)
+        {
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
+            return;
+        }
+        if (mpHeatGeodesics == NULL || !mpHeatGeodesics->IsBuiltFrom(triMesh))
+        {
+            GPPFREEPOINTER(mpHeatGeodesics);
+            mpHeatGeodesics = new HeatGeodesics;
+            mpHeatGeodesics->SetTimeFactor(mHeatTimeFactor);
+            double factorTime = MagicCore::ToolKit::GetTime();
+            GPP::ErrorCode res = mpHeatGeodesics->Init(triMesh);
+            if (res != GPP_NO_ERROR)
+            {
+                GPPFREEPOINTER(mpHeatGeodesics);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
+                return;
+            }
+            InfoLog << "Heat geodesics factorization: " << MagicCore::ToolKit::GetTime() - factorTime << std::endl;
+        }
+        mpHeatGeodesics->WaitReady();
+        GPP::Real heatDistance = 0;
+        GPP::Real exactDistance = 0;
+        GPP::Real relativeError = 0;
+        double startTime = MagicCore::ToolKit::GetTime();
+        GPP::ErrorCode res = mpHeatGeodesics->CheckAccuracy(mMarkIds, mIsGeodesicsClose, heatDistance, exactDistance, relativeError);
+        if (res != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
+            return;
+        }
+        GPP::Real scaleValue = ModelManager::Get()->GetScaleValue();
+        InfoLog << "Heat geodesics accuracy: heat " << heatDistance / scaleValue << " exact " << exactDistance / scaleValue 
+            << " relative error " << relativeError << " time " << MagicCore::ToolKit::GetTime() - startTime << std::endl;
+    }
+
+    void MeasureApp::SwitchHeatTimeFactor()
+    {
+        mHeatTimeFactor = (mHeatTimeFactor < MAX_HEAT_TIME_FACTOR) ? mHeatTimeFactor * 4.0 : 1.0;
+        InfoLog << "Heat geodesics time factor: " << mHeatTimeFactor << std::endl;
+        // the factorization depends on the time step, rebuild it with the new factor
+        GPPFREEPOINTER(mpHeatGeodesics);
+        if (mIsHeatGeodesicsMode)
+        {
+            mIsHeatGeodesicsMode = false;
+            SwitchHeatGeodesicsMode();
+        }
+    }
+
+    void MeasureApp::SwitchLocalGeodesicsMode()
+    {
+        mIsLocalGeodesicsMode = !mIsLocalGeodesicsMode;
+        InfoLog << "Local geodesics mode: " << mIsLocalGeodesicsMode << std::endl;
+    }
+
+    GPP::ErrorCode MeasureApp::ComputeLocalGeodesics(GPP::TriMesh* triMesh, std::vector<GPP::Vector3>& pathPoints, GPP::Real& distance,
+        std::vector<GPP::PointOnEdge>* pathInfos)
+    {
+        if (mpLocalGeodesics == NULL || !mpLocalGeodesics->IsBuiltFrom(triMesh))
+        {
+            GPPFREEPOINTER(mpLocalGeodesics);
+            mpLocalGeodesics = new LocalGeodesics;
+            GPP::ErrorCode res = mpLocalGeodesics->Init(triMesh);
+            if (res != GPP_NO_ERROR)
+            {
+                GPPFREEPOINTER(mpLocalGeodesics);
+                return res;
+            }
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        GPP::ErrorCode res = mpLocalGeodesics->ComputeExactGeodesics(mMarkIds, mIsGeodesicsClose, pathPoints, distance, pathInfos);
+        InfoLog << "Local geodesics: " << MagicCore::ToolKit::GetTime() - startTime << " last region vertex count " 
+            << mpLocalGeodesics->GetLastRegionVertexCount() << std::endl;
+        return res;
+    }
+
     void MeasureApp::FastComputeExactGeodesics(double accuracy, bool isSubThread)
     {
         if (IsCommandAvaliable() == false)
@@ -801,12 +1009,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -822,17 +1030,25 @@ namespace MagicApp
             GPP::Real distance = 0;
             //GPP::DumpOnce();
             mIsCommandInProgress = true;
-            GPP::ErrorCode res = GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, mMarkIds, mIsGeodesicsClose, 
-                pathPoints, distance, &pathInfos, accuracy);
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            if (mIsLocalGeodesicsMode)
+            {
+                res = ComputeLocalGeodesics(triMesh, pathPoints, distance, &pathInfos);
+            }
+            else
+            {
+                res = GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, mMarkIds, mIsGeodesicsClose, 
+                    pathPoints, distance, &pathInfos, accuracy);
+            }
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
@@ -851,17 +1067,17 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             return;
         }
-        else if (triMesh->GetVertexCount() > 200000 && isSubThread)
+        else if (triMesh->GetVertexCount() > 200000 && isSubThread && !mIsLocalGeodesicsMode)
         {
-            if (MessageBox(NULL, "񶥵200kʱȽϳǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+            if (MessageBox(NULL, "测量网格顶点大于200k，测量时间会比较长，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
             {
                 return;
             }
@@ -878,16 +1094,24 @@ namespace MagicApp
             GPP::Real distance = 0;
             //GPP::DumpOnce();
             mIsCommandInProgress = true;
-            GPP::ErrorCode res = GPP::MeasureMesh::ComputeExactGeodesics(triMesh, mMarkIds, mIsGeodesicsClose, pathPoints, distance, &pathInfos);
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            if (mIsLocalGeodesicsMode)
+            {
+                res = ComputeLocalGeodesics(triMesh, pathPoints, distance, &pathInfos);
+            }
+            else
+            {
+                res = GPP::MeasureMesh::ComputeExactGeodesics(triMesh, mMarkIds, mIsGeodesicsClose, pathPoints, distance, &pathInfos);
+            }
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
@@ -906,14 +1130,14 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         GPP::Real area = 0;
         GPP::ErrorCode res = GPP::MeasureMesh::ComputeArea(triMesh, area);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
@@ -932,14 +1156,14 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         GPP::Real volume = 0;
         GPP::ErrorCode res = GPP::MeasureMesh::ComputeVolume(triMesh, volume);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
@@ -958,14 +1182,14 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         std::vector<GPP::Real> curvature;
         GPP::ErrorCode res = GPP::MeasureMesh::ComputeMeanCurvature(triMesh, curvature);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
@@ -992,14 +1216,14 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         std::vector<GPP::Real> curvature;
         GPP::ErrorCode res = GPP::MeasureMesh::ComputeGaussCurvature(triMesh, curvature);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
@@ -1042,7 +1266,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1065,12 +1289,12 @@ namespace MagicApp
                     mMinCurvatureDirs, mMaxCurvatureDirs);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʼʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "主曲率计算失败", "温馨提示", MB_OK);
                     return;
                 }
                 mDisplayPrincipalCurvature = 1;
@@ -1087,7 +1311,7 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵҪ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
 
@@ -1103,7 +1327,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::MeasureMesh::ComputeThickness(measureMesh, thickness);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "计算厚度失败", "温馨提示", MB_OK);
                 return ;
             }
 
@@ -1139,12 +1363,12 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵҪ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         if (mpRefTriMesh == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考网格", "温馨提示", MB_OK);
             return;
         }
 
@@ -1161,23 +1385,37 @@ namespace MagicApp
             {
                 points.at(pid) = measureMesh->GetVertexCoord(pid);
             }
-            std::vector<GPP::Real> distances;
-            GPP::MeshQueryTool queryTool;
-            GPP::ErrorCode res = queryTool.Init(mpRefTriMesh);
-            if (res != GPP_NO_ERROR)
+            double startTime = MagicCore::ToolKit::GetTime();
+            // The distance tree is kept until the reference mesh is changed
+            if (mpRefDistanceTree == NULL || !mpRefDistanceTree->IsBuiltFrom(mpRefTriMesh))
             {
-                MessageBox(NULL, "빤߳ʼʧ", "ܰʾ", MB_OK);
-                return;
+                GPPFREEPOINTER(mpRefDistanceTree);
+                mpRefDistanceTree = new MeshDistanceTree;
+                GPP::ErrorCode res = mpRefDistanceTree->Init(mpRefTriMesh);
+                if (res != GPP_NO_ERROR)
+                {
+                    GPPFREEPOINTER(mpRefDistanceTree);
+                    MessageBox(NULL, "网格距离工具初始化失败", "温馨提示", MB_OK);
+                    return;
+                }
+                InfoLog << "  Build distance tree: " << MagicCore::ToolKit::GetTime() - startTime << " triangle count: "
+                    << mpRefDistanceTree->GetTriangleCount() << std::endl;
             }
-            res = queryTool.QueryNearestTriangles(points, NULL, &distances);
+            double queryTime = MagicCore::ToolKit::GetTime();
+            std::vector<GPP::Real> distances;
+            std::vector<GPP::Real> signedDistances;
+            GPP::ErrorCode res = mpRefDistanceTree->QueryPointsDistance(points, distances, &signedDistances);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "距离计算失败", "温馨提示", MB_OK);
                 return;
             }
+            InfoLog << "  Query points distance: " << MagicCore::ToolKit::GetTime() - queryTime << " point count: " << points.size() << std::endl;
             measureMesh->SetHasVertexColor(true);
             GPP::Real maxValue = *std::max_element(distances.begin(), distances.end());
             GPP::Real minValue = *std::min_element(distances.begin(), distances.end());
+            GPP::Real maxSignedValue = *std::max_element(signedDistances.begin(), signedDistances.end());
+            GPP::Real minSignedValue = *std::min_element(signedDistances.begin(), signedDistances.end());
             std::vector<GPP::Real> distancesCopy = distances;
             int halfPointId = ceil(double(distancesCopy.size()) / 2.0) - 1;
             std::nth_element(distancesCopy.begin(), distancesCopy.begin() + halfPointId, distancesCopy.end());
@@ -1186,13 +1424,16 @@ namespace MagicApp
             {
                 midDist = 1.0;
             }
+            // Signed deviation heatmap: green on the reference surface, blue outside and red inside
             for (GPP::Int pid = 0; pid < points.size(); ++pid)
             {
-                GPP::Real dist = distances.at(pid) / midDist * 0.2 + 0.2;
-                dist = dist > 0.8 ? 0.8 : dist;
+                GPP::Real dist = signedDistances.at(pid) / midDist * 0.1 + 0.6;
+                dist = dist < 0.2 ? 0.2 : (dist > 1.0 ? 1.0 : dist);
                 GPP::Vector3 color = MagicCore::ToolKit::ColorCoding(dist);
                 measureMesh->SetVertexColor(pid, color);
             }
+            InfoLog << "  Signed deviation: " << minSignedValue / ModelManager::Get()->GetScaleValue() << " ~ "
+                << maxSignedValue / ModelManager::Get()->GetScaleValue() << std::endl;
             mpUI->SetDistanceInfo(measureMesh->GetVertexCount(), true, 
                 minValue / ModelManager::Get()->GetScaleValue(), maxValue / ModelManager::Get()->GetScaleValue());
             mUpdateRefModelRendering = true;
@@ -1208,15 +1449,19 @@ namespace MagicApp
         }
     }
 
-    void MeasureApp::UpdateModelRendering()
+    void MeasureApp::UpdateModelRendering(bool isMeshChanged)
     {
         if (ModelManager::Get()->GetMesh() == NULL)
         {
             MagicCore::RenderSystem::Get()->HideRenderingObject("Mesh_Measure");
             return;
         }
+        if (isMeshChanged)
+        {
+            mRenderVersion++;
+        }
         MagicCore::RenderSystem::Get()->RenderMesh("Mesh_Measure", "CookTorrance", ModelManager::Get()->GetMesh(), 
-            MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, mIsFlatRenderingMode);
+            MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, mIsFlatRenderingMode, mRenderVersion);
     }
 
     void MeasureApp::UpdateRefModelRendering()
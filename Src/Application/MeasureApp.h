@@ -17,6 +17,9 @@ namespace MagicCore
 namespace MagicApp
 {
     class MeasureAppUI;
+    class MeshDistanceTree;
+    class HeatGeodesics;
+    class LocalGeodesics;
     class MeasureApp : public AppBase
     {
         enum CommandType
@@ -55,6 +58,11 @@ namespace MagicApp
         void ComputeExactGeodesics(bool isSubThread = true);
         void ComputeCurvatureGeodesics(int curvatureType, double curvatureWeight, bool isSubThread = true);
         void SmoothGeodesicsOnVertex(void);
+        void SwitchHeatGeodesicsMode(void);
+        void ComputeHeatGeodesics(void);
+        void CheckHeatGeodesicsAccuracy(void);
+        void SwitchHeatTimeFactor(void);
+        void SwitchLocalGeodesicsMode(void);
         
         void ComputePointsToMeshDistance(bool isSubThread = true);
         void ShowReferenceMesh(bool isShow);
@@ -81,9 +89,12 @@ namespace MagicApp
         bool IsCommandAvaliable(void);
 
         void InitViewTool(void);
-        void UpdateModelRendering(void);
+        // isMeshChanged: false if only the display mode is switched, then the cached buffers are shown
+        void UpdateModelRendering(bool isMeshChanged = true);
         void UpdateMarkRendering(void);
         void UpdateRefModelRendering(void);
+        GPP::ErrorCode ComputeLocalGeodesics(GPP::TriMesh* triMesh, std::vector<GPP::Vector3>& pathPoints, GPP::Real& distance,
+            std::vector<GPP::PointOnEdge>* pathInfos);
 
     private:
         MeasureAppUI* mpUI;
@@ -103,6 +114,7 @@ namespace MagicApp
         double mGeodesicAccuracy;
         bool mIsFlatRenderingMode;
         GPP::TriMesh* mpRefTriMesh;
+        MeshDistanceTree* mpRefDistanceTree;
         bool mUpdateRefModelRendering;
         std::vector<GPP::Real> mMinCurvature;
         std::vector<GPP::Real> mMaxCurvature;
@@ -112,5 +124,13 @@ namespace MagicApp
         GPP::Real mCurvatureWeight;
         bool mIsGeodesicsClose;
         int mCurvatureType;
+        HeatGeodesics* mpHeatGeodesics;
+        bool mIsHeatGeodesicsMode;
+        // See HeatGeodesics::SetTimeFactor
+        GPP::Real mHeatTimeFactor;
+        LocalGeodesics* mpLocalGeodesics;
+        bool mIsLocalGeodesicsMode;
+        // Version of the rendered mesh, see RenderSystem::RenderMesh
+        int mRenderVersion;
     };
 }
@@ -0,0 +1,636 @@
+#include "MeshAdjacency.h"
+#include "../Common/ParallelTool.h"
+#include <algorithm>
+
+namespace MagicApp
+{
+    // Count the unique edges of every bucket of the smaller vertex id, the bucket is sorted by the larger vertex id
+    class EdgeCountTask : public MagicCore::ParallelTask
+    {
+    public:
+        EdgeCountTask(const std::vector<GPP::Int>* bucketStart, const std::vector<GPP::Int>* otherIds,
+            std::vector<GPP::Int>* vertexEdgeCounts) :
+            mpBucketStart(bucketStart),
+            mpOtherIds(otherIds),
+            mpVertexEdgeCounts(vertexEdgeCounts)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                GPP::Int bucketStart = mpBucketStart->at(vid);
+                GPP::Int bucketEnd = mpBucketStart->at(vid + 1);
+                GPP::Int edgeCount = 0;
+                for (GPP::Int bid = bucketStart; bid < bucketEnd; bid++)
+                {
+                    if (bid == bucketStart || mpOtherIds->at(bid) != mpOtherIds->at(bid - 1))
+                    {
+                        edgeCount++;
+                    }
+                }
+                mpVertexEdgeCounts->at(vid) = edgeCount;
+            }
+        }
+
+    private:
+        const std::vector<GPP::Int>* mpBucketStart;
+        const std::vector<GPP::Int>* mpOtherIds;
+        std::vector<GPP::Int>* mpVertexEdgeCounts;
+    };
+
+    class EdgeFillTask : public MagicCore::ParallelTask
+    {
+    public:
+        EdgeFillTask(const std::vector<GPP::Int>* bucketStart, const std::vector<GPP::Int>* otherIds,
+            const std::vector<GPP::Int>* vertexEdgeStart, std::vector<GPP::Int>* edgeVertexIds, std::vector<GPP::Int>* edgeFaceStart) :
+            mpBucketStart(bucketStart),
+            mpOtherIds(otherIds),
+            mpVertexEdgeStart(vertexEdgeStart),
+            mpEdgeVertexIds(edgeVertexIds),
+            mpEdgeFaceStart(edgeFaceStart)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                GPP::Int bucketStart = mpBucketStart->at(vid);
+                GPP::Int bucketEnd = mpBucketStart->at(vid + 1);
+                GPP::Int edgeId = mpVertexEdgeStart->at(vid);
+                for (GPP::Int bid = bucketStart; bid < bucketEnd; bid++)
+                {
+                    if (bid == bucketStart || mpOtherIds->at(bid) != mpOtherIds->at(bid - 1))
+                    {
+                        mpEdgeVertexIds->at(edgeId * 2) = vid;
+                        mpEdgeVertexIds->at(edgeId * 2 + 1) = mpOtherIds->at(bid);
+                        mpEdgeFaceStart->at(edgeId) = bid;
+                        edgeId++;
+                    }
+                }
+            }
+        }
+
+    private:
+        const std::vector<GPP::Int>* mpBucketStart;
+        const std::vector<GPP::Int>* mpOtherIds;
+        const std::vector<GPP::Int>* mpVertexEdgeStart;
+        std::vector<GPP::Int>* mpEdgeVertexIds;
+        std::vector<GPP::Int>* mpEdgeFaceStart;
+    };
+
+    // Neighbors with larger ids are the edges starting from the vertex, which are already sorted
+    class UpperNeighborTask : public MagicCore::ParallelTask
+    {
+    public:
+        UpperNeighborTask(const std::vector<GPP::Int>* vertexEdgeStart, const std::vector<GPP::Int>* edgeVertexIds,
+            const std::vector<GPP::Int>* neighborStart, std::vector<GPP::Int>* neighborIds, std::vector<GPP::Int>* neighborEdgeIds) :
+            mpVertexEdgeStart(vertexEdgeStart),
+            mpEdgeVertexIds(edgeVertexIds),
+            mpNeighborStart(neighborStart),
+            mpNeighborIds(neighborIds),
+            mpNeighborEdgeIds(neighborEdgeIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                GPP::Int edgeStart = mpVertexEdgeStart->at(vid);
+                GPP::Int edgeEnd = mpVertexEdgeStart->at(vid + 1);
+                GPP::Int neighborId = mpNeighborStart->at(vid + 1) - (edgeEnd - edgeStart);
+                for (GPP::Int eid = edgeStart; eid < edgeEnd; eid++)
+                {
+                    mpNeighborIds->at(neighborId) = mpEdgeVertexIds->at(eid * 2 + 1);
+                    mpNeighborEdgeIds->at(neighborId) = eid;
+                    neighborId++;
+                }
+            }
+        }
+
+    private:
+        const std::vector<GPP::Int>* mpVertexEdgeStart;
+        const std::vector<GPP::Int>* mpEdgeVertexIds;
+        const std::vector<GPP::Int>* mpNeighborStart;
+        std::vector<GPP::Int>* mpNeighborIds;
+        std::vector<GPP::Int>* mpNeighborEdgeIds;
+    };
+
+    // A vertex is non-manifold if one of its edges has more than two faces, or its faces form more than one fan
+    class ClassifyVertexTask : public MagicCore::ParallelTask
+    {
+    public:
+        ClassifyVertexTask(const MeshAdjacency* adjacency, const std::vector<GPP::Int>* triangleVertexIds,
+            std::vector<unsigned char>* vertexFlags, unsigned char boundaryFlag, unsigned char nonManifoldFlag, unsigned char isolatedFlag) :
+            mpAdjacency(adjacency),
+            mpTriangleVertexIds(triangleVertexIds),
+            mpVertexFlags(vertexFlags),
+            mBoundaryFlag(boundaryFlag),
+            mNonManifoldFlag(nonManifoldFlag),
+            mIsolatedFlag(isolatedFlag)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            std::vector<bool> visitFlags;
+            std::vector<GPP::Int> faceStack;
+            for (int vid = startId; vid < endId; vid++)
+            {
+                unsigned char flag = 0;
+                GPP::Int faceCount = mpAdjacency->GetVertexFaceCount(vid);
+                if (faceCount == 0)
+                {
+                    mpVertexFlags->at(vid) = mIsolatedFlag;
+                    continue;
+                }
+                GPP::Int neighborCount = mpAdjacency->GetNeighborCount(vid);
+                const GPP::Int* neighborEdgeIds = mpAdjacency->GetNeighborEdgeIds(vid);
+                for (GPP::Int nid = 0; nid < neighborCount; nid++)
+                {
+                    GPP::Int edgeFaceCount = mpAdjacency->GetEdgeFaceCount(neighborEdgeIds[nid]);
+                    if (edgeFaceCount == 1)
+                    {
+                        flag |= mBoundaryFlag;
+                    }
+                    else if (edgeFaceCount > 2)
+                    {
+                        flag |= mNonManifoldFlag;
+                    }
+                }
+                if ((flag & mNonManifoldFlag) == 0 && CountFans(vid, faceCount, visitFlags, faceStack) > 1)
+                {
+                    flag |= mNonManifoldFlag;
+                }
+                mpVertexFlags->at(vid) = flag;
+            }
+        }
+
+    private:
+        GPP::Int CountFans(GPP::Int vertexId, GPP::Int faceCount, std::vector<bool>& visitFlags, std::vector<GPP::Int>& faceStack) const
+        {
+            const GPP::Int* faceIds = mpAdjacency->GetVertexFaceIds(vertexId);
+            visitFlags.assign(faceCount, false);
+            GPP::Int fanCount = 0;
+            for (GPP::Int seedId = 0; seedId < faceCount; seedId++)
+            {
+                if (visitFlags.at(seedId))
+                {
+                    continue;
+                }
+                fanCount++;
+                visitFlags.at(seedId) = true;
+                faceStack.clear();
+                faceStack.push_back(seedId);
+                while (!faceStack.empty())
+                {
+                    GPP::Int faceId = faceIds[faceStack.back()];
+                    faceStack.pop_back();
+                    for (int fvid = 0; fvid < 3; fvid++)
+                    {
+                        GPP::Int otherId = mpTriangleVertexIds->at(faceId * 3 + fvid);
+                        if (otherId == vertexId)
+                        {
+                            continue;
+                        }
+                        GPP::Int edgeId = mpAdjacency->GetEdgeId(vertexId, otherId);
+                        if (edgeId < 0)
+                        {
+                            continue;
+                        }
+                        GPP::Int edgeFaceCount = mpAdjacency->GetEdgeFaceCount(edgeId);
+                        const GPP::Int* edgeFaceIds = mpAdjacency->GetEdgeFaceIds(edgeId);
+                        for (GPP::Int efid = 0; efid < edgeFaceCount; efid++)
+                        {
+                            GPP::Int localId = GPP::Int(std::lower_bound(faceIds, faceIds + faceCount, edgeFaceIds[efid]) - faceIds);
+                            if (localId < faceCount && faceIds[localId] == edgeFaceIds[efid] && !visitFlags.at(localId))
+                            {
+                                visitFlags.at(localId) = true;
+                                faceStack.push_back(localId);
+                            }
+                        }
+                    }
+                }
+            }
+            return fanCount;
+        }
+
+        const MeshAdjacency* mpAdjacency;
+        const std::vector<GPP::Int>* mpTriangleVertexIds;
+        std::vector<unsigned char>* mpVertexFlags;
+        unsigned char mBoundaryFlag;
+        unsigned char mNonManifoldFlag;
+        unsigned char mIsolatedFlag;
+    };
+
+    MeshAdjacency::MeshAdjacency() :
+        mpTriMesh(NULL),
+        mMeshVersion(0),
+        mVertexCount(0),
+        mTriangleCount(0),
+        mTriangleVertexIds(),
+        mVertexEdgeStart(),
+        mEdgeVertexIds(),
+        mEdgeFaceStart(),
+        mEdgeFaceIds(),
+        mNeighborStart(),
+        mNeighborIds(),
+        mNeighborEdgeIds(),
+        mVertexFaceStart(),
+        mVertexFaceIds(),
+        mVertexFlags(),
+        mBoundaryEdgeCount(0),
+        mNonManifoldVertexCount(0)
+    {
+    }
+
+    MeshAdjacency::~MeshAdjacency()
+    {
+    }
+
+    GPP::ErrorCode MeshAdjacency::Init(const GPP::ITriMesh* triMesh, GPP::Int meshVersion)
+    {
+        Clear();
+        if (triMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        if (vertexCount < 3 || triangleCount < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mTriangleVertexIds.resize(triangleCount * 3);
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                if (vertexIds[fvid] < 0 || vertexIds[fvid] >= vertexCount)
+                {
+                    mTriangleVertexIds.clear();
+                    return GPP_INVALID_INPUT;
+                }
+                mTriangleVertexIds.at(fid * 3 + fvid) = vertexIds[fvid];
+            }
+        }
+        mpTriMesh = triMesh;
+        mMeshVersion = meshVersion;
+        mVertexCount = vertexCount;
+        mTriangleCount = triangleCount;
+
+        BuildEdges();
+        BuildVertexNeighbors();
+        BuildVertexFaces();
+        ClassifyVertices();
+
+        return GPP_NO_ERROR;
+    }
+
+    bool MeshAdjacency::IsBuiltFrom(const GPP::ITriMesh* triMesh, GPP::Int meshVersion) const
+    {
+        return triMesh != NULL && mpTriMesh == triMesh && mMeshVersion == meshVersion &&
+            mVertexCount == triMesh->GetVertexCount() && mTriangleCount == triMesh->GetTriangleCount();
+    }
+
+    void MeshAdjacency::Clear()
+    {
+        mpTriMesh = NULL;
+        mMeshVersion = 0;
+        mVertexCount = 0;
+        mTriangleCount = 0;
+        mTriangleVertexIds.clear();
+        mVertexEdgeStart.clear();
+        mEdgeVertexIds.clear();
+        mEdgeFaceStart.clear();
+        mEdgeFaceIds.clear();
+        mNeighborStart.clear();
+        mNeighborIds.clear();
+        mNeighborEdgeIds.clear();
+        mVertexFaceStart.clear();
+        mVertexFaceIds.clear();
+        mVertexFlags.clear();
+        mBoundaryEdgeCount = 0;
+        mNonManifoldVertexCount = 0;
+    }
+
+    void MeshAdjacency::BuildEdges()
+    {
+        // LSD radix sort of the directed edges with two stable counting passes, so the faces of an edge stay in face order.
+        // Degenerate edges of collapsed triangles are skipped
+        std::vector<GPP::Int> largeBucketStart(mVertexCount + 1, 0);
+        std::vector<GPP::Int> bucketStart(mVertexCount + 1, 0);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vertexId0 = mTriangleVertexIds.at(fid * 3 + fvid);
+                GPP::Int vertexId1 = mTriangleVertexIds.at(fid * 3 + (fvid + 1) % 3);
+                if (vertexId0 != vertexId1)
+                {
+                    bucketStart.at((vertexId0 < vertexId1 ? vertexId0 : vertexId1) + 1)++;
+                    largeBucketStart.at((vertexId0 < vertexId1 ? vertexId1 : vertexId0) + 1)++;
+                }
+            }
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            bucketStart.at(vid + 1) += bucketStart.at(vid);
+            largeBucketStart.at(vid + 1) += largeBucketStart.at(vid);
+        }
+        GPP::Int directedEdgeCount = bucketStart.at(mVertexCount);
+        // First digit: the larger vertex id
+        std::vector<GPP::Int> largeSortedMinIds(directedEdgeCount);
+        std::vector<GPP::Int> largeSortedFaceIds(directedEdgeCount);
+        std::vector<GPP::Int> fillPos(largeBucketStart.begin(), largeBucketStart.end() - 1);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vertexId0 = mTriangleVertexIds.at(fid * 3 + fvid);
+                GPP::Int vertexId1 = mTriangleVertexIds.at(fid * 3 + (fvid + 1) % 3);
+                if (vertexId0 == vertexId1)
+                {
+                    continue;
+                }
+                GPP::Int pos = fillPos.at(vertexId0 < vertexId1 ? vertexId1 : vertexId0)++;
+                largeSortedMinIds.at(pos) = vertexId0 < vertexId1 ? vertexId0 : vertexId1;
+                largeSortedFaceIds.at(pos) = fid;
+            }
+        }
+        // Second digit: the smaller vertex id, every bucket comes out sorted by the larger vertex id
+        std::vector<GPP::Int> otherIds(directedEdgeCount);
+        mEdgeFaceIds.resize(directedEdgeCount);
+        fillPos.assign(bucketStart.begin(), bucketStart.end() - 1);
+        for (GPP::Int largeId = 0; largeId < mVertexCount; largeId++)
+        {
+            for (GPP::Int lid = largeBucketStart.at(largeId); lid < largeBucketStart.at(largeId + 1); lid++)
+            {
+                GPP::Int pos = fillPos.at(largeSortedMinIds.at(lid))++;
+                otherIds.at(pos) = largeId;
+                mEdgeFaceIds.at(pos) = largeSortedFaceIds.at(lid);
+            }
+        }
+        largeSortedMinIds.clear();
+        largeSortedFaceIds.clear();
+
+        // The unique edges are numbered in (smaller id, larger id) order
+        std::vector<GPP::Int> vertexEdgeCounts(mVertexCount, 0);
+        EdgeCountTask countTask(&bucketStart, &otherIds, &vertexEdgeCounts);
+        MagicCore::ParallelTool::ParallelFor(mVertexCount, &countTask);
+        mVertexEdgeStart.resize(mVertexCount + 1);
+        mVertexEdgeStart.at(0) = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexEdgeStart.at(vid + 1) = mVertexEdgeStart.at(vid) + vertexEdgeCounts.at(vid);
+        }
+        GPP::Int edgeCount = mVertexEdgeStart.at(mVertexCount);
+        mEdgeVertexIds.resize(edgeCount * 2);
+        mEdgeFaceStart.resize(edgeCount + 1);
+        mEdgeFaceStart.at(edgeCount) = directedEdgeCount;
+        EdgeFillTask fillTask(&bucketStart, &otherIds, &mVertexEdgeStart, &mEdgeVertexIds, &mEdgeFaceStart);
+        MagicCore::ParallelTool::ParallelFor(mVertexCount, &fillTask);
+
+        mBoundaryEdgeCount = 0;
+        for (GPP::Int eid = 0; eid < edgeCount; eid++)
+        {
+            if (mEdgeFaceStart.at(eid + 1) - mEdgeFaceStart.at(eid) == 1)
+            {
+                mBoundaryEdgeCount++;
+            }
+        }
+    }
+
+    void MeshAdjacency::BuildVertexNeighbors()
+    {
+        GPP::Int edgeCount = GetEdgeCount();
+        mNeighborStart.assign(mVertexCount + 1, 0);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mNeighborStart.at(vid + 1) = mVertexEdgeStart.at(vid + 1) - mVertexEdgeStart.at(vid);
+        }
+        for (GPP::Int eid = 0; eid < edgeCount; eid++)
+        {
+            mNeighborStart.at(mEdgeVertexIds.at(eid * 2 + 1) + 1)++;
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mNeighborStart.at(vid + 1) += mNeighborStart.at(vid);
+        }
+        mNeighborIds.resize(edgeCount * 2);
+        mNeighborEdgeIds.resize(edgeCount * 2);
+        // Edges are visited in increasing smaller id, so the neighbors with smaller ids come out sorted
+        std::vector<GPP::Int> fillPos(mNeighborStart.begin(), mNeighborStart.end() - 1);
+        for (GPP::Int eid = 0; eid < edgeCount; eid++)
+        {
+            GPP::Int pos = fillPos.at(mEdgeVertexIds.at(eid * 2 + 1))++;
+            mNeighborIds.at(pos) = mEdgeVertexIds.at(eid * 2);
+            mNeighborEdgeIds.at(pos) = eid;
+        }
+        UpperNeighborTask upperTask(&mVertexEdgeStart, &mEdgeVertexIds, &mNeighborStart, &mNeighborIds, &mNeighborEdgeIds);
+        MagicCore::ParallelTool::ParallelFor(mVertexCount, &upperTask);
+    }
+
+    void MeshAdjacency::BuildVertexFaces()
+    {
+        mVertexFaceStart.assign(mVertexCount + 1, 0);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vertexId = mTriangleVertexIds.at(fid * 3 + fvid);
+                if (fvid > 0 && vertexId == mTriangleVertexIds.at(fid * 3))
+                {
+                    continue;
+                }
+                if (fvid == 2 && vertexId == mTriangleVertexIds.at(fid * 3 + 1))
+                {
+                    continue;
+                }
+                mVertexFaceStart.at(vertexId + 1)++;
+            }
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexFaceStart.at(vid + 1) += mVertexFaceStart.at(vid);
+        }
+        mVertexFaceIds.resize(mVertexFaceStart.at(mVertexCount));
+        std::vector<GPP::Int> fillPos(mVertexFaceStart.begin(), mVertexFaceStart.end() - 1);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vertexId = mTriangleVertexIds.at(fid * 3 + fvid);
+                if (fvid > 0 && vertexId == mTriangleVertexIds.at(fid * 3))
+                {
+                    continue;
+                }
+                if (fvid == 2 && vertexId == mTriangleVertexIds.at(fid * 3 + 1))
+                {
+                    continue;
+                }
+                mVertexFaceIds.at(fillPos.at(vertexId)++) = fid;
+            }
+        }
+    }
+
+    void MeshAdjacency::ClassifyVertices()
+    {
+        mVertexFlags.assign(mVertexCount, 0);
+        ClassifyVertexTask classifyTask(this, &mTriangleVertexIds, &mVertexFlags, VERTEX_BOUNDARY, VERTEX_NON_MANIFOLD, VERTEX_ISOLATED);
+        MagicCore::ParallelTool::ParallelFor(mVertexCount, &classifyTask);
+        mNonManifoldVertexCount = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            if (mVertexFlags.at(vid) & VERTEX_NON_MANIFOLD)
+            {
+                mNonManifoldVertexCount++;
+            }
+        }
+    }
+
+    GPP::Int MeshAdjacency::GetVertexCount() const
+    {
+        return mVertexCount;
+    }
+
+    GPP::Int MeshAdjacency::GetTriangleCount() const
+    {
+        return mTriangleCount;
+    }
+
+    GPP::Int MeshAdjacency::GetEdgeCount() const
+    {
+        return GPP::Int(mEdgeVertexIds.size() / 2);
+    }
+
+    GPP::Int MeshAdjacency::GetNeighborCount(GPP::Int vertexId) const
+    {
+        return mNeighborStart.at(vertexId + 1) - mNeighborStart.at(vertexId);
+    }
+
+    const GPP::Int* MeshAdjacency::GetNeighborIds(GPP::Int vertexId) const
+    {
+        return mNeighborIds.empty() ? NULL : &(mNeighborIds.at(0)) + mNeighborStart.at(vertexId);
+    }
+
+    const GPP::Int* MeshAdjacency::GetNeighborEdgeIds(GPP::Int vertexId) const
+    {
+        return mNeighborEdgeIds.empty() ? NULL : &(mNeighborEdgeIds.at(0)) + mNeighborStart.at(vertexId);
+    }
+
+    GPP::Int MeshAdjacency::GetVertexFaceCount(GPP::Int vertexId) const
+    {
+        return mVertexFaceStart.at(vertexId + 1) - mVertexFaceStart.at(vertexId);
+    }
+
+    const GPP::Int* MeshAdjacency::GetVertexFaceIds(GPP::Int vertexId) const
+    {
+        return mVertexFaceIds.empty() ? NULL : &(mVertexFaceIds.at(0)) + mVertexFaceStart.at(vertexId);
+    }
+
+    void MeshAdjacency::GetEdgeVertexIds(GPP::Int edgeId, GPP::Int edgeVertexIds[2]) const
+    {
+        edgeVertexIds[0] = mEdgeVertexIds.at(edgeId * 2);
+        edgeVertexIds[1] = mEdgeVertexIds.at(edgeId * 2 + 1);
+    }
+
+    GPP::Int MeshAdjacency::GetEdgeFaceCount(GPP::Int edgeId) const
+    {
+        return mEdgeFaceStart.at(edgeId + 1) - mEdgeFaceStart.at(edgeId);
+    }
+
+    const GPP::Int* MeshAdjacency::GetEdgeFaceIds(GPP::Int edgeId) const
+    {
+        return &(mEdgeFaceIds.at(0)) + mEdgeFaceStart.at(edgeId);
+    }
+
+    GPP::Int MeshAdjacency::GetEdgeId(GPP::Int vertexId0, GPP::Int vertexId1) const
+    {
+        if (vertexId0 == vertexId1 || vertexId0 < 0 || vertexId1 < 0 || vertexId0 >= mVertexCount || vertexId1 >= mVertexCount)
+        {
+            return -1;
+        }
+        GPP::Int minId = vertexId0 < vertexId1 ? vertexId0 : vertexId1;
+        GPP::Int maxId = vertexId0 < vertexId1 ? vertexId1 : vertexId0;
+        GPP::Int low = mVertexEdgeStart.at(minId);
+        GPP::Int high = mVertexEdgeStart.at(minId + 1);
+        while (low < high)
+        {
+            GPP::Int mid = (low + high) / 2;
+            if (mEdgeVertexIds.at(mid * 2 + 1) < maxId)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        if (low < mVertexEdgeStart.at(minId + 1) && mEdgeVertexIds.at(low * 2 + 1) == maxId)
+        {
+            return low;
+        }
+        return -1;
+    }
+
+    bool MeshAdjacency::IsBoundaryEdge(GPP::Int edgeId) const
+    {
+        return GetEdgeFaceCount(edgeId) == 1;
+    }
+
+    bool MeshAdjacency::IsNonManifoldEdge(GPP::Int edgeId) const
+    {
+        return GetEdgeFaceCount(edgeId) > 2;
+    }
+
+    bool MeshAdjacency::IsBoundaryVertex(GPP::Int vertexId) const
+    {
+        return (mVertexFlags.at(vertexId) & VERTEX_BOUNDARY) != 0;
+    }
+
+    bool MeshAdjacency::IsNonManifoldVertex(GPP::Int vertexId) const
+    {
+        return (mVertexFlags.at(vertexId) & VERTEX_NON_MANIFOLD) != 0;
+    }
+
+    bool MeshAdjacency::IsIsolatedVertex(GPP::Int vertexId) const
+    {
+        return (mVertexFlags.at(vertexId) & VERTEX_ISOLATED) != 0;
+    }
+
+    GPP::Int MeshAdjacency::GetBoundaryEdgeCount() const
+    {
+        return mBoundaryEdgeCount;
+    }
+
+    GPP::Int MeshAdjacency::GetNonManifoldVertexCount() const
+    {
+        return mNonManifoldVertexCount;
+    }
+
+    bool MeshAdjacency::IsManifold(GPP::Int* invalidVertexId) const
+    {
+        if (mNonManifoldVertexCount == 0)
+        {
+            return true;
+        }
+        if (invalidVertexId != NULL)
+        {
+            for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+            {
+                if (mVertexFlags.at(vid) & VERTEX_NON_MANIFOLD)
+                {
+                    *invalidVertexId = vid;
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+}
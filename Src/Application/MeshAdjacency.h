@@ -0,0 +1,84 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Compact CSR topology of a triangle mesh: vertex-vertex, vertex-face and edge-face adjacency.
+    // Directed edges are radix sorted by (smaller vertex id, larger vertex id) with two counting passes, so the edges come out
+    // in order and the faces of an edge are contiguous. Boundary and non-manifold flags are classified during the build.
+    // It only stores topology, so it stays valid until triangles are inserted, deleted or changed.
+    // USAGE: 1. adjacency.Init(triMesh, meshVersion);
+    //        2. adjacency.GetNeighborCount(vid), adjacency.GetNeighborIds(vid)[nid], adjacency.IsBoundaryVertex(vid)
+    class MeshAdjacency
+    {
+    public:
+        MeshAdjacency();
+        ~MeshAdjacency();
+
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh, GPP::Int meshVersion = 0);
+        // Whether it is built from triMesh with the same version and mesh size
+        bool IsBuiltFrom(const GPP::ITriMesh* triMesh, GPP::Int meshVersion = 0) const;
+        void Clear(void);
+
+        GPP::Int GetVertexCount(void) const;
+        GPP::Int GetTriangleCount(void) const;
+        GPP::Int GetEdgeCount(void) const;
+
+        // One ring neighbors in increasing id order, and the edge id to each neighbor
+        GPP::Int GetNeighborCount(GPP::Int vertexId) const;
+        const GPP::Int* GetNeighborIds(GPP::Int vertexId) const;
+        const GPP::Int* GetNeighborEdgeIds(GPP::Int vertexId) const;
+        GPP::Int GetVertexFaceCount(GPP::Int vertexId) const;
+        const GPP::Int* GetVertexFaceIds(GPP::Int vertexId) const;
+        // edgeVertexIds[0] < edgeVertexIds[1]
+        void GetEdgeVertexIds(GPP::Int edgeId, GPP::Int edgeVertexIds[2]) const;
+        GPP::Int GetEdgeFaceCount(GPP::Int edgeId) const;
+        const GPP::Int* GetEdgeFaceIds(GPP::Int edgeId) const;
+        // -1 if there is no edge between vertexId0 and vertexId1
+        GPP::Int GetEdgeId(GPP::Int vertexId0, GPP::Int vertexId1) const;
+
+        bool IsBoundaryEdge(GPP::Int edgeId) const;
+        bool IsNonManifoldEdge(GPP::Int edgeId) const;
+        bool IsBoundaryVertex(GPP::Int vertexId) const;
+        // Vertex with a non-manifold edge, or whose faces form more than one fan
+        bool IsNonManifoldVertex(GPP::Int vertexId) const;
+        bool IsIsolatedVertex(GPP::Int vertexId) const;
+        GPP::Int GetBoundaryEdgeCount(void) const;
+        GPP::Int GetNonManifoldVertexCount(void) const;
+        // invalidVertexId: one of the non-manifold vertices if it is not manifold
+        bool IsManifold(GPP::Int* invalidVertexId = NULL) const;
+
+    private:
+        enum VertexFlag
+        {
+            VERTEX_BOUNDARY = 1,
+            VERTEX_NON_MANIFOLD = 2,
+            VERTEX_ISOLATED = 4
+        };
+
+        void BuildEdges(void);
+        void BuildVertexNeighbors(void);
+        void BuildVertexFaces(void);
+        void ClassifyVertices(void);
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mMeshVersion;
+        GPP::Int mVertexCount;
+        GPP::Int mTriangleCount;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        std::vector<GPP::Int> mVertexEdgeStart;
+        std::vector<GPP::Int> mEdgeVertexIds;
+        std::vector<GPP::Int> mEdgeFaceStart;
+        std::vector<GPP::Int> mEdgeFaceIds;
+        std::vector<GPP::Int> mNeighborStart;
+        std::vector<GPP::Int> mNeighborIds;
+        std::vector<GPP::Int> mNeighborEdgeIds;
+        std::vector<GPP::Int> mVertexFaceStart;
+        std::vector<GPP::Int> mVertexFaceIds;
+        std::vector<unsigned char> mVertexFlags;
+        GPP::Int mBoundaryEdgeCount;
+        GPP::Int mNonManifoldVertexCount;
+    };
+}
@@ -0,0 +1,782 @@
+#include "MeshDistanceTree.h"
+#include "../Common/ParallelTool.h"
+#include <xmmintrin.h>
+#include <malloc.h>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+namespace MagicApp
+{
+    static const GPP::Int DISTANCE_TREE_LEAF_SIZE = 8;
+    // The traversal stack holds at most one node per level, Init rejects deeper trees
+    static const int DISTANCE_TREE_STACK_SIZE = 128;
+    // Nearest feature of a triangle: vertex a, b, c, edge ab, bc, ca, or the inside
+    static const int CLOSEST_VERTEX = 0;
+    static const int CLOSEST_EDGE = 3;
+    static const int CLOSEST_FACE = 6;
+
+    // Four triangles in SoA layout, padding lanes repeat the first triangle of the pack
+    struct DistanceTrianglePack
+    {
+        __m128 mA[3];
+        __m128 mB[3];
+        __m128 mC[3];
+        __m128 mNormal[3];
+        __m128 mInvEdgeLengthSquared[3];
+        GPP::Int mFaceIds[4];
+    };
+
+    static inline __m128 Dot3(const __m128* a, const __m128* b)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+    }
+
+    static inline __m128 SegmentDistanceSquared(const __m128* w, const __m128* edge, __m128 invEdgeLengthSquared)
+    {
+        __m128 t = _mm_mul_ps(Dot3(w, edge), invEdgeLengthSquared);
+        t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128 d[3];
+        for (int cid = 0; cid < 3; cid++)
+        {
+            d[cid] = _mm_sub_ps(w[cid], _mm_mul_ps(t, edge[cid]));
+        }
+        return Dot3(d, d);
+    }
+
+    // dot(normal, edge x w) >= 0
+    static inline __m128 InsideEdgeMask(const __m128* normal, const __m128* edge, const __m128* w)
+    {
+        __m128 crossValue[3];
+        crossValue[0] = _mm_sub_ps(_mm_mul_ps(edge[1], w[2]), _mm_mul_ps(edge[2], w[1]));
+        crossValue[1] = _mm_sub_ps(_mm_mul_ps(edge[2], w[0]), _mm_mul_ps(edge[0], w[2]));
+        crossValue[2] = _mm_sub_ps(_mm_mul_ps(edge[0], w[1]), _mm_mul_ps(edge[1], w[0]));
+        return _mm_cmpge_ps(Dot3(normal, crossValue), _mm_setzero_ps());
+    }
+
+    // Squared distances from point to the four triangles of the pack
+    static inline __m128 PackDistanceSquared(const DistanceTrianglePack& pack, const __m128* point)
+    {
+        __m128 wa[3], wb[3], wc[3], e0[3], e1[3], e2[3];
+        for (int cid = 0; cid < 3; cid++)
+        {
+            wa[cid] = _mm_sub_ps(point[cid], pack.mA[cid]);
+            wb[cid] = _mm_sub_ps(point[cid], pack.mB[cid]);
+            wc[cid] = _mm_sub_ps(point[cid], pack.mC[cid]);
+            e0[cid] = _mm_sub_ps(pack.mB[cid], pack.mA[cid]);
+            e1[cid] = _mm_sub_ps(pack.mC[cid], pack.mB[cid]);
+            e2[cid] = _mm_sub_ps(pack.mA[cid], pack.mC[cid]);
+        }
+        // degenerated triangles have zero normal and always use the edge distance
+        __m128 insideMask = _mm_cmpgt_ps(Dot3(pack.mNormal, pack.mNormal), _mm_set1_ps(0.5f));
+        insideMask = _mm_and_ps(insideMask, InsideEdgeMask(pack.mNormal, e0, wa));
+        insideMask = _mm_and_ps(insideMask, InsideEdgeMask(pack.mNormal, e1, wb));
+        insideMask = _mm_and_ps(insideMask, InsideEdgeMask(pack.mNormal, e2, wc));
+        __m128 planeDistance = Dot3(wa, pack.mNormal);
+        __m128 planeDistanceSquared = _mm_mul_ps(planeDistance, planeDistance);
+        __m128 edgeDistanceSquared = SegmentDistanceSquared(wa, e0, pack.mInvEdgeLengthSquared[0]);
+        edgeDistanceSquared = _mm_min_ps(edgeDistanceSquared, SegmentDistanceSquared(wb, e1, pack.mInvEdgeLengthSquared[1]));
+        edgeDistanceSquared = _mm_min_ps(edgeDistanceSquared, SegmentDistanceSquared(wc, e2, pack.mInvEdgeLengthSquared[2]));
+        return _mm_or_ps(_mm_and_ps(insideMask, planeDistanceSquared), _mm_andnot_ps(insideMask, edgeDistanceSquared));
+    }
+
+    static inline float BoxDistanceSquared(const DistanceTreeNode& node, __m128 point)
+    {
+        __m128 d = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.mBoxMin), point), _mm_sub_ps(point, _mm_loadu_ps(node.mBoxMax)));
+        d = _mm_max_ps(d, _mm_setzero_ps());
+        d = _mm_mul_ps(d, d);
+        float values[4];
+        _mm_storeu_ps(values, d);
+        return values[0] + values[1] + values[2];
+    }
+
+    // feature is set to the nearest feature, CLOSEST_VERTEX + corner, CLOSEST_EDGE + corner of the edge start, or CLOSEST_FACE
+    static GPP::Vector3 ClosestPointOnTriangle(const GPP::Vector3& p, const GPP::Vector3& a, const GPP::Vector3& b, const GPP::Vector3& c,
+        int& feature)
+    {
+        GPP::Vector3 ab = b - a;
+        GPP::Vector3 ac = c - a;
+        GPP::Vector3 ap = p - a;
+        GPP::Real d1 = ab * ap;
+        GPP::Real d2 = ac * ap;
+        feature = CLOSEST_VERTEX;
+        if (d1 <= 0 && d2 <= 0)
+        {
+            return a;
+        }
+        GPP::Vector3 bp = p - b;
+        GPP::Real d3 = ab * bp;
+        GPP::Real d4 = ac * bp;
+        if (d3 >= 0 && d4 <= d3)
+        {
+            feature = CLOSEST_VERTEX + 1;
+            return b;
+        }
+        GPP::Real vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        {
+            GPP::Real denom = d1 - d3;
+            if (denom <= GPP::REAL_TOL)
+            {
+                return a;
+            }
+            feature = CLOSEST_EDGE;
+            return a + ab * (d1 / denom);
+        }
+        GPP::Vector3 cp = p - c;
+        GPP::Real d5 = ab * cp;
+        GPP::Real d6 = ac * cp;
+        if (d6 >= 0 && d5 <= d6)
+        {
+            feature = CLOSEST_VERTEX + 2;
+            return c;
+        }
+        GPP::Real vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        {
+            GPP::Real denom = d2 - d6;
+            if (denom <= GPP::REAL_TOL)
+            {
+                return a;
+            }
+            feature = CLOSEST_EDGE + 2;
+            return a + ac * (d2 / denom);
+        }
+        GPP::Real va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        {
+            GPP::Real denom = (d4 - d3) + (d5 - d6);
+            if (denom <= GPP::REAL_TOL)
+            {
+                feature = CLOSEST_VERTEX + 1;
+                return b;
+            }
+            feature = CLOSEST_EDGE + 1;
+            return b + (c - b) * ((d4 - d3) / denom);
+        }
+        GPP::Real denom = va + vb + vc;
+        if (denom < GPP::REAL_TOL)
+        {
+            return a;
+        }
+        feature = CLOSEST_FACE;
+        return a + ab * (vb / denom) + ac * (vc / denom);
+    }
+
+    struct DistanceTreeEdge
+    {
+        GPP::Int mVertexId0;
+        GPP::Int mVertexId1;
+        GPP::Int mCornerId;
+
+        bool operator < (const DistanceTreeEdge& edge) const
+        {
+            if (mVertexId0 != edge.mVertexId0)
+            {
+                return mVertexId0 < edge.mVertexId0;
+            }
+            return mVertexId1 < edge.mVertexId1;
+        }
+    };
+
+    class TriangleBoundTask : public MagicCore::ParallelTask
+    {
+    public:
+        TriangleBoundTask(const std::vector<GPP::Vector3>* vertexCoords, const std::vector<GPP::Int>* triangleVertexIds,
+            std::vector<float>* triangleCenters, std::vector<float>* triangleBoxes) :
+            mpVertexCoords(vertexCoords),
+            mpTriangleVertexIds(triangleVertexIds),
+            mpTriangleCenters(triangleCenters),
+            mpTriangleBoxes(triangleBoxes)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int fid = startId; fid < endId; fid++)
+            {
+                for (int cid = 0; cid < 3; cid++)
+                {
+                    GPP::Real minValue = GPP::REAL_LARGE;
+                    GPP::Real maxValue = -GPP::REAL_LARGE;
+                    for (int fvid = 0; fvid < 3; fvid++)
+                    {
+                        GPP::Real value = mpVertexCoords->at(mpTriangleVertexIds->at(fid * 3 + fvid))[cid];
+                        minValue = value < minValue ? value : minValue;
+                        maxValue = value > maxValue ? value : maxValue;
+                    }
+                    mpTriangleBoxes->at(fid * 6 + cid) = float(minValue);
+                    mpTriangleBoxes->at(fid * 6 + 3 + cid) = float(maxValue);
+                    mpTriangleCenters->at(fid * 3 + cid) = float((minValue + maxValue) / 2.0);
+                }
+            }
+        }
+
+    private:
+        const std::vector<GPP::Vector3>* mpVertexCoords;
+        const std::vector<GPP::Int>* mpTriangleVertexIds;
+        std::vector<float>* mpTriangleCenters;
+        std::vector<float>* mpTriangleBoxes;
+    };
+
+    class BuildPackTask : public MagicCore::ParallelTask
+    {
+    public:
+        BuildPackTask(const std::vector<DistanceTreeNode>* nodes, const std::vector<GPP::Int>* leafNodeIds, const std::vector<GPP::Int>* triangleIds,
+            const std::vector<GPP::Vector3>* vertexCoords, const std::vector<GPP::Int>* triangleVertexIds, DistanceTrianglePack* packs) :
+            mpNodes(nodes),
+            mpLeafNodeIds(leafNodeIds),
+            mpTriangleIds(triangleIds),
+            mpVertexCoords(vertexCoords),
+            mpTriangleVertexIds(triangleVertexIds),
+            mpPacks(packs)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int lid = startId; lid < endId; lid++)
+            {
+                const DistanceTreeNode& node = mpNodes->at(mpLeafNodeIds->at(lid));
+                GPP::Int packCount = (node.mTriangleCount + 3) / 4;
+                for (GPP::Int packId = 0; packId < packCount; packId++)
+                {
+                    DistanceTrianglePack& pack = mpPacks[node.mPackStart + packId];
+                    float values[15][4];
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        GPP::Int localId = packId * 4 + lane;
+                        if (localId >= node.mTriangleCount)
+                        {
+                            localId = packId * 4;
+                        }
+                        GPP::Int faceId = mpTriangleIds->at(node.mTriangleStart + localId);
+                        pack.mFaceIds[lane] = faceId;
+                        GPP::Vector3 coords[3];
+                        for (int fvid = 0; fvid < 3; fvid++)
+                        {
+                            coords[fvid] = mpVertexCoords->at(mpTriangleVertexIds->at(faceId * 3 + fvid));
+                        }
+                        GPP::Vector3 normal = (coords[1] - coords[0]).CrossProduct(coords[2] - coords[0]);
+                        if (normal.Normalise() < GPP::REAL_TOL)
+                        {
+                            normal = GPP::Vector3(0, 0, 0);
+                        }
+                        for (int cid = 0; cid < 3; cid++)
+                        {
+                            values[cid][lane] = float(coords[0][cid]);
+                            values[3 + cid][lane] = float(coords[1][cid]);
+                            values[6 + cid][lane] = float(coords[2][cid]);
+                            values[9 + cid][lane] = float(normal[cid]);
+                        }
+                        for (int eid = 0; eid < 3; eid++)
+                        {
+                            GPP::Real edgeLengthSquared = (coords[(eid + 1) % 3] - coords[eid]).LengthSquared();
+                            values[12 + eid][lane] = edgeLengthSquared > GPP::REAL_TOL * GPP::REAL_TOL ? float(1.0 / edgeLengthSquared) : 0.0f;
+                        }
+                    }
+                    for (int cid = 0; cid < 3; cid++)
+                    {
+                        pack.mA[cid] = _mm_loadu_ps(values[cid]);
+                        pack.mB[cid] = _mm_loadu_ps(values[3 + cid]);
+                        pack.mC[cid] = _mm_loadu_ps(values[6 + cid]);
+                        pack.mNormal[cid] = _mm_loadu_ps(values[9 + cid]);
+                        pack.mInvEdgeLengthSquared[cid] = _mm_loadu_ps(values[12 + cid]);
+                    }
+                }
+            }
+        }
+
+    private:
+        const std::vector<DistanceTreeNode>* mpNodes;
+        const std::vector<GPP::Int>* mpLeafNodeIds;
+        const std::vector<GPP::Int>* mpTriangleIds;
+        const std::vector<GPP::Vector3>* mpVertexCoords;
+        const std::vector<GPP::Int>* mpTriangleVertexIds;
+        DistanceTrianglePack* mpPacks;
+    };
+
+    class QueryDistanceTask : public MagicCore::ParallelTask
+    {
+    public:
+        QueryDistanceTask(const MeshDistanceTree* tree, const std::vector<GPP::Vector3>* queryCoords, std::vector<GPP::Real>* distances,
+            std::vector<GPP::Real>* signedDistances, std::vector<GPP::Int>* faceIds) :
+            mpTree(tree),
+            mpQueryCoords(queryCoords),
+            mpDistances(distances),
+            mpSignedDistances(signedDistances),
+            mpFaceIds(faceIds),
+            mFailedCounts(MagicCore::ParallelTool::GetThreadCount(), 0)
+        {
+        }
+
+        GPP::Int GetFailedCount(void) const
+        {
+            GPP::Int failedCount = 0;
+            for (std::vector<GPP::Int>::const_iterator itr = mFailedCounts.begin(); itr != mFailedCounts.end(); ++itr)
+            {
+                failedCount += *itr;
+            }
+            return failedCount;
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int faceId = -1;
+            GPP::Real distance = 0;
+            GPP::Real signedDistance = 0;
+            for (int pid = startId; pid < endId; pid++)
+            {
+                if (mpTree->QueryNearestTriangle(mpQueryCoords->at(pid), &faceId, &distance, &signedDistance) != GPP_NO_ERROR)
+                {
+                    faceId = -1;
+                    distance = -1;
+                    signedDistance = 0;
+                    mFailedCounts.at(threadId)++;
+                }
+                mpDistances->at(pid) = distance;
+                if (mpSignedDistances)
+                {
+                    mpSignedDistances->at(pid) = signedDistance;
+                }
+                if (mpFaceIds)
+                {
+                    mpFaceIds->at(pid) = faceId;
+                }
+            }
+        }
+
+    private:
+        const MeshDistanceTree* mpTree;
+        const std::vector<GPP::Vector3>* mpQueryCoords;
+        std::vector<GPP::Real>* mpDistances;
+        std::vector<GPP::Real>* mpSignedDistances;
+        std::vector<GPP::Int>* mpFaceIds;
+        // Failed queries of every thread
+        std::vector<GPP::Int> mFailedCounts;
+    };
+
+    class CenterAxisLess
+    {
+    public:
+        CenterAxisLess(const std::vector<float>* triangleCenters, int axis) :
+            mpTriangleCenters(triangleCenters),
+            mAxis(axis)
+        {
+        }
+
+        bool operator()(GPP::Int fid0, GPP::Int fid1) const
+        {
+            return mpTriangleCenters->at(fid0 * 3 + mAxis) < mpTriangleCenters->at(fid1 * 3 + mAxis);
+        }
+
+    private:
+        const std::vector<float>* mpTriangleCenters;
+        int mAxis;
+    };
+
+    MeshDistanceTree::MeshDistanceTree() :
+        mpRefTriMesh(NULL),
+        mRefVertexCount(0),
+        mRefTriangleCount(0),
+        mVertexCoords(),
+        mTriangleVertexIds(),
+        mTriangleNeighbors(),
+        mVertexPseudoNormals(),
+        mNodes(),
+        mTreeDepth(0),
+        mpPacks(NULL),
+        mPackCount(0)
+    {
+    }
+
+    MeshDistanceTree::~MeshDistanceTree()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode MeshDistanceTree::Init(const GPP::ITriMesh* refTriMesh)
+    {
+        Clear();
+        if (refTriMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = refTriMesh->GetVertexCount();
+        GPP::Int triangleCount = refTriMesh->GetTriangleCount();
+        if (vertexCount < 3 || triangleCount < 1)
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        mVertexCoords.resize(vertexCount);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            mVertexCoords.at(vid) = refTriMesh->GetVertexCoord(vid);
+        }
+        mTriangleVertexIds.resize(triangleCount * 3);
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            refTriMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                if (vertexIds[fvid] < 0 || vertexIds[fvid] >= vertexCount)
+                {
+                    Clear();
+                    return GPP_INVALID_INPUT;
+                }
+                mTriangleVertexIds.at(fid * 3 + fvid) = vertexIds[fvid];
+            }
+        }
+
+        std::vector<float> triangleCenters(triangleCount * 3);
+        std::vector<float> triangleBoxes(triangleCount * 6);
+        TriangleBoundTask boundTask(&mVertexCoords, &mTriangleVertexIds, &triangleCenters, &triangleBoxes);
+        MagicCore::ParallelTool::ParallelFor(triangleCount, &boundTask);
+
+        std::vector<GPP::Int> triangleIds(triangleCount);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triangleIds.at(fid) = fid;
+        }
+        mNodes.reserve(triangleCount / DISTANCE_TREE_LEAF_SIZE * 4 + 1);
+        BuildNode(triangleIds, 0, triangleCount, triangleCenters, triangleBoxes, 1);
+        if (mTreeDepth >= DISTANCE_TREE_STACK_SIZE)
+        {
+            Clear();
+            return GPP_INVALID_INPUT;
+        }
+        BuildLeafPacks(triangleIds);
+        BuildPseudoNormals();
+
+        mpRefTriMesh = refTriMesh;
+        mRefVertexCount = vertexCount;
+        mRefTriangleCount = triangleCount;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int MeshDistanceTree::BuildNode(std::vector<GPP::Int>& triangleIds, GPP::Int startId, GPP::Int endId,
+        const std::vector<float>& triangleCenters, const std::vector<float>& triangleBoxes, int depth)
+    {
+        GPP::Int nodeId = mNodes.size();
+        mTreeDepth = depth > mTreeDepth ? depth : mTreeDepth;
+        DistanceTreeNode node;
+        float centerMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+        float centerMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        for (int cid = 0; cid < 3; cid++)
+        {
+            node.mBoxMin[cid] = FLT_MAX;
+            node.mBoxMax[cid] = -FLT_MAX;
+        }
+        node.mBoxMin[3] = 0;
+        node.mBoxMax[3] = 0;
+        for (GPP::Int tid = startId; tid < endId; tid++)
+        {
+            GPP::Int fid = triangleIds.at(tid);
+            for (int cid = 0; cid < 3; cid++)
+            {
+                node.mBoxMin[cid] = std::min(node.mBoxMin[cid], triangleBoxes.at(fid * 6 + cid));
+                node.mBoxMax[cid] = std::max(node.mBoxMax[cid], triangleBoxes.at(fid * 6 + 3 + cid));
+                centerMin[cid] = std::min(centerMin[cid], triangleCenters.at(fid * 3 + cid));
+                centerMax[cid] = std::max(centerMax[cid], triangleCenters.at(fid * 3 + cid));
+            }
+        }
+        node.mRightChild = -1;
+        node.mTriangleStart = startId;
+        node.mTriangleCount = 0;
+        node.mPackStart = -1;
+        mNodes.push_back(node);
+        if (endId - startId <= DISTANCE_TREE_LEAF_SIZE)
+        {
+            mNodes.at(nodeId).mTriangleCount = endId - startId;
+            return nodeId;
+        }
+        int splitAxis = 0;
+        for (int cid = 1; cid < 3; cid++)
+        {
+            if (centerMax[cid] - centerMin[cid] > centerMax[splitAxis] - centerMin[splitAxis])
+            {
+                splitAxis = cid;
+            }
+        }
+        GPP::Int midId = (startId + endId) / 2;
+        std::nth_element(triangleIds.begin() + startId, triangleIds.begin() + midId, triangleIds.begin() + endId,
+            CenterAxisLess(&triangleCenters, splitAxis));
+        BuildNode(triangleIds, startId, midId, triangleCenters, triangleBoxes, depth + 1);
+        GPP::Int rightChild = BuildNode(triangleIds, midId, endId, triangleCenters, triangleBoxes, depth + 1);
+        mNodes.at(nodeId).mRightChild = rightChild;
+        return nodeId;
+    }
+
+    void MeshDistanceTree::BuildLeafPacks(const std::vector<GPP::Int>& triangleIds)
+    {
+        std::vector<GPP::Int> leafNodeIds;
+        mPackCount = 0;
+        GPP::Int nodeCount = mNodes.size();
+        for (GPP::Int nid = 0; nid < nodeCount; nid++)
+        {
+            DistanceTreeNode& node = mNodes.at(nid);
+            if (node.mTriangleCount > 0)
+            {
+                node.mPackStart = mPackCount;
+                mPackCount += (node.mTriangleCount + 3) / 4;
+                leafNodeIds.push_back(nid);
+            }
+        }
+        mpPacks = (DistanceTrianglePack*)_aligned_malloc(sizeof(DistanceTrianglePack) * mPackCount, 16);
+        BuildPackTask packTask(&mNodes, &leafNodeIds, &triangleIds, &mVertexCoords, &mTriangleVertexIds, mpPacks);
+        MagicCore::ParallelTool::ParallelFor(leafNodeIds.size(), &packTask);
+    }
+
+    void MeshDistanceTree::BuildPseudoNormals()
+    {
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        // Triangles across an edge are found by sorting the edges of all corners
+        std::vector<DistanceTreeEdge> edges(triangleCount * 3);
+        for (GPP::Int cornerId = 0; cornerId < triangleCount * 3; cornerId++)
+        {
+            GPP::Int vertexId0 = mTriangleVertexIds.at(cornerId);
+            GPP::Int vertexId1 = mTriangleVertexIds.at(cornerId - cornerId % 3 + (cornerId + 1) % 3);
+            DistanceTreeEdge& edge = edges.at(cornerId);
+            edge.mVertexId0 = vertexId0 < vertexId1 ? vertexId0 : vertexId1;
+            edge.mVertexId1 = vertexId0 < vertexId1 ? vertexId1 : vertexId0;
+            edge.mCornerId = cornerId;
+        }
+        std::sort(edges.begin(), edges.end());
+        mTriangleNeighbors.assign(triangleCount * 3, -1);
+        GPP::Int edgeCount = edges.size();
+        for (GPP::Int startId = 0; startId < edgeCount; )
+        {
+            GPP::Int endId = startId + 1;
+            while (endId < edgeCount && !(edges.at(startId) < edges.at(endId)))
+            {
+                endId++;
+            }
+            if (endId - startId == 2)
+            {
+                GPP::Int cornerId0 = edges.at(startId).mCornerId;
+                GPP::Int cornerId1 = edges.at(startId + 1).mCornerId;
+                mTriangleNeighbors.at(cornerId0) = cornerId1 / 3;
+                mTriangleNeighbors.at(cornerId1) = cornerId0 / 3;
+            }
+            startId = endId;
+        }
+        std::vector<DistanceTreeEdge>().swap(edges);
+
+        mVertexPseudoNormals.assign(mVertexCoords.size(), GPP::Vector3(0, 0, 0));
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            GPP::Vector3 normal = GetTriangleNormal(fid);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vertexId = mTriangleVertexIds.at(fid * 3 + fvid);
+                GPP::Vector3 edge0 = mVertexCoords.at(mTriangleVertexIds.at(fid * 3 + (fvid + 1) % 3)) - mVertexCoords.at(vertexId);
+                GPP::Vector3 edge1 = mVertexCoords.at(mTriangleVertexIds.at(fid * 3 + (fvid + 2) % 3)) - mVertexCoords.at(vertexId);
+                if (edge0.Normalise() < GPP::REAL_TOL || edge1.Normalise() < GPP::REAL_TOL)
+                {
+                    continue;
+                }
+                GPP::Real cosAngle = edge0 * edge1;
+                cosAngle = cosAngle > 1 ? 1 : (cosAngle < -1 ? -1 : cosAngle);
+                mVertexPseudoNormals.at(vertexId) += normal * acos(cosAngle);
+            }
+        }
+    }
+
+    GPP::Vector3 MeshDistanceTree::GetTriangleNormal(GPP::Int faceId) const
+    {
+        const GPP::Vector3& a = mVertexCoords[mTriangleVertexIds[faceId * 3]];
+        const GPP::Vector3& b = mVertexCoords[mTriangleVertexIds[faceId * 3 + 1]];
+        const GPP::Vector3& c = mVertexCoords[mTriangleVertexIds[faceId * 3 + 2]];
+        GPP::Vector3 normal = (b - a).CrossProduct(c - a);
+        if (normal.Normalise() < GPP::REAL_TOL)
+        {
+            return GPP::Vector3(0, 0, 0);
+        }
+        return normal;
+    }
+
+    void MeshDistanceTree::Clear()
+    {
+        mpRefTriMesh = NULL;
+        mRefVertexCount = 0;
+        mRefTriangleCount = 0;
+        mVertexCoords.clear();
+        mTriangleVertexIds.clear();
+        mTriangleNeighbors.clear();
+        mVertexPseudoNormals.clear();
+        mNodes.clear();
+        mTreeDepth = 0;
+        if (mpPacks != NULL)
+        {
+            _aligned_free(mpPacks);
+            mpPacks = NULL;
+        }
+        mPackCount = 0;
+    }
+
+    bool MeshDistanceTree::IsBuiltFrom(const GPP::ITriMesh* refTriMesh) const
+    {
+        return refTriMesh != NULL && mpRefTriMesh == refTriMesh && refTriMesh->GetVertexCount() == mRefVertexCount &&
+            refTriMesh->GetTriangleCount() == mRefTriangleCount;
+    }
+
+    GPP::Int MeshDistanceTree::GetTriangleCount() const
+    {
+        return mRefTriangleCount;
+    }
+
+    GPP::Int MeshDistanceTree::FindNearestTriangle(const float queryCoord[3]) const
+    {
+        __m128 point = _mm_set_ps(0.0f, queryCoord[2], queryCoord[1], queryCoord[0]);
+        __m128 pointSoA[3] = {_mm_set1_ps(queryCoord[0]), _mm_set1_ps(queryCoord[1]), _mm_set1_ps(queryCoord[2])};
+        float bestDistanceSquared = FLT_MAX;
+        GPP::Int bestFaceId = -1;
+        GPP::Int nodeStack[DISTANCE_TREE_STACK_SIZE];
+        float nodeDistanceStack[DISTANCE_TREE_STACK_SIZE];
+        int stackSize = 0;
+        nodeStack[stackSize] = 0;
+        nodeDistanceStack[stackSize] = BoxDistanceSquared(mNodes.at(0), point);
+        stackSize++;
+        while (stackSize > 0)
+        {
+            stackSize--;
+            if (nodeDistanceStack[stackSize] >= bestDistanceSquared)
+            {
+                continue;
+            }
+            GPP::Int nodeId = nodeStack[stackSize];
+            while (true)
+            {
+                const DistanceTreeNode& node = mNodes[nodeId];
+                if (node.mTriangleCount > 0)
+                {
+                    GPP::Int packEnd = node.mPackStart + (node.mTriangleCount + 3) / 4;
+                    for (GPP::Int packId = node.mPackStart; packId < packEnd; packId++)
+                    {
+                        float distanceSquared[4];
+                        _mm_storeu_ps(distanceSquared, PackDistanceSquared(mpPacks[packId], pointSoA));
+                        for (int lane = 0; lane < 4; lane++)
+                        {
+                            if (distanceSquared[lane] < bestDistanceSquared)
+                            {
+                                bestDistanceSquared = distanceSquared[lane];
+                                bestFaceId = mpPacks[packId].mFaceIds[lane];
+                            }
+                        }
+                    }
+                    break;
+                }
+                // Visit the nearer child first, and push the farther one
+                GPP::Int leftChild = nodeId + 1;
+                GPP::Int rightChild = node.mRightChild;
+                float leftDistance = BoxDistanceSquared(mNodes[leftChild], point);
+                float rightDistance = BoxDistanceSquared(mNodes[rightChild], point);
+                if (rightDistance < leftDistance)
+                {
+                    std::swap(leftChild, rightChild);
+                    std::swap(leftDistance, rightDistance);
+                }
+                if (leftDistance >= bestDistanceSquared)
+                {
+                    break;
+                }
+                // Every stacked node is the sibling of a node on the current path, so stackSize < mTreeDepth
+                if (rightDistance < bestDistanceSquared)
+                {
+                    nodeStack[stackSize] = rightChild;
+                    nodeDistanceStack[stackSize] = rightDistance;
+                    stackSize++;
+                }
+                nodeId = leftChild;
+            }
+        }
+        return bestFaceId;
+    }
+
+    void MeshDistanceTree::ComputeExactDistance(const GPP::Vector3& queryCoord, GPP::Int faceId, GPP::Real& distance, GPP::Real& signedDistance,
+        GPP::Vector3& projectCoord) const
+    {
+        const GPP::Vector3& a = mVertexCoords[mTriangleVertexIds[faceId * 3]];
+        const GPP::Vector3& b = mVertexCoords[mTriangleVertexIds[faceId * 3 + 1]];
+        const GPP::Vector3& c = mVertexCoords[mTriangleVertexIds[faceId * 3 + 2]];
+        int feature = CLOSEST_FACE;
+        projectCoord = ClosestPointOnTriangle(queryCoord, a, b, c, feature);
+        GPP::Vector3 deviation = queryCoord - projectCoord;
+        distance = deviation.Length();
+        // The face normal alone gives the wrong side near convex and concave edges and vertices
+        GPP::Vector3 normal = GetTriangleNormal(faceId);
+        if (feature < CLOSEST_EDGE)
+        {
+            normal = mVertexPseudoNormals[mTriangleVertexIds[faceId * 3 + feature - CLOSEST_VERTEX]];
+        }
+        else if (feature < CLOSEST_FACE)
+        {
+            GPP::Int neighborId = mTriangleNeighbors[faceId * 3 + feature - CLOSEST_EDGE];
+            if (neighborId >= 0)
+            {
+                normal += GetTriangleNormal(neighborId);
+            }
+        }
+        signedDistance = (deviation * normal) < 0 ? -distance : distance;
+    }
+
+    GPP::ErrorCode MeshDistanceTree::QueryNearestTriangle(const GPP::Vector3& queryCoord, GPP::Int* faceId, GPP::Real* distance,
+        GPP::Real* signedDistance, GPP::Vector3* projectCoord) const
+    {
+        if (mNodes.empty())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        float coord[3] = {float(queryCoord[0]), float(queryCoord[1]), float(queryCoord[2])};
+        GPP::Int nearestFaceId = FindNearestTriangle(coord);
+        if (nearestFaceId < 0)
+        {
+            return GPP_INVALID_RESULT;
+        }
+        GPP::Real exactDistance = 0;
+        GPP::Real exactSignedDistance = 0;
+        GPP::Vector3 exactProjectCoord;
+        ComputeExactDistance(queryCoord, nearestFaceId, exactDistance, exactSignedDistance, exactProjectCoord);
+        if (faceId)
+        {
+            *faceId = nearestFaceId;
+        }
+        if (distance)
+        {
+            *distance = exactDistance;
+        }
+        if (signedDistance)
+        {
+            *signedDistance = exactSignedDistance;
+        }
+        if (projectCoord)
+        {
+            *projectCoord = exactProjectCoord;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode MeshDistanceTree::QueryPointsDistance(const std::vector<GPP::Vector3>& queryCoords, std::vector<GPP::Real>& distances,
+        std::vector<GPP::Real>* signedDistances, std::vector<GPP::Int>* faceIds) const
+    {
+        if (mNodes.empty())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        GPP::Int queryCount = queryCoords.size();
+        distances.resize(queryCount);
+        if (signedDistances)
+        {
+            signedDistances->resize(queryCount);
+        }
+        if (faceIds)
+        {
+            faceIds->resize(queryCount);
+        }
+        QueryDistanceTask queryTask(this, &queryCoords, &distances, signedDistances, faceIds);
+        // small blocks keep the load balanced, since query cost varies a lot with the distance to the mesh
+        MagicCore::ParallelTool::ParallelFor(queryCount, &queryTask, 1024);
+        return queryTask.GetFailedCount() > 0 ? GPP_INVALID_RESULT : GPP_NO_ERROR;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    struct DistanceTrianglePack;
+
+    // Leaf if mTriangleCount > 0, and the left child of an inner node is the next node
+    struct DistanceTreeNode
+    {
+        float mBoxMin[4];
+        float mBoxMax[4];
+        GPP::Int mRightChild;
+        GPP::Int mTriangleStart;
+        GPP::Int mTriangleCount;
+        GPP::Int mPackStart;
+    };
+
+    // Bounding volume hierarchy over a reference mesh for point to mesh distance queries.
+    // Leaf triangles are stored in packs of four and tested with a SSE kernel; batch queries run on all cores.
+    // The tree only keeps a copy of the triangle data, so it stays valid until the reference mesh is modified.
+    // USAGE: 1. tree.Init(refTriMesh);
+    //        2. tree.QueryPointsDistance(points, distances, &signedDistances);
+    //        3. tree.Clear() or tree.Init(...) again after refTriMesh is changed
+    class MeshDistanceTree
+    {
+    public:
+        MeshDistanceTree();
+        ~MeshDistanceTree();
+
+        GPP::ErrorCode Init(const GPP::ITriMesh* refTriMesh);
+        void Clear(void);
+        // Whether the tree was built from refTriMesh and the mesh size is unchanged
+        bool IsBuiltFrom(const GPP::ITriMesh* refTriMesh) const;
+        GPP::Int GetTriangleCount(void) const;
+
+        // signedDistance is positive on the side the angle weighted pseudo normal of the nearest feature points to:
+        // the triangle normal inside the triangle, the sum of both triangle normals on an edge, the angle weighted vertex normal on a vertex
+        GPP::ErrorCode QueryNearestTriangle(const GPP::Vector3& queryCoord, GPP::Int* faceId, GPP::Real* distance = NULL,
+            GPP::Real* signedDistance = NULL, GPP::Vector3* projectCoord = NULL) const;
+        // Multithreaded batch query. Output vectors are resized to queryCoords.size().
+        // A point that fails gets distance -1, signed distance 0 and face id -1, and GPP_INVALID_RESULT is returned
+        GPP::ErrorCode QueryPointsDistance(const std::vector<GPP::Vector3>& queryCoords, std::vector<GPP::Real>& distances,
+            std::vector<GPP::Real>* signedDistances = NULL, std::vector<GPP::Int>* faceIds = NULL) const;
+
+    private:
+        GPP::Int BuildNode(std::vector<GPP::Int>& triangleIds, GPP::Int startId, GPP::Int endId,
+            const std::vector<float>& triangleCenters, const std::vector<float>& triangleBoxes, int depth);
+        void BuildLeafPacks(const std::vector<GPP::Int>& triangleIds);
+        void BuildPseudoNormals(void);
+        GPP::Vector3 GetTriangleNormal(GPP::Int faceId) const;
+        GPP::Int FindNearestTriangle(const float queryCoord[3]) const;
+        void ComputeExactDistance(const GPP::Vector3& queryCoord, GPP::Int faceId, GPP::Real& distance, GPP::Real& signedDistance,
+            GPP::Vector3& projectCoord) const;
+
+    private:
+        const GPP::ITriMesh* mpRefTriMesh;
+        GPP::Int mRefVertexCount;
+        GPP::Int mRefTriangleCount;
+        std::vector<GPP::Vector3> mVertexCoords;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        // Triangle across edge (corner, corner + 1) of every triangle corner, -1 on boundary and non manifold edges
+        std::vector<GPP::Int> mTriangleNeighbors;
+        std::vector<GPP::Vector3> mVertexPseudoNormals;
+        std::vector<DistanceTreeNode> mNodes;
+        int mTreeDepth;
+        DistanceTrianglePack* mpPacks;
+        GPP::Int mPackCount;
+    };
+}
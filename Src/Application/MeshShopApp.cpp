@@ -8,17 +8,26 @@
 #include "MeasureApp.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "MeshAdjacency.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
 #include "../Common/ScriptSystem.h"
 #include "MagicMesh.h"
+#include "ModelCompactor.h"
+#include "PatchSimplifier.h"
+#include "VertexWelder.h"
 #if DEBUGDUMPFILE
 #include "DumpFillMeshHole.h"
 #endif
 
 namespace MagicApp
 {
+    // Meshes with more triangles than this are simplified by PatchSimplifier
+    static const GPP::Int PATCH_SIMPLIFY_TRIANGLE_COUNT = 20000000;
+    // Stamp of a MeshShop_Holes polyline slot that draws nothing
+    static const GPP::Int EMPTY_HOLE_SECTION = -2;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         MeshShopApp* app = (MeshShopApp*)arg;
@@ -38,7 +47,10 @@ namespace MagicApp
         mpDumpInfo(NULL),
 #endif
         mShowHoleLoopIds(),
+        mShowHoleLoopStamps(),
+        mHoleSectionStamps(),
         mBoundarySeedIds(),
+        mBoundaryLoops(),
         mTargetVertexCount(0),
         mFillHoleType(0),
         mCommandType(NONE),
@@ -52,7 +64,10 @@ namespace MagicApp
         mFilterPositionWeight(1.0),
         mIsFlatRenderingMode(true),
         mSharpAngle(0),
-        mEnhanceIntensity(0)
+        mEnhanceIntensity(0),
+        mPatchProgress(-1),
+        mComparePatchSimplification(false),
+        mRenderVersion(0)
     {
     }
 
@@ -90,7 +105,8 @@ namespace MagicApp
 
         if (mpUI && mpUI->IsProgressbarVisible())
         {
-            int progressValue = int(GPP::GetApiProgress() * 100.0);
+            double progress = mPatchProgress >= 0 ? mPatchProgress : GPP::GetApiProgress();
+            int progressValue = int(progress * 100.0);
             mpUI->SetProgressbar(progressValue);
         }
         if (mUpdateMeshRendering)
@@ -250,6 +266,18 @@ namespace MagicApp
         {
             RunScript(true);
         }
+        else if (arg.key == OIS::KC_G)
+        {
+            GrowSelection();
+        }
+        else if (arg.key == OIS::KC_B)
+        {
+            BenchmarkAdjacency();
+        }
+        else if (arg.key == OIS::KC_W)
+        {
+            BenchmarkWeld();
+        }
         return true;
     }
     
@@ -358,6 +386,7 @@ namespace MagicApp
         //MagicCore::RenderSystem::Get()->SetupCameraDefaultParameter();
         MagicCore::RenderSystem::Get()->HideRenderingObject("Mesh_MeshShop");
         MagicCore::RenderSystem::Get()->HideRenderingObject("MeshShop_Holes");
+        mHoleSectionStamps.clear();
         MagicCore::RenderSystem::Get()->HideRenderingObject("MeshShop_HoleSeeds");
         /*if (MagicCore::RenderSystem::Get()->GetSceneManager()->hasSceneNode("ModelNode"))
         {
@@ -373,6 +402,8 @@ namespace MagicApp
         GPPFREEPOINTER(mpDumpInfo);
 #endif
         mShowHoleLoopIds.clear();
+        mShowHoleLoopStamps.clear();
+        mHoleSectionStamps.clear();
         mVertexSelectFlag.clear();
         mRightMouseType = MOVE;
     }
@@ -381,12 +412,12 @@ namespace MagicApp
     {
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return false;
         }
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -567,7 +598,9 @@ namespace MagicApp
         }
         if (!mIsCommandInProgress)
         {
-            mUpdateMeshRendering = true;
+            // Only the layout is switched if the mesh is not changed since the last rendering
+            UpdateMeshRendering(mUpdateMeshRendering);
+            mUpdateMeshRendering = false;
         }
     }
 
@@ -575,7 +608,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -585,13 +618,14 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return false;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             ResetSelection();
             mRightMouseType = MOVE;
             mShowHoleLoopIds.clear();
+            mShowHoleLoopStamps.clear();
             UpdateHoleRendering();
             UpdateMeshRendering();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
@@ -622,32 +656,12 @@ namespace MagicApp
         if (triMesh && insertVertexIdMap.size() > 0)
         {
             int curVertexCount = triMesh->GetVertexCount();
-            std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
-            if (imageColorIds)
-            {
-                imageColorIds->resize(curVertexCount);
-                for (std::map<int, int>::iterator itr = insertVertexIdMap.begin(); itr != insertVertexIdMap.end(); ++itr)
-                {
-                    imageColorIds->at(itr->first) = imageColorIds->at(itr->second);
-                }
-            }
-            std::vector<int>* imageColorIdFlags = ModelManager::Get()->GetImageColorIdFlagsPointer();
-            if (imageColorIdFlags)
-            {
-                imageColorIdFlags->resize(curVertexCount);
-                for (std::map<int, int>::iterator itr = insertVertexIdMap.begin(); itr != insertVertexIdMap.end(); ++itr)
-                {
-                    imageColorIdFlags->at(itr->first) = imageColorIdFlags->at(itr->second);
-                }
-            }
-            std::vector<int>* colorIds = ModelManager::Get()->GetColorIdsPointer();
-            if (colorIds)
+            AttributeStore* attributes = ModelManager::Get()->GetMeshAttributes();
+            attributes->LoadAllChannels();
+            attributes->ResizeElements(curVertexCount);
+            for (std::map<int, int>::iterator itr = insertVertexIdMap.begin(); itr != insertVertexIdMap.end(); ++itr)
             {
-                colorIds->resize(curVertexCount);
-                for (std::map<int, int>::iterator itr = insertVertexIdMap.begin(); itr != insertVertexIdMap.end(); ++itr)
-                {
-                    colorIds->at(itr->first) = colorIds->at(itr->second);
-                }
+                attributes->CopyElement(itr->second, itr->first);
             }
             if (triMesh->HasVertexColor())
             {
@@ -664,25 +678,206 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh)
         {
-            int invalidVertexId = -1;
-            if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh, &invalidVertexId) == false)
+            const MeshAdjacency* adjacency = ModelManager::Get()->GetMeshAdjacency();
+            if (adjacency == NULL)
             {
-                MessageBox(NULL, "зνṹ", "ܰʾ", MB_OK);
-                if (mVertexSelectFlag.size() == triMesh->GetVertexCount() && invalidVertexId != -1)
+                MessageBox(NULL, "网格拓扑构建失败", "温馨提示", MB_OK);
+                return;
+            }
+            if (adjacency->IsManifold() == false)
+            {
+                MessageBox(NULL, "网格有非流形结构", "温馨提示", MB_OK);
+                if (mVertexSelectFlag.size() == triMesh->GetVertexCount())
                 {
-                    mVertexSelectFlag.at(invalidVertexId) = 1;
+                    GPP::Int vertexCount = triMesh->GetVertexCount();
+                    for (GPP::Int vid = 0; vid < vertexCount; vid++)
+                    {
+                        if (adjacency->IsNonManifoldVertex(vid))
+                        {
+                            mVertexSelectFlag.at(vid) = 1;
+                        }
+                    }
                     UpdateMeshRendering();
                 }
             }
             else
             {
-                MessageBox(NULL, "νṹ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格是流形结构", "温馨提示", MB_OK);
+            }
+        }
+        else
+        {
+            MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
+        }
+    }
+
+    void MeshShopApp::GrowSelection()
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        const MeshAdjacency* adjacency = ModelManager::Get()->GetMeshAdjacency();
+        if (adjacency == NULL || mVertexSelectFlag.size() != triMesh->GetVertexCount())
+        {
+            return;
+        }
+        std::vector<GPP::Int> growIds;
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            if (mVertexSelectFlag.at(vid) == 0)
+            {
+                continue;
+            }
+            GPP::Int neighborCount = adjacency->GetNeighborCount(vid);
+            const GPP::Int* neighborIds = adjacency->GetNeighborIds(vid);
+            for (GPP::Int nid = 0; nid < neighborCount; nid++)
+            {
+                if (mVertexSelectFlag.at(neighborIds[nid]) == 0)
+                {
+                    growIds.push_back(neighborIds[nid]);
+                }
+            }
+        }
+        for (std::vector<GPP::Int>::iterator itr = growIds.begin(); itr != growIds.end(); ++itr)
+        {
+            mVertexSelectFlag.at(*itr) = 1;
+        }
+        UpdateMeshRendering();
+    }
+
+    // Same data layout as GPP::ConstructEdgeInfo, which is not exported from the library
+    static void ConstructMapEdgeInfo(const GPP::ITriMesh* triMesh, std::vector<GPP::EdgeInfo>& edgeInfoList,
+        std::vector<std::map<GPP::Int, GPP::Int> >& vertexEdgeMap)
+    {
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        edgeInfoList.clear();
+        vertexEdgeMap.clear();
+        vertexEdgeMap.resize(vertexCount);
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vertexId0 = vertexIds[fvid];
+                GPP::Int vertexId1 = vertexIds[(fvid + 1) % 3];
+                if (vertexId0 > vertexId1)
+                {
+                    std::swap(vertexId0, vertexId1);
+                }
+                std::map<GPP::Int, GPP::Int>::iterator edgeItr = vertexEdgeMap.at(vertexId0).find(vertexId1);
+                if (edgeItr == vertexEdgeMap.at(vertexId0).end())
+                {
+                    GPP::EdgeInfo edgeInfo;
+                    edgeInfo.mVertexId[0] = vertexId0;
+                    edgeInfo.mVertexId[1] = vertexId1;
+                    edgeInfo.mFaceIds.push_back(fid);
+                    vertexEdgeMap.at(vertexId0)[vertexId1] = GPP::Int(edgeInfoList.size());
+                    edgeInfoList.push_back(edgeInfo);
+                }
+                else
+                {
+                    edgeInfoList.at(edgeItr->second).mFaceIds.push_back(fid);
+                }
             }
         }
+    }
+
+    void MeshShopApp::BenchmarkAdjacency()
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        InfoLog << "BenchmarkAdjacency: vertex " << triMesh->GetVertexCount() << " triangle " << triMesh->GetTriangleCount() << std::endl;
+
+        double startTime = MagicCore::ToolKit::GetTime();
+        MeshAdjacency adjacency;
+        if (adjacency.Init(triMesh) != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "网格拓扑构建失败", "温馨提示", MB_OK);
+            return;
+        }
+        double adjacencyTime = MagicCore::ToolKit::GetTime() - startTime;
+        InfoLog << "  MeshAdjacency: " << adjacencyTime << " edges " << adjacency.GetEdgeCount()
+            << " boundary edges " << adjacency.GetBoundaryEdgeCount() << " non-manifold vertices "
+            << adjacency.GetNonManifoldVertexCount() << std::endl;
+
+        startTime = MagicCore::ToolKit::GetTime();
+        std::vector<GPP::EdgeInfo> edgeInfoList;
+        std::vector<std::map<GPP::Int, GPP::Int> > vertexEdgeMap;
+        ConstructMapEdgeInfo(triMesh, edgeInfoList, vertexEdgeMap);
+        double edgeInfoTime = MagicCore::ToolKit::GetTime() - startTime;
+        InfoLog << "  EdgeInfo map: " << edgeInfoTime << " edges " << edgeInfoList.size() << std::endl;
+
+        startTime = MagicCore::ToolKit::GetTime();
+        GPP::HalfMesh* halfMesh = GPP::CreateHalfMeshFromITriMesh(triMesh);
+        double halfMeshTime = MagicCore::ToolKit::GetTime() - startTime;
+        InfoLog << "  HalfMesh: " << halfMeshTime << (halfMesh ? "" : " failed") << std::endl;
+        GPPFREEPOINTER(halfMesh);
+
+        startTime = MagicCore::ToolKit::GetTime();
+        int invalidVertexId = -1;
+        bool isManifold = GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh, &invalidVertexId);
+        double manifoldTime = MagicCore::ToolKit::GetTime() - startTime;
+        InfoLog << "  _IsTriMeshManifold: " << manifoldTime << " " << isManifold << " MeshAdjacency: " << adjacency.IsManifold() << std::endl;
+    }
+
+    void MeshShopApp::BenchmarkWeld()
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        // Split the current mesh into a triangle soup, 3 points per triangle like an STL file
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        GPP::TriMesh* soupMesh = new GPP::TriMesh;
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Int soupVertexId = soupMesh->InsertVertex(triMesh->GetVertexCoord(vertexIds[0]));
+            soupMesh->InsertVertex(triMesh->GetVertexCoord(vertexIds[1]));
+            soupMesh->InsertVertex(triMesh->GetVertexCoord(vertexIds[2]));
+            soupMesh->InsertTriangle(soupVertexId, soupVertexId + 1, soupVertexId + 2);
+        }
+        soupMesh->SetMeshType(GPP::MeshType::MT_TRIANGLE_SOUP);
+        InfoLog << "BenchmarkWeld: triangle " << triangleCount << " points " << soupMesh->GetVertexCount()
+            << " mesh vertex " << triMesh->GetVertexCount() << std::endl;
+
+        double startTime = MagicCore::ToolKit::GetTime();
+        VertexWelder vertexWelder;
+        GPP::TriMesh* weldMesh = vertexWelder.WeldTriMesh(soupMesh);
+        double welderTime = MagicCore::ToolKit::GetTime() - startTime;
+        if (weldMesh)
+        {
+            InfoLog << "  VertexWelder: " << welderTime << " vertex " << weldMesh->GetVertexCount() << " triangle "
+                << weldMesh->GetTriangleCount() << " weld time " << vertexWelder.GetWeldTime() << " build time "
+                << vertexWelder.GetBuildTime() << std::endl;
+        }
         else
         {
-            MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+            InfoLog << "  VertexWelder: " << welderTime << " failed" << std::endl;
         }
+        GPPFREEPOINTER(weldMesh);
+
+        // WeldTriMesh does not change soupMesh, so FuseVertex welds the same soup
+        startTime = MagicCore::ToolKit::GetTime();
+        GPP::ErrorCode res = soupMesh->FuseVertex();
+        double fuseTime = MagicCore::ToolKit::GetTime() - startTime;
+        InfoLog << "  FuseVertex: " << fuseTime << " vertex " << soupMesh->GetVertexCount() << " triangle "
+            << soupMesh->GetTriangleCount() << (res == GPP_NO_ERROR ? "" : " failed") << std::endl;
+        if (welderTime > 0)
+        {
+            InfoLog << "  speedup " << fuseTime / welderTime << std::endl;
+        }
+        GPPFREEPOINTER(soupMesh);
     }
 
     void MeshShopApp::ConsolidateTopology(bool isSubThread)
@@ -711,12 +906,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "޸ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "拓扑修复失败", "温馨提示", MB_OK);
                 return;
             }
             UpdateAddedVertexInfo(insertVertexIdMap);
@@ -724,11 +919,12 @@ namespace MagicApp
             bool isManifold = GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh);
             if (!isManifold)
             {
-                MessageBox(NULL, "޸ȻǷνṹ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "拓扑修复后，网格仍然是非流形结构", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
             mUpdateMeshRendering= true;
+            ModelManager::Get()->MarkMeshChanged();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
@@ -770,7 +966,7 @@ namespace MagicApp
             GPP::Int vertexCount = triMesh->GetVertexCount();
             if (vertexCount < 1)
             {
-                MessageBox(NULL, "񶥵С1ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格顶点个数小于1，操作失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Real> isolation;
@@ -779,35 +975,42 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "˳ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格光顺失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real cutValue = 0.10;
-            std::vector<GPP::Int> deleteIndex;
+            std::vector<bool> deleteFlags(vertexCount, false);
             for (GPP::Int vid = 0; vid < vertexCount; vid++)
             {
-                if (isolation[vid] < cutValue)
-                {
-                    deleteIndex.push_back(vid);
-                }
+                deleteFlags.at(vid) = isolation[vid] < cutValue;
             }
-            DebugLog << "MeshShopApp::RemoveOutlier deleteIndex size=" << deleteIndex.size() << std::endl;
-            MagicMesh magicMesh(triMesh);
-            ConstructMagicMeshInfo(&magicMesh);
-            //res = GPP::DeleteTriMeshVertices(triMesh, deleteIndex);
-            res = GPP::DeleteTriMeshVertices(&magicMesh, deleteIndex);
+            bool isLoopsBuilt = mBoundaryLoops.IsBuiltFrom(triMesh, ModelManager::Get()->GetMeshVersion());
+            if (isLoopsBuilt)
+            {
+                mBoundaryLoops.RemoveVertices(deleteFlags);
+            }
+            ModelCompactor modelCompactor;
+            res = modelCompactor.CompactTriMesh(triMesh, ModelManager::Get()->GetMeshAttributes(), deleteFlags);
             if (res != GPP_NO_ERROR)
             {
+                mBoundaryLoops.Clear();
                 return;
             }
+            DebugLog << "MeshShopApp::RemoveOutlier delete " << modelCompactor.GetDeletedCount() << " vertices, time "
+                << modelCompactor.GetCompactTime() << std::endl;
             triMesh->UpdateNormal();
             ResetSelection();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
+            if (isLoopsBuilt)
+            {
+                mBoundaryLoops.RemapVertices(modelCompactor.GetOldToNewIds(), ModelManager::Get()->GetMeshVersion());
+            }
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
@@ -837,17 +1040,18 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "޸ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "几何修复失败", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
             ResetSelection();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
         }
     }
 
@@ -868,7 +1072,7 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             mIsCommandInProgress = true;
@@ -885,12 +1089,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格优化失败", "温馨提示", MB_OK);
                     return;
                 }
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -909,17 +1113,18 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格优化失败", "温馨提示", MB_OK);
                     return;
                 }
             }        
             triMesh->UpdateNormal();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
         }
     }
 
@@ -940,7 +1145,7 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             mIsCommandInProgress = true;
@@ -953,16 +1158,17 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格优化失败", "温馨提示", MB_OK);
                 return;
             }       
             triMesh->UpdateNormal();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
         }
     }
 
@@ -1007,16 +1213,17 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "˳ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格光顺失败", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
             mUpdateMeshRendering = true;
+            mUpdateHoleRendering = true;
         }
     }
 
@@ -1061,16 +1268,17 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "˳ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格光顺失败", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
             mUpdateMeshRendering = true;
+            mUpdateHoleRendering = true;
         }
     }
 
@@ -1115,16 +1323,17 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ϸǿʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "几何细节增强失败", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
             mUpdateMeshRendering = true;
+            mUpdateHoleRendering = true;
         }
     }
 
@@ -1145,7 +1354,7 @@ namespace MagicApp
             GPP::Int vertexCount = triMesh->GetVertexCount();
             if (vertexCount >= 250000)
             {
-                if (MessageBox(NULL, "ϸֺ񶥵ܻ1MǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "细分后网格顶点数量可能会大于1M，是否继续", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1170,12 +1379,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Loopϸʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Loop细分失败", "温馨提示", MB_OK);
                     return;
                 }               
                 GPP::Int insertedVertexCount = triMesh->GetVertexCount() - vertexCount;
@@ -1195,18 +1404,19 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Loopϸʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Loop细分失败", "温馨提示", MB_OK);
                     return;
                 }
             }
             triMesh->UpdateNormal();
             ResetSelection();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         }
     }
@@ -1228,12 +1438,12 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh->GetVertexCount() >= targetVertexCount)
             {
-                MessageBox(NULL, "棺Ŀ궥", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：目标顶点数必须大于网格点数", "温馨提示", MB_OK);
                 return;
             }
             if (targetVertexCount > 1000000)
             {
-                if (MessageBox(NULL, "ܺ񶥵1MǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "加密后网格顶点数量会大于1M，是否继续", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1259,12 +1469,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格加密失败", "温馨提示", MB_OK);
                     return;
                 }
                 GPP::Int insertedVertexCount = triMesh->GetVertexCount() - vertexCount;
@@ -1284,18 +1494,19 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格加密失败", "温馨提示", MB_OK);
                     return;
                 }
             }
             triMesh->UpdateNormal();
             ResetSelection();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         }
     }
@@ -1317,12 +1528,12 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             if (triMesh->GetVertexCount() <= targetVertexCount)
             {
-                MessageBox(NULL, "棺Ŀ궥С", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：目标顶点数必须小于网格点数", "温馨提示", MB_OK);
                 return;
             }
             if (triMesh->HasVertexColor())
@@ -1335,16 +1546,16 @@ namespace MagicApp
 #if MAKEDUMPFILE
                 GPP::DumpOnce();
 #endif
-                GPP::ErrorCode res = GPP::SimplifyMesh::QuadricSimplify(triMesh, targetVertexCount, false, &vertexFields, &simplifiedVertexFields);
+                GPP::ErrorCode res = QuadricSimplifyMesh(triMesh, targetVertexCount, &vertexFields, &simplifiedVertexFields);
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格简化失败", "温馨提示", MB_OK);
                     return;
                 }               
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -1360,27 +1571,86 @@ namespace MagicApp
 #if MAKEDUMPFILE
                 GPP::DumpOnce();
 #endif
-                GPP::ErrorCode res = GPP::SimplifyMesh::QuadricSimplify(triMesh, targetVertexCount, false, NULL, NULL);
+                GPP::ErrorCode res = QuadricSimplifyMesh(triMesh, targetVertexCount, NULL, NULL);
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格简化失败", "温馨提示", MB_OK);
                     return;
                 }
             }
             ResetSelection();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
         }
     }
 
+    GPP::ErrorCode MeshShopApp::QuadricSimplifyMesh(GPP::TriMesh* triMesh, int targetVertexCount, const std::vector<GPP::Real>* vertexFields,
+        std::vector<GPP::Real>* simplifiedVertexFields)
+    {
+        if (triMesh->GetTriangleCount() <= PATCH_SIMPLIFY_TRIANGLE_COUNT)
+        {
+            return GPP::SimplifyMesh::QuadricSimplify(triMesh, targetVertexCount, false, vertexFields, simplifiedVertexFields);
+        }
+        GPP::TriMesh* singleMesh = NULL;
+        if (mComparePatchSimplification)
+        {
+            singleMesh = new GPP::TriMesh;
+            GPP::Int vertexCount = triMesh->GetVertexCount();
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                singleMesh->InsertVertex(triMesh->GetVertexCoord(vid));
+            }
+            GPP::Int triangleCount = triMesh->GetTriangleCount();
+            GPP::Int vertexIds[3];
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                triMesh->GetTriangleVertexIds(fid, vertexIds);
+                singleMesh->InsertTriangle(vertexIds[0], vertexIds[1], vertexIds[2]);
+            }
+            singleMesh->UpdateNormal();
+        }
+        // One call over the whole mesh is serial and runs out of memory, simplify it patch by patch
+        bool hasVertexColor = triMesh->HasVertexColor();
+        PatchSimplifier patchSimplifier;
+        mPatchProgress = 0;
+        GPP::ErrorCode res = patchSimplifier.Simplify(triMesh, targetVertexCount, vertexFields, simplifiedVertexFields, &mPatchProgress);
+        mPatchProgress = -1;
+        triMesh->SetHasVertexColor(hasVertexColor);
+        InfoLog << "MeshShopApp::QuadricSimplifyMesh: " << patchSimplifier.GetPatchCount() << " patches, " 
+            << patchSimplifier.GetConcurrentPatchCount() << " concurrent, time " << patchSimplifier.GetSimplifyTime() << std::endl;
+        if (singleMesh != NULL)
+        {
+            if (res == GPP_NO_ERROR)
+            {
+                double startTime = MagicCore::ToolKit::GetTime();
+                GPP::ErrorCode singleRes = GPP::SimplifyMesh::QuadricSimplify(singleMesh, targetVertexCount, false, NULL, NULL);
+                double singleTime = MagicCore::ToolKit::GetTime() - startTime;
+                GPP::Real hausdorffDistance = 0;
+                if (singleRes == GPP_NO_ERROR && PatchSimplifier::MeasureHausdorffDistance(triMesh, singleMesh, hausdorffDistance) == GPP_NO_ERROR)
+                {
+                    InfoLog << "  single call: " << singleMesh->GetVertexCount() << " vertices, time " << singleTime 
+                        << ", hausdorff distance to the patch result " << hausdorffDistance << std::endl;
+                }
+            }
+            GPPFREEPOINTER(singleMesh);
+        }
+        return res;
+    }
+
+    void MeshShopApp::SetComparePatchSimplification(bool isCompare)
+    {
+        mComparePatchSimplification = isCompare;
+    }
+
     void MeshShopApp::SimplifySelectedVertices(bool isSubThread)
     {
         if (IsCommandAvaliable() == false)
@@ -1397,7 +1667,7 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Int> removingVertices;
@@ -1430,12 +1700,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格简化失败", "温馨提示", MB_OK);
                     return;
                 }               
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -1454,17 +1724,18 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格简化失败", "温馨提示", MB_OK);
                     return;
                 }          
             }
             ResetSelection();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
@@ -1489,7 +1760,7 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             sharpAngle *= GPP::ONE_RADIAN;
@@ -1506,12 +1777,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Remeshʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Remesh失败", "温馨提示", MB_OK);
                     return;
                 }               
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -1531,18 +1802,19 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Remeshʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Remesh失败", "温馨提示", MB_OK);
                     return;
                 }
             }
             triMesh->UpdateNormal();
             ResetSelection();
             mUpdateMeshRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
@@ -1566,12 +1838,12 @@ namespace MagicApp
             pointsOnFace, pointsOnEdge, pointsOnVertex, false); 
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "采样失败", "温馨提示", MB_OK);
             return;
         }
 
@@ -1626,7 +1898,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return;
         }
         AppManager::Get()->EnterApp(new ReliefApp, "ReliefApp");
@@ -1636,7 +1908,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return;
         }
         AppManager::Get()->EnterApp(new TextureApp, "TextureApp");
@@ -1646,7 +1918,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return;
         }
         AppManager::Get()->EnterApp(new MeasureApp, "MeasureApp");
@@ -1685,22 +1957,50 @@ namespace MagicApp
             //UpdateHoleRendering();
             return;
         }
-        GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(ModelManager::Get()->GetMesh(), &holeIds);
-        if (res == GPP_API_IS_NOT_AVAILABLE)
+        // Loops are only searched on the first query, edits update them in place
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        GPP::Int meshVersion = ModelManager::Get()->GetMeshVersion();
+        if (!mBoundaryLoops.IsBuiltFrom(triMesh, meshVersion))
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-            MagicCore::ToolKit::Get()->SetAppRunning(false);
+            // FindHoles is the licensed api of this command, its loops seed the tracker
+            GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(triMesh, &holeIds);
+            if (res == GPP_API_IS_NOT_AVAILABLE)
+            {
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+                MagicCore::ToolKit::Get()->SetAppRunning(false);
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                return;
+            }
+            res = mBoundaryLoops.Init(triMesh, ModelManager::Get()->GetMeshAdjacency(), meshVersion, &holeIds);
+            if (res != GPP_NO_ERROR)
+            {
+                return;
+            }
         }
-        if (res != GPP_NO_ERROR)
+        // Only the loops traced again since the last query are copied and drawn
+        GPP::Int loopCount = mBoundaryLoops.GetLoopCount();
+        mShowHoleLoopIds.resize(loopCount);
+        mShowHoleLoopStamps.resize(loopCount, -1);
+        GPP::Int changedCount = 0;
+        for (GPP::Int loopId = 0; loopId < loopCount; loopId++)
         {
-            return;
+            GPP::Int loopStamp = mBoundaryLoops.GetLoopStamp(loopId);
+            if (mShowHoleLoopStamps.at(loopId) != loopStamp)
+            {
+                mShowHoleLoopIds.at(loopId) = mBoundaryLoops.GetLoopVertexIds(loopId);
+                mShowHoleLoopStamps.at(loopId) = loopStamp;
+                changedCount++;
+            }
         }
-        SetToShowHoleLoopVrtIds(holeIds);
-        SetBoundarySeedIds(std::vector<GPP::Int>());
-
-        ModelManager::Get()->GetMesh()->UpdateNormal();
-        UpdateHoleRendering();
-        UpdateMeshRendering();
+        InfoLog << "MeshShopApp::FindHole " << loopCount << " holes, " << changedCount << " changed" << std::endl;
+        if (!mBoundarySeedIds.empty())
+        {
+            SetBoundarySeedIds(std::vector<GPP::Int>());
+            MagicCore::RenderSystem::Get()->RenderPointList("MeshShop_HoleSeeds", "SimplePoint", GPP::Vector3(1.0, 0.0, 0.0), std::vector<GPP::Vector3>());
+        }
+        UpdateChangedHoleRendering();
     }
 
     void MeshShopApp::FillHole(int type, bool isSubThread)
@@ -1739,6 +2039,8 @@ namespace MagicApp
             
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             int originVertexCount = triMesh->GetVertexCount();
+            GPP::Int originTriangleCount = triMesh->GetTriangleCount();
+            bool isLoopsBuilt = mBoundaryLoops.IsBuiltFrom(triMesh, ModelManager::Get()->GetMeshVersion());
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
@@ -1761,39 +2063,30 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "񲹶ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格补洞失败", "温馨提示", MB_OK);
                 return;
             }
-            std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
-            if (imageColorIds && imageColorIds->size() == originVertexCount)
-            {
-                int curVertexCount = triMesh->GetVertexCount();
-                if (curVertexCount > originVertexCount)
-                {
-                    imageColorIds->resize(curVertexCount, GPP::ImageColorId(-1, 0, 0));
-                    std::vector<int>* colorIds = ModelManager::Get()->GetColorIdsPointer();
-                    if (colorIds && colorIds->size() == originVertexCount)
-                    {
-                        colorIds->resize(curVertexCount, -1);
-                    }
-                    std::vector<int>* imageColorIdFlags = ModelManager::Get()->GetImageColorIdFlagsPointer();
-                    if (imageColorIdFlags && imageColorIdFlags->size() == originVertexCount)
-                    {
-                        imageColorIdFlags->resize(curVertexCount, 0);
-                    }
-                }
-            }
+            AttributeStore* attributes = ModelManager::Get()->GetMeshAttributes();
+            attributes->RemoveUnmatchedChannels(originVertexCount);
+            attributes->LoadAllChannels();
+            attributes->ResizeElements(triMesh->GetVertexCount());
             ResetSelection();           
             SetToShowHoleLoopVrtIds(std::vector<std::vector<GPP::Int> >());
             SetBoundarySeedIds(std::vector<GPP::Int>());
             triMesh->UpdateNormal();
             mUpdateMeshRendering = true;
             mUpdateHoleRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
+            if (isLoopsBuilt)
+            {
+                // Filled triangles are appended
+                mBoundaryLoops.AppendTriangles(originTriangleCount, ModelManager::Get()->GetMeshVersion());
+            }
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
         }
@@ -1936,6 +2229,8 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             GPP::Int edgeVertex1[2] = {mBridgeEdgeVertices[0], mBridgeEdgeVertices[1]};
             GPP::Int edgeVertex2[2] = {mBridgeEdgeVertices[2], mBridgeEdgeVertices[3]};
+            GPP::Int originTriangleCount = triMesh->GetTriangleCount();
+            bool isLoopsBuilt = mBoundaryLoops.IsBuiltFrom(triMesh, ModelManager::Get()->GetMeshVersion());
             if (triMesh->HasVertexColor())
             {
                 std::vector<GPP::Real> vertexScaleFields, outputScaleFields;
@@ -1947,12 +2242,12 @@ namespace MagicApp
                 GPP::ErrorCode res = GPP::FillMeshHole::BridgeEdges(triMesh, edgeVertex1, edgeVertex2, &vertexScaleFields, &outputScaleFields);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格搭桥失败", "温馨提示", MB_OK);
                 }
                 UpdateTriMeshVertexColors(triMesh, oldTriMeshVertexSize, outputScaleFields);
             }
@@ -1964,12 +2259,12 @@ namespace MagicApp
                 GPP::ErrorCode res = GPP::FillMeshHole::BridgeEdges(triMesh, edgeVertex1, edgeVertex2, NULL, NULL);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格搭桥失败", "温馨提示", MB_OK);
                 }
             }          
             ResetSelection();
@@ -1978,6 +2273,12 @@ namespace MagicApp
             mUpdateMeshRendering = true;
             mUpdateHoleRendering = true;
             mUpdateBridgeRendering = true;
+            ModelManager::Get()->MarkMeshChanged();
+            if (isLoopsBuilt)
+            {
+                // Bridge triangles are appended
+                mBoundaryLoops.AppendTriangles(originTriangleCount, ModelManager::Get()->GetMeshVersion());
+            }
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             mRightMouseType = MOVE;
@@ -1994,11 +2295,11 @@ namespace MagicApp
         ResetBridgeTags();
         if (mBridgeEdgeVertices.empty())
         {
-            MessageBox(NULL, "ģʽ: ʹҼοѡҪдŵԱ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "进入搭桥模式: 请使用鼠标右键依次框选需要进行搭桥的两对边", "温馨提示", MB_OK);
         }
         else
         {
-            MessageBox(NULL, "ģʽ: ʹҼѡһ߽д", "ܰʾ", MB_OK);
+            MessageBox(NULL, "搭桥模式: 请使用鼠标右键再选择一条边进行搭桥", "温馨提示", MB_OK);
         }
     }
 
@@ -2015,15 +2316,16 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::OffsetMesh::UniformApproximate(triMesh, offsetValue);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "网格抽壳失败", "温馨提示", MB_OK);
             return;
         }
         ResetSelection();
+        ModelManager::Get()->MarkMeshChanged();
         mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         UpdateMeshRendering();
     }
@@ -2051,38 +2353,40 @@ namespace MagicApp
         {
             return;
         }
-        std::vector<GPP::Int> deleteIndex;
-        GPP::Int vertexCount = triMesh->GetVertexCount();
-        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        bool isLoopsBuilt = mBoundaryLoops.IsBuiltFrom(triMesh, ModelManager::Get()->GetMeshVersion());
+        if (isLoopsBuilt)
         {
-            if (mVertexSelectFlag.at(vid))
-            {
-                deleteIndex.push_back(vid);
-            }
+            mBoundaryLoops.RemoveVertices(mVertexSelectFlag);
         }
-        MagicMesh magicMesh(triMesh);
-        ConstructMagicMeshInfo(&magicMesh);
-        //res = GPP::DeleteTriMeshVertices(triMesh, deleteIndex);
-        GPP::ErrorCode res = GPP::DeleteTriMeshVertices(&magicMesh, deleteIndex);
+        ModelCompactor modelCompactor;
+        GPP::ErrorCode res = modelCompactor.CompactTriMesh(triMesh, ModelManager::Get()->GetMeshAttributes(), mVertexSelectFlag);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ɾʧ", "ܰʾ", MB_OK);
+            mBoundaryLoops.Clear();
+            MessageBox(NULL, "删点失败", "温馨提示", MB_OK);
             return;
         }
+        InfoLog << "MeshShopApp::DeleteSelections delete " << modelCompactor.GetDeletedCount() << " vertices, time "
+            << modelCompactor.GetCompactTime() << std::endl;
+        MagicMesh magicMesh(triMesh);
+        ConstructMagicMeshInfo(&magicMesh);
         if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
         {
-            if (MessageBox(NULL, "棺ɾƬзνṹǷҪ޸", "ܰʾ", MB_OKCANCEL) == IDOK)
+            if (MessageBox(NULL, "警告：删除面片后的网格有非流形结构，是否需要修复？", "温馨提示", MB_OKCANCEL) == IDOK)
             {
+                // Splitting vertices changes the boundary everywhere, loops are searched again
+                mBoundaryLoops.Clear();
+                isLoopsBuilt = false;
                 std::map<int, int> insertVertexIdMap;
                 GPP::ErrorCode res = GPP::ConsolidateMesh::MakeTriMeshManifold(&magicMesh, &insertVertexIdMap);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "޸ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "拓扑修复失败", "温馨提示", MB_OK);
                     return;
                 }
                 UpdateAddedVertexInfo(insertVertexIdMap);
@@ -2091,6 +2395,11 @@ namespace MagicApp
         ResetSelection();
         triMesh->UpdateNormal();
         mUpdateMeshRendering = true;
+        ModelManager::Get()->MarkMeshChanged();
+        if (isLoopsBuilt)
+        {
+            mBoundaryLoops.RemapVertices(modelCompactor.GetOldToNewIds(), ModelManager::Get()->GetMeshVersion());
+        }
         mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         mpUI->ResetFillHole();
         FindHole(false);
@@ -2171,12 +2480,12 @@ namespace MagicApp
         }
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "SplitByPlane failed", "ܰʾ", MB_OK);
+            MessageBox(NULL, "SplitByPlane failed", "温馨提示", MB_OK);
             return;
         }
         std::vector<int> deleteIndex;
@@ -2191,16 +2500,17 @@ namespace MagicApp
         res = GPP::DeleteTriMeshTriangles(triMesh, deleteIndex, true);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "DeleteTriMeshTriangles failed", "ܰʾ", MB_OK);
+            MessageBox(NULL, "DeleteTriMeshTriangles failed", "温馨提示", MB_OK);
             return;
         }
         triMesh->UpdateNormal();
+        ModelManager::Get()->MarkMeshChanged();
         mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         ResetSelection();
         UpdateMeshRendering();
         if (triMesh->GetVertexCount() < 3 || triMesh->GetTriangleCount() < 1)
         {
-            MessageBox(NULL, "ѿ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "网格已空", "温馨提示", MB_OK);
             return;
         }
     }
@@ -2217,7 +2527,19 @@ namespace MagicApp
         }
     }
 
-    void MeshShopApp::UpdateMeshRendering()
+    bool MeshShopApp::SetVertexSelectFlags(const std::vector<bool>& selectFlags)
+    {
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL || selectFlags.size() != triMesh->GetVertexCount())
+        {
+            return false;
+        }
+        mVertexSelectFlag = selectFlags;
+        mUpdateMeshRendering = true;
+        return true;
+    }
+
+    void MeshShopApp::UpdateMeshRendering(bool isMeshChanged)
     {
         if (MagicCore::ScriptSystem::Get()->IsOnRunningScript())
         {
@@ -2228,9 +2550,13 @@ namespace MagicApp
             MagicCore::RenderSystem::Get()->HideRenderingObject("Mesh_MeshShop");
             return;
         }
+        if (isMeshChanged)
+        {
+            mRenderVersion++;
+        }
         GPP::Vector3 selectColor(1, 0, 0);
         MagicCore::RenderSystem::Get()->RenderMesh("Mesh_MeshShop", "CookTorrance", ModelManager::Get()->GetMesh(), 
-            MagicCore::RenderSystem::MODEL_NODE_CENTER, &mVertexSelectFlag, &selectColor, mIsFlatRenderingMode);
+            MagicCore::RenderSystem::MODEL_NODE_CENTER, &mVertexSelectFlag, &selectColor, mIsFlatRenderingMode, mRenderVersion);
     }
 
     void MeshShopApp::UpdateHoleRendering()
@@ -2267,6 +2593,58 @@ namespace MagicApp
             holeSeeds.at(vId) = triMesh->GetVertexCoord(mBoundarySeedIds[vId]);
         }
         MagicCore::RenderSystem::Get()->RenderPointList("MeshShop_HoleSeeds", "SimplePoint", GPP::Vector3(1.0, 0.0, 0.0), holeSeeds);
+        // Every shown loop is drawn in order, one polyline each
+        mHoleSectionStamps = mShowHoleLoopStamps;
+    }
+
+    void MeshShopApp::UpdateChangedHoleRendering()
+    {
+        if (MagicCore::ScriptSystem::Get()->IsOnRunningScript())
+        {
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL)
+        {
+            return;
+        }
+        if (GPP::Int(mHoleSectionStamps.size()) != MagicCore::RenderSystem::Get()->GetPolylineCount("MeshShop_Holes"))
+        {
+            // The polylines were dropped or rebuilt elsewhere
+            UpdateHoleRendering();
+            return;
+        }
+        GPP::Int loopCount = mShowHoleLoopIds.size();
+        GPP::Int sectionCount = mHoleSectionStamps.size();
+        GPP::Int slotCount = loopCount > sectionCount ? loopCount : sectionCount;
+        mHoleSectionStamps.resize(slotCount, EMPTY_HOLE_SECTION);
+        std::vector<GPP::Vector3> positions;
+        for (GPP::Int slotId = 0; slotId < slotCount; slotId++)
+        {
+            positions.clear();
+            GPP::Int loopStamp = EMPTY_HOLE_SECTION;
+            if (slotId < loopCount && !mShowHoleLoopIds.at(slotId).empty())
+            {
+                loopStamp = mShowHoleLoopStamps.at(slotId);
+                // A loop that is not from the tracker has no stamp to compare, it is always drawn
+                if (slotId < sectionCount && loopStamp >= 0 && mHoleSectionStamps.at(slotId) == loopStamp)
+                {
+                    continue;
+                }
+                const std::vector<GPP::Int>& loopVertexIds = mShowHoleLoopIds.at(slotId);
+                for (std::vector<GPP::Int>::const_iterator itr = loopVertexIds.begin(); itr != loopVertexIds.end(); ++itr)
+                {
+                    positions.push_back(triMesh->GetVertexCoord(*itr));
+                }
+                positions.push_back(triMesh->GetVertexCoord(loopVertexIds.at(0)));
+            }
+            else if (slotId < sectionCount && mHoleSectionStamps.at(slotId) == EMPTY_HOLE_SECTION)
+            {
+                continue;
+            }
+            MagicCore::RenderSystem::Get()->UpdatePolyline("MeshShop_Holes", "SimpleLine", GPP::Vector3(1.0, 0.0, 0.0), slotId, positions);
+            mHoleSectionStamps.at(slotId) = loopStamp;
+        }
     }
 
     void MeshShopApp::UpdateBridgeRendering()
@@ -2303,13 +2681,14 @@ namespace MagicApp
         if (MagicCore::ToolKit::FileSaveDlg(fileName, filterName))
         {
             std::ofstream fout(fileName);
-            std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-            int imageIdCount = imageColorIds.size();
+            const std::vector<GPP::ImageColorId>* imageColorIds =
+                ModelManager::Get()->GetMeshAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL);
+            int imageIdCount = imageColorIds ? imageColorIds->size() : 0;
             fout << imageIdCount << " ";
             GPP::ImageColorId curId;
             for (int iid = 0; iid < imageIdCount; iid++)
             {
-                curId = imageColorIds.at(iid);
+                curId = imageColorIds->at(iid);
                 fout << curId.GetImageIndex() << " " << curId.GetLocalX() << " " << curId.GetLocalY() << " ";
             }
             std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
@@ -2333,7 +2712,7 @@ namespace MagicApp
             std::ifstream fin(fileName);
             if (!fin)
             {
-                MessageBox(NULL, "GIIʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "GII导入失败", "温馨提示", MB_OK);
                 return;
             }
             int imageIdCount = 0;
@@ -2346,7 +2725,7 @@ namespace MagicApp
                 fin >> imageId >> posX >> posY;
                 imageColorIds.push_back(GPP::ImageColorId(imageId, posX, posY));
             }
-            ModelManager::Get()->SetImageColorIds(imageColorIds);
+            ModelManager::Get()->GetMeshAttributes()->SwapChannel(IMAGE_COLOR_ID_CHANNEL, imageColorIds, GPP::ImageColorId(-1, 0, 0));
 
             int imageCount = 0;
             fin >> imageCount;
@@ -2374,7 +2753,7 @@ namespace MagicApp
     {
         if (MagicCore::ScriptSystem::Get()->IsOnRunningScript())
         {
-            MessageBox(NULL, "ȴǰһűִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待前一脚本执行完毕", "温馨提示", MB_OK);
             return;
         }
         if (IsCommandInProgress())
@@ -2398,6 +2777,7 @@ namespace MagicApp
                     GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
                     if (triMesh)
                     {
+                        ModelManager::Get()->MarkMeshChanged();
                         if (mpUI)
                         {
                             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
@@ -2406,12 +2786,16 @@ namespace MagicApp
                             mpUI->StopProgressbar();
                         }
                     }
-                    ResetSelection();
+                    // Keep the selection made by SelectMeshVertices
+                    if (triMesh == NULL || mVertexSelectFlag.size() != triMesh->GetVertexCount())
+                    {
+                        ResetSelection();
+                    }
                     mUpdateMeshRendering = true;
                     mUpdateBridgeRendering = true;
                     mUpdateHoleRendering = true;
                     mUpdateMeshRendering = true;
-                    MessageBox(NULL, "űִ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "脚本执行完毕", "温馨提示", MB_OK);
                 }
             }
         }
@@ -2422,19 +2806,20 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "mpTriMesh == NULL", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mpTriMesh == NULL", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
         if (textureImageFiles.empty())
         {
-            MessageBox(NULL, "mTextureImageFiles is empty", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mTextureImageFiles is empty", "温馨提示", MB_OK);
             return;
         }
-        std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-        if (imageColorIds.size() != triMesh->GetVertexCount())
+        const std::vector<GPP::ImageColorId>* imageColorIds =
+            ModelManager::Get()->GetMeshAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, triMesh->GetVertexCount());
+        if (imageColorIds == NULL)
         {
-            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "温馨提示", MB_OK);
             return;
         }
         int imageCount = textureImageFiles.size();
@@ -2445,7 +2830,7 @@ namespace MagicApp
             imageList.at(fid) = cv::imread(textureImageFiles.at(fid));
             if (imageList.at(fid).data == NULL)
             {
-                MessageBox(NULL, "Imageʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Image导入失败", "温馨提示", MB_OK);
                 return;
             }
             imageHList.at(fid) = imageList.at(fid).rows;
@@ -2454,7 +2839,7 @@ namespace MagicApp
         triMesh->SetHasVertexColor(true);
         for (int vid = 0; vid < vertexCount; vid++)
         {
-            GPP::ImageColorId colorId = imageColorIds.at(vid);
+            GPP::ImageColorId colorId = imageColorIds->at(vid);
             int imageIndex = colorId.GetImageIndex();
             const unsigned char* pixel = imageList.at(imageIndex).ptr(imageHList.at(imageIndex) - colorId.GetLocalY() - 1,
                 colorId.GetLocalX());
@@ -2470,21 +2855,7 @@ namespace MagicApp
 
     void MeshShopApp::ConstructMagicMeshInfo(MagicMesh* magicMesh)
     {
-        std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
-        if (imageColorIds && imageColorIds->size() == magicMesh->GetVertexCount())
-        {
-            magicMesh->SetImageColorIds(imageColorIds);
-        }
-        std::vector<int>* imageColorIdFlags = ModelManager::Get()->GetImageColorIdFlagsPointer();
-        if (imageColorIdFlags && imageColorIdFlags->size() == magicMesh->GetVertexCount())
-        {
-            magicMesh->SetImageColorIdFlags(imageColorIdFlags);
-        }
-        std::vector<int>* colorIds = ModelManager::Get()->GetColorIdsPointer();
-        if (colorIds && colorIds->size() == magicMesh->GetVertexCount())
-        {
-            magicMesh->SetColorIds(colorIds);
-        }
+        magicMesh->SetAttributes(ModelManager::Get()->GetMeshAttributes());
     }
 
     void MeshShopApp::SetToShowHoleLoopVrtIds(const std::vector<std::vector<GPP::Int> >& toShowHoleLoopVrtIds)
@@ -2492,10 +2863,12 @@ namespace MagicApp
         if (ModelManager::Get()->GetMesh() == NULL || toShowHoleLoopVrtIds.empty())
         {
             mShowHoleLoopIds.clear();
+            mShowHoleLoopStamps.clear();
             return;
         }
 
         mShowHoleLoopIds = toShowHoleLoopVrtIds;
+        mShowHoleLoopStamps.assign(mShowHoleLoopIds.size(), -1);
     }
 
     void MeshShopApp::SetBoundarySeedIds(const std::vector<GPP::Int>& holeSeedIds)
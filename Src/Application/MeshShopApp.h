@@ -3,6 +3,7 @@
 #include "../Common/RenderSystem.h"
 #include <vector>
 #include "Gpp.h"
+#include "BoundaryLoopTracker.h"
 #if DEBUGDUMPFILE
 #include "DumpBase.h"
 #endif
@@ -102,8 +103,16 @@ namespace MagicApp
         void MoveModel(void);
         void SplitMeshByPlane(SplitType st, double offsetValue);
         void RunScript(bool isSubThread = true);
+        void GrowSelection(void);
+        void BenchmarkAdjacency(void);
+        void BenchmarkWeld(void);
+        // Simplifying a mesh too large for one QuadricSimplify call also runs that call on a copy,
+        // and logs its time and Hausdorff distance to the patch result. It needs the memory of the single call
+        void SetComparePatchSimplification(bool isCompare);
 
         int GetMeshVertexCount(void);
+        // Return false if the flag count is not the vertex count. Rendering is updated in the next frame
+        bool SetVertexSelectFlags(const std::vector<bool>& selectFlags);
         bool IsCommandInProgress(void);
 #if DEBUGDUMPFILE
         void SetDumpInfo(GPP::DumpBase* dumpInfo);
@@ -123,16 +132,21 @@ namespace MagicApp
         void ResetBridgeTags();
 
         void InitViewTool(void);
-        void UpdateMeshRendering(void);
+        // isMeshChanged: false if only the display mode is switched, then the cached buffers are shown
+        void UpdateMeshRendering(bool isMeshChanged = true);
         void SetToShowHoleLoopVrtIds(const std::vector<std::vector<GPP::Int> >& toShowHoleLoopIds);
         void SetBoundarySeedIds(const std::vector<GPP::Int>& bounarySeedIds);
         void UpdateHoleRendering(void);
+        // Redraw only the holes whose tracker stamp differs from the one drawn in their polyline slot
+        void UpdateChangedHoleRendering(void);
         void UpdateBridgeRendering(void);
 
         void SaveImageColorInfo(void);
         void LoadImageColorInfo(void);
         void PickMeshColorFromImages(void);
 
+        GPP::ErrorCode QuadricSimplifyMesh(GPP::TriMesh* triMesh, int targetVertexCount, const std::vector<GPP::Real>* vertexFields,
+            std::vector<GPP::Real>* simplifiedVertexFields);
         void ConstructMagicMeshInfo(MagicMesh* magicMesh);
         void UpdateAddedVertexInfo(std::map<int, int>& insertVertexIdMap);
 
@@ -144,7 +158,12 @@ namespace MagicApp
         GPP::DumpBase* mpDumpInfo;
 #endif
         std::vector<std::vector<GPP::Int> > mShowHoleLoopIds;
+        // Tracker stamp of every shown hole, -1 if it is not a tracker loop
+        std::vector<GPP::Int>               mShowHoleLoopStamps;
+        // Stamp of the hole drawn in every polyline of MeshShop_Holes
+        std::vector<GPP::Int>               mHoleSectionStamps;
         std::vector<GPP::Int>               mBoundarySeedIds;
+        BoundaryLoopTracker mBoundaryLoops;
         GPP::Int mTargetVertexCount;
         int mFillHoleType;
         CommandType mCommandType;
@@ -162,5 +181,10 @@ namespace MagicApp
         bool mIsFlatRenderingMode;
         double mSharpAngle;
         double mEnhanceIntensity;
+        // Finished patch ratio of a patch simplification, -1 when it is not running
+        double mPatchProgress;
+        bool mComparePatchSimplification;
+        // Version of the rendered mesh and select flags, see RenderSystem::RenderMesh
+        int mRenderVersion;
     };
 }
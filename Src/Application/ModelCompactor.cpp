@@ -0,0 +1,468 @@
+#include "ModelCompactor.h"
+#include "AttributeStore.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+
+namespace MagicApp
+{
+    static const GPP::Int COMPACT_BLOCK_SIZE = 65536;
+
+    static GPP::Int GetBlockCount(GPP::Int elementCount)
+    {
+        return (elementCount + COMPACT_BLOCK_SIZE - 1) / COMPACT_BLOCK_SIZE;
+    }
+
+    class KeepFlagTask : public MagicCore::ParallelTask
+    {
+    public:
+        KeepFlagTask(const std::vector<bool>& deleteFlags, std::vector<char>& keepFlags) :
+            mDeleteFlags(deleteFlags),
+            mKeepFlags(keepFlags)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int eid = startId; eid < endId; eid++)
+            {
+                mKeepFlags.at(eid) = !mDeleteFlags.at(eid);
+            }
+        }
+
+    private:
+        const std::vector<bool>& mDeleteFlags;
+        std::vector<char>& mKeepFlags;
+    };
+
+    // A triangle is kept if its three vertices are kept. Its vertex ids are renumbered on the way
+    class TriangleKeepFlagTask : public MagicCore::ParallelTask
+    {
+    public:
+        TriangleKeepFlagTask(const GPP::TriMesh* triMesh, const std::vector<GPP::Int>& vertexOldToNewIds,
+            std::vector<GPP::Int>& triangleVertexIds, std::vector<char>& keepFlags) :
+            mpTriMesh(triMesh),
+            mVertexOldToNewIds(vertexOldToNewIds),
+            mTriangleVertexIds(triangleVertexIds),
+            mKeepFlags(keepFlags)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int vertexIds[3] = {-1};
+            for (int fid = startId; fid < endId; fid++)
+            {
+                mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+                bool isKept = true;
+                for (int fvid = 0; fvid < 3; fvid++)
+                {
+                    GPP::Int newId = mVertexOldToNewIds.at(vertexIds[fvid]);
+                    mTriangleVertexIds.at(fid * 3 + fvid) = newId;
+                    isKept = isKept && newId >= 0;
+                }
+                mKeepFlags.at(fid) = isKept;
+            }
+        }
+
+    private:
+        const GPP::TriMesh* mpTriMesh;
+        const std::vector<GPP::Int>& mVertexOldToNewIds;
+        std::vector<GPP::Int>& mTriangleVertexIds;
+        std::vector<char>& mKeepFlags;
+    };
+
+    // Block bid covers [bid * COMPACT_BLOCK_SIZE, (bid + 1) * COMPACT_BLOCK_SIZE)
+    class CountKeptTask : public MagicCore::ParallelTask
+    {
+    public:
+        CountKeptTask(const std::vector<char>& keepFlags, std::vector<GPP::Int>& blockCounts) :
+            mKeepFlags(keepFlags),
+            mBlockCounts(blockCounts)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int elementCount = mKeepFlags.size();
+            for (int bid = startId; bid < endId; bid++)
+            {
+                GPP::Int blockEnd = (bid + 1) * COMPACT_BLOCK_SIZE < elementCount ? (bid + 1) * COMPACT_BLOCK_SIZE : elementCount;
+                GPP::Int keptCount = 0;
+                for (GPP::Int eid = bid * COMPACT_BLOCK_SIZE; eid < blockEnd; eid++)
+                {
+                    keptCount += mKeepFlags.at(eid) ? 1 : 0;
+                }
+                mBlockCounts.at(bid) = keptCount;
+            }
+        }
+
+    private:
+        const std::vector<char>& mKeepFlags;
+        std::vector<GPP::Int>& mBlockCounts;
+    };
+
+    class NumberKeptTask : public MagicCore::ParallelTask
+    {
+    public:
+        NumberKeptTask(const std::vector<char>& keepFlags, const std::vector<GPP::Int>& blockStarts,
+            std::vector<GPP::Int>& oldToNewIds, std::vector<GPP::Int>& newToOldIds) :
+            mKeepFlags(keepFlags),
+            mBlockStarts(blockStarts),
+            mOldToNewIds(oldToNewIds),
+            mNewToOldIds(newToOldIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int elementCount = mKeepFlags.size();
+            for (int bid = startId; bid < endId; bid++)
+            {
+                GPP::Int blockEnd = (bid + 1) * COMPACT_BLOCK_SIZE < elementCount ? (bid + 1) * COMPACT_BLOCK_SIZE : elementCount;
+                GPP::Int newId = mBlockStarts.at(bid);
+                for (GPP::Int eid = bid * COMPACT_BLOCK_SIZE; eid < blockEnd; eid++)
+                {
+                    if (mKeepFlags.at(eid))
+                    {
+                        mOldToNewIds.at(eid) = newId;
+                        mNewToOldIds.at(newId) = eid;
+                        newId++;
+                    }
+                    else
+                    {
+                        mOldToNewIds.at(eid) = -1;
+                    }
+                }
+            }
+        }
+
+    private:
+        const std::vector<char>& mKeepFlags;
+        const std::vector<GPP::Int>& mBlockStarts;
+        std::vector<GPP::Int>& mOldToNewIds;
+        std::vector<GPP::Int>& mNewToOldIds;
+    };
+
+    // Stream compaction: count per block, exclusive scan of the block counts, then number every block in parallel
+    static GPP::Int NumberKeptElements(const std::vector<char>& keepFlags, std::vector<GPP::Int>& oldToNewIds, std::vector<GPP::Int>& newToOldIds)
+    {
+        GPP::Int elementCount = keepFlags.size();
+        GPP::Int blockCount = GetBlockCount(elementCount);
+        std::vector<GPP::Int> blockCounts(blockCount, 0);
+        CountKeptTask countTask(keepFlags, blockCounts);
+        MagicCore::ParallelTool::ParallelFor(blockCount, &countTask, 1);
+        std::vector<GPP::Int> blockStarts(blockCount, 0);
+        GPP::Int keptCount = 0;
+        for (GPP::Int bid = 0; bid < blockCount; bid++)
+        {
+            blockStarts.at(bid) = keptCount;
+            keptCount += blockCounts.at(bid);
+        }
+        oldToNewIds.resize(elementCount);
+        newToOldIds.resize(keptCount);
+        NumberKeptTask numberTask(keepFlags, blockStarts, oldToNewIds, newToOldIds);
+        MagicCore::ParallelTool::ParallelFor(blockCount, &numberTask, 1);
+        return keptCount;
+    }
+
+    // isGather: read the kept points from their old ids, else write them to their new ids
+    class MovePointTask : public MagicCore::ParallelTask
+    {
+    public:
+        MovePointTask(GPP::PointCloud* pointCloud, const std::vector<GPP::Int>& newToOldIds, bool isGather,
+            std::vector<GPP::Vector3>& coords, std::vector<GPP::Vector3>& normals, std::vector<GPP::Vector3>& colors) :
+            mpPointCloud(pointCloud),
+            mNewToOldIds(newToOldIds),
+            mIsGather(isGather),
+            mCoords(coords),
+            mNormals(normals),
+            mColors(colors)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            bool hasNormal = !mNormals.empty();
+            bool hasColor = !mColors.empty();
+            for (int newId = startId; newId < endId; newId++)
+            {
+                if (mIsGather)
+                {
+                    GPP::Int oldId = mNewToOldIds.at(newId);
+                    mCoords.at(newId) = mpPointCloud->GetPointCoord(oldId);
+                    if (hasNormal)
+                    {
+                        mNormals.at(newId) = mpPointCloud->GetPointNormal(oldId);
+                    }
+                    if (hasColor)
+                    {
+                        mColors.at(newId) = mpPointCloud->GetPointColor(oldId);
+                    }
+                }
+                else
+                {
+                    mpPointCloud->SetPointCoord(newId, mCoords.at(newId));
+                    if (hasNormal)
+                    {
+                        mpPointCloud->SetPointNormal(newId, mNormals.at(newId));
+                    }
+                    if (hasColor)
+                    {
+                        mpPointCloud->SetPointColor(newId, mColors.at(newId));
+                    }
+                }
+            }
+        }
+
+    private:
+        GPP::PointCloud* mpPointCloud;
+        const std::vector<GPP::Int>& mNewToOldIds;
+        bool mIsGather;
+        std::vector<GPP::Vector3>& mCoords;
+        std::vector<GPP::Vector3>& mNormals;
+        std::vector<GPP::Vector3>& mColors;
+    };
+
+    class MoveVertexTask : public MagicCore::ParallelTask
+    {
+    public:
+        MoveVertexTask(GPP::TriMesh* triMesh, const std::vector<GPP::Int>& newToOldIds, bool isGather, std::vector<GPP::Vector3>& coords,
+            std::vector<GPP::Vector3>& normals, std::vector<GPP::Vector3>& colors, std::vector<GPP::Vector3>& texCoords) :
+            mpTriMesh(triMesh),
+            mNewToOldIds(newToOldIds),
+            mIsGather(isGather),
+            mCoords(coords),
+            mNormals(normals),
+            mColors(colors),
+            mTexCoords(texCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            bool hasColor = !mColors.empty();
+            bool hasTexCoord = !mTexCoords.empty();
+            for (int newId = startId; newId < endId; newId++)
+            {
+                if (mIsGather)
+                {
+                    GPP::Int oldId = mNewToOldIds.at(newId);
+                    mCoords.at(newId) = mpTriMesh->GetVertexCoord(oldId);
+                    mNormals.at(newId) = mpTriMesh->GetVertexNormal(oldId);
+                    if (hasColor)
+                    {
+                        mColors.at(newId) = mpTriMesh->GetVertexColor(oldId);
+                    }
+                    if (hasTexCoord)
+                    {
+                        mTexCoords.at(newId) = mpTriMesh->GetVertexTexcoord(oldId);
+                    }
+                }
+                else
+                {
+                    mpTriMesh->SetVertexCoord(newId, mCoords.at(newId));
+                    mpTriMesh->SetVertexNormal(newId, mNormals.at(newId));
+                    if (hasColor)
+                    {
+                        mpTriMesh->SetVertexColor(newId, mColors.at(newId));
+                    }
+                    if (hasTexCoord)
+                    {
+                        mpTriMesh->SetVertexTexcoord(newId, mTexCoords.at(newId));
+                    }
+                }
+            }
+        }
+
+    private:
+        GPP::TriMesh* mpTriMesh;
+        const std::vector<GPP::Int>& mNewToOldIds;
+        bool mIsGather;
+        std::vector<GPP::Vector3>& mCoords;
+        std::vector<GPP::Vector3>& mNormals;
+        std::vector<GPP::Vector3>& mColors;
+        std::vector<GPP::Vector3>& mTexCoords;
+    };
+
+    // Triangle vertex ids are already renumbered, per corner colors and texture coordinates are moved with the triangle
+    class MoveTriangleTask : public MagicCore::ParallelTask
+    {
+    public:
+        MoveTriangleTask(GPP::TriMesh* triMesh, const std::vector<GPP::Int>& newToOldIds, bool isGather, const std::vector<GPP::Int>& triangleVertexIds,
+            std::vector<GPP::Vector3>& cornerColors, std::vector<GPP::Vector3>& cornerTexCoords) :
+            mpTriMesh(triMesh),
+            mNewToOldIds(newToOldIds),
+            mIsGather(isGather),
+            mTriangleVertexIds(triangleVertexIds),
+            mCornerColors(cornerColors),
+            mCornerTexCoords(cornerTexCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            bool hasColor = !mCornerColors.empty();
+            bool hasTexCoord = !mCornerTexCoords.empty();
+            for (int newId = startId; newId < endId; newId++)
+            {
+                GPP::Int oldId = mNewToOldIds.at(newId);
+                if (mIsGather)
+                {
+                    for (int fvid = 0; fvid < 3; fvid++)
+                    {
+                        if (hasColor)
+                        {
+                            mCornerColors.at(newId * 3 + fvid) = mpTriMesh->GetTriangleColor(oldId, fvid);
+                        }
+                        if (hasTexCoord)
+                        {
+                            mCornerTexCoords.at(newId * 3 + fvid) = mpTriMesh->GetTriangleTexcoord(oldId, fvid);
+                        }
+                    }
+                }
+                else
+                {
+                    mpTriMesh->SetTriangleVertexIds(newId, mTriangleVertexIds.at(oldId * 3), mTriangleVertexIds.at(oldId * 3 + 1),
+                        mTriangleVertexIds.at(oldId * 3 + 2));
+                    for (int fvid = 0; fvid < 3; fvid++)
+                    {
+                        if (hasColor)
+                        {
+                            mpTriMesh->SetTriangleColor(newId, fvid, mCornerColors.at(newId * 3 + fvid));
+                        }
+                        if (hasTexCoord)
+                        {
+                            mpTriMesh->SetTriangleTexcoord(newId, fvid, mCornerTexCoords.at(newId * 3 + fvid));
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        GPP::TriMesh* mpTriMesh;
+        const std::vector<GPP::Int>& mNewToOldIds;
+        bool mIsGather;
+        const std::vector<GPP::Int>& mTriangleVertexIds;
+        std::vector<GPP::Vector3>& mCornerColors;
+        std::vector<GPP::Vector3>& mCornerTexCoords;
+    };
+
+    ModelCompactor::ModelCompactor() :
+        mOldToNewIds(),
+        mNewToOldIds(),
+        mDeletedCount(0),
+        mCompactTime(0)
+    {
+    }
+
+    ModelCompactor::~ModelCompactor()
+    {
+    }
+
+    GPP::ErrorCode ModelCompactor::CompactPointCloud(GPP::PointCloud* pointCloud, AttributeStore* attributes, const std::vector<bool>& deleteFlags)
+    {
+        mDeletedCount = 0;
+        mCompactTime = 0;
+        if (pointCloud == NULL || GPP::Int(deleteFlags.size()) != pointCloud->GetPointCount())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        std::vector<char> keepFlags(pointCount);
+        KeepFlagTask keepFlagTask(deleteFlags, keepFlags);
+        MagicCore::ParallelTool::ParallelFor(pointCount, &keepFlagTask);
+        GPP::Int keptCount = NumberKeptElements(keepFlags, mOldToNewIds, mNewToOldIds);
+        mDeletedCount = pointCount - keptCount;
+        if (mDeletedCount > 0)
+        {
+            std::vector<GPP::Vector3> coords(keptCount);
+            std::vector<GPP::Vector3> normals(pointCloud->HasNormal() ? keptCount : 0);
+            std::vector<GPP::Vector3> colors(pointCloud->HasColor() ? keptCount : 0);
+            MovePointTask gatherTask(pointCloud, mNewToOldIds, true, coords, normals, colors);
+            MagicCore::ParallelTool::ParallelFor(keptCount, &gatherTask);
+            MovePointTask scatterTask(pointCloud, mNewToOldIds, false, coords, normals, colors);
+            MagicCore::ParallelTool::ParallelFor(keptCount, &scatterTask);
+            pointCloud->PopbackPoints(mDeletedCount);
+            if (attributes)
+            {
+                attributes->RemoveUnmatchedChannels(pointCount);
+                attributes->ReorderElements(mNewToOldIds);
+            }
+        }
+        mCompactTime = MagicCore::ToolKit::GetTime() - startTime;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode ModelCompactor::CompactTriMesh(GPP::TriMesh* triMesh, AttributeStore* attributes, const std::vector<bool>& deleteFlags)
+    {
+        mDeletedCount = 0;
+        mCompactTime = 0;
+        if (triMesh == NULL || GPP::Int(deleteFlags.size()) != triMesh->GetVertexCount())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        std::vector<char> keepFlags(vertexCount);
+        KeepFlagTask keepFlagTask(deleteFlags, keepFlags);
+        MagicCore::ParallelTool::ParallelFor(vertexCount, &keepFlagTask);
+        GPP::Int keptCount = NumberKeptElements(keepFlags, mOldToNewIds, mNewToOldIds);
+        mDeletedCount = vertexCount - keptCount;
+        if (mDeletedCount == 0)
+        {
+            mCompactTime = MagicCore::ToolKit::GetTime() - startTime;
+            return GPP_NO_ERROR;
+        }
+
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        std::vector<GPP::Int> triangleVertexIds(triangleCount * 3);
+        std::vector<char> triangleKeepFlags(triangleCount);
+        TriangleKeepFlagTask triangleKeepFlagTask(triMesh, mOldToNewIds, triangleVertexIds, triangleKeepFlags);
+        MagicCore::ParallelTool::ParallelFor(triangleCount, &triangleKeepFlagTask);
+        std::vector<GPP::Int> triangleOldToNewIds;
+        std::vector<GPP::Int> triangleNewToOldIds;
+        GPP::Int keptTriangleCount = NumberKeptElements(triangleKeepFlags, triangleOldToNewIds, triangleNewToOldIds);
+
+        std::vector<GPP::Vector3> coords(keptCount);
+        std::vector<GPP::Vector3> normals(keptCount);
+        std::vector<GPP::Vector3> colors(triMesh->HasVertexColor() ? keptCount : 0);
+        std::vector<GPP::Vector3> texCoords(triMesh->HasVertexTexCoord() ? keptCount : 0);
+        MoveVertexTask gatherVertexTask(triMesh, mNewToOldIds, true, coords, normals, colors, texCoords);
+        MagicCore::ParallelTool::ParallelFor(keptCount, &gatherVertexTask);
+        std::vector<GPP::Vector3> cornerColors(triMesh->HasTriangleColor() ? keptTriangleCount * 3 : 0);
+        std::vector<GPP::Vector3> cornerTexCoords(triMesh->HasTriangleTexCoord() ? keptTriangleCount * 3 : 0);
+        MoveTriangleTask gatherTriangleTask(triMesh, triangleNewToOldIds, true, triangleVertexIds, cornerColors, cornerTexCoords);
+        MagicCore::ParallelTool::ParallelFor(keptTriangleCount, &gatherTriangleTask);
+
+        MoveVertexTask scatterVertexTask(triMesh, mNewToOldIds, false, coords, normals, colors, texCoords);
+        MagicCore::ParallelTool::ParallelFor(keptCount, &scatterVertexTask);
+        MoveTriangleTask scatterTriangleTask(triMesh, triangleNewToOldIds, false, triangleVertexIds, cornerColors, cornerTexCoords);
+        MagicCore::ParallelTool::ParallelFor(keptTriangleCount, &scatterTriangleTask);
+        triMesh->PopbackTriangles(triangleCount - keptTriangleCount);
+        triMesh->PopbackVertices(mDeletedCount);
+        if (attributes)
+        {
+            attributes->RemoveUnmatchedChannels(vertexCount);
+            attributes->ReorderElements(mNewToOldIds);
+        }
+        mCompactTime = MagicCore::ToolKit::GetTime() - startTime;
+        return GPP_NO_ERROR;
+    }
+
+    const std::vector<GPP::Int>& ModelCompactor::GetOldToNewIds() const
+    {
+        return mOldToNewIds;
+    }
+
+    GPP::Int ModelCompactor::GetDeletedCount() const
+    {
+        return mDeletedCount;
+    }
+
+    double ModelCompactor::GetCompactTime() const
+    {
+        return mCompactTime;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    class AttributeStore;
+
+    // Deletes the flagged points of a point cloud, or the flagged vertices of a mesh with their triangles, in one O(N) pass
+    // instead of a swap and popback per deleted element. A parallel prefix sum over the keep flags gives every kept element
+    // its new id, so kept elements stay in order. Geometry is gathered in parallel, written back at the new ids,
+    // the tail is popped, and every channel of the AttributeStore is reordered once.
+    // USAGE: 1. ModelCompactor modelCompactor; modelCompactor.CompactPointCloud(pointCloud, attributes, mPointSelectFlag);
+    //        2. const std::vector<GPP::Int>& oldToNewIds = modelCompactor.GetOldToNewIds();  // -1 for deleted elements
+    class ModelCompactor
+    {
+    public:
+        ModelCompactor();
+        ~ModelCompactor();
+
+        // One flag per point, true is deleted. attributes can be NULL
+        GPP::ErrorCode CompactPointCloud(GPP::PointCloud* pointCloud, AttributeStore* attributes, const std::vector<bool>& deleteFlags);
+        // One flag per vertex, triangles with a deleted vertex are deleted too. Normals are not updated
+        GPP::ErrorCode CompactTriMesh(GPP::TriMesh* triMesh, AttributeStore* attributes, const std::vector<bool>& deleteFlags);
+
+        // Point or vertex ids of the last compaction
+        const std::vector<GPP::Int>& GetOldToNewIds(void) const;
+        GPP::Int GetDeletedCount(void) const;
+        double GetCompactTime(void) const;
+
+    private:
+        std::vector<GPP::Int> mOldToNewIds;
+        std::vector<GPP::Int> mNewToOldIds;
+        GPP::Int mDeletedCount;
+        double mCompactTime;
+    };
+}
@@ -0,0 +1,621 @@
+#include "ModelExporter.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/LogSystem.h"
+#include <windows.h>
+#include <process.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sstream>
+
+namespace MagicApp
+{
+    static const GPP::Int CHUNK_RECORD_COUNT = 65536;
+    static const GPP::Int BATCH_CHUNK_COUNT = 32;
+    static const GPP::ULongInt MAX_PENDING_BYTE_COUNT = 256 * 1024 * 1024;
+
+    // Encodes a range of records of one element into bytes
+    class RecordEncoder
+    {
+    public:
+        virtual ~RecordEncoder() {}
+        virtual GPP::Int GetRecordCount(void) const = 0;
+        virtual void Encode(GPP::Int startId, GPP::Int endId, std::vector<char>& data) const = 0;
+    };
+
+    static void WriteFloats(const GPP::Vector3& value, char* data)
+    {
+        float floatValue[3] = { float(value[0]), float(value[1]), float(value[2]) };
+        memcpy(data, floatValue, sizeof(float) * 3);
+    }
+
+    static void WriteBytes(const GPP::Vector3& value, GPP::Real scale, GPP::Real minValue, GPP::Real maxValue, char* data)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real scaled = value[axis] * scale;
+            scaled = scaled < minValue ? minValue : (scaled > maxValue ? maxValue : scaled);
+            data[axis] = char(int(scaled < 0 ? scaled - 0.5 : scaled + 0.5));
+        }
+    }
+
+    // x y z [nx ny nz] [red green blue] of a point cloud or of the mesh vertices
+    class PlyVertexEncoder : public RecordEncoder
+    {
+    public:
+        PlyVertexEncoder(const GPP::PointCloud* pointCloud, const GPP::TriMesh* triMesh, bool hasNormal, bool hasColor, bool isCompact) :
+            mpPointCloud(pointCloud),
+            mpTriMesh(triMesh),
+            mHasNormal(hasNormal),
+            mHasColor(hasColor),
+            mIsCompact(isCompact),
+            mRecordSize(GetRecordSize(hasNormal, hasColor, isCompact))
+        {
+        }
+
+        static GPP::Int GetRecordSize(bool hasNormal, bool hasColor, bool isCompact)
+        {
+            GPP::Int recordSize = sizeof(float) * 3;
+            if (hasNormal)
+            {
+                recordSize += isCompact ? 3 : sizeof(float) * 3;
+            }
+            if (hasColor)
+            {
+                recordSize += 3;
+            }
+            return recordSize;
+        }
+
+        virtual GPP::Int GetRecordCount() const
+        {
+            return mpPointCloud ? mpPointCloud->GetPointCount() : mpTriMesh->GetVertexCount();
+        }
+
+        virtual void Encode(GPP::Int startId, GPP::Int endId, std::vector<char>& data) const
+        {
+            data.resize(GPP::ULongInt(endId - startId) * mRecordSize);
+            char* record = &data.at(0);
+            for (GPP::Int vid = startId; vid < endId; vid++)
+            {
+                char* field = record;
+                WriteFloats(mpPointCloud ? mpPointCloud->GetPointCoord(vid) : mpTriMesh->GetVertexCoord(vid), field);
+                field += sizeof(float) * 3;
+                if (mHasNormal)
+                {
+                    GPP::Vector3 normal = mpPointCloud ? mpPointCloud->GetPointNormal(vid) : mpTriMesh->GetVertexNormal(vid);
+                    if (mIsCompact)
+                    {
+                        WriteBytes(normal, 127, -127, 127, field);
+                        field += 3;
+                    }
+                    else
+                    {
+                        WriteFloats(normal, field);
+                        field += sizeof(float) * 3;
+                    }
+                }
+                if (mHasColor)
+                {
+                    GPP::Vector3 color = mpPointCloud ? mpPointCloud->GetPointColor(vid) : mpTriMesh->GetVertexColor(vid);
+                    unsigned char colorBytes[3];
+                    for (int cid = 0; cid < 3; cid++)
+                    {
+                        GPP::Real value = color[cid] * 255 + 0.5;
+                        colorBytes[cid] = (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+                    }
+                    memcpy(field, colorBytes, 3);
+                }
+                record += mRecordSize;
+            }
+        }
+
+    private:
+        const GPP::PointCloud* mpPointCloud;
+        const GPP::TriMesh* mpTriMesh;
+        bool mHasNormal;
+        bool mHasColor;
+        bool mIsCompact;
+        GPP::Int mRecordSize;
+    };
+
+    // uchar 3 and 3 int vertex ids
+    class PlyFaceEncoder : public RecordEncoder
+    {
+    public:
+        explicit PlyFaceEncoder(const GPP::TriMesh* triMesh) :
+            mpTriMesh(triMesh)
+        {
+        }
+
+        virtual GPP::Int GetRecordCount() const
+        {
+            return mpTriMesh->GetTriangleCount();
+        }
+
+        virtual void Encode(GPP::Int startId, GPP::Int endId, std::vector<char>& data) const
+        {
+            static const GPP::Int recordSize = 1 + sizeof(int) * 3;
+            data.resize(GPP::ULongInt(endId - startId) * recordSize);
+            char* record = &data.at(0);
+            GPP::Int vertexIds[3];
+            for (GPP::Int fid = startId; fid < endId; fid++)
+            {
+                mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+                int recordIds[3] = { int(vertexIds[0]), int(vertexIds[1]), int(vertexIds[2]) };
+                record[0] = 3;
+                memcpy(record + 1, recordIds, sizeof(int) * 3);
+                record += recordSize;
+            }
+        }
+
+    private:
+        const GPP::TriMesh* mpTriMesh;
+    };
+
+    class ObjVertexEncoder : public RecordEncoder
+    {
+    public:
+        explicit ObjVertexEncoder(const GPP::TriMesh* triMesh) :
+            mpTriMesh(triMesh)
+        {
+        }
+
+        virtual GPP::Int GetRecordCount() const
+        {
+            return mpTriMesh->GetVertexCount();
+        }
+
+        virtual void Encode(GPP::Int startId, GPP::Int endId, std::vector<char>& data) const
+        {
+            std::ostringstream objStream;
+            for (GPP::Int vid = startId; vid < endId; vid++)
+            {
+                GPP::Vector3 coord = mpTriMesh->GetVertexCoord(vid);
+                objStream << "v " << coord[0] << " " << coord[1] << " " << coord[2] << "\n";
+            }
+            std::string text = objStream.str();
+            data.assign(text.begin(), text.end());
+        }
+
+    private:
+        const GPP::TriMesh* mpTriMesh;
+    };
+
+    // One record is the 3 texture vertices of a triangle
+    class ObjTexCoordEncoder : public RecordEncoder
+    {
+    public:
+        explicit ObjTexCoordEncoder(const GPP::TriMesh* triMesh) :
+            mpTriMesh(triMesh)
+        {
+        }
+
+        virtual GPP::Int GetRecordCount() const
+        {
+            return mpTriMesh->GetTriangleCount();
+        }
+
+        virtual void Encode(GPP::Int startId, GPP::Int endId, std::vector<char>& data) const
+        {
+            std::ostringstream objStream;
+            for (GPP::Int fid = startId; fid < endId; fid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    GPP::Vector3 texCoord = mpTriMesh->GetTriangleTexcoord(fid, localId);
+                    objStream << "vt " << texCoord[0] << " " << texCoord[1] << "\n";
+                }
+            }
+            std::string text = objStream.str();
+            data.assign(text.begin(), text.end());
+        }
+
+    private:
+        const GPP::TriMesh* mpTriMesh;
+    };
+
+    class ObjFaceEncoder : public RecordEncoder
+    {
+    public:
+        explicit ObjFaceEncoder(const GPP::TriMesh* triMesh) :
+            mpTriMesh(triMesh)
+        {
+        }
+
+        virtual GPP::Int GetRecordCount() const
+        {
+            return mpTriMesh->GetTriangleCount();
+        }
+
+        virtual void Encode(GPP::Int startId, GPP::Int endId, std::vector<char>& data) const
+        {
+            std::ostringstream objStream;
+            GPP::Int vertexIds[3];
+            for (GPP::Int fid = startId; fid < endId; fid++)
+            {
+                mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+                objStream << "f " << vertexIds[0] + 1 << "/" << fid * 3 + 1 << " "
+                    << vertexIds[1] + 1 << "/" << fid * 3 + 2 << " " << vertexIds[2] + 1 << "/" << fid * 3 + 3 << "\n";
+            }
+            std::string text = objStream.str();
+            data.assign(text.begin(), text.end());
+        }
+
+    private:
+        const GPP::TriMesh* mpTriMesh;
+    };
+
+    class EncodeChunkTask : public MagicCore::ParallelTask
+    {
+    public:
+        EncodeChunkTask(const RecordEncoder* encoder, GPP::Int startChunkId, std::vector<std::vector<char> >* chunkDatas) :
+            mpEncoder(encoder),
+            mStartChunkId(startChunkId),
+            mpChunkDatas(chunkDatas)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int recordCount = mpEncoder->GetRecordCount();
+            for (int localChunkId = startId; localChunkId < endId; localChunkId++)
+            {
+                GPP::Int startRecordId = (mStartChunkId + localChunkId) * CHUNK_RECORD_COUNT;
+                GPP::Int endRecordId = startRecordId + CHUNK_RECORD_COUNT;
+                if (endRecordId > recordCount)
+                {
+                    endRecordId = recordCount;
+                }
+                mpEncoder->Encode(startRecordId, endRecordId, mpChunkDatas->at(localChunkId));
+            }
+        }
+
+    private:
+        const RecordEncoder* mpEncoder;
+        GPP::Int mStartChunkId;
+        std::vector<std::vector<char> >* mpChunkDatas;
+    };
+
+    static std::string PlyHeader(GPP::Int vertexCount, bool hasNormal, bool hasColor, bool isCompact, GPP::Int faceCount)
+    {
+        std::ostringstream headerStream;
+        headerStream << "ply\nformat binary_little_endian 1.0\ncomment Magic3D\n";
+        headerStream << "element vertex " << vertexCount << "\n";
+        headerStream << "property float x\nproperty float y\nproperty float z\n";
+        if (hasNormal)
+        {
+            const char* normalType = isCompact ? "char" : "float";
+            headerStream << "property " << normalType << " nx\nproperty " << normalType << " ny\nproperty " << normalType << " nz\n";
+        }
+        if (hasColor)
+        {
+            headerStream << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        }
+        if (faceCount >= 0)
+        {
+            headerStream << "element face " << faceCount << "\n";
+            headerStream << "property list uchar int vertex_indices\n";
+        }
+        headerStream << "end_header\n";
+        return headerStream.str();
+    }
+
+    ModelExporter* ModelExporter::mpModelExporter = NULL;
+
+    static void ShutdownModelExporter(void)
+    {
+        ModelExporter::Get()->Shutdown();
+    }
+
+    ModelExporter::ModelExporter() :
+        mChunkQueue(),
+        mPendingByteCount(0),
+        mWriteError(GPP_NO_ERROR),
+        mIsStopping(false),
+        mpFileHandle(NULL),
+        mpExportLock(NULL),
+        mpQueueLock(NULL),
+        mpWorkEvent(NULL),
+        mpSpaceEvent(NULL),
+        mpIdleEvent(NULL),
+        mpWriteThread(NULL)
+    {
+        CRITICAL_SECTION* exportLock = new CRITICAL_SECTION;
+        InitializeCriticalSection(exportLock);
+        mpExportLock = exportLock;
+        CRITICAL_SECTION* queueLock = new CRITICAL_SECTION;
+        InitializeCriticalSection(queueLock);
+        mpQueueLock = queueLock;
+        mpWorkEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        mpSpaceEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        mpIdleEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+        mpWriteThread = (void*)_beginthreadex(NULL, 0, WriteThread, (void*)this, 0, NULL);
+    }
+
+    ModelExporter* ModelExporter::Get()
+    {
+        if (mpModelExporter == NULL)
+        {
+            mpModelExporter = new ModelExporter;
+            atexit(ShutdownModelExporter);
+        }
+        return mpModelExporter;
+    }
+
+    ModelExporter::~ModelExporter()
+    {
+        Shutdown();
+        CloseHandle((HANDLE)mpWorkEvent);
+        CloseHandle((HANDLE)mpSpaceEvent);
+        CloseHandle((HANDLE)mpIdleEvent);
+        CRITICAL_SECTION* exportLock = (CRITICAL_SECTION*)mpExportLock;
+        DeleteCriticalSection(exportLock);
+        GPPFREEPOINTER(exportLock);
+        mpExportLock = NULL;
+        CRITICAL_SECTION* queueLock = (CRITICAL_SECTION*)mpQueueLock;
+        DeleteCriticalSection(queueLock);
+        GPPFREEPOINTER(queueLock);
+        mpQueueLock = NULL;
+    }
+
+    GPP::ErrorCode ModelExporter::ExportPointCloud(const std::string& fileName, const GPP::PointCloud* pointCloud)
+    {
+        if (IsPlyFile(fileName))
+        {
+            return ExportPointCloudPly(fileName, pointCloud, false);
+        }
+        return GPP::Parser::ExportPointCloud(fileName, pointCloud);
+    }
+
+    GPP::ErrorCode ModelExporter::ExportTriMesh(const std::string& fileName, const GPP::TriMesh* triMesh)
+    {
+        if (IsPlyFile(fileName))
+        {
+            return ExportTriMeshPly(fileName, triMesh, false);
+        }
+        return GPP::Parser::ExportTriMesh(fileName, triMesh);
+    }
+
+    GPP::ErrorCode ModelExporter::ExportPointCloudPly(const std::string& fileName, const GPP::PointCloud* pointCloud, bool isCompact)
+    {
+        if (pointCloud == NULL || pointCloud->GetPointCount() == 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        EnterCriticalSection((CRITICAL_SECTION*)mpExportLock);
+        bool hasNormal = pointCloud->HasNormal();
+        bool hasColor = pointCloud->HasColor();
+        GPP::ErrorCode res = BeginFile(fileName, PlyHeader(pointCloud->GetPointCount(), hasNormal, hasColor, isCompact, -1));
+        if (res == GPP_NO_ERROR)
+        {
+            EncodeRecords(PlyVertexEncoder(pointCloud, NULL, hasNormal, hasColor, isCompact));
+            EndFile();
+        }
+        LeaveCriticalSection((CRITICAL_SECTION*)mpExportLock);
+        return res;
+    }
+
+    GPP::ErrorCode ModelExporter::ExportTriMeshPly(const std::string& fileName, const GPP::TriMesh* triMesh, bool isCompact)
+    {
+        if (triMesh == NULL || triMesh->GetVertexCount() == 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        EnterCriticalSection((CRITICAL_SECTION*)mpExportLock);
+        bool hasColor = triMesh->HasVertexColor();
+        GPP::ErrorCode res = BeginFile(fileName, PlyHeader(triMesh->GetVertexCount(), true, hasColor, isCompact, triMesh->GetTriangleCount()));
+        if (res == GPP_NO_ERROR)
+        {
+            EncodeRecords(PlyVertexEncoder(NULL, triMesh, true, hasColor, isCompact));
+            EncodeRecords(PlyFaceEncoder(triMesh));
+            EndFile();
+        }
+        LeaveCriticalSection((CRITICAL_SECTION*)mpExportLock);
+        return res;
+    }
+
+    GPP::ErrorCode ModelExporter::ExportTexturedObj(const std::string& fileName, const std::string& materialName, const GPP::TriMesh* triMesh)
+    {
+        if (triMesh == NULL || triMesh->HasTriangleTexCoord() == false)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        EnterCriticalSection((CRITICAL_SECTION*)mpExportLock);
+        GPP::ErrorCode res = BeginFile(fileName, "mtllib " + materialName + ".mtl\nusemtl " + materialName + "\n");
+        if (res == GPP_NO_ERROR)
+        {
+            EncodeRecords(ObjVertexEncoder(triMesh));
+            EncodeRecords(ObjTexCoordEncoder(triMesh));
+            EncodeRecords(ObjFaceEncoder(triMesh));
+            EndFile();
+        }
+        LeaveCriticalSection((CRITICAL_SECTION*)mpExportLock);
+        return res;
+    }
+
+    GPP::ErrorCode ModelExporter::Flush()
+    {
+        if (mpWriteThread != NULL)
+        {
+            WaitForSingleObject((HANDLE)mpIdleEvent, INFINITE);
+        }
+        return PopWriteError();
+    }
+
+    GPP::ErrorCode ModelExporter::PopWriteError()
+    {
+        EnterCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+        GPP::ErrorCode res = mWriteError;
+        mWriteError = GPP_NO_ERROR;
+        LeaveCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+        return res;
+    }
+
+    void ModelExporter::Shutdown()
+    {
+        if (mpWriteThread != NULL)
+        {
+            EnterCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+            mIsStopping = true;
+            SetEvent((HANDLE)mpWorkEvent);
+            LeaveCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+            WaitForSingleObject((HANDLE)mpWriteThread, INFINITE);
+            CloseHandle((HANDLE)mpWriteThread);
+            mpWriteThread = NULL;
+        }
+    }
+
+    bool ModelExporter::IsPlyFile(const std::string& fileName)
+    {
+        size_t dotPos = fileName.rfind('.');
+        if (dotPos == std::string::npos)
+        {
+            return false;
+        }
+        std::string extension = fileName.substr(dotPos);
+        for (std::string::iterator itr = extension.begin(); itr != extension.end(); ++itr)
+        {
+            *itr = char(tolower(*itr));
+        }
+        return extension == ".ply";
+    }
+
+    GPP::ErrorCode ModelExporter::BeginFile(const std::string& fileName, const std::string& header)
+    {
+        HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            ErrorLog << "ModelExporter: open " << fileName << " failed" << std::endl;
+            return GPP_INVALID_INPUT;
+        }
+        WriteChunk* chunk = new WriteChunk;
+        chunk->mpFileHandle = fileHandle;
+        chunk->mIsLastChunk = false;
+        chunk->mData.assign(header.begin(), header.end());
+        PushChunk(chunk);
+        return GPP_NO_ERROR;
+    }
+
+    void ModelExporter::EncodeRecords(const RecordEncoder& encoder)
+    {
+        GPP::Int chunkCount = (encoder.GetRecordCount() + CHUNK_RECORD_COUNT - 1) / CHUNK_RECORD_COUNT;
+        std::vector<std::vector<char> > chunkDatas;
+        for (GPP::Int batchStart = 0; batchStart < chunkCount; batchStart += BATCH_CHUNK_COUNT)
+        {
+            GPP::Int batchCount = chunkCount - batchStart < BATCH_CHUNK_COUNT ? chunkCount - batchStart : BATCH_CHUNK_COUNT;
+            chunkDatas.clear();
+            chunkDatas.resize(batchCount);
+            EncodeChunkTask encodeTask(&encoder, batchStart, &chunkDatas);
+            MagicCore::ParallelTool::ParallelFor(batchCount, &encodeTask, 1);
+            for (GPP::Int localChunkId = 0; localChunkId < batchCount; localChunkId++)
+            {
+                WriteChunk* chunk = new WriteChunk;
+                chunk->mpFileHandle = NULL;
+                chunk->mIsLastChunk = false;
+                chunk->mData.swap(chunkDatas.at(localChunkId));
+                PushChunk(chunk);
+            }
+        }
+    }
+
+    void ModelExporter::EndFile()
+    {
+        WriteChunk* chunk = new WriteChunk;
+        chunk->mpFileHandle = NULL;
+        chunk->mIsLastChunk = true;
+        PushChunk(chunk);
+    }
+
+    void ModelExporter::PushChunk(WriteChunk* chunk)
+    {
+        if (mpWriteThread == NULL)
+        {
+            WriteChunkToFile(chunk);
+            return;
+        }
+        EnterCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+        // Back pressure: the write thread signals mpSpaceEvent after every written chunk
+        while (mPendingByteCount > MAX_PENDING_BYTE_COUNT)
+        {
+            LeaveCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+            WaitForSingleObject((HANDLE)mpSpaceEvent, INFINITE);
+            EnterCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+        }
+        mChunkQueue.push_back(chunk);
+        mPendingByteCount += chunk->mData.size();
+        ResetEvent((HANDLE)mpIdleEvent);
+        SetEvent((HANDLE)mpWorkEvent);
+        LeaveCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+    }
+
+    void ModelExporter::WriteChunkToFile(WriteChunk* chunk)
+    {
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        if (chunk->mpFileHandle != NULL)
+        {
+            mpFileHandle = chunk->mpFileHandle;
+        }
+        if (mpFileHandle != NULL && !chunk->mData.empty())
+        {
+            DWORD writtenSize = 0;
+            if (!WriteFile((HANDLE)mpFileHandle, &chunk->mData.at(0), DWORD(chunk->mData.size()), &writtenSize, NULL) ||
+                writtenSize != DWORD(chunk->mData.size()))
+            {
+                ErrorLog << "ModelExporter: write failed, error " << GetLastError() << std::endl;
+                res = GPP_INVALID_RESULT;
+                CloseHandle((HANDLE)mpFileHandle);
+                mpFileHandle = NULL;
+            }
+        }
+        if (mpFileHandle != NULL && chunk->mIsLastChunk)
+        {
+            CloseHandle((HANDLE)mpFileHandle);
+            mpFileHandle = NULL;
+        }
+        if (res != GPP_NO_ERROR)
+        {
+            EnterCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+            if (mWriteError == GPP_NO_ERROR)
+            {
+                mWriteError = res;
+            }
+            LeaveCriticalSection((CRITICAL_SECTION*)mpQueueLock);
+        }
+        GPPFREEPOINTER(chunk);
+    }
+
+    unsigned __stdcall ModelExporter::WriteThread(void* arg)
+    {
+        ModelExporter* exporter = (ModelExporter*)arg;
+        while (true)
+        {
+            EnterCriticalSection((CRITICAL_SECTION*)exporter->mpQueueLock);
+            if (exporter->mChunkQueue.empty())
+            {
+                bool isStopping = exporter->mIsStopping;
+                SetEvent((HANDLE)exporter->mpIdleEvent);
+                LeaveCriticalSection((CRITICAL_SECTION*)exporter->mpQueueLock);
+                if (isStopping)
+                {
+                    break;
+                }
+                WaitForSingleObject((HANDLE)exporter->mpWorkEvent, INFINITE);
+                continue;
+            }
+            WriteChunk* chunk = exporter->mChunkQueue.front();
+            exporter->mChunkQueue.pop_front();
+            GPP::ULongInt chunkSize = chunk->mData.size();
+            LeaveCriticalSection((CRITICAL_SECTION*)exporter->mpQueueLock);
+
+            exporter->WriteChunkToFile(chunk);
+
+            EnterCriticalSection((CRITICAL_SECTION*)exporter->mpQueueLock);
+            exporter->mPendingByteCount -= chunkSize;
+            SetEvent((HANDLE)exporter->mpSpaceEvent);
+            LeaveCriticalSection((CRITICAL_SECTION*)exporter->mpQueueLock);
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "GPP.h"
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace MagicApp
+{
+    class RecordEncoder;
+
+    // Writes big models as binary little endian PLY, or as text OBJ with per corner texture coordinates, without waiting for the disk.
+    // Records are encoded into chunks in parallel on the calling thread, then a background thread writes the chunks in order.
+    // The caller only waits when too many bytes are queued, so encoding the next batch overlaps writing the previous one.
+    // The model can be changed or freed as soon as an Export function returns. The file is created on the calling thread,
+    // so an Export function fails at once if it can not be opened. Later write errors are returned by Flush, which waits,
+    // or by PopWriteError, which the UI polls every frame (AppManager::Update) so it never blocks on the disk.
+    // Get creates the exporter without a lock, so call it on the main thread before a worker thread uses it.
+    // USAGE: 1. ModelExporter::Get()->ExportPointCloudPly("scan.ply", pointCloud, false);
+    //        2. ModelExporter::Get()->Flush();  // worker thread: wait for the queued files and get the first write error
+    //        or ModelExporter::Get()->PopWriteError();  // main thread: get the first write error so far without waiting
+    class ModelExporter
+    {
+    private:
+        static ModelExporter* mpModelExporter;
+        ModelExporter(void);
+    public:
+        static ModelExporter* Get(void);
+        ~ModelExporter(void);
+
+        // .ply files are written by ExportPointCloudPly and ExportTriMeshPly, other formats by GPP::Parser on the calling thread
+        GPP::ErrorCode ExportPointCloud(const std::string& fileName, const GPP::PointCloud* pointCloud);
+        GPP::ErrorCode ExportTriMesh(const std::string& fileName, const GPP::TriMesh* triMesh);
+        // float coordinates, uchar colors. isCompact: normals are written as char instead of float
+        GPP::ErrorCode ExportPointCloudPly(const std::string& fileName, const GPP::PointCloud* pointCloud, bool isCompact);
+        GPP::ErrorCode ExportTriMeshPly(const std::string& fileName, const GPP::TriMesh* triMesh, bool isCompact);
+        // One texture vertex per triangle corner. materialName is used for mtllib materialName.mtl and usemtl materialName
+        GPP::ErrorCode ExportTexturedObj(const std::string& fileName, const std::string& materialName, const GPP::TriMesh* triMesh);
+
+        // Wait until every queued file is written. Return the first write error since the last Flush
+        GPP::ErrorCode Flush(void);
+        // Return the first write error since the last Flush or PopWriteError without waiting for the queued files
+        GPP::ErrorCode PopWriteError(void);
+        // Write the queued files and stop the write thread. Later exports are written on the calling thread
+        void Shutdown(void);
+
+    private:
+        struct WriteChunk
+        {
+            // The first chunk of a file has the opened file, the last chunk closes it
+            void* mpFileHandle;
+            bool mIsLastChunk;
+            std::vector<char> mData;
+        };
+
+        static bool IsPlyFile(const std::string& fileName);
+        GPP::ErrorCode BeginFile(const std::string& fileName, const std::string& header);
+        void EncodeRecords(const RecordEncoder& encoder);
+        void EndFile(void);
+        void PushChunk(WriteChunk* chunk);
+        void WriteChunkToFile(WriteChunk* chunk);
+        static unsigned __stdcall WriteThread(void* arg);
+
+    private:
+        std::deque<WriteChunk*> mChunkQueue;
+        GPP::ULongInt mPendingByteCount;
+        GPP::ErrorCode mWriteError;
+        bool mIsStopping;
+        void* mpFileHandle;
+        void* mpExportLock;
+        void* mpQueueLock;
+        void* mpWorkEvent;
+        void* mpSpaceEvent;
+        void* mpIdleEvent;
+        void* mpWriteThread;
+    };
+}
@@ -1,4 +1,10 @@
 #include "ModelManager.h"
+#include "MeshAdjacency.h"
+#include "VertexWelder.h"
+#include "BinaryMeshReader.h"
+#include "WorkspaceFile.h"
+#include "ModelRegistry.h"
+#include "../Common/LogSystem.h"
 
 namespace MagicApp
 {
@@ -7,12 +13,17 @@ namespace MagicApp
     ModelManager::ModelManager() :
         mpPointCloud(NULL),
         mpTriMesh(NULL),
+        mMeshVersion(0),
+        mpMeshAdjacency(NULL),
         mObjCenterCoord(),
         mScaleValue(1),
-        mImageColorIds(),
         mTextureImageFiles(),
-        mCloudIds(),
-        mImageColorIdFlags()
+        mPointCloudAttributes(),
+        mMeshAttributes(),
+        mPointCloudName(),
+        mMeshName(),
+        mpModelRegistry(NULL),
+        mStashedTransforms()
     {
     }
 
@@ -29,12 +40,21 @@ namespace MagicApp
     {
         ClearPointCloud();
         ClearMesh();
+        GPPFREEPOINTER(mpMeshAdjacency);
+        GPPFREEPOINTER(mpModelRegistry);
     }
 
     bool ModelManager::ImportPointCloud(std::string fileName)
     {
         GPPFREEPOINTER(mpPointCloud);
-        mpPointCloud = GPP::Parser::ImportPointCloud(fileName);
+        mPointCloudAttributes.Clear();
+        mPointCloudName = fileName;
+        BinaryMeshReader binaryMeshReader;
+        mpPointCloud = binaryMeshReader.ImportPointCloud(fileName);
+        if (mpPointCloud == NULL)
+        {
+            mpPointCloud = GPP::Parser::ImportPointCloud(fileName);
+        }
         if (mpPointCloud == NULL)
         {
             return false;
@@ -79,26 +99,14 @@ namespace MagicApp
         return mObjCenterCoord;
     }
 
-    void ModelManager::SetImageColorIds(const std::vector<GPP::ImageColorId>& imageColorIds)
+    AttributeStore* ModelManager::GetPointCloudAttributes()
     {
-        mImageColorIds = imageColorIds;
+        return &mPointCloudAttributes;
     }
 
-    std::vector<GPP::ImageColorId> ModelManager::GetImageColorIds() const
+    AttributeStore* ModelManager::GetMeshAttributes()
     {
-        return mImageColorIds;
-    }
-
-    std::vector<GPP::ImageColorId>* ModelManager::GetImageColorIdsPointer()
-    {
-        if (mImageColorIds.empty())
-        {
-            return NULL;
-        }
-        else
-        {
-            return &mImageColorIds;
-        }
+        return &mMeshAttributes;
     }
 
     void ModelManager::SetTextureImageFiles(const std::vector<std::string>& textureImageFiles)
@@ -111,178 +119,277 @@ namespace MagicApp
         return mTextureImageFiles;
     }
 
-    void ModelManager::SetCloudIds(const std::vector<int>& cloudIds)
+    bool ModelManager::ImportMesh(std::string fileName)
+    {
+        GPPFREEPOINTER(mpTriMesh);
+        MarkMeshChanged();
+        mMeshAttributes.Clear();
+        mMeshName = fileName;
+        BinaryMeshReader binaryMeshReader;
+        mpTriMesh = binaryMeshReader.ImportTriMesh(fileName);
+        if (mpTriMesh != NULL)
+        {
+            InfoLog << "ModelManager::ImportMesh binary reader: vertex " << mpTriMesh->GetVertexCount() << " triangle " << mpTriMesh->GetTriangleCount()
+                << " read time " << binaryMeshReader.GetReadTime() << " weld time " << binaryMeshReader.GetWeldTime()
+                << " build time " << binaryMeshReader.GetBuildTime() << std::endl;
+        }
+        else
+        {
+            mpTriMesh = GPP::Parser::ImportTriMesh(fileName);
+        }
+        if (mpTriMesh == NULL)
+        {
+            return false;
+        }
+        if (mpTriMesh->GetMeshType() == GPP::MeshType::MT_TRIANGLE_SOUP)
+        {
+            VertexWelder vertexWelder;
+            GPP::TriMesh* weldMesh = vertexWelder.WeldTriMesh(mpTriMesh);
+            if (weldMesh != NULL)
+            {
+                InfoLog << "ModelManager::ImportMesh weld " << mpTriMesh->GetVertexCount() << " points to " << weldMesh->GetVertexCount()
+                    << " vertices, removed triangle " << vertexWelder.GetRemovedTriangleCount() << " weld time " << vertexWelder.GetWeldTime()
+                    << " build time " << vertexWelder.GetBuildTime() << std::endl;
+                GPPFREEPOINTER(mpTriMesh);
+                mpTriMesh = weldMesh;
+            }
+            else
+            {
+                mpTriMesh->FuseVertex();
+            }
+        }
+        mpTriMesh->UnifyCoords(2.0, &mScaleValue, &mObjCenterCoord);
+        mpTriMesh->UpdateNormal();
+        return true;
+    }
+
+    void ModelManager::SetMesh(GPP::TriMesh* triMesh)
     {
-        mCloudIds = cloudIds;
+        GPPFREEPOINTER(mpTriMesh);
+        MarkMeshChanged();
+        mpTriMesh = triMesh;
     }
 
-    std::vector<int> ModelManager::GetCloudIds(void) const
+    GPP::TriMesh* ModelManager::GetMesh()
     {
-        return mCloudIds;
+        return mpTriMesh;
     }
 
-    std::vector<int>* ModelManager::GetCloudIdsPointer(void)
+    void ModelManager::ClearMesh()
     {
-        if (mCloudIds.empty())
-        {
-            return NULL;
-        }
-        else
-        {
-            return &mCloudIds;
-        }
+        GPPFREEPOINTER(mpTriMesh);
+        MarkMeshChanged();
     }
 
-    void ModelManager::SetColorIds(const std::vector<int>& colorIds)
+    void ModelManager::MarkMeshChanged()
     {
-        mColorIds = colorIds;
+        mMeshVersion++;
+        if (mpMeshAdjacency)
+        {
+            mpMeshAdjacency->Clear();
+        }
     }
 
-    std::vector<int> ModelManager::GetColorIds(void) const
+    GPP::Int ModelManager::GetMeshVersion() const
     {
-        return mColorIds;
+        return mMeshVersion;
     }
 
-    std::vector<int>* ModelManager::GetColorIdsPointer(void)
+    const MeshAdjacency* ModelManager::GetMeshAdjacency()
     {
-        if (mColorIds.empty())
+        if (mpTriMesh == NULL)
         {
             return NULL;
         }
-        else
+        if (mpMeshAdjacency == NULL)
         {
-            return &mColorIds;
+            mpMeshAdjacency = new MeshAdjacency;
         }
+        if (!mpMeshAdjacency->IsBuiltFrom(mpTriMesh, mMeshVersion))
+        {
+            if (mpMeshAdjacency->Init(mpTriMesh, mMeshVersion) != GPP_NO_ERROR)
+            {
+                return NULL;
+            }
+        }
+        return mpMeshAdjacency;
     }
 
-    void ModelManager::SetImageColorIdFlag(const std::vector<int>& flags)
+    ModelRegistry* ModelManager::GetModelRegistry()
     {
-        mImageColorIdFlags = flags;
-    }
-    
-    std::vector<int> ModelManager::GetImageColorIdFlags() const
-    {
-        return mImageColorIdFlags;
+        if (mpModelRegistry == NULL)
+        {
+            mpModelRegistry = new ModelRegistry;
+        }
+        return mpModelRegistry;
     }
 
-    std::vector<int>* ModelManager::GetImageColorIdFlagsPointer()
+    GPP::Int ModelManager::StashPointCloud()
     {
-        if (mImageColorIdFlags.empty())
+        if (mpPointCloud == NULL)
         {
-            return NULL;
+            return -1;
         }
-        else
+        AttributeStore* attributes = new AttributeStore;
+        attributes->Swap(mPointCloudAttributes);
+        GPP::Int handle = GetModelRegistry()->AddPointCloud(mpPointCloud, attributes, mPointCloudName);
+        mpPointCloud = NULL;
+        StashTransform(handle);
+        return handle;
+    }
+
+    GPP::Int ModelManager::StashMesh()
+    {
+        if (mpTriMesh == NULL)
         {
-            return &mImageColorIdFlags;
+            return -1;
         }
+        AttributeStore* attributes = new AttributeStore;
+        attributes->Swap(mMeshAttributes);
+        GPP::Int handle = GetModelRegistry()->AddTriMesh(mpTriMesh, attributes, mMeshName);
+        mpTriMesh = NULL;
+        MarkMeshChanged();
+        StashTransform(handle);
+        return handle;
     }
 
-    bool ModelManager::ImportMesh(std::string fileName)
+    bool ModelManager::SwitchPointCloud(GPP::Int handle, GPP::Int* stashedHandle)
     {
-        GPPFREEPOINTER(mpTriMesh);
-        mpTriMesh = GPP::Parser::ImportTriMesh(fileName);
-        if (mpTriMesh == NULL)
+        ModelRegistry* modelRegistry = GetModelRegistry();
+        if (!modelRegistry->IsValid(handle) || !modelRegistry->IsPointCloud(handle))
         {
             return false;
         }
-        if (mpTriMesh->GetMeshType() == GPP::MeshType::MT_TRIANGLE_SOUP)
+        std::string name = modelRegistry->GetName(handle);
+        AttributeStore* attributes = NULL;
+        GPP::PointCloud* pointCloud = modelRegistry->TakePointCloud(handle, &attributes);
+        if (pointCloud == NULL)
         {
-            mpTriMesh->FuseVertex();
+            GPPFREEPOINTER(attributes);
+            return false;
         }
-        mpTriMesh->UnifyCoords(2.0, &mScaleValue, &mObjCenterCoord);
-        mpTriMesh->UpdateNormal();
+        GPP::Int previousHandle = StashPointCloud();
+        if (stashedHandle)
+        {
+            *stashedHandle = previousHandle;
+        }
+        mpPointCloud = pointCloud;
+        mPointCloudName = name;
+        mPointCloudAttributes.Clear();
+        if (attributes)
+        {
+            mPointCloudAttributes.Swap(*attributes);
+            GPPFREEPOINTER(attributes);
+        }
+        RestoreTransform(handle);
+        InfoLog << "ModelManager::SwitchPointCloud " << name << " resident " << modelRegistry->GetResidentByteCount() << " bytes" << std::endl;
         return true;
     }
 
-    void ModelManager::SetMesh(GPP::TriMesh* triMesh)
+    bool ModelManager::SwitchMesh(GPP::Int handle, GPP::Int* stashedHandle)
     {
-        GPPFREEPOINTER(mpTriMesh);
+        ModelRegistry* modelRegistry = GetModelRegistry();
+        if (!modelRegistry->IsValid(handle) || modelRegistry->IsPointCloud(handle))
+        {
+            return false;
+        }
+        std::string name = modelRegistry->GetName(handle);
+        AttributeStore* attributes = NULL;
+        GPP::TriMesh* triMesh = modelRegistry->TakeTriMesh(handle, &attributes);
+        if (triMesh == NULL)
+        {
+            GPPFREEPOINTER(attributes);
+            return false;
+        }
+        GPP::Int previousHandle = StashMesh();
+        if (stashedHandle)
+        {
+            *stashedHandle = previousHandle;
+        }
         mpTriMesh = triMesh;
+        mMeshName = name;
+        MarkMeshChanged();
+        mMeshAttributes.Clear();
+        if (attributes)
+        {
+            mMeshAttributes.Swap(*attributes);
+            GPPFREEPOINTER(attributes);
+        }
+        RestoreTransform(handle);
+        InfoLog << "ModelManager::SwitchMesh " << name << " resident " << modelRegistry->GetResidentByteCount() << " bytes" << std::endl;
+        return true;
     }
 
-    GPP::TriMesh* ModelManager::GetMesh()
+    void ModelManager::ReleaseModel(GPP::Int handle)
     {
-        return mpTriMesh;
+        ModelRegistry* modelRegistry = GetModelRegistry();
+        modelRegistry->Release(handle);
+        if (!modelRegistry->IsValid(handle))
+        {
+            mStashedTransforms.erase(handle);
+        }
     }
 
-    void ModelManager::ClearMesh()
+    void ModelManager::StashTransform(GPP::Int handle)
     {
-        GPPFREEPOINTER(mpTriMesh);
+        ModelTransform transform;
+        transform.mScaleValue = mScaleValue;
+        transform.mObjCenterCoord = mObjCenterCoord;
+        mStashedTransforms[handle] = transform;
     }
 
-    void ModelManager::DumpInfo(std::ofstream& dumpOut) const
+    void ModelManager::RestoreTransform(GPP::Int handle)
     {
-        dumpOut << mImageColorIds.size() << std::endl;
-        for (std::vector<GPP::ImageColorId>::const_iterator itr = mImageColorIds.begin(); itr != mImageColorIds.end(); ++itr)
+        std::map<GPP::Int, ModelTransform>::iterator itr = mStashedTransforms.find(handle);
+        if (itr == mStashedTransforms.end())
         {
-            dumpOut << itr->GetImageIndex() << " " << itr->GetLocalX() << " " << itr->GetLocalY() << " ";
+            return;
         }
-        dumpOut << std::endl;
-           
-        dumpOut << mColorIds.size() << std::endl;
-        for (std::vector<int>::const_iterator itr = mColorIds.begin(); itr != mColorIds.end(); ++itr)
-        {
-            dumpOut << *itr << " ";
-        }
-        dumpOut << std::endl;
+        mScaleValue = itr->second.mScaleValue;
+        mObjCenterCoord = itr->second.mObjCenterCoord;
+        mStashedTransforms.erase(itr);
+    }
 
-        dumpOut << mImageColorIdFlags.size() << std::endl;
-        for (std::vector<int>::const_iterator itr = mImageColorIdFlags.begin(); itr != mImageColorIdFlags.end(); ++itr)
+    static void LoadIntChannel(std::ifstream& loadIn, std::vector<int>& values)
+    {
+        int count = 0;
+        loadIn >> count;
+        values.clear();
+        values.reserve(count);
+        int value;
+        for (int vid = 0; vid < count; vid++)
         {
-            dumpOut << *itr << " ";
+            loadIn >> value;
+            values.push_back(value);
         }
-        dumpOut << std::endl;
+    }
 
-        dumpOut << mCloudIds.size() << std::endl;
-        for (std::vector<int>::const_iterator itr = mCloudIds.begin(); itr != mCloudIds.end(); ++itr)
-        {
-            dumpOut << *itr << " ";
-        }
-        dumpOut << std::endl;
+    bool ModelManager::SaveWorkspace(const std::string& fileName)
+    {
+        return WorkspaceFile::Save(fileName, this) == GPP_NO_ERROR;
     }
 
-    void ModelManager::LoadInfo(std::ifstream& loadIn)
+    bool ModelManager::LoadWorkspace(const std::string& fileName)
     {
-        mImageColorIds.clear();
+        return WorkspaceFile::Load(fileName, this) == GPP_NO_ERROR;
+    }
+
+    void ModelManager::LoadInfo(std::ifstream& loadIn, AttributeStore* attributes)
+    {
+        attributes->Clear();
         int count = 0;
         loadIn >> count;
-        mImageColorIds.reserve(count);
+        std::vector<GPP::ImageColorId>& imageColorIds = attributes->AddChannel(IMAGE_COLOR_ID_CHANNEL, GPP::ImageColorId(-1, 0, 0));
+        imageColorIds.reserve(count);
         int imageIndex;
         double localX, localY;
         for (int iid = 0; iid < count; iid++)
         {
             loadIn >> imageIndex >> localX >> localY;
-            mImageColorIds.push_back(GPP::ImageColorId(imageIndex, int(localX + 0.5), int(localY + 0.5)));
-        }
-
-        mColorIds.clear();
-        loadIn >> count;
-        mColorIds.reserve(count);
-        int colorId;
-        for (int cid = 0; cid < count; cid++)
-        {
-            loadIn >> colorId;
-            mColorIds.push_back(colorId);
-        }
-
-        mImageColorIdFlags.clear();
-        loadIn >> count;
-        mImageColorIdFlags.reserve(count);
-        int flag;
-        for (int fid = 0; fid < count; fid++)
-        {
-            loadIn >> flag;
-            mImageColorIdFlags.push_back(flag);
-        }
-
-        mCloudIds.clear();
-        loadIn >> count;
-        mCloudIds.reserve(count);
-        int cloudId;
-        for (int cid = 0; cid < count; cid++)
-        {
-            loadIn >> cloudId;
-            mCloudIds.push_back(cloudId);
+            imageColorIds.push_back(GPP::ImageColorId(imageIndex, int(localX + 0.5), int(localY + 0.5)));
         }
+        LoadIntChannel(loadIn, attributes->AddChannel(COLOR_ID_CHANNEL, -1));
+        LoadIntChannel(loadIn, attributes->AddChannel(IMAGE_COLOR_ID_FLAG_CHANNEL, 0));
+        LoadIntChannel(loadIn, attributes->AddChannel(CLOUD_ID_CHANNEL, -1));
     }
 }
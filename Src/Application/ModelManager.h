@@ -1,9 +1,14 @@
 #pragma once
 #include "GPP.h"
+#include "AttributeStore.h"
+#include <map>
 #include <string>
 
 namespace MagicApp
 {
+    class MeshAdjacency;
+    class ModelRegistry;
+
     class ModelManager
     {
     private:
@@ -23,44 +28,67 @@ namespace MagicApp
         void SetObjCenterCoord(GPP::Vector3 objCenterCoord);
         GPP::Vector3 GetObjCenterCoord(void) const;
 
-        void SetImageColorIds(const std::vector<GPP::ImageColorId>& imageColorIds);
-        std::vector<GPP::ImageColorId> GetImageColorIds(void) const;
-        std::vector<GPP::ImageColorId>* GetImageColorIdsPointer(void);
+        // Per point channels of the point cloud and per vertex channels of the mesh, see AttributeStore.
+        // Pass them to MagicPointCloud / MagicMesh when the geometry is edited, so they stay in sync
+        AttributeStore* GetPointCloudAttributes(void);
+        AttributeStore* GetMeshAttributes(void);
 
         void SetTextureImageFiles(const std::vector<std::string>& textureImageFiles);
         std::vector<std::string> GetTextureImageFiles(void) const;
 
-        void SetCloudIds(const std::vector<int>& cloudIds);
-        std::vector<int> GetCloudIds(void) const;
-        std::vector<int>* GetCloudIdsPointer(void);
-
-        void SetColorIds(const std::vector<int>& colorIds);
-        std::vector<int> GetColorIds(void) const;
-        std::vector<int>* GetColorIdsPointer(void);
-
-        void SetImageColorIdFlag(const std::vector<int>& flags);
-        std::vector<int> GetImageColorIdFlags(void) const;
-        std::vector<int>* GetImageColorIdFlagsPointer(void);
-
         bool ImportMesh(std::string fileName);
         void SetMesh(GPP::TriMesh* triMesh);
         GPP::TriMesh* GetMesh(void);
         void ClearMesh(void);
+        // Call it after the mesh topology is changed in place, cached topology is rebuilt on the next query
+        void MarkMeshChanged(void);
+        GPP::Int GetMeshVersion(void) const;
+        // Cached adjacency of the current mesh, NULL if there is no mesh
+        const MeshAdjacency* GetMeshAdjacency(void);
 
-        void DumpInfo(std::ofstream& dumpOut) const;
-        void LoadInfo(std::ifstream& loadIn);
+        // Binary workspace snapshot (.gws) of all models, channels, texture files and transform, see WorkspaceFile
+        bool SaveWorkspace(const std::string& fileName);
+        bool LoadWorkspace(const std::string& fileName);
+        // Legacy text .gii channels, loaded into attributes
+        void LoadInfo(std::ifstream& loadIn, AttributeStore* attributes);
+
+        // Models that are open but not current, kept under a memory budget, see ModelRegistry
+        ModelRegistry* GetModelRegistry(void);
+        // Move the current model, its channels and transform into the registry. Return its handle, -1 if there is no model
+        GPP::Int StashPointCloud(void);
+        GPP::Int StashMesh(void);
+        // Stash the current model and make the registered one current, its handle is dropped.
+        // stashedHandle: handle of the previous model, -1 if there was none
+        bool SwitchPointCloud(GPP::Int handle, GPP::Int* stashedHandle = NULL);
+        bool SwitchMesh(GPP::Int handle, GPP::Int* stashedHandle = NULL);
+        // Release a stashed model. Its transform is dropped with the last reference
+        void ReleaseModel(GPP::Int handle);
 
         ~ModelManager();
 
+    private:
+        struct ModelTransform
+        {
+            GPP::Real mScaleValue;
+            GPP::Vector3 mObjCenterCoord;
+        };
+
+        void StashTransform(GPP::Int handle);
+        void RestoreTransform(GPP::Int handle);
+
     private:
         GPP::PointCloud* mpPointCloud;
         GPP::TriMesh* mpTriMesh;
+        GPP::Int mMeshVersion;
+        MeshAdjacency* mpMeshAdjacency;
         GPP::Vector3 mObjCenterCoord;
         GPP::Real mScaleValue;
-        std::vector<GPP::ImageColorId> mImageColorIds;
         std::vector<std::string> mTextureImageFiles;
-        std::vector<int> mCloudIds;
-        std::vector<int> mColorIds;
-        std::vector<int> mImageColorIdFlags;
+        AttributeStore mPointCloudAttributes;
+        AttributeStore mMeshAttributes;
+        std::string mPointCloudName;
+        std::string mMeshName;
+        ModelRegistry* mpModelRegistry;
+        std::map<GPP::Int, ModelTransform> mStashedTransforms;
     };
 }
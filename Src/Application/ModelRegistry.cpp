@@ -0,0 +1,1037 @@
+#include "ModelRegistry.h"
+#include "AttributeStore.h"
+#include "../Common/LogSystem.h"
+#include "../Common/ToolKit.h"
+#include <windows.h>
+#include <stdio.h>
+#include <sstream>
+
+namespace MagicApp
+{
+    static const GPP::ULongInt DEFAULT_MEMORY_BUDGET = GPP::ULongInt(2048) * 1024 * 1024;
+    static const GPP::Int SPILL_CHUNK_COUNT = 65536;
+    static const GPP::ULongInt SPILL_HEADER_COUNT = 4;
+    static const GPP::ULongInt HAS_VERTEX_COLOR = 1;
+    static const GPP::ULongInt HAS_VERTEX_TEXCOORD = 2;
+    static const GPP::ULongInt HAS_TRIANGLE_TEXCOORD = 4;
+    static const GPP::ULongInt HAS_TRIANGLE_COLOR = 8;
+
+    typedef GPP::Vector3 (GPP::TriMesh::*TriangleVectorGetter)(GPP::Int fid, GPP::Int localVid) const;
+    typedef void (GPP::TriMesh::*TriangleVectorSetter)(GPP::Int fid, GPP::Int localVid, const GPP::Vector3& value);
+
+    class RegistryLock
+    {
+    public:
+        explicit RegistryLock(void* lock) :
+            mpLock(lock)
+        {
+            EnterCriticalSection((CRITICAL_SECTION*)mpLock);
+        }
+
+        ~RegistryLock()
+        {
+            LeaveCriticalSection((CRITICAL_SECTION*)mpLock);
+        }
+
+    private:
+        void* mpLock;
+    };
+
+    static void PushVector3(const GPP::Vector3& value, std::vector<double>& values)
+    {
+        values.push_back(value[0]);
+        values.push_back(value[1]);
+        values.push_back(value[2]);
+    }
+
+    static GPP::Vector3 GetVector3(const std::vector<double>& values, GPP::Int id)
+    {
+        return GPP::Vector3(values.at(id), values.at(id + 1), values.at(id + 2));
+    }
+
+    template<class T>
+    static bool WriteChunk(std::fstream& file, const std::vector<T>& values)
+    {
+        if (!values.empty())
+        {
+            file.write((const char*)&values.at(0), values.size() * sizeof(T));
+        }
+        return file.good();
+    }
+
+    template<class T>
+    static bool ReadChunk(std::fstream& file, std::vector<T>& values, GPP::ULongInt valueCount)
+    {
+        values.resize(valueCount);
+        if (valueCount > 0)
+        {
+            file.read((char*)&values.at(0), valueCount * sizeof(T));
+        }
+        return file.good();
+    }
+
+    // Point record: header, then coordinate [normal] [color] of every point
+    static GPP::ULongInt GetPointCloudRecordByteCount(const GPP::PointCloud* pointCloud)
+    {
+        GPP::ULongInt pointValueCount = 3 + (pointCloud->HasNormal() ? 3 : 0) + (pointCloud->HasColor() ? 3 : 0);
+        return SPILL_HEADER_COUNT * sizeof(GPP::ULongInt) + GPP::ULongInt(pointCloud->GetPointCount()) * pointValueCount * sizeof(double);
+    }
+
+    static bool WritePointCloud(std::fstream& file, const GPP::PointCloud* pointCloud)
+    {
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        bool hasNormal = pointCloud->HasNormal();
+        bool hasColor = pointCloud->HasColor();
+        std::vector<GPP::ULongInt> header(SPILL_HEADER_COUNT, 0);
+        header.at(0) = pointCount;
+        header.at(1) = hasNormal ? 1 : 0;
+        header.at(2) = hasColor ? 1 : 0;
+        if (!WriteChunk(file, header))
+        {
+            return false;
+        }
+        std::vector<double> values;
+        for (GPP::Int chunkStart = 0; chunkStart < pointCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < pointCount ? chunkStart + SPILL_CHUNK_COUNT : pointCount;
+            values.clear();
+            for (GPP::Int pid = chunkStart; pid < chunkEnd; pid++)
+            {
+                PushVector3(pointCloud->GetPointCoord(pid), values);
+                if (hasNormal)
+                {
+                    PushVector3(pointCloud->GetPointNormal(pid), values);
+                }
+                if (hasColor)
+                {
+                    PushVector3(pointCloud->GetPointColor(pid), values);
+                }
+            }
+            if (!WriteChunk(file, values))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static GPP::PointCloud* ReadPointCloud(std::fstream& file)
+    {
+        std::vector<GPP::ULongInt> header;
+        if (!ReadChunk(file, header, SPILL_HEADER_COUNT))
+        {
+            return NULL;
+        }
+        GPP::Int pointCount = GPP::Int(header.at(0));
+        bool hasNormal = header.at(1) != 0;
+        bool hasColor = header.at(2) != 0;
+        GPP::Int pointValueCount = 3 + (hasNormal ? 3 : 0) + (hasColor ? 3 : 0);
+        GPP::PointCloud* pointCloud = new GPP::PointCloud(hasNormal, hasColor);
+        pointCloud->ReservePoint(pointCount);
+        std::vector<double> values;
+        for (GPP::Int chunkStart = 0; chunkStart < pointCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < pointCount ? chunkStart + SPILL_CHUNK_COUNT : pointCount;
+            if (!ReadChunk(file, values, GPP::ULongInt(chunkEnd - chunkStart) * pointValueCount))
+            {
+                GPPFREEPOINTER(pointCloud);
+                return NULL;
+            }
+            for (GPP::Int pid = chunkStart; pid < chunkEnd; pid++)
+            {
+                GPP::Int valueId = (pid - chunkStart) * pointValueCount;
+                GPP::Int insertId = hasNormal ? pointCloud->InsertPoint(GetVector3(values, valueId), GetVector3(values, valueId + 3)) :
+                    pointCloud->InsertPoint(GetVector3(values, valueId));
+                if (hasColor)
+                {
+                    pointCloud->SetPointColor(insertId, GetVector3(values, valueId + pointValueCount - 3));
+                }
+            }
+        }
+        return pointCloud;
+    }
+
+    // 3 vectors of every triangle, one per triangle corner
+    static bool WriteTriangleVectors(std::fstream& file, const GPP::TriMesh* triMesh, TriangleVectorGetter getter)
+    {
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        std::vector<double> values;
+        for (GPP::Int chunkStart = 0; chunkStart < triangleCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < triangleCount ? chunkStart + SPILL_CHUNK_COUNT : triangleCount;
+            values.clear();
+            for (GPP::Int fid = chunkStart; fid < chunkEnd; fid++)
+            {
+                for (GPP::Int localVid = 0; localVid < 3; localVid++)
+                {
+                    PushVector3((triMesh->*getter)(fid, localVid), values);
+                }
+            }
+            if (!WriteChunk(file, values))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool ReadTriangleVectors(std::fstream& file, GPP::TriMesh* triMesh, TriangleVectorSetter setter)
+    {
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        std::vector<double> values;
+        for (GPP::Int chunkStart = 0; chunkStart < triangleCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < triangleCount ? chunkStart + SPILL_CHUNK_COUNT : triangleCount;
+            if (!ReadChunk(file, values, GPP::ULongInt(chunkEnd - chunkStart) * 9))
+            {
+                return false;
+            }
+            for (GPP::Int fid = chunkStart; fid < chunkEnd; fid++)
+            {
+                for (GPP::Int localVid = 0; localVid < 3; localVid++)
+                {
+                    (triMesh->*setter)(fid, localVid, GetVector3(values, (fid - chunkStart) * 9 + localVid * 3));
+                }
+            }
+        }
+        return true;
+    }
+
+    // Mesh record: header, coordinate [color] [texture coordinate] of every vertex, vertex ids of every triangle,
+    // then [3 texture coordinates of every triangle] [3 colors of every triangle]. Normals are recomputed on load
+    static GPP::ULongInt GetTriMeshRecordByteCount(const GPP::TriMesh* triMesh)
+    {
+        GPP::ULongInt vertexValueCount = 3 + (triMesh->HasVertexColor() ? 3 : 0) + (triMesh->HasVertexTexCoord() ? 3 : 0);
+        GPP::ULongInt triangleValueCount = (triMesh->HasTriangleTexCoord() ? 9 : 0) + (triMesh->HasTriangleColor() ? 9 : 0);
+        GPP::ULongInt triangleCount = triMesh->GetTriangleCount();
+        return SPILL_HEADER_COUNT * sizeof(GPP::ULongInt) + GPP::ULongInt(triMesh->GetVertexCount()) * vertexValueCount * sizeof(double) +
+            triangleCount * 3 * sizeof(GPP::Int) + triangleCount * triangleValueCount * sizeof(double);
+    }
+
+    static bool WriteTriMesh(std::fstream& file, const GPP::TriMesh* triMesh)
+    {
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        bool hasVertexColor = triMesh->HasVertexColor();
+        bool hasVertexTexCoord = triMesh->HasVertexTexCoord();
+        bool hasTriangleTexCoord = triMesh->HasTriangleTexCoord();
+        bool hasTriangleColor = triMesh->HasTriangleColor();
+        std::vector<GPP::ULongInt> header(SPILL_HEADER_COUNT, 0);
+        header.at(0) = vertexCount;
+        header.at(1) = triangleCount;
+        header.at(2) = (hasVertexColor ? HAS_VERTEX_COLOR : 0) | (hasVertexTexCoord ? HAS_VERTEX_TEXCOORD : 0) |
+            (hasTriangleTexCoord ? HAS_TRIANGLE_TEXCOORD : 0) | (hasTriangleColor ? HAS_TRIANGLE_COLOR : 0);
+        header.at(3) = GPP::ULongInt(triMesh->GetMeshType());
+        if (!WriteChunk(file, header))
+        {
+            return false;
+        }
+        std::vector<double> values;
+        for (GPP::Int chunkStart = 0; chunkStart < vertexCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < vertexCount ? chunkStart + SPILL_CHUNK_COUNT : vertexCount;
+            values.clear();
+            for (GPP::Int vid = chunkStart; vid < chunkEnd; vid++)
+            {
+                PushVector3(triMesh->GetVertexCoord(vid), values);
+                if (hasVertexColor)
+                {
+                    PushVector3(triMesh->GetVertexColor(vid), values);
+                }
+                if (hasVertexTexCoord)
+                {
+                    PushVector3(triMesh->GetVertexTexcoord(vid), values);
+                }
+            }
+            if (!WriteChunk(file, values))
+            {
+                return false;
+            }
+        }
+        std::vector<GPP::Int> triangleVertexIds;
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int chunkStart = 0; chunkStart < triangleCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < triangleCount ? chunkStart + SPILL_CHUNK_COUNT : triangleCount;
+            triangleVertexIds.clear();
+            for (GPP::Int fid = chunkStart; fid < chunkEnd; fid++)
+            {
+                triMesh->GetTriangleVertexIds(fid, vertexIds);
+                triangleVertexIds.push_back(vertexIds[0]);
+                triangleVertexIds.push_back(vertexIds[1]);
+                triangleVertexIds.push_back(vertexIds[2]);
+            }
+            if (!WriteChunk(file, triangleVertexIds))
+            {
+                return false;
+            }
+        }
+        if (hasTriangleTexCoord && !WriteTriangleVectors(file, triMesh, &GPP::TriMesh::GetTriangleTexcoord))
+        {
+            return false;
+        }
+        if (hasTriangleColor && !WriteTriangleVectors(file, triMesh, &GPP::TriMesh::GetTriangleColor))
+        {
+            return false;
+        }
+        return true;
+    }
+
+    static GPP::TriMesh* ReadTriMesh(std::fstream& file)
+    {
+        std::vector<GPP::ULongInt> header;
+        if (!ReadChunk(file, header, SPILL_HEADER_COUNT))
+        {
+            return NULL;
+        }
+        GPP::Int vertexCount = GPP::Int(header.at(0));
+        GPP::Int triangleCount = GPP::Int(header.at(1));
+        bool hasVertexColor = (header.at(2) & HAS_VERTEX_COLOR) != 0;
+        bool hasVertexTexCoord = (header.at(2) & HAS_VERTEX_TEXCOORD) != 0;
+        bool hasTriangleTexCoord = (header.at(2) & HAS_TRIANGLE_TEXCOORD) != 0;
+        bool hasTriangleColor = (header.at(2) & HAS_TRIANGLE_COLOR) != 0;
+        GPP::Int vertexValueCount = 3 + (hasVertexColor ? 3 : 0) + (hasVertexTexCoord ? 3 : 0);
+        GPP::TriMesh* triMesh = new GPP::TriMesh(hasVertexColor, hasVertexTexCoord, hasTriangleTexCoord);
+        triMesh->SetMeshType(GPP::MeshType(header.at(3)));
+        std::vector<double> values;
+        for (GPP::Int chunkStart = 0; chunkStart < vertexCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < vertexCount ? chunkStart + SPILL_CHUNK_COUNT : vertexCount;
+            if (!ReadChunk(file, values, GPP::ULongInt(chunkEnd - chunkStart) * vertexValueCount))
+            {
+                GPPFREEPOINTER(triMesh);
+                return NULL;
+            }
+            for (GPP::Int vid = chunkStart; vid < chunkEnd; vid++)
+            {
+                GPP::Int valueId = (vid - chunkStart) * vertexValueCount;
+                GPP::Int insertId = triMesh->InsertVertex(GetVector3(values, valueId));
+                valueId += 3;
+                if (hasVertexColor)
+                {
+                    triMesh->SetVertexColor(insertId, GetVector3(values, valueId));
+                    valueId += 3;
+                }
+                if (hasVertexTexCoord)
+                {
+                    triMesh->SetVertexTexcoord(insertId, GetVector3(values, valueId));
+                }
+            }
+        }
+        std::vector<GPP::Int> triangleVertexIds;
+        for (GPP::Int chunkStart = 0; chunkStart < triangleCount; chunkStart += SPILL_CHUNK_COUNT)
+        {
+            GPP::Int chunkEnd = chunkStart + SPILL_CHUNK_COUNT < triangleCount ? chunkStart + SPILL_CHUNK_COUNT : triangleCount;
+            if (!ReadChunk(file, triangleVertexIds, GPP::ULongInt(chunkEnd - chunkStart) * 3))
+            {
+                GPPFREEPOINTER(triMesh);
+                return NULL;
+            }
+            for (GPP::Int fid = chunkStart; fid < chunkEnd; fid++)
+            {
+                GPP::Int valueId = (fid - chunkStart) * 3;
+                triMesh->InsertTriangle(triangleVertexIds.at(valueId), triangleVertexIds.at(valueId + 1), triangleVertexIds.at(valueId + 2));
+            }
+        }
+        if (hasTriangleTexCoord && !ReadTriangleVectors(file, triMesh, &GPP::TriMesh::SetTriangleTexcoord))
+        {
+            GPPFREEPOINTER(triMesh);
+            return NULL;
+        }
+        if (hasTriangleColor)
+        {
+            triMesh->SetHasTriangleColor(true);
+            if (!ReadTriangleVectors(file, triMesh, &GPP::TriMesh::SetTriangleColor))
+            {
+                GPPFREEPOINTER(triMesh);
+                return NULL;
+            }
+        }
+        triMesh->UpdateNormal();
+        return triMesh;
+    }
+
+    // Loaded int and GPP::ImageColorId channels are spilled as ints, 1 and 3 per element. 0 for other channel types
+    static GPP::ULongInt GetChannelComponentCount(AttributeStore* attributes, const std::string& name)
+    {
+        if (attributes->GetChannel<int>(name) != NULL)
+        {
+            return 1;
+        }
+        if (attributes->GetChannel<GPP::ImageColorId>(name) != NULL)
+        {
+            return 3;
+        }
+        return 0;
+    }
+
+    static GPP::ULongInt GetChannelElementCount(AttributeStore* attributes, const std::string& name, GPP::ULongInt componentCount)
+    {
+        return componentCount == 1 ? attributes->GetChannel<int>(name)->size() : attributes->GetChannel<GPP::ImageColorId>(name)->size();
+    }
+
+    // Channels that go to the spill record with the geometry. Channels that are not loaded stay with their loaders
+    static void GetSpillChannelNames(AttributeStore* attributes, std::vector<std::string>& names)
+    {
+        names.clear();
+        if (attributes == NULL)
+        {
+            return;
+        }
+        std::vector<std::string> loadedNames;
+        attributes->GetLoadedChannelNames(loadedNames);
+        for (std::vector<std::string>::iterator itr = loadedNames.begin(); itr != loadedNames.end(); ++itr)
+        {
+            if (GetChannelComponentCount(attributes, *itr) > 0)
+            {
+                names.push_back(*itr);
+            }
+        }
+    }
+
+    // Channel record, after the model record: per channel a header (component count, element count, name length), the name and the values
+    static GPP::ULongInt GetChannelRecordByteCount(AttributeStore* attributes, const std::vector<std::string>& names)
+    {
+        GPP::ULongInt byteCount = 0;
+        for (std::vector<std::string>::const_iterator itr = names.begin(); itr != names.end(); ++itr)
+        {
+            GPP::ULongInt componentCount = GetChannelComponentCount(attributes, *itr);
+            byteCount += 3 * sizeof(GPP::ULongInt) + itr->size() +
+                GetChannelElementCount(attributes, *itr, componentCount) * componentCount * sizeof(int);
+        }
+        return byteCount;
+    }
+
+    // The channel values are freed once they are written, the channels themselves stay in the store
+    static bool WriteChannels(std::fstream& file, AttributeStore* attributes, const std::vector<std::string>& names)
+    {
+        std::vector<GPP::ULongInt> header(3, 0);
+        std::vector<int> values;
+        for (std::vector<std::string>::const_iterator itr = names.begin(); itr != names.end(); ++itr)
+        {
+            GPP::ULongInt componentCount = GetChannelComponentCount(attributes, *itr);
+            header.at(0) = componentCount;
+            header.at(1) = GetChannelElementCount(attributes, *itr, componentCount);
+            header.at(2) = itr->size();
+            std::vector<char> name(itr->begin(), itr->end());
+            if (!WriteChunk(file, header) || !WriteChunk(file, name))
+            {
+                return false;
+            }
+            if (componentCount == 1)
+            {
+                if (!WriteChunk(file, *(attributes->GetChannel<int>(*itr))))
+                {
+                    return false;
+                }
+                continue;
+            }
+            const std::vector<GPP::ImageColorId>* imageColorIds = attributes->GetChannel<GPP::ImageColorId>(*itr);
+            values.clear();
+            values.reserve(imageColorIds->size() * 3);
+            for (std::vector<GPP::ImageColorId>::const_iterator idItr = imageColorIds->begin(); idItr != imageColorIds->end(); ++idItr)
+            {
+                values.push_back(idItr->GetImageIndex());
+                values.push_back(idItr->GetLocalX());
+                values.push_back(idItr->GetLocalY());
+            }
+            if (!WriteChunk(file, values))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void FreeChannelValues(AttributeStore* attributes, const std::vector<std::string>& names)
+    {
+        for (std::vector<std::string>::const_iterator itr = names.begin(); itr != names.end(); ++itr)
+        {
+            std::vector<int>* intValues = attributes->GetChannel<int>(*itr);
+            if (intValues != NULL)
+            {
+                std::vector<int>().swap(*intValues);
+                continue;
+            }
+            std::vector<GPP::ImageColorId>* imageColorIds = attributes->GetChannel<GPP::ImageColorId>(*itr);
+            if (imageColorIds != NULL)
+            {
+                std::vector<GPP::ImageColorId>().swap(*imageColorIds);
+            }
+        }
+    }
+
+    static bool ReadChannels(std::fstream& file, AttributeStore* attributes, const std::vector<std::string>& names)
+    {
+        std::vector<GPP::ULongInt> header;
+        std::vector<char> name;
+        std::vector<int> values;
+        for (std::vector<std::string>::const_iterator itr = names.begin(); itr != names.end(); ++itr)
+        {
+            if (!ReadChunk(file, header, 3) || !ReadChunk(file, name, header.at(2)) || std::string(name.begin(), name.end()) != *itr ||
+                !ReadChunk(file, values, header.at(0) * header.at(1)))
+            {
+                return false;
+            }
+            std::vector<int>* intValues = attributes->GetChannel<int>(*itr);
+            if (intValues != NULL && header.at(0) == 1)
+            {
+                intValues->swap(values);
+                continue;
+            }
+            std::vector<GPP::ImageColorId>* imageColorIds = attributes->GetChannel<GPP::ImageColorId>(*itr);
+            if (imageColorIds == NULL || header.at(0) != 3)
+            {
+                return false;
+            }
+            GPP::Int elementCount = GPP::Int(header.at(1));
+            imageColorIds->resize(elementCount);
+            for (GPP::Int eid = 0; eid < elementCount; eid++)
+            {
+                imageColorIds->at(eid).Set(values.at(eid * 3), values.at(eid * 3 + 1), values.at(eid * 3 + 2));
+            }
+        }
+        return true;
+    }
+
+    ModelRegistry::ModelRegistry() :
+        mEntries(),
+        mNextHandle(0),
+        mAccessCount(0),
+        mMemoryBudget(DEFAULT_MEMORY_BUDGET),
+        mResidentByteCount(0),
+        mSpillFileName(),
+        mSpillFile(),
+        mSpillFileSize(0),
+        mFreeExtents(),
+        mEvictTime(0),
+        mLoadTime(0),
+        mpLock(NULL)
+    {
+        CRITICAL_SECTION* lock = new CRITICAL_SECTION;
+        InitializeCriticalSection(lock);
+        mpLock = lock;
+    }
+
+    ModelRegistry::~ModelRegistry()
+    {
+        Clear();
+        if (mSpillFile.is_open())
+        {
+            mSpillFile.close();
+            remove(mSpillFileName.c_str());
+        }
+        CRITICAL_SECTION* lock = (CRITICAL_SECTION*)mpLock;
+        DeleteCriticalSection(lock);
+        GPPFREEPOINTER(lock);
+        mpLock = NULL;
+    }
+
+    GPP::Int ModelRegistry::AddPointCloud(GPP::PointCloud* pointCloud, AttributeStore* attributes, const std::string& name)
+    {
+        if (pointCloud == NULL)
+        {
+            return -1;
+        }
+        ModelEntry* entry = new ModelEntry;
+        entry->mType = MODEL_POINTCLOUD;
+        entry->mName = name;
+        entry->mpPointCloud = pointCloud;
+        entry->mpTriMesh = NULL;
+        entry->mpAttributes = attributes;
+        RegistryLock registryLock(mpLock);
+        return AddEntry(entry);
+    }
+
+    GPP::Int ModelRegistry::AddTriMesh(GPP::TriMesh* triMesh, AttributeStore* attributes, const std::string& name)
+    {
+        if (triMesh == NULL)
+        {
+            return -1;
+        }
+        ModelEntry* entry = new ModelEntry;
+        entry->mType = MODEL_TRIMESH;
+        entry->mName = name;
+        entry->mpPointCloud = NULL;
+        entry->mpTriMesh = triMesh;
+        entry->mpAttributes = attributes;
+        RegistryLock registryLock(mpLock);
+        return AddEntry(entry);
+    }
+
+    void ModelRegistry::AddReference(GPP::Int handle)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry)
+        {
+            entry->mReferenceCount++;
+        }
+    }
+
+    void ModelRegistry::Release(GPP::Int handle)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry == NULL || entry->mReferenceCount <= 0)
+        {
+            return;
+        }
+        entry->mReferenceCount--;
+        if (entry->mReferenceCount == 0 && entry->mPinCount == 0)
+        {
+            FreeEntry(handle, true);
+        }
+    }
+
+    GPP::PointCloud* ModelRegistry::TakePointCloud(GPP::Int handle, AttributeStore** attributes)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry == NULL || entry->mType != MODEL_POINTCLOUD || (entry->mpPointCloud == NULL && !LoadEntry(entry)))
+        {
+            return NULL;
+        }
+        GPP::PointCloud* pointCloud = entry->mpPointCloud;
+        if (attributes)
+        {
+            *attributes = entry->mpAttributes;
+            entry->mpAttributes = NULL;
+        }
+        FreeEntry(handle, false);
+        return pointCloud;
+    }
+
+    GPP::TriMesh* ModelRegistry::TakeTriMesh(GPP::Int handle, AttributeStore** attributes)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry == NULL || entry->mType != MODEL_TRIMESH || (entry->mpTriMesh == NULL && !LoadEntry(entry)))
+        {
+            return NULL;
+        }
+        GPP::TriMesh* triMesh = entry->mpTriMesh;
+        if (attributes)
+        {
+            *attributes = entry->mpAttributes;
+            entry->mpAttributes = NULL;
+        }
+        FreeEntry(handle, false);
+        return triMesh;
+    }
+
+    GPP::PointCloud* ModelRegistry::PinPointCloud(GPP::Int handle)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry == NULL || entry->mType != MODEL_POINTCLOUD || !PinEntry(entry))
+        {
+            return NULL;
+        }
+        return entry->mpPointCloud;
+    }
+
+    GPP::TriMesh* ModelRegistry::PinTriMesh(GPP::Int handle)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry == NULL || entry->mType != MODEL_TRIMESH || !PinEntry(entry))
+        {
+            return NULL;
+        }
+        return entry->mpTriMesh;
+    }
+
+    void ModelRegistry::Unpin(GPP::Int handle, bool isChanged)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry == NULL || entry->mPinCount <= 0)
+        {
+            return;
+        }
+        entry->mPinCount--;
+        if (isChanged)
+        {
+            FreeSpillRecord(entry);
+            mResidentByteCount -= entry->mByteCount;
+            entry->mByteCount = GetModelByteCount(entry);
+            mResidentByteCount += entry->mByteCount;
+        }
+        if (entry->mReferenceCount == 0 && entry->mPinCount == 0)
+        {
+            FreeEntry(handle, true);
+        }
+        EnforceBudget();
+    }
+
+    AttributeStore* ModelRegistry::GetAttributes(GPP::Int handle)
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        if (entry == NULL || (entry->mpPointCloud == NULL && entry->mpTriMesh == NULL))
+        {
+            return NULL;
+        }
+        return entry->mpAttributes;
+    }
+
+    bool ModelRegistry::IsValid(GPP::Int handle) const
+    {
+        RegistryLock registryLock(mpLock);
+        return FindEntry(handle) != NULL;
+    }
+
+    bool ModelRegistry::IsPointCloud(GPP::Int handle) const
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        return entry != NULL && entry->mType == MODEL_POINTCLOUD;
+    }
+
+    bool ModelRegistry::IsResident(GPP::Int handle) const
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        return entry != NULL && (entry->mpPointCloud != NULL || entry->mpTriMesh != NULL);
+    }
+
+    std::string ModelRegistry::GetName(GPP::Int handle) const
+    {
+        RegistryLock registryLock(mpLock);
+        ModelEntry* entry = FindEntry(handle);
+        return entry ? entry->mName : std::string();
+    }
+
+    void ModelRegistry::GetHandles(std::vector<GPP::Int>& handles) const
+    {
+        RegistryLock registryLock(mpLock);
+        handles.clear();
+        for (std::map<GPP::Int, ModelEntry*>::const_iterator itr = mEntries.begin(); itr != mEntries.end(); ++itr)
+        {
+            handles.push_back(itr->first);
+        }
+    }
+
+    void ModelRegistry::Clear()
+    {
+        RegistryLock registryLock(mpLock);
+        while (!mEntries.empty())
+        {
+            FreeEntry(mEntries.begin()->first, true);
+        }
+        mFreeExtents.clear();
+        mSpillFileSize = 0;
+    }
+
+    void ModelRegistry::SetMemoryBudget(GPP::ULongInt byteCount)
+    {
+        RegistryLock registryLock(mpLock);
+        mMemoryBudget = byteCount;
+        EnforceBudget();
+    }
+
+    GPP::ULongInt ModelRegistry::GetMemoryBudget() const
+    {
+        RegistryLock registryLock(mpLock);
+        return mMemoryBudget;
+    }
+
+    GPP::ULongInt ModelRegistry::GetResidentByteCount() const
+    {
+        RegistryLock registryLock(mpLock);
+        return mResidentByteCount;
+    }
+
+    GPP::ULongInt ModelRegistry::GetSpillByteCount() const
+    {
+        RegistryLock registryLock(mpLock);
+        return mSpillFileSize;
+    }
+
+    double ModelRegistry::GetEvictTime() const
+    {
+        RegistryLock registryLock(mpLock);
+        return mEvictTime;
+    }
+
+    double ModelRegistry::GetLoadTime() const
+    {
+        RegistryLock registryLock(mpLock);
+        return mLoadTime;
+    }
+
+    GPP::Int ModelRegistry::AddEntry(ModelEntry* entry)
+    {
+        entry->mReferenceCount = 1;
+        entry->mPinCount = 0;
+        entry->mLastAccess = ++mAccessCount;
+        entry->mByteCount = GetModelByteCount(entry);
+        entry->mSpillOffset = -1;
+        entry->mSpillByteCount = 0;
+        GPP::Int handle = mNextHandle++;
+        mEntries[handle] = entry;
+        mResidentByteCount += entry->mByteCount;
+        EnforceBudget();
+        return handle;
+    }
+
+    ModelRegistry::ModelEntry* ModelRegistry::FindEntry(GPP::Int handle) const
+    {
+        std::map<GPP::Int, ModelEntry*>::const_iterator itr = mEntries.find(handle);
+        return itr == mEntries.end() ? NULL : itr->second;
+    }
+
+    bool ModelRegistry::PinEntry(ModelEntry* entry)
+    {
+        if (entry->mpPointCloud == NULL && entry->mpTriMesh == NULL && !LoadEntry(entry))
+        {
+            return false;
+        }
+        entry->mPinCount++;
+        entry->mLastAccess = ++mAccessCount;
+        // Make room for the loaded model, it is pinned so it stays
+        EnforceBudget();
+        return true;
+    }
+
+    void ModelRegistry::FreeEntry(GPP::Int handle, bool isFreeModel)
+    {
+        std::map<GPP::Int, ModelEntry*>::iterator itr = mEntries.find(handle);
+        if (itr == mEntries.end())
+        {
+            return;
+        }
+        ModelEntry* entry = itr->second;
+        FreeSpillRecord(entry);
+        if (entry->mpPointCloud != NULL || entry->mpTriMesh != NULL)
+        {
+            mResidentByteCount -= entry->mByteCount;
+        }
+        if (isFreeModel)
+        {
+            GPPFREEPOINTER(entry->mpPointCloud);
+            GPPFREEPOINTER(entry->mpTriMesh);
+        }
+        GPPFREEPOINTER(entry->mpAttributes);
+        GPPFREEPOINTER(entry);
+        mEntries.erase(itr);
+    }
+
+    void ModelRegistry::EnforceBudget()
+    {
+        while (mResidentByteCount > mMemoryBudget)
+        {
+            // Least recently used resident model that is not pinned
+            ModelEntry* evictEntry = NULL;
+            for (std::map<GPP::Int, ModelEntry*>::iterator itr = mEntries.begin(); itr != mEntries.end(); ++itr)
+            {
+                ModelEntry* entry = itr->second;
+                if (entry->mPinCount > 0 || (entry->mpPointCloud == NULL && entry->mpTriMesh == NULL))
+                {
+                    continue;
+                }
+                if (evictEntry == NULL || entry->mLastAccess < evictEntry->mLastAccess)
+                {
+                    evictEntry = entry;
+                }
+            }
+            if (evictEntry == NULL || !EvictEntry(evictEntry))
+            {
+                break;
+            }
+        }
+    }
+
+    bool ModelRegistry::EvictEntry(ModelEntry* entry)
+    {
+        double startTime = MagicCore::ToolKit::GetTime();
+        if (entry->mSpillOffset < 0)
+        {
+            GetSpillChannelNames(entry->mpAttributes, entry->mSpillChannels);
+            GPP::ULongInt recordByteCount = entry->mType == MODEL_POINTCLOUD ? GetPointCloudRecordByteCount(entry->mpPointCloud) :
+                GetTriMeshRecordByteCount(entry->mpTriMesh);
+            recordByteCount += GetChannelRecordByteCount(entry->mpAttributes, entry->mSpillChannels);
+            // First free extent that is large enough, or the end of the file
+            GPP::ULongInt offset = mSpillFileSize;
+            for (std::vector<SpillExtent>::iterator itr = mFreeExtents.begin(); itr != mFreeExtents.end(); ++itr)
+            {
+                if (itr->mByteCount >= recordByteCount)
+                {
+                    offset = itr->mOffset;
+                    itr->mOffset += recordByteCount;
+                    itr->mByteCount -= recordByteCount;
+                    if (itr->mByteCount == 0)
+                    {
+                        mFreeExtents.erase(itr);
+                    }
+                    break;
+                }
+            }
+            entry->mSpillOffset = GPP::LongInt(offset);
+            entry->mSpillByteCount = recordByteCount;
+            if (offset == mSpillFileSize)
+            {
+                mSpillFileSize += recordByteCount;
+            }
+            if (!OpenSpillFile())
+            {
+                FreeSpillRecord(entry);
+                return false;
+            }
+            mSpillFile.clear();
+            mSpillFile.seekp(std::streamoff(offset));
+            bool isWritten = entry->mType == MODEL_POINTCLOUD ? WritePointCloud(mSpillFile, entry->mpPointCloud) :
+                WriteTriMesh(mSpillFile, entry->mpTriMesh);
+            isWritten = isWritten && WriteChannels(mSpillFile, entry->mpAttributes, entry->mSpillChannels);
+            if (!isWritten)
+            {
+                ErrorLog << "ModelRegistry::EvictEntry write failed: " << entry->mName << std::endl;
+                mSpillFile.clear();
+                FreeSpillRecord(entry);
+                return false;
+            }
+        }
+        GPPFREEPOINTER(entry->mpPointCloud);
+        GPPFREEPOINTER(entry->mpTriMesh);
+        if (entry->mpAttributes != NULL)
+        {
+            FreeChannelValues(entry->mpAttributes, entry->mSpillChannels);
+        }
+        mResidentByteCount -= entry->mByteCount;
+        mEvictTime += MagicCore::ToolKit::GetTime() - startTime;
+        DebugLog << "ModelRegistry evict " << entry->mName << " " << entry->mByteCount << " bytes, resident " << mResidentByteCount << std::endl;
+        return true;
+    }
+
+    bool ModelRegistry::LoadEntry(ModelEntry* entry)
+    {
+        if (entry->mSpillOffset < 0 || !mSpillFile.is_open())
+        {
+            return false;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        mSpillFile.flush();
+        mSpillFile.clear();
+        mSpillFile.seekg(std::streamoff(entry->mSpillOffset));
+        if (entry->mType == MODEL_POINTCLOUD)
+        {
+            entry->mpPointCloud = ReadPointCloud(mSpillFile);
+        }
+        else
+        {
+            entry->mpTriMesh = ReadTriMesh(mSpillFile);
+        }
+        bool isChannelRead = (entry->mpPointCloud != NULL || entry->mpTriMesh != NULL) &&
+            (entry->mpAttributes == NULL || ReadChannels(mSpillFile, entry->mpAttributes, entry->mSpillChannels));
+        mSpillFile.clear();
+        if (!isChannelRead)
+        {
+            ErrorLog << "ModelRegistry::LoadEntry read failed: " << entry->mName << std::endl;
+            GPPFREEPOINTER(entry->mpPointCloud);
+            GPPFREEPOINTER(entry->mpTriMesh);
+            return false;
+        }
+        entry->mByteCount = GetModelByteCount(entry);
+        mResidentByteCount += entry->mByteCount;
+        mLoadTime += MagicCore::ToolKit::GetTime() - startTime;
+        return true;
+    }
+
+    void ModelRegistry::FreeSpillRecord(ModelEntry* entry)
+    {
+        if (entry->mSpillOffset < 0)
+        {
+            return;
+        }
+        SpillExtent extent;
+        extent.mOffset = GPP::ULongInt(entry->mSpillOffset);
+        extent.mByteCount = entry->mSpillByteCount;
+        // Free extents are sorted by offset and never touch each other
+        std::vector<SpillExtent>::iterator itr = mFreeExtents.begin();
+        while (itr != mFreeExtents.end() && itr->mOffset < extent.mOffset)
+        {
+            ++itr;
+        }
+        itr = mFreeExtents.insert(itr, extent);
+        std::vector<SpillExtent>::iterator nextItr = itr + 1;
+        if (nextItr != mFreeExtents.end() && itr->mOffset + itr->mByteCount == nextItr->mOffset)
+        {
+            itr->mByteCount += nextItr->mByteCount;
+            mFreeExtents.erase(nextItr);
+        }
+        if (itr != mFreeExtents.begin())
+        {
+            std::vector<SpillExtent>::iterator prevItr = itr - 1;
+            if (prevItr->mOffset + prevItr->mByteCount == itr->mOffset)
+            {
+                prevItr->mByteCount += itr->mByteCount;
+                mFreeExtents.erase(itr);
+            }
+        }
+        SpillExtent& lastExtent = mFreeExtents.back();
+        if (lastExtent.mOffset + lastExtent.mByteCount == mSpillFileSize)
+        {
+            mSpillFileSize = lastExtent.mOffset;
+            mFreeExtents.pop_back();
+        }
+        entry->mSpillOffset = -1;
+        entry->mSpillByteCount = 0;
+        entry->mSpillChannels.clear();
+    }
+
+    bool ModelRegistry::OpenSpillFile()
+    {
+        if (mSpillFile.is_open())
+        {
+            return true;
+        }
+        char tempPath[MAX_PATH];
+        DWORD pathLength = GetTempPathA(MAX_PATH, tempPath);
+        std::stringstream nameStream;
+        if (pathLength > 0 && pathLength < MAX_PATH)
+        {
+            nameStream << tempPath;
+        }
+        nameStream << "Magic3D_" << GetCurrentProcessId() << "_" << (void*)this << ".spill";
+        mSpillFileName = nameStream.str();
+        mSpillFile.open(mSpillFileName.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!mSpillFile.is_open())
+        {
+            ErrorLog << "ModelRegistry::OpenSpillFile failed: " << mSpillFileName << std::endl;
+            return false;
+        }
+        InfoLog << "ModelRegistry spill file: " << mSpillFileName << std::endl;
+        return true;
+    }
+
+    GPP::ULongInt ModelRegistry::GetModelByteCount(const ModelEntry* entry)
+    {
+        GPP::ULongInt channelByteCount = 0;
+        std::vector<std::string> channelNames;
+        GetSpillChannelNames(entry->mpAttributes, channelNames);
+        for (std::vector<std::string>::iterator itr = channelNames.begin(); itr != channelNames.end(); ++itr)
+        {
+            GPP::ULongInt componentCount = GetChannelComponentCount(entry->mpAttributes, *itr);
+            channelByteCount += GetChannelElementCount(entry->mpAttributes, *itr, componentCount) *
+                (componentCount == 1 ? sizeof(int) : sizeof(GPP::ImageColorId));
+        }
+        GPP::ULongInt vectorSize = sizeof(GPP::Vector3);
+        if (entry->mpPointCloud)
+        {
+            const GPP::PointCloud* pointCloud = entry->mpPointCloud;
+            GPP::ULongInt pointVectorCount = 1 + (pointCloud->HasNormal() ? 1 : 0) + (pointCloud->HasColor() ? 1 : 0);
+            return GPP::ULongInt(pointCloud->GetPointCount()) * pointVectorCount * vectorSize + channelByteCount;
+        }
+        if (entry->mpTriMesh)
+        {
+            const GPP::TriMesh* triMesh = entry->mpTriMesh;
+            GPP::ULongInt vertexVectorCount = 2 + (triMesh->HasVertexColor() ? 1 : 0) + (triMesh->HasVertexTexCoord() ? 1 : 0);
+            GPP::ULongInt triangleByteCount = 3 * sizeof(GPP::Int) + vectorSize + (triMesh->HasTriangleTexCoord() ? 3 * vectorSize : 0) +
+                (triMesh->HasTriangleColor() ? 3 * vectorSize : 0);
+            return GPP::ULongInt(triMesh->GetVertexCount()) * vertexVectorCount * vectorSize +
+                GPP::ULongInt(triMesh->GetTriangleCount()) * triangleByteCount + channelByteCount;
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "GPP.h"
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MagicApp
+{
+    class AttributeStore;
+
+    // Point clouds and meshes kept by handle, with reference counting and a global memory budget.
+    // When the resident models are larger than the budget, the least recently used unpinned ones are written raw to a
+    // spill file in the temp directory and freed. Pinning an evicted model reads it back. A model that was pinned without
+    // being changed keeps its spill record, so evicting it again does not write anything.
+    // Loaded int and GPP::ImageColorId attribute channels are evicted with the geometry, other channels stay in memory.
+    // Pinned models are never evicted, even over the budget.
+    // The registry is locked, so handles can be used from a command thread while the main thread renders.
+    // USAGE: 1. GPP::Int handle = modelRegistry->AddPointCloud(pointCloud, NULL, fileName);  // the registry owns pointCloud
+    //        2. GPP::PointCloud* pointCloud = modelRegistry->PinPointCloud(handle); ... modelRegistry->Unpin(handle, false);
+    //        3. modelRegistry->Release(handle);
+    class ModelRegistry
+    {
+    public:
+        ModelRegistry();
+        ~ModelRegistry();
+
+        // The registry owns the model and attributes (can be NULL). The reference count of the new handle is 1
+        GPP::Int AddPointCloud(GPP::PointCloud* pointCloud, AttributeStore* attributes, const std::string& name);
+        GPP::Int AddTriMesh(GPP::TriMesh* triMesh, AttributeStore* attributes, const std::string& name);
+        void AddReference(GPP::Int handle);
+        // The model is freed when the last reference and pin are released
+        void Release(GPP::Int handle);
+        // Take the model and attributes back out of the registry and drop the handle, whatever its reference count is
+        GPP::PointCloud* TakePointCloud(GPP::Int handle, AttributeStore** attributes);
+        GPP::TriMesh* TakeTriMesh(GPP::Int handle, AttributeStore** attributes);
+
+        // NULL if handle is not a point cloud (mesh) or the spill record can not be read
+        GPP::PointCloud* PinPointCloud(GPP::Int handle);
+        GPP::TriMesh* PinTriMesh(GPP::Int handle);
+        // isChanged: the model or its attributes were edited while pinned, its spill record is out of date
+        void Unpin(GPP::Int handle, bool isChanged = true);
+        // Attributes are evicted with the model, so they are only valid while it is pinned. NULL if the model is evicted
+        AttributeStore* GetAttributes(GPP::Int handle);
+
+        bool IsValid(GPP::Int handle) const;
+        bool IsPointCloud(GPP::Int handle) const;
+        bool IsResident(GPP::Int handle) const;
+        std::string GetName(GPP::Int handle) const;
+        void GetHandles(std::vector<GPP::Int>& handles) const;
+        void Clear(void);
+
+        // Evict models right away if the resident size is over byteCount
+        void SetMemoryBudget(GPP::ULongInt byteCount);
+        GPP::ULongInt GetMemoryBudget(void) const;
+        GPP::ULongInt GetResidentByteCount(void) const;
+        GPP::ULongInt GetSpillByteCount(void) const;
+        double GetEvictTime(void) const;
+        double GetLoadTime(void) const;
+
+    private:
+        enum ModelType
+        {
+            MODEL_POINTCLOUD = 0,
+            MODEL_TRIMESH
+        };
+
+        struct ModelEntry
+        {
+            ModelType mType;
+            std::string mName;
+            GPP::PointCloud* mpPointCloud;
+            GPP::TriMesh* mpTriMesh;
+            AttributeStore* mpAttributes;
+            GPP::Int mReferenceCount;
+            GPP::Int mPinCount;
+            GPP::ULongInt mLastAccess;
+            GPP::ULongInt mByteCount;
+            // -1 if there is no valid spill record
+            GPP::LongInt mSpillOffset;
+            GPP::ULongInt mSpillByteCount;
+            // Attribute channels in the spill record
+            std::vector<std::string> mSpillChannels;
+        };
+
+        struct SpillExtent
+        {
+            GPP::ULongInt mOffset;
+            GPP::ULongInt mByteCount;
+        };
+
+        ModelRegistry(const ModelRegistry&);
+        ModelRegistry& operator = (const ModelRegistry&);
+        GPP::Int AddEntry(ModelEntry* entry);
+        ModelEntry* FindEntry(GPP::Int handle) const;
+        bool PinEntry(ModelEntry* entry);
+        void FreeEntry(GPP::Int handle, bool isFreeModel);
+        void EnforceBudget(void);
+        bool EvictEntry(ModelEntry* entry);
+        bool LoadEntry(ModelEntry* entry);
+        // The freed extent is merged with its free neighbours, a free tail shrinks the file
+        void FreeSpillRecord(ModelEntry* entry);
+        bool WriteSpillRecord(ModelEntry* entry, const std::vector<char>& record);
+        bool OpenSpillFile(void);
+        static GPP::ULongInt GetModelByteCount(const ModelEntry* entry);
+
+    private:
+        std::map<GPP::Int, ModelEntry*> mEntries;
+        GPP::Int mNextHandle;
+        GPP::ULongInt mAccessCount;
+        GPP::ULongInt mMemoryBudget;
+        GPP::ULongInt mResidentByteCount;
+        std::string mSpillFileName;
+        std::fstream mSpillFile;
+        GPP::ULongInt mSpillFileSize;
+        std::vector<SpillExtent> mFreeExtents;
+        double mEvictTime;
+        double mLoadTime;
+        void* mpLock;
+    };
+}
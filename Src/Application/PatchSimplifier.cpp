@@ -0,0 +1,726 @@
+#include "PatchSimplifier.h"
+#include "MeshDistanceTree.h"
+#include "../Common/LogSystem.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <algorithm>
+
+namespace MagicApp
+{
+    static const GPP::Int DEFAULT_MAX_PATCH_TRIANGLE_COUNT = 2000000;
+    // Smaller patches are mostly border, and the locked border limits how far they can be simplified
+    static const GPP::Int MIN_PATCH_TRIANGLE_COUNT = 10000;
+    static const GPP::ULongInt DEFAULT_MEMORY_BYTE_COUNT = GPP::ULongInt(4) << 30;
+    // Rough peak memory of a quadric simplification per input triangle, edge heap and quadrics included
+    static const GPP::ULongInt PATCH_BYTES_PER_TRIANGLE = 512;
+    // Rings of triangles around the patch borders that are simplified again in the final pass
+    static const GPP::Int SEAM_STRIP_RING_COUNT = 3;
+
+    class TriangleAxisLess
+    {
+    public:
+        TriangleAxisLess(const std::vector<GPP::Real>& vertexCoords, const std::vector<GPP::Int>& triangleVertexIds, int axis) :
+            mpVertexCoords(&vertexCoords),
+            mpTriangleVertexIds(&triangleVertexIds),
+            mAxis(axis)
+        {
+        }
+
+        // Centroids compared by their coordinate sums
+        GPP::Real GetCentroidSum(GPP::Int triangleId) const
+        {
+            const GPP::Int* vertexIds = &(mpTriangleVertexIds->at(triangleId * 3));
+            return mpVertexCoords->at(vertexIds[0] * 3 + mAxis) + mpVertexCoords->at(vertexIds[1] * 3 + mAxis) +
+                mpVertexCoords->at(vertexIds[2] * 3 + mAxis);
+        }
+
+        bool operator () (GPP::Int triangleId0, GPP::Int triangleId1) const
+        {
+            return GetCentroidSum(triangleId0) < GetCentroidSum(triangleId1);
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpVertexCoords;
+        const std::vector<GPP::Int>* mpTriangleVertexIds;
+        int mAxis;
+    };
+
+    struct BorderCoord
+    {
+        GPP::Real mCoord[3];
+        GPP::Int mVertexId;
+
+        bool operator < (const BorderCoord& borderCoord) const
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (mCoord[axis] != borderCoord.mCoord[axis])
+                {
+                    return mCoord[axis] < borderCoord.mCoord[axis];
+                }
+            }
+            return false;
+        }
+
+        bool IsSameCoord(const BorderCoord& borderCoord) const
+        {
+            return mCoord[0] == borderCoord.mCoord[0] && mCoord[1] == borderCoord.mCoord[1] && mCoord[2] == borderCoord.mCoord[2];
+        }
+    };
+
+    class SimplifyPatchTask : public MagicCore::ParallelTask
+    {
+    public:
+        SimplifyPatchTask(PatchSimplifier* patchSimplifier, GPP::Int fromPatchId) :
+            mpPatchSimplifier(patchSimplifier),
+            mFromPatchId(fromPatchId)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int slotId = startId; slotId < endId; slotId++)
+            {
+                mpPatchSimplifier->SimplifyPatch(mFromPatchId + slotId, slotId);
+            }
+        }
+
+    private:
+        PatchSimplifier* mpPatchSimplifier;
+        GPP::Int mFromPatchId;
+    };
+
+    PatchSimplifier::PatchSimplifier() :
+        mMemoryByteCount(DEFAULT_MEMORY_BYTE_COUNT),
+        mMaxPatchTriangleCount(DEFAULT_MAX_PATCH_TRIANGLE_COUNT),
+        mFieldDim(0),
+        mTargetVertexCount(0),
+        mVertexCoords(),
+        mVertexFields(),
+        mTriangleVertexIds(),
+        mTriangleOrder(),
+        mPatchStarts(),
+        mPatchCount(0),
+        mIsPatchBorder(),
+        mConcurrentPatchCount(1),
+        mPatchResults(),
+        mPatchFinished(),
+        mFinishedPatchCount(0),
+        mpProgress(NULL),
+        mPatchVertexCount(0),
+        mSimplifyTime(0)
+    {
+    }
+
+    PatchSimplifier::~PatchSimplifier()
+    {
+    }
+
+    void PatchSimplifier::SetMaxPatchTriangleCount(GPP::Int maxPatchTriangleCount)
+    {
+        mMaxPatchTriangleCount = maxPatchTriangleCount < MIN_PATCH_TRIANGLE_COUNT ? MIN_PATCH_TRIANGLE_COUNT : maxPatchTriangleCount;
+    }
+
+    void PatchSimplifier::SetMemoryBudget(GPP::ULongInt memoryByteCount)
+    {
+        mMemoryByteCount = memoryByteCount;
+    }
+
+    GPP::ErrorCode PatchSimplifier::Simplify(GPP::TriMesh* triMesh, GPP::Int targetVertexCount, const std::vector<GPP::Real>* vertexFields,
+        std::vector<GPP::Real>* simplifiedVertexFields, double* progress)
+    {
+        if (triMesh == NULL || triMesh->GetTriangleCount() == 0 || targetVertexCount < 3 || targetVertexCount >= triMesh->GetVertexCount())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        mFieldDim = 0;
+        if (vertexFields != NULL && simplifiedVertexFields != NULL)
+        {
+            if (vertexFields->empty() || vertexFields->size() % vertexCount != 0)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            mFieldDim = vertexFields->size() / vertexCount;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        mTargetVertexCount = targetVertexCount;
+        mpProgress = progress;
+        mVertexCoords.resize(vertexCount * 3);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            GPP::Vector3 coord = triMesh->GetVertexCoord(vid);
+            mVertexCoords.at(vid * 3) = coord[0];
+            mVertexCoords.at(vid * 3 + 1) = coord[1];
+            mVertexCoords.at(vid * 3 + 2) = coord[2];
+        }
+        if (mFieldDim > 0)
+        {
+            mVertexFields = *vertexFields;
+        }
+        else
+        {
+            mVertexFields.clear();
+        }
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        mTriangleVertexIds.resize(triangleCount * 3);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, &(mTriangleVertexIds.at(fid * 3)));
+        }
+        SplitPatches();
+        MarkBorderVertices();
+        GPP::Int patchCount = GetPatchCount();
+        GPP::ULongInt patchTriangleCount = triangleCount < mMaxPatchTriangleCount ? triangleCount : mMaxPatchTriangleCount;
+        mConcurrentPatchCount = GPP::Int(mMemoryByteCount / (patchTriangleCount * PATCH_BYTES_PER_TRIANGLE));
+        GPP::Int threadCount = MagicCore::ParallelTool::GetThreadCount();
+        mConcurrentPatchCount = mConcurrentPatchCount > threadCount ? threadCount : mConcurrentPatchCount;
+        mConcurrentPatchCount = mConcurrentPatchCount < 1 ? 1 : mConcurrentPatchCount;
+        InfoLog << "PatchSimplifier: " << patchCount << " patches, " << mConcurrentPatchCount << " concurrent" << std::endl;
+
+        mPatchResults.clear();
+        mPatchResults.resize(patchCount);
+        mFinishedPatchCount = 0;
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        for (GPP::Int fromPatchId = 0; fromPatchId < patchCount; fromPatchId += mConcurrentPatchCount)
+        {
+            GPP::Int toPatchId = fromPatchId + mConcurrentPatchCount;
+            if (toPatchId > patchCount)
+            {
+                toPatchId = patchCount;
+            }
+            GPP::Int slotCount = toPatchId - fromPatchId;
+            mPatchFinished.assign(slotCount, 0);
+            SimplifyPatchTask simplifyTask(this, fromPatchId);
+            MagicCore::ParallelTool::ParallelFor(slotCount, &simplifyTask, 1);
+            for (GPP::Int patchId = fromPatchId; patchId < toPatchId; patchId++)
+            {
+                if (mPatchResults.at(patchId).mResult != GPP_NO_ERROR)
+                {
+                    res = mPatchResults.at(patchId).mResult;
+                    break;
+                }
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                break;
+            }
+            mFinishedPatchCount = toPatchId;
+        }
+        std::vector<GPP::Int>().swap(mTriangleOrder);
+        std::vector<GPP::Int>().swap(mPatchStarts);
+        if (res != GPP_NO_ERROR)
+        {
+            mPatchResults.clear();
+            mVertexCoords.clear();
+            mVertexFields.clear();
+            mTriangleVertexIds.clear();
+            mIsPatchBorder.clear();
+            mSimplifyTime = MagicCore::ToolKit::GetTime() - startTime;
+            return res;
+        }
+
+        // Every triangle is replaced by the patches, joined again by the locked border vertices
+        std::vector<bool> isTriangleReplaced(triangleCount, true);
+        MergeResults(isTriangleReplaced, mPatchResults, mIsPatchBorder);
+        mPatchResults.clear();
+        mPatchVertexCount = mVertexCoords.size() / 3;
+        InfoLog << "  patch vertex count " << mPatchVertexCount << " time " << MagicCore::ToolKit::GetTime() - startTime << std::endl;
+
+        bool isJoinedMeshSimplified = GPP::Int(mTriangleVertexIds.size() / 3) <= mMaxPatchTriangleCount;
+        if (isJoinedMeshSimplified)
+        {
+            res = SimplifyJoinedMesh();
+        }
+        else
+        {
+            res = SimplifySeamStrip();
+        }
+        mIsPatchBorder.clear();
+        if (res != GPP_NO_ERROR)
+        {
+            mVertexCoords.clear();
+            mVertexFields.clear();
+            mTriangleVertexIds.clear();
+            mSimplifyTime = MagicCore::ToolKit::GetTime() - startTime;
+            return res;
+        }
+
+        triMesh->Clear();
+        vertexCount = mVertexCoords.size() / 3;
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            triMesh->InsertVertex(GPP::Vector3(mVertexCoords.at(vid * 3), mVertexCoords.at(vid * 3 + 1), mVertexCoords.at(vid * 3 + 2)));
+        }
+        triangleCount = mTriangleVertexIds.size() / 3;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->InsertTriangle(mTriangleVertexIds.at(fid * 3), mTriangleVertexIds.at(fid * 3 + 1), mTriangleVertexIds.at(fid * 3 + 2));
+        }
+        triMesh->UpdateNormal();
+        std::vector<GPP::Real>().swap(mVertexCoords);
+        std::vector<GPP::Int>().swap(mTriangleVertexIds);
+        if (mFieldDim > 0)
+        {
+            simplifiedVertexFields->swap(mVertexFields);
+        }
+        mVertexFields.clear();
+        if (mpProgress)
+        {
+            *mpProgress = 1.0;
+        }
+        mSimplifyTime = MagicCore::ToolKit::GetTime() - startTime;
+        InfoLog << "PatchSimplifier: " << triMesh->GetVertexCount() << " vertices, time " << mSimplifyTime << std::endl;
+        if (triMesh->GetVertexCount() > mTargetVertexCount)
+        {
+            InfoLog << "  target " << mTargetVertexCount << " not reached" << (isJoinedMeshSimplified ? "" :
+                ", the seam strip pass can not remove the locked input boundary and strip border vertices") << std::endl;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int PatchSimplifier::GetPatchCount(void) const
+    {
+        return mPatchCount;
+    }
+
+    GPP::Int PatchSimplifier::GetConcurrentPatchCount(void) const
+    {
+        return mConcurrentPatchCount;
+    }
+
+    GPP::Int PatchSimplifier::GetPatchVertexCount(void) const
+    {
+        return mPatchVertexCount;
+    }
+
+    double PatchSimplifier::GetSimplifyTime(void) const
+    {
+        return mSimplifyTime;
+    }
+
+    GPP::ErrorCode PatchSimplifier::MeasureHausdorffDistance(const GPP::ITriMesh* triMesh0, const GPP::ITriMesh* triMesh1, GPP::Real& distance)
+    {
+        if (triMesh0 == NULL || triMesh1 == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        distance = 0;
+        const GPP::ITriMesh* triMeshes[2] = {triMesh0, triMesh1};
+        for (int fromId = 0; fromId < 2; fromId++)
+        {
+            MeshDistanceTree distanceTree;
+            GPP::ErrorCode res = distanceTree.Init(triMeshes[1 - fromId]);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            const GPP::ITriMesh* fromMesh = triMeshes[fromId];
+            GPP::Int vertexCount = fromMesh->GetVertexCount();
+            std::vector<GPP::Vector3> vertexCoords(vertexCount);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                vertexCoords.at(vid) = fromMesh->GetVertexCoord(vid);
+            }
+            std::vector<GPP::Real> distances;
+            res = distanceTree.QueryPointsDistance(vertexCoords, distances);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            for (std::vector<GPP::Real>::iterator itr = distances.begin(); itr != distances.end(); ++itr)
+            {
+                if (*itr > distance)
+                {
+                    distance = *itr;
+                }
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void PatchSimplifier::SplitPatches(void)
+    {
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        mTriangleOrder.resize(triangleCount);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            mTriangleOrder.at(fid) = fid;
+        }
+        mPatchStarts.clear();
+        // Depth first, so the patches of a subtree are neighbors in mPatchStarts
+        std::vector<GPP::Int> rangeStack;
+        rangeStack.push_back(triangleCount);
+        rangeStack.push_back(0);
+        while (!rangeStack.empty())
+        {
+            GPP::Int startId = rangeStack.back();
+            rangeStack.pop_back();
+            GPP::Int endId = rangeStack.back();
+            rangeStack.pop_back();
+            if (endId - startId <= mMaxPatchTriangleCount)
+            {
+                mPatchStarts.push_back(startId);
+                continue;
+            }
+            GPP::Real centroidMin[3] = {0, 0, 0};
+            GPP::Real centroidMax[3] = {0, 0, 0};
+            for (int axis = 0; axis < 3; axis++)
+            {
+                TriangleAxisLess axisLess(mVertexCoords, mTriangleVertexIds, axis);
+                centroidMin[axis] = centroidMax[axis] = axisLess.GetCentroidSum(mTriangleOrder.at(startId));
+                for (GPP::Int orderId = startId + 1; orderId < endId; orderId++)
+                {
+                    GPP::Real centroidSum = axisLess.GetCentroidSum(mTriangleOrder.at(orderId));
+                    centroidMin[axis] = centroidSum < centroidMin[axis] ? centroidSum : centroidMin[axis];
+                    centroidMax[axis] = centroidSum > centroidMax[axis] ? centroidSum : centroidMax[axis];
+                }
+            }
+            int splitAxis = 0;
+            for (int axis = 1; axis < 3; axis++)
+            {
+                if (centroidMax[axis] - centroidMin[axis] > centroidMax[splitAxis] - centroidMin[splitAxis])
+                {
+                    splitAxis = axis;
+                }
+            }
+            GPP::Int midId = (startId + endId) / 2;
+            std::nth_element(mTriangleOrder.begin() + startId, mTriangleOrder.begin() + midId, mTriangleOrder.begin() + endId,
+                TriangleAxisLess(mVertexCoords, mTriangleVertexIds, splitAxis));
+            rangeStack.push_back(endId);
+            rangeStack.push_back(midId);
+            rangeStack.push_back(midId);
+            rangeStack.push_back(startId);
+        }
+        std::sort(mPatchStarts.begin(), mPatchStarts.end());
+        mPatchCount = mPatchStarts.size();
+        mPatchStarts.push_back(triangleCount);
+    }
+
+    void PatchSimplifier::MarkBorderVertices(void)
+    {
+        GPP::Int vertexCount = mVertexCoords.size() / 3;
+        std::vector<GPP::Int> vertexPatchIds(vertexCount, -1);
+        mIsPatchBorder.assign(vertexCount, false);
+        GPP::Int patchCount = GetPatchCount();
+        for (GPP::Int patchId = 0; patchId < patchCount; patchId++)
+        {
+            for (GPP::Int orderId = mPatchStarts.at(patchId); orderId < mPatchStarts.at(patchId + 1); orderId++)
+            {
+                const GPP::Int* vertexIds = &(mTriangleVertexIds.at(mTriangleOrder.at(orderId) * 3));
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    GPP::Int& vertexPatchId = vertexPatchIds.at(vertexIds[localId]);
+                    if (vertexPatchId == -1)
+                    {
+                        vertexPatchId = patchId;
+                    }
+                    else if (vertexPatchId != patchId)
+                    {
+                        mIsPatchBorder.at(vertexIds[localId]) = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void PatchSimplifier::SimplifyPatch(GPP::Int patchId, GPP::Int slotId)
+    {
+        std::vector<GPP::Int> triangleIds(mTriangleOrder.begin() + mPatchStarts.at(patchId), mTriangleOrder.begin() + mPatchStarts.at(patchId + 1));
+        GPP::Real keepRatio = GPP::Real(mTargetVertexCount) / GPP::Real(mVertexCoords.size() / 3);
+        SimplifyTriangles(triangleIds, keepRatio, mIsPatchBorder, true, mPatchResults.at(patchId));
+        // Patches of a batch finish in any order, so the progress counts them
+        mPatchFinished.at(slotId) = 1;
+        if (mpProgress)
+        {
+            GPP::Int finishedCount = mFinishedPatchCount;
+            for (std::vector<GPP::Int>::iterator itr = mPatchFinished.begin(); itr != mPatchFinished.end(); ++itr)
+            {
+                finishedCount += *itr;
+            }
+            // The seam strip is counted as one more patch
+            *mpProgress = double(finishedCount) / double(GetPatchCount() + 1);
+        }
+    }
+
+    void PatchSimplifier::SimplifyTriangles(const std::vector<GPP::Int>& triangleIds, GPP::Real keepRatio, const std::vector<bool>& isBorderVertex,
+        bool keepBoundary, PatchResult& patchResult) const
+    {
+        std::vector<GPP::Int> localVertexIds;
+        localVertexIds.reserve(triangleIds.size() * 3);
+        for (std::vector<GPP::Int>::const_iterator itr = triangleIds.begin(); itr != triangleIds.end(); ++itr)
+        {
+            localVertexIds.insert(localVertexIds.end(), mTriangleVertexIds.begin() + (*itr) * 3, mTriangleVertexIds.begin() + (*itr) * 3 + 3);
+        }
+        std::sort(localVertexIds.begin(), localVertexIds.end());
+        localVertexIds.erase(std::unique(localVertexIds.begin(), localVertexIds.end()), localVertexIds.end());
+        GPP::Int localVertexCount = localVertexIds.size();
+
+        GPP::TriMesh localMesh;
+        std::vector<GPP::Real> localFields;
+        localFields.reserve(localVertexCount * mFieldDim);
+        std::vector<BorderCoord> borderCoords;
+        for (std::vector<GPP::Int>::iterator itr = localVertexIds.begin(); itr != localVertexIds.end(); ++itr)
+        {
+            const GPP::Real* coord = &(mVertexCoords.at((*itr) * 3));
+            localMesh.InsertVertex(GPP::Vector3(coord[0], coord[1], coord[2]));
+            if (mFieldDim > 0)
+            {
+                localFields.insert(localFields.end(), mVertexFields.begin() + (*itr) * mFieldDim, mVertexFields.begin() + (*itr + 1) * mFieldDim);
+            }
+            if (isBorderVertex.at(*itr))
+            {
+                BorderCoord borderCoord;
+                borderCoord.mCoord[0] = coord[0];
+                borderCoord.mCoord[1] = coord[1];
+                borderCoord.mCoord[2] = coord[2];
+                borderCoord.mVertexId = *itr;
+                borderCoords.push_back(borderCoord);
+            }
+        }
+        // Vertices with the same coordinates keep their order
+        std::stable_sort(borderCoords.begin(), borderCoords.end());
+        for (std::vector<GPP::Int>::const_iterator itr = triangleIds.begin(); itr != triangleIds.end(); ++itr)
+        {
+            GPP::Int vertexIds[3];
+            for (int localId = 0; localId < 3; localId++)
+            {
+                vertexIds[localId] = std::lower_bound(localVertexIds.begin(), localVertexIds.end(), mTriangleVertexIds.at((*itr) * 3 + localId)) - localVertexIds.begin();
+            }
+            localMesh.InsertTriangle(vertexIds[0], vertexIds[1], vertexIds[2]);
+        }
+        std::vector<GPP::Int>().swap(localVertexIds);
+        localMesh.UpdateNormal();
+
+        // Border vertices are locked, so the ratio applies to the others
+        GPP::Int borderCount = borderCoords.size();
+        GPP::Int targetVertexCount = borderCount + GPP::Int((localVertexCount - borderCount) * keepRatio + 0.5);
+        patchResult.mResult = GPP_NO_ERROR;
+        if (targetVertexCount < localVertexCount)
+        {
+            targetVertexCount = targetVertexCount < 3 ? 3 : targetVertexCount;
+            std::vector<GPP::Real> simplifiedFields;
+            patchResult.mResult = GPP::SimplifyMesh::QuadricSimplify(&localMesh, targetVertexCount, keepBoundary,
+                mFieldDim > 0 ? &localFields : NULL, mFieldDim > 0 ? &simplifiedFields : NULL);
+            if (patchResult.mResult != GPP_NO_ERROR)
+            {
+                return;
+            }
+            localFields.swap(simplifiedFields);
+        }
+
+        // keepBoundary leaves the border vertices where they were, so they are found again by their coordinates.
+        // Border vertices with the same coordinates are taken in order
+        GPP::Int vertexCount = localMesh.GetVertexCount();
+        patchResult.mVertexCoords.resize(vertexCount * 3);
+        patchResult.mBorderVertexIds.assign(vertexCount, -1);
+        std::vector<GPP::Int> sameCoordFoundCounts(borderCoords.size(), 0);
+        GPP::Int foundBorderCount = 0;
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            GPP::Vector3 coord = localMesh.GetVertexCoord(vid);
+            BorderCoord borderCoord;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                patchResult.mVertexCoords.at(vid * 3 + axis) = coord[axis];
+                borderCoord.mCoord[axis] = coord[axis];
+            }
+            GPP::Int borderId = std::lower_bound(borderCoords.begin(), borderCoords.end(), borderCoord) - borderCoords.begin();
+            if (borderId == GPP::Int(borderCoords.size()) || !borderCoord.IsSameCoord(borderCoords.at(borderId)))
+            {
+                continue;
+            }
+            GPP::Int sameCoordId = borderId + sameCoordFoundCounts.at(borderId);
+            if (sameCoordId < GPP::Int(borderCoords.size()) && borderCoord.IsSameCoord(borderCoords.at(sameCoordId)))
+            {
+                sameCoordFoundCounts.at(borderId)++;
+                patchResult.mBorderVertexIds.at(vid) = borderCoords.at(sameCoordId).mVertexId;
+                foundBorderCount++;
+            }
+        }
+        if (foundBorderCount < borderCount)
+        {
+            InfoLog << "  PatchSimplifier: " << borderCount - foundBorderCount << " border vertices moved" << std::endl;
+        }
+        patchResult.mVertexFields.swap(localFields);
+        GPP::Int triangleCount = localMesh.GetTriangleCount();
+        patchResult.mTriangleVertexIds.resize(triangleCount * 3);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            localMesh.GetTriangleVertexIds(fid, &(patchResult.mTriangleVertexIds.at(fid * 3)));
+        }
+    }
+
+    void PatchSimplifier::MergeResults(const std::vector<bool>& isTriangleReplaced, const std::vector<PatchResult>& patchResults,
+        std::vector<bool>& isBorderVertex)
+    {
+        GPP::Int vertexCount = mVertexCoords.size() / 3;
+        std::vector<GPP::Int> newVertexIds(vertexCount, -1);
+        std::vector<GPP::Real> newVertexCoords;
+        std::vector<GPP::Real> newVertexFields;
+        std::vector<GPP::Int> newTriangleVertexIds;
+        std::vector<bool> isNewBorderVertex;
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            if (isTriangleReplaced.at(fid))
+            {
+                continue;
+            }
+            for (int localId = 0; localId < 3; localId++)
+            {
+                GPP::Int vertexId = mTriangleVertexIds.at(fid * 3 + localId);
+                if (newVertexIds.at(vertexId) == -1)
+                {
+                    newVertexIds.at(vertexId) = newVertexCoords.size() / 3;
+                    newVertexCoords.insert(newVertexCoords.end(), mVertexCoords.begin() + vertexId * 3, mVertexCoords.begin() + vertexId * 3 + 3);
+                    newVertexFields.insert(newVertexFields.end(), mVertexFields.begin() + vertexId * mFieldDim, mVertexFields.begin() + (vertexId + 1) * mFieldDim);
+                    isNewBorderVertex.push_back(isBorderVertex.at(vertexId));
+                }
+                newTriangleVertexIds.push_back(newVertexIds.at(vertexId));
+            }
+        }
+        std::vector<GPP::Int> resultVertexIds;
+        for (std::vector<PatchResult>::const_iterator resultItr = patchResults.begin(); resultItr != patchResults.end(); ++resultItr)
+        {
+            GPP::Int resultVertexCount = resultItr->mBorderVertexIds.size();
+            resultVertexIds.resize(resultVertexCount);
+            for (GPP::Int vid = 0; vid < resultVertexCount; vid++)
+            {
+                GPP::Int borderVertexId = resultItr->mBorderVertexIds.at(vid);
+                if (borderVertexId >= 0 && newVertexIds.at(borderVertexId) >= 0)
+                {
+                    resultVertexIds.at(vid) = newVertexIds.at(borderVertexId);
+                    continue;
+                }
+                resultVertexIds.at(vid) = newVertexCoords.size() / 3;
+                newVertexCoords.insert(newVertexCoords.end(), resultItr->mVertexCoords.begin() + vid * 3, resultItr->mVertexCoords.begin() + vid * 3 + 3);
+                newVertexFields.insert(newVertexFields.end(), resultItr->mVertexFields.begin() + vid * mFieldDim,
+                    resultItr->mVertexFields.begin() + (vid + 1) * mFieldDim);
+                isNewBorderVertex.push_back(borderVertexId >= 0);
+                if (borderVertexId >= 0)
+                {
+                    newVertexIds.at(borderVertexId) = resultVertexIds.at(vid);
+                }
+            }
+            for (std::vector<GPP::Int>::const_iterator itr = resultItr->mTriangleVertexIds.begin(); itr != resultItr->mTriangleVertexIds.end(); ++itr)
+            {
+                newTriangleVertexIds.push_back(resultVertexIds.at(*itr));
+            }
+        }
+        mVertexCoords.swap(newVertexCoords);
+        mVertexFields.swap(newVertexFields);
+        mTriangleVertexIds.swap(newTriangleVertexIds);
+        isBorderVertex.swap(isNewBorderVertex);
+    }
+
+    GPP::ErrorCode PatchSimplifier::SimplifyJoinedMesh(void)
+    {
+        GPP::Int vertexCount = mVertexCoords.size() / 3;
+        if (vertexCount <= mTargetVertexCount)
+        {
+            return GPP_NO_ERROR;
+        }
+        // Nothing is locked, the patch borders and the boundary of the input mesh are simplified like the other vertices
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        std::vector<GPP::Int> triangleIds(triangleCount);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triangleIds.at(fid) = fid;
+        }
+        std::vector<bool> isBorderVertex(vertexCount, false);
+        std::vector<PatchResult> joinedResults(1);
+        SimplifyTriangles(triangleIds, GPP::Real(mTargetVertexCount) / GPP::Real(vertexCount), isBorderVertex, false, joinedResults.at(0));
+        if (joinedResults.at(0).mResult != GPP_NO_ERROR)
+        {
+            return joinedResults.at(0).mResult;
+        }
+        std::vector<GPP::Int>().swap(triangleIds);
+        std::vector<bool> isTriangleReplaced(triangleCount, true);
+        MergeResults(isTriangleReplaced, joinedResults, isBorderVertex);
+        InfoLog << "  joined mesh " << vertexCount << " vertices, " << vertexCount - GPP::Int(mVertexCoords.size() / 3) << " removed" << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode PatchSimplifier::SimplifySeamStrip(void)
+    {
+        GPP::Int vertexCount = mVertexCoords.size() / 3;
+        if (vertexCount <= mTargetVertexCount)
+        {
+            return GPP_NO_ERROR;
+        }
+        InfoLog << "  joined mesh is larger than a patch, only the seam strip is simplified and the input boundary stays locked" << std::endl;
+        // Grow the strip ring by ring from the patch border vertices
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        std::vector<bool> isStripVertex = mIsPatchBorder;
+        std::vector<bool> isStripTriangle(triangleCount, false);
+        for (GPP::Int ringId = 0; ringId < SEAM_STRIP_RING_COUNT; ringId++)
+        {
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                const GPP::Int* vertexIds = &(mTriangleVertexIds.at(fid * 3));
+                if (isStripVertex.at(vertexIds[0]) || isStripVertex.at(vertexIds[1]) || isStripVertex.at(vertexIds[2]))
+                {
+                    isStripTriangle.at(fid) = true;
+                }
+            }
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                if (isStripTriangle.at(fid))
+                {
+                    isStripVertex.at(mTriangleVertexIds.at(fid * 3)) = true;
+                    isStripVertex.at(mTriangleVertexIds.at(fid * 3 + 1)) = true;
+                    isStripVertex.at(mTriangleVertexIds.at(fid * 3 + 2)) = true;
+                }
+            }
+        }
+        // The strip is joined to the rest by the vertices they share
+        std::vector<bool> isStripBorder(vertexCount, false);
+        std::vector<GPP::Int> stripTriangleIds;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            if (isStripTriangle.at(fid))
+            {
+                stripTriangleIds.push_back(fid);
+                continue;
+            }
+            for (int localId = 0; localId < 3; localId++)
+            {
+                GPP::Int vertexId = mTriangleVertexIds.at(fid * 3 + localId);
+                if (isStripVertex.at(vertexId))
+                {
+                    isStripBorder.at(vertexId) = true;
+                }
+            }
+        }
+        if (stripTriangleIds.empty())
+        {
+            return GPP_NO_ERROR;
+        }
+        GPP::Int stripVertexCount = 0;
+        GPP::Int innerVertexCount = 0;
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            if (isStripVertex.at(vid))
+            {
+                stripVertexCount++;
+                if (!isStripBorder.at(vid))
+                {
+                    innerVertexCount++;
+                }
+            }
+        }
+        GPP::Int removeCount = vertexCount - mTargetVertexCount;
+        GPP::Real keepRatio = removeCount >= innerVertexCount ? 0 : GPP::Real(innerVertexCount - removeCount) / GPP::Real(innerVertexCount);
+        std::vector<PatchResult> stripResults(1);
+        SimplifyTriangles(stripTriangleIds, keepRatio, isStripBorder, true, stripResults.at(0));
+        if (stripResults.at(0).mResult != GPP_NO_ERROR)
+        {
+            return stripResults.at(0).mResult;
+        }
+        std::vector<GPP::Int>().swap(stripTriangleIds);
+        MergeResults(isStripTriangle, stripResults, isStripBorder);
+        InfoLog << "  seam strip " << stripVertexCount << " vertices, " << vertexCount - GPP::Int(mVertexCoords.size() / 3) << " removed" << std::endl;
+        return GPP_NO_ERROR;
+    }
+}
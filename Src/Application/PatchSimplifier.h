@@ -0,0 +1,91 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Quadric simplification of a large mesh by spatial patches instead of one GPP::SimplifyMesh::QuadricSimplify call.
+    // Triangles are split into kd patches of at most maxPatchTriangleCount triangles by their centroids. Every patch is
+    // simplified concurrently to its share of the target with keepBoundary, so the vertices shared by two patches stay in place
+    // and the patches are joined again by these vertices. keepBoundary also locks the open boundary of the input mesh.
+    // If the joined mesh fits in one patch, a final call without keepBoundary simplifies all of it to the target vertex count,
+    // like one QuadricSimplify(triMesh, targetVertexCount, false) call. Otherwise the final call only simplifies the strip of
+    // rings around the patch borders with keepBoundary, the boundary of the input mesh stays, and the result can have more
+    // vertices than the target. The reached count is logged.
+    // USAGE: 1. PatchSimplifier patchSimplifier;
+    //        2. patchSimplifier.Simplify(triMesh, targetVertexCount, &vertexFields, &simplifiedVertexFields, &progress);
+    class PatchSimplifier
+    {
+    public:
+        PatchSimplifier();
+        ~PatchSimplifier();
+
+        // Patches are split until they have at most maxPatchTriangleCount triangles. Default is 2000000
+        void SetMaxPatchTriangleCount(GPP::Int maxPatchTriangleCount);
+        // Estimated peak memory of the concurrent patches, it bounds the patches simplified at the same time. Default is 4GB
+        void SetMemoryBudget(GPP::ULongInt memoryByteCount);
+
+        // triMesh should be manifold. vertexFields has the same count of values for every vertex, it can be NULL,
+        // then simplifiedVertexFields is ignored. progress (can be NULL) is set to the finished patch ratio after every patch
+        GPP::ErrorCode Simplify(GPP::TriMesh* triMesh, GPP::Int targetVertexCount, const std::vector<GPP::Real>* vertexFields,
+            std::vector<GPP::Real>* simplifiedVertexFields, double* progress = NULL);
+
+        GPP::Int GetPatchCount(void) const;
+        GPP::Int GetConcurrentPatchCount(void) const;
+        // Vertex count after the patches are simplified, before the seam strip is simplified
+        GPP::Int GetPatchVertexCount(void) const;
+        double GetSimplifyTime(void) const;
+
+        // Two sided Hausdorff distance sampled at the vertices of both meshes
+        static GPP::ErrorCode MeasureHausdorffDistance(const GPP::ITriMesh* triMesh0, const GPP::ITriMesh* triMesh1, GPP::Real& distance);
+
+    private:
+        struct PatchResult
+        {
+            std::vector<GPP::Real> mVertexCoords;
+            std::vector<GPP::Real> mVertexFields;
+            std::vector<GPP::Int> mTriangleVertexIds;
+            // Input vertex id of a locked border vertex, -1 for the others
+            std::vector<GPP::Int> mBorderVertexIds;
+            GPP::ErrorCode mResult;
+        };
+
+        PatchSimplifier(const PatchSimplifier&);
+        PatchSimplifier& operator = (const PatchSimplifier&);
+        void SplitPatches(void);
+        void MarkBorderVertices(void);
+        void SimplifyPatch(GPP::Int patchId, GPP::Int slotId);
+        // Simplify the triangles of triangleIds, keeping keepRatio of the vertices not in isBorderVertex.
+        // isBorderVertex marks the vertices to find again in the result, they must be on the boundary of triangleIds and keepBoundary is true
+        void SimplifyTriangles(const std::vector<GPP::Int>& triangleIds, GPP::Real keepRatio, const std::vector<bool>& isBorderVertex,
+            bool keepBoundary, PatchResult& patchResult) const;
+        // Replace the marked triangles of the working mesh by patchResults. isBorderVertex is mapped to the new vertex ids
+        void MergeResults(const std::vector<bool>& isTriangleReplaced, const std::vector<PatchResult>& patchResults,
+            std::vector<bool>& isBorderVertex);
+        GPP::ErrorCode SimplifyJoinedMesh(void);
+        GPP::ErrorCode SimplifySeamStrip(void);
+        friend class SimplifyPatchTask;
+
+    private:
+        GPP::ULongInt mMemoryByteCount;
+        GPP::Int mMaxPatchTriangleCount;
+        GPP::Int mFieldDim;
+        GPP::Int mTargetVertexCount;
+        // The working mesh, 3 coordinates and 3 vertex ids per element
+        std::vector<GPP::Real> mVertexCoords;
+        std::vector<GPP::Real> mVertexFields;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        std::vector<GPP::Int> mTriangleOrder;
+        // Range of mTriangleOrder of every patch
+        std::vector<GPP::Int> mPatchStarts;
+        GPP::Int mPatchCount;
+        std::vector<bool> mIsPatchBorder;
+        GPP::Int mConcurrentPatchCount;
+        std::vector<PatchResult> mPatchResults;
+        std::vector<GPP::Int> mPatchFinished;
+        GPP::Int mFinishedPatchCount;
+        double* mpProgress;
+        GPP::Int mPatchVertexCount;
+        double mSimplifyTime;
+    };
+}
@@ -12,11 +12,18 @@
 #include "AppManager.h"
 #include "MeshShopApp.h"
 #include "ModelManager.h"
+#include "ModelExporter.h"
+#include "WorkspaceFile.h"
+#include "ModelCompactor.h"
 #include "MagicPointCloud.h"
+#include "TiledReconstructor.h"
 #include <algorithm>
 
 namespace MagicApp
 {
+    // Point clouds larger than this are reconstructed by TiledReconstructor
+    static const GPP::Int TILED_RECONSTRUCTION_POINT_COUNT = 5000000;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         PointShopApp* app = (PointShopApp*)arg;
@@ -51,7 +58,8 @@ namespace MagicApp
         mNeighborCount(0),
         mColorNeighborCount(0),
         mIsolateValue(0),
-        mSharpDiff()
+        mSharpDiff(),
+        mTileProgress(-1)
     {
     }
 
@@ -84,7 +92,8 @@ namespace MagicApp
     {
         if (mpUI && mpUI->IsProgressbarVisible())
         {
-            int progressValue = int(GPP::GetApiProgress() * 100.0);
+            double progress = mTileProgress >= 0 ? mTileProgress : GPP::GetApiProgress();
+            int progressValue = int(progress * 100.0);
             mpUI->SetProgressbar(progressValue);
         }
         if (mUpdatePointCloudRendering)
@@ -227,51 +236,52 @@ namespace MagicApp
 
     void PointShopApp::SetupMagicPointCloud(MagicPointCloud& magicPointCloud)
     {
-        std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
-        if (imageColorIds && imageColorIds->size() == magicPointCloud.GetPointCount())
-        {
-            magicPointCloud.SetImageColorIds(imageColorIds);
-        }
-        std::vector<int>* colorIds = ModelManager::Get()->GetColorIdsPointer();
-        if (colorIds && colorIds->size() == magicPointCloud.GetPointCount())
-        {
-            magicPointCloud.SetColorIds(colorIds);
-        }
-        std::vector<int>* cloudIds = ModelManager::Get()->GetCloudIdsPointer();
-        if (cloudIds && cloudIds->size() == magicPointCloud.GetPointCount())
-        {
-            magicPointCloud.SetCloudIds(cloudIds);
-        }
+        magicPointCloud.SetAttributes(ModelManager::Get()->GetPointCloudAttributes());
     }
 
     void PointShopApp::SaveImageColorInfo()
     {
         std::string fileName;
-        char filterName[] = "Support format(*.gii)\0*.gii\0";
+        char filterName[] = "Magic3D Workspace(*.gws)\0*.gws\0";
         if (MagicCore::ToolKit::FileSaveDlg(fileName, filterName))
         {
-            std::ofstream fout(fileName);
-            ModelManager::Get()->DumpInfo(fout);
-            fout.close();
+            if (ModelManager::Get()->SaveWorkspace(fileName) == false)
+            {
+                MessageBox(NULL, "工作区保存失败", "温馨提示", MB_OK);
+            }
         }
     }
     
     void PointShopApp::LoadImageColorInfo()
     {
         std::string fileName;
-        char filterName[] = "Geometry++ Image Info(*.gii)\0*.gii\0";
+        char filterName[] = "Magic3D Workspace(*.gws)\0*.gws\0Geometry++ Image Info(*.gii)\0*.gii\0";
         if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName))
         {
+            if (WorkspaceFile::IsWorkspaceFile(fileName))
+            {
+                if (ModelManager::Get()->LoadWorkspace(fileName) == false)
+                {
+                    MessageBox(NULL, "工作区导入失败", "温馨提示", MB_OK);
+                    return;
+                }
+                GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+                mpUI->SetPointCloudInfo(pointCloud ? pointCloud->GetPointCount() : 0);
+                UpdatePickTool();
+                ResetSelection();
+                UpdatePointCloudRendering();
+                return;
+            }
             std::ifstream fin(fileName);
             if (!fin)
             {
-                MessageBox(NULL, "GIIʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "GII导入失败", "温馨提示", MB_OK);
                 return;
             }
-            ModelManager::Get()->LoadInfo(fin);
+            ModelManager::Get()->LoadInfo(fin, ModelManager::Get()->GetPointCloudAttributes());
             fin.close();
 
-            MessageBox(NULL, "뵼ͼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入图像", "温馨提示", MB_OK);
             std::vector<std::string> fileNames;
             char filterName[] = "JPG Files(*.jpg)\0*.jpg\0PNG Files(*.png)\0*.png\0BMP Image(*.bmp)\0*.bmp\0";
             if (MagicCore::ToolKit::MultiFileOpenDlg(fileNames, filterName))
@@ -287,19 +297,20 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud == NULL)
         {
-            MessageBox(NULL, "mpPointCloud == NULL", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mpPointCloud == NULL", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
         if (textureImageFiles.empty())
         {
-            MessageBox(NULL, "mTextureImageFiles is empty", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mTextureImageFiles is empty", "温馨提示", MB_OK);
             return;
         }
-        std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-        if (imageColorIds.size() != pointCloud->GetPointCount())
+        const std::vector<GPP::ImageColorId>* imageColorIds =
+            ModelManager::Get()->GetPointCloudAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, pointCloud->GetPointCount());
+        if (imageColorIds == NULL)
         {
-            MessageBox(NULL, "mImageColorIds.size() != mpPointCloud->GetPointCount()", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mImageColorIds.size() != mpPointCloud->GetPointCount()", "温馨提示", MB_OK);
             return;
         }
         int imageCount = textureImageFiles.size();
@@ -310,7 +321,7 @@ namespace MagicApp
             imageList.at(fid) = cv::imread(textureImageFiles.at(fid));
             if (imageList.at(fid).data == NULL)
             {
-                MessageBox(NULL, "Imageʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Image导入失败", "温馨提示", MB_OK);
                 return;
             }
             imageHList.at(fid) = imageList.at(fid).rows;
@@ -319,7 +330,7 @@ namespace MagicApp
         int pointCount = pointCloud->GetPointCount();
         for (int pid = 0; pid < pointCount; pid++)
         {
-            GPP::ImageColorId colorId = imageColorIds.at(pid);
+            GPP::ImageColorId colorId = imageColorIds->at(pid);
             int imageIndex = colorId.GetImageIndex();
             const unsigned char* pixel = imageList.at(imageIndex).ptr(imageHList.at(imageIndex) - colorId.GetLocalY() - 1,
                 colorId.GetLocalX());
@@ -335,30 +346,33 @@ namespace MagicApp
 
     void PointShopApp::ConstructImageColorIdForMesh(GPP::TriMesh* triMesh, const GPP::IPointCloud* pointCloud)
     {
-        std::vector<GPP::ImageColorId> originImageColorIds = ModelManager::Get()->GetImageColorIds();
-        std::vector<int> colorIds = ModelManager::Get()->GetColorIds();
-        if (originImageColorIds.size() > 0 && originImageColorIds.size() == pointCloud->GetPointCount())
+        AttributeStore* pointCloudAttributes = ModelManager::Get()->GetPointCloudAttributes();
+        AttributeStore* meshAttributes = ModelManager::Get()->GetMeshAttributes();
+        meshAttributes->Clear();
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        const std::vector<GPP::ImageColorId>* originImageColorIds = pointCloudAttributes->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, pointCount);
+        const std::vector<int>* colorIds = pointCloudAttributes->GetChannel<int>(COLOR_ID_CHANNEL, pointCount);
+        if (pointCount > 0 && originImageColorIds)
         {
             std::vector<GPP::ImageColorId> meshColorIds;
-            GPP::ErrorCode res = GPP::OptimiseMapping::TransferMappingToMesh(pointCloud, originImageColorIds,
+            GPP::ErrorCode res = GPP::OptimiseMapping::TransferMappingToMesh(pointCloud, *originImageColorIds,
                 triMesh, meshColorIds, 1.0, false);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "TransferMappingToMesh Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "TransferMappingToMesh Failed", "温馨提示", MB_OK);
                 return;
             }
-            std::vector<int> imageColorIdFlags(triMesh->GetVertexCount(), 1);
-            ModelManager::Get()->SetImageColorIds(meshColorIds);
-            ModelManager::Get()->SetImageColorIdFlag(imageColorIdFlags);
+            meshAttributes->SwapChannel(IMAGE_COLOR_ID_CHANNEL, meshColorIds, GPP::ImageColorId(-1, 0, 0));
+            meshAttributes->AddChannel(IMAGE_COLOR_ID_FLAG_CHANNEL, 0).assign(triMesh->GetVertexCount(), 1);
         }
-        if (colorIds.size() > 0 && colorIds.size() == pointCloud->GetPointCount())
+        if (pointCount > 0 && colorIds)
         {
             GPP::PointCloudPointList pointList(pointCloud);
             GPP::Ann ann;
             GPP::ErrorCode res = ann.Init(&pointList);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ann Init Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Ann Init Failed", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
@@ -374,12 +388,12 @@ namespace MagicApp
                 res = ann.FindNearestNeighbors(searchData, 1, 1, indexRes, NULL);
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "温馨提示", MB_OK);
                     return;
                 }
-                meshColorIds.at(vid) = colorIds.at(indexRes[0]);
+                meshColorIds.at(vid) = colorIds->at(indexRes[0]);
             }
-            ModelManager::Get()->SetColorIds(meshColorIds);
+            meshAttributes->SwapChannel(COLOR_ID_CHANNEL, meshColorIds, -1);
         }
     }
 
@@ -393,7 +407,7 @@ namespace MagicApp
             GPP::ErrorCode res = ann.Init(&pointList);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ann Init Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Ann Init Failed", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
@@ -409,7 +423,7 @@ namespace MagicApp
                 res = ann.FindNearestNeighbors(searchData, 1, 1, indexRes, NULL);
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "温馨提示", MB_OK);
                     return;
                 }
                 meshColorIds.at(vid) = colorIds.at(indexRes[0]);
@@ -424,7 +438,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::CalculatePointListDensity(&pointList, 5, pointDensity);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "CalculatePointListDensity Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "CalculatePointListDensity Failed", "温馨提示", MB_OK);
                 return;
             }
             pointDensity *= pointDensity;
@@ -434,7 +448,7 @@ namespace MagicApp
             res = ann.Init(&triMeshList);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ann Init Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Ann Init Failed", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
@@ -453,7 +467,7 @@ namespace MagicApp
                 res = ann.FindNearestNeighbors(searchData, 1, 1, indexRes, distanceRes);
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "温馨提示", MB_OK);
                     return;
                 }
                 vertex2PointMap.at(indexRes[0]).push_back(pid);
@@ -601,12 +615,12 @@ namespace MagicApp
                 GPP::ErrorCode res = GPP::ConsolidatePointCloud::ReversePatchNormal(ModelManager::Get()->GetPointCloud(), pickedId, mNeighborCount);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Ʒ߷޸ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云法线方向修复失败", "温馨提示", MB_OK);
                     return true;
                 }
                 UpdatePointCloudRendering();
@@ -750,8 +764,9 @@ namespace MagicApp
         else if (arg.key == OIS::KC_Z)
         {
             GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
-            std::vector<int> colorIds = ModelManager::Get()->GetColorIds();
-            if (pointCloud && pointCloud->GetPointCount() == colorIds.size())
+            const std::vector<int>* colorIds = pointCloud == NULL ? NULL :
+                ModelManager::Get()->GetPointCloudAttributes()->GetChannel<int>(COLOR_ID_CHANNEL, pointCloud->GetPointCount());
+            if (colorIds)
             {
                 pointCloud->SetHasColor(true);
                 int pointCount = pointCloud->GetPointCount();
@@ -759,7 +774,7 @@ namespace MagicApp
                 int maxId = 9;
                 for (int pid = 0; pid < pointCount; pid++)
                 {
-                    pointCloud->SetPointColor(pid, MagicCore::ToolKit::ColorCoding((colorIds.at(pid) % maxId) * deltaColor));
+                    pointCloud->SetPointColor(pid, MagicCore::ToolKit::ColorCoding((colorIds->at(pid) % maxId) * deltaColor));
                 }
                 UpdatePointCloudRendering();
             }
@@ -767,8 +782,9 @@ namespace MagicApp
         else if (arg.key == OIS::KC_I)
         {
             GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
-            std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-            if (pointCloud == NULL || pointCloud->GetPointCount() != imageColorIds.size())
+            const std::vector<GPP::ImageColorId>* imageColorIds = pointCloud == NULL ? NULL :
+                ModelManager::Get()->GetPointCloudAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, pointCloud->GetPointCount());
+            if (imageColorIds == NULL)
             {
                 return true;
             }
@@ -778,7 +794,7 @@ namespace MagicApp
             int pointCount = pointCloud->GetPointCount();
             for (int pid = 0; pid < pointCount; pid++)
             {
-                int imageIndex = imageColorIds.at(pid).GetImageIndex();
+                int imageIndex = imageColorIds->at(pid).GetImageIndex();
                 if (imageIndex < 0)
                 {
                     pointCloud->SetPointColor(pid, MagicCore::ToolKit::Get()->ColorCoding(0));
@@ -911,7 +927,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -921,7 +937,7 @@ namespace MagicApp
             ModelManager::Get()->ClearMesh();
             if (ModelManager::Get()->ImportPointCloud(fileName) == false)
             {
-                MessageBox(NULL, "Ƶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败", "温馨提示", MB_OK);
                 return false;
             }
             mpUI->SetPointCloudInfo(ModelManager::Get()->GetPointCloud()->GetPointCount());
@@ -953,17 +969,17 @@ namespace MagicApp
             size_t dotPos = fileName.rfind('.');
             if (dotPos == std::string::npos)
             {
-                MessageBox(NULL, "ļ׺", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请输入文件后缀名", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real scaleValue = ModelManager::Get()->GetScaleValue();
             GPP::Vector3 objCenterCoord = ModelManager::Get()->GetObjCenterCoord();
             pointCloud->UnifyCoords(1.0 / scaleValue, objCenterCoord * (-scaleValue));
-            GPP::ErrorCode res = GPP::Parser::ExportPointCloud(fileName, pointCloud);
+            GPP::ErrorCode res = ModelExporter::Get()->ExportPointCloud(fileName, pointCloud);
             pointCloud->UnifyCoords(scaleValue, objCenterCoord);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "导出点云失败", "温馨提示", MB_OK);
             }
         }
     }
@@ -977,7 +993,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -997,12 +1013,12 @@ namespace MagicApp
             mUpdatePointCloudRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߹⻬ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云法线光滑失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -1017,7 +1033,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1034,12 +1050,12 @@ namespace MagicApp
             mUpdatePointCloudRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߸ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云法线更新失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -1068,12 +1084,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ƹ⻬ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云光滑失败", "温馨提示", MB_OK);
                 return;
             }
             mUpdatePointCloudRendering = true;
@@ -1097,15 +1113,16 @@ namespace MagicApp
         else
         {
             GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
-            std::vector<int> colorIds = ModelManager::Get()->GetColorIds();
+            const std::vector<int>* colorIds =
+                ModelManager::Get()->GetPointCloudAttributes()->GetChannel<int>(COLOR_ID_CHANNEL, pointCloud->GetPointCount());
             if (pointCloud->HasColor() == false)
             {
-                MessageBox(NULL, "ûɫϢ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云没有颜色信息", "温馨提示", MB_OK);
                 return;
             }
-            if (pointCloud->GetPointCount() != colorIds.size())
+            if (colorIds == NULL)
             {
-                MessageBox(NULL, "ɫںҪIDϢ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云颜色融合需要点云ID信息", "温馨提示", MB_OK);
                 return;
             }
             mIsCommandInProgress = true;
@@ -1120,16 +1137,16 @@ namespace MagicApp
             GPP::DumpOnce();
 #endif
             GPP::ErrorCode res = GPP::IntrinsicColor::TuneColorFromMultiFrame(pointCloud, neighborCount, 
-                colorIds, pointColors, GPP::Vector3(sharpDiff_H, sharpDiff_S, sharpDiff_V));
+                *colorIds, pointColors, GPP::Vector3(sharpDiff_H, sharpDiff_S, sharpDiff_V));
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɫںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云颜色融合失败", "温馨提示", MB_OK);
                 return;
             }
             for (int pid = 0; pid < pointCount; pid++)
@@ -1156,13 +1173,14 @@ namespace MagicApp
             GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
             if (pointCloud->HasColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "输入点云需要有颜色", "温馨提示", MB_OK);
                 return;
             }
-            std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-            if (imageColorIds.size() != pointCloud->GetPointCount())
+            const std::vector<GPP::ImageColorId>* imageColorIds =
+                ModelManager::Get()->GetPointCloudAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, pointCloud->GetPointCount());
+            if (imageColorIds == NULL)
             {
-                MessageBox(NULL, "ͼƬӦļд", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点与图片对应文件有错", "温馨提示", MB_OK);
                 return;
             }
             std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
@@ -1175,12 +1193,12 @@ namespace MagicApp
                 std::vector<GPP::Vector3> pointColors;
                 for (int pid = 0; pid < pointCount; pid++)
                 {
-                    if (imageColorIds.at(pid).GetImageIndex() != iid)
+                    if (imageColorIds->at(pid).GetImageIndex() != iid)
                     {
                         continue;
                     }
-                    pointCoords.push_back(imageColorIds.at(pid).GetLocalX());
-                    pointCoords.push_back(imageColorIds.at(pid).GetLocalY());
+                    pointCoords.push_back(imageColorIds->at(pid).GetLocalX());
+                    pointCoords.push_back(imageColorIds->at(pid).GetLocalY());
                     pointColors.push_back(pointCloud->GetPointColor(pid));
                 }
                 if (pointColors.empty())
@@ -1190,7 +1208,7 @@ namespace MagicApp
                 cv::Mat image = cv::imread(textureImageFiles.at(iid));
                 if (image.data == NULL)
                 {
-                    MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "图片读取失败", "温馨提示", MB_OK);
                     return;
                 }
                 int imageWidth = image.cols;
@@ -1208,7 +1226,7 @@ namespace MagicApp
                     imageWidth, imageHeight, imageData); 
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ͼŻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "纹理图优化失败", "温馨提示", MB_OK);
                     return;
                 }
                 for (int y = 0; y < imageHeight; ++y)
@@ -1247,23 +1265,15 @@ namespace MagicApp
         {
             return;
         }
-        std::vector<GPP::Int> deleteIndex;
-        GPP::Int pointCount = pointCloud->GetPointCount();
-        for (GPP::Int pid = 0; pid < pointCount; pid++)
-        {
-            if (mPointSelectFlag.at(pid))
-            {
-                deleteIndex.push_back(pid);
-            }
-        }
-        MagicPointCloud magicPointCloud(pointCloud);
-        SetupMagicPointCloud(magicPointCloud);
-        GPP::ErrorCode res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
+        ModelCompactor modelCompactor;
+        GPP::ErrorCode res = modelCompactor.CompactPointCloud(pointCloud, ModelManager::Get()->GetPointCloudAttributes(), mPointSelectFlag);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ɾʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "删点失败", "温馨提示", MB_OK);
             return;
         }
+        InfoLog << "PointShopApp::DeleteSelections delete " << modelCompactor.GetDeletedCount() << " points, time "
+            << modelCompactor.GetCompactTime() << std::endl;
         ResetSelection();
         mUpdatePointCloudRendering = true;
         mpUI->SetPointCloudInfo(pointCloud->GetPointCount());
@@ -1296,7 +1306,7 @@ namespace MagicApp
             GPP::Int pointCount = pointCloud->GetPointCount();
             if (pointCount < 1)
             {
-                MessageBox(NULL, "ƵĵС1ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云的点个数小于1，操作失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Real> outlierValue;
@@ -1308,12 +1318,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȥɵʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除飞点失败", "温馨提示", MB_OK);
                 return;
             }
             /*GPP::Real cutValue = 0.8;
@@ -1330,17 +1340,13 @@ namespace MagicApp
             }
             pointCloud->SetHasColor(true);*/
             GPP::Real cutValue = 0.8;
-            std::vector<GPP::Int> deleteIndex;
+            std::vector<bool> deleteFlags(pointCount, false);
             for (GPP::Int pid = 0; pid < pointCount; pid++)
             {
-                if (outlierValue.at(pid) > cutValue)
-                {
-                    deleteIndex.push_back(pid);
-                }
+                deleteFlags.at(pid) = outlierValue.at(pid) > cutValue;
             }
-            MagicPointCloud magicPointCloud(pointCloud);
-            SetupMagicPointCloud(magicPointCloud);
-            res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
+            ModelCompactor modelCompactor;
+            res = modelCompactor.CompactPointCloud(pointCloud, ModelManager::Get()->GetPointCloudAttributes(), deleteFlags);
             if (res != GPP_NO_ERROR)
             {
                 return;
@@ -1360,7 +1366,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1374,7 +1380,7 @@ namespace MagicApp
             GPP::Int pointCount = pointCloud->GetPointCount();
             if (pointCount < 1)
             {
-                MessageBox(NULL, "ƵĵС1ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云的点个数小于1，操作失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Real> isolation;
@@ -1386,26 +1392,22 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȥʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除孤立项失败", "温馨提示", MB_OK);
                 return;
             }
 
-            std::vector<GPP::Int> deleteIndex;
+            std::vector<bool> deleteFlags(pointCount, false);
             for (GPP::Int pid = 0; pid < pointCount; pid++)
             {
-                if (isolation[pid] < isolateValue)
-                {
-                    deleteIndex.push_back(pid);
-                }
+                deleteFlags.at(pid) = isolation[pid] < isolateValue;
             }
-            MagicPointCloud magicPointCloud(pointCloud);
-            SetupMagicPointCloud(magicPointCloud);
-            res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
+            ModelCompactor modelCompactor;
+            res = modelCompactor.CompactPointCloud(pointCloud, ModelManager::Get()->GetPointCloudAttributes(), deleteFlags);
             if (res != GPP_NO_ERROR)
             {
                 return;
@@ -1418,36 +1420,9 @@ namespace MagicApp
 
     static void SampleModelData(GPP::Int* sampleIndex, int sampleCount, int pointCount)
     {
-        std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
-        if (imageColorIds && imageColorIds->size() == pointCount)
-        {
-            std::vector<GPP::ImageColorId> sampleImageColorIds(sampleCount);
-            for (int sid = 0; sid < sampleCount; sid++)
-            {
-                sampleImageColorIds.at(sid) = imageColorIds->at(sampleIndex[sid]);
-            }
-            ModelManager::Get()->SetImageColorIds(sampleImageColorIds);
-        }
-        std::vector<int>* colorIds = ModelManager::Get()->GetColorIdsPointer();
-        if (colorIds && colorIds->size() == pointCount)
-        {
-            std::vector<GPP::Int> sampleColorIds(sampleCount);
-            for (int sid = 0; sid < sampleCount; sid++)
-            {
-                sampleColorIds.at(sid) = colorIds->at(sampleIndex[sid]);
-            }
-            ModelManager::Get()->SetColorIds(sampleColorIds);
-        }
-        std::vector<int>* cloudIds = ModelManager::Get()->GetCloudIdsPointer();
-        if (cloudIds && cloudIds->size() == pointCount)
-        {
-            std::vector<GPP::Int> sampleCloudIds(sampleCount);
-            for (int sid = 0; sid < sampleCount; sid++)
-            {
-                sampleCloudIds.at(sid) = cloudIds->at(sampleIndex[sid]);
-            }
-            ModelManager::Get()->SetCloudIds(sampleCloudIds);
-        }
+        AttributeStore* attributes = ModelManager::Get()->GetPointCloudAttributes();
+        attributes->RemoveUnmatchedChannels(pointCount);
+        attributes->ReorderElements(std::vector<GPP::Int>(sampleIndex, sampleIndex + sampleCount));
     }
 
     void PointShopApp::UniformSamplePointCloud(int targetPointCount)
@@ -1465,12 +1440,12 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::SamplePointCloud::UniformSample(pointCloud, targetPointCount, sampleIndex, 0);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Ʋʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云采样失败", "温馨提示", MB_OK);
             GPPFREEARRAY(sampleIndex);
             return;
         }
@@ -1519,7 +1494,7 @@ namespace MagicApp
         GPP::Int originPointCount = pointCloud->GetPointCount();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "Ҫȼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云需要先计算法线", "温馨提示", MB_OK);
             return;
         }
         GPP::Int* sampleIndex = new GPP::Int[targetPointCount];
@@ -1530,12 +1505,12 @@ namespace MagicApp
             GPP::SAMPLE_QUALITY_HIGH);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Ʋʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云采样失败", "温馨提示", MB_OK);
             GPPFREEARRAY(sampleIndex);
             return;
         }
@@ -1603,7 +1578,7 @@ namespace MagicApp
         }
         if (resolution > 10000 || resolution < 1)
         {
-            MessageBox(NULL, "ֱΪ[1, 10000]", "ܰʾ", MB_OK);
+            MessageBox(NULL, "采样分辨率区间为[1, 10000]", "温馨提示", MB_OK);
             return;
         }
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
@@ -1627,12 +1602,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::SamplePointCloud::Simplify(pointCloud, resolution, simplifiedCloud, &fields, &simplifiedFields);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ƽʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云简化失败", "温馨提示", MB_OK);
                 GPPFREEPOINTER(simplifiedCloud);
                 return;
             }
@@ -1649,12 +1624,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::SamplePointCloud::Simplify(pointCloud, resolution, simplifiedCloud, NULL, NULL);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ƽʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云简化失败", "温馨提示", MB_OK);
                 GPPFREEPOINTER(simplifiedCloud);
                 return;
             }
@@ -1691,12 +1666,12 @@ namespace MagicApp
             mUpdatePointCloudRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߼ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云法线计算失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -1711,7 +1686,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         GPP::Int pointCount = pointCloud->GetPointCount();
@@ -1730,7 +1705,7 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetPointCloud()->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (mRightMouseType == REVERSE_NORMAL)
@@ -1744,7 +1719,7 @@ namespace MagicApp
         }
         if (mRightMouseType == REVERSE_NORMAL)
         {
-            MessageBox(NULL, "ҼƷתģʽٴεťƽģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入点云反转法线模式，再次点击本按钮返回平移模式", "温馨提示", MB_OK);
         }
     }
 
@@ -1757,12 +1732,12 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         else if (quality < 0 || quality > 6)
         {
-            MessageBox(NULL, "ǻΧ[0, 6]ԽԽãٶԽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "三角化质量参数范围[0, 6]，数字越大，质量越好，速度越慢", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1793,17 +1768,17 @@ namespace MagicApp
 #if MAKEDUMPFILE
                 GPP::DumpOnce();
 #endif
-                GPP::ErrorCode res = GPP::ReconstructMesh::Reconstruct(pointCloud, triMesh, quality, needFillHole, 
+                GPP::ErrorCode res = ReconstructPointCloud(pointCloud, triMesh, quality, needFillHole, 
                     &pointColorFields, &vertexColorField, maxHoleAreaRatio);
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ǻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云三角化失败", "温馨提示", MB_OK);
                     GPPFREEPOINTER(triMesh);
                     return;
                 }
@@ -1830,17 +1805,17 @@ namespace MagicApp
 #if MAKEDUMPFILE
                 GPP::DumpOnce();
 #endif
-                GPP::ErrorCode res = GPP::ReconstructMesh::Reconstruct(pointCloud, triMesh, quality, needFillHole, 
+                GPP::ErrorCode res = ReconstructPointCloud(pointCloud, triMesh, quality, needFillHole, 
                     NULL, NULL, maxHoleAreaRatio);
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ǻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云三角化失败", "温馨提示", MB_OK);
                     GPPFREEPOINTER(triMesh);
                     return;
                 }
@@ -1856,6 +1831,24 @@ namespace MagicApp
         }
     }
 
+    GPP::ErrorCode PointShopApp::ReconstructPointCloud(const GPP::PointCloud* pointCloud, GPP::TriMesh* triMesh, int quality, bool needFillHole,
+        const std::vector<GPP::Real>* pointColorFields, std::vector<GPP::Real>* vertexColorField, double maxHoleAreaRatio)
+    {
+        if (pointCloud->GetPointCount() <= TILED_RECONSTRUCTION_POINT_COUNT)
+        {
+            return GPP::ReconstructMesh::Reconstruct(pointCloud, triMesh, quality, needFillHole, 
+                pointColorFields, vertexColorField, maxHoleAreaRatio);
+        }
+        // One octree for the whole cloud runs out of memory, reconstruct it tile by tile
+        TiledReconstructor tiledReconstructor(quality, needFillHole, maxHoleAreaRatio);
+        mTileProgress = 0;
+        GPP::ErrorCode res = tiledReconstructor.Reconstruct(pointCloud, pointColorFields, 3, triMesh, vertexColorField, &mTileProgress);
+        mTileProgress = -1;
+        InfoLog << "PointShopApp::ReconstructPointCloud: " << tiledReconstructor.GetTileCount() << " tiles, " 
+            << tiledReconstructor.GetConcurrentTileCount() << " concurrent, time " << tiledReconstructor.GetReconstructTime() << std::endl;
+        return res;
+    }
+
     int PointShopApp::GetPointCount()
     {
         if (ModelManager::Get()->GetPointCloud() != NULL)
@@ -1911,12 +1904,12 @@ namespace MagicApp
     {
         if (ModelManager::Get()->GetPointCloud() == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入点云", "温馨提示", MB_OK);
             return false;
         }
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -106,6 +106,8 @@ namespace MagicApp
         
         void PickPointCloudColorFromImages(void);
         void ConstructImageColorIdForMesh(GPP::TriMesh* triMesh, const GPP::IPointCloud* pointCloud);
+        GPP::ErrorCode ReconstructPointCloud(const GPP::PointCloud* pointCloud, GPP::TriMesh* triMesh, int quality, bool needFillHole,
+            const std::vector<GPP::Real>* pointColorFields, std::vector<GPP::Real>* vertexColorField, double maxHoleAreaRatio);
 
     private:
         void SetupScene(void);
@@ -137,5 +139,7 @@ namespace MagicApp
         int mColorNeighborCount;
         double mIsolateValue;
         GPP::Vector3 mSharpDiff;
+        // Finished tile ratio of a tiled reconstruction, -1 when it is not running
+        double mTileProgress;
     };
 }
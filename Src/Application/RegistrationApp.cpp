@@ -12,6 +12,8 @@
 #include "opencv2/opencv.hpp"
 #include "ToolAnn.h"
 #include "ModelManager.h"
+#include "ModelCompactor.h"
+#include "BrickFuser.h"
 #if DEBUGDUMPFILE
 #include "DumpRegistratePointCloud.h"
 #endif
@@ -257,12 +259,12 @@ namespace MagicApp
                         GPP::ErrorCode res = GPP::ConsolidatePointCloud::ReversePatchNormal(mpPointCloudRef, pickedIdRef);
                         if (res == GPP_API_IS_NOT_AVAILABLE)
                         {
-                            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                             MagicCore::ToolKit::Get()->SetAppRunning(false);
                         }
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "Ʒ߷޸ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "点云法线方向修复失败", "温馨提示", MB_OK);
                             return true;
                         }
                         UpdatePointCloudRefRendering();
@@ -286,12 +288,12 @@ namespace MagicApp
                         GPP::ErrorCode res = GPP::ConsolidatePointCloud::ReversePatchNormal(mpPointCloudFrom, pickedIdFrom);
                         if (res == GPP_API_IS_NOT_AVAILABLE)
                         {
-                            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                             MagicCore::ToolKit::Get()->SetAppRunning(false);
                         }
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "Ʒ߷޸ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "点云法线方向修复失败", "温馨提示", MB_OK);
                             return true;
                         }
                         UpdatePointCloudFromRendering();
@@ -336,7 +338,7 @@ namespace MagicApp
                     NULL, true, 0, NULL);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
                 return;
             }
             int pointListCount = pointCloudList.size();
@@ -359,7 +361,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::CalculatePointCloudListBoundingBox(pointCloudList, NULL, bboxMin, bboxMax);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Χмʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "包围盒计算失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::PointCloudPointList pointList(pointCloudList.at(0));
@@ -367,7 +369,7 @@ namespace MagicApp
             res = GPP::CalculatePointListDensity(&pointList, 5, density);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ܶȼʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云密度计算失败", "温馨提示", MB_OK);
                 return;
             }
             density *= intervalCount;
@@ -387,7 +389,7 @@ namespace MagicApp
                 res = sum.UpdateSumFunction(curPointCloud, NULL, &pointFields);
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                     return;
                 }
             }
@@ -396,7 +398,7 @@ namespace MagicApp
             res = sum.ExtractPointCloud(&fusedPointCloud, &pointFieldsFused, &cloudIds);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ƴȡʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云抽取失败", "温馨提示", MB_OK);
                 return;
             }
             int fieldDim = 1;
@@ -419,25 +421,24 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateIsolation(&fusedPointCloud, &isolation, 20, NULL);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȥʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除孤立项失败", "温馨提示", MB_OK);
                 return;
             }
             int fusedPointCount = fusedPointCloud.GetPointCount();
-            std::vector<GPP::Int> deleteIndex;
+            std::vector<bool> deleteFlags(fusedPointCount, false);
             GPP::Real isolateValue = 0.05; // parameter
             for (GPP::Int pid = 0; pid < fusedPointCount; pid++)
             {
-                if (isolation[pid] < isolateValue)
-                {
-                    deleteIndex.push_back(pid);
-                }
+                deleteFlags.at(pid) = isolation[pid] < isolateValue;
             }
-            MagicPointCloud magicPointCloud(&fusedPointCloud);
-            magicPointCloud.SetImageColorIds(&imageColorIds_point);
-            res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
+            AttributeStore pointAttributes;
+            pointAttributes.SwapChannel(IMAGE_COLOR_ID_CHANNEL, imageColorIds_point, GPP::ImageColorId(-1, 0, 0));
+            ModelCompactor modelCompactor;
+            res = modelCompactor.CompactPointCloud(&fusedPointCloud, &pointAttributes, deleteFlags);
+            pointAttributes.SwapChannel(IMAGE_COLOR_ID_CHANNEL, imageColorIds_point, GPP::ImageColorId(-1, 0, 0));
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɾʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云删点失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -450,14 +451,14 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ReconstructMesh::Reconstruct(&fusedPointCloud, &triMesh, quality, false, NULL, NULL);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ǻʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云三角化失败", "温馨提示", MB_OK);
                 return;
             }
             res = GPP::OptimiseMapping::TransferMappingToMesh(&fusedPointCloud, imageColorIds_point,
                 &triMesh, imageColorIds_mesh, 1.5, true);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "TransferMappingToMesh Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "TransferMappingToMesh Failed", "温馨提示", MB_OK);
                 return;
             }
             fusedPointCloud.Clear();
@@ -472,7 +473,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::UnfoldMesh::GenerateUVAtlas(&triMesh, initChartCount, &texCoords, &faceTexIds, true, true, true);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "UV Atlas ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "UV Atlas 生成失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -539,7 +540,7 @@ namespace MagicApp
                     cv::Mat image = cv::imread(textureImageFiles.at(iid));
                     if (image.data == NULL)
                     {
-                        MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "图片读取失败", "温馨提示", MB_OK);
                         return;
                     }
                     std::vector<GPP::Color4> oneImageData(width * height);
@@ -572,7 +573,7 @@ namespace MagicApp
                 imageListData, imageInfos, textureSize, textureSize, imageData, &textureImageMasks);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ͼʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "纹理图生成失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -678,7 +679,7 @@ namespace MagicApp
                 pointCloudList.push_back(*itr);
                 if ((*itr)->HasNormal() == false)
                 {
-                    MessageBox(NULL, "ҪϢ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云需要法线信息", "温馨提示", MB_OK);
                     return true;
                 }
             }
@@ -842,10 +843,10 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
-        MessageBox(NULL, "ȵͼ", "ܰʾ", MB_OK);
+        MessageBox(NULL, "请先导入图像", "温馨提示", MB_OK);
         char imageFilterName[] = "JPG Image(*.jpg)\0*.jpg\0PNG Image(*.png)\0*.png\0BMP Image(*.bmp)\0*.bmp\0";
         if (MagicCore::ToolKit::MultiFileOpenDlg(mTextureImageFiles, imageFilterName))
         {
@@ -858,14 +859,14 @@ namespace MagicApp
         {
             return;
         }
-        MessageBox(NULL, "ٵӦļ", "ܰʾ", MB_OK);
+        MessageBox(NULL, "再导入点像对应文件", "温馨提示", MB_OK);
         std::vector<std::string> mapFileNames;
         char mapFilterName[] = "SingleImage MAP Files(*.map)\0*.map\0MultiImage MAP Files(*.mmap)\0*.mmap\0";
         if (MagicCore::ToolKit::MultiFileOpenDlg(mapFileNames, mapFilterName))
         {
             if (mapFileNames.size() != mPointCloudList.size())
             {
-                MessageBox(NULL, "ӦļҪ͵һһӦ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点像对应文件需要和点云一一对应", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -880,7 +881,7 @@ namespace MagicApp
         size_t dotPos = mapFileNames.at(0).rfind('.');
         if (dotPos == std::string::npos)
         {
-            MessageBox(NULL, "ļʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "文件名解析失败", "温馨提示", MB_OK);
             return;
         }
         std::string extName = mapFileNames.at(0).substr(dotPos + 1);
@@ -893,7 +894,7 @@ namespace MagicApp
                 std::ifstream fin(mapFileNames.at(cloudId));
                 if (!fin)
                 {
-                    MessageBox(NULL, "Ӧļʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点像对应文件打开失败", "温馨提示", MB_OK);
                     return;
                 }
                 int curPointCount = mPointCloudList.at(cloudId)->GetPointCount();
@@ -920,7 +921,7 @@ namespace MagicApp
                 std::ifstream fin(mapFileNames.at(cloudId));
                 if (!fin)
                 {
-                    MessageBox(NULL, "Ӧļʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点像对应文件打开失败", "温馨提示", MB_OK);
                     return;
                 }
                 int pointCount = 0;
@@ -949,7 +950,7 @@ namespace MagicApp
             imageList.at(imageId) = cv::imread(mTextureImageFiles.at(imageId));
             if (imageList.at(imageId).data == NULL)
             {
-                MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
                 return;
             }
             imageHeightList.at(imageId) = imageList.at(imageId).rows;
@@ -1014,7 +1015,7 @@ namespace MagicApp
             }
             else
             {
-                MessageBox(NULL, "Ƶʧ, Ŀǰֵ֧ʽascobj", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败, 目前支持导入格式：asc，obj", "温馨提示", MB_OK);
             }
         }
         return false;
@@ -1028,7 +1029,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1050,12 +1051,12 @@ namespace MagicApp
             mUpdatePointRefRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߼ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云法线计算失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -1069,12 +1070,12 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         GPP::Int pointCount = mpPointCloudRef->GetPointCount();
@@ -1093,13 +1094,13 @@ namespace MagicApp
         }
         else if (mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         mReversePatchNormalRef = !mReversePatchNormalRef;
         if (mReversePatchNormalRef)
         {
-            MessageBox(NULL, "ҼƷ޸ģʽƷת߷ٴεťʰȡģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入点云法线修复模式，点击点云反转法线方向，再次点击本按钮返回拾取模式", "温馨提示", MB_OK);
         }
     }
 
@@ -1111,7 +1112,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1127,13 +1128,13 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateOutlier(mpPointCloudRef, &uniformity);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 mIsCommandInProgress = false;
-                MessageBox(NULL, "ȥɵʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除飞点失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real cutValue = 0.8;
@@ -1175,7 +1176,7 @@ namespace MagicApp
         {
             return;
         }
-        MessageBox(NULL, "ƱǵʽΪ\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "ܰʾ", MB_OK);
+        MessageBox(NULL, "点云标记点格式为：\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "温馨提示", MB_OK);
         std::string fileName;
         char filterName[] = "Ref Files(*.ref)\0*.ref\0";
         if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName))
@@ -1208,7 +1209,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL || mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
 
@@ -1248,7 +1249,7 @@ namespace MagicApp
             }
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
@@ -1278,12 +1279,12 @@ namespace MagicApp
             res = mpSumPointCloud->UpdateSumFunction(mpPointCloudFrom, NULL, &pointColorFieldsFrom);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
@@ -1294,13 +1295,13 @@ namespace MagicApp
             res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, &pointColorFieldsFused);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 GPPFREEPOINTER(extractPointCloud);
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             extractPointCloud->SetHasColor(true);
@@ -1321,12 +1322,12 @@ namespace MagicApp
             res = mpSumPointCloud->UpdateSumFunction(mpPointCloudFrom, NULL, NULL);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
@@ -1336,13 +1337,13 @@ namespace MagicApp
             res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, NULL);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 GPPFREEPOINTER(extractPointCloud);
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             GPPFREEPOINTER(mpPointCloudRef);
@@ -1405,7 +1406,7 @@ namespace MagicApp
             {
                 ClearPairwiseRegistrationData();
                 mMarkList.clear();
-                if (MessageBox(NULL, "ǷҪǵ", "ܰʾ", MB_YESNO) == IDYES)
+                if (MessageBox(NULL, "是否需要导入标记点", "温馨提示", MB_YESNO) == IDYES)
                 {
                     ImportMarkList();
                 }
@@ -1449,7 +1450,7 @@ namespace MagicApp
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
                 mIsCommandInProgress = false;
                 return;
             }
@@ -1485,7 +1486,7 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1526,12 +1527,12 @@ namespace MagicApp
             }
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
                 mIsCommandInProgress = false;
                 return;
             }
@@ -1583,7 +1584,7 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1622,7 +1623,7 @@ namespace MagicApp
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Χмʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "包围盒计算失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Vector3 deltaVector(0.25, 0.25, 0.25);
@@ -1636,28 +1637,43 @@ namespace MagicApp
             InfoLog << " pointlist density = " << density << std::endl;
             density *= intervalCount;
             InfoLog << " intervalCount = " << intervalCount << std::endl;
-            mpSumPointCloud = new GPP::SumPointCloud(density, bboxMin, bboxMax, hasNormalInfo, 25, 2);
+            // Bricks are fused concurrently with a SumPointCloud each, mpSumPointCloud is rebuilt from the fused reference by the next Fuse
+            BrickFuser brickFuser(density, bboxMin, bboxMax, hasNormalInfo, 25, 2);
 
             int pointCloudCount = mPointCloudList.size();
             bool hasColorInfo = false;
             for (int cid = 0; cid < pointCloudCount; cid++)
             {
-                mGlobalRegistrateProgress = double(cid) / double(pointCloudCount);
-                GPP::PointCloud* pointCloudFrom = mPointCloudList.at(cid);
-                GPP::Int pointCountFrom = pointCloudFrom->GetPointCount();
- 
-                if (pointCloudFrom->HasColor())
+                if (mPointCloudList.at(cid)->HasColor())
                 {
                     hasColorInfo = true;
-                    int fieldDim = 5;
-                    std::vector<GPP::Real> pointColorFieldsFrom(pointCountFrom * fieldDim, 0);
-                    for (GPP::Int pid = 0; pid < pointCountFrom; pid++)
+                }
+            }
+            // Fields are rgb and color id, source point ids are given back by BrickFuser
+            int fieldDim = 4;
+            std::vector<std::vector<GPP::Real> > pointColorFieldsList(hasColorInfo ? pointCloudCount : 0);
+            for (int cid = 0; cid < pointCloudCount; cid++)
+            {
+                GPP::PointCloud* pointCloudFrom = mPointCloudList.at(cid);
+                if (!hasColorInfo)
+                {
+                    res = brickFuser.AddPointCloud(pointCloudFrom, NULL, 0);
+                }
+                else
+                {
+                    GPP::Int pointCountFrom = pointCloudFrom->GetPointCount();
+                    std::vector<GPP::Real>& pointColorFieldsFrom = pointColorFieldsList.at(cid);
+                    pointColorFieldsFrom.resize(pointCountFrom * fieldDim, 0);
+                    if (pointCloudFrom->HasColor())
                     {
-                        GPP::Vector3 color = pointCloudFrom->GetPointColor(pid);
-                        GPP::Int baseId = pid * fieldDim;
-                        pointColorFieldsFrom.at(baseId) = color[0];
-                        pointColorFieldsFrom.at(baseId + 1) = color[1];
-                        pointColorFieldsFrom.at(baseId + 2) = color[2];
+                        for (GPP::Int pid = 0; pid < pointCountFrom; pid++)
+                        {
+                            GPP::Vector3 color = pointCloudFrom->GetPointColor(pid);
+                            GPP::Int baseId = pid * fieldDim;
+                            pointColorFieldsFrom.at(baseId) = color[0];
+                            pointColorFieldsFrom.at(baseId + 1) = color[1];
+                            pointColorFieldsFrom.at(baseId + 2) = color[2];
+                        }
                     }
                     if (mColorList.size() == pointCloudCount)
                     {
@@ -1666,63 +1682,39 @@ namespace MagicApp
                             pointColorFieldsFrom.at(pid * fieldDim + 3) = mColorList.at(cid).at(pid);
                         }
                     }
-                    for (GPP::Int pid = 0; pid < pointCountFrom; pid++)
-                    {
-                        pointColorFieldsFrom.at(pid * fieldDim + 4) = pid;
-                    }
-                    res = mpSumPointCloud->UpdateSumFunction(pointCloudFrom, NULL, &pointColorFieldsFrom);
-                    if (res == GPP_API_IS_NOT_AVAILABLE)
-                    {
-                        MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                        MagicCore::ToolKit::Get()->SetAppRunning(false);
-                    }
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
-                        mGlobalRegistrateProgress = -1;
-                        mIsCommandInProgress = false;
-                        return;
-                    }
+                    res = brickFuser.AddPointCloud(pointCloudFrom, &pointColorFieldsFrom, fieldDim);
                 }
-                else
+                if (res != GPP_NO_ERROR)
                 {
-                    res = mpSumPointCloud->UpdateSumFunction(pointCloudFrom, NULL, NULL);
-                    if (res == GPP_API_IS_NOT_AVAILABLE)
-                    {
-                        MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                        MagicCore::ToolKit::Get()->SetAppRunning(false);
-                    }
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
-                        mGlobalRegistrateProgress = -1;
-                        mIsCommandInProgress = false;
-                        return;
-                    }
+                    MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
+                    mIsCommandInProgress = false;
+                    return;
                 }
             }
             mCloudIds.clear();
             mColorIds.clear();
             std::vector<int> pointIds;
+            GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
+            std::vector<GPP::Real> pointColorFieldsFused;
+            mGlobalRegistrateProgress = 0;
+            res = brickFuser.Fuse(extractPointCloud, hasColorInfo ? &pointColorFieldsFused : NULL, &mCloudIds, &pointIds, 
+                &mGlobalRegistrateProgress);
+            InfoLog << "Global fuse app: brickCount=" << brickFuser.GetBrickCount() << " time=" << brickFuser.GetFuseTime() << std::endl;
+            if (res == GPP_API_IS_NOT_AVAILABLE)
+            {
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+                MagicCore::ToolKit::Get()->SetAppRunning(false);
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                GPPFREEPOINTER(extractPointCloud);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
+                mGlobalRegistrateProgress = -1;
+                mIsCommandInProgress = false;
+                return;
+            }
             if (hasColorInfo)
             {
-                GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
-                std::vector<GPP::Real> pointColorFieldsFused;
-                res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, &pointColorFieldsFused, &mCloudIds);
-                if (res == GPP_API_IS_NOT_AVAILABLE)
-                {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                    MagicCore::ToolKit::Get()->SetAppRunning(false);
-                }
-                if (res != GPP_NO_ERROR)
-                {
-                    GPPFREEPOINTER(extractPointCloud);
-                    MessageBox(NULL, "Ƴȡʧ", "ܰʾ", MB_OK);
-                    mGlobalRegistrateProgress = -1;
-                    mIsCommandInProgress = false;
-                    return;
-                }
-                int fieldDim = 5;
                 extractPointCloud->SetHasColor(true);
                 GPP::Int pointCountFused = extractPointCloud->GetPointCount();
                 for (GPP::Int pid = 0; pid < pointCountFused; pid++)
@@ -1740,31 +1732,11 @@ namespace MagicApp
                         mColorIds.at(pid) = int(pointColorFieldsFused.at(pid * fieldDim + 3));
                     }
                 }
-                pointIds.resize(pointCountFused);
-                for (int pid = 0; pid < pointCountFused; pid++)
-                {
-                    pointIds.at(pid) = int(pointColorFieldsFused.at(pid * fieldDim + 4));
-                }
                 GPPFREEPOINTER(mpPointCloudRef);
                 mpPointCloudRef = extractPointCloud;
             }
             else
             {
-                GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
-                res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, NULL, &mCloudIds);
-                if (res == GPP_API_IS_NOT_AVAILABLE)
-                {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                    MagicCore::ToolKit::Get()->SetAppRunning(false);
-                }
-                if (res != GPP_NO_ERROR)
-                {
-                    GPPFREEPOINTER(extractPointCloud);
-                    MessageBox(NULL, "Ƴȡʧ", "ܰʾ", MB_OK);
-                    mGlobalRegistrateProgress = -1;
-                    mIsCommandInProgress = false;
-                    return;
-                }
                 GPPFREEPOINTER(mpPointCloudRef);
                 mpPointCloudRef = extractPointCloud;
                 mpPointCloudRef->SetDefaultColor(GPP::Vector3(0.09, 0.48627, 0.69));
@@ -1796,7 +1768,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -1837,7 +1809,7 @@ namespace MagicApp
             }
             else
             {
-                MessageBox(NULL, "Ƶʧ, Ŀǰֵ֧ʽascobj", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败, 目前支持导入格式：asc，obj", "温馨提示", MB_OK);
             }
         }
         return false;
@@ -1851,7 +1823,7 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1872,12 +1844,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߼ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云法线计算失败", "温馨提示", MB_OK);
                 return;
             }
             mUpdatePointFromRendering = true;
@@ -1892,12 +1864,12 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudFrom->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         GPP::Int pointCount = mpPointCloudFrom->GetPointCount();
@@ -1916,13 +1888,13 @@ namespace MagicApp
         }
         else if (mpPointCloudFrom->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         mReversePatchNormalFrom = !mReversePatchNormalFrom;
         if (mReversePatchNormalFrom)
         {
-            MessageBox(NULL, "ҼƷ޸ģʽƷת߷ٴεťʰȡģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入点云法线修复模式，点击点云反转法线方向，再次点击本按钮返回拾取模式", "温馨提示", MB_OK);
         }
     }
 
@@ -1934,7 +1906,7 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1950,13 +1922,13 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateOutlier(mpPointCloudFrom, &uniformity);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 mIsCommandInProgress = false;
-                MessageBox(NULL, "ȥɵʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除飞点失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real cutValue = 0.8;
@@ -2045,7 +2017,7 @@ namespace MagicApp
         {
             return;
         }
-        MessageBox(NULL, "ƱǵʽΪ\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "ܰʾ", MB_OK);
+        MessageBox(NULL, "点云标记点格式为：\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "温馨提示", MB_OK);
         std::string fileName;
         char filterName[] = "Ref Files(*.ref)\0*.ref\0";
         if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName))
@@ -2078,17 +2050,17 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL || mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudFrom->HasNormal() == false || mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸοƺҪĵƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给参考点云和需要对齐的点云计算法线", "温馨提示", MB_OK);
             return;
         }
         if (mRefMarks.size() < 3 || mFromMarks.size() < 3)
         {
-            MessageBox(NULL, "ǵƴҪ3ϵıǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "带标记的拼接需要3个及以上的标记点", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2117,12 +2089,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ٶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "快速对齐失败", "温馨提示", MB_OK);
                 return;
             }
             //Update mpPointCloudFrom
@@ -2153,12 +2125,12 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL || mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudFrom->HasNormal() == false || mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸοƺҪĵƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给参考点云和需要对齐的点云计算法线", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2179,12 +2151,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ޱǶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "无标记对齐失败", "温馨提示", MB_OK);
                 return;
             }
             //Update mpPointCloudFrom
@@ -2215,7 +2187,7 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL || mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2227,7 +2199,7 @@ namespace MagicApp
         {
             if (mRefMarks.size() > 0 || mFromMarks.size() > 0)
             {
-                if (MessageBox(NULL, "Ҫɾбǵ", "ܰʾ", MB_YESNO) == IDYES)
+                if (MessageBox(NULL, "需要删除所有标记点吗", "温馨提示", MB_YESNO) == IDYES)
                 {
                     mRefMarks.clear();
                     mFromMarks.clear();
@@ -2260,12 +2232,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ICPʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "ICP对齐失败", "温馨提示", MB_OK);
                 return;
             }
             //Update mpPointCloudFrom
@@ -2298,7 +2270,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -2320,16 +2292,18 @@ namespace MagicApp
         ModelManager::Get()->SetScaleValue(mScaleValue);
         ModelManager::Get()->SetObjCenterCoord(mObjCenterCoord);
         ModelManager::Get()->ClearMesh();
-        ModelManager::Get()->SetCloudIds(mCloudIds);
         ModelManager::Get()->SetTextureImageFiles(mTextureImageFiles);
-        ModelManager::Get()->SetImageColorIds(mImageColorIds);
+        AttributeStore* attributes = ModelManager::Get()->GetPointCloudAttributes();
+        attributes->Clear();
+        attributes->AddChannel(CLOUD_ID_CHANNEL, -1) = mCloudIds;
+        attributes->AddChannel(IMAGE_COLOR_ID_CHANNEL, GPP::ImageColorId(-1, 0, 0)) = mImageColorIds;
         if (mColorIds.empty())
         {
-            ModelManager::Get()->SetColorIds(mCloudIds);
+            attributes->AddChannel(COLOR_ID_CHANNEL, -1) = mCloudIds;
         }
         else
         {
-            ModelManager::Get()->SetColorIds(mColorIds);
+            attributes->AddChannel(COLOR_ID_CHANNEL, -1) = mColorIds;
         }
         AppManager::Get()->EnterApp(new PointShopApp, "PointShopApp");
     }
@@ -2395,10 +2369,10 @@ namespace MagicApp
         {
             if (mPointCloudList.size() < 2)
             {
-                MessageBox(NULL, "Ƹ2", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云个数少于2", "温馨提示", MB_OK);
                 return;
             }
-            if (MessageBox(NULL, "ԴɫǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+            if (MessageBox(NULL, "单光源点云颜色修正，是否继续", "温馨提示", MB_OKCANCEL) != IDOK)
             {
                 return;
             }
@@ -2445,7 +2419,7 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɫʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云颜色矫正失败", "温馨提示", MB_OK);
                 mColorList.clear();
                 return;
             }
@@ -2470,7 +2444,7 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> fileNames;
@@ -2544,18 +2518,18 @@ namespace MagicApp
     {
         if (mpDumpInfo == NULL)
         {
-            MessageBox(NULL, "ȵdumpļ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入dump文件", "温馨提示", MB_OK);
             return;
         }
         GPP::ErrorCode res = mpDumpInfo->Run();
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "dumpִʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump执行失败", "温馨提示", MB_OK);
             return;
         }
         else
         {
-            MessageBox(NULL, "dumpļִгɹ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump文件执行成功", "温馨提示", MB_OK);
         }
 
         ResetGlobalRegistrationData();
@@ -293,7 +293,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return false;
             }
             GPPFREEPOINTER(mpReliefMesh);   
@@ -308,7 +308,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         //Get depth data
@@ -353,12 +353,12 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::DigitalRelief::CompressHeightField(&compressedHeightField, resolution, resolution, compressRatio);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "浮雕生成失败", "温馨提示", MB_OK);
             return;
         }
         GPP::TriMesh* reliefMesh = GenerateTriMeshFromHeightField(compressedHeightField, resolution, resolution);
@@ -372,7 +372,7 @@ namespace MagicApp
         }
         else
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "浮雕生成失败", "温馨提示", MB_OK);
         }
         UpdateModelRendering();
     }
@@ -393,12 +393,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         if (scanResolution < 0 || imageResolution < 0)
         {
-            MessageBox(NULL, "úʵķֱ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请设置合适的分辨率", "温馨提示", MB_OK);
             return;
         }
 
@@ -487,12 +487,12 @@ namespace MagicApp
             scanResolution, false, true, 75.0 * GPP::ONE_RADIAN);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "浮雕生成失败", "温馨提示", MB_OK);
             return;
         }
         Ogre::TextureManager::getSingleton().remove("DepthTexture");
@@ -534,14 +534,14 @@ namespace MagicApp
         size_t dotPos = fileName.rfind('.');
         if (dotPos == std::string::npos)
         {
-            MessageBox(NULL, "ļ׺", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请输入文件后缀名", "温馨提示", MB_OK);
             return;
         }
         mpDepthPointCloud->SetHasColor(false);
         GPP::ErrorCode res = GPP::Parser::ExportPointCloud(fileName, mpDepthPointCloud);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "导出点云失败", "温馨提示", MB_OK);
         }
 
         dotPos = fileName.rfind('.');
@@ -646,7 +646,7 @@ namespace MagicApp
     {
         if (mpDepthPointCloud == NULL)
         {
-            MessageBox(NULL, "ɵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先生成点云数据", "温馨提示", MB_OK);
             return;
         }
         std::string fileName;
@@ -736,7 +736,7 @@ namespace MagicApp
     {
         if (MagicCore::ScriptSystem::Get()->IsOnRunningScript())
         {
-            MessageBox(NULL, "ȴǰһűִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待前一脚本执行完毕", "温馨提示", MB_OK);
             return;
         }
         std::string fileName;
@@ -747,7 +747,7 @@ namespace MagicApp
             if (MagicCore::ScriptSystem::Get()->RunScriptFile(fileName.c_str()))
             {
                 UpdateModelRendering();
-                MessageBox(NULL, "űִ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "脚本执行完毕", "温馨提示", MB_OK);
             }
         }
     }
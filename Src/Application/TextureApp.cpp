@@ -4,6 +4,8 @@
 #include "TextureAppUI.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "ModelExporter.h"
+#include "WorkspaceFile.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
@@ -40,7 +42,8 @@ namespace MagicApp
         mTextureType(TT_NONE),
         mTextureImageName("../../Media/TextureApp/texture.png"),
         mTextureImageMasks(),
-        mSharpDiff()
+        mSharpDiff(),
+        mRenderVersion(0)
     {
     }
 
@@ -71,7 +74,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -179,14 +182,19 @@ namespace MagicApp
         else if (arg.key == OIS::KC_I)
         {
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
-            std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
+            const std::vector<GPP::ImageColorId>* imageColorIds = triMesh == NULL ? NULL :
+                ModelManager::Get()->GetMeshAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, triMesh->GetVertexCount());
+            if (imageColorIds == NULL)
+            {
+                return true;
+            }
             triMesh->SetHasVertexColor(true);
             int maxColorId = 10;
             double deltaColor = 0.1;
             int vertexCount = triMesh->GetVertexCount();
             for (int vid = 0; vid < vertexCount; vid++)
             {
-                int imageIndex = imageColorIds.at(vid).GetImageIndex();
+                int imageIndex = imageColorIds->at(vid).GetImageIndex();
                 if (imageIndex < 0)
                 {
                     triMesh->SetVertexColor(vid, MagicCore::ToolKit::Get()->ColorCoding(0));
@@ -216,7 +224,7 @@ namespace MagicApp
             mpImageFrameMesh = GPP::Parser::ImportTriMesh("../../Media/TextureApp/ImageMesh.obj");
             if (mpImageFrameMesh == NULL)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "纹理网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             mpImageFrameMesh->UpdateNormal();
@@ -270,7 +278,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -330,6 +338,11 @@ namespace MagicApp
         }
     }
 
+    int TextureApp::GetTextureImageSize() const
+    {
+        return mTextureImageSize;
+    }
+
     void TextureApp::SwitchDisplayMode()
     {
         if (mDisplayMode == TRIMESH_SOLID)
@@ -349,7 +362,8 @@ namespace MagicApp
             mDisplayMode = TRIMESH_SOLID;
         }
         
-        UpdateDisplay();
+        UpdateDisplay(mUpdateDisplay);
+        mUpdateDisplay = false;
     }
 
     void TextureApp::SwitchTextureImage()
@@ -363,9 +377,10 @@ namespace MagicApp
         }
         else
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
         }
-        UpdateDisplay();
+        UpdateDisplay(mUpdateDisplay);
+        mUpdateDisplay = false;
     }
 
     void TextureApp::UpdatetextureImage()
@@ -378,7 +393,7 @@ namespace MagicApp
         }
         else
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
         }
         mUpdateDisplay = true;
     }
@@ -392,9 +407,13 @@ namespace MagicApp
         }
     }
 
-    void TextureApp::UpdateDisplay()
+    void TextureApp::UpdateDisplay(bool isMeshChanged)
     {
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh != NULL && isMeshChanged)
+        {
+            mRenderVersion++;
+        }
         if (mDisplayMode == TRIMESH_SOLID)
         {
             if (triMesh == NULL)
@@ -404,7 +423,7 @@ namespace MagicApp
             }
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_SOLID);
             MagicCore::RenderSystem::Get()->RenderMesh("TriMesh_TextureApp", "CookTorrance", triMesh, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, false);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, false, mRenderVersion);
         }
         else if (mDisplayMode == TRIMESH_WIREFRAME)
         {
@@ -415,7 +434,7 @@ namespace MagicApp
             }
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_WIREFRAME);
             MagicCore::RenderSystem::Get()->RenderMesh("TriMesh_TextureApp", "CookTorrance", triMesh, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, false, mRenderVersion);
         }
         else if (mDisplayMode == TRIMESH_TEXTURE)
         {
@@ -427,7 +446,7 @@ namespace MagicApp
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_SOLID);
             UpdateTriMeshTexture();
             MagicCore::RenderSystem::Get()->RenderTextureMesh("TriMesh_TextureApp", "TextureMeshMaterial", triMesh, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, mRenderVersion);
         }
         else if (mDisplayMode == UVMESH_WIREFRAME)
         {
@@ -438,7 +457,7 @@ namespace MagicApp
             }
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_SOLID);
             MagicCore::RenderSystem::Get()->RenderUVMesh("TriMesh_TextureApp", "CookTorrance", triMesh, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, mRenderVersion);
         }
     }
 
@@ -555,12 +574,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         if (triMesh->HasTriangleTexCoord() == false)
         {
-            MessageBox(NULL, "ȼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先计算纹理坐标", "温馨提示", MB_OK);
             return;
         }
         std::string fileName;
@@ -579,37 +598,16 @@ namespace MagicApp
                 dotPos = fileName.rfind('/');
                 if (dotPos == std::string::npos)
                 {
-                    MessageBox(NULL, "ļЧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "文件名字无效", "温馨提示", MB_OK);
                     return;
                 }
             }
             std::string fileNameNoPath = fileName.substr(dotPos + 1);
-            std::ofstream objOut(objName.c_str());
-            objOut << "mtllib " << fileNameNoPath << ".mtl" << "\n";
-            objOut << "usemtl " << fileNameNoPath << "\n";
-            GPP::Int vertexCount = triMesh->GetVertexCount();
-            for (GPP::Int vid = 0; vid < vertexCount; vid++)
-            {
-                GPP::Vector3 coord = triMesh->GetVertexCoord(vid);
-                objOut << "v " << coord[0] << " " << coord[1] << " " << coord[2] << "\n";
-            }
-            GPP::Int faceCount = triMesh->GetTriangleCount();
-            for (GPP::Int fid = 0; fid < faceCount; fid++)
-            {
-                for (int localId = 0; localId < 3; localId++)
-                {
-                    GPP::Vector3 texCoord = triMesh->GetTriangleTexcoord(fid, localId);
-                    objOut << "vt " << texCoord[0] << " " << texCoord[1] << "\n";
-                }
-            }
-            GPP::Int vertexIds[3];
-            for (GPP::Int fid = 0; fid < faceCount; fid++)
+            GPP::ErrorCode res = ModelExporter::Get()->ExportTexturedObj(objName, fileNameNoPath, triMesh);
+            if (res != GPP_NO_ERROR)
             {
-                triMesh->GetTriangleVertexIds(fid, vertexIds);
-                objOut << "f " << vertexIds[0] + 1 << "/" << fid * 3 + 1 << " " 
-                    << vertexIds[1] + 1 << "/" << fid * 3 + 2 << " " << vertexIds[2] + 1 << "/" << fid * 3 + 3 << "\n"; 
+                MessageBox(NULL, "网格导出失败", "温馨提示", MB_OK);
             }
-            objOut.close();
             
             // export mtl file
             std::string mtlName = fileName + ".mtl";
@@ -637,29 +635,30 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         if (triMesh->HasTriangleTexCoord() == false)
         {
-            MessageBox(NULL, "ȸ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给网格计算纹理坐标", "温馨提示", MB_OK);
             return;
         }
 
-        std::vector<GPP::ImageColorId> originImageColorIds = ModelManager::Get()->GetImageColorIds();
+        const std::vector<GPP::ImageColorId>* originImageColorIds =
+            ModelManager::Get()->GetMeshAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, triMesh->GetVertexCount());
         if (isByVertexColor)
         {
             if (triMesh->HasVertexColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "输入需要带颜色的网格", "温馨提示", MB_OK);
                 return;
             }
         }
         else
         {
-            if (originImageColorIds.size() != triMesh->GetVertexCount())
+            if (originImageColorIds == NULL)
             {
-                MessageBox(NULL, "ͼƬӦļд", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点与图片对应文件有错", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -709,7 +708,7 @@ namespace MagicApp
                 triMesh->GetTriangleVertexIds(fid, vertexIds);
                 for (int fvid = 0; fvid < 3; ++fvid)
                 {
-                    imageColorIds.at(fid * 3 + fvid) = originImageColorIds.at(vertexIds[fvid]);
+                    imageColorIds.at(fid * 3 + fvid) = originImageColorIds->at(vertexIds[fvid]);
                 }
             }
             std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
@@ -723,7 +722,7 @@ namespace MagicApp
                 cv::Mat image = cv::imread(textureImageFiles.at(iid));
                 if (image.data == NULL)
                 {
-                    MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "图片读取失败", "温馨提示", MB_OK);
                     return;
                 }
                 int width = image.cols;
@@ -749,7 +748,7 @@ namespace MagicApp
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ͼʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "纹理图生成失败", "温馨提示", MB_OK);
             return;
         }
         
@@ -807,7 +806,7 @@ namespace MagicApp
         }
         else
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
         }
         mDisplayMode = TRIMESH_TEXTURE;
         UpdateDisplay();
@@ -829,25 +828,33 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh == NULL)
             {
-                MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
                 return;
             }
             if (triMesh->HasVertexColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "输入需要带颜色的网格", "温馨提示", MB_OK);
                 return;
             }
-            std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-            if (imageColorIds.size() != triMesh->GetVertexCount())
+            AttributeStore* attributes = ModelManager::Get()->GetMeshAttributes();
+            const std::vector<GPP::ImageColorId>* imageColorIdsPointer =
+                attributes->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, triMesh->GetVertexCount());
+            if (imageColorIdsPointer == NULL)
             {
-                MessageBox(NULL, "ͼƬӦļд", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点与图片对应文件有错", "温馨提示", MB_OK);
                 return;
             }
-            std::vector<int> vertexFlags = ModelManager::Get()->GetImageColorIdFlags();
-            if (vertexFlags.empty())
+            const std::vector<GPP::ImageColorId>& imageColorIds = *imageColorIdsPointer;
+            std::vector<int> vertexFlags;
+            const std::vector<int>* imageColorIdFlags = attributes->GetChannel<int>(IMAGE_COLOR_ID_FLAG_CHANNEL);
+            if (imageColorIdFlags == NULL || imageColorIdFlags->empty())
             {
                 vertexFlags.resize(triMesh->GetVertexCount(), 1);
             }
+            else
+            {
+                vertexFlags = *imageColorIdFlags;
+            }
             std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
             int imageCount = textureImageFiles.size();
             InfoLog << "imageCount=" << imageCount << std::endl;
@@ -903,7 +910,7 @@ namespace MagicApp
                 cv::Mat image = cv::imread(textureImageFiles.at(iid));
                 if (image.data == NULL)
                 {
-                    MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "图片读取失败", "温馨提示", MB_OK);
                     return;
                 }
                 int imageWidth = image.cols;
@@ -921,7 +928,7 @@ namespace MagicApp
                     faceVertexIds, imageWidth, imageHeight, imageData); 
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ͼŻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "纹理图优化失败", "温馨提示", MB_OK);
                     return;
                 }
                 for (int y = 0; y < imageHeight; ++y)
@@ -1013,38 +1020,37 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh == NULL)
             {
-                MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
-            std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-            if (imageColorIds.empty())
+            AttributeStore* attributes = ModelManager::Get()->GetMeshAttributes();
+            std::vector<GPP::ImageColorId>* imageColorIds = attributes->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL);
+            if (imageColorIds == NULL || imageColorIds->empty())
             {
-                MessageBox(NULL, "ImageColorId is empty", "ܰʾ", MB_OK);
+                MessageBox(NULL, "ImageColorId is empty", "温馨提示", MB_OK);
                 return;
             }
-            std::vector<int> fixFlag = ModelManager::Get()->GetImageColorIdFlags();
-            if (fixFlag.empty())
+            const std::vector<int>* fixFlag = attributes->GetChannel<int>(IMAGE_COLOR_ID_FLAG_CHANNEL);
+            if (fixFlag == NULL || fixFlag->empty())
             {
-                fixFlag.resize(triMesh->GetVertexCount(), 1);
                 return;
             }
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = GPP::OptimiseMapping::InterpolateImageColorIdsOnMesh(triMesh, fixFlag, imageColorIds);
+            GPP::ErrorCode res = GPP::OptimiseMapping::InterpolateImageColorIdsOnMesh(triMesh, *fixFlag, *imageColorIds);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ͼӦŻʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "图像对应优化失败", "温馨提示", MB_OK);
                 return;
             }
-            ModelManager::Get()->SetImageColorIds(imageColorIds);
-            //MapTriMesh2ImageSpace(triMesh, imageColorIds);
+            //MapTriMesh2ImageSpace(triMesh, *imageColorIds);
         }
     }
 
@@ -1057,62 +1063,79 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         int vertexCount = triMesh->GetVertexCount();
-        std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-        if (imageColorIds.size() != vertexCount)
+        std::vector<GPP::ImageColorId>* imageColorIds =
+            ModelManager::Get()->GetMeshAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, vertexCount);
+        if (imageColorIds == NULL)
         {
-            MessageBox(NULL, "ImageColorId size != vertexCount", "ܰʾ", MB_OK);
+            MessageBox(NULL, "ImageColorId size != vertexCount", "温馨提示", MB_OK);
             return;
         }
 #if MAKEDUMPFILE
         GPP::DumpOnce();
 #endif
         double isolateValue = 0.001;
-        GPP::ErrorCode res = GPP::OptimiseMapping::OptimiseIsolateImageColorIdsOnMesh(triMesh, imageColorIds, isolateValue);
+        GPP::ErrorCode res = GPP::OptimiseMapping::OptimiseIsolateImageColorIdsOnMesh(triMesh, *imageColorIds, isolateValue);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ӦŻʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点像对应孤立点优化失败", "温馨提示", MB_OK);
             return;
         }
-        ModelManager::Get()->SetImageColorIds(imageColorIds);
     }
 
     void TextureApp::SaveImageColorInfo()
     {
         std::string fileName;
-        char filterName[] = "Support format(*.gii)\0*.gii\0";
+        char filterName[] = "Magic3D Workspace(*.gws)\0*.gws\0";
         if (MagicCore::ToolKit::FileSaveDlg(fileName, filterName))
         {
-            std::ofstream fout(fileName);
-            ModelManager::Get()->DumpInfo(fout);
-            fout.close();
+            if (ModelManager::Get()->SaveWorkspace(fileName) == false)
+            {
+                MessageBox(NULL, "工作区保存失败", "温馨提示", MB_OK);
+            }
         }
     }
     
     void TextureApp::LoadImageColorInfo()
     {
         std::string fileName;
-        char filterName[] = "Geometry++ Image Info(*.gii)\0*.gii\0";
+        char filterName[] = "Magic3D Workspace(*.gws)\0*.gws\0Geometry++ Image Info(*.gii)\0*.gii\0";
         if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName))
         {
+            if (WorkspaceFile::IsWorkspaceFile(fileName))
+            {
+                if (ModelManager::Get()->LoadWorkspace(fileName) == false)
+                {
+                    MessageBox(NULL, "工作区导入失败", "温馨提示", MB_OK);
+                    return;
+                }
+                GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+                mDisplayMode = TRIMESH_SOLID;
+                UpdateDisplay();
+                if (triMesh)
+                {
+                    mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
+                }
+                return;
+            }
             std::ifstream fin(fileName);
             if (!fin)
             {
-                MessageBox(NULL, "GIIʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "GII导入失败", "温馨提示", MB_OK);
                 return;
             }
-            ModelManager::Get()->LoadInfo(fin);
+            ModelManager::Get()->LoadInfo(fin, ModelManager::Get()->GetMeshAttributes());
             fin.close();
 
-            MessageBox(NULL, "뵼ͼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入图像", "温馨提示", MB_OK);
             std::vector<std::string> fileNames;
             char filterName[] = "JPG Files(*.jpg)\0*.jpg\0PNG Files(*.png)\0*.png\0BMP Image(*.bmp)\0*.bmp\0";
             if (MagicCore::ToolKit::MultiFileOpenDlg(fileNames, filterName))
@@ -1128,19 +1151,20 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "mpTriMesh == NULL", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mpTriMesh == NULL", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
         if (textureImageFiles.empty())
         {
-            MessageBox(NULL, "mTextureImageFiles is empty", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mTextureImageFiles is empty", "温馨提示", MB_OK);
             return;
         }
-        std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
-        if (imageColorIds.size() != triMesh->GetVertexCount())
+        const std::vector<GPP::ImageColorId>* imageColorIds =
+            ModelManager::Get()->GetMeshAttributes()->GetChannel<GPP::ImageColorId>(IMAGE_COLOR_ID_CHANNEL, triMesh->GetVertexCount());
+        if (imageColorIds == NULL)
         {
-            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "温馨提示", MB_OK);
             return;
         }
         int imageCount = textureImageFiles.size();
@@ -1151,7 +1175,7 @@ namespace MagicApp
             imageList.at(fid) = cv::imread(textureImageFiles.at(fid));
             if (imageList.at(fid).data == NULL)
             {
-                MessageBox(NULL, "Imageʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Image导入失败", "温馨提示", MB_OK);
                 return;
             }
             imageHList.at(fid) = imageList.at(fid).rows;
@@ -1160,7 +1184,7 @@ namespace MagicApp
         triMesh->SetHasVertexColor(true);
         for (int vid = 0; vid < vertexCount; vid++)
         {
-            GPP::ImageColorId colorId = imageColorIds.at(vid);
+            GPP::ImageColorId colorId = imageColorIds->at(vid);
             int imageIndex = colorId.GetImageIndex();
             const unsigned char* pixel = imageList.at(imageIndex).ptr(imageHList.at(imageIndex) - colorId.GetLocalY() - 1,
                 colorId.GetLocalX());
@@ -1191,20 +1215,20 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh == NULL)
             {
-                MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
-            std::vector<GPP::Int> colorIds = ModelManager::Get()->GetColorIds();
-            if (colorIds.empty())
+            const std::vector<GPP::Int>* colorIds = ModelManager::Get()->GetMeshAttributes()->GetChannel<GPP::Int>(COLOR_ID_CHANNEL);
+            if (colorIds == NULL || colorIds->empty())
             {
-                MessageBox(NULL, "ColorIds is empty", "ܰʾ", MB_OK);
+                MessageBox(NULL, "ColorIds is empty", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Vector3> vertexColors(vertexCount);
             if (triMesh->HasVertexColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格需要颜色", "温馨提示", MB_OK);
                 return;
             }
             for (int vid = 0; vid < vertexCount; vid++)
@@ -1215,17 +1239,17 @@ namespace MagicApp
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = GPP::IntrinsicColor::TuneMeshColorFromMultiPatch(triMesh, colorIds, vertexColors,
+            GPP::ErrorCode res = GPP::IntrinsicColor::TuneMeshColorFromMultiPatch(triMesh, *colorIds, vertexColors,
                 GPP::Vector3(sharpDiff_H ,sharpDiff_S, sharpDiff_V));
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɫںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格颜色融合失败", "温馨提示", MB_OK);
                 return;
             }
             for (int vid = 0; vid < vertexCount; vid++)
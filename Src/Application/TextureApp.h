@@ -79,6 +79,7 @@ namespace MagicApp
         void TuneTextureImageByVertexColor(bool isSubThread = true);
 
         int GetMeshVertexCount(void);
+        int GetTextureImageSize(void) const;
 
 #if DEBUGDUMPFILE
         void SetDumpInfo(GPP::DumpBase* dumpInfo);
@@ -87,7 +88,8 @@ namespace MagicApp
 
     private:
         void InitViewTool(void);
-        void UpdateDisplay(void);
+        // isMeshChanged: false if only the display mode is switched, then the cached buffers are shown
+        void UpdateDisplay(bool isMeshChanged = true);
         void UpdateTriMeshTexture(void);
         void UnifyTextureCoords(std::vector<double>& texCoords, double scaleValue);
         void ExportObjFile(void);
@@ -116,5 +118,6 @@ namespace MagicApp
         std::string mTextureImageName;
         std::vector<GPP::Int> mTextureImageMasks;
         GPP::Vector3 mSharpDiff;
+        int mRenderVersion;
     };
 }
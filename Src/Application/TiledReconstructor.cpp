@@ -0,0 +1,1086 @@
+#include "TiledReconstructor.h"
+#include "../Common/LogSystem.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <math.h>
+
+namespace MagicApp
+{
+    static const GPP::Int DEFAULT_MAX_TILE_POINT_COUNT = 2000000;
+    // Smaller tiles are mostly margin, and the reconstruction degrades near the tile border
+    static const GPP::Int MIN_TILE_POINT_COUNT = 10000;
+    static const GPP::Real DEFAULT_OVERLAP_RATIO = 0.1;
+    static const GPP::ULongInt DEFAULT_MEMORY_BYTE_COUNT = GPP::ULongInt(4) << 30;
+    // Rough peak memory of a reconstruction per input point, octree and solver included
+    static const GPP::ULongInt TILE_BYTES_PER_POINT = 1024;
+    // Boundary vertices this many mean edge lengths from an inner core face are seam vertices
+    static const GPP::Real SEAM_BAND_EDGE_RATIO = 2.0;
+    // A seam vertex is welded to the nearest seam vertex of another tile within this many mean boundary edge lengths
+    static const GPP::Real SEAM_WELD_EDGE_RATIO = 0.75;
+    // Turns around a vertex fan before its boundary edge is given up
+    static const GPP::Int MAX_FAN_TURN_COUNT = 64;
+    static const GPP::Real ONE_PI = 3.14159265358979;
+
+    class PointAxisLess
+    {
+    public:
+        PointAxisLess(const GPP::IPointCloud* pointCloud, int axis) :
+            mpPointCloud(pointCloud),
+            mAxis(axis)
+        {
+        }
+
+        bool operator () (GPP::Int pointId0, GPP::Int pointId1) const
+        {
+            return mpPointCloud->GetPointCoord(pointId0)[mAxis] < mpPointCloud->GetPointCoord(pointId1)[mAxis];
+        }
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        int mAxis;
+    };
+
+    class PointAxisBelow
+    {
+    public:
+        PointAxisBelow(const GPP::IPointCloud* pointCloud, int axis, GPP::Real splitValue) :
+            mpPointCloud(pointCloud),
+            mAxis(axis),
+            mSplitValue(splitValue)
+        {
+        }
+
+        bool operator () (GPP::Int pointId) const
+        {
+            return mpPointCloud->GetPointCoord(pointId)[mAxis] < mSplitValue;
+        }
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        int mAxis;
+        GPP::Real mSplitValue;
+    };
+
+    struct SeamCell
+    {
+        GPP::ULongInt mCellKey;
+        GPP::Int mSeamId;
+
+        bool operator < (const SeamCell& seamCell) const
+        {
+            return mCellKey < seamCell.mCellKey || (mCellKey == seamCell.mCellKey && mSeamId < seamCell.mSeamId);
+        }
+    };
+
+    static GPP::ULongInt PackSeamCellKey(GPP::Int cellX, GPP::Int cellY, GPP::Int cellZ)
+    {
+        return GPP::ULongInt(cellX) | (GPP::ULongInt(cellY) << 21) | (GPP::ULongInt(cellZ) << 42);
+    }
+
+    struct SortedTriangle
+    {
+        GPP::Int mVertexIds[3];
+        GPP::Int mTriangleId;
+
+        bool operator < (const SortedTriangle& triangle) const
+        {
+            for (int localId = 0; localId < 3; localId++)
+            {
+                if (mVertexIds[localId] != triangle.mVertexIds[localId])
+                {
+                    return mVertexIds[localId] < triangle.mVertexIds[localId];
+                }
+            }
+            return mTriangleId < triangle.mTriangleId;
+        }
+    };
+
+    struct EarCandidate
+    {
+        GPP::Real mLength;
+        GPP::Int mLoopId;
+        GPP::Int mVersion;
+
+        // std::priority_queue pops the largest, so the shortest ear compares largest
+        bool operator < (const EarCandidate& ear) const
+        {
+            return mLength > ear.mLength;
+        }
+    };
+
+    class ReconstructTileTask : public MagicCore::ParallelTask
+    {
+    public:
+        ReconstructTileTask(TiledReconstructor* tiledReconstructor, GPP::Int fromTileId) :
+            mpTiledReconstructor(tiledReconstructor),
+            mFromTileId(fromTileId)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int slotId = startId; slotId < endId; slotId++)
+            {
+                mpTiledReconstructor->ReconstructTile(mFromTileId + slotId, slotId);
+            }
+        }
+
+    private:
+        TiledReconstructor* mpTiledReconstructor;
+        GPP::Int mFromTileId;
+    };
+
+    TiledReconstructor::TiledReconstructor(GPP::Int quality, bool needFillHole, GPP::Real maxHoleAreaRatio) :
+        mQuality(quality),
+        mNeedFillHole(needFillHole),
+        mMaxHoleAreaRatio(maxHoleAreaRatio),
+        mMaxTilePointCount(DEFAULT_MAX_TILE_POINT_COUNT),
+        mOverlapRatio(DEFAULT_OVERLAP_RATIO),
+        mMemoryByteCount(DEFAULT_MEMORY_BYTE_COUNT),
+        mpPointCloud(NULL),
+        mpPointFields(NULL),
+        mFieldDim(0),
+        mPointOrder(),
+        mNodes(),
+        mTileNodeIds(),
+        mBBoxMin(),
+        mBBoxMax(),
+        mConcurrentTileCount(1),
+        mBatchResults(),
+        mVertexCoords(),
+        mVertexFields(),
+        mTriangleVertexIds(),
+        mSeamVertexIds(),
+        mSeamTileIds(),
+        mBoundaryEdgeLength(0),
+        mBoundaryEdgeCount(0),
+        mReconstructTime(0)
+    {
+    }
+
+    TiledReconstructor::~TiledReconstructor()
+    {
+    }
+
+    void TiledReconstructor::SetMaxTilePointCount(GPP::Int maxTilePointCount)
+    {
+        mMaxTilePointCount = maxTilePointCount < MIN_TILE_POINT_COUNT ? MIN_TILE_POINT_COUNT : maxTilePointCount;
+    }
+
+    void TiledReconstructor::SetOverlapRatio(GPP::Real overlapRatio)
+    {
+        mOverlapRatio = overlapRatio < 0 ? 0 : overlapRatio;
+    }
+
+    void TiledReconstructor::SetMemoryBudget(GPP::ULongInt memoryByteCount)
+    {
+        mMemoryByteCount = memoryByteCount;
+    }
+
+    GPP::ErrorCode TiledReconstructor::Reconstruct(const GPP::IPointCloud* pointCloud, const std::vector<GPP::Real>* pointFields,
+        GPP::Int fieldDim, GPP::TriMesh* triMesh, std::vector<GPP::Real>* vertexFields, double* progress)
+    {
+        if (pointCloud == NULL || triMesh == NULL || pointCloud->GetPointCount() == 0 || pointCloud->HasNormal() == false)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (pointFields == NULL || vertexFields == NULL)
+        {
+            pointFields = NULL;
+            fieldDim = 0;
+        }
+        else if (fieldDim <= 0 || GPP::Int(pointFields->size()) != pointCloud->GetPointCount() * fieldDim)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        mpPointCloud = pointCloud;
+        mpPointFields = pointFields;
+        mFieldDim = fieldDim;
+        SplitTiles();
+        GPP::Int tileCount = GetTileCount();
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        GPP::ULongInt tilePointCount = pointCount < mMaxTilePointCount ? pointCount : mMaxTilePointCount;
+        mConcurrentTileCount = GPP::Int(mMemoryByteCount / (tilePointCount * TILE_BYTES_PER_POINT));
+        GPP::Int threadCount = MagicCore::ParallelTool::GetThreadCount();
+        mConcurrentTileCount = mConcurrentTileCount > threadCount ? threadCount : mConcurrentTileCount;
+        mConcurrentTileCount = mConcurrentTileCount < 1 ? 1 : mConcurrentTileCount;
+        InfoLog << "TiledReconstructor: " << tileCount << " tiles, " << mConcurrentTileCount << " concurrent" << std::endl;
+
+        mVertexCoords.clear();
+        mVertexFields.clear();
+        mTriangleVertexIds.clear();
+        mSeamVertexIds.clear();
+        mSeamTileIds.clear();
+        mBoundaryEdgeLength = 0;
+        mBoundaryEdgeCount = 0;
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        for (GPP::Int fromTileId = 0; fromTileId < tileCount; fromTileId += mConcurrentTileCount)
+        {
+            GPP::Int toTileId = fromTileId + mConcurrentTileCount;
+            if (toTileId > tileCount)
+            {
+                toTileId = tileCount;
+            }
+            GPP::Int slotCount = toTileId - fromTileId;
+            mBatchResults.clear();
+            mBatchResults.resize(slotCount);
+            ReconstructTileTask reconstructTask(this, fromTileId);
+            MagicCore::ParallelTool::ParallelFor(slotCount, &reconstructTask, 1);
+
+            for (GPP::Int slotId = 0; slotId < slotCount; slotId++)
+            {
+                if (mBatchResults.at(slotId).mResult == GPP_API_IS_NOT_AVAILABLE)
+                {
+                    res = GPP_API_IS_NOT_AVAILABLE;
+                    break;
+                }
+                if (mBatchResults.at(slotId).mResult != GPP_NO_ERROR)
+                {
+                    // A tile with too few points to reconstruct only leaves a hole
+                    InfoLog << "  tile " << fromTileId + slotId << " reconstruction failed" << std::endl;
+                }
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                break;
+            }
+
+            // Append in tile order, so the result does not depend on the thread timing
+            for (GPP::Int slotId = 0; slotId < slotCount; slotId++)
+            {
+                TileResult& tileResult = mBatchResults.at(slotId);
+                if (tileResult.mResult != GPP_NO_ERROR)
+                {
+                    continue;
+                }
+                GPP::Int vertexStart = mVertexCoords.size() / 3;
+                mVertexCoords.insert(mVertexCoords.end(), tileResult.mVertexCoords.begin(), tileResult.mVertexCoords.end());
+                mVertexFields.insert(mVertexFields.end(), tileResult.mVertexFields.begin(), tileResult.mVertexFields.end());
+                for (std::vector<GPP::Int>::iterator itr = tileResult.mTriangleVertexIds.begin(); itr != tileResult.mTriangleVertexIds.end(); ++itr)
+                {
+                    mTriangleVertexIds.push_back(vertexStart + *itr);
+                }
+                for (std::vector<GPP::Int>::iterator itr = tileResult.mSeamVertexIds.begin(); itr != tileResult.mSeamVertexIds.end(); ++itr)
+                {
+                    mSeamVertexIds.push_back(vertexStart + *itr);
+                    mSeamTileIds.push_back(fromTileId + slotId);
+                }
+                mBoundaryEdgeLength += tileResult.mBoundaryEdgeLength;
+                mBoundaryEdgeCount += tileResult.mBoundaryEdgeCount;
+            }
+            mBatchResults.clear();
+            // Worker threads never write it, so the reading thread sees one writer
+            if (progress)
+            {
+                *progress = double(toTileId) / double(tileCount);
+            }
+        }
+        std::vector<GPP::Int>().swap(mPointOrder);
+        if (res == GPP_NO_ERROR && mTriangleVertexIds.empty())
+        {
+            res = GPP_INVALID_RESULT;
+        }
+        if (res != GPP_NO_ERROR)
+        {
+            mVertexCoords.clear();
+            mVertexFields.clear();
+            mTriangleVertexIds.clear();
+            mSeamVertexIds.clear();
+            mSeamTileIds.clear();
+            mReconstructTime = MagicCore::ToolKit::GetTime() - startTime;
+            return res;
+        }
+
+        StitchSeams();
+        triMesh->Clear();
+        GPP::Int vertexCount = mVertexCoords.size() / 3;
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            triMesh->InsertVertex(GPP::Vector3(mVertexCoords.at(vid * 3), mVertexCoords.at(vid * 3 + 1), mVertexCoords.at(vid * 3 + 2)));
+        }
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->InsertTriangle(mTriangleVertexIds.at(fid * 3), mTriangleVertexIds.at(fid * 3 + 1), mTriangleVertexIds.at(fid * 3 + 2));
+        }
+        std::vector<GPP::Real>().swap(mVertexCoords);
+        std::vector<GPP::Int>().swap(mTriangleVertexIds);
+        std::vector<GPP::Int>().swap(mSeamVertexIds);
+        std::vector<GPP::Int>().swap(mSeamTileIds);
+        if (vertexFields)
+        {
+            vertexFields->swap(mVertexFields);
+        }
+        mVertexFields.clear();
+        triMesh->UpdateNormal();
+        if (mNeedFillHole)
+        {
+            res = FillHoles(triMesh, mFieldDim > 0 ? vertexFields : NULL);
+            if (res == GPP_API_IS_NOT_AVAILABLE)
+            {
+                return res;
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                InfoLog << "TiledReconstructor: fill holes failed" << std::endl;
+            }
+            triMesh->UpdateNormal();
+        }
+        mReconstructTime = MagicCore::ToolKit::GetTime() - startTime;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int TiledReconstructor::GetTileCount(void) const
+    {
+        return mTileNodeIds.size();
+    }
+
+    GPP::Int TiledReconstructor::GetConcurrentTileCount(void) const
+    {
+        return mConcurrentTileCount;
+    }
+
+    double TiledReconstructor::GetReconstructTime(void) const
+    {
+        return mReconstructTime;
+    }
+
+    void TiledReconstructor::SplitTiles(void)
+    {
+        GPP::Int pointCount = mpPointCloud->GetPointCount();
+        mPointOrder.resize(pointCount);
+        mBBoxMin = mpPointCloud->GetPointCoord(0);
+        mBBoxMax = mBBoxMin;
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            mPointOrder.at(pid) = pid;
+            GPP::Vector3 coord = mpPointCloud->GetPointCoord(pid);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                mBBoxMin[axis] = coord[axis] < mBBoxMin[axis] ? coord[axis] : mBBoxMin[axis];
+                mBBoxMax[axis] = coord[axis] > mBBoxMax[axis] ? coord[axis] : mBBoxMax[axis];
+            }
+        }
+        // The outer core faces are far outside, so the outer tiles own everything the reconstruction adds beyond the bounding box
+        GPP::Vector3 outerDelta = mBBoxMax - mBBoxMin + GPP::Vector3(1, 1, 1);
+        TileNode rootNode;
+        rootNode.mCoreMin = mBBoxMin - outerDelta;
+        rootNode.mCoreMax = mBBoxMax + outerDelta;
+        rootNode.mPointStart = 0;
+        rootNode.mPointEnd = pointCount;
+        rootNode.mChildIds[0] = -1;
+        rootNode.mChildIds[1] = -1;
+        mNodes.clear();
+        mNodes.push_back(rootNode);
+        mTileNodeIds.clear();
+        std::vector<GPP::Int> splitNodeIds(1, 0);
+        while (!splitNodeIds.empty())
+        {
+            GPP::Int nodeId = splitNodeIds.back();
+            splitNodeIds.pop_back();
+            TileNode node = mNodes.at(nodeId);
+            if (node.mPointEnd - node.mPointStart <= mMaxTilePointCount)
+            {
+                mTileNodeIds.push_back(nodeId);
+                continue;
+            }
+            // Split the longest edge of the points at their median
+            GPP::Vector3 pointMin = mpPointCloud->GetPointCoord(mPointOrder.at(node.mPointStart));
+            GPP::Vector3 pointMax = pointMin;
+            for (GPP::Int orderId = node.mPointStart; orderId < node.mPointEnd; orderId++)
+            {
+                GPP::Vector3 coord = mpPointCloud->GetPointCoord(mPointOrder.at(orderId));
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    pointMin[axis] = coord[axis] < pointMin[axis] ? coord[axis] : pointMin[axis];
+                    pointMax[axis] = coord[axis] > pointMax[axis] ? coord[axis] : pointMax[axis];
+                }
+            }
+            int splitAxis = 0;
+            for (int axis = 1; axis < 3; axis++)
+            {
+                if (pointMax[axis] - pointMin[axis] > pointMax[splitAxis] - pointMin[splitAxis])
+                {
+                    splitAxis = axis;
+                }
+            }
+            std::vector<GPP::Int>::iterator startItr = mPointOrder.begin() + node.mPointStart;
+            std::vector<GPP::Int>::iterator endItr = mPointOrder.begin() + node.mPointEnd;
+            std::vector<GPP::Int>::iterator medianItr = startItr + (node.mPointEnd - node.mPointStart) / 2;
+            std::nth_element(startItr, medianItr, endItr, PointAxisLess(mpPointCloud, splitAxis));
+            GPP::Real splitValue = mpPointCloud->GetPointCoord(*medianItr)[splitAxis];
+            GPP::Int pointSplit = GPP::Int(std::partition(startItr, endItr, PointAxisBelow(mpPointCloud, splitAxis, splitValue)) - mPointOrder.begin());
+            if (pointSplit == node.mPointStart || pointSplit == node.mPointEnd)
+            {
+                // Too many equal coordinates to split
+                mTileNodeIds.push_back(nodeId);
+                continue;
+            }
+            TileNode childNode = node;
+            childNode.mCoreMax[splitAxis] = splitValue;
+            childNode.mPointEnd = pointSplit;
+            mNodes.at(nodeId).mChildIds[0] = mNodes.size();
+            splitNodeIds.push_back(mNodes.size());
+            mNodes.push_back(childNode);
+            childNode = node;
+            childNode.mCoreMin[splitAxis] = splitValue;
+            childNode.mPointStart = pointSplit;
+            mNodes.at(nodeId).mChildIds[1] = mNodes.size();
+            splitNodeIds.push_back(mNodes.size());
+            mNodes.push_back(childNode);
+        }
+        std::sort(mTileNodeIds.begin(), mTileNodeIds.end());
+    }
+
+    void TiledReconstructor::CollectTilePoints(GPP::Int tileId, std::vector<GPP::Int>& pointIds) const
+    {
+        const TileNode& tileNode = mNodes.at(mTileNodeIds.at(tileId));
+        GPP::Vector3 pointMin = mpPointCloud->GetPointCoord(mPointOrder.at(tileNode.mPointStart));
+        GPP::Vector3 pointMax = pointMin;
+        for (GPP::Int orderId = tileNode.mPointStart; orderId < tileNode.mPointEnd; orderId++)
+        {
+            GPP::Vector3 coord = mpPointCloud->GetPointCoord(mPointOrder.at(orderId));
+            for (int axis = 0; axis < 3; axis++)
+            {
+                pointMin[axis] = coord[axis] < pointMin[axis] ? coord[axis] : pointMin[axis];
+                pointMax[axis] = coord[axis] > pointMax[axis] ? coord[axis] : pointMax[axis];
+            }
+        }
+        GPP::Vector3 pointExtent = pointMax - pointMin;
+        GPP::Real margin = mOverlapRatio * std::max(pointExtent[0], std::max(pointExtent[1], pointExtent[2]));
+        GPP::Vector3 marginMin = tileNode.mCoreMin - GPP::Vector3(margin, margin, margin);
+        GPP::Vector3 marginMax = tileNode.mCoreMax + GPP::Vector3(margin, margin, margin);
+        pointIds.clear();
+        std::vector<GPP::Int> visitNodeIds(1, 0);
+        while (!visitNodeIds.empty())
+        {
+            const TileNode& node = mNodes.at(visitNodeIds.back());
+            visitNodeIds.pop_back();
+            bool isOverlapped = true;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (node.mCoreMin[axis] > marginMax[axis] || node.mCoreMax[axis] < marginMin[axis])
+                {
+                    isOverlapped = false;
+                    break;
+                }
+            }
+            if (!isOverlapped)
+            {
+                continue;
+            }
+            if (node.mChildIds[0] >= 0)
+            {
+                visitNodeIds.push_back(node.mChildIds[0]);
+                visitNodeIds.push_back(node.mChildIds[1]);
+                continue;
+            }
+            for (GPP::Int orderId = node.mPointStart; orderId < node.mPointEnd; orderId++)
+            {
+                GPP::Int pointId = mPointOrder.at(orderId);
+                GPP::Vector3 coord = mpPointCloud->GetPointCoord(pointId);
+                if (coord[0] >= marginMin[0] && coord[0] <= marginMax[0] && coord[1] >= marginMin[1] && coord[1] <= marginMax[1] &&
+                    coord[2] >= marginMin[2] && coord[2] <= marginMax[2])
+                {
+                    pointIds.push_back(pointId);
+                }
+            }
+        }
+        std::sort(pointIds.begin(), pointIds.end());
+    }
+
+    void TiledReconstructor::ReconstructTile(GPP::Int tileId, GPP::Int slotId)
+    {
+        TileResult& tileResult = mBatchResults.at(slotId);
+        tileResult.mBoundaryEdgeLength = 0;
+        tileResult.mBoundaryEdgeCount = 0;
+        tileResult.mResult = GPP_NO_ERROR;
+        std::vector<GPP::Int> pointIds;
+        CollectTilePoints(tileId, pointIds);
+        GPP::Int tilePointCount = pointIds.size();
+        GPP::PointCloud* tilePointCloud = new GPP::PointCloud;
+        tilePointCloud->SetHasNormal(true);
+        std::vector<GPP::Real> tilePointFields;
+        tilePointFields.reserve(tilePointCount * mFieldDim);
+        for (GPP::Int localId = 0; localId < tilePointCount; localId++)
+        {
+            GPP::Int pointId = pointIds.at(localId);
+            tilePointCloud->InsertPoint(mpPointCloud->GetPointCoord(pointId), mpPointCloud->GetPointNormal(pointId));
+            for (GPP::Int fieldId = 0; fieldId < mFieldDim; fieldId++)
+            {
+                tilePointFields.push_back(mpPointFields->at(pointId * mFieldDim + fieldId));
+            }
+        }
+        std::vector<GPP::Int>().swap(pointIds);
+        // Holes are filled after stitching, a tile would close its cut through the core
+        GPP::TriMesh* tileMesh = new GPP::TriMesh;
+        std::vector<GPP::Real> tileVertexFields;
+        tileResult.mResult = GPP::ReconstructMesh::Reconstruct(tilePointCloud, tileMesh, mQuality, false,
+            mFieldDim > 0 ? &tilePointFields : NULL, mFieldDim > 0 ? &tileVertexFields : NULL);
+        GPPFREEPOINTER(tilePointCloud);
+        std::vector<GPP::Real>().swap(tilePointFields);
+        if (tileResult.mResult == GPP_NO_ERROR)
+        {
+            TrimTile(tileId, tileMesh, tileVertexFields, tileResult);
+        }
+        GPPFREEPOINTER(tileMesh);
+    }
+
+    void TiledReconstructor::TrimTile(GPP::Int tileId, const GPP::TriMesh* tileMesh, const std::vector<GPP::Real>& tileFields,
+        TileResult& tileResult) const
+    {
+        const TileNode& tileNode = mNodes.at(mTileNodeIds.at(tileId));
+        const TileNode& rootNode = mNodes.at(0);
+        GPP::Int vertexCount = tileMesh->GetVertexCount();
+        GPP::Int triangleCount = tileMesh->GetTriangleCount();
+        bool hasFields = mFieldDim > 0 && GPP::Int(tileFields.size()) == vertexCount * mFieldDim;
+        // A triangle belongs to the tile whose half open core contains its centroid, so neighbor tiles do not overlap
+        std::vector<GPP::Int> vertexTrimIds(vertexCount, -1);
+        GPP::Int trimVertexCount = 0;
+        GPP::Real edgeLength = 0;
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            tileMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Vector3 coords[3] = {tileMesh->GetVertexCoord(vertexIds[0]), tileMesh->GetVertexCoord(vertexIds[1]),
+                tileMesh->GetVertexCoord(vertexIds[2])};
+            GPP::Vector3 centroid = (coords[0] + coords[1] + coords[2]) / 3.0;
+            if (centroid[0] < tileNode.mCoreMin[0] || centroid[0] >= tileNode.mCoreMax[0] || centroid[1] < tileNode.mCoreMin[1] ||
+                centroid[1] >= tileNode.mCoreMax[1] || centroid[2] < tileNode.mCoreMin[2] || centroid[2] >= tileNode.mCoreMax[2])
+            {
+                continue;
+            }
+            for (int localId = 0; localId < 3; localId++)
+            {
+                if (vertexTrimIds.at(vertexIds[localId]) < 0)
+                {
+                    vertexTrimIds.at(vertexIds[localId]) = trimVertexCount;
+                    trimVertexCount++;
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        tileResult.mVertexCoords.push_back(coords[localId][axis]);
+                    }
+                    for (GPP::Int fieldId = 0; hasFields && fieldId < mFieldDim; fieldId++)
+                    {
+                        tileResult.mVertexFields.push_back(tileFields.at(vertexIds[localId] * mFieldDim + fieldId));
+                    }
+                }
+                tileResult.mTriangleVertexIds.push_back(vertexTrimIds.at(vertexIds[localId]));
+                edgeLength += (coords[(localId + 1) % 3] - coords[localId]).Length();
+            }
+        }
+        GPP::Int trimTriangleCount = tileResult.mTriangleVertexIds.size() / 3;
+        if (trimTriangleCount == 0)
+        {
+            return;
+        }
+        if (mFieldDim > 0 && !hasFields)
+        {
+            tileResult.mVertexFields.assign(trimVertexCount * mFieldDim, 0);
+        }
+        GPP::Real seamBand = edgeLength / (trimTriangleCount * 3) * SEAM_BAND_EDGE_RATIO;
+
+        // Boundary edges have no opposite half edge
+        std::vector<GPP::ULongInt> halfEdgeKeys;
+        halfEdgeKeys.reserve(trimTriangleCount * 3);
+        for (GPP::Int fid = 0; fid < trimTriangleCount; fid++)
+        {
+            for (int localId = 0; localId < 3; localId++)
+            {
+                GPP::ULongInt fromId = tileResult.mTriangleVertexIds.at(fid * 3 + localId);
+                GPP::ULongInt toId = tileResult.mTriangleVertexIds.at(fid * 3 + (localId + 1) % 3);
+                halfEdgeKeys.push_back((fromId << 32) | toId);
+            }
+        }
+        std::sort(halfEdgeKeys.begin(), halfEdgeKeys.end());
+        std::vector<bool> isSeamVertex(trimVertexCount, false);
+        for (std::vector<GPP::ULongInt>::iterator itr = halfEdgeKeys.begin(); itr != halfEdgeKeys.end(); ++itr)
+        {
+            GPP::ULongInt fromId = (*itr) >> 32;
+            GPP::ULongInt toId = (*itr) & 0xFFFFFFFF;
+            if (std::binary_search(halfEdgeKeys.begin(), halfEdgeKeys.end(), (toId << 32) | fromId))
+            {
+                continue;
+            }
+            GPP::Int edgeVertexIds[2] = {GPP::Int(fromId), GPP::Int(toId)};
+            GPP::Vector3 edgeCoords[2];
+            for (int localId = 0; localId < 2; localId++)
+            {
+                const GPP::Real* coord = &(tileResult.mVertexCoords.at(edgeVertexIds[localId] * 3));
+                edgeCoords[localId] = GPP::Vector3(coord[0], coord[1], coord[2]);
+            }
+            tileResult.mBoundaryEdgeLength += (edgeCoords[1] - edgeCoords[0]).Length();
+            tileResult.mBoundaryEdgeCount++;
+            for (int localId = 0; localId < 2; localId++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    if ((tileNode.mCoreMin[axis] > rootNode.mCoreMin[axis] && fabs(edgeCoords[localId][axis] - tileNode.mCoreMin[axis]) <= seamBand) ||
+                        (tileNode.mCoreMax[axis] < rootNode.mCoreMax[axis] && fabs(edgeCoords[localId][axis] - tileNode.mCoreMax[axis]) <= seamBand))
+                    {
+                        isSeamVertex.at(edgeVertexIds[localId]) = true;
+                    }
+                }
+            }
+        }
+        for (GPP::Int vid = 0; vid < trimVertexCount; vid++)
+        {
+            if (isSeamVertex.at(vid))
+            {
+                tileResult.mSeamVertexIds.push_back(vid);
+            }
+        }
+    }
+
+    void TiledReconstructor::StitchSeams(void)
+    {
+        GPP::Int vertexCount = mVertexCoords.size() / 3;
+        GPP::Int seamVertexCount = mSeamVertexIds.size();
+        std::vector<GPP::Int> vertexMapIds(vertexCount);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            vertexMapIds.at(vid) = vid;
+        }
+        if (seamVertexCount > 1 && mBoundaryEdgeCount > 0)
+        {
+            // Seam vertices sorted by grid cells as large as the tolerance, so the nearest one is in the 27 neighbor cells
+            GPP::Real tolerance = mBoundaryEdgeLength / mBoundaryEdgeCount * SEAM_WELD_EDGE_RATIO;
+            GPP::Real seamMin[3] = {GPP::REAL_LARGE, GPP::REAL_LARGE, GPP::REAL_LARGE};
+            for (std::vector<GPP::Int>::iterator itr = mSeamVertexIds.begin(); itr != mSeamVertexIds.end(); ++itr)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    seamMin[axis] = std::min(seamMin[axis], mVertexCoords.at((*itr) * 3 + axis));
+                }
+            }
+            std::vector<SeamCell> seamCells(seamVertexCount);
+            std::vector<GPP::Int> seamCellIndices(seamVertexCount * 3);
+            for (GPP::Int seamId = 0; seamId < seamVertexCount; seamId++)
+            {
+                GPP::Int* cellIndex = &(seamCellIndices.at(seamId * 3));
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    cellIndex[axis] = GPP::Int((mVertexCoords.at(mSeamVertexIds.at(seamId) * 3 + axis) - seamMin[axis]) / tolerance) + 1;
+                }
+                seamCells.at(seamId).mCellKey = PackSeamCellKey(cellIndex[0], cellIndex[1], cellIndex[2]);
+                seamCells.at(seamId).mSeamId = seamId;
+            }
+            std::sort(seamCells.begin(), seamCells.end());
+            std::vector<GPP::Int> nearestSeamIds(seamVertexCount, -1);
+            GPP::Real toleranceSquared = tolerance * tolerance;
+            for (GPP::Int seamId = 0; seamId < seamVertexCount; seamId++)
+            {
+                const GPP::Real* coord = &(mVertexCoords.at(mSeamVertexIds.at(seamId) * 3));
+                const GPP::Int* cellIndex = &(seamCellIndices.at(seamId * 3));
+                GPP::Real nearestDistance = toleranceSquared;
+                for (GPP::Int offsetId = 0; offsetId < 27; offsetId++)
+                {
+                    SeamCell searchCell;
+                    searchCell.mCellKey = PackSeamCellKey(cellIndex[0] + offsetId % 3 - 1, cellIndex[1] + (offsetId / 3) % 3 - 1,
+                        cellIndex[2] + offsetId / 9 - 1);
+                    searchCell.mSeamId = -1;
+                    for (std::vector<SeamCell>::iterator cellItr = std::lower_bound(seamCells.begin(), seamCells.end(), searchCell);
+                        cellItr != seamCells.end() && cellItr->mCellKey == searchCell.mCellKey; ++cellItr)
+                    {
+                        GPP::Int otherId = cellItr->mSeamId;
+                        if (mSeamTileIds.at(otherId) == mSeamTileIds.at(seamId))
+                        {
+                            continue;
+                        }
+                        const GPP::Real* otherCoord = &(mVertexCoords.at(mSeamVertexIds.at(otherId) * 3));
+                        GPP::Real distance = (otherCoord[0] - coord[0]) * (otherCoord[0] - coord[0]) +
+                            (otherCoord[1] - coord[1]) * (otherCoord[1] - coord[1]) + (otherCoord[2] - coord[2]) * (otherCoord[2] - coord[2]);
+                        if (distance <= nearestDistance)
+                        {
+                            nearestDistance = distance;
+                            nearestSeamIds.at(seamId) = otherId;
+                        }
+                    }
+                }
+            }
+            // Only mutual nearest pairs are welded, a chain of close vertices along the seam would collapse into one
+            for (GPP::Int seamId = 0; seamId < seamVertexCount; seamId++)
+            {
+                GPP::Int otherId = nearestSeamIds.at(seamId);
+                if (otherId < seamId || nearestSeamIds.at(otherId) != seamId)
+                {
+                    continue;
+                }
+                GPP::Int vertexId = mSeamVertexIds.at(seamId);
+                GPP::Int otherVertexId = mSeamVertexIds.at(otherId);
+                vertexMapIds.at(otherVertexId) = vertexId;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    GPP::Real& coord = mVertexCoords.at(vertexId * 3 + axis);
+                    coord = (coord + mVertexCoords.at(otherVertexId * 3 + axis)) * 0.5;
+                }
+                for (GPP::Int fieldId = 0; fieldId < mFieldDim; fieldId++)
+                {
+                    GPP::Real& field = mVertexFields.at(vertexId * mFieldDim + fieldId);
+                    field = (field + mVertexFields.at(otherVertexId * mFieldDim + fieldId)) * 0.5;
+                }
+            }
+        }
+
+        // Drop the triangles collapsed by welding and the duplicated ones, then the unused vertices
+        GPP::Int triangleCount = mTriangleVertexIds.size() / 3;
+        std::vector<SortedTriangle> sortedTriangles;
+        sortedTriangles.reserve(triangleCount);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            SortedTriangle triangle;
+            for (int localId = 0; localId < 3; localId++)
+            {
+                triangle.mVertexIds[localId] = vertexMapIds.at(mTriangleVertexIds.at(fid * 3 + localId));
+                mTriangleVertexIds.at(fid * 3 + localId) = triangle.mVertexIds[localId];
+            }
+            std::sort(triangle.mVertexIds, triangle.mVertexIds + 3);
+            if (triangle.mVertexIds[0] == triangle.mVertexIds[1] || triangle.mVertexIds[1] == triangle.mVertexIds[2])
+            {
+                continue;
+            }
+            triangle.mTriangleId = fid;
+            sortedTriangles.push_back(triangle);
+        }
+        std::sort(sortedTriangles.begin(), sortedTriangles.end());
+        std::vector<bool> isTriangleKept(triangleCount, false);
+        GPP::Int sortedCount = sortedTriangles.size();
+        for (GPP::Int sortedId = 0; sortedId < sortedCount; sortedId++)
+        {
+            const SortedTriangle& triangle = sortedTriangles.at(sortedId);
+            if (sortedId > 0 && std::equal(triangle.mVertexIds, triangle.mVertexIds + 3, sortedTriangles.at(sortedId - 1).mVertexIds))
+            {
+                continue;
+            }
+            isTriangleKept.at(triangle.mTriangleId) = true;
+        }
+        std::vector<SortedTriangle>().swap(sortedTriangles);
+        // A triangle folded over the neighbor tile repeats a half edge, the one of the first tile is kept
+        std::vector<GPP::ULongInt> halfEdgeKeys;
+        std::vector<GPP::Int> halfEdgeTriangleIds;
+        CollectHalfEdges(isTriangleKept, halfEdgeKeys, halfEdgeTriangleIds);
+        GPP::Int halfEdgeCount = halfEdgeKeys.size();
+        GPP::Int foldTriangleCount = 0;
+        for (GPP::Int edgeId = 1; edgeId < halfEdgeCount; edgeId++)
+        {
+            if (halfEdgeKeys.at(edgeId) == halfEdgeKeys.at(edgeId - 1) && isTriangleKept.at(halfEdgeTriangleIds.at(edgeId)))
+            {
+                isTriangleKept.at(halfEdgeTriangleIds.at(edgeId)) = false;
+                foldTriangleCount++;
+            }
+        }
+        std::vector<bool> isSeamVertex(vertexCount, false);
+        for (std::vector<GPP::Int>::iterator itr = mSeamVertexIds.begin(); itr != mSeamVertexIds.end(); ++itr)
+        {
+            isSeamVertex.at(*itr) = true;
+        }
+        GPP::Int zipTriangleCount = ZipSeamLoops(isTriangleKept, isSeamVertex);
+        triangleCount = isTriangleKept.size();
+        std::vector<GPP::Int> vertexNewIds(vertexCount, -1);
+        GPP::Int newVertexCount = 0;
+        GPP::Int newTriangleCount = 0;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            if (!isTriangleKept.at(fid))
+            {
+                continue;
+            }
+            for (int localId = 0; localId < 3; localId++)
+            {
+                GPP::Int vertexId = mTriangleVertexIds.at(fid * 3 + localId);
+                if (vertexNewIds.at(vertexId) < 0)
+                {
+                    vertexNewIds.at(vertexId) = newVertexCount;
+                    newVertexCount++;
+                }
+                mTriangleVertexIds.at(newTriangleCount * 3 + localId) = vertexNewIds.at(vertexId);
+            }
+            newTriangleCount++;
+        }
+        mTriangleVertexIds.resize(newTriangleCount * 3);
+        std::vector<GPP::Real> newVertexCoords(newVertexCount * 3);
+        std::vector<GPP::Real> newVertexFields(newVertexCount * mFieldDim);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            GPP::Int newId = vertexNewIds.at(vid);
+            if (newId < 0)
+            {
+                continue;
+            }
+            std::copy(mVertexCoords.begin() + vid * 3, mVertexCoords.begin() + vid * 3 + 3, newVertexCoords.begin() + newId * 3);
+            if (mFieldDim > 0)
+            {
+                std::copy(mVertexFields.begin() + vid * mFieldDim, mVertexFields.begin() + (vid + 1) * mFieldDim,
+                    newVertexFields.begin() + newId * mFieldDim);
+            }
+        }
+        mVertexCoords.swap(newVertexCoords);
+        mVertexFields.swap(newVertexFields);
+        InfoLog << "TiledReconstructor: " << seamVertexCount << " seam vertices, " << foldTriangleCount << " folded triangles removed, "
+            << zipTriangleCount << " triangles zipped" << std::endl;
+    }
+
+    void TiledReconstructor::CollectHalfEdges(const std::vector<bool>& isTriangleKept, std::vector<GPP::ULongInt>& halfEdgeKeys,
+        std::vector<GPP::Int>& halfEdgeTriangleIds) const
+    {
+        // Keys are (from vertex, to vertex), sorted by key and then by triangle id
+        GPP::Int triangleCount = isTriangleKept.size();
+        std::vector<std::pair<GPP::ULongInt, GPP::Int> > halfEdges;
+        halfEdges.reserve(triangleCount * 3);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            if (!isTriangleKept.at(fid))
+            {
+                continue;
+            }
+            for (int localId = 0; localId < 3; localId++)
+            {
+                GPP::ULongInt fromId = mTriangleVertexIds.at(fid * 3 + localId);
+                GPP::ULongInt toId = mTriangleVertexIds.at(fid * 3 + (localId + 1) % 3);
+                halfEdges.push_back(std::make_pair((fromId << 32) | toId, fid));
+            }
+        }
+        std::sort(halfEdges.begin(), halfEdges.end());
+        GPP::Int halfEdgeCount = halfEdges.size();
+        halfEdgeKeys.resize(halfEdgeCount);
+        halfEdgeTriangleIds.resize(halfEdgeCount);
+        for (GPP::Int edgeId = 0; edgeId < halfEdgeCount; edgeId++)
+        {
+            halfEdgeKeys.at(edgeId) = halfEdges.at(edgeId).first;
+            halfEdgeTriangleIds.at(edgeId) = halfEdges.at(edgeId).second;
+        }
+    }
+
+    GPP::Int TiledReconstructor::ZipSeamLoops(std::vector<bool>& isTriangleKept, const std::vector<bool>& isSeamVertex)
+    {
+        std::vector<GPP::ULongInt> halfEdgeKeys;
+        std::vector<GPP::Int> halfEdgeTriangleIds;
+        CollectHalfEdges(isTriangleKept, halfEdgeKeys, halfEdgeTriangleIds);
+        std::vector<GPP::ULongInt> boundaryKeys;
+        for (std::vector<GPP::ULongInt>::iterator itr = halfEdgeKeys.begin(); itr != halfEdgeKeys.end(); ++itr)
+        {
+            GPP::ULongInt oppositeKey = ((*itr) << 32) | ((*itr) >> 32);
+            if (!std::binary_search(halfEdgeKeys.begin(), halfEdgeKeys.end(), oppositeKey))
+            {
+                boundaryKeys.push_back(*itr);
+            }
+        }
+        boundaryKeys.erase(std::unique(boundaryKeys.begin(), boundaryKeys.end()), boundaryKeys.end());
+
+        // The gaps left along the seams are boundary loops with only seam vertices, real holes of the scan have other vertices.
+        // Welded vertices pinch the gaps, so the next boundary edge is found by turning around the vertex fan
+        GPP::Int boundaryCount = boundaryKeys.size();
+        std::vector<bool> isBoundaryVisited(boundaryCount, false);
+        GPP::Int triangleStart = mTriangleVertexIds.size() / 3;
+        std::vector<GPP::Int> loopVertexIds;
+        std::map<GPP::Int, GPP::Int> loopPositions;
+        for (GPP::Int startEdgeId = 0; startEdgeId < boundaryCount; startEdgeId++)
+        {
+            if (isBoundaryVisited.at(startEdgeId))
+            {
+                continue;
+            }
+            loopVertexIds.clear();
+            loopPositions.clear();
+            GPP::Int startVertexId = GPP::Int(boundaryKeys.at(startEdgeId) >> 32);
+            GPP::Int edgeId = startEdgeId;
+            bool isClosed = false;
+            while (edgeId >= 0 && !isBoundaryVisited.at(edgeId))
+            {
+                isBoundaryVisited.at(edgeId) = true;
+                GPP::Int fromId = GPP::Int(boundaryKeys.at(edgeId) >> 32);
+                GPP::Int toId = GPP::Int(boundaryKeys.at(edgeId) & 0xFFFFFFFF);
+                std::map<GPP::Int, GPP::Int>::iterator positionItr = loopPositions.find(fromId);
+                if (positionItr != loopPositions.end())
+                {
+                    // The loop touched itself, cut the closed part out
+                    std::vector<GPP::Int> subLoopVertexIds(loopVertexIds.begin() + positionItr->second, loopVertexIds.end());
+                    for (std::vector<GPP::Int>::iterator itr = subLoopVertexIds.begin() + 1; itr != subLoopVertexIds.end(); ++itr)
+                    {
+                        loopPositions.erase(*itr);
+                    }
+                    loopVertexIds.resize(positionItr->second);
+                    ZipLoop(subLoopVertexIds, isSeamVertex);
+                }
+                loopPositions[fromId] = loopVertexIds.size();
+                loopVertexIds.push_back(fromId);
+                if (toId == startVertexId)
+                {
+                    isClosed = true;
+                    break;
+                }
+                edgeId = FindNextBoundaryEdge(fromId, toId, halfEdgeKeys, halfEdgeTriangleIds, boundaryKeys);
+            }
+            if (isClosed)
+            {
+                ZipLoop(loopVertexIds, isSeamVertex);
+            }
+        }
+        GPP::Int zipTriangleCount = mTriangleVertexIds.size() / 3 - triangleStart;
+        isTriangleKept.resize(isTriangleKept.size() + zipTriangleCount, true);
+        return zipTriangleCount;
+    }
+
+    GPP::Int TiledReconstructor::FindNextBoundaryEdge(GPP::Int fromId, GPP::Int toId, const std::vector<GPP::ULongInt>& halfEdgeKeys,
+        const std::vector<GPP::Int>& halfEdgeTriangleIds, const std::vector<GPP::ULongInt>& boundaryKeys) const
+    {
+        GPP::ULongInt edgeKey = (GPP::ULongInt(fromId) << 32) | GPP::ULongInt(toId);
+        for (GPP::Int turnCount = 0; turnCount < MAX_FAN_TURN_COUNT; turnCount++)
+        {
+            std::vector<GPP::ULongInt>::const_iterator edgeItr = std::lower_bound(halfEdgeKeys.begin(), halfEdgeKeys.end(), edgeKey);
+            if (edgeItr == halfEdgeKeys.end() || *edgeItr != edgeKey)
+            {
+                return -1;
+            }
+            // The edge leaving toId in the same triangle
+            const GPP::Int* vertexIds = &(mTriangleVertexIds.at(halfEdgeTriangleIds.at(edgeItr - halfEdgeKeys.begin()) * 3));
+            GPP::Int localId = vertexIds[0] == toId ? 0 : (vertexIds[1] == toId ? 1 : 2);
+            GPP::ULongInt outKey = (GPP::ULongInt(toId) << 32) | GPP::ULongInt(vertexIds[(localId + 1) % 3]);
+            std::vector<GPP::ULongInt>::const_iterator boundaryItr = std::lower_bound(boundaryKeys.begin(), boundaryKeys.end(), outKey);
+            if (boundaryItr != boundaryKeys.end() && *boundaryItr == outKey)
+            {
+                return GPP::Int(boundaryItr - boundaryKeys.begin());
+            }
+            edgeKey = (outKey << 32) | (outKey >> 32);
+        }
+        return -1;
+    }
+
+    void TiledReconstructor::ZipLoop(const std::vector<GPP::Int>& loopVertexIds, const std::vector<bool>& isSeamVertex)
+    {
+        if (loopVertexIds.size() < 3)
+        {
+            return;
+        }
+        for (std::vector<GPP::Int>::const_iterator itr = loopVertexIds.begin(); itr != loopVertexIds.end(); ++itr)
+        {
+            if (!isSeamVertex.at(*itr))
+            {
+                return;
+            }
+        }
+        FillLoopByEars(loopVertexIds);
+    }
+
+    void TiledReconstructor::FillLoopByEars(const std::vector<GPP::Int>& loopVertexIds)
+    {
+        // Cut the ear with the shortest new edge first, which zips a thin gap from side to side
+        GPP::Int loopSize = loopVertexIds.size();
+        std::vector<GPP::Int> prevIds(loopSize);
+        std::vector<GPP::Int> nextIds(loopSize);
+        std::vector<GPP::Int> earVersions(loopSize, 0);
+        std::priority_queue<EarCandidate> earQueue;
+        for (GPP::Int loopId = 0; loopId < loopSize; loopId++)
+        {
+            prevIds.at(loopId) = (loopId + loopSize - 1) % loopSize;
+            nextIds.at(loopId) = (loopId + 1) % loopSize;
+        }
+        for (GPP::Int loopId = 0; loopId < loopSize; loopId++)
+        {
+            EarCandidate ear = {GetEarLength(loopVertexIds.at(prevIds.at(loopId)), loopVertexIds.at(nextIds.at(loopId))), loopId, 0};
+            earQueue.push(ear);
+        }
+        GPP::Int remainCount = loopSize;
+        while (remainCount >= 3 && !earQueue.empty())
+        {
+            EarCandidate ear = earQueue.top();
+            earQueue.pop();
+            if (ear.mVersion != earVersions.at(ear.mLoopId))
+            {
+                continue;
+            }
+            GPP::Int prevId = prevIds.at(ear.mLoopId);
+            GPP::Int nextId = nextIds.at(ear.mLoopId);
+            // The loop follows the boundary half edges, so the new triangle runs against them
+            mTriangleVertexIds.push_back(loopVertexIds.at(nextId));
+            mTriangleVertexIds.push_back(loopVertexIds.at(ear.mLoopId));
+            mTriangleVertexIds.push_back(loopVertexIds.at(prevId));
+            earVersions.at(ear.mLoopId) = -1;
+            nextIds.at(prevId) = nextId;
+            prevIds.at(nextId) = prevId;
+            remainCount--;
+            if (remainCount < 3)
+            {
+                break;
+            }
+            GPP::Int updateIds[2] = {prevId, nextId};
+            for (int localId = 0; localId < 2; localId++)
+            {
+                GPP::Int loopId = updateIds[localId];
+                earVersions.at(loopId)++;
+                EarCandidate updateEar = {GetEarLength(loopVertexIds.at(prevIds.at(loopId)), loopVertexIds.at(nextIds.at(loopId))),
+                    loopId, earVersions.at(loopId)};
+                earQueue.push(updateEar);
+            }
+        }
+    }
+
+    GPP::Real TiledReconstructor::GetEarLength(GPP::Int vertexId0, GPP::Int vertexId1) const
+    {
+        GPP::Real lengthSquared = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real delta = mVertexCoords.at(vertexId0 * 3 + axis) - mVertexCoords.at(vertexId1 * 3 + axis);
+            lengthSquared += delta * delta;
+        }
+        return lengthSquared;
+    }
+
+    GPP::ErrorCode TiledReconstructor::FillHoles(GPP::TriMesh* triMesh, std::vector<GPP::Real>* vertexFields) const
+    {
+        std::vector<std::vector<GPP::Int> > holeLoops;
+        GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(triMesh, &holeLoops);
+        if (res != GPP_NO_ERROR || holeLoops.empty())
+        {
+            return res;
+        }
+        GPP::Real meshArea = 0;
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Vector3 coord0 = triMesh->GetVertexCoord(vertexIds[0]);
+            meshArea += ((triMesh->GetVertexCoord(vertexIds[1]) - coord0).CrossProduct(triMesh->GetVertexCoord(vertexIds[2]) - coord0)).Length() * 0.5;
+        }
+        // Same limit as ReconstructMesh's maxHoleAreaRatio, with the hole area estimated from its perimeter
+        std::vector<GPP::Int> holeSeeds;
+        for (std::vector<std::vector<GPP::Int> >::iterator loopItr = holeLoops.begin(); loopItr != holeLoops.end(); ++loopItr)
+        {
+            GPP::Int loopSize = loopItr->size();
+            if (loopSize < 3)
+            {
+                continue;
+            }
+            GPP::Real perimeter = 0;
+            for (GPP::Int localId = 0; localId < loopSize; localId++)
+            {
+                perimeter += (triMesh->GetVertexCoord(loopItr->at((localId + 1) % loopSize)) - triMesh->GetVertexCoord(loopItr->at(localId))).Length();
+            }
+            if (perimeter * perimeter / (4.0 * ONE_PI) <= mMaxHoleAreaRatio * meshArea)
+            {
+                holeSeeds.push_back(loopItr->at(0));
+            }
+        }
+        if (holeSeeds.empty())
+        {
+            return GPP_NO_ERROR;
+        }
+        if (vertexFields == NULL)
+        {
+            return GPP::FillMeshHole::FillHoles(triMesh, &holeSeeds, GPP::FILL_MESH_HOLE_FLAT, NULL, NULL);
+        }
+        std::vector<GPP::Real> insertedFields;
+        res = GPP::FillMeshHole::FillHoles(triMesh, &holeSeeds, GPP::FILL_MESH_HOLE_FLAT, vertexFields, &insertedFields);
+        if (res == GPP_NO_ERROR)
+        {
+            vertexFields->insert(vertexFields->end(), insertedFields.begin(), insertedFields.end());
+            vertexFields->resize(triMesh->GetVertexCount() * mFieldDim, 0);
+        }
+        return res;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Reconstructs a large point cloud with one GPP::ReconstructMesh per spatial tile instead of one octree for the whole cloud.
+    // The cloud is split into kd tiles of at most maxTilePointCount points. Every tile is reconstructed from its points plus
+    // an overlap margin, and tiles run concurrently in batches sized by the memory budget, so peak memory depends on the
+    // tile size and not on the cloud size. Each tile mesh is trimmed to its core (the tile without margin) by triangle centroid,
+    // and every boundary vertex along a seam is welded to its mutual nearest boundary vertex of another tile.
+    // The gaps left between the welded pairs are zipped by ear clipping, and holes are filled after stitching when needFillHole is set.
+    // USAGE: 1. TiledReconstructor tiledReconstructor(quality, needFillHole, maxHoleAreaRatio);
+    //        2. tiledReconstructor.Reconstruct(pointCloud, &pointFields, 3, triMesh, &vertexFields, &progress);
+    class TiledReconstructor
+    {
+    public:
+        TiledReconstructor(GPP::Int quality, bool needFillHole, GPP::Real maxHoleAreaRatio);
+        ~TiledReconstructor();
+
+        // Tiles are split until they have at most maxTilePointCount points. Default is 2000000
+        void SetMaxTilePointCount(GPP::Int maxTilePointCount);
+        // Margin of a tile as a ratio of its longest core edge. Default is 0.1
+        void SetOverlapRatio(GPP::Real overlapRatio);
+        // Estimated peak memory of the concurrent tiles, it bounds the tiles reconstructed at the same time. Default is 4GB
+        void SetMemoryBudget(GPP::ULongInt memoryByteCount);
+
+        // pointCloud should have normals, triMesh should be blank. pointFields has fieldDim values per point, it can be NULL,
+        // then vertexFields is ignored. progress (can be NULL) is set to the finished tile ratio after every batch of concurrent tiles,
+        // by the calling thread only
+        GPP::ErrorCode Reconstruct(const GPP::IPointCloud* pointCloud, const std::vector<GPP::Real>* pointFields, GPP::Int fieldDim,
+            GPP::TriMesh* triMesh, std::vector<GPP::Real>* vertexFields, double* progress = NULL);
+
+        GPP::Int GetTileCount(void) const;
+        GPP::Int GetConcurrentTileCount(void) const;
+        double GetReconstructTime(void) const;
+
+    private:
+        struct TileNode
+        {
+            GPP::Vector3 mCoreMin;
+            GPP::Vector3 mCoreMax;
+            // Range of mPointOrder
+            GPP::Int mPointStart;
+            GPP::Int mPointEnd;
+            // -1 for tiles
+            GPP::Int mChildIds[2];
+        };
+
+        struct TileResult
+        {
+            std::vector<GPP::Real> mVertexCoords;
+            std::vector<GPP::Real> mVertexFields;
+            std::vector<GPP::Int> mTriangleVertexIds;
+            // Trimmed boundary vertices near an inner core face
+            std::vector<GPP::Int> mSeamVertexIds;
+            GPP::Real mBoundaryEdgeLength;
+            GPP::Int mBoundaryEdgeCount;
+            GPP::ErrorCode mResult;
+        };
+
+        TiledReconstructor(const TiledReconstructor&);
+        TiledReconstructor& operator = (const TiledReconstructor&);
+        void SplitTiles(void);
+        void CollectTilePoints(GPP::Int tileId, std::vector<GPP::Int>& pointIds) const;
+        void ReconstructTile(GPP::Int tileId, GPP::Int slotId);
+        void TrimTile(GPP::Int tileId, const GPP::TriMesh* tileMesh, const std::vector<GPP::Real>& tileFields, TileResult& tileResult) const;
+        void StitchSeams(void);
+        void CollectHalfEdges(const std::vector<bool>& isTriangleKept, std::vector<GPP::ULongInt>& halfEdgeKeys,
+            std::vector<GPP::Int>& halfEdgeTriangleIds) const;
+        // Return the triangle count added to the gaps between the seams
+        GPP::Int ZipSeamLoops(std::vector<bool>& isTriangleKept, const std::vector<bool>& isSeamVertex);
+        // -1 if the boundary edge after (fromId, toId) is not found
+        GPP::Int FindNextBoundaryEdge(GPP::Int fromId, GPP::Int toId, const std::vector<GPP::ULongInt>& halfEdgeKeys,
+            const std::vector<GPP::Int>& halfEdgeTriangleIds, const std::vector<GPP::ULongInt>& boundaryKeys) const;
+        // Fill the loop if every vertex is a seam vertex
+        void ZipLoop(const std::vector<GPP::Int>& loopVertexIds, const std::vector<bool>& isSeamVertex);
+        void FillLoopByEars(const std::vector<GPP::Int>& loopVertexIds);
+        GPP::Real GetEarLength(GPP::Int vertexId0, GPP::Int vertexId1) const;
+        GPP::ErrorCode FillHoles(GPP::TriMesh* triMesh, std::vector<GPP::Real>* vertexFields) const;
+        friend class ReconstructTileTask;
+
+    private:
+        GPP::Int mQuality;
+        bool mNeedFillHole;
+        GPP::Real mMaxHoleAreaRatio;
+        GPP::Int mMaxTilePointCount;
+        GPP::Real mOverlapRatio;
+        GPP::ULongInt mMemoryByteCount;
+        const GPP::IPointCloud* mpPointCloud;
+        const std::vector<GPP::Real>* mpPointFields;
+        GPP::Int mFieldDim;
+        std::vector<GPP::Int> mPointOrder;
+        std::vector<TileNode> mNodes;
+        std::vector<GPP::Int> mTileNodeIds;
+        GPP::Vector3 mBBoxMin;
+        GPP::Vector3 mBBoxMax;
+        GPP::Int mConcurrentTileCount;
+        std::vector<TileResult> mBatchResults;
+        // Stitched mesh, 3 coordinates and 3 vertex ids per element
+        std::vector<GPP::Real> mVertexCoords;
+        std::vector<GPP::Real> mVertexFields;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        std::vector<GPP::Int> mSeamVertexIds;
+        std::vector<GPP::Int> mSeamTileIds;
+        GPP::Real mBoundaryEdgeLength;
+        GPP::Int mBoundaryEdgeCount;
+        double mReconstructTime;
+    };
+}
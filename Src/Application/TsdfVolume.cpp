@@ -0,0 +1,687 @@
+#include "TsdfVolume.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <algorithm>
+#include <math.h>
+
+namespace MagicApp
+{
+    static const GPP::Int BLOCK_EDGE_BITS = IDistanceVolume::BLOCK_EDGE_BITS;
+    static const GPP::Int BLOCK_EDGE = 1 << BLOCK_EDGE_BITS;
+    static const GPP::Int BLOCK_EDGE_MASK = BLOCK_EDGE - 1;
+    static const GPP::Int BLOCK_VOXEL_COUNT = BLOCK_EDGE * BLOCK_EDGE * BLOCK_EDGE;
+    static const GPP::Int BLOCK_AXIS_BITS = 21;
+    static const GPP::Int BLOCK_AXIS_OFFSET = 1 << (BLOCK_AXIS_BITS - 1);
+    static const GPP::ULongInt BLOCK_AXIS_MASK = (GPP::ULongInt(1) << BLOCK_AXIS_BITS) - 1;
+    static const GPP::ULongInt EMPTY_SLOT_KEY = ~GPP::ULongInt(0);
+    static const GPP::Int MIN_SLOT_BITS = 10;
+    // Samples per voxel along the truncation band, so a voxel crossed near its corner is not skipped
+    static const GPP::Real SAMPLE_STEP_RATIO = 0.5;
+    static const GPP::Real DEFAULT_MAX_WEIGHT = 64.0;
+    // Weights below it are dropped by the decay and ignored by the extraction
+    static const float MIN_VOXEL_WEIGHT = 0.05f;
+
+    struct TsdfVoxel
+    {
+        // Signed distance divided by the truncation, positive in front of the surface
+        float mDistance;
+        float mWeight;
+    };
+
+    struct TsdfBlock
+    {
+        GPP::ULongInt mKey;
+        GPP::Int mCoord[3];
+        TsdfVoxel mVoxels[BLOCK_VOXEL_COUNT];
+    };
+
+    static GPP::ULongInt PackBlockKey(const GPP::Int blockCoord[3])
+    {
+        return GPP::ULongInt(blockCoord[0] + BLOCK_AXIS_OFFSET) | (GPP::ULongInt(blockCoord[1] + BLOCK_AXIS_OFFSET) << BLOCK_AXIS_BITS) |
+            (GPP::ULongInt(blockCoord[2] + BLOCK_AXIS_OFFSET) << (BLOCK_AXIS_BITS * 2));
+    }
+
+    static void UnpackBlockKey(GPP::ULongInt blockKey, GPP::Int blockCoord[3])
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            blockCoord[axis] = GPP::Int((blockKey >> (BLOCK_AXIS_BITS * axis)) & BLOCK_AXIS_MASK) - BLOCK_AXIS_OFFSET;
+        }
+    }
+
+    static GPP::Int HashBlockKey(GPP::ULongInt blockKey, GPP::Int slotBits)
+    {
+        return GPP::Int((blockKey * 0x9E3779B97F4A7C15ULL) >> (64 - slotBits));
+    }
+
+    static GPP::Int GetLocalVoxelId(const GPP::Int voxel[3])
+    {
+        return (voxel[0] & BLOCK_EDGE_MASK) | ((voxel[1] & BLOCK_EDGE_MASK) << BLOCK_EDGE_BITS) |
+            ((voxel[2] & BLOCK_EDGE_MASK) << (BLOCK_EDGE_BITS * 2));
+    }
+
+    static GPP::ULongInt GetVoxelBlockKey(const GPP::Int voxel[3])
+    {
+        // Arithmetic shift rounds negative voxels down, like floor
+        GPP::Int blockCoord[3] = {voxel[0] >> BLOCK_EDGE_BITS, voxel[1] >> BLOCK_EDGE_BITS, voxel[2] >> BLOCK_EDGE_BITS};
+        return PackBlockKey(blockCoord);
+    }
+
+    class FramePointTask : public MagicCore::ParallelTask
+    {
+    public:
+        FramePointTask(TsdfVolume* tsdfVolume, const GPP::IPointCloud* pointCloud, const GPP::Matrix4x4* transform) :
+            mpTsdfVolume(tsdfVolume),
+            mpPointCloud(pointCloud),
+            mpTransform(transform),
+            mHasNormal(pointCloud->HasNormal())
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::Vector3 coord = mpPointCloud->GetPointCoord(pid);
+                GPP::Vector3 direction = mHasNormal ? mpPointCloud->GetPointNormal(pid) : mpTsdfVolume->mSensorOrigin - coord;
+                if (mpTransform)
+                {
+                    coord = mpTransform->TransformPoint(coord);
+                    direction = mpTransform->RotateVector(direction);
+                }
+                // A zero direction marks a point that can not be integrated
+                if (direction.Normalise() < GPP::REAL_TOL)
+                {
+                    direction = GPP::Vector3(0, 0, 0);
+                }
+                mpTsdfVolume->mFrameCoords.at(pid) = coord;
+                mpTsdfVolume->mFrameDirections.at(pid) = direction;
+            }
+        }
+
+    private:
+        TsdfVolume* mpTsdfVolume;
+        const GPP::IPointCloud* mpPointCloud;
+        const GPP::Matrix4x4* mpTransform;
+        bool mHasNormal;
+    };
+
+    class CollectBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        CollectBlockTask(const TsdfVolume* tsdfVolume, std::vector<std::vector<TsdfVolume::BlockPoint> >* threadBlockPoints) :
+            mpTsdfVolume(tsdfVolume),
+            mpThreadBlockPoints(threadBlockPoints)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            std::vector<TsdfVolume::BlockPoint>& blockPoints = mpThreadBlockPoints->at(threadId);
+            for (int pid = startId; pid < endId; pid++)
+            {
+                mpTsdfVolume->CollectPointBlocks(pid, blockPoints);
+            }
+        }
+
+    private:
+        const TsdfVolume* mpTsdfVolume;
+        std::vector<std::vector<TsdfVolume::BlockPoint> >* mpThreadBlockPoints;
+    };
+
+    class UpdateBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        UpdateBlockTask(TsdfVolume* tsdfVolume, const std::vector<TsdfVolume::BlockPoint>* blockPoints,
+            const std::vector<GPP::Int>* touchedBlockIds, const std::vector<GPP::Int>* touchedStart) :
+            mpTsdfVolume(tsdfVolume),
+            mpBlockPoints(blockPoints),
+            mpTouchedBlockIds(touchedBlockIds),
+            mpTouchedStart(touchedStart)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int touchedId = startId; touchedId < endId; touchedId++)
+            {
+                GPP::Int pointStart = mpTouchedStart->at(touchedId);
+                GPP::Int pointCount = mpTouchedStart->at(touchedId + 1) - pointStart;
+                mpTsdfVolume->UpdateBlock(mpTouchedBlockIds->at(touchedId), &(mpBlockPoints->at(pointStart)), pointCount);
+            }
+        }
+
+    private:
+        TsdfVolume* mpTsdfVolume;
+        const std::vector<TsdfVolume::BlockPoint>* mpBlockPoints;
+        const std::vector<GPP::Int>* mpTouchedBlockIds;
+        const std::vector<GPP::Int>* mpTouchedStart;
+    };
+
+    class ExtractBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        ExtractBlockTask(const TsdfVolume* tsdfVolume, std::vector<std::vector<GPP::Vector3> >* blockCoords,
+            std::vector<std::vector<GPP::Vector3> >* blockNormals) :
+            mpTsdfVolume(tsdfVolume),
+            mpBlockCoords(blockCoords),
+            mpBlockNormals(blockNormals)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                mpTsdfVolume->ExtractBlock(blockId, mpBlockCoords->at(blockId), mpBlockNormals->at(blockId));
+            }
+        }
+
+    private:
+        const TsdfVolume* mpTsdfVolume;
+        std::vector<std::vector<GPP::Vector3> >* mpBlockCoords;
+        std::vector<std::vector<GPP::Vector3> >* mpBlockNormals;
+    };
+
+    class DecayBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        DecayBlockTask(TsdfVolume* tsdfVolume, float weightDecay, std::vector<GPP::Int>* blockWeightCounts) :
+            mpTsdfVolume(tsdfVolume),
+            mWeightDecay(weightDecay),
+            mpBlockWeightCounts(blockWeightCounts)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                TsdfVoxel* voxels = mpTsdfVolume->mBlocks.at(blockId)->mVoxels;
+                GPP::Int weightCount = 0;
+                for (GPP::Int voxelId = 0; voxelId < BLOCK_VOXEL_COUNT; voxelId++)
+                {
+                    float weight = voxels[voxelId].mWeight * mWeightDecay;
+                    if (weight < MIN_VOXEL_WEIGHT)
+                    {
+                        weight = 0;
+                    }
+                    else
+                    {
+                        weightCount++;
+                    }
+                    voxels[voxelId].mWeight = weight;
+                }
+                mpBlockWeightCounts->at(blockId) = weightCount;
+            }
+        }
+
+    private:
+        TsdfVolume* mpTsdfVolume;
+        float mWeightDecay;
+        std::vector<GPP::Int>* mpBlockWeightCounts;
+    };
+
+    TsdfVolume::TsdfVolume(GPP::Real voxelSize, GPP::Real truncation) :
+        mVoxelSize(voxelSize),
+        mTruncation(truncation < voxelSize ? voxelSize : truncation),
+        mSampleCount(0),
+        mSensorOrigin(0, 0, 0),
+        mMaxWeight(DEFAULT_MAX_WEIGHT),
+        mWeightDecay(1.0),
+        mBlocks(),
+        mSlotKeys(),
+        mSlotBlockIds(),
+        mSlotBits(0),
+        mFrameCoords(),
+        mFrameDirections(),
+        mFrameCount(0),
+        mIntegrateTime(0)
+    {
+        mSampleCount = GPP::Int(2.0 * mTruncation / (mVoxelSize * SAMPLE_STEP_RATIO)) + 1;
+        RebuildSlots(MIN_SLOT_BITS);
+    }
+
+    TsdfVolume::~TsdfVolume()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode TsdfVolume::Integrate(const GPP::IPointCloud* pointCloud, const GPP::Matrix4x4* transform)
+    {
+        if (pointCloud == NULL || pointCloud->GetPointCount() == 0 || mVoxelSize <= 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        double startTime = MagicCore::ToolKit::GetTime();
+        if (mWeightDecay < 1.0 && !mBlocks.empty())
+        {
+            DecayWeights(mWeightDecay);
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        mFrameCoords.resize(pointCount);
+        mFrameDirections.resize(pointCount);
+        FramePointTask frameTask(this, pointCloud, transform);
+        MagicCore::ParallelTool::ParallelFor(pointCount, &frameTask);
+
+        // Pass 1: blocks touched by every point, sorted so that the points of a block are together
+        std::vector<std::vector<BlockPoint> > threadBlockPoints(MagicCore::ParallelTool::GetThreadCount());
+        CollectBlockTask collectTask(this, &threadBlockPoints);
+        MagicCore::ParallelTool::ParallelFor(pointCount, &collectTask);
+        std::vector<BlockPoint> blockPoints;
+        GPP::Int blockPointCount = 0;
+        for (std::vector<std::vector<BlockPoint> >::iterator itr = threadBlockPoints.begin(); itr != threadBlockPoints.end(); ++itr)
+        {
+            blockPointCount += itr->size();
+        }
+        blockPoints.reserve(blockPointCount);
+        for (std::vector<std::vector<BlockPoint> >::iterator itr = threadBlockPoints.begin(); itr != threadBlockPoints.end(); ++itr)
+        {
+            blockPoints.insert(blockPoints.end(), itr->begin(), itr->end());
+            std::vector<BlockPoint>().swap(*itr);
+        }
+        std::sort(blockPoints.begin(), blockPoints.end());
+
+        // Allocate the new blocks in key order, so block ids do not depend on the thread count
+        std::vector<GPP::Int> touchedBlockIds;
+        std::vector<GPP::Int> touchedStart;
+        for (GPP::Int bpid = 0; bpid < blockPointCount; bpid++)
+        {
+            if (bpid > 0 && blockPoints.at(bpid).mBlockKey == blockPoints.at(bpid - 1).mBlockKey)
+            {
+                continue;
+            }
+            GPP::ULongInt blockKey = blockPoints.at(bpid).mBlockKey;
+            GPP::Int blockId = FindBlock(blockKey);
+            if (blockId < 0)
+            {
+                blockId = InsertBlock(blockKey);
+            }
+            touchedBlockIds.push_back(blockId);
+            touchedStart.push_back(bpid);
+        }
+        touchedStart.push_back(blockPointCount);
+
+        // Pass 2: every touched block is updated by one thread
+        UpdateBlockTask updateTask(this, &blockPoints, &touchedBlockIds, &touchedStart);
+        MagicCore::ParallelTool::ParallelFor(touchedBlockIds.size(), &updateTask);
+        std::vector<GPP::Vector3>().swap(mFrameCoords);
+        std::vector<GPP::Vector3>().swap(mFrameDirections);
+        mFrameCount++;
+        mIntegrateTime += MagicCore::ToolKit::GetTime() - startTime;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode TsdfVolume::ExtractPointCloud(GPP::IPointCloud* pointCloud) const
+    {
+        if (pointCloud == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int blockCount = mBlocks.size();
+        std::vector<std::vector<GPP::Vector3> > blockCoords(blockCount);
+        std::vector<std::vector<GPP::Vector3> > blockNormals(blockCount);
+        ExtractBlockTask extractTask(this, &blockCoords, &blockNormals);
+        MagicCore::ParallelTool::ParallelFor(blockCount, &extractTask);
+        pointCloud->Clear();
+        pointCloud->SetHasNormal(true);
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            const std::vector<GPP::Vector3>& coords = blockCoords.at(blockId);
+            const std::vector<GPP::Vector3>& normals = blockNormals.at(blockId);
+            GPP::Int coordCount = coords.size();
+            for (GPP::Int cid = 0; cid < coordCount; cid++)
+            {
+                pointCloud->InsertPoint(coords.at(cid), normals.at(cid));
+            }
+            std::vector<GPP::Vector3>().swap(blockCoords.at(blockId));
+            std::vector<GPP::Vector3>().swap(blockNormals.at(blockId));
+        }
+        if (pointCloud->GetPointCount() == 0)
+        {
+            return GPP_INVALID_RESULT;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void TsdfVolume::Clear(void)
+    {
+        for (std::vector<TsdfBlock*>::iterator itr = mBlocks.begin(); itr != mBlocks.end(); ++itr)
+        {
+            GPPFREEPOINTER(*itr);
+        }
+        mBlocks.clear();
+        RebuildSlots(MIN_SLOT_BITS);
+        mFrameCount = 0;
+        mIntegrateTime = 0;
+    }
+
+    void TsdfVolume::SetSensorOrigin(const GPP::Vector3& sensorOrigin)
+    {
+        mSensorOrigin = sensorOrigin;
+    }
+
+    void TsdfVolume::SetMaxWeight(GPP::Real maxWeight)
+    {
+        mMaxWeight = maxWeight < 1.0 ? 1.0 : maxWeight;
+    }
+
+    void TsdfVolume::SetWeightDecay(GPP::Real weightDecay)
+    {
+        mWeightDecay = weightDecay > 1.0 ? 1.0 : (weightDecay < 0 ? 0 : weightDecay);
+    }
+
+    void TsdfVolume::DecayWeights(GPP::Real weightDecay)
+    {
+        GPP::Int blockCount = mBlocks.size();
+        std::vector<GPP::Int> blockWeightCounts(blockCount, 0);
+        DecayBlockTask decayTask(this, float(weightDecay), &blockWeightCounts);
+        MagicCore::ParallelTool::ParallelFor(blockCount, &decayTask);
+        GPP::Int keepCount = 0;
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            if (blockWeightCounts.at(blockId) == 0)
+            {
+                GPPFREEPOINTER(mBlocks.at(blockId));
+            }
+            else
+            {
+                mBlocks.at(keepCount) = mBlocks.at(blockId);
+                keepCount++;
+            }
+        }
+        if (keepCount < blockCount)
+        {
+            mBlocks.resize(keepCount);
+            // Shrink the table back to between a quarter and a half full
+            GPP::Int slotBits = MIN_SLOT_BITS;
+            while ((keepCount + 1) * 4 > (1 << slotBits))
+            {
+                slotBits++;
+            }
+            RebuildSlots(slotBits);
+        }
+    }
+
+    GPP::Int TsdfVolume::GetBlockCount(void) const
+    {
+        return mBlocks.size();
+    }
+
+    GPP::ULongInt TsdfVolume::GetMemoryByteCount(void) const
+    {
+        return GPP::ULongInt(mBlocks.size()) * (sizeof(TsdfBlock) + sizeof(TsdfBlock*)) +
+            GPP::ULongInt(mSlotKeys.size()) * (sizeof(GPP::ULongInt) + sizeof(GPP::Int));
+    }
+
+    GPP::Int TsdfVolume::GetFrameCount(void) const
+    {
+        return mFrameCount;
+    }
+
+    double TsdfVolume::GetIntegrateTime(void) const
+    {
+        return mIntegrateTime;
+    }
+
+    void TsdfVolume::GetBlockCoord(GPP::Int blockId, GPP::Int blockCoord[3]) const
+    {
+        const TsdfBlock* block = mBlocks.at(blockId);
+        blockCoord[0] = block->mCoord[0];
+        blockCoord[1] = block->mCoord[1];
+        blockCoord[2] = block->mCoord[2];
+    }
+
+    GPP::Int TsdfVolume::FindBlockId(const GPP::Int blockCoord[3]) const
+    {
+        return FindBlock(PackBlockKey(blockCoord));
+    }
+
+    GPP::Vector3 TsdfVolume::GetVoxelCoord(const GPP::Int voxel[3]) const
+    {
+        return GPP::Vector3((voxel[0] + 0.5) * mVoxelSize, (voxel[1] + 0.5) * mVoxelSize, (voxel[2] + 0.5) * mVoxelSize);
+    }
+
+    void TsdfVolume::GetSampleVoxel(const GPP::Vector3& coord, const GPP::Vector3& direction, GPP::Int sampleId, GPP::Int voxel[3]) const
+    {
+        GPP::Real offset = -mTruncation + sampleId * mVoxelSize * SAMPLE_STEP_RATIO;
+        GPP::Vector3 sampleCoord = coord + direction * offset;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            voxel[axis] = GPP::Int(floor(sampleCoord[axis] / mVoxelSize));
+        }
+    }
+
+    void TsdfVolume::CollectPointBlocks(GPP::Int pointId, std::vector<BlockPoint>& blockPoints) const
+    {
+        const GPP::Vector3& direction = mFrameDirections.at(pointId);
+        if (direction[0] == 0 && direction[1] == 0 && direction[2] == 0)
+        {
+            return;
+        }
+        const GPP::Vector3& coord = mFrameCoords.at(pointId);
+        // The samples are on a line, so a block is never entered twice
+        GPP::ULongInt lastBlockKey = EMPTY_SLOT_KEY;
+        GPP::Int voxel[3];
+        for (GPP::Int sampleId = 0; sampleId < mSampleCount; sampleId++)
+        {
+            GetSampleVoxel(coord, direction, sampleId, voxel);
+            GPP::ULongInt blockKey = GetVoxelBlockKey(voxel);
+            if (blockKey != lastBlockKey)
+            {
+                BlockPoint blockPoint;
+                blockPoint.mBlockKey = blockKey;
+                blockPoint.mPointId = pointId;
+                blockPoints.push_back(blockPoint);
+                lastBlockKey = blockKey;
+            }
+        }
+    }
+
+    void TsdfVolume::UpdateBlock(GPP::Int blockId, const BlockPoint* blockPoints, GPP::Int pointCount)
+    {
+        TsdfBlock* block = mBlocks.at(blockId);
+        float maxWeight = float(mMaxWeight);
+        for (GPP::Int bpid = 0; bpid < pointCount; bpid++)
+        {
+            GPP::Int pointId = blockPoints[bpid].mPointId;
+            const GPP::Vector3& coord = mFrameCoords.at(pointId);
+            const GPP::Vector3& direction = mFrameDirections.at(pointId);
+            GPP::Int lastVoxel[3] = {0, 0, 0};
+            bool hasLastVoxel = false;
+            GPP::Int voxel[3];
+            for (GPP::Int sampleId = 0; sampleId < mSampleCount; sampleId++)
+            {
+                GetSampleVoxel(coord, direction, sampleId, voxel);
+                if (hasLastVoxel && voxel[0] == lastVoxel[0] && voxel[1] == lastVoxel[1] && voxel[2] == lastVoxel[2])
+                {
+                    continue;
+                }
+                lastVoxel[0] = voxel[0];
+                lastVoxel[1] = voxel[1];
+                lastVoxel[2] = voxel[2];
+                hasLastVoxel = true;
+                if ((voxel[0] >> BLOCK_EDGE_BITS) != block->mCoord[0] || (voxel[1] >> BLOCK_EDGE_BITS) != block->mCoord[1] ||
+                    (voxel[2] >> BLOCK_EDGE_BITS) != block->mCoord[2])
+                {
+                    continue;
+                }
+                GPP::Vector3 voxelCenter((voxel[0] + 0.5) * mVoxelSize, (voxel[1] + 0.5) * mVoxelSize, (voxel[2] + 0.5) * mVoxelSize);
+                GPP::Real distance = (voxelCenter - coord) * direction / mTruncation;
+                if (distance < -1.0)
+                {
+                    continue;
+                }
+                if (distance > 1.0)
+                {
+                    distance = 1.0;
+                }
+                TsdfVoxel& tsdfVoxel = block->mVoxels[GetLocalVoxelId(voxel)];
+                float weight = tsdfVoxel.mWeight + 1.0f;
+                tsdfVoxel.mDistance = (tsdfVoxel.mDistance * tsdfVoxel.mWeight + float(distance)) / weight;
+                tsdfVoxel.mWeight = weight < maxWeight ? weight : maxWeight;
+            }
+        }
+    }
+
+    void TsdfVolume::ExtractBlock(GPP::Int blockId, std::vector<GPP::Vector3>& coords, std::vector<GPP::Vector3>& normals) const
+    {
+        const TsdfBlock* block = mBlocks.at(blockId);
+        GPP::Int voxel[3];
+        GPP::Int neighborVoxel[3];
+        for (GPP::Int localId = 0; localId < BLOCK_VOXEL_COUNT; localId++)
+        {
+            const TsdfVoxel& tsdfVoxel = block->mVoxels[localId];
+            if (tsdfVoxel.mWeight < MIN_VOXEL_WEIGHT)
+            {
+                continue;
+            }
+            voxel[0] = (block->mCoord[0] << BLOCK_EDGE_BITS) + (localId & BLOCK_EDGE_MASK);
+            voxel[1] = (block->mCoord[1] << BLOCK_EDGE_BITS) + ((localId >> BLOCK_EDGE_BITS) & BLOCK_EDGE_MASK);
+            voxel[2] = (block->mCoord[2] << BLOCK_EDGE_BITS) + (localId >> (BLOCK_EDGE_BITS * 2));
+            GPP::Real distance = tsdfVoxel.mDistance;
+            // Every edge is visited once, from its voxel with the smaller coordinate
+            for (int axis = 0; axis < 3; axis++)
+            {
+                neighborVoxel[0] = voxel[0];
+                neighborVoxel[1] = voxel[1];
+                neighborVoxel[2] = voxel[2];
+                neighborVoxel[axis]++;
+                GPP::Real neighborDistance = 0;
+                if (!GetVoxelDistance(neighborVoxel, neighborDistance))
+                {
+                    continue;
+                }
+                if ((distance >= 0) == (neighborDistance >= 0))
+                {
+                    continue;
+                }
+                GPP::Real ratio = distance / (distance - neighborDistance);
+                GPP::Vector3 coord((voxel[0] + 0.5) * mVoxelSize, (voxel[1] + 0.5) * mVoxelSize, (voxel[2] + 0.5) * mVoxelSize);
+                coord[axis] += ratio * mVoxelSize;
+                GPP::Vector3 normal = GetVoxelGradient(ratio < 0.5 ? voxel : neighborVoxel);
+                if (normal.Normalise() < GPP::REAL_TOL)
+                {
+                    normal = GPP::Vector3(0, 0, 0);
+                    normal[axis] = distance > neighborDistance ? -1.0 : 1.0;
+                }
+                coords.push_back(coord);
+                normals.push_back(normal);
+            }
+        }
+    }
+
+    bool TsdfVolume::GetVoxelDistance(const GPP::Int voxel[3], GPP::Real& distance) const
+    {
+        GPP::Int blockId = FindBlock(GetVoxelBlockKey(voxel));
+        if (blockId < 0)
+        {
+            return false;
+        }
+        const TsdfVoxel& tsdfVoxel = mBlocks.at(blockId)->mVoxels[GetLocalVoxelId(voxel)];
+        if (tsdfVoxel.mWeight < MIN_VOXEL_WEIGHT)
+        {
+            return false;
+        }
+        distance = tsdfVoxel.mDistance;
+        return true;
+    }
+
+    GPP::Vector3 TsdfVolume::GetVoxelGradient(const GPP::Int voxel[3]) const
+    {
+        // Central differences, one sided where a neighbor is not observed
+        GPP::Vector3 gradient(0, 0, 0);
+        GPP::Real distance = 0;
+        bool hasDistance = GetVoxelDistance(voxel, distance);
+        GPP::Int neighborVoxel[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            neighborVoxel[0] = voxel[0];
+            neighborVoxel[1] = voxel[1];
+            neighborVoxel[2] = voxel[2];
+            neighborVoxel[axis] = voxel[axis] + 1;
+            GPP::Real upperDistance = 0;
+            bool hasUpper = GetVoxelDistance(neighborVoxel, upperDistance);
+            neighborVoxel[axis] = voxel[axis] - 1;
+            GPP::Real lowerDistance = 0;
+            bool hasLower = GetVoxelDistance(neighborVoxel, lowerDistance);
+            if (hasUpper && hasLower)
+            {
+                gradient[axis] = (upperDistance - lowerDistance) * 0.5;
+            }
+            else if (hasUpper && hasDistance)
+            {
+                gradient[axis] = upperDistance - distance;
+            }
+            else if (hasLower && hasDistance)
+            {
+                gradient[axis] = distance - lowerDistance;
+            }
+        }
+        return gradient;
+    }
+
+    GPP::Int TsdfVolume::FindBlock(GPP::ULongInt blockKey) const
+    {
+        GPP::Int slotMask = (1 << mSlotBits) - 1;
+        GPP::Int slotId = HashBlockKey(blockKey, mSlotBits);
+        while (mSlotKeys.at(slotId) != EMPTY_SLOT_KEY)
+        {
+            if (mSlotKeys.at(slotId) == blockKey)
+            {
+                return mSlotBlockIds.at(slotId);
+            }
+            slotId = (slotId + 1) & slotMask;
+        }
+        return -1;
+    }
+
+    GPP::Int TsdfVolume::InsertBlock(GPP::ULongInt blockKey)
+    {
+        // Keep the table at most half full, so probe chains stay short
+        if ((mBlocks.size() + 1) * 2 > mSlotKeys.size())
+        {
+            RebuildSlots(mSlotBits + 1);
+        }
+        TsdfBlock* block = new TsdfBlock;
+        block->mKey = blockKey;
+        UnpackBlockKey(blockKey, block->mCoord);
+        for (GPP::Int voxelId = 0; voxelId < BLOCK_VOXEL_COUNT; voxelId++)
+        {
+            block->mVoxels[voxelId].mDistance = 1.0f;
+            block->mVoxels[voxelId].mWeight = 0;
+        }
+        GPP::Int blockId = mBlocks.size();
+        mBlocks.push_back(block);
+        GPP::Int slotMask = (1 << mSlotBits) - 1;
+        GPP::Int slotId = HashBlockKey(blockKey, mSlotBits);
+        while (mSlotKeys.at(slotId) != EMPTY_SLOT_KEY)
+        {
+            slotId = (slotId + 1) & slotMask;
+        }
+        mSlotKeys.at(slotId) = blockKey;
+        mSlotBlockIds.at(slotId) = blockId;
+        return blockId;
+    }
+
+    void TsdfVolume::RebuildSlots(GPP::Int slotBits)
+    {
+        mSlotBits = slotBits;
+        GPP::Int slotCount = 1 << slotBits;
+        mSlotKeys.assign(slotCount, EMPTY_SLOT_KEY);
+        mSlotBlockIds.assign(slotCount, -1);
+        GPP::Int slotMask = slotCount - 1;
+        GPP::Int blockCount = mBlocks.size();
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            GPP::ULongInt blockKey = mBlocks.at(blockId)->mKey;
+            GPP::Int slotId = HashBlockKey(blockKey, slotBits);
+            while (mSlotKeys.at(slotId) != EMPTY_SLOT_KEY)
+            {
+                slotId = (slotId + 1) & slotMask;
+            }
+            mSlotKeys.at(slotId) = blockKey;
+            mSlotBlockIds.at(slotId) = blockId;
+        }
+    }
+}
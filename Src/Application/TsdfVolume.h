@@ -0,0 +1,99 @@
+#pragma once
+#include "GPP.h"
+#include "DistanceVolume.h"
+#include <vector>
+
+namespace MagicApp
+{
+    struct TsdfBlock;
+
+    // Truncated signed distance volume stored as hashed blocks of 8x8x8 voxels, replacing the dense GPP::SignedDistanceFunction.
+    // Only blocks within the truncation distance of an integrated point are allocated, so memory grows with the surface area
+    // and not with the bounding box. A frame is integrated in two parallel passes: the points find the blocks they touch,
+    // then every touched block is updated by its own points, so no voxel is written by two threads.
+    // Distances are measured along the point normal, or along the ray to the sensor if the frame has no normals.
+    // Weight decay fades old frames out, and blocks whose weights all decayed away are freed.
+    // USAGE: 1. TsdfVolume tsdfVolume(voxelSize, voxelSize * 4);
+    //        2. tsdfVolume.Integrate(pointCloud, &transform); ...
+    //        3. tsdfVolume.ExtractPointCloud(fusedPointCloud), or MarchingCubes::Extract(&tsdfVolume, triMesh);
+    class TsdfVolume : public IDistanceVolume
+    {
+    public:
+        TsdfVolume(GPP::Real voxelSize, GPP::Real truncation);
+        virtual ~TsdfVolume();
+
+        // transform can be NULL if it is identity. Points are integrated along their normals if pointCloud has normals
+        GPP::ErrorCode Integrate(const GPP::IPointCloud* pointCloud, const GPP::Matrix4x4* transform);
+        // pointCloud should be blank. Zero crossings of the voxel edges, with normals from the distance gradient
+        GPP::ErrorCode ExtractPointCloud(GPP::IPointCloud* pointCloud) const;
+        void Clear(void);
+
+        // Sensor position in frame coordinates, used for frames without normals. Default is the origin
+        void SetSensorOrigin(const GPP::Vector3& sensorOrigin);
+        // Voxel weights are capped, so a voxel still follows changes after many frames. Default is 64
+        void SetMaxWeight(GPP::Real maxWeight);
+        // Weights are scaled by weightDecay before every Integrate. 1 (default) disables the decay
+        void SetWeightDecay(GPP::Real weightDecay);
+        // Scale every weight and free the blocks without any weight left
+        void DecayWeights(GPP::Real weightDecay);
+
+        GPP::ULongInt GetMemoryByteCount(void) const;
+        GPP::Int GetFrameCount(void) const;
+        double GetIntegrateTime(void) const;
+
+        virtual GPP::Int GetBlockCount(void) const;
+        virtual void GetBlockCoord(GPP::Int blockId, GPP::Int blockCoord[3]) const;
+        virtual GPP::Int FindBlockId(const GPP::Int blockCoord[3]) const;
+        // Distances are normalized by the truncation, voxels without weight are not observed
+        virtual bool GetVoxelDistance(const GPP::Int voxel[3], GPP::Real& distance) const;
+        // Voxel center
+        virtual GPP::Vector3 GetVoxelCoord(const GPP::Int voxel[3]) const;
+
+    private:
+        struct BlockPoint
+        {
+            GPP::ULongInt mBlockKey;
+            GPP::Int mPointId;
+
+            bool operator < (const BlockPoint& blockPoint) const
+            {
+                return mBlockKey < blockPoint.mBlockKey || (mBlockKey == blockPoint.mBlockKey && mPointId < blockPoint.mPointId);
+            }
+        };
+
+        TsdfVolume(const TsdfVolume&);
+        TsdfVolume& operator = (const TsdfVolume&);
+        // Voxel hit by sample sampleId of the truncation band of a point
+        void GetSampleVoxel(const GPP::Vector3& coord, const GPP::Vector3& direction, GPP::Int sampleId, GPP::Int voxel[3]) const;
+        void CollectPointBlocks(GPP::Int pointId, std::vector<BlockPoint>& blockPoints) const;
+        void UpdateBlock(GPP::Int blockId, const BlockPoint* blockPoints, GPP::Int pointCount);
+        void ExtractBlock(GPP::Int blockId, std::vector<GPP::Vector3>& coords, std::vector<GPP::Vector3>& normals) const;
+        GPP::Vector3 GetVoxelGradient(const GPP::Int voxel[3]) const;
+        GPP::Int FindBlock(GPP::ULongInt blockKey) const;
+        GPP::Int InsertBlock(GPP::ULongInt blockKey);
+        void RebuildSlots(GPP::Int slotBits);
+        friend class FramePointTask;
+        friend class CollectBlockTask;
+        friend class UpdateBlockTask;
+        friend class ExtractBlockTask;
+        friend class DecayBlockTask;
+
+    private:
+        GPP::Real mVoxelSize;
+        GPP::Real mTruncation;
+        GPP::Int mSampleCount;
+        GPP::Vector3 mSensorOrigin;
+        GPP::Real mMaxWeight;
+        GPP::Real mWeightDecay;
+        std::vector<TsdfBlock*> mBlocks;
+        // Open addressing table from block key to block id
+        std::vector<GPP::ULongInt> mSlotKeys;
+        std::vector<GPP::Int> mSlotBlockIds;
+        GPP::Int mSlotBits;
+        // Frame being integrated, in volume coordinates
+        std::vector<GPP::Vector3> mFrameCoords;
+        std::vector<GPP::Vector3> mFrameDirections;
+        GPP::Int mFrameCount;
+        double mIntegrateTime;
+    };
+}
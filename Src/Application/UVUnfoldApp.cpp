@@ -4,6 +4,11 @@
 #include "UVUnfoldAppUI.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "HeatGeodesics.h"
+#include "LocalGeodesics.h"
+#include "ChartUnfolder.h"
+#include "AtlasPacker.h"
+#include "TextureApp.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
@@ -24,6 +29,32 @@ namespace MagicApp
         return 1;
     }
 
+    // SplitByLines only duplicates the vertices on the lines, so every triangle of the split copy should have the corner
+    // coordinates of the same triangle of triMesh. Face tex ids of the copy are written back to triMesh by triangle id
+    static bool IsSameTriangleOrder(const GPP::ITriMesh* triMesh, const GPP::ITriMesh* splitMesh)
+    {
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        if (splitMesh->GetTriangleCount() != triangleCount)
+        {
+            return false;
+        }
+        GPP::Int vertexIds[3] = {-1};
+        GPP::Int splitVertexIds[3] = {-1};
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            splitMesh->GetTriangleVertexIds(fid, splitVertexIds);
+            for (int localId = 0; localId < 3; localId++)
+            {
+                if (!(triMesh->GetVertexCoord(vertexIds[localId]) == splitMesh->GetVertexCoord(splitVertexIds[localId])))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
     UVUnfoldApp::UVUnfoldApp() :
         mpUI(NULL),
         mpImageFrameMesh(NULL),
@@ -44,7 +75,12 @@ namespace MagicApp
         mInitChartCount(1),
         mSnapIds(),
         mTargetVertexCount(0),
-        mIsCutLineAccurate(false)
+        mIsCutLineAccurate(false),
+        mpHeatGeodesics(NULL),
+        mUseHeatGeodesics(false),
+        mpLocalGeodesics(NULL),
+        mUseLocalGeodesics(false),
+        mRenderVersion(0)
     {
     }
 
@@ -54,6 +90,8 @@ namespace MagicApp
         GPPFREEPOINTER(mpImageFrameMesh);
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
+        GPPFREEPOINTER(mpHeatGeodesics);
+        GPPFREEPOINTER(mpLocalGeodesics);
     }
 
     void UVUnfoldApp::ClearData()
@@ -62,6 +100,10 @@ namespace MagicApp
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpImageFrameMesh);
         GPPFREEPOINTER(mpPickTool);
+        GPPFREEPOINTER(mpHeatGeodesics);
+        mUseHeatGeodesics = false;
+        GPPFREEPOINTER(mpLocalGeodesics);
+        mUseLocalGeodesics = false;
         mDisplayMode = TRIMESH_SOLID;
         mDistortionImage.release();
         ClearSplitData();
@@ -82,7 +124,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -198,12 +240,10 @@ namespace MagicApp
                     {
                         std::vector<GPP::Vector3> pathCoords;
                         std::vector<GPP::PointOnEdge> pathInfos;
-                        GPP::Real distance = 0;
-                        GPP::ErrorCode res = GPP::MeasureMesh::FastComputeExactGeodesics(ModelManager::Get()->GetMesh(), 
-                            sectionVertexIds, false, pathCoords, distance, &pathInfos, 0.5);
+                        GPP::ErrorCode res = ComputeAccurateCutLine(sectionVertexIds, pathCoords, pathInfos);
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                             return true;
                         }
                         int startId = 1;
@@ -229,7 +269,7 @@ namespace MagicApp
                             pathVertexIds, distance);
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                             return true;
                         }
                         int startId = 1;
@@ -257,9 +297,70 @@ namespace MagicApp
         {
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_WIREFRAME);
         }
+        else if (arg.key == OIS::KC_H)
+        {
+            SwitchHeatGeodesics();
+        }
+        else if (arg.key == OIS::KC_G)
+        {
+            mUseLocalGeodesics = !mUseLocalGeodesics;
+            InfoLog << "UVUnfoldApp local geodesics: " << mUseLocalGeodesics << std::endl;
+        }
         return true;
     }
 
+    void UVUnfoldApp::SwitchHeatGeodesics()
+    {
+        mUseHeatGeodesics = !mUseHeatGeodesics;
+        InfoLog << "UVUnfoldApp heat geodesics: " << mUseHeatGeodesics << std::endl;
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (mUseHeatGeodesics && triMesh != NULL && (mpHeatGeodesics == NULL || !mpHeatGeodesics->IsBuiltFrom(triMesh)))
+        {
+            GPPFREEPOINTER(mpHeatGeodesics);
+            mpHeatGeodesics = new HeatGeodesics;
+            mpHeatGeodesics->InitAsync(triMesh);
+        }
+    }
+
+    GPP::ErrorCode UVUnfoldApp::ComputeAccurateCutLine(const std::vector<GPP::Int>& sectionVertexIds, std::vector<GPP::Vector3>& pathCoords,
+        std::vector<GPP::PointOnEdge>& pathInfos)
+    {
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (mUseHeatGeodesics && triMesh != NULL)
+        {
+            if (mpHeatGeodesics == NULL || !mpHeatGeodesics->IsBuiltFrom(triMesh))
+            {
+                // mesh is changed by splitting, refactorize for the next cut line
+                GPPFREEPOINTER(mpHeatGeodesics);
+                mpHeatGeodesics = new HeatGeodesics;
+                mpHeatGeodesics->InitAsync(triMesh);
+            }
+            if (mpHeatGeodesics->IsReady())
+            {
+                GPP::Real distance = 0;
+                GPP::ErrorCode res = mpHeatGeodesics->ComputeGeodesics(sectionVertexIds, false, pathCoords, distance, &pathInfos);
+                if (res == GPP_NO_ERROR)
+                {
+                    return res;
+                }
+                InfoLog << "Heat geodesics failed, use FastComputeExactGeodesics" << std::endl;
+            }
+        }
+        GPP::Real distance = 0;
+        if (mUseLocalGeodesics && triMesh != NULL)
+        {
+            // cut line sections are short, an exact path on a small region is faster than the fast version on the whole mesh
+            if (mpLocalGeodesics == NULL || !mpLocalGeodesics->IsBuiltFrom(triMesh))
+            {
+                GPPFREEPOINTER(mpLocalGeodesics);
+                mpLocalGeodesics = new LocalGeodesics;
+                mpLocalGeodesics->Init(triMesh);
+            }
+            return mpLocalGeodesics->ComputeExactGeodesics(sectionVertexIds, false, pathCoords, distance, &pathInfos);
+        }
+        return GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, sectionVertexIds, false, pathCoords, distance, &pathInfos, 0.5);
+    }
+
     void UVUnfoldApp::SetupScene()
     {
         Ogre::SceneManager* sceneManager = MagicCore::RenderSystem::Get()->GetSceneManager();
@@ -274,7 +375,7 @@ namespace MagicApp
             mpImageFrameMesh = GPP::Parser::ImportTriMesh("../../Media/UVUnfoldApp/ImageMesh.obj");
             if (mpImageFrameMesh == NULL)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "纹理网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             mpImageFrameMesh->UpdateNormal();
@@ -284,7 +385,7 @@ namespace MagicApp
         mDistortionImage = cv::imread("../../Media/UVUnfoldApp/grid.png");
         if (mDistortionImage.data == NULL)
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "纹理图片打开失败", "温馨提示", MB_OK);
         }
         InitTriMeshTexture();
 
@@ -332,7 +433,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -354,7 +455,7 @@ namespace MagicApp
     {
         if (mCurPointsOnVertex.size() > 0 && mCurPointsOnEdge.size() > 0)
         {
-            MessageBox(NULL, "Ϣд", "ܰʾ", MB_OK);
+            MessageBox(NULL, "割线信息有错", "温馨提示", MB_OK);
             return;
         }
         if (mCurPointsOnEdge.size() > 0)
@@ -364,10 +465,11 @@ namespace MagicApp
             mLastCutVertexId = -1;
             std::vector<GPP::Int> newSplitLineIds;
             GPP::ErrorCode res = GPP::SplitMesh::InsertSplitLineOnTriMesh(triMesh, mCurPointsOnEdge, &newSplitLineIds);
+            ModelManager::Get()->MarkMeshChanged();
             mCurPointsOnEdge.clear();
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "߲Խ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "割线不能自交", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
@@ -425,12 +527,10 @@ namespace MagicApp
             sectionVertexIds.push_back(pickedId);
             std::vector<GPP::Vector3> pathCoords;
             std::vector<GPP::PointOnEdge> pathInfos;
-            GPP::Real distance = 0;
-            GPP::ErrorCode res = GPP::MeasureMesh::FastComputeExactGeodesics(ModelManager::Get()->GetMesh(), sectionVertexIds, false, 
-                pathCoords, distance, &pathInfos, 0.5);
+            GPP::ErrorCode res = ComputeAccurateCutLine(sectionVertexIds, pathCoords, pathInfos);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -465,7 +565,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::MeasureMesh::ComputeApproximateGeodesics(triMesh, sectionVertexIds, false, pathVertexIds, distance);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -517,12 +617,10 @@ namespace MagicApp
         {
             std::vector<GPP::Vector3> pathCoords;
             std::vector<GPP::PointOnEdge> pathInfos;
-            GPP::Real distance = 0;
-            GPP::ErrorCode res = GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, sectionVertexIds, false, 
-                pathCoords, distance, &pathInfos, 0.5);
+            GPP::ErrorCode res = ComputeAccurateCutLine(sectionVertexIds, pathCoords, pathInfos);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -545,7 +643,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::MeasureMesh::ComputeApproximateGeodesics(triMesh, sectionVertexIds, false, pathVertexIds, distance);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -609,12 +707,10 @@ namespace MagicApp
             sectionVertexIds.push_back(mCurPointsOnEdge.at(0).mVertexIdStart);
             std::vector<GPP::Vector3> pathCoords;
             std::vector<GPP::PointOnEdge> pathInfos;
-            GPP::Real distance = 0;
-            GPP::ErrorCode res = GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, sectionVertexIds, false, 
-                pathCoords, distance, &pathInfos, 0.5);
+            GPP::ErrorCode res = ComputeAccurateCutLine(sectionVertexIds, pathCoords, pathInfos);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::PointOnEdge> newPonitsOnEdge;
@@ -645,7 +741,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::MeasureMesh::ComputeApproximateGeodesics(triMesh, sectionVertexIds, false, pathVertexIds, distance);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             for (int pvid = 0; pvid < pathVertexIds.size(); pvid++)
@@ -737,7 +833,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
 #if MAKEDUMPFILE
@@ -746,12 +842,12 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, mCurPointsOnVertex, false, GPP::ONE_RADIAN * 60, 0.2, 10);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "割线优化失败", "温馨提示", MB_OK);
             return;
         }
         mCurMarkCoords.clear();
@@ -773,19 +869,19 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::vector<GPP::Int> > splitLines;
         GPP::ErrorCode res = GPP::SplitMesh::GenerateAtlasSplitLines(triMesh, splitChartCount, splitLines);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Զʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "自动割线失败", "温馨提示", MB_OK);
             return;
         }
         ClearSplitData();
@@ -840,7 +936,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -852,12 +948,12 @@ namespace MagicApp
         {
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "չʧܣзνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格有非流形结构，请先拓扑修复", "温馨提示", MB_OK);
                 return;
             }
             if (GPP::ConsolidateMesh::_IsGeometryDegenerate(triMesh) == false)
             {
-                if (MessageBox(NULL, "棺˻ΣܵõЧȼ޸Ƿ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "警告：网格有退化几何，继续计算可能得到无效结果，可以先几何修复，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -869,12 +965,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(triMesh, &holeIds);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "߽ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "找网格边界失败", "温馨提示", MB_OK);
                 return;
             }
             if (holeIds.empty())
@@ -897,12 +993,12 @@ namespace MagicApp
                 }
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "չʧܣͨʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格展开失败：网格连通区域检测失败", "温馨提示", MB_OK);
                     return;
                 }
                 if (!isMultiPatchCase)
@@ -931,12 +1027,12 @@ namespace MagicApp
                     mIsCommandInProgress = false;
                     if (res == GPP_API_IS_NOT_AVAILABLE)
                     {
-                        MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                         MagicCore::ToolKit::Get()->SetAppRunning(false);
                     }
                     if (res != GPP_NO_ERROR)
                     {
-                        MessageBox(NULL, "չʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "网格展开失败", "温馨提示", MB_OK);
                         return;
                     }
                     UnifyTextureCoords(texCoords, 0.9);
@@ -964,19 +1060,27 @@ namespace MagicApp
                 std::vector<GPP::Real> texCoords;
                 std::vector<GPP::Int> faceTexIds;
                 mIsCommandInProgress = true;
-                GPP::ErrorCode res = GPP::UnfoldMesh::GenerateUVAtlas(triMesh, 1, &texCoords, &faceTexIds, false, false, false);
+                GPP::ErrorCode res = UnfoldCharts(triMesh, texCoords, faceTexIds);
+                bool isPacked = (res == GPP_NO_ERROR);
+                if (res != GPP_NO_ERROR && res != GPP_API_IS_NOT_AVAILABLE)
+                {
+                    res = GPP::UnfoldMesh::GenerateUVAtlas(triMesh, 1, &texCoords, &faceTexIds, false, false, false);
+                }
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "UV Atlas ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "UV Atlas 生成失败", "温馨提示", MB_OK);
                     return;
                 }
-                UnifyTextureCoords(texCoords, 0.9);
+                if (!isPacked)
+                {
+                    UnifyTextureCoords(texCoords, 0.9);
+                }
                 triMesh->SetHasTriangleTexCoord(true);
                 int uvFaceCount = faceTexIds.size() / 3;
                 for (int fid = 0; fid < uvFaceCount; fid++)
@@ -1004,7 +1108,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1016,12 +1120,12 @@ namespace MagicApp
         {
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "չʧܣзνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格有非流形结构，请先拓扑修复", "温馨提示", MB_OK);
                 return;
             }
             if (GPP::ConsolidateMesh::_IsGeometryDegenerate(triMesh) == false)
             {
-                if (MessageBox(NULL, "棺˻ΣܵõЧȼ޸Ƿ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "警告：网格有退化几何，继续计算可能得到无效结果，可以先几何修复，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1033,17 +1137,17 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(triMesh, &holeIds);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "߽ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "找网格边界失败", "温馨提示", MB_OK);
                 return;
             }
             if (holeIds.empty())
             {
-                MessageBox(NULL, "Ϊͨԭ˽ṹ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格必须为单连通原盘拓扑结构", "温馨提示", MB_OK);
                 return;
             }
 
@@ -1055,18 +1159,18 @@ namespace MagicApp
             {
                 if (isolation.at(vid) < 1)
                 {
-                    MessageBox(NULL, "Ϊͨṹ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格必须为单连通结构", "温馨提示", MB_OK);
                     return;
                 }
             }
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "չʧܣͨʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格连通区域检测失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -1104,12 +1208,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "չʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败", "温馨提示", MB_OK);
                 return;
             }
             UnifyTextureCoords(texCoords, 0.9);
@@ -1146,7 +1250,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1159,12 +1263,12 @@ namespace MagicApp
         {
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "չʧܣзνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格有非流形结构，请先拓扑修复", "温馨提示", MB_OK);
                 return;
             }
             if (GPP::ConsolidateMesh::_IsGeometryDegenerate(triMesh) == false)
             {
-                if (MessageBox(NULL, "棺˻ΣܵõЧȼ޸Ƿ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "警告：网格有退化几何，继续计算可能得到无效结果，可以先几何修复，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1176,19 +1280,48 @@ namespace MagicApp
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = GPP::UnfoldMesh::GenerateUVAtlas(triMesh, initChartCount, &texCoords, &faceTexIds, true, true, true);
+            // Split a copy into charts and unfold them in parallel, GPP atlas is the fallback since it also splits fold overs and overlaps
+            GPP::ErrorCode res = GPP_INVALID_RESULT;
+            GPP::TriMesh* splitMesh = GPP::CopyTriMesh(triMesh);
+            if (splitMesh != NULL)
+            {
+                std::vector<std::vector<GPP::Int> > splitLines;
+                res = GPP::SplitMesh::GenerateAtlasSplitLines(splitMesh, initChartCount, splitLines);
+                if (res == GPP_NO_ERROR && !splitLines.empty())
+                {
+                    res = GPP::SplitMesh::SplitByLines(splitMesh, splitLines);
+                }
+                if (res == GPP_NO_ERROR && !IsSameTriangleOrder(triMesh, splitMesh))
+                {
+                    InfoLog << "UVUnfoldApp::GenerateUVAtlas: split copy changed the triangle order, use GenerateUVAtlas" << std::endl;
+                    res = GPP_INVALID_RESULT;
+                }
+                if (res == GPP_NO_ERROR)
+                {
+                    res = UnfoldCharts(splitMesh, texCoords, faceTexIds);
+                }
+                GPPFREEPOINTER(splitMesh);
+            }
+            bool isPacked = (res == GPP_NO_ERROR);
+            if (res != GPP_NO_ERROR && res != GPP_API_IS_NOT_AVAILABLE)
+            {
+                res = GPP::UnfoldMesh::GenerateUVAtlas(triMesh, initChartCount, &texCoords, &faceTexIds, true, true, true);
+            }
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "UV Atlas ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "UV Atlas 生成失败", "温馨提示", MB_OK);
                 return;
             }
-            UnifyTextureCoords(texCoords, 0.9);
+            if (!isPacked)
+            {
+                UnifyTextureCoords(texCoords, 0.9);
+            }
             triMesh->SetHasTriangleTexCoord(true);
             int uvFaceCount = faceTexIds.size() / 3;
             for (int fid = 0; fid < uvFaceCount; fid++)
@@ -1268,7 +1401,8 @@ namespace MagicApp
                 material->setCullingMode(Ogre::CullingMode::CULL_NONE);
             }
         }
-        UpdateDisplay();
+        UpdateDisplay(mUpdateDisplay);
+        mUpdateDisplay = false;
     }
 
     void UVUnfoldApp::InitViewTool()
@@ -1280,9 +1414,13 @@ namespace MagicApp
         }
     }
 
-    void UVUnfoldApp::UpdateDisplay()
+    void UVUnfoldApp::UpdateDisplay(bool isMeshChanged)
     {
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh != NULL && isMeshChanged)
+        {
+            mRenderVersion++;
+        }
         if (mDisplayMode == TRIMESH_SOLID)
         {
             InfoLog << "Display TRIMESH_SOLID" << std::endl;
@@ -1293,7 +1431,7 @@ namespace MagicApp
             }
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_SOLID);
             MagicCore::RenderSystem::Get()->RenderMesh("TriMesh_UVUnfoldApp", "CookTorrance", triMesh, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, false);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, false, mRenderVersion);
             InfoLog << "Display done" << std::endl;
         }
         else if (mDisplayMode == TRIMESH_WIREFRAME)
@@ -1306,7 +1444,7 @@ namespace MagicApp
             }
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_WIREFRAME);
             MagicCore::RenderSystem::Get()->RenderMesh("TriMesh_UVUnfoldApp", "CookTorrance", triMesh, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, false, mRenderVersion);
             InfoLog << "Display done" << std::endl;
         }
         else if (mDisplayMode == TRIMESH_TEXTURE)
@@ -1319,7 +1457,7 @@ namespace MagicApp
             }
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_SOLID);
             MagicCore::RenderSystem::Get()->RenderTextureMesh("TriMesh_UVUnfoldApp", "UVUnfoldGridMaterial", 
-                triMesh, MagicCore::RenderSystem::MODEL_NODE_CENTER);
+                triMesh, MagicCore::RenderSystem::MODEL_NODE_CENTER, mRenderVersion);
             InfoLog << "Display done" << std::endl;
         }
         else if (mDisplayMode == UVMESH_WIREFRAME)
@@ -1332,7 +1470,7 @@ namespace MagicApp
             }
             MagicCore::RenderSystem::Get()->GetMainCamera()->setPolygonMode(Ogre::PolygonMode::PM_SOLID);
             MagicCore::RenderSystem::Get()->RenderUVMesh("TriMesh_UVUnfoldApp", "CookTorrance", triMesh, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, mRenderVersion);
             InfoLog << "Display done" << std::endl;
         }
     }
@@ -1441,12 +1579,47 @@ namespace MagicApp
         if (!mCutLineList.empty())
         {
             GPP::SplitMesh::SplitByLines(ModelManager::Get()->GetMesh(), mCutLineList);
+            ModelManager::Get()->MarkMeshChanged();
             ModelManager::Get()->GetMesh()->UpdateNormal();
             ClearSplitData();
             InsertHolesToSnapIds();
         }
     }
 
+    GPP::ErrorCode UVUnfoldApp::UnfoldCharts(GPP::ITriMesh* splitMesh, std::vector<GPP::Real>& texCoords, std::vector<GPP::Int>& faceTexIds)
+    {
+        // Charts are packed into one page of the texture image size, padding keeps mipmaps from bleeding between charts
+        AtlasPacker atlasPacker;
+        TextureApp* textureApp = dynamic_cast<TextureApp* >(AppManager::Get()->GetApp("TextureApp"));
+        atlasPacker.SetImageSize(textureApp != NULL ? textureApp->GetTextureImageSize() : 4096, 4);
+        atlasPacker.SetMaxPageCount(1);
+        ChartUnfolder chartUnfolder;
+        GPP::ErrorCode res = chartUnfolder.Unfold(splitMesh, 10, &atlasPacker);
+        const std::vector<ChartUnfolder::ChartInfo>& chartInfos = chartUnfolder.GetChartInfos();
+        GPP::Int chartCount = chartInfos.size();
+        for (GPP::Int chartId = 0; chartId < chartCount; chartId++)
+        {
+            const ChartUnfolder::ChartInfo& chartInfo = chartInfos.at(chartId);
+            DebugLog << "  chart " << chartId << ": triangle " << chartInfo.mTriangleCount << " vertex " << chartInfo.mVertexCount
+                << " time " << chartInfo.mTime << " angle distortion " << chartInfo.mAngleDistortion << " area distortion "
+                << chartInfo.mAreaDistortion << " flip " << chartInfo.mFlipCount << " result " << chartInfo.mResult << std::endl;
+        }
+        InfoLog << "UVUnfoldApp::UnfoldCharts: chart " << chartCount << " unfold time " << chartUnfolder.GetUnfoldTime()
+            << " pack time " << chartUnfolder.GetPackTime() << " flip " << chartUnfolder.GetFlipCount() << " result " << res << std::endl;
+        InfoLog << "  texel density " << atlasPacker.GetTexelDensity() << " coverage " << atlasPacker.GetCoverage() << std::endl;
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        if (chartUnfolder.GetFlipCount() > 0)
+        {
+            return GPP_INVALID_RESULT;
+        }
+        texCoords = chartUnfolder.GetTexCoords();
+        faceTexIds = chartUnfolder.GetFaceTexIds();
+        return GPP_NO_ERROR;
+    }
+
     void UVUnfoldApp::UnifyTextureCoords(std::vector<double>& texCoords, double scaleValue)
     {
         int vertexCount = texCoords.size() / 2;
@@ -21,6 +21,8 @@ namespace MagicCore
 namespace MagicApp
 {
     class UVUnfoldAppUI;
+    class HeatGeodesics;
+    class LocalGeodesics;
     class UVUnfoldApp : public AppBase
     {
     public:
@@ -83,13 +85,19 @@ namespace MagicApp
 
     private:
         void InitViewTool(void);
-        void UpdateDisplay(void);
+        // isMeshChanged: false if only the display mode is switched, then the cached buffers are shown
+        void UpdateDisplay(bool isMeshChanged = true);
         void UpdateMarkDisplay();
         void InitTriMeshTexture(void);
         void GenerateSplitMesh(void);
         void UnifyTextureCoords(std::vector<double>& texCoords, double scaleValue);
+        // splitMesh: every connected region is one chart. faceTexIds are against splitMesh triangles
+        GPP::ErrorCode UnfoldCharts(GPP::ITriMesh* splitMesh, std::vector<GPP::Real>& texCoords, std::vector<GPP::Int>& faceTexIds);
 
         void InsertHolesToSnapIds(void);
+        void SwitchHeatGeodesics(void);
+        GPP::ErrorCode ComputeAccurateCutLine(const std::vector<GPP::Int>& sectionVertexIds, std::vector<GPP::Vector3>& pathCoords,
+            std::vector<GPP::PointOnEdge>& pathInfos);
 
     private:
         void SetupScene(void);
@@ -119,5 +127,10 @@ namespace MagicApp
         std::vector<int> mSnapIds;
         int mTargetVertexCount;
         bool mIsCutLineAccurate;
+        HeatGeodesics* mpHeatGeodesics;
+        bool mUseHeatGeodesics;
+        LocalGeodesics* mpLocalGeodesics;
+        bool mUseLocalGeodesics;
+        int mRenderVersion;
     };
 }
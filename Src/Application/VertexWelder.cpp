@@ -0,0 +1,461 @@
+#include "VertexWelder.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include <math.h>
+
+namespace MagicApp
+{
+    static const GPP::Real WELD_TOLERANCE_RATIO = 1.0e-7;
+    // Cells are much larger than the tolerance, so few points are near a cell border and need the neighbor cells
+    static const GPP::Real CELL_TOLERANCE_RATIO = 64.0;
+    static const GPP::Int CELL_AXIS_BITS = 21;
+    static const GPP::Int CELL_AXIS_COUNT = 1 << CELL_AXIS_BITS;
+
+    static GPP::ULongInt PackCellKey(GPP::Int cellX, GPP::Int cellY, GPP::Int cellZ)
+    {
+        return GPP::ULongInt(cellX) | (GPP::ULongInt(cellY) << CELL_AXIS_BITS) | (GPP::ULongInt(cellZ) << (CELL_AXIS_BITS * 2));
+    }
+
+    static GPP::Int HashCellKey(GPP::ULongInt cellKey, GPP::Int bucketBits)
+    {
+        return GPP::Int((cellKey * 0x9E3779B97F4A7C15ULL) >> (64 - bucketBits));
+    }
+
+    static GPP::Int ToCellIndex(GPP::Real coord, GPP::Real boxMin, GPP::Real cellSize)
+    {
+        GPP::Int cellIndex = GPP::Int((coord - boxMin) / cellSize);
+        if (cellIndex < 0)
+        {
+            return 0;
+        }
+        return cellIndex < CELL_AXIS_COUNT ? cellIndex : CELL_AXIS_COUNT - 1;
+    }
+
+    class GatherCoordTask : public MagicCore::ParallelTask
+    {
+    public:
+        GatherCoordTask(const GPP::TriMesh* triMesh, std::vector<GPP::Real>* pointCoords) :
+            mpTriMesh(triMesh),
+            mpPointCoords(pointCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                GPP::Vector3 coord = mpTriMesh->GetVertexCoord(vid);
+                mpPointCoords->at(vid * 3) = coord[0];
+                mpPointCoords->at(vid * 3 + 1) = coord[1];
+                mpPointCoords->at(vid * 3 + 2) = coord[2];
+            }
+        }
+
+    private:
+        const GPP::TriMesh* mpTriMesh;
+        std::vector<GPP::Real>* mpPointCoords;
+    };
+
+    class PointBoxTask : public MagicCore::ParallelTask
+    {
+    public:
+        PointBoxTask(const std::vector<GPP::Real>* pointCoords, GPP::Int threadCount) :
+            mpPointCoords(pointCoords),
+            mThreadBoxes(threadCount * 6)
+        {
+            for (GPP::Int tid = 0; tid < threadCount; tid++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    mThreadBoxes.at(tid * 6 + axis) = GPP::REAL_LARGE;
+                    mThreadBoxes.at(tid * 6 + 3 + axis) = -GPP::REAL_LARGE;
+                }
+            }
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Real* box = &(mThreadBoxes.at(threadId * 6));
+            for (int pid = startId; pid < endId; pid++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    GPP::Real coord = mpPointCoords->at(pid * 3 + axis);
+                    box[axis] = coord < box[axis] ? coord : box[axis];
+                    box[3 + axis] = coord > box[3 + axis] ? coord : box[3 + axis];
+                }
+            }
+        }
+
+        // Min and max coordinates of the points visited by thread threadId
+        const GPP::Real* GetThreadBox(GPP::Int threadId) const
+        {
+            return &(mThreadBoxes.at(threadId * 6));
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpPointCoords;
+        std::vector<GPP::Real> mThreadBoxes;
+    };
+
+    class CellKeyTask : public MagicCore::ParallelTask
+    {
+    public:
+        CellKeyTask(const std::vector<GPP::Real>* pointCoords, const GPP::Real* boxMin, GPP::Real cellSize, GPP::Int bucketBits,
+            std::vector<GPP::ULongInt>* pointCellKeys, std::vector<GPP::Int>* pointBucketIds) :
+            mpPointCoords(pointCoords),
+            mpBoxMin(boxMin),
+            mCellSize(cellSize),
+            mBucketBits(bucketBits),
+            mpPointCellKeys(pointCellKeys),
+            mpPointBucketIds(pointBucketIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::ULongInt cellKey = PackCellKey(ToCellIndex(mpPointCoords->at(pid * 3), mpBoxMin[0], mCellSize),
+                    ToCellIndex(mpPointCoords->at(pid * 3 + 1), mpBoxMin[1], mCellSize),
+                    ToCellIndex(mpPointCoords->at(pid * 3 + 2), mpBoxMin[2], mCellSize));
+                mpPointCellKeys->at(pid) = cellKey;
+                mpPointBucketIds->at(pid) = HashCellKey(cellKey, mBucketBits);
+            }
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpPointCoords;
+        const GPP::Real* mpBoxMin;
+        GPP::Real mCellSize;
+        GPP::Int mBucketBits;
+        std::vector<GPP::ULongInt>* mpPointCellKeys;
+        std::vector<GPP::Int>* mpPointBucketIds;
+    };
+
+    // Points of one cell share a bucket, so walking the buckets keeps the lookups of a cell in cache
+    class WeldPointTask : public MagicCore::ParallelTask
+    {
+    public:
+        WeldPointTask(const VertexWelder* vertexWelder, const std::vector<GPP::Int>* bucketStart, const std::vector<GPP::Int>* bucketPointIds,
+            const std::vector<GPP::Real>* pointCoords, std::vector<GPP::Int>* weldPointIds) :
+            mpVertexWelder(vertexWelder),
+            mpBucketStart(bucketStart),
+            mpBucketPointIds(bucketPointIds),
+            mpPointCoords(pointCoords),
+            mpWeldPointIds(weldPointIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (GPP::Int bid = mpBucketStart->at(startId); bid < mpBucketStart->at(endId); bid++)
+            {
+                mpVertexWelder->FindWeldPoint(mpBucketPointIds->at(bid), *mpPointCoords, *mpWeldPointIds);
+            }
+        }
+
+    private:
+        const VertexWelder* mpVertexWelder;
+        const std::vector<GPP::Int>* mpBucketStart;
+        const std::vector<GPP::Int>* mpBucketPointIds;
+        const std::vector<GPP::Real>* mpPointCoords;
+        std::vector<GPP::Int>* mpWeldPointIds;
+    };
+
+    VertexWelder::VertexWelder() :
+        mTolerance(0),
+        mMergeAttributes(false),
+        mUsedTolerance(0),
+        mCellSize(0),
+        mBucketBits(0),
+        mBucketStart(),
+        mBucketPointIds(),
+        mBucketCellKeys(),
+        mRemovedTriangleCount(0),
+        mWeldTime(0),
+        mBuildTime(0)
+    {
+        mBoxMin[0] = 0;
+        mBoxMin[1] = 0;
+        mBoxMin[2] = 0;
+    }
+
+    VertexWelder::~VertexWelder()
+    {
+    }
+
+    void VertexWelder::SetTolerance(GPP::Real tolerance)
+    {
+        mTolerance = tolerance;
+    }
+
+    void VertexWelder::SetMergeAttributes(bool mergeAttributes)
+    {
+        mMergeAttributes = mergeAttributes;
+    }
+
+    GPP::TriMesh* VertexWelder::WeldTriMesh(const GPP::TriMesh* triMesh)
+    {
+        mRemovedTriangleCount = 0;
+        mBuildTime = 0;
+        if (triMesh == NULL || triMesh->GetVertexCount() == 0)
+        {
+            return NULL;
+        }
+        GPP::Int pointCount = triMesh->GetVertexCount();
+        std::vector<GPP::Real> pointCoords(pointCount * 3);
+        GatherCoordTask gatherTask(triMesh, &pointCoords);
+        MagicCore::ParallelTool::ParallelFor(pointCount, &gatherTask);
+        std::vector<GPP::Int> pointWeldIds;
+        GPP::Int weldCount = 0;
+        if (Weld(pointCoords, pointWeldIds, weldCount) != GPP_NO_ERROR)
+        {
+            return NULL;
+        }
+
+        double startTime = MagicCore::ToolKit::GetTime();
+        bool hasVertexColor = triMesh->HasVertexColor();
+        std::vector<GPP::Vector3> weldCoords(weldCount, GPP::Vector3(0, 0, 0));
+        std::vector<GPP::Vector3> weldColors(hasVertexColor ? weldCount : 0, GPP::Vector3(0, 0, 0));
+        std::vector<GPP::Int> weldFirstPointIds(weldCount, -1);
+        std::vector<GPP::Int> weldPointCounts(weldCount, 0);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Int weldId = pointWeldIds.at(pid);
+            if (weldFirstPointIds.at(weldId) == -1)
+            {
+                weldFirstPointIds.at(weldId) = pid;
+            }
+            else if (!mMergeAttributes)
+            {
+                continue;
+            }
+            weldCoords.at(weldId) += GPP::Vector3(pointCoords.at(pid * 3), pointCoords.at(pid * 3 + 1), pointCoords.at(pid * 3 + 2));
+            if (hasVertexColor)
+            {
+                weldColors.at(weldId) += triMesh->GetVertexColor(pid);
+            }
+            weldPointCounts.at(weldId)++;
+        }
+        GPP::TriMesh* weldMesh = new GPP::TriMesh;
+        for (GPP::Int weldId = 0; weldId < weldCount; weldId++)
+        {
+            weldMesh->InsertVertex(weldCoords.at(weldId) / GPP::Real(weldPointCounts.at(weldId)));
+        }
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        std::vector<GPP::Int> weldTriangleIds;
+        weldTriangleIds.reserve(triangleCount);
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Int weldId0 = pointWeldIds.at(vertexIds[0]);
+            GPP::Int weldId1 = pointWeldIds.at(vertexIds[1]);
+            GPP::Int weldId2 = pointWeldIds.at(vertexIds[2]);
+            if (weldId0 == weldId1 || weldId1 == weldId2 || weldId2 == weldId0)
+            {
+                mRemovedTriangleCount++;
+                continue;
+            }
+            weldMesh->InsertTriangle(weldId0, weldId1, weldId2);
+            weldTriangleIds.push_back(fid);
+        }
+        if (hasVertexColor)
+        {
+            weldMesh->SetHasVertexColor(true);
+            for (GPP::Int weldId = 0; weldId < weldCount; weldId++)
+            {
+                weldMesh->SetVertexColor(weldId, weldColors.at(weldId) / GPP::Real(weldPointCounts.at(weldId)));
+            }
+        }
+        if (triMesh->HasVertexTexCoord())
+        {
+            weldMesh->SetHasVertexTexCoord(true);
+            for (GPP::Int weldId = 0; weldId < weldCount; weldId++)
+            {
+                weldMesh->SetVertexTexcoord(weldId, triMesh->GetVertexTexcoord(weldFirstPointIds.at(weldId)));
+            }
+        }
+        GPP::Int weldTriangleCount = weldTriangleIds.size();
+        if (triMesh->HasTriangleColor())
+        {
+            weldMesh->SetHasTriangleColor(true);
+            for (GPP::Int weldFid = 0; weldFid < weldTriangleCount; weldFid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    weldMesh->SetTriangleColor(weldFid, localId, triMesh->GetTriangleColor(weldTriangleIds.at(weldFid), localId));
+                }
+            }
+        }
+        if (triMesh->HasTriangleTexCoord())
+        {
+            weldMesh->SetHasTriangleTexCoord(true);
+            for (GPP::Int weldFid = 0; weldFid < weldTriangleCount; weldFid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    weldMesh->SetTriangleTexcoord(weldFid, localId, triMesh->GetTriangleTexcoord(weldTriangleIds.at(weldFid), localId));
+                }
+            }
+        }
+        mBuildTime = MagicCore::ToolKit::GetTime() - startTime;
+        return weldMesh;
+    }
+
+    GPP::ErrorCode VertexWelder::Weld(const std::vector<GPP::Real>& pointCoords, std::vector<GPP::Int>& pointWeldIds, GPP::Int& weldCount)
+    {
+        double startTime = MagicCore::ToolKit::GetTime();
+        weldCount = 0;
+        GPP::Int pointCount = pointCoords.size() / 3;
+        if (pointCount == 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int threadCount = MagicCore::ParallelTool::GetThreadCount();
+        PointBoxTask boxTask(&pointCoords, threadCount);
+        MagicCore::ParallelTool::ParallelFor(pointCount, &boxTask);
+        GPP::Real boxMax[3] = {-GPP::REAL_LARGE, -GPP::REAL_LARGE, -GPP::REAL_LARGE};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mBoxMin[axis] = GPP::REAL_LARGE;
+            for (GPP::Int tid = 0; tid < threadCount; tid++)
+            {
+                GPP::Real threadMin = boxTask.GetThreadBox(tid)[axis];
+                GPP::Real threadMax = boxTask.GetThreadBox(tid)[3 + axis];
+                mBoxMin[axis] = threadMin < mBoxMin[axis] ? threadMin : mBoxMin[axis];
+                boxMax[axis] = threadMax > boxMax[axis] ? threadMax : boxMax[axis];
+            }
+        }
+        GPP::Real maxExtent = 0;
+        GPP::Real diagonalSquared = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real extent = boxMax[axis] - mBoxMin[axis];
+            maxExtent = extent > maxExtent ? extent : maxExtent;
+            diagonalSquared += extent * extent;
+        }
+        mUsedTolerance = mTolerance > 0 ? mTolerance : sqrt(diagonalSquared) * WELD_TOLERANCE_RATIO;
+        if (mUsedTolerance < GPP::REAL_TOL)
+        {
+            mUsedTolerance = GPP::REAL_TOL;
+        }
+        mCellSize = mUsedTolerance * CELL_TOLERANCE_RATIO;
+        if (mCellSize * (CELL_AXIS_COUNT / 2) < maxExtent)
+        {
+            mCellSize = maxExtent / (CELL_AXIS_COUNT / 2);
+        }
+
+        // Counting sort of the points into hash buckets of about 4 points, every bucket keeps increasing point ids
+        mBucketBits = 10;
+        while (mBucketBits < 30 && (1 << mBucketBits) < pointCount / 4)
+        {
+            mBucketBits++;
+        }
+        GPP::Int bucketCount = 1 << mBucketBits;
+        std::vector<GPP::ULongInt> pointCellKeys(pointCount);
+        std::vector<GPP::Int> pointBucketIds(pointCount);
+        CellKeyTask keyTask(&pointCoords, mBoxMin, mCellSize, mBucketBits, &pointCellKeys, &pointBucketIds);
+        MagicCore::ParallelTool::ParallelFor(pointCount, &keyTask);
+        mBucketStart.assign(bucketCount + 1, 0);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            mBucketStart.at(pointBucketIds.at(pid) + 1)++;
+        }
+        for (GPP::Int bid = 0; bid < bucketCount; bid++)
+        {
+            mBucketStart.at(bid + 1) += mBucketStart.at(bid);
+        }
+        mBucketPointIds.resize(pointCount);
+        mBucketCellKeys.resize(pointCount);
+        std::vector<GPP::Int> fillPos(mBucketStart.begin(), mBucketStart.end() - 1);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Int pos = fillPos.at(pointBucketIds.at(pid))++;
+            mBucketPointIds.at(pos) = pid;
+            mBucketCellKeys.at(pos) = pointCellKeys.at(pid);
+        }
+
+        std::vector<GPP::Int> weldPointIds(pointCount);
+        WeldPointTask weldTask(this, &mBucketStart, &mBucketPointIds, &pointCoords, &weldPointIds);
+        MagicCore::ParallelTool::ParallelFor(bucketCount, &weldTask);
+        // The weld point has a smaller id, so following it in increasing id order resolves chains in one pass
+        pointWeldIds.resize(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Int weldPointId = weldPointIds.at(pid);
+            pointWeldIds.at(pid) = (weldPointId == pid) ? weldCount++ : pointWeldIds.at(weldPointId);
+        }
+        mBucketStart.clear();
+        mBucketPointIds.clear();
+        mBucketCellKeys.clear();
+        mWeldTime = MagicCore::ToolKit::GetTime() - startTime;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int VertexWelder::GetRemovedTriangleCount() const
+    {
+        return mRemovedTriangleCount;
+    }
+
+    double VertexWelder::GetWeldTime() const
+    {
+        return mWeldTime;
+    }
+
+    double VertexWelder::GetBuildTime() const
+    {
+        return mBuildTime;
+    }
+
+    void VertexWelder::FindWeldPoint(GPP::Int pointId, const std::vector<GPP::Real>& pointCoords, std::vector<GPP::Int>& weldPointIds) const
+    {
+        const GPP::Real* coord = &(pointCoords.at(pointId * 3));
+        GPP::Int cellIndex[3];
+        GPP::Int offsetMin[3];
+        GPP::Int offsetMax[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            cellIndex[axis] = ToCellIndex(coord[axis], mBoxMin[axis], mCellSize);
+            GPP::Real cellMin = mBoxMin[axis] + cellIndex[axis] * mCellSize;
+            offsetMin[axis] = (cellIndex[axis] > 0 && coord[axis] - cellMin <= mUsedTolerance) ? -1 : 0;
+            offsetMax[axis] = (cellIndex[axis] + 1 < CELL_AXIS_COUNT && cellMin + mCellSize - coord[axis] <= mUsedTolerance) ? 1 : 0;
+        }
+        GPP::Real toleranceSquared = mUsedTolerance * mUsedTolerance;
+        GPP::Int weldPointId = pointId;
+        for (GPP::Int offsetX = offsetMin[0]; offsetX <= offsetMax[0]; offsetX++)
+        {
+            for (GPP::Int offsetY = offsetMin[1]; offsetY <= offsetMax[1]; offsetY++)
+            {
+                for (GPP::Int offsetZ = offsetMin[2]; offsetZ <= offsetMax[2]; offsetZ++)
+                {
+                    GPP::ULongInt cellKey = PackCellKey(cellIndex[0] + offsetX, cellIndex[1] + offsetY, cellIndex[2] + offsetZ);
+                    GPP::Int bucketId = HashCellKey(cellKey, mBucketBits);
+                    GPP::Int bucketEnd = mBucketStart.at(bucketId + 1);
+                    for (GPP::Int bid = mBucketStart.at(bucketId); bid < bucketEnd; bid++)
+                    {
+                        GPP::Int otherId = mBucketPointIds.at(bid);
+                        if (otherId >= weldPointId)
+                        {
+                            break;
+                        }
+                        if (mBucketCellKeys.at(bid) != cellKey)
+                        {
+                            continue;
+                        }
+                        GPP::Real deltaX = pointCoords.at(otherId * 3) - coord[0];
+                        GPP::Real deltaY = pointCoords.at(otherId * 3 + 1) - coord[1];
+                        GPP::Real deltaZ = pointCoords.at(otherId * 3 + 2) - coord[2];
+                        if (deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ <= toleranceSquared)
+                        {
+                            weldPointId = otherId;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        weldPointIds.at(pointId) = weldPointId;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Welds the points of a triangle soup into an indexed mesh, replacing TriMesh::FuseVertex.
+    // Points are quantized into a hash grid with cells much larger than the tolerance. Every point looks up the smallest point id
+    // within tolerance in its own cell, and in the neighbor cells only when it is near a cell border. The lookups run in parallel
+    // and the welded vertices are numbered by their first point, so the result does not depend on the thread count.
+    // USAGE: 1. vertexWelder.SetTolerance(0); vertexWelder.SetMergeAttributes(true);
+    //        2. GPP::TriMesh* indexedMesh = vertexWelder.WeldTriMesh(soupMesh);
+    //        or vertexWelder.Weld(pointCoords, pointWeldIds, weldCount);
+    class VertexWelder
+    {
+    public:
+        VertexWelder();
+        ~VertexWelder();
+
+        // tolerance <= 0 uses a small ratio of the bounding box diagonal
+        void SetTolerance(GPP::Real tolerance);
+        // true: a welded vertex takes the average coordinate and color of its points, false: the ones of its first point
+        void SetMergeAttributes(bool mergeAttributes);
+
+        // Return a new indexed mesh without the triangles collapsed by welding, triMesh is not changed. NULL if failed
+        GPP::TriMesh* WeldTriMesh(const GPP::TriMesh* triMesh);
+        // pointCoords: 3 values per point. pointWeldIds: welded vertex id of every point, weldCount: welded vertex count
+        GPP::ErrorCode Weld(const std::vector<GPP::Real>& pointCoords, std::vector<GPP::Int>& pointWeldIds, GPP::Int& weldCount);
+
+        GPP::Int GetRemovedTriangleCount(void) const;
+        double GetWeldTime(void) const;
+        double GetBuildTime(void) const;
+
+    private:
+        void FindWeldPoint(GPP::Int pointId, const std::vector<GPP::Real>& pointCoords, std::vector<GPP::Int>& weldPointIds) const;
+        friend class WeldPointTask;
+
+    private:
+        GPP::Real mTolerance;
+        bool mMergeAttributes;
+        GPP::Real mUsedTolerance;
+        GPP::Real mCellSize;
+        GPP::Real mBoxMin[3];
+        GPP::Int mBucketBits;
+        std::vector<GPP::Int> mBucketStart;
+        std::vector<GPP::Int> mBucketPointIds;
+        std::vector<GPP::ULongInt> mBucketCellKeys;
+        GPP::Int mRemovedTriangleCount;
+        double mWeldTime;
+        double mBuildTime;
+    };
+}
@@ -0,0 +1,1025 @@
+#include "WorkspaceFile.h"
+#include "ModelManager.h"
+#include "AttributeStore.h"
+#include "../Common/ParallelTool.h"
+#include "../Common/ToolKit.h"
+#include "../Common/LogSystem.h"
+#include <windows.h>
+#include <fstream>
+#include <string.h>
+
+namespace MagicApp
+{
+    // File layout: header | section blocks | section table
+    // header: char magic[8], uint32 version, uint32 section count, uint64 section table offset
+    // table entry: uint32 name length, name, uint32 value type, uint32 component count, uint64 element count,
+    //              uint64 data offset, uint32 block count, block count * (uint32 raw size, uint32 stored size)
+    // A block is stored as it is if encoding does not make it smaller, then stored size == raw size
+    static const char WORKSPACE_MAGIC[8] = { 'M', 'A', 'G', 'I', 'C', 'W', 'S', '\0' };
+    static const unsigned int WORKSPACE_VERSION = 1;
+    static const GPP::ULongInt HEADER_SIZE = 24;
+    static const GPP::ULongInt BLOCK_BYTE_COUNT = 1 << 20;
+    static const GPP::Int BATCH_BLOCK_COUNT = 16;
+    static const GPP::Int MIN_RUN_LENGTH = 3;
+    static const GPP::Int MAX_RUN_LENGTH = 130;
+    static const GPP::Int MAX_LITERAL_LENGTH = 128;
+
+    static const char* TRANSFORM_SECTION = "Workspace.Transform";
+    static const char* TEXTURE_FILES_SECTION = "Workspace.TextureFiles";
+    static const char* POINTCLOUD_COORD_SECTION = "PointCloud.Coord";
+    static const char* POINTCLOUD_NORMAL_SECTION = "PointCloud.Normal";
+    static const char* POINTCLOUD_COLOR_SECTION = "PointCloud.Color";
+    static const char* POINTCLOUD_ATTRIBUTE_PREFIX = "PointCloud.Attribute.";
+    static const char* MESH_COORD_SECTION = "Mesh.Coord";
+    static const char* MESH_COLOR_SECTION = "Mesh.Color";
+    static const char* MESH_TRIANGLE_SECTION = "Mesh.Triangle";
+    static const char* MESH_VERTEX_TEXCOORD_SECTION = "Mesh.VertexTexCoord";
+    static const char* MESH_TRIANGLE_TEXCOORD_SECTION = "Mesh.TriangleTexCoord";
+    static const char* MESH_ATTRIBUTE_PREFIX = "Mesh.Attribute.";
+
+    enum WorkspaceValueType
+    {
+        WVT_BYTE = 1,
+        WVT_INT32,
+        WVT_FLOAT64
+    };
+
+    static GPP::Int GetValueSize(unsigned int valueType)
+    {
+        switch (valueType)
+        {
+        case WVT_BYTE:
+            return 1;
+        case WVT_INT32:
+            return 4;
+        case WVT_FLOAT64:
+            return 8;
+        default:
+            return 0;
+        }
+    }
+
+    // Byte b of value i goes to b * valueCount + i, so the slowly changing high bytes of neighbouring values
+    // become long runs. A tail shorter than one value is copied as it is
+    static void ShuffleBytes(const char* data, GPP::Int byteCount, GPP::Int valueSize, char* shuffled)
+    {
+        GPP::Int valueCount = byteCount / valueSize;
+        for (GPP::Int vid = 0; vid < valueCount; vid++)
+        {
+            for (GPP::Int bid = 0; bid < valueSize; bid++)
+            {
+                shuffled[bid * valueCount + vid] = data[vid * valueSize + bid];
+            }
+        }
+        GPP::Int tailStart = valueCount * valueSize;
+        memcpy(shuffled + tailStart, data + tailStart, byteCount - tailStart);
+    }
+
+    static void UnshuffleBytes(const char* shuffled, GPP::Int byteCount, GPP::Int valueSize, char* data)
+    {
+        GPP::Int valueCount = byteCount / valueSize;
+        for (GPP::Int vid = 0; vid < valueCount; vid++)
+        {
+            for (GPP::Int bid = 0; bid < valueSize; bid++)
+            {
+                data[vid * valueSize + bid] = shuffled[bid * valueCount + vid];
+            }
+        }
+        GPP::Int tailStart = valueCount * valueSize;
+        memcpy(data + tailStart, shuffled + tailStart, byteCount - tailStart);
+    }
+
+    static void FlushLiterals(const unsigned char* data, GPP::Int startId, GPP::Int endId, std::vector<char>& encoded)
+    {
+        while (startId < endId)
+        {
+            GPP::Int literalCount = endId - startId < MAX_LITERAL_LENGTH ? endId - startId : MAX_LITERAL_LENGTH;
+            encoded.push_back(char(literalCount - 1));
+            encoded.insert(encoded.end(), data + startId, data + startId + literalCount);
+            startId += literalCount;
+        }
+    }
+
+    // Control byte c < 128 is followed by c + 1 literal bytes, c >= 128 by one byte that is repeated c - 125 times
+    static void EncodeRuns(const unsigned char* data, GPP::Int byteCount, std::vector<char>& encoded)
+    {
+        encoded.clear();
+        encoded.reserve(byteCount / 2);
+        GPP::Int literalStart = 0;
+        GPP::Int pos = 0;
+        while (pos < byteCount)
+        {
+            GPP::Int runLength = 1;
+            while (pos + runLength < byteCount && runLength < MAX_RUN_LENGTH && data[pos + runLength] == data[pos])
+            {
+                runLength++;
+            }
+            if (runLength >= MIN_RUN_LENGTH)
+            {
+                FlushLiterals(data, literalStart, pos, encoded);
+                encoded.push_back(char(runLength + 125));
+                encoded.push_back(char(data[pos]));
+                literalStart = pos + runLength;
+            }
+            pos += runLength;
+        }
+        FlushLiterals(data, literalStart, byteCount, encoded);
+    }
+
+    static bool DecodeRuns(const unsigned char* encoded, GPP::Int encodedCount, unsigned char* data, GPP::Int byteCount)
+    {
+        GPP::Int inPos = 0;
+        GPP::Int outPos = 0;
+        while (inPos < encodedCount)
+        {
+            int control = encoded[inPos++];
+            if (control < 128)
+            {
+                GPP::Int literalCount = control + 1;
+                if (inPos + literalCount > encodedCount || outPos + literalCount > byteCount)
+                {
+                    return false;
+                }
+                memcpy(data + outPos, encoded + inPos, literalCount);
+                inPos += literalCount;
+                outPos += literalCount;
+            }
+            else
+            {
+                GPP::Int runLength = control - 125;
+                if (inPos >= encodedCount || outPos + runLength > byteCount)
+                {
+                    return false;
+                }
+                memset(data + outPos, encoded[inPos++], runLength);
+                outPos += runLength;
+            }
+        }
+        return outPos == byteCount;
+    }
+
+    struct WorkspaceSection
+    {
+        std::string mName;
+        unsigned int mValueType;
+        unsigned int mComponentCount;
+        GPP::ULongInt mElementCount;
+        GPP::ULongInt mDataOffset;
+        std::vector<unsigned int> mRawSizes;
+        std::vector<unsigned int> mStoredSizes;
+        // File offset of each block, only filled by WorkspaceReader
+        std::vector<GPP::ULongInt> mBlockOffsets;
+    };
+
+    class EncodeBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        EncodeBlockTask(const char* data, GPP::ULongInt byteCount, GPP::Int valueSize, GPP::Int firstBlockId, std::vector<std::vector<char> >& blocks) :
+            mpData(data),
+            mByteCount(byteCount),
+            mValueSize(valueSize),
+            mFirstBlockId(firstBlockId),
+            mBlocks(blocks)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            std::vector<char> shuffled;
+            for (int bid = startId; bid < endId; bid++)
+            {
+                GPP::ULongInt blockStart = GPP::ULongInt(mFirstBlockId + bid) * BLOCK_BYTE_COUNT;
+                GPP::Int rawSize = GPP::Int(mByteCount - blockStart < BLOCK_BYTE_COUNT ? mByteCount - blockStart : BLOCK_BYTE_COUNT);
+                const char* raw = mpData + blockStart;
+                shuffled.resize(rawSize);
+                ShuffleBytes(raw, rawSize, mValueSize, &shuffled.at(0));
+                std::vector<char>& block = mBlocks.at(bid);
+                EncodeRuns((const unsigned char*)&shuffled.at(0), rawSize, block);
+                if (GPP::Int(block.size()) >= rawSize)
+                {
+                    block.assign(raw, raw + rawSize);
+                }
+            }
+        }
+
+    private:
+        const char* mpData;
+        GPP::ULongInt mByteCount;
+        GPP::Int mValueSize;
+        GPP::Int mFirstBlockId;
+        std::vector<std::vector<char> >& mBlocks;
+    };
+
+    class DecodeBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        DecodeBlockTask(const char* fileData, const WorkspaceSection* section, char* values, std::vector<int>& blockStates) :
+            mpFileData(fileData),
+            mpSection(section),
+            mpValues(values),
+            mBlockStates(blockStates)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int valueSize = GetValueSize(mpSection->mValueType);
+            std::vector<char> shuffled;
+            for (int bid = startId; bid < endId; bid++)
+            {
+                GPP::Int rawSize = mpSection->mRawSizes.at(bid);
+                GPP::Int storedSize = mpSection->mStoredSizes.at(bid);
+                const char* stored = mpFileData + mpSection->mBlockOffsets.at(bid);
+                char* raw = mpValues + GPP::ULongInt(bid) * BLOCK_BYTE_COUNT;
+                if (storedSize == rawSize)
+                {
+                    memcpy(raw, stored, rawSize);
+                    mBlockStates.at(bid) = 1;
+                    continue;
+                }
+                shuffled.resize(rawSize);
+                if (DecodeRuns((const unsigned char*)stored, storedSize, (unsigned char*)&shuffled.at(0), rawSize))
+                {
+                    UnshuffleBytes(&shuffled.at(0), rawSize, valueSize, raw);
+                    mBlockStates.at(bid) = 1;
+                }
+            }
+        }
+
+    private:
+        const char* mpFileData;
+        const WorkspaceSection* mpSection;
+        char* mpValues;
+        std::vector<int>& mBlockStates;
+    };
+
+    class WorkspaceWriter
+    {
+    public:
+        WorkspaceWriter() :
+            mFile(),
+            mSections(),
+            mOffset(0)
+        {
+        }
+
+        bool Open(const std::string& fileName)
+        {
+            mFile.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!mFile)
+            {
+                return false;
+            }
+            // Section count and table offset are filled by Close
+            char header[HEADER_SIZE];
+            memset(header, 0, HEADER_SIZE);
+            memcpy(header, WORKSPACE_MAGIC, sizeof(WORKSPACE_MAGIC));
+            memcpy(header + 8, &WORKSPACE_VERSION, 4);
+            mFile.write(header, HEADER_SIZE);
+            mOffset = HEADER_SIZE;
+            return mFile.good();
+        }
+
+        bool WriteSection(const std::string& name, unsigned int valueType, unsigned int componentCount, const void* values, GPP::ULongInt elementCount)
+        {
+            WorkspaceSection section;
+            section.mName = name;
+            section.mValueType = valueType;
+            section.mComponentCount = componentCount;
+            section.mElementCount = elementCount;
+            section.mDataOffset = mOffset;
+            GPP::Int valueSize = GetValueSize(valueType);
+            GPP::ULongInt byteCount = elementCount * componentCount * valueSize;
+            GPP::Int blockCount = GPP::Int((byteCount + BLOCK_BYTE_COUNT - 1) / BLOCK_BYTE_COUNT);
+            std::vector<std::vector<char> > blocks;
+            for (GPP::Int batchStart = 0; batchStart < blockCount; batchStart += BATCH_BLOCK_COUNT)
+            {
+                GPP::Int batchCount = blockCount - batchStart < BATCH_BLOCK_COUNT ? blockCount - batchStart : BATCH_BLOCK_COUNT;
+                blocks.resize(batchCount);
+                EncodeBlockTask encodeTask((const char*)values, byteCount, valueSize, batchStart, blocks);
+                MagicCore::ParallelTool::ParallelFor(batchCount, &encodeTask, 1);
+                for (GPP::Int bid = 0; bid < batchCount; bid++)
+                {
+                    GPP::ULongInt blockStart = GPP::ULongInt(batchStart + bid) * BLOCK_BYTE_COUNT;
+                    section.mRawSizes.push_back((unsigned int)(byteCount - blockStart < BLOCK_BYTE_COUNT ? byteCount - blockStart : BLOCK_BYTE_COUNT));
+                    section.mStoredSizes.push_back((unsigned int)blocks.at(bid).size());
+                    mFile.write(&blocks.at(bid).at(0), blocks.at(bid).size());
+                    mOffset += blocks.at(bid).size();
+                }
+            }
+            mSections.push_back(section);
+            return mFile.good();
+        }
+
+        bool Close()
+        {
+            GPP::ULongInt tableOffset = mOffset;
+            for (std::vector<WorkspaceSection>::const_iterator itr = mSections.begin(); itr != mSections.end(); ++itr)
+            {
+                unsigned int nameLength = (unsigned int)itr->mName.size();
+                unsigned int blockCount = (unsigned int)itr->mRawSizes.size();
+                mFile.write((const char*)&nameLength, 4);
+                mFile.write(itr->mName.c_str(), nameLength);
+                mFile.write((const char*)&itr->mValueType, 4);
+                mFile.write((const char*)&itr->mComponentCount, 4);
+                mFile.write((const char*)&itr->mElementCount, 8);
+                mFile.write((const char*)&itr->mDataOffset, 8);
+                mFile.write((const char*)&blockCount, 4);
+                for (unsigned int bid = 0; bid < blockCount; bid++)
+                {
+                    mFile.write((const char*)&itr->mRawSizes.at(bid), 4);
+                    mFile.write((const char*)&itr->mStoredSizes.at(bid), 4);
+                }
+            }
+            unsigned int sectionCount = (unsigned int)mSections.size();
+            mFile.seekp(12);
+            mFile.write((const char*)&sectionCount, 4);
+            mFile.write((const char*)&tableOffset, 8);
+            bool isGood = mFile.good();
+            mFile.close();
+            return isGood;
+        }
+
+    private:
+        std::ofstream mFile;
+        std::vector<WorkspaceSection> mSections;
+        GPP::ULongInt mOffset;
+    };
+
+    // Keeps the file mapped while lazy channels still need it. Freed by the last Release
+    class WorkspaceReader
+    {
+    public:
+        WorkspaceReader() :
+            mpFileHandle(NULL),
+            mpMappingHandle(NULL),
+            mpFileData(NULL),
+            mFileSize(0),
+            mSections(),
+            mRefCount(1)
+        {
+        }
+
+        void AddRef()
+        {
+            mRefCount++;
+        }
+
+        void Release()
+        {
+            mRefCount--;
+            if (mRefCount == 0)
+            {
+                delete this;
+            }
+        }
+
+        bool Open(const std::string& fileName)
+        {
+            HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL, NULL);
+            if (fileHandle == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+            mpFileHandle = fileHandle;
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(fileHandle, &fileSize) || GPP::ULongInt(fileSize.QuadPart) < HEADER_SIZE)
+            {
+                return false;
+            }
+            mFileSize = GPP::ULongInt(fileSize.QuadPart);
+            mpMappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mpMappingHandle == NULL)
+            {
+                return false;
+            }
+            mpFileData = (const char*)MapViewOfFile(mpMappingHandle, FILE_MAP_READ, 0, 0, 0);
+            if (mpFileData == NULL)
+            {
+                return false;
+            }
+            return ReadSectionTable();
+        }
+
+        const WorkspaceSection* FindSection(const std::string& name) const
+        {
+            for (std::vector<WorkspaceSection>::const_iterator itr = mSections.begin(); itr != mSections.end(); ++itr)
+            {
+                if (itr->mName == name)
+                {
+                    return &(*itr);
+                }
+            }
+            return NULL;
+        }
+
+        void GetSections(const std::string& prefix, std::vector<const WorkspaceSection*>& sections) const
+        {
+            sections.clear();
+            for (std::vector<WorkspaceSection>::const_iterator itr = mSections.begin(); itr != mSections.end(); ++itr)
+            {
+                if (itr->mName.compare(0, prefix.size(), prefix) == 0)
+                {
+                    sections.push_back(&(*itr));
+                }
+            }
+        }
+
+        // values has room for every value of the section
+        bool ReadSection(const WorkspaceSection* section, void* values) const
+        {
+            GPP::Int blockCount = section->mRawSizes.size();
+            std::vector<int> blockStates(blockCount, 0);
+            DecodeBlockTask decodeTask(mpFileData, section, (char*)values, blockStates);
+            MagicCore::ParallelTool::ParallelFor(blockCount, &decodeTask, 1);
+            for (GPP::Int bid = 0; bid < blockCount; bid++)
+            {
+                if (blockStates.at(bid) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        ~WorkspaceReader()
+        {
+            if (mpFileData != NULL)
+            {
+                UnmapViewOfFile(mpFileData);
+            }
+            if (mpMappingHandle != NULL)
+            {
+                CloseHandle(mpMappingHandle);
+            }
+            if (mpFileHandle != NULL)
+            {
+                CloseHandle(mpFileHandle);
+            }
+        }
+
+        bool ReadField(GPP::ULongInt& cursor, void* value, GPP::ULongInt size, GPP::ULongInt endOffset) const
+        {
+            if (cursor + size > endOffset)
+            {
+                return false;
+            }
+            memcpy(value, mpFileData + cursor, size);
+            cursor += size;
+            return true;
+        }
+
+        bool ReadSectionTable()
+        {
+            if (memcmp(mpFileData, WORKSPACE_MAGIC, sizeof(WORKSPACE_MAGIC)) != 0)
+            {
+                return false;
+            }
+            unsigned int version = 0;
+            unsigned int sectionCount = 0;
+            GPP::ULongInt tableOffset = 0;
+            memcpy(&version, mpFileData + 8, 4);
+            memcpy(&sectionCount, mpFileData + 12, 4);
+            memcpy(&tableOffset, mpFileData + 16, 8);
+            if (version != WORKSPACE_VERSION || tableOffset < HEADER_SIZE || tableOffset > mFileSize)
+            {
+                return false;
+            }
+            GPP::ULongInt cursor = tableOffset;
+            mSections.resize(sectionCount);
+            for (unsigned int sid = 0; sid < sectionCount; sid++)
+            {
+                WorkspaceSection& section = mSections.at(sid);
+                unsigned int nameLength = 0;
+                unsigned int blockCount = 0;
+                if (!ReadField(cursor, &nameLength, 4, mFileSize) || cursor + nameLength > mFileSize)
+                {
+                    return false;
+                }
+                section.mName.assign(mpFileData + cursor, nameLength);
+                cursor += nameLength;
+                if (!ReadField(cursor, &section.mValueType, 4, mFileSize) || !ReadField(cursor, &section.mComponentCount, 4, mFileSize) ||
+                    !ReadField(cursor, &section.mElementCount, 8, mFileSize) || !ReadField(cursor, &section.mDataOffset, 8, mFileSize) ||
+                    !ReadField(cursor, &blockCount, 4, mFileSize))
+                {
+                    return false;
+                }
+                GPP::Int valueSize = GetValueSize(section.mValueType);
+                if (valueSize == 0 || section.mComponentCount == 0 || cursor + GPP::ULongInt(blockCount) * 8 > mFileSize)
+                {
+                    return false;
+                }
+                // Every block but the last is full, so block bid decodes to bid * BLOCK_BYTE_COUNT
+                GPP::ULongInt byteCount = section.mElementCount * section.mComponentCount * valueSize;
+                if (GPP::ULongInt(blockCount) != (byteCount + BLOCK_BYTE_COUNT - 1) / BLOCK_BYTE_COUNT)
+                {
+                    return false;
+                }
+                section.mRawSizes.resize(blockCount);
+                section.mStoredSizes.resize(blockCount);
+                section.mBlockOffsets.resize(blockCount);
+                GPP::ULongInt blockOffset = section.mDataOffset;
+                for (unsigned int bid = 0; bid < blockCount; bid++)
+                {
+                    ReadField(cursor, &section.mRawSizes.at(bid), 4, mFileSize);
+                    ReadField(cursor, &section.mStoredSizes.at(bid), 4, mFileSize);
+                    GPP::ULongInt blockStart = GPP::ULongInt(bid) * BLOCK_BYTE_COUNT;
+                    GPP::ULongInt rawSize = byteCount - blockStart < BLOCK_BYTE_COUNT ? byteCount - blockStart : BLOCK_BYTE_COUNT;
+                    if (section.mRawSizes.at(bid) != rawSize || section.mStoredSizes.at(bid) > rawSize)
+                    {
+                        return false;
+                    }
+                    section.mBlockOffsets.at(bid) = blockOffset;
+                    blockOffset += section.mStoredSizes.at(bid);
+                }
+                if (blockOffset > tableOffset)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        void* mpFileHandle;
+        void* mpMappingHandle;
+        const char* mpFileData;
+        GPP::ULongInt mFileSize;
+        std::vector<WorkspaceSection> mSections;
+        int mRefCount;
+    };
+
+    static int GetDefaultIntValue(const std::string& channelName)
+    {
+        return channelName == IMAGE_COLOR_ID_FLAG_CHANNEL ? 0 : -1;
+    }
+
+    // int channels have one component, GPP::ImageColorId channels three: image index, local x, local y
+    class WorkspaceChannelLoader : public AttributeChannelLoader
+    {
+    public:
+        WorkspaceChannelLoader(WorkspaceReader* reader, const WorkspaceSection* section) :
+            mpReader(reader),
+            mpSection(section)
+        {
+            mpReader->AddRef();
+        }
+
+        virtual ~WorkspaceChannelLoader()
+        {
+            mpReader->Release();
+        }
+
+        virtual GPP::Int GetSize() const
+        {
+            return GPP::Int(mpSection->mElementCount);
+        }
+
+        virtual void Load(const std::string& name, AttributeStore* store)
+        {
+            std::vector<int> values(mpSection->mElementCount * mpSection->mComponentCount);
+            if (!values.empty() && !mpReader->ReadSection(mpSection, &values.at(0)))
+            {
+                ErrorLog << "WorkspaceChannelLoader::Load channel " << name << " is corrupt" << std::endl;
+                return;
+            }
+            if (mpSection->mComponentCount == 1)
+            {
+                store->SwapChannel(name, values, GetDefaultIntValue(name));
+                return;
+            }
+            std::vector<GPP::ImageColorId>& imageColorIds = store->AddChannel(name, GPP::ImageColorId(-1, 0, 0));
+            GPP::Int valueCount = GetSize();
+            imageColorIds.resize(valueCount);
+            for (GPP::Int vid = 0; vid < valueCount; vid++)
+            {
+                imageColorIds.at(vid).Set(values.at(vid * 3), values.at(vid * 3 + 1), values.at(vid * 3 + 2));
+            }
+        }
+
+    private:
+        WorkspaceReader* mpReader;
+        const WorkspaceSection* mpSection;
+    };
+
+    template<class T>
+    static bool WriteValues(WorkspaceWriter& writer, const std::string& name, unsigned int valueType, unsigned int componentCount, const std::vector<T>& values)
+    {
+        return writer.WriteSection(name, valueType, componentCount, values.empty() ? NULL : &values.at(0), values.size() / componentCount);
+    }
+
+    // Missing section or another layout returns false
+    template<class T>
+    static bool ReadValues(const WorkspaceReader* reader, const std::string& name, unsigned int valueType, unsigned int componentCount, std::vector<T>& values)
+    {
+        const WorkspaceSection* section = reader->FindSection(name);
+        if (section == NULL || section->mValueType != valueType || section->mComponentCount != componentCount)
+        {
+            return false;
+        }
+        values.resize(section->mElementCount * componentCount);
+        return values.empty() || reader->ReadSection(section, &values.at(0));
+    }
+
+    static void PushVector3(const GPP::Vector3& value, std::vector<double>& values)
+    {
+        values.push_back(value[0]);
+        values.push_back(value[1]);
+        values.push_back(value[2]);
+    }
+
+    static GPP::Vector3 GetVector3(const std::vector<double>& values, GPP::Int id)
+    {
+        return GPP::Vector3(values.at(id * 3), values.at(id * 3 + 1), values.at(id * 3 + 2));
+    }
+
+    static bool WritePointCloud(WorkspaceWriter& writer, const GPP::PointCloud* pointCloud)
+    {
+        if (pointCloud == NULL)
+        {
+            return true;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        std::vector<double> values;
+        values.reserve(pointCount * 3);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            PushVector3(pointCloud->GetPointCoord(pid), values);
+        }
+        if (!WriteValues(writer, POINTCLOUD_COORD_SECTION, WVT_FLOAT64, 3, values))
+        {
+            return false;
+        }
+        if (pointCloud->HasNormal())
+        {
+            values.clear();
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                PushVector3(pointCloud->GetPointNormal(pid), values);
+            }
+            if (!WriteValues(writer, POINTCLOUD_NORMAL_SECTION, WVT_FLOAT64, 3, values))
+            {
+                return false;
+            }
+        }
+        if (pointCloud->HasColor())
+        {
+            values.clear();
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                PushVector3(pointCloud->GetPointColor(pid), values);
+            }
+            if (!WriteValues(writer, POINTCLOUD_COLOR_SECTION, WVT_FLOAT64, 3, values))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Normals are not written, they are recomputed on load like after every mesh import
+    static bool WriteTriMesh(WorkspaceWriter& writer, const GPP::TriMesh* triMesh)
+    {
+        if (triMesh == NULL)
+        {
+            return true;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        std::vector<double> values;
+        values.reserve(vertexCount * 3);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            PushVector3(triMesh->GetVertexCoord(vid), values);
+        }
+        if (!WriteValues(writer, MESH_COORD_SECTION, WVT_FLOAT64, 3, values))
+        {
+            return false;
+        }
+        if (triMesh->HasVertexColor())
+        {
+            values.clear();
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                PushVector3(triMesh->GetVertexColor(vid), values);
+            }
+            if (!WriteValues(writer, MESH_COLOR_SECTION, WVT_FLOAT64, 3, values))
+            {
+                return false;
+            }
+        }
+        if (triMesh->HasVertexTexCoord())
+        {
+            values.clear();
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                PushVector3(triMesh->GetVertexTexcoord(vid), values);
+            }
+            if (!WriteValues(writer, MESH_VERTEX_TEXCOORD_SECTION, WVT_FLOAT64, 3, values))
+            {
+                return false;
+            }
+        }
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        std::vector<int> triangleVertexIds(triangleCount * 3);
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            triangleVertexIds.at(fid * 3) = vertexIds[0];
+            triangleVertexIds.at(fid * 3 + 1) = vertexIds[1];
+            triangleVertexIds.at(fid * 3 + 2) = vertexIds[2];
+        }
+        if (!WriteValues(writer, MESH_TRIANGLE_SECTION, WVT_INT32, 3, triangleVertexIds))
+        {
+            return false;
+        }
+        if (triMesh->HasTriangleTexCoord())
+        {
+            values.clear();
+            values.reserve(triangleCount * 9);
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                for (GPP::Int localVid = 0; localVid < 3; localVid++)
+                {
+                    PushVector3(triMesh->GetTriangleTexcoord(fid, localVid), values);
+                }
+            }
+            if (!WriteValues(writer, MESH_TRIANGLE_TEXCOORD_SECTION, WVT_FLOAT64, 9, values))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool WriteAttributes(WorkspaceWriter& writer, const std::string& prefix, AttributeStore* attributes)
+    {
+        std::vector<std::string> names;
+        attributes->GetChannelNames(names);
+        for (std::vector<std::string>::iterator itr = names.begin(); itr != names.end(); ++itr)
+        {
+            const std::vector<int>* intValues = attributes->GetChannel<int>(*itr);
+            if (intValues)
+            {
+                if (!WriteValues(writer, prefix + *itr, WVT_INT32, 1, *intValues))
+                {
+                    return false;
+                }
+                continue;
+            }
+            const std::vector<GPP::ImageColorId>* imageColorIds = attributes->GetChannel<GPP::ImageColorId>(*itr);
+            if (imageColorIds)
+            {
+                std::vector<int> values;
+                values.reserve(imageColorIds->size() * 3);
+                for (std::vector<GPP::ImageColorId>::const_iterator idItr = imageColorIds->begin(); idItr != imageColorIds->end(); ++idItr)
+                {
+                    values.push_back(idItr->GetImageIndex());
+                    values.push_back(idItr->GetLocalX());
+                    values.push_back(idItr->GetLocalY());
+                }
+                if (!WriteValues(writer, prefix + *itr, WVT_INT32, 3, values))
+                {
+                    return false;
+                }
+                continue;
+            }
+            WarnLog << "WorkspaceFile skips channel " << *itr << ", only int and GPP::ImageColorId channels are saved" << std::endl;
+        }
+        return true;
+    }
+
+    static bool ReadPointCloud(const WorkspaceReader* reader, GPP::PointCloud*& pointCloud)
+    {
+        pointCloud = NULL;
+        if (reader->FindSection(POINTCLOUD_COORD_SECTION) == NULL)
+        {
+            return true;
+        }
+        std::vector<double> coords, normals, colors;
+        if (!ReadValues(reader, POINTCLOUD_COORD_SECTION, WVT_FLOAT64, 3, coords))
+        {
+            return false;
+        }
+        bool hasNormal = reader->FindSection(POINTCLOUD_NORMAL_SECTION) != NULL;
+        bool hasColor = reader->FindSection(POINTCLOUD_COLOR_SECTION) != NULL;
+        if ((hasNormal && (!ReadValues(reader, POINTCLOUD_NORMAL_SECTION, WVT_FLOAT64, 3, normals) || normals.size() != coords.size())) ||
+            (hasColor && (!ReadValues(reader, POINTCLOUD_COLOR_SECTION, WVT_FLOAT64, 3, colors) || colors.size() != coords.size())))
+        {
+            return false;
+        }
+        pointCloud = new GPP::PointCloud(hasNormal, hasColor);
+        GPP::Int pointCount = coords.size() / 3;
+        pointCloud->ReservePoint(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            if (hasNormal)
+            {
+                pointCloud->InsertPoint(GetVector3(coords, pid), GetVector3(normals, pid));
+            }
+            else
+            {
+                pointCloud->InsertPoint(GetVector3(coords, pid));
+            }
+        }
+        if (hasColor)
+        {
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                pointCloud->SetPointColor(pid, GetVector3(colors, pid));
+            }
+        }
+        return true;
+    }
+
+    static bool ReadTriMesh(const WorkspaceReader* reader, GPP::TriMesh*& triMesh)
+    {
+        triMesh = NULL;
+        if (reader->FindSection(MESH_COORD_SECTION) == NULL)
+        {
+            return true;
+        }
+        std::vector<double> coords, colors, vertexTexCoords, triangleTexCoords;
+        std::vector<int> triangleVertexIds;
+        if (!ReadValues(reader, MESH_COORD_SECTION, WVT_FLOAT64, 3, coords) || !ReadValues(reader, MESH_TRIANGLE_SECTION, WVT_INT32, 3, triangleVertexIds))
+        {
+            return false;
+        }
+        bool hasColor = reader->FindSection(MESH_COLOR_SECTION) != NULL;
+        bool hasVertexTexCoord = reader->FindSection(MESH_VERTEX_TEXCOORD_SECTION) != NULL;
+        bool hasTriangleTexCoord = reader->FindSection(MESH_TRIANGLE_TEXCOORD_SECTION) != NULL;
+        if ((hasColor && (!ReadValues(reader, MESH_COLOR_SECTION, WVT_FLOAT64, 3, colors) || colors.size() != coords.size())) ||
+            (hasVertexTexCoord && (!ReadValues(reader, MESH_VERTEX_TEXCOORD_SECTION, WVT_FLOAT64, 3, vertexTexCoords) || vertexTexCoords.size() != coords.size())) ||
+            (hasTriangleTexCoord && (!ReadValues(reader, MESH_TRIANGLE_TEXCOORD_SECTION, WVT_FLOAT64, 9, triangleTexCoords) ||
+            triangleTexCoords.size() != triangleVertexIds.size() * 3)))
+        {
+            return false;
+        }
+        GPP::Int vertexCount = coords.size() / 3;
+        for (std::vector<int>::iterator itr = triangleVertexIds.begin(); itr != triangleVertexIds.end(); ++itr)
+        {
+            if (*itr < 0 || *itr >= vertexCount)
+            {
+                return false;
+            }
+        }
+        triMesh = new GPP::TriMesh(hasColor, hasVertexTexCoord, hasTriangleTexCoord);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            triMesh->InsertVertex(GetVector3(coords, vid));
+        }
+        GPP::Int triangleCount = triangleVertexIds.size() / 3;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->InsertTriangle(triangleVertexIds.at(fid * 3), triangleVertexIds.at(fid * 3 + 1), triangleVertexIds.at(fid * 3 + 2));
+        }
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            if (hasColor)
+            {
+                triMesh->SetVertexColor(vid, GetVector3(colors, vid));
+            }
+            if (hasVertexTexCoord)
+            {
+                triMesh->SetVertexTexcoord(vid, GetVector3(vertexTexCoords, vid));
+            }
+        }
+        if (hasTriangleTexCoord)
+        {
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                for (GPP::Int localVid = 0; localVid < 3; localVid++)
+                {
+                    triMesh->SetTriangleTexcoord(fid, localVid, GetVector3(triangleTexCoords, fid * 3 + localVid));
+                }
+            }
+        }
+        triMesh->UpdateNormal();
+        return true;
+    }
+
+    static void AddChannelLoaders(WorkspaceReader* reader, const std::string& prefix, AttributeStore* attributes)
+    {
+        attributes->Clear();
+        std::vector<const WorkspaceSection*> sections;
+        reader->GetSections(prefix, sections);
+        for (std::vector<const WorkspaceSection*>::iterator itr = sections.begin(); itr != sections.end(); ++itr)
+        {
+            if ((*itr)->mValueType != WVT_INT32 || ((*itr)->mComponentCount != 1 && (*itr)->mComponentCount != 3))
+            {
+                DebugLog << "WorkspaceFile skips section " << (*itr)->mName << std::endl;
+                continue;
+            }
+            attributes->AddChannelLoader((*itr)->mName.substr(prefix.size()), new WorkspaceChannelLoader(reader, *itr));
+        }
+    }
+
+    bool WorkspaceFile::IsWorkspaceFile(const std::string& fileName)
+    {
+        std::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+        char magic[sizeof(WORKSPACE_MAGIC)];
+        if (!fin || !fin.read(magic, sizeof(magic)))
+        {
+            return false;
+        }
+        return memcmp(magic, WORKSPACE_MAGIC, sizeof(WORKSPACE_MAGIC)) == 0;
+    }
+
+    GPP::ErrorCode WorkspaceFile::Save(const std::string& fileName, ModelManager* modelManager)
+    {
+        double startTime = MagicCore::ToolKit::GetTime();
+        // Channels that are not loaded yet keep the file they come from mapped, and a mapped file can not be replaced
+        AttributeStore* pointCloudAttributes = modelManager->GetPointCloudAttributes();
+        AttributeStore* meshAttributes = modelManager->GetMeshAttributes();
+        pointCloudAttributes->LoadAllChannels();
+        meshAttributes->LoadAllChannels();
+
+        std::string tempFileName = fileName + ".tmp";
+        WorkspaceWriter writer;
+        if (!writer.Open(tempFileName))
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<double> transform(4);
+        transform.at(0) = modelManager->GetScaleValue();
+        GPP::Vector3 objCenterCoord = modelManager->GetObjCenterCoord();
+        transform.at(1) = objCenterCoord[0];
+        transform.at(2) = objCenterCoord[1];
+        transform.at(3) = objCenterCoord[2];
+        std::vector<std::string> textureImageFiles = modelManager->GetTextureImageFiles();
+        std::vector<char> textureFileData;
+        for (std::vector<std::string>::iterator itr = textureImageFiles.begin(); itr != textureImageFiles.end(); ++itr)
+        {
+            textureFileData.insert(textureFileData.end(), itr->begin(), itr->end());
+            textureFileData.push_back('\n');
+        }
+        bool isWritten = WriteValues(writer, TRANSFORM_SECTION, WVT_FLOAT64, 4, transform) &&
+            WriteValues(writer, TEXTURE_FILES_SECTION, WVT_BYTE, 1, textureFileData) &&
+            WritePointCloud(writer, modelManager->GetPointCloud()) &&
+            WriteTriMesh(writer, modelManager->GetMesh()) &&
+            WriteAttributes(writer, POINTCLOUD_ATTRIBUTE_PREFIX, pointCloudAttributes) &&
+            WriteAttributes(writer, MESH_ATTRIBUTE_PREFIX, meshAttributes);
+        isWritten = writer.Close() && isWritten;
+        if (isWritten && !MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        {
+            ErrorLog << "WorkspaceFile::Save can not replace " << fileName << ", error " << GetLastError() << std::endl;
+            isWritten = false;
+        }
+        if (!isWritten)
+        {
+            DeleteFileA(tempFileName.c_str());
+        }
+        InfoLog << "WorkspaceFile::Save " << fileName << " time " << MagicCore::ToolKit::GetTime() - startTime << std::endl;
+        return isWritten ? GPP_NO_ERROR : GPP_INVALID_RESULT;
+    }
+
+    GPP::ErrorCode WorkspaceFile::Load(const std::string& fileName, ModelManager* modelManager)
+    {
+        double startTime = MagicCore::ToolKit::GetTime();
+        WorkspaceReader* reader = new WorkspaceReader;
+        std::vector<double> transform;
+        std::vector<char> textureFileData;
+        GPP::PointCloud* pointCloud = NULL;
+        GPP::TriMesh* triMesh = NULL;
+        if (!reader->Open(fileName) ||
+            !ReadValues(reader, TRANSFORM_SECTION, WVT_FLOAT64, 4, transform) || transform.size() != 4 ||
+            !ReadValues(reader, TEXTURE_FILES_SECTION, WVT_BYTE, 1, textureFileData) ||
+            !ReadPointCloud(reader, pointCloud) || !ReadTriMesh(reader, triMesh))
+        {
+            GPPFREEPOINTER(pointCloud);
+            GPPFREEPOINTER(triMesh);
+            reader->Release();
+            return GPP_INVALID_INPUT;
+        }
+        double geometryTime = MagicCore::ToolKit::GetTime() - startTime;
+
+        modelManager->SetPointCloud(pointCloud);
+        modelManager->SetMesh(triMesh);
+        modelManager->SetScaleValue(transform.at(0));
+        modelManager->SetObjCenterCoord(GPP::Vector3(transform.at(1), transform.at(2), transform.at(3)));
+        std::vector<std::string> textureImageFiles;
+        std::string textureImageFile;
+        for (std::vector<char>::iterator itr = textureFileData.begin(); itr != textureFileData.end(); ++itr)
+        {
+            if (*itr == '\n')
+            {
+                textureImageFiles.push_back(textureImageFile);
+                textureImageFile.clear();
+            }
+            else
+            {
+                textureImageFile.push_back(*itr);
+            }
+        }
+        modelManager->SetTextureImageFiles(textureImageFiles);
+        AddChannelLoaders(reader, POINTCLOUD_ATTRIBUTE_PREFIX, modelManager->GetPointCloudAttributes());
+        AddChannelLoaders(reader, MESH_ATTRIBUTE_PREFIX, modelManager->GetMeshAttributes());
+        // The channel loaders keep the file mapped until every channel is loaded or dropped
+        reader->Release();
+        InfoLog << "WorkspaceFile::Load " << fileName << " geometry time " << geometryTime << " total time "
+            << MagicCore::ToolKit::GetTime() - startTime << std::endl;
+        return GPP_NO_ERROR;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "GPP.h"
+#include <string>
+
+namespace MagicApp
+{
+    class ModelManager;
+
+    // Binary snapshot (.gws) of everything ModelManager holds: point cloud, mesh, every point and vertex attribute channel,
+    // texture image file names and the scale / center transform.
+    // The file is a list of named sections. Each section is cut into 1MB blocks that are byte shuffled and run length
+    // encoded in parallel, so blocks can also be decoded in parallel straight from the memory mapped file.
+    // Geometry is built on Load, attribute channels are only decoded when an app first asks for them.
+    // Legacy text .gii files are still read by ModelManager::LoadInfo.
+    // USAGE: 1. WorkspaceFile::Save("scan.gws", ModelManager::Get());
+    //        2. if (WorkspaceFile::IsWorkspaceFile(fileName)) WorkspaceFile::Load(fileName, ModelManager::Get());
+    class WorkspaceFile
+    {
+    public:
+        static bool IsWorkspaceFile(const std::string& fileName);
+        // Written to fileName.tmp and renamed over fileName, so a failed save keeps the previous file
+        static GPP::ErrorCode Save(const std::string& fileName, ModelManager* modelManager);
+        // Replace the models of modelManager. Nothing is changed if the file is not a valid workspace
+        static GPP::ErrorCode Load(const std::string& fileName, ModelManager* modelManager);
+    };
+}
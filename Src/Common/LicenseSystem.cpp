@@ -28,7 +28,7 @@ namespace MagicCore
         fin.close();
         if (!res)
         {
-            MessageBox(NULL, "ð棺ÿʹʱ30", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用版：每次使用时限30分钟", "温馨提示", MB_OK);
         }
         return res;
     }
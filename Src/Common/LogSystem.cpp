@@ -1,30 +1,500 @@
 #include "LogSystem.h"
+#include <windows.h>
+#include <process.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 namespace MagicCore
 {
-    const LogLevel gSystemLogLevel = LOGLEVEL_DEBUG;
+    volatile LogLevel gSystemLogLevel = LOGLEVEL_DEBUG;
     LogSystem* LogSystem::mpLogSystem = NULL;
 
-    LogSystem::LogSystem(void)
-        : mOFStream("Log_Magic3D.txt")
+    static const long LOG_SLOT_COUNT = 8192; // power of 2
+    static const DWORD LOG_FLUSH_INTERVAL = 20; // milliseconds
+    static const int LOG_FULL_WAIT_COUNT = 64;
+    static const char* LOG_LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+
+    enum LogArgTag
+    {
+        LOG_ARG_STRING = 0,
+        LOG_ARG_CHAR,
+        LOG_ARG_BOOL,
+        LOG_ARG_INT,
+        LOG_ARG_UINT,
+        LOG_ARG_DOUBLE,
+        LOG_ARG_POINTER,
+        LOG_ARG_ENDL,
+        LOG_ARG_TRUNCATED
+    };
+
+    struct LogSlot
+    {
+        volatile long mSequence;
+        LogLevel mLevel;
+        DWORD mThreadId;
+        long long mCounter;
+        int mSize;
+        char mData[LOG_RECORD_DATA_SIZE];
+    };
+
+    LogRecord::LogRecord(LogLevel level) :
+        mLevel(level),
+        mSize(0),
+        mIsTruncated(false)
+    {
+    }
+
+    LogRecord::~LogRecord()
+    {
+        LogSystem::Get()->PushRecord(mLevel, mData, mSize);
+    }
+
+    // Layout of an argument: tag, then the raw value. Strings store an int length before the characters.
+    // The last byte is kept for LOG_ARG_TRUNCATED, arguments after the first one which does not fit are skipped
+    void LogRecord::AppendArg(char tag, const void* value, int size)
+    {
+        if (mIsTruncated)
+        {
+            return;
+        }
+        if (mSize + 1 + size > LOG_RECORD_DATA_SIZE - 1)
+        {
+            mData[mSize] = LOG_ARG_TRUNCATED;
+            mSize++;
+            mIsTruncated = true;
+            return;
+        }
+        mData[mSize] = tag;
+        if (size > 0)
+        {
+            memcpy(mData + mSize + 1, value, size);
+        }
+        mSize += 1 + size;
+    }
+
+    LogRecord& LogRecord::operator<<(const char* value)
+    {
+        if (mIsTruncated)
+        {
+            return *this;
+        }
+        if (value == NULL)
+        {
+            value = "(null)";
+        }
+        int length = int(strlen(value));
+        int maxLength = LOG_RECORD_DATA_SIZE - 1 - mSize - 1 - int(sizeof(int));
+        if (maxLength <= 0)
+        {
+            AppendArg(LOG_ARG_STRING, value, LOG_RECORD_DATA_SIZE);
+            return *this;
+        }
+        bool isTruncated = (length > maxLength);
+        if (isTruncated)
+        {
+            length = maxLength;
+        }
+        mData[mSize] = LOG_ARG_STRING;
+        memcpy(mData + mSize + 1, &length, sizeof(int));
+        memcpy(mData + mSize + 1 + sizeof(int), value, length);
+        mSize += 1 + int(sizeof(int)) + length;
+        if (isTruncated)
+        {
+            AppendArg(LOG_ARG_STRING, value, LOG_RECORD_DATA_SIZE);
+        }
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(const std::string& value)
+    {
+        return (*this << value.c_str());
+    }
+
+    LogRecord& LogRecord::operator<<(char value)
+    {
+        AppendArg(LOG_ARG_CHAR, &value, sizeof(char));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(bool value)
+    {
+        char boolValue = value ? 1 : 0;
+        AppendArg(LOG_ARG_BOOL, &boolValue, sizeof(char));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(int value)
+    {
+        long long intValue = value;
+        AppendArg(LOG_ARG_INT, &intValue, sizeof(long long));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(unsigned int value)
+    {
+        unsigned long long uintValue = value;
+        AppendArg(LOG_ARG_UINT, &uintValue, sizeof(unsigned long long));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(long value)
+    {
+        long long intValue = value;
+        AppendArg(LOG_ARG_INT, &intValue, sizeof(long long));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(unsigned long value)
+    {
+        unsigned long long uintValue = value;
+        AppendArg(LOG_ARG_UINT, &uintValue, sizeof(unsigned long long));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(long long value)
+    {
+        AppendArg(LOG_ARG_INT, &value, sizeof(long long));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(unsigned long long value)
+    {
+        AppendArg(LOG_ARG_UINT, &value, sizeof(unsigned long long));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(float value)
+    {
+        double doubleValue = value;
+        AppendArg(LOG_ARG_DOUBLE, &doubleValue, sizeof(double));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(double value)
+    {
+        AppendArg(LOG_ARG_DOUBLE, &value, sizeof(double));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(const void* value)
     {
+        AppendArg(LOG_ARG_POINTER, &value, sizeof(const void*));
+        return *this;
+    }
+
+    LogRecord& LogRecord::operator<<(std::ostream& (*manipulator)(std::ostream&))
+    {
+        AppendArg(LOG_ARG_ENDL, NULL, 0);
+        return *this;
+    }
+
+    static void ShutdownLogSystem(void)
+    {
+        LogSystem::Get()->Shutdown();
+    }
+
+    LogSystem::LogSystem(void) :
+        mOFStream("Log_Magic3D.txt"),
+        mpSlots(NULL),
+        mEnqueuePos(0),
+        mDequeuePos(0),
+        mWrittenPos(0),
+        mDroppedCount(0),
+        mIsStopping(0),
+        mStartCounter(0),
+        mCounterFrequency(1),
+        mpWakeEvent(NULL),
+        mpFlushThread(NULL),
+        mpSyncLock(NULL)
+    {
+        mpSlots = new LogSlot[LOG_SLOT_COUNT];
+        for (long sid = 0; sid < LOG_SLOT_COUNT; sid++)
+        {
+            mpSlots[sid].mSequence = sid;
+        }
+        QueryPerformanceCounter((LARGE_INTEGER*)&mStartCounter);
+        QueryPerformanceFrequency((LARGE_INTEGER*)&mCounterFrequency);
+        CRITICAL_SECTION* lock = new CRITICAL_SECTION;
+        InitializeCriticalSection(lock);
+        mpSyncLock = lock;
+        mpWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
     }
 
     LogSystem* LogSystem::Get()
     {
         if (mpLogSystem == NULL)
         {
-            mpLogSystem = new LogSystem;
+            LogSystem* logSystem = new LogSystem;
+            if (InterlockedCompareExchangePointer((PVOID volatile*)&mpLogSystem, logSystem, NULL) != NULL)
+            {
+                delete logSystem;
+            }
+            else
+            {
+                mpLogSystem->StartFlushThread();
+                atexit(ShutdownLogSystem);
+            }
         }
         return mpLogSystem;
     }
 
     LogSystem::~LogSystem(void)
     {
+        Shutdown();
+        CloseHandle((HANDLE)mpWakeEvent);
+        CRITICAL_SECTION* lock = (CRITICAL_SECTION*)mpSyncLock;
+        DeleteCriticalSection(lock);
+        delete lock;
+        delete []mpSlots;
+    }
+
+    void LogSystem::SetLogLevel(LogLevel level)
+    {
+        gSystemLogLevel = level;
+    }
+
+    LogLevel LogSystem::GetLogLevel()
+    {
+        return gSystemLogLevel;
+    }
+
+    void LogSystem::StartFlushThread()
+    {
+        mpFlushThread = (void*)_beginthreadex(NULL, 0, FlushThread, (void*)this, 0, NULL);
+    }
+
+    // Bounded multi-producer queue: a slot is free for position pos when its sequence is pos,
+    // and holds a record for the consumer when its sequence is pos + 1
+    void LogSystem::PushRecord(LogLevel level, const char* data, int size)
+    {
+        if (mpFlushThread == NULL)
+        {
+            // No flush thread (start failed or shut down): format and write in place
+            LogSlot slot;
+            slot.mLevel = level;
+            slot.mThreadId = GetCurrentThreadId();
+            QueryPerformanceCounter((LARGE_INTEGER*)&slot.mCounter);
+            slot.mSize = size;
+            memcpy(slot.mData, data, size);
+            std::string line;
+            FormatRecord(slot, line);
+            EnterCriticalSection((CRITICAL_SECTION*)mpSyncLock);
+            mOFStream << line << std::flush;
+            LeaveCriticalSection((CRITICAL_SECTION*)mpSyncLock);
+            return;
+        }
+        long pos = mEnqueuePos;
+        LogSlot* slot = NULL;
+        int waitCount = 0;
+        while (true)
+        {
+            slot = mpSlots + (pos & (LOG_SLOT_COUNT - 1));
+            long diff = long((unsigned long)slot->mSequence - (unsigned long)pos);
+            if (diff == 0)
+            {
+                if (InterlockedCompareExchange(&mEnqueuePos, pos + 1, pos) == pos)
+                {
+                    break;
+                }
+                pos = mEnqueuePos;
+            }
+            else if (diff < 0)
+            {
+                // Queue is full: wake the flush thread and wait a little, warnings and errors are never dropped
+                if (level < LOGLEVEL_WARN && waitCount >= LOG_FULL_WAIT_COUNT)
+                {
+                    InterlockedIncrement(&mDroppedCount);
+                    return;
+                }
+                SetEvent((HANDLE)mpWakeEvent);
+                Sleep(waitCount < LOG_FULL_WAIT_COUNT / 2 ? 0 : 1);
+                waitCount++;
+                pos = mEnqueuePos;
+            }
+            else
+            {
+                pos = mEnqueuePos;
+            }
+        }
+        slot->mLevel = level;
+        slot->mThreadId = GetCurrentThreadId();
+        QueryPerformanceCounter((LARGE_INTEGER*)&slot->mCounter);
+        slot->mSize = size;
+        memcpy(slot->mData, data, size);
+        InterlockedExchange(&slot->mSequence, pos + 1);
+        if (level >= LOGLEVEL_WARN)
+        {
+            SetEvent((HANDLE)mpWakeEvent);
+        }
+    }
+
+    bool LogSystem::PopRecord(std::string& line)
+    {
+        long pos = mDequeuePos;
+        LogSlot* slot = mpSlots + (pos & (LOG_SLOT_COUNT - 1));
+        if (long((unsigned long)slot->mSequence - (unsigned long)(pos + 1)) != 0)
+        {
+            return false;
+        }
+        FormatRecord(*slot, line);
+        InterlockedExchange(&slot->mSequence, pos + LOG_SLOT_COUNT);
+        mDequeuePos = pos + 1;
+        return true;
+    }
+
+    void LogSystem::FormatRecord(const LogSlot& slot, std::string& line) const
+    {
+        std::ostringstream lineStream;
+        char prefix[64];
+        double time = double(slot.mCounter - mStartCounter) / double(mCounterFrequency);
+        _snprintf_s(prefix, sizeof(prefix), _TRUNCATE, "[%.3f][%lu][%s] ", time, (unsigned long)slot.mThreadId, LOG_LEVEL_NAMES[slot.mLevel]);
+        lineStream << prefix;
+        const char* data = slot.mData;
+        int pos = 0;
+        while (pos < slot.mSize)
+        {
+            char tag = data[pos];
+            pos++;
+            if (tag == LOG_ARG_STRING)
+            {
+                int length = 0;
+                memcpy(&length, data + pos, sizeof(int));
+                pos += sizeof(int);
+                lineStream.write(data + pos, length);
+                pos += length;
+            }
+            else if (tag == LOG_ARG_CHAR)
+            {
+                lineStream << data[pos];
+                pos += sizeof(char);
+            }
+            else if (tag == LOG_ARG_BOOL)
+            {
+                lineStream << (data[pos] != 0);
+                pos += sizeof(char);
+            }
+            else if (tag == LOG_ARG_INT)
+            {
+                long long value = 0;
+                memcpy(&value, data + pos, sizeof(long long));
+                lineStream << value;
+                pos += sizeof(long long);
+            }
+            else if (tag == LOG_ARG_UINT)
+            {
+                unsigned long long value = 0;
+                memcpy(&value, data + pos, sizeof(unsigned long long));
+                lineStream << value;
+                pos += sizeof(unsigned long long);
+            }
+            else if (tag == LOG_ARG_DOUBLE)
+            {
+                double value = 0;
+                memcpy(&value, data + pos, sizeof(double));
+                lineStream << value;
+                pos += sizeof(double);
+            }
+            else if (tag == LOG_ARG_POINTER)
+            {
+                const void* value = NULL;
+                memcpy(&value, data + pos, sizeof(const void*));
+                lineStream << value;
+                pos += sizeof(const void*);
+            }
+            else if (tag == LOG_ARG_ENDL)
+            {
+                // The record ends the line, an inner endl starts an indented continuation
+                if (pos < slot.mSize)
+                {
+                    lineStream << "\n    ";
+                }
+            }
+            else
+            {
+                // LOG_ARG_TRUNCATED
+                lineStream << "...";
+                break;
+            }
+        }
+        lineStream << "\n";
+        line = lineStream.str();
     }
 
-    std::ofstream& LogSystem::GetOFStream()
+    void LogSystem::WriteRecords()
     {
-        return mOFStream;
+        std::string line;
+        bool hasWritten = false;
+        EnterCriticalSection((CRITICAL_SECTION*)mpSyncLock);
+        long droppedCount = InterlockedExchange(&mDroppedCount, 0);
+        if (droppedCount > 0)
+        {
+            mOFStream << "[LogSystem] " << droppedCount << " records dropped, queue is full\n";
+            hasWritten = true;
+        }
+        while (PopRecord(line))
+        {
+            mOFStream << line;
+            hasWritten = true;
+        }
+        if (hasWritten)
+        {
+            mOFStream.flush();
+        }
+        LeaveCriticalSection((CRITICAL_SECTION*)mpSyncLock);
+        InterlockedExchange(&mWrittenPos, mDequeuePos);
+    }
+
+    unsigned __stdcall LogSystem::FlushThread(void* arg)
+    {
+        LogSystem* logSystem = (LogSystem*)arg;
+        if (logSystem == NULL)
+        {
+            return 0;
+        }
+        while (logSystem->mIsStopping == 0)
+        {
+            WaitForSingleObject((HANDLE)logSystem->mpWakeEvent, LOG_FLUSH_INTERVAL);
+            logSystem->WriteRecords();
+        }
+        logSystem->WriteRecords();
+        return 1;
+    }
+
+    void LogSystem::Flush()
+    {
+        if (mpFlushThread == NULL)
+        {
+            return;
+        }
+        long targetPos = mEnqueuePos;
+        SetEvent((HANDLE)mpWakeEvent);
+        while (long((unsigned long)mWrittenPos - (unsigned long)targetPos) < 0)
+        {
+            Sleep(1);
+        }
+    }
+
+    void LogSystem::Shutdown()
+    {
+        if (mpFlushThread == NULL)
+        {
+            return;
+        }
+        InterlockedExchange(&mIsStopping, 1);
+        SetEvent((HANDLE)mpWakeEvent);
+        WaitForSingleObject((HANDLE)mpFlushThread, INFINITE);
+        CloseHandle((HANDLE)mpFlushThread);
+        mpFlushThread = NULL;
+        // A producer that saw the flush thread may still be filling a claimed slot, and PopRecord stops there:
+        // drain until every claimed slot is written, new records are now written in place
+        int waitCount = 0;
+        WriteRecords();
+        while (long((unsigned long)mEnqueuePos - (unsigned long)mDequeuePos) > 0 && waitCount < LOG_FULL_WAIT_COUNT)
+        {
+            Sleep(waitCount < LOG_FULL_WAIT_COUNT / 2 ? 0 : 1);
+            waitCount++;
+            WriteRecords();
+        }
     }
 }
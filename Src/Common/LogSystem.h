@@ -1,6 +1,8 @@
 #pragma once
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 namespace MagicCore
 {
@@ -13,16 +15,67 @@ namespace MagicCore
         LOGLEVEL_OFF
     };
 
-    extern const LogLevel gSystemLogLevel;
+    // Records below gSystemLogLevel are skipped before any argument is evaluated. Change it with LogSystem::SetLogLevel
+    extern volatile LogLevel gSystemLogLevel;
 
 #define MagicLog(level) \
     if (level < MagicCore::gSystemLogLevel) ;\
-    else MagicCore::LogSystem::Get()->GetOFStream() 
+    else MagicCore::LogRecord(level)
 #define DebugLog MagicLog(MagicCore::LOGLEVEL_DEBUG)
 #define InfoLog MagicLog(MagicCore::LOGLEVEL_INFO)
 #define WarnLog MagicLog(MagicCore::LOGLEVEL_WARN)
 #define ErrorLog MagicLog(MagicCore::LOGLEVEL_ERROR)
 
+    static const int LOG_RECORD_DATA_SIZE = 232;
+
+    // One log statement. Arguments are packed as raw typed values into a local buffer,
+    // which is copied into the LogSystem queue when the statement ends and formatted by the flush thread.
+    // A statement is one line of the log file, std::endl only ends it.
+    class LogRecord
+    {
+    public:
+        explicit LogRecord(LogLevel level);
+        ~LogRecord();
+
+        LogRecord& operator<<(const char* value);
+        LogRecord& operator<<(const std::string& value);
+        LogRecord& operator<<(char value);
+        LogRecord& operator<<(bool value);
+        LogRecord& operator<<(int value);
+        LogRecord& operator<<(unsigned int value);
+        LogRecord& operator<<(long value);
+        LogRecord& operator<<(unsigned long value);
+        LogRecord& operator<<(long long value);
+        LogRecord& operator<<(unsigned long long value);
+        LogRecord& operator<<(float value);
+        LogRecord& operator<<(double value);
+        LogRecord& operator<<(const void* value);
+        LogRecord& operator<<(std::ostream& (*manipulator)(std::ostream&));
+
+        // Other types are formatted at the call site
+        template<class T>
+        LogRecord& operator<<(const T& value)
+        {
+            std::ostringstream valueStream;
+            valueStream << value;
+            return (*this << valueStream.str());
+        }
+
+    private:
+        void AppendArg(char tag, const void* value, int size);
+
+    private:
+        LogLevel mLevel;
+        int mSize;
+        bool mIsTruncated;
+        char mData[LOG_RECORD_DATA_SIZE];
+    };
+
+    struct LogSlot;
+
+    // Multi-producer ring buffer drained by a background thread into Log_Magic3D.txt.
+    // Each line is prefixed by its time in seconds, thread id and level.
+    // A producer waits briefly when the queue is full, then drops debug and info records and the count is reported.
     class LogSystem
     {
     private:
@@ -31,8 +84,36 @@ namespace MagicCore
     public:
         static LogSystem* Get(void);
         ~LogSystem(void);
-        std::ofstream& GetOFStream();
-    public:
+
+        static void SetLogLevel(LogLevel level);
+        static LogLevel GetLogLevel(void);
+
+        // Called by LogRecord. data is copied
+        void PushRecord(LogLevel level, const char* data, int size);
+        // Wait until every record pushed before the call is written to the file
+        void Flush(void);
+        // Stop the flush thread and write the remaining records. Later records are written synchronously
+        void Shutdown(void);
+
+    private:
+        void StartFlushThread(void);
+        bool PopRecord(std::string& line);
+        void FormatRecord(const LogSlot& slot, std::string& line) const;
+        void WriteRecords(void);
+        static unsigned __stdcall FlushThread(void* arg);
+
+    private:
         std::ofstream mOFStream;
+        LogSlot* mpSlots;
+        volatile long mEnqueuePos;
+        volatile long mDequeuePos;
+        volatile long mWrittenPos;
+        volatile long mDroppedCount;
+        volatile long mIsStopping;
+        long long mStartCounter;
+        long long mCounterFrequency;
+        void* mpWakeEvent;
+        void* volatile mpFlushThread;
+        void* mpSyncLock;
     };
 }
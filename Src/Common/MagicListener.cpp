@@ -84,6 +84,11 @@ namespace MagicCore
     {
         MyGUI::KeyCode code = MyGUI::KeyCode::Enum(arg.key);
         MyGUI::InputManager::getInstance().injectKeyPress(code, arg.text);
+        if (arg.key == OIS::KC_F12)
+        {
+            RenderSystem::Get()->ToggleRenderCacheView();
+            return true;
+        }
         return MagicApp::AppManager::Get()->KeyPressed(arg);
     }
 
@@ -0,0 +1,127 @@
+#include "ParallelTool.h"
+#include <windows.h>
+#include <process.h>
+#include <vector>
+
+namespace MagicCore
+{
+    struct ParallelForContext
+    {
+        ParallelTask* mpTask;
+        int mCount;
+        int mBlockSize;
+        volatile LONG mNextBlock;
+    };
+
+    struct ParallelForThreadArg
+    {
+        ParallelForContext* mpContext;
+        int mThreadId;
+    };
+
+    static void RunParallelForBlocks(ParallelForContext* context, int threadId)
+    {
+        while (true)
+        {
+            LONG blockId = InterlockedIncrement(&(context->mNextBlock)) - 1;
+            int startId = int(blockId) * context->mBlockSize;
+            if (startId >= context->mCount)
+            {
+                break;
+            }
+            int endId = startId + context->mBlockSize;
+            if (endId > context->mCount)
+            {
+                endId = context->mCount;
+            }
+            context->mpTask->Run(startId, endId, threadId);
+        }
+    }
+
+    static unsigned __stdcall ParallelForThread(void* arg)
+    {
+        ParallelForThreadArg* threadArg = (ParallelForThreadArg*)arg;
+        if (threadArg == NULL)
+        {
+            return 0;
+        }
+        RunParallelForBlocks(threadArg->mpContext, threadArg->mThreadId);
+        return 1;
+    }
+
+    int ParallelTool::GetThreadCount()
+    {
+        static int threadCount = 0;
+        if (threadCount == 0)
+        {
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+            threadCount = int(systemInfo.dwNumberOfProcessors);
+            if (threadCount < 1)
+            {
+                threadCount = 1;
+            }
+            else if (threadCount > MAXIMUM_WAIT_OBJECTS)
+            {
+                threadCount = MAXIMUM_WAIT_OBJECTS;
+            }
+        }
+        return threadCount;
+    }
+
+    void ParallelTool::ParallelFor(int count, ParallelTask* task, int blockSize)
+    {
+        if (count <= 0 || task == NULL)
+        {
+            return;
+        }
+        int threadCount = GetThreadCount();
+        if (blockSize <= 0)
+        {
+            // several blocks per thread so that uneven blocks are balanced
+            blockSize = count / (threadCount * 8);
+            if (blockSize < 1)
+            {
+                blockSize = 1;
+            }
+        }
+        int blockCount = (count + blockSize - 1) / blockSize;
+        if (threadCount > blockCount)
+        {
+            threadCount = blockCount;
+        }
+        ParallelForContext context;
+        context.mpTask = task;
+        context.mCount = count;
+        context.mBlockSize = blockSize;
+        context.mNextBlock = 0;
+        if (threadCount == 1)
+        {
+            RunParallelForBlocks(&context, 0);
+            return;
+        }
+        // The calling thread works as thread 0
+        std::vector<ParallelForThreadArg> threadArgs(threadCount);
+        std::vector<HANDLE> threadHandles;
+        threadHandles.reserve(threadCount - 1);
+        for (int tid = 1; tid < threadCount; tid++)
+        {
+            threadArgs.at(tid).mpContext = &context;
+            threadArgs.at(tid).mThreadId = tid;
+            HANDLE threadHandle = (HANDLE)_beginthreadex(NULL, 0, ParallelForThread, (void*)(&threadArgs.at(tid)), 0, NULL);
+            if (threadHandle != 0)
+            {
+                threadHandles.push_back(threadHandle);
+            }
+        }
+        RunParallelForBlocks(&context, 0);
+        if (!threadHandles.empty())
+        {
+            WaitForMultipleObjects(DWORD(threadHandles.size()), &(threadHandles.at(0)), TRUE, INFINITE);
+            for (std::vector<HANDLE>::iterator itr = threadHandles.begin(); itr != threadHandles.end(); ++itr)
+            {
+                CloseHandle(*itr);
+            }
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace MagicCore
+{
+    // Work item for ParallelTool::ParallelFor: Run is called with disjoint [startId, endId) blocks
+    // from several threads at the same time, so it must only write to data owned by its block.
+    class ParallelTask
+    {
+    public:
+        ParallelTask() {}
+        virtual void Run(int startId, int endId, int threadId) = 0;
+        virtual ~ParallelTask() {}
+    };
+
+    class ParallelTool
+    {
+    public:
+        static int GetThreadCount(void);
+        // Split [0, count) into blocks and run them on all cores, return after every block is finished.
+        // blockSize <= 0 chooses a block size from count and thread count.
+        static void ParallelFor(int count, ParallelTask* task, int blockSize = 0);
+    };
+}
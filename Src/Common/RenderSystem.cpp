@@ -2,18 +2,45 @@
 #include "RenderSystem.h"
 #include "../Common/LogSystem.h"
 #include "MagicListener.h"
+#include "MyGUI.h"
 #include "GPP.h"
+#include <sstream>
 
 namespace MagicCore
 {
+    static const unsigned long long DEFAULT_RENDER_CACHE_BUDGET = 512ULL << 20;
+    // Bytes of a vertex with position, normal and colour or texture coordinate, and of a triangle index list
+    static const unsigned long long COLOR_VERTEX_BYTE_COUNT = 28;
+    static const unsigned long long TEXTURE_VERTEX_BYTE_COUNT = 32;
+    static const unsigned long long TRIANGLE_BYTE_COUNT = 12;
+    static const char* RENDER_LAYOUT_NAMES[] = {"_CacheSmooth", "_CacheFlat", "_CacheTexture", "_CacheUV"};
+
     RenderSystem* RenderSystem::mpRenderSystem = NULL;
 
+    RenderSystem::RenderCacheObject::RenderCacheObject() :
+        mShownLayout(-1)
+    {
+        for (int layout = 0; layout < RENDER_LAYOUT_COUNT; layout++)
+        {
+            mEntries[layout].mRenderVersion = -1;
+            mEntries[layout].mByteCount = 0;
+            mEntries[layout].mShowTick = 0;
+        }
+    }
+
     RenderSystem::RenderSystem(void) : 
         mpRoot(NULL), 
         mpMainCamera(NULL), 
         mpRenderWindow(NULL), 
         mpSceneManager(NULL),
-        mpViewport(NULL)
+        mpViewport(NULL),
+        mRenderCache(),
+        mRenderCacheBudget(DEFAULT_RENDER_CACHE_BUDGET),
+        mRenderCacheByteCount(0),
+        mRenderCacheTick(0),
+        mRenderCacheHitCount(0),
+        mRenderCacheMissCount(0),
+        mpRenderCacheText(NULL)
     {
     }
 
@@ -289,16 +316,27 @@ namespace MagicCore
     }
 
     void RenderSystem::RenderMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType,
-        std::vector<bool>* selectFlags, GPP::Vector3* selectColor, bool isFlat)
+        std::vector<bool>* selectFlags, GPP::Vector3* selectColor, bool isFlat, int renderVersion)
     {
         Ogre::ManualObject* manualObj = NULL;
-        if (mpSceneManager->hasManualObject(meshName))
+        RenderLayout layout = isFlat ? RENDER_LAYOUT_FLAT : RENDER_LAYOUT_SMOOTH;
+        if (renderVersion >= 0)
+        {
+            bool isCached = false;
+            manualObj = BeginCachedObject(meshName, layout, renderVersion, nodeType, isCached);
+            if (isCached)
+            {
+                return;
+            }
+        }
+        else if (mpSceneManager->hasManualObject(meshName))
         {
             manualObj = mpSceneManager->getManualObject(meshName);
             manualObj->clear();
         }
         else
         {
+            DropRenderCache(meshName);
             manualObj = mpSceneManager->createManualObject(meshName);
             AttachManualObjectToSceneNode(nodeType, manualObj);
         }
@@ -373,18 +411,34 @@ namespace MagicCore
             }
         }
         manualObj->end();
+        if (renderVersion >= 0)
+        {
+            unsigned long long vertexCount = isFlat ? mesh->GetTriangleCount() * 3 : mesh->GetVertexCount();
+            EndCachedObject(meshName, layout, renderVersion, vertexCount * COLOR_VERTEX_BYTE_COUNT + mesh->GetTriangleCount() * TRIANGLE_BYTE_COUNT);
+        }
     }
 
-    void RenderSystem::RenderTextureMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType)
+    void RenderSystem::RenderTextureMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType,
+        int renderVersion)
     {
         Ogre::ManualObject* manualObj = NULL;
-        if (mpSceneManager->hasManualObject(meshName))
+        if (renderVersion >= 0)
+        {
+            bool isCached = false;
+            manualObj = BeginCachedObject(meshName, RENDER_LAYOUT_TEXTURE, renderVersion, nodeType, isCached);
+            if (isCached)
+            {
+                return;
+            }
+        }
+        else if (mpSceneManager->hasManualObject(meshName))
         {
             manualObj = mpSceneManager->getManualObject(meshName);
             manualObj->clear();
         }
         else
         {
+            DropRenderCache(meshName);
             manualObj = mpSceneManager->createManualObject(meshName);
             AttachManualObjectToSceneNode(nodeType, manualObj);
         }
@@ -413,18 +467,33 @@ namespace MagicCore
             manualObj->triangle(fid * 3, fid * 3 + 1, fid * 3 + 2);
         }
         manualObj->end();
+        if (renderVersion >= 0)
+        {
+            EndCachedObject(meshName, RENDER_LAYOUT_TEXTURE, renderVersion, faceCount * (3 * TEXTURE_VERTEX_BYTE_COUNT + TRIANGLE_BYTE_COUNT));
+        }
     }
 
-    void RenderSystem::RenderUVMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType)
+    void RenderSystem::RenderUVMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType,
+        int renderVersion)
     {
         Ogre::ManualObject* manualObj = NULL;
-        if (mpSceneManager->hasManualObject(meshName))
+        if (renderVersion >= 0)
+        {
+            bool isCached = false;
+            manualObj = BeginCachedObject(meshName, RENDER_LAYOUT_UV, renderVersion, nodeType, isCached);
+            if (isCached)
+            {
+                return;
+            }
+        }
+        else if (mpSceneManager->hasManualObject(meshName))
         {
             manualObj = mpSceneManager->getManualObject(meshName);
             manualObj->clear();
         }
         else
         {
+            DropRenderCache(meshName);
             manualObj = mpSceneManager->createManualObject(meshName);
             AttachManualObjectToSceneNode(nodeType, manualObj);
         }
@@ -465,6 +534,10 @@ namespace MagicCore
             manualObj->triangle(fid * 3, fid * 3 + 1, fid * 3 + 2);
         }
         manualObj->end();
+        if (renderVersion >= 0)
+        {
+            EndCachedObject(meshName, RENDER_LAYOUT_UV, renderVersion, faceCount * (3 * COLOR_VERTEX_BYTE_COUNT + TRIANGLE_BYTE_COUNT));
+        }
     }
 
     void RenderSystem::RenderLineSegments(std::string lineName, std::string materialName, const std::vector<GPP::Vector3>& startCoords, const std::vector<GPP::Vector3>& endCoords)
@@ -533,6 +606,47 @@ namespace MagicCore
         manualObj->end();
     }
 
+    void RenderSystem::UpdatePolyline(std::string lineName, std::string materialName, const GPP::Vector3& color, int polylineId,
+        const std::vector<GPP::Vector3>& polylineCoords, ModelNodeType nodeType)
+    {
+        Ogre::ManualObject* manualObj = NULL;
+        if (mpSceneManager->hasManualObject(lineName))
+        {
+            manualObj = mpSceneManager->getManualObject(lineName);
+        }
+        else
+        {
+            manualObj = mpSceneManager->createManualObject(lineName);
+            AttachManualObjectToSceneNode(nodeType, manualObj);
+        }
+        // Every polyline is a section of the object, an updated section keeps its slot even when it is empty
+        if (polylineId < int(manualObj->getNumSections()))
+        {
+            manualObj->beginUpdate(polylineId);
+        }
+        else
+        {
+            manualObj->begin(materialName, Ogre::RenderOperation::OT_LINE_STRIP);
+        }
+        int pointSize = polylineCoords.size();
+        for (int pointId = 0; pointId < pointSize; ++pointId)
+        {
+            GPP::Vector3 pt = polylineCoords.at(pointId);
+            manualObj->position(pt[0], pt[1], pt[2]);
+            manualObj->colour(color[0], color[1], color[2]);
+        }
+        manualObj->end();
+    }
+
+    int RenderSystem::GetPolylineCount(std::string lineName) const
+    {
+        if (mpSceneManager == NULL || !mpSceneManager->hasManualObject(lineName))
+        {
+            return 0;
+        }
+        return mpSceneManager->getManualObject(lineName)->getNumSections();
+    }
+
     void RenderSystem::RenderOBB(std::string obbName, std::string materialName, const GPP::Vector3& color, const GPP::Obb& obb, bool appendNewObb, ModelNodeType nodeType)
     {
         Ogre::ManualObject* manualObj = NULL;
@@ -586,7 +700,27 @@ namespace MagicCore
             {
                 mpSceneManager->destroyManualObject(objName);
             }
+            DropRenderCache(objName);
+        }
+    }
+
+    void RenderSystem::SetRenderCacheBudget(unsigned long long byteCount)
+    {
+        mRenderCacheBudget = byteCount;
+        EvictRenderCache();
+    }
+
+    void RenderSystem::ToggleRenderCacheView()
+    {
+        if (mpRenderCacheText == NULL)
+        {
+            mpRenderCacheText = MyGUI::Gui::getInstance().createWidget<MyGUI::TextBox>("TextBox", 
+                MyGUI::IntCoord(10, GetRenderWindowHeight() - 30, 600, 20), MyGUI::Align::Left | MyGUI::Align::Bottom, "Statistic", "Text_RenderCache");
+            mpRenderCacheText->setTextColour(MyGUI::Colour::Black);
+            mpRenderCacheText->setVisible(false);
         }
+        mpRenderCacheText->setVisible(!mpRenderCacheText->getVisible());
+        UpdateRenderCacheView();
     }
     
     void RenderSystem::ResertAllSceneNode()
@@ -623,6 +757,156 @@ namespace MagicCore
     {
     }
 
+    std::string RenderSystem::GetCachedObjectName(const std::string& objName, int layout) const
+    {
+        return objName + RENDER_LAYOUT_NAMES[layout];
+    }
+
+    Ogre::ManualObject* RenderSystem::BeginCachedObject(const std::string& objName, RenderLayout layout, int renderVersion, 
+        ModelNodeType nodeType, bool& isCached)
+    {
+        // The object was rendered without cache before
+        if (mpSceneManager->hasManualObject(objName))
+        {
+            mpSceneManager->destroyManualObject(objName);
+        }
+        RenderCacheObject& cacheObject = mRenderCache[objName];
+        for (int otherLayout = 0; otherLayout < RENDER_LAYOUT_COUNT; otherLayout++)
+        {
+            int otherVersion = cacheObject.mEntries[otherLayout].mRenderVersion;
+            if (otherLayout == layout || otherVersion < 0)
+            {
+                continue;
+            }
+            if (otherVersion != renderVersion)
+            {
+                // The data is changed, these buffers are never shown again
+                DestroyCachedObject(objName, otherLayout);
+            }
+            else if (otherLayout == cacheObject.mShownLayout)
+            {
+                mpSceneManager->getManualObject(GetCachedObjectName(objName, otherLayout))->setVisible(false);
+            }
+        }
+        cacheObject.mShownLayout = layout;
+        RenderCacheEntry& entry = cacheObject.mEntries[layout];
+        entry.mShowTick = ++mRenderCacheTick;
+        std::string cachedName = GetCachedObjectName(objName, layout);
+        Ogre::ManualObject* manualObj = NULL;
+        if (mpSceneManager->hasManualObject(cachedName))
+        {
+            manualObj = mpSceneManager->getManualObject(cachedName);
+            manualObj->setVisible(true);
+            if (entry.mRenderVersion == renderVersion)
+            {
+                isCached = true;
+                mRenderCacheHitCount++;
+                UpdateRenderCacheView();
+                return manualObj;
+            }
+            manualObj->clear();
+        }
+        else
+        {
+            manualObj = mpSceneManager->createManualObject(cachedName);
+            AttachManualObjectToSceneNode(nodeType, manualObj);
+        }
+        isCached = false;
+        mRenderCacheMissCount++;
+        mRenderCacheByteCount -= entry.mByteCount;
+        entry.mRenderVersion = -1;
+        entry.mByteCount = 0;
+        return manualObj;
+    }
+
+    void RenderSystem::EndCachedObject(const std::string& objName, RenderLayout layout, int renderVersion, unsigned long long byteCount)
+    {
+        RenderCacheEntry& entry = mRenderCache[objName].mEntries[layout];
+        entry.mRenderVersion = renderVersion;
+        entry.mByteCount = byteCount;
+        mRenderCacheByteCount += byteCount;
+        EvictRenderCache();
+        UpdateRenderCacheView();
+    }
+
+    void RenderSystem::DestroyCachedObject(const std::string& objName, int layout)
+    {
+        std::string cachedName = GetCachedObjectName(objName, layout);
+        if (mpSceneManager->hasManualObject(cachedName))
+        {
+            mpSceneManager->destroyManualObject(cachedName);
+        }
+        RenderCacheObject& cacheObject = mRenderCache[objName];
+        RenderCacheEntry& entry = cacheObject.mEntries[layout];
+        mRenderCacheByteCount -= entry.mByteCount;
+        entry.mRenderVersion = -1;
+        entry.mByteCount = 0;
+        if (cacheObject.mShownLayout == layout)
+        {
+            cacheObject.mShownLayout = -1;
+        }
+    }
+
+    void RenderSystem::DropRenderCache(const std::string& objName)
+    {
+        std::map<std::string, RenderCacheObject>::iterator cacheItr = mRenderCache.find(objName);
+        if (cacheItr == mRenderCache.end())
+        {
+            return;
+        }
+        for (int layout = 0; layout < RENDER_LAYOUT_COUNT; layout++)
+        {
+            DestroyCachedObject(objName, layout);
+        }
+        mRenderCache.erase(cacheItr);
+        UpdateRenderCacheView();
+    }
+
+    void RenderSystem::EvictRenderCache()
+    {
+        while (mRenderCacheByteCount > mRenderCacheBudget)
+        {
+            // The shown buffers stay, the least recently shown of the others goes first
+            std::string evictName;
+            int evictLayout = -1;
+            unsigned long long evictTick = 0;
+            for (std::map<std::string, RenderCacheObject>::iterator cacheItr = mRenderCache.begin(); cacheItr != mRenderCache.end(); ++cacheItr)
+            {
+                for (int layout = 0; layout < RENDER_LAYOUT_COUNT; layout++)
+                {
+                    const RenderCacheEntry& entry = cacheItr->second.mEntries[layout];
+                    if (layout == cacheItr->second.mShownLayout || entry.mByteCount == 0)
+                    {
+                        continue;
+                    }
+                    if (evictLayout == -1 || entry.mShowTick < evictTick)
+                    {
+                        evictName = cacheItr->first;
+                        evictLayout = layout;
+                        evictTick = entry.mShowTick;
+                    }
+                }
+            }
+            if (evictLayout == -1)
+            {
+                break;
+            }
+            DestroyCachedObject(evictName, evictLayout);
+        }
+    }
+
+    void RenderSystem::UpdateRenderCacheView()
+    {
+        if (mpRenderCacheText == NULL || !mpRenderCacheText->getVisible())
+        {
+            return;
+        }
+        std::stringstream ss;
+        ss << "Render cache: hit " << mRenderCacheHitCount << "  miss " << mRenderCacheMissCount << "  " 
+            << (mRenderCacheByteCount >> 20) << "MB / " << (mRenderCacheBudget >> 20) << "MB";
+        mpRenderCacheText->setCaption(ss.str());
+    }
+
     void RenderSystem::AttachManualObjectToSceneNode(ModelNodeType nodeType, Ogre::ManualObject* manualObj)
     {
         switch (nodeType)
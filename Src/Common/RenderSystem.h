@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <map>
 #include "Vector3.h"
 
 namespace Ogre
@@ -13,6 +14,11 @@ namespace Ogre
     class Viewport;
 }
 
+namespace MyGUI
+{
+    class TextBox;
+}
+
 namespace GPP
 {
     class PointCloud;
@@ -49,25 +55,74 @@ namespace MagicCore
         int GetRenderWindowHeight(void);
 
         //Rendering tools
+        //renderVersion >= 0 caches the built buffers of the mesh object per layout (smooth, flat, texture, uv). Calling again with
+        //the same layout and renderVersion shows the cached buffers without rebuilding, so switching display modes is cheap.
+        //Change renderVersion whenever the mesh or the select flags change. renderVersion < 0 rebuilds and drops the cache
         void RenderPointCloud(std::string pointCloudName, std::string materialName, const GPP::PointCloud* pointCloud, 
             ModelNodeType nodeType = MODEL_NODE_CENTER, std::vector<bool>* selectFlags = NULL, GPP::Vector3* selectColor = NULL);
         void RenderPointCloudList(std::string pointCloudListName, std::string materialName, const std::vector<GPP::PointCloud*>& pointCloudList, bool hasNormal, ModelNodeType nodeType = MODEL_NODE_CENTER);
         void RenderPointList(std::string pointListName, std::string materialName, const GPP::Vector3& color, const std::vector<GPP::Vector3>& pointCoords, ModelNodeType nodeType = MODEL_NODE_CENTER);
         void RenderMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, 
-            ModelNodeType nodeType = MODEL_NODE_CENTER, std::vector<bool>* selectFlags = NULL, GPP::Vector3* selectColor = NULL, bool isFlat = false);
-        void RenderTextureMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType = MODEL_NODE_CENTER);
-        void RenderUVMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType = MODEL_NODE_CENTER);
+            ModelNodeType nodeType = MODEL_NODE_CENTER, std::vector<bool>* selectFlags = NULL, GPP::Vector3* selectColor = NULL, bool isFlat = false,
+            int renderVersion = -1);
+        void RenderTextureMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType = MODEL_NODE_CENTER,
+            int renderVersion = -1);
+        void RenderUVMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType = MODEL_NODE_CENTER,
+            int renderVersion = -1);
         void RenderLineSegments(std::string lineName, std::string materialName, const std::vector<GPP::Vector3>& startCoords, const std::vector<GPP::Vector3>& endCoords);
         void RenderPolyline(std::string polylineName, std::string materialName, const GPP::Vector3& color, const std::vector<GPP::Vector3>& polylineCoords, bool appendNewPolyline = false, ModelNodeType nodeType = MODEL_NODE_CENTER);
+        //Rebuild only polyline polylineId of a RenderPolyline object, polylineId == GetPolylineCount appends one.
+        //A polyline can not be removed, empty polylineCoords keeps its slot and draws nothing
+        void UpdatePolyline(std::string polylineName, std::string materialName, const GPP::Vector3& color, int polylineId, const std::vector<GPP::Vector3>& polylineCoords, ModelNodeType nodeType = MODEL_NODE_CENTER);
+        int GetPolylineCount(std::string polylineName) const;
         void RenderOBB(std::string obbName, std::string materialName, const GPP::Vector3& color, const GPP::Obb& obb, bool appendNewObb = false, ModelNodeType nodeType = MODEL_NODE_CENTER);
         void HideRenderingObject(std::string objName);
 
+        //Cached buffers that are not shown are destroyed, least recently shown first, above this byte count. Default is 512MB
+        void SetRenderCacheBudget(unsigned long long byteCount);
+        //Show or hide the hit and miss count of the render cache
+        void ToggleRenderCacheView(void);
+
         void ResertAllSceneNode(void);
 
         virtual ~RenderSystem(void);
 
     private:
+        enum RenderLayout
+        {
+            RENDER_LAYOUT_SMOOTH = 0,
+            RENDER_LAYOUT_FLAT,
+            RENDER_LAYOUT_TEXTURE,
+            RENDER_LAYOUT_UV,
+            RENDER_LAYOUT_COUNT
+        };
+
+        struct RenderCacheEntry
+        {
+            //-1 if the buffers are not built
+            int mRenderVersion;
+            unsigned long long mByteCount;
+            unsigned long long mShowTick;
+        };
+
+        struct RenderCacheObject
+        {
+            RenderCacheObject();
+
+            //-1 if no layout is shown
+            int mShownLayout;
+            RenderCacheEntry mEntries[RENDER_LAYOUT_COUNT];
+        };
+
         void AttachManualObjectToSceneNode(ModelNodeType nodeType, Ogre::ManualObject* manualObj);
+        std::string GetCachedObjectName(const std::string& objName, int layout) const;
+        //Return the manual object of the layout to build, or the cached one if isCached
+        Ogre::ManualObject* BeginCachedObject(const std::string& objName, RenderLayout layout, int renderVersion, ModelNodeType nodeType, bool& isCached);
+        void EndCachedObject(const std::string& objName, RenderLayout layout, int renderVersion, unsigned long long byteCount);
+        void DestroyCachedObject(const std::string& objName, int layout);
+        void DropRenderCache(const std::string& objName);
+        void EvictRenderCache(void);
+        void UpdateRenderCacheView(void);
 
     private:
         Ogre::Root*    mpRoot;
@@ -75,6 +130,13 @@ namespace MagicCore
         Ogre::RenderWindow* mpRenderWindow;
         Ogre::SceneManager* mpSceneManager;
         Ogre::Viewport* mpViewport;
+        std::map<std::string, RenderCacheObject> mRenderCache;
+        unsigned long long mRenderCacheBudget;
+        unsigned long long mRenderCacheByteCount;
+        unsigned long long mRenderCacheTick;
+        int mRenderCacheHitCount;
+        int mRenderCacheMissCount;
+        MyGUI::TextBox* mpRenderCacheText;
     };
 }
 
@@ -0,0 +1,523 @@
+#include "ScriptBatchRunner.h"
+#include "ScriptBuffer.h"
+#include "ParallelTool.h"
+#include "ToolKit.h"
+#include "LogSystem.h"
+#include "../Application/VertexWelder.h"
+#include "../Application/BinaryMeshReader.h"
+#include "lua.hpp"
+#include <windows.h>
+#include <process.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+namespace MagicCore
+{
+    static const char* SCRIPT_BATCH_CHUNK_KEY = "Magic3D.ScriptBatchChunk";
+
+    // Models and log of the file a batch worker is running
+    class BatchModelContext : public ScriptModelContext
+    {
+    public:
+        BatchModelContext() :
+            mpTriMesh(NULL),
+            mpPointCloud(NULL),
+            mpLogStream(NULL)
+        {
+        }
+
+        virtual GPP::TriMesh* GetMesh()
+        {
+            return mpTriMesh;
+        }
+
+        virtual GPP::PointCloud* GetPointCloud()
+        {
+            return mpPointCloud;
+        }
+
+        void SetMesh(GPP::TriMesh* triMesh)
+        {
+            GPPFREEPOINTER(mpTriMesh);
+            mpTriMesh = triMesh;
+        }
+
+        void SetPointCloud(GPP::PointCloud* pointCloud)
+        {
+            GPPFREEPOINTER(mpPointCloud);
+            mpPointCloud = pointCloud;
+        }
+
+        void Reset(std::ofstream* logStream)
+        {
+            SetMesh(NULL);
+            SetPointCloud(NULL);
+            mpLogStream = logStream;
+        }
+
+        std::ofstream* GetLogStream()
+        {
+            return mpLogStream;
+        }
+
+        virtual ~BatchModelContext()
+        {
+            Reset(NULL);
+        }
+
+    private:
+        GPP::TriMesh* mpTriMesh;
+        GPP::PointCloud* mpPointCloud;
+        std::ofstream* mpLogStream;
+    };
+
+    static BatchModelContext* GetBatchContext(lua_State* luaState)
+    {
+        return (BatchModelContext*)ScriptBuffer::GetModelContext(luaState);
+    }
+
+    static void WriteBatchLog(lua_State* luaState, const std::string& message)
+    {
+        std::ofstream* logStream = GetBatchContext(luaState)->GetLogStream();
+        if (logStream)
+        {
+            *logStream << message << std::endl;
+        }
+    }
+
+    // Log(...) and print(...): arguments are joined by tab into one line of the file log
+    static int BatchLog(lua_State* luaState)
+    {
+        int argCount = lua_gettop(luaState);
+        std::string message;
+        for (int argId = 1; argId <= argCount; argId++)
+        {
+            if (argId > 1)
+            {
+                message += "\t";
+            }
+            message += luaL_tolstring(luaState, argId, NULL);
+            lua_pop(luaState, 1);
+        }
+        WriteBatchLog(luaState, message);
+        return 0;
+    }
+
+    // Coordinates are kept in file units so that exported models match the input
+    static int BatchImportMesh(lua_State* luaState)
+    {
+        std::string fileName(luaL_checkstring(luaState, 1));
+        MagicApp::BinaryMeshReader binaryMeshReader;
+        GPP::TriMesh* triMesh = binaryMeshReader.ImportTriMesh(fileName);
+        if (triMesh == NULL)
+        {
+            triMesh = GPP::Parser::ImportTriMesh(fileName);
+        }
+        if (triMesh && triMesh->GetMeshType() == GPP::MeshType::MT_TRIANGLE_SOUP)
+        {
+            MagicApp::VertexWelder vertexWelder;
+            GPP::TriMesh* weldMesh = vertexWelder.WeldTriMesh(triMesh);
+            if (weldMesh != NULL)
+            {
+                GPPFREEPOINTER(triMesh);
+                triMesh = weldMesh;
+            }
+            else
+            {
+                triMesh->FuseVertex();
+            }
+        }
+        if (triMesh)
+        {
+            triMesh->UpdateNormal();
+        }
+        GetBatchContext(luaState)->SetMesh(triMesh);
+        lua_pushboolean(luaState, triMesh != NULL);
+        return 1;
+    }
+
+    static int BatchExportMesh(lua_State* luaState)
+    {
+        std::string fileName(luaL_checkstring(luaState, 1));
+        GPP::TriMesh* triMesh = GetBatchContext(luaState)->GetMesh();
+        bool isSuccess = (triMesh != NULL && GPP::Parser::ExportTriMesh(fileName, triMesh) == GPP_NO_ERROR);
+        lua_pushboolean(luaState, isSuccess);
+        return 1;
+    }
+
+    static int BatchImportPointCloud(lua_State* luaState)
+    {
+        std::string fileName(luaL_checkstring(luaState, 1));
+        GPP::PointCloud* pointCloud = GPP::Parser::ImportPointCloud(fileName);
+        GetBatchContext(luaState)->SetPointCloud(pointCloud);
+        lua_pushboolean(luaState, pointCloud != NULL);
+        return 1;
+    }
+
+    static int BatchExportPointCloud(lua_State* luaState)
+    {
+        std::string fileName(luaL_checkstring(luaState, 1));
+        GPP::PointCloud* pointCloud = GetBatchContext(luaState)->GetPointCloud();
+        bool isSuccess = (pointCloud != NULL && GPP::Parser::ExportPointCloud(fileName, pointCloud) == GPP_NO_ERROR);
+        lua_pushboolean(luaState, isSuccess);
+        return 1;
+    }
+
+    static int BatchSmoothMesh(lua_State* luaState)
+    {
+        GPP::Real positionWeight = luaL_optnumber(luaState, 1, 1.0);
+        GPP::TriMesh* triMesh = GetBatchContext(luaState)->GetMesh();
+        GPP::ErrorCode res = (triMesh == NULL) ? GPP_INVALID_INPUT : GPP::FilterMesh::LaplaceSmooth(triMesh, true, positionWeight);
+        if (res == GPP_NO_ERROR)
+        {
+            triMesh->UpdateNormal();
+        }
+        lua_pushboolean(luaState, res == GPP_NO_ERROR);
+        return 1;
+    }
+
+    static int BatchSimplifyMesh(lua_State* luaState)
+    {
+        GPP::Int targetVertexCount = GPP::Int(luaL_checkinteger(luaState, 1));
+        GPP::TriMesh* triMesh = GetBatchContext(luaState)->GetMesh();
+        GPP::ErrorCode res = (triMesh == NULL) ? GPP_INVALID_INPUT : GPP::SimplifyMesh::QuadricSimplify(triMesh, targetVertexCount);
+        if (res == GPP_NO_ERROR)
+        {
+            triMesh->UpdateNormal();
+        }
+        lua_pushboolean(luaState, res == GPP_NO_ERROR);
+        return 1;
+    }
+
+    static int BatchCalculatePointCloudNormal(lua_State* luaState)
+    {
+        GPP::PointCloud* pointCloud = GetBatchContext(luaState)->GetPointCloud();
+        GPP::ErrorCode res = (pointCloud == NULL) ? GPP_INVALID_INPUT : GPP::ConsolidatePointCloud::CalculatePointCloudNormal(pointCloud);
+        lua_pushboolean(luaState, res == GPP_NO_ERROR);
+        return 1;
+    }
+
+    static lua_State* CreateBatchState(BatchModelContext* context)
+    {
+        lua_State* luaState = luaL_newstate();
+        if (luaState == NULL)
+        {
+            return NULL;
+        }
+        luaL_openlibs(luaState);
+        ScriptBuffer::Registrate(luaState);
+        ScriptBuffer::SetModelContext(luaState, context);
+        lua_register(luaState, "Log", BatchLog);
+        lua_register(luaState, "print", BatchLog);
+        lua_register(luaState, "ImportMesh", BatchImportMesh);
+        lua_register(luaState, "ExportMesh", BatchExportMesh);
+        lua_register(luaState, "ImportPointCloud", BatchImportPointCloud);
+        lua_register(luaState, "ExportPointCloud", BatchExportPointCloud);
+        lua_register(luaState, "SmoothMesh", BatchSmoothMesh);
+        lua_register(luaState, "SimplifyMesh", BatchSimplifyMesh);
+        lua_register(luaState, "CalculatePointCloudNormal", BatchCalculatePointCloudNormal);
+        return luaState;
+    }
+
+    static std::string GetFileName(const std::string& filePath)
+    {
+        std::string::size_type pos = filePath.find_last_of("/\\");
+        return (pos == std::string::npos) ? filePath : filePath.substr(pos + 1);
+    }
+
+    // Run the compiled script with a fresh _ENV whose missing globals fall back to _G
+    static bool RunBatchChunk(lua_State* luaState, const std::string& inputFile, const std::string& outputDir, std::string& message)
+    {
+        lua_getfield(luaState, LUA_REGISTRYINDEX, SCRIPT_BATCH_CHUNK_KEY);
+        lua_newtable(luaState);
+        lua_pushstring(luaState, inputFile.c_str());
+        lua_setfield(luaState, -2, "InputFile");
+        lua_pushstring(luaState, outputDir.c_str());
+        lua_setfield(luaState, -2, "OutputDir");
+        lua_pushstring(luaState, ToolKit::GetNoSuffixName(GetFileName(inputFile)).c_str());
+        lua_setfield(luaState, -2, "InputName");
+        lua_newtable(luaState);
+        lua_rawgeti(luaState, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+        lua_setfield(luaState, -2, "__index");
+        lua_setmetatable(luaState, -2);
+        lua_setupvalue(luaState, -2, 1);
+        if (lua_pcall(luaState, 0, 1, 0) != LUA_OK)
+        {
+            message = lua_tostring(luaState, -1) ? lua_tostring(luaState, -1) : "unknown lua error";
+            lua_pop(luaState, 1);
+            return false;
+        }
+        // A script may return false to fail its file
+        bool isSuccess = !(lua_isboolean(luaState, -1) && !lua_toboolean(luaState, -1));
+        if (!isSuccess)
+        {
+            message = "script returned false";
+        }
+        lua_pop(luaState, 1);
+        return isSuccess;
+    }
+
+    struct BatchWorkerArg
+    {
+        ScriptBatchRunner* mpRunner;
+        int mWorkerId;
+    };
+
+    ScriptBatchRunner::ScriptBatchRunner() :
+        mScriptFile(),
+        mOutputDir(),
+        mResults(),
+        mNextFileId(0),
+        mTotalTime(0)
+    {
+    }
+
+    ScriptBatchRunner::~ScriptBatchRunner()
+    {
+    }
+
+    GPP::ErrorCode ScriptBatchRunner::Run(const std::string& scriptFile, const std::vector<std::string>& inputFiles,
+        const std::string& outputDir, int workerCount)
+    {
+        if (scriptFile.empty() || inputFiles.empty())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        CreateDirectory(outputDir.c_str(), NULL);
+        mScriptFile = scriptFile;
+        mOutputDir = outputDir;
+        mResults.clear();
+        mResults.resize(inputFiles.size());
+        for (GPP::Int fileId = 0; fileId < GPP::Int(inputFiles.size()); fileId++)
+        {
+            BatchResult& result = mResults.at(fileId);
+            result.mInputFile = inputFiles.at(fileId);
+            result.mLogFile = outputDir + "/" + GetFileName(inputFiles.at(fileId)) + ".log";
+            result.mIsSuccess = false;
+            result.mTime = 0;
+            result.mWorkerId = -1;
+        }
+        mNextFileId = 0;
+        if (workerCount <= 0)
+        {
+            workerCount = ParallelTool::GetThreadCount();
+        }
+        if (workerCount > int(inputFiles.size()))
+        {
+            workerCount = int(inputFiles.size());
+        }
+        // The worker threads are joined by one WaitForMultipleObjects
+        if (workerCount > MAXIMUM_WAIT_OBJECTS)
+        {
+            workerCount = MAXIMUM_WAIT_OBJECTS;
+        }
+        double startTime = ToolKit::GetTime();
+        // The calling thread works as worker 0
+        std::vector<BatchWorkerArg> workerArgs(workerCount);
+        std::vector<HANDLE> threadHandles;
+        for (int workerId = 1; workerId < workerCount; workerId++)
+        {
+            workerArgs.at(workerId).mpRunner = this;
+            workerArgs.at(workerId).mWorkerId = workerId;
+            HANDLE threadHandle = (HANDLE)_beginthreadex(NULL, 0, WorkerThread, (void*)(&workerArgs.at(workerId)), 0, NULL);
+            if (threadHandle != 0)
+            {
+                threadHandles.push_back(threadHandle);
+            }
+        }
+        RunWorker(0);
+        if (!threadHandles.empty())
+        {
+            DWORD waitResult = WaitForMultipleObjects(DWORD(threadHandles.size()), &(threadHandles.at(0)), TRUE, INFINITE);
+            if (waitResult == WAIT_FAILED)
+            {
+                // workerArgs and mResults are used by the workers until they exit
+                ErrorLog << "ScriptBatchRunner: WaitForMultipleObjects failed " << GPP::Int(GetLastError()) << std::endl;
+                for (std::vector<HANDLE>::iterator itr = threadHandles.begin(); itr != threadHandles.end(); ++itr)
+                {
+                    WaitForSingleObject(*itr, INFINITE);
+                }
+            }
+            for (std::vector<HANDLE>::iterator itr = threadHandles.begin(); itr != threadHandles.end(); ++itr)
+            {
+                CloseHandle(*itr);
+            }
+        }
+        mTotalTime = ToolKit::GetTime() - startTime;
+        InfoLog << "ScriptBatchRunner: " << mResults.size() << " files, " << GetFailedCount() << " failed, "
+            << workerCount << " workers, time " << mTotalTime << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    void ScriptBatchRunner::RunWorker(int workerId)
+    {
+        BatchModelContext context;
+        lua_State* luaState = CreateBatchState(&context);
+        std::string loadMessage;
+        if (luaState == NULL)
+        {
+            loadMessage = "create lua state failed";
+        }
+        else if (luaL_loadfile(luaState, mScriptFile.c_str()) != LUA_OK)
+        {
+            loadMessage = lua_tostring(luaState, -1) ? lua_tostring(luaState, -1) : "load script failed";
+            lua_pop(luaState, 1);
+        }
+        else
+        {
+            lua_setfield(luaState, LUA_REGISTRYINDEX, SCRIPT_BATCH_CHUNK_KEY);
+        }
+        while (true)
+        {
+            GPP::Int fileId = GPP::Int(InterlockedIncrement(&mNextFileId) - 1);
+            if (fileId >= GPP::Int(mResults.size()))
+            {
+                break;
+            }
+            BatchResult& result = mResults.at(fileId);
+            result.mWorkerId = workerId;
+            double startTime = ToolKit::GetTime();
+            std::ofstream logStream(result.mLogFile.c_str());
+            logStream << "Input: " << result.mInputFile << std::endl;
+            if (!loadMessage.empty())
+            {
+                result.mMessage = loadMessage;
+            }
+            else
+            {
+                context.Reset(&logStream);
+                try
+                {
+                    result.mIsSuccess = RunBatchChunk(luaState, result.mInputFile, mOutputDir, result.mMessage);
+                }
+                catch (std::exception& e)
+                {
+                    result.mIsSuccess = false;
+                    result.mMessage = e.what();
+                }
+                context.Reset(NULL);
+                lua_gc(luaState, LUA_GCCOLLECT, 0);
+            }
+            result.mTime = ToolKit::GetTime() - startTime;
+            logStream << (result.mIsSuccess ? "Success" : "Failed: ") << result.mMessage << std::endl;
+            logStream << "Time: " << result.mTime << std::endl;
+        }
+        if (luaState)
+        {
+            lua_close(luaState);
+        }
+    }
+
+    unsigned __stdcall ScriptBatchRunner::WorkerThread(void* arg)
+    {
+        BatchWorkerArg* workerArg = (BatchWorkerArg*)arg;
+        if (workerArg == NULL)
+        {
+            return 0;
+        }
+        workerArg->mpRunner->RunWorker(workerArg->mWorkerId);
+        return 1;
+    }
+
+    const std::vector<ScriptBatchRunner::BatchResult>& ScriptBatchRunner::GetResults() const
+    {
+        return mResults;
+    }
+
+    GPP::Int ScriptBatchRunner::GetFailedCount() const
+    {
+        GPP::Int failedCount = 0;
+        for (std::vector<BatchResult>::const_iterator itr = mResults.begin(); itr != mResults.end(); ++itr)
+        {
+            if (!itr->mIsSuccess)
+            {
+                failedCount++;
+            }
+        }
+        return failedCount;
+    }
+
+    GPP::ErrorCode ScriptBatchRunner::ExportSummary(const std::string& summaryFile) const
+    {
+        std::ofstream summaryOut(summaryFile.c_str());
+        if (!summaryOut)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        summaryOut << "Script: " << mScriptFile << std::endl;
+        summaryOut << "Files: " << mResults.size() << " Failed: " << GetFailedCount() << " Time: " << mTotalTime << std::endl;
+        for (std::vector<BatchResult>::const_iterator itr = mResults.begin(); itr != mResults.end(); ++itr)
+        {
+            summaryOut << (itr->mIsSuccess ? "OK    " : "FAILED") << " " << itr->mTime << " worker " << itr->mWorkerId
+                << " " << itr->mInputFile;
+            if (!itr->mIsSuccess)
+            {
+                summaryOut << " : " << itr->mMessage;
+            }
+            summaryOut << std::endl;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void ScriptBatchRunner::ListModelFiles(const std::string& dirPath, const std::vector<std::string>& extensions,
+        std::vector<std::string>& fileNames)
+    {
+        fileNames.clear();
+        WIN32_FIND_DATA findData;
+        HANDLE findHandle = FindFirstFile((dirPath + "/*").c_str(), &findData);
+        if (findHandle == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+        do
+        {
+            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                continue;
+            }
+            std::string fileName(findData.cFileName);
+            std::string::size_type dotPos = fileName.find_last_of('.');
+            if (dotPos == std::string::npos)
+            {
+                continue;
+            }
+            std::string extension = fileName.substr(dotPos + 1);
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (std::find(extensions.begin(), extensions.end(), extension) != extensions.end())
+            {
+                fileNames.push_back(dirPath + "/" + fileName);
+            }
+        } while (FindNextFile(findHandle, &findData));
+        FindClose(findHandle);
+        std::sort(fileNames.begin(), fileNames.end());
+    }
+
+    int ScriptBatchRunner::RunCommandLine(int argc, char* argv[])
+    {
+        if (argc < 5)
+        {
+            return -1;
+        }
+        std::string scriptFile(argv[2]);
+        std::string inputDir(argv[3]);
+        std::string outputDir(argv[4]);
+        int workerCount = (argc > 5) ? atoi(argv[5]) : 0;
+        std::vector<std::string> extensions;
+        extensions.push_back("obj");
+        extensions.push_back("stl");
+        extensions.push_back("off");
+        extensions.push_back("ply");
+        extensions.push_back("asc");
+        std::vector<std::string> inputFiles;
+        ListModelFiles(inputDir, extensions, inputFiles);
+        ScriptBatchRunner batchRunner;
+        if (batchRunner.Run(scriptFile, inputFiles, outputDir, workerCount) != GPP_NO_ERROR)
+        {
+            return -1;
+        }
+        batchRunner.ExportSummary(outputDir + "/batch_summary.txt");
+        return int(batchRunner.GetFailedCount());
+    }
+}
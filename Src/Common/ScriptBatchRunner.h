@@ -0,0 +1,56 @@
+#pragma once
+#include "Gpp.h"
+#include <string>
+#include <vector>
+
+namespace MagicCore
+{
+    // Runs one lua script over many model files without the GUI.
+    // Every worker thread owns a lua state and its own mesh / point cloud, input files are handed out from a shared counter.
+    // Each file runs in a fresh global environment and writes its own log, so a lua error only fails that file.
+    // Script api: InputFile, OutputDir, InputName, Log, ImportMesh, ExportMesh, ImportPointCloud, ExportPointCloud,
+    //             SmoothMesh, SimplifyMesh, CalculatePointCloudNormal, and the ScriptBuffer functions.
+    // USAGE: 1. scriptBatchRunner.Run("process.lua", inputFiles, "output", 0);
+    //        2. scriptBatchRunner.GetResults(); scriptBatchRunner.GetFailedCount();
+    class ScriptBatchRunner
+    {
+    public:
+        struct BatchResult
+        {
+            std::string mInputFile;
+            std::string mLogFile;
+            std::string mMessage;
+            bool mIsSuccess;
+            double mTime;
+            int mWorkerId;
+        };
+
+        ScriptBatchRunner();
+        ~ScriptBatchRunner();
+
+        // workerCount <= 0 uses one worker per core, at most MAXIMUM_WAIT_OBJECTS workers. Return after every file is finished
+        GPP::ErrorCode Run(const std::string& scriptFile, const std::vector<std::string>& inputFiles,
+            const std::string& outputDir, int workerCount);
+        const std::vector<BatchResult>& GetResults(void) const;
+        GPP::Int GetFailedCount(void) const;
+        // Write one line per file into summaryFile
+        GPP::ErrorCode ExportSummary(const std::string& summaryFile) const;
+
+        // Files in dirPath whose extension is one of extensions (lower case, without dot), sorted by name
+        static void ListModelFiles(const std::string& dirPath, const std::vector<std::string>& extensions,
+            std::vector<std::string>& fileNames);
+        // Command line entry: Magic3D.exe -batch script.lua inputDir outputDir [workerCount]. Return the failed file count
+        static int RunCommandLine(int argc, char* argv[]);
+
+    private:
+        void RunWorker(int workerId);
+        static unsigned __stdcall WorkerThread(void* arg);
+
+    private:
+        std::string mScriptFile;
+        std::string mOutputDir;
+        std::vector<BatchResult> mResults;
+        volatile long mNextFileId;
+        double mTotalTime;
+    };
+}
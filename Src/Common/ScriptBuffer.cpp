@@ -0,0 +1,895 @@
+#include "ScriptBuffer.h"
+#include "ParallelTool.h"
+#include "../Application/ModelManager.h"
+#include <cmath>
+#include <algorithm>
+#include <new>
+
+namespace MagicCore
+{
+    static const char* SCRIPT_BUFFER_META_NAME = "Magic3D.ScriptBuffer";
+    static const char* SCRIPT_MODEL_CONTEXT_KEY = "Magic3D.ScriptModelContext";
+    static const char* SCRIPT_BUFFER_TYPE_NAMES[] = { "coord", "normal", "color", "index", "selection", "scalar", NULL };
+    static const GPP::Int SCRIPT_BUFFER_BLOCK_SIZE = 16384;
+
+    static GPP::Int BufferComponentCount(ScriptBuffer::BufferType type)
+    {
+        if (type == ScriptBuffer::BUFFER_SELECTION || type == ScriptBuffer::BUFFER_SCALAR)
+        {
+            return 1;
+        }
+        return 3;
+    }
+
+    ScriptBuffer::ScriptBuffer(BufferType type, GPP::Int count) :
+        mType(type),
+        mSource(SOURCE_NONE),
+        mpSourceModel(NULL),
+        mCount(count),
+        mComponentCount(BufferComponentCount(type)),
+        mRealData(),
+        mIntData()
+    {
+        if (IsInteger())
+        {
+            mIntData.resize(mCount * mComponentCount, 0);
+        }
+        else
+        {
+            mRealData.resize(mCount * mComponentCount, 0);
+        }
+    }
+
+    ScriptBuffer::~ScriptBuffer()
+    {
+    }
+
+    ScriptBuffer::BufferType ScriptBuffer::GetType() const
+    {
+        return mType;
+    }
+
+    GPP::Int ScriptBuffer::GetCount() const
+    {
+        return mCount;
+    }
+
+    ScriptBuffer::BufferSource ScriptBuffer::GetSource() const
+    {
+        return mSource;
+    }
+
+    GPP::Int ScriptBuffer::GetComponentCount() const
+    {
+        return mComponentCount;
+    }
+
+    bool ScriptBuffer::IsInteger() const
+    {
+        return (mType == BUFFER_INDEX || mType == BUFFER_SELECTION);
+    }
+
+    GPP::Real ScriptBuffer::GetValue(GPP::Int elementId, GPP::Int componentId) const
+    {
+        GPP::Int valueId = elementId * mComponentCount + componentId;
+        if (IsInteger())
+        {
+            return GPP::Real(mIntData.at(valueId));
+        }
+        return mRealData.at(valueId);
+    }
+
+    void ScriptBuffer::SetValue(GPP::Int elementId, GPP::Int componentId, GPP::Real value)
+    {
+        GPP::Int valueId = elementId * mComponentCount + componentId;
+        if (IsInteger())
+        {
+            mIntData.at(valueId) = GPP::Int(value);
+        }
+        else
+        {
+            mRealData.at(valueId) = value;
+        }
+    }
+
+    GPP::Real* ScriptBuffer::GetRealData()
+    {
+        return mRealData.empty() ? NULL : &(mRealData.at(0));
+    }
+
+    GPP::Int* ScriptBuffer::GetIntData()
+    {
+        return mIntData.empty() ? NULL : &(mIntData.at(0));
+    }
+
+    class GatherMeshTask : public ParallelTask
+    {
+    public:
+        GatherMeshTask(const GPP::TriMesh* triMesh, ScriptBuffer::BufferType type, GPP::Real* realData, GPP::Int* intData) :
+            mpTriMesh(triMesh),
+            mType(type),
+            mpRealData(realData),
+            mpIntData(intData)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Vector3 value;
+            GPP::Int vertexIds[3];
+            for (int eid = startId; eid < endId; eid++)
+            {
+                if (mType == ScriptBuffer::BUFFER_INDEX)
+                {
+                    mpTriMesh->GetTriangleVertexIds(eid, vertexIds);
+                    mpIntData[eid * 3] = vertexIds[0];
+                    mpIntData[eid * 3 + 1] = vertexIds[1];
+                    mpIntData[eid * 3 + 2] = vertexIds[2];
+                    continue;
+                }
+                if (mType == ScriptBuffer::BUFFER_COORD)
+                {
+                    value = mpTriMesh->GetVertexCoord(eid);
+                }
+                else if (mType == ScriptBuffer::BUFFER_NORMAL)
+                {
+                    value = mpTriMesh->GetVertexNormal(eid);
+                }
+                else
+                {
+                    value = mpTriMesh->GetVertexColor(eid);
+                }
+                mpRealData[eid * 3] = value[0];
+                mpRealData[eid * 3 + 1] = value[1];
+                mpRealData[eid * 3 + 2] = value[2];
+            }
+        }
+
+    private:
+        const GPP::TriMesh* mpTriMesh;
+        ScriptBuffer::BufferType mType;
+        GPP::Real* mpRealData;
+        GPP::Int* mpIntData;
+    };
+
+    class GatherPointCloudTask : public ParallelTask
+    {
+    public:
+        GatherPointCloudTask(const GPP::PointCloud* pointCloud, ScriptBuffer::BufferType type, GPP::Real* realData) :
+            mpPointCloud(pointCloud),
+            mType(type),
+            mpRealData(realData)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Vector3 value;
+            for (int pid = startId; pid < endId; pid++)
+            {
+                if (mType == ScriptBuffer::BUFFER_COORD)
+                {
+                    value = mpPointCloud->GetPointCoord(pid);
+                }
+                else if (mType == ScriptBuffer::BUFFER_NORMAL)
+                {
+                    value = mpPointCloud->GetPointNormal(pid);
+                }
+                else
+                {
+                    value = mpPointCloud->GetPointColor(pid);
+                }
+                mpRealData[pid * 3] = value[0];
+                mpRealData[pid * 3 + 1] = value[1];
+                mpRealData[pid * 3 + 2] = value[2];
+            }
+        }
+
+    private:
+        const GPP::PointCloud* mpPointCloud;
+        ScriptBuffer::BufferType mType;
+        GPP::Real* mpRealData;
+    };
+
+    GPP::ErrorCode ScriptBuffer::GatherMesh(const GPP::TriMesh* triMesh)
+    {
+        if (triMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (mType == BUFFER_SELECTION || mType == BUFFER_SCALAR || (mType == BUFFER_COLOR && !triMesh->HasVertexColor()))
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int count = (mType == BUFFER_INDEX) ? triMesh->GetTriangleCount() : triMesh->GetVertexCount();
+        if (count != mCount)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GatherMeshTask task(triMesh, mType, GetRealData(), GetIntData());
+        ParallelTool::ParallelFor(mCount, &task, SCRIPT_BUFFER_BLOCK_SIZE);
+        mSource = SOURCE_MESH;
+        mpSourceModel = triMesh;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode ScriptBuffer::GatherPointCloud(const GPP::PointCloud* pointCloud)
+    {
+        if (pointCloud == NULL || pointCloud->GetPointCount() != mCount)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if ((mType != BUFFER_COORD && mType != BUFFER_NORMAL && mType != BUFFER_COLOR) ||
+            (mType == BUFFER_NORMAL && !pointCloud->HasNormal()) || (mType == BUFFER_COLOR && !pointCloud->HasColor()))
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GatherPointCloudTask task(pointCloud, mType, GetRealData());
+        ParallelTool::ParallelFor(mCount, &task, SCRIPT_BUFFER_BLOCK_SIZE);
+        mSource = SOURCE_POINTCLOUD;
+        mpSourceModel = pointCloud;
+        return GPP_NO_ERROR;
+    }
+
+    class CommitMeshTask : public ParallelTask
+    {
+    public:
+        CommitMeshTask(GPP::TriMesh* triMesh, ScriptBuffer::BufferType type, const GPP::Real* realData, const GPP::Int* intData) :
+            mpTriMesh(triMesh),
+            mType(type),
+            mpRealData(realData),
+            mpIntData(intData)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int eid = startId; eid < endId; eid++)
+            {
+                if (mType == ScriptBuffer::BUFFER_INDEX)
+                {
+                    mpTriMesh->SetTriangleVertexIds(eid, mpIntData[eid * 3], mpIntData[eid * 3 + 1], mpIntData[eid * 3 + 2]);
+                    continue;
+                }
+                GPP::Vector3 value(mpRealData[eid * 3], mpRealData[eid * 3 + 1], mpRealData[eid * 3 + 2]);
+                if (mType == ScriptBuffer::BUFFER_COORD)
+                {
+                    mpTriMesh->SetVertexCoord(eid, value);
+                }
+                else if (mType == ScriptBuffer::BUFFER_NORMAL)
+                {
+                    mpTriMesh->SetVertexNormal(eid, value);
+                }
+                else
+                {
+                    mpTriMesh->SetVertexColor(eid, value);
+                }
+            }
+        }
+
+    private:
+        GPP::TriMesh* mpTriMesh;
+        ScriptBuffer::BufferType mType;
+        const GPP::Real* mpRealData;
+        const GPP::Int* mpIntData;
+    };
+
+    class CommitPointCloudTask : public ParallelTask
+    {
+    public:
+        CommitPointCloudTask(GPP::PointCloud* pointCloud, ScriptBuffer::BufferType type, const GPP::Real* realData) :
+            mpPointCloud(pointCloud),
+            mType(type),
+            mpRealData(realData)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::Vector3 value(mpRealData[pid * 3], mpRealData[pid * 3 + 1], mpRealData[pid * 3 + 2]);
+                if (mType == ScriptBuffer::BUFFER_COORD)
+                {
+                    mpPointCloud->SetPointCoord(pid, value);
+                }
+                else if (mType == ScriptBuffer::BUFFER_NORMAL)
+                {
+                    mpPointCloud->SetPointNormal(pid, value);
+                }
+                else
+                {
+                    mpPointCloud->SetPointColor(pid, value);
+                }
+            }
+        }
+
+    private:
+        GPP::PointCloud* mpPointCloud;
+        ScriptBuffer::BufferType mType;
+        const GPP::Real* mpRealData;
+    };
+
+    GPP::ErrorCode ScriptBuffer::Commit(GPP::TriMesh* triMesh, GPP::PointCloud* pointCloud) const
+    {
+        const GPP::Real* realData = mRealData.empty() ? NULL : &(mRealData.at(0));
+        const GPP::Int* intData = mIntData.empty() ? NULL : &(mIntData.at(0));
+        if (mSource == SOURCE_MESH)
+        {
+            // The model may have been replaced by a command after the buffer was gathered
+            if (triMesh == NULL || triMesh != mpSourceModel)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            GPP::Int count = (mType == BUFFER_INDEX) ? triMesh->GetTriangleCount() : triMesh->GetVertexCount();
+            if (count != mCount)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            if (mType == BUFFER_INDEX)
+            {
+                GPP::Int vertexCount = triMesh->GetVertexCount();
+                for (std::vector<GPP::Int>::const_iterator itr = mIntData.begin(); itr != mIntData.end(); ++itr)
+                {
+                    if (*itr < 0 || *itr >= vertexCount)
+                    {
+                        return GPP_INVALID_INPUT;
+                    }
+                }
+            }
+            else if (mType == BUFFER_COLOR && !triMesh->HasVertexColor())
+            {
+                triMesh->SetHasVertexColor(true);
+            }
+            CommitMeshTask task(triMesh, mType, realData, intData);
+            ParallelTool::ParallelFor(mCount, &task, SCRIPT_BUFFER_BLOCK_SIZE);
+            return GPP_NO_ERROR;
+        }
+        else if (mSource == SOURCE_POINTCLOUD)
+        {
+            if (pointCloud == NULL || pointCloud != mpSourceModel || pointCloud->GetPointCount() != mCount)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            CommitPointCloudTask task(pointCloud, mType, realData);
+            ParallelTool::ParallelFor(mCount, &task, SCRIPT_BUFFER_BLOCK_SIZE);
+            return GPP_NO_ERROR;
+        }
+        return GPP_INVALID_INPUT;
+    }
+
+    class TransformBufferTask : public ParallelTask
+    {
+    public:
+        TransformBufferTask(GPP::Real* realData, const GPP::Real* matrix, bool isNormal) :
+            mpRealData(realData),
+            mpMatrix(matrix),
+            mIsNormal(isNormal)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            const GPP::Real* m = mpMatrix;
+            for (int eid = startId; eid < endId; eid++)
+            {
+                GPP::Real* value = mpRealData + eid * 3;
+                GPP::Real x = m[0] * value[0] + m[1] * value[1] + m[2] * value[2];
+                GPP::Real y = m[4] * value[0] + m[5] * value[1] + m[6] * value[2];
+                GPP::Real z = m[8] * value[0] + m[9] * value[1] + m[10] * value[2];
+                if (mIsNormal)
+                {
+                    GPP::Real length = sqrt(x * x + y * y + z * z);
+                    if (length > GPP::REAL_TOL)
+                    {
+                        x /= length;
+                        y /= length;
+                        z /= length;
+                    }
+                }
+                else
+                {
+                    x += m[3];
+                    y += m[7];
+                    z += m[11];
+                }
+                value[0] = x;
+                value[1] = y;
+                value[2] = z;
+            }
+        }
+
+    private:
+        GPP::Real* mpRealData;
+        const GPP::Real* mpMatrix;
+        bool mIsNormal;
+    };
+
+    void ScriptBuffer::Transform(const GPP::Real matrix[12])
+    {
+        if (IsInteger() || mComponentCount != 3)
+        {
+            return;
+        }
+        TransformBufferTask task(GetRealData(), matrix, mType == BUFFER_NORMAL);
+        ParallelTool::ParallelFor(mCount, &task, SCRIPT_BUFFER_BLOCK_SIZE);
+    }
+
+    class ThresholdBufferTask : public ParallelTask
+    {
+    public:
+        ThresholdBufferTask(const ScriptBuffer* buffer, GPP::Int componentId, GPP::Real minValue, GPP::Real maxValue,
+            std::vector<GPP::Int>& selectFlags) :
+            mpBuffer(buffer),
+            mComponentId(componentId),
+            mMinValue(minValue),
+            mMaxValue(maxValue),
+            mSelectFlags(selectFlags)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int componentCount = mpBuffer->GetComponentCount();
+            for (int eid = startId; eid < endId; eid++)
+            {
+                GPP::Real value = 0;
+                if (mComponentId < 0)
+                {
+                    for (GPP::Int cid = 0; cid < componentCount; cid++)
+                    {
+                        GPP::Real componentValue = mpBuffer->GetValue(eid, cid);
+                        value += componentValue * componentValue;
+                    }
+                    value = sqrt(value);
+                }
+                else
+                {
+                    value = mpBuffer->GetValue(eid, mComponentId);
+                }
+                mSelectFlags.at(eid) = (value >= mMinValue && value <= mMaxValue) ? 1 : 0;
+            }
+        }
+
+    private:
+        const ScriptBuffer* mpBuffer;
+        GPP::Int mComponentId;
+        GPP::Real mMinValue;
+        GPP::Real mMaxValue;
+        std::vector<GPP::Int>& mSelectFlags;
+    };
+
+    void ScriptBuffer::Threshold(GPP::Int componentId, GPP::Real minValue, GPP::Real maxValue, std::vector<GPP::Int>& selectFlags) const
+    {
+        selectFlags.resize(mCount);
+        if (componentId >= mComponentCount)
+        {
+            selectFlags.assign(mCount, 0);
+            return;
+        }
+        ThresholdBufferTask task(this, componentId, minValue, maxValue, selectFlags);
+        ParallelTool::ParallelFor(mCount, &task, SCRIPT_BUFFER_BLOCK_SIZE);
+    }
+
+    // Each thread reduces into its own slot, the slots are merged after ParallelFor
+    class StatisticsBufferTask : public ParallelTask
+    {
+    public:
+        StatisticsBufferTask(const ScriptBuffer* buffer, GPP::Int componentId) :
+            mpBuffer(buffer),
+            mComponentId(componentId),
+            mMinValues(ParallelTool::GetThreadCount(), GPP::REAL_LARGE),
+            mMaxValues(ParallelTool::GetThreadCount(), -GPP::REAL_LARGE),
+            mSumValues(ParallelTool::GetThreadCount(), 0)
+        {
+        }
+
+        virtual void Run(int startId, int endId, int threadId)
+        {
+            GPP::Int componentCount = mpBuffer->GetComponentCount();
+            GPP::Real minValue = mMinValues.at(threadId);
+            GPP::Real maxValue = mMaxValues.at(threadId);
+            GPP::Real sumValue = 0;
+            for (int eid = startId; eid < endId; eid++)
+            {
+                GPP::Real value = 0;
+                if (mComponentId < 0)
+                {
+                    for (GPP::Int cid = 0; cid < componentCount; cid++)
+                    {
+                        GPP::Real componentValue = mpBuffer->GetValue(eid, cid);
+                        value += componentValue * componentValue;
+                    }
+                    value = sqrt(value);
+                }
+                else
+                {
+                    value = mpBuffer->GetValue(eid, mComponentId);
+                }
+                minValue = value < minValue ? value : minValue;
+                maxValue = value > maxValue ? value : maxValue;
+                sumValue += value;
+            }
+            mMinValues.at(threadId) = minValue;
+            mMaxValues.at(threadId) = maxValue;
+            mSumValues.at(threadId) += sumValue;
+        }
+
+        void Merge(GPP::Real& minValue, GPP::Real& maxValue, GPP::Real& sumValue) const
+        {
+            minValue = GPP::REAL_LARGE;
+            maxValue = -GPP::REAL_LARGE;
+            sumValue = 0;
+            for (GPP::Int tid = 0; tid < GPP::Int(mSumValues.size()); tid++)
+            {
+                minValue = mMinValues.at(tid) < minValue ? mMinValues.at(tid) : minValue;
+                maxValue = mMaxValues.at(tid) > maxValue ? mMaxValues.at(tid) : maxValue;
+                sumValue += mSumValues.at(tid);
+            }
+        }
+
+    private:
+        const ScriptBuffer* mpBuffer;
+        GPP::Int mComponentId;
+        std::vector<GPP::Real> mMinValues;
+        std::vector<GPP::Real> mMaxValues;
+        std::vector<GPP::Real> mSumValues;
+    };
+
+    void ScriptBuffer::Statistics(GPP::Int componentId, GPP::Real& minValue, GPP::Real& maxValue, GPP::Real& meanValue) const
+    {
+        minValue = 0;
+        maxValue = 0;
+        meanValue = 0;
+        if (mCount == 0 || componentId >= mComponentCount)
+        {
+            return;
+        }
+        StatisticsBufferTask task(this, componentId);
+        ParallelTool::ParallelFor(mCount, &task, SCRIPT_BUFFER_BLOCK_SIZE);
+        GPP::Real sumValue = 0;
+        task.Merge(minValue, maxValue, sumValue);
+        meanValue = sumValue / GPP::Real(mCount);
+    }
+
+    ScriptBuffer* ScriptBuffer::CheckBuffer(lua_State* luaState, int index)
+    {
+        return (ScriptBuffer*)luaL_checkudata(luaState, index, SCRIPT_BUFFER_META_NAME);
+    }
+
+    ScriptBuffer* ScriptBuffer::PushBuffer(lua_State* luaState, BufferType type, GPP::Int count)
+    {
+        void* memory = lua_newuserdata(luaState, sizeof(ScriptBuffer));
+        ScriptBuffer* buffer = new (memory) ScriptBuffer(type, count);
+        luaL_setmetatable(luaState, SCRIPT_BUFFER_META_NAME);
+        return buffer;
+    }
+
+    void ScriptBuffer::SetModelContext(lua_State* luaState, ScriptModelContext* context)
+    {
+        if (context)
+        {
+            lua_pushlightuserdata(luaState, context);
+        }
+        else
+        {
+            lua_pushnil(luaState);
+        }
+        lua_setfield(luaState, LUA_REGISTRYINDEX, SCRIPT_MODEL_CONTEXT_KEY);
+    }
+
+    ScriptModelContext* ScriptBuffer::GetModelContext(lua_State* luaState)
+    {
+        lua_getfield(luaState, LUA_REGISTRYINDEX, SCRIPT_MODEL_CONTEXT_KEY);
+        ScriptModelContext* context = (ScriptModelContext*)lua_touserdata(luaState, -1);
+        lua_pop(luaState, 1);
+        return context;
+    }
+
+    static GPP::TriMesh* GetScriptMesh(lua_State* luaState)
+    {
+        ScriptModelContext* context = ScriptBuffer::GetModelContext(luaState);
+        return context ? context->GetMesh() : MagicApp::ModelManager::Get()->GetMesh();
+    }
+
+    static GPP::PointCloud* GetScriptPointCloud(lua_State* luaState)
+    {
+        ScriptModelContext* context = ScriptBuffer::GetModelContext(luaState);
+        return context ? context->GetPointCloud() : MagicApp::ModelManager::Get()->GetPointCloud();
+    }
+
+    // Lua index i is 1 based and addresses the flat value array
+    static GPP::Int CheckValueId(lua_State* luaState, const ScriptBuffer* buffer, int index)
+    {
+        lua_Integer valueId = luaL_checkinteger(luaState, index) - 1;
+        luaL_argcheck(luaState, valueId >= 0 && valueId < lua_Integer(buffer->GetCount() * buffer->GetComponentCount()),
+            index, "buffer index out of range");
+        return GPP::Int(valueId);
+    }
+
+    static int BufferIndex(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        if (lua_type(luaState, 2) == LUA_TNUMBER)
+        {
+            GPP::Int valueId = CheckValueId(luaState, buffer, 2);
+            if (buffer->IsInteger())
+            {
+                lua_pushinteger(luaState, buffer->GetIntData()[valueId]);
+            }
+            else
+            {
+                lua_pushnumber(luaState, buffer->GetRealData()[valueId]);
+            }
+            return 1;
+        }
+        lua_pushvalue(luaState, 2);
+        lua_rawget(luaState, lua_upvalueindex(1));
+        return 1;
+    }
+
+    static int BufferNewIndex(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        GPP::Int valueId = CheckValueId(luaState, buffer, 2);
+        if (buffer->IsInteger())
+        {
+            buffer->GetIntData()[valueId] = GPP::Int(luaL_checkinteger(luaState, 3));
+        }
+        else
+        {
+            buffer->GetRealData()[valueId] = luaL_checknumber(luaState, 3);
+        }
+        return 0;
+    }
+
+    static int BufferLength(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_pushinteger(luaState, buffer->GetCount() * buffer->GetComponentCount());
+        return 1;
+    }
+
+    static int BufferGc(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        buffer->~ScriptBuffer();
+        return 0;
+    }
+
+    static int BufferToString(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_pushfstring(luaState, "ScriptBuffer(%s, %d)", SCRIPT_BUFFER_TYPE_NAMES[buffer->GetType()], int(buffer->GetCount()));
+        return 1;
+    }
+
+    static int BufferCount(lua_State* luaState)
+    {
+        lua_pushinteger(luaState, ScriptBuffer::CheckBuffer(luaState, 1)->GetCount());
+        return 1;
+    }
+
+    static int BufferComponents(lua_State* luaState)
+    {
+        lua_pushinteger(luaState, ScriptBuffer::CheckBuffer(luaState, 1)->GetComponentCount());
+        return 1;
+    }
+
+    static int BufferTypeName(lua_State* luaState)
+    {
+        lua_pushstring(luaState, SCRIPT_BUFFER_TYPE_NAMES[ScriptBuffer::CheckBuffer(luaState, 1)->GetType()]);
+        return 1;
+    }
+
+    // buffer:Get(elementId, componentId), both 1 based
+    static int BufferGet(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_Integer elementId = luaL_checkinteger(luaState, 2) - 1;
+        lua_Integer componentId = luaL_optinteger(luaState, 3, 1) - 1;
+        luaL_argcheck(luaState, elementId >= 0 && elementId < buffer->GetCount(), 2, "element index out of range");
+        luaL_argcheck(luaState, componentId >= 0 && componentId < buffer->GetComponentCount(), 3, "component index out of range");
+        lua_pushnumber(luaState, buffer->GetValue(GPP::Int(elementId), GPP::Int(componentId)));
+        return 1;
+    }
+
+    // buffer:Set(elementId, componentId, value), both 1 based
+    static int BufferSet(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_Integer elementId = luaL_checkinteger(luaState, 2) - 1;
+        lua_Integer componentId = luaL_checkinteger(luaState, 3) - 1;
+        luaL_argcheck(luaState, elementId >= 0 && elementId < buffer->GetCount(), 2, "element index out of range");
+        luaL_argcheck(luaState, componentId >= 0 && componentId < buffer->GetComponentCount(), 3, "component index out of range");
+        buffer->SetValue(GPP::Int(elementId), GPP::Int(componentId), luaL_checknumber(luaState, 4));
+        return 0;
+    }
+
+    static int BufferFill(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_Number value = luaL_checknumber(luaState, 2);
+        GPP::Int valueCount = buffer->GetCount() * buffer->GetComponentCount();
+        if (buffer->IsInteger())
+        {
+            std::fill(buffer->GetIntData(), buffer->GetIntData() + valueCount, GPP::Int(value));
+        }
+        else
+        {
+            std::fill(buffer->GetRealData(), buffer->GetRealData() + valueCount, GPP::Real(value));
+        }
+        return 0;
+    }
+
+    // buffer:Transform(m00, m01, m02, t0, m10, m11, m12, t1, m20, m21, m22, t2)
+    static int BufferTransform(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        luaL_argcheck(luaState, !buffer->IsInteger() && buffer->GetComponentCount() == 3, 1, "not a vector buffer");
+        GPP::Real matrix[12];
+        for (int mid = 0; mid < 12; mid++)
+        {
+            matrix[mid] = luaL_checknumber(luaState, mid + 2);
+        }
+        buffer->Transform(matrix);
+        return 0;
+    }
+
+    // buffer:Threshold(componentId, minValue, maxValue), componentId 0 uses the element length. Return a selection buffer
+    static int BufferThreshold(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_Integer componentId = luaL_checkinteger(luaState, 2) - 1;
+        luaL_argcheck(luaState, componentId < buffer->GetComponentCount(), 2, "component index out of range");
+        GPP::Real minValue = luaL_checknumber(luaState, 3);
+        GPP::Real maxValue = luaL_checknumber(luaState, 4);
+        ScriptBuffer* selection = ScriptBuffer::PushBuffer(luaState, ScriptBuffer::BUFFER_SELECTION, buffer->GetCount());
+        std::vector<GPP::Int> selectFlags;
+        buffer->Threshold(GPP::Int(componentId), minValue, maxValue, selectFlags);
+        if (!selectFlags.empty())
+        {
+            std::copy(selectFlags.begin(), selectFlags.end(), selection->GetIntData());
+        }
+        return 1;
+    }
+
+    // buffer:Statistics(componentId), componentId 0 uses the element length. Return min, max, mean
+    static int BufferStatistics(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_Integer componentId = luaL_optinteger(luaState, 2, 1) - 1;
+        luaL_argcheck(luaState, componentId < buffer->GetComponentCount(), 2, "component index out of range");
+        GPP::Real minValue, maxValue, meanValue;
+        buffer->Statistics(GPP::Int(componentId), minValue, maxValue, meanValue);
+        lua_pushnumber(luaState, minValue);
+        lua_pushnumber(luaState, maxValue);
+        lua_pushnumber(luaState, meanValue);
+        return 3;
+    }
+
+    static int BufferCountSelected(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        lua_Integer selectCount = 0;
+        if (buffer->IsInteger())
+        {
+            const GPP::Int* values = buffer->GetIntData();
+            GPP::Int valueCount = buffer->GetCount() * buffer->GetComponentCount();
+            for (GPP::Int vid = 0; vid < valueCount; vid++)
+            {
+                if (values[vid] != 0)
+                {
+                    selectCount++;
+                }
+            }
+        }
+        lua_pushinteger(luaState, selectCount);
+        return 1;
+    }
+
+    static int BufferCommit(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        GPP::ErrorCode res = buffer->Commit(GetScriptMesh(luaState), GetScriptPointCloud(luaState));
+        if (res == GPP_NO_ERROR && buffer->GetSource() == ScriptBuffer::SOURCE_MESH)
+        {
+            ScriptModelContext* context = ScriptBuffer::GetModelContext(luaState);
+            if (context)
+            {
+                context->MarkMeshChanged();
+            }
+            else
+            {
+                MagicApp::ModelManager::Get()->MarkMeshChanged();
+            }
+        }
+        lua_pushboolean(luaState, res == GPP_NO_ERROR);
+        return 1;
+    }
+
+    // NewBuffer(typeName, count)
+    static int NewBuffer(lua_State* luaState)
+    {
+        ScriptBuffer::BufferType type = ScriptBuffer::BufferType(luaL_checkoption(luaState, 1, NULL, SCRIPT_BUFFER_TYPE_NAMES));
+        lua_Integer count = luaL_checkinteger(luaState, 2);
+        luaL_argcheck(luaState, count >= 0, 2, "negative count");
+        ScriptBuffer::PushBuffer(luaState, type, GPP::Int(count));
+        return 1;
+    }
+
+    // GetMeshBuffer(typeName): coord, normal, color per vertex or index per triangle. Return nil if not available
+    static int GetMeshBuffer(lua_State* luaState)
+    {
+        ScriptBuffer::BufferType type = ScriptBuffer::BufferType(luaL_checkoption(luaState, 1, NULL, SCRIPT_BUFFER_TYPE_NAMES));
+        GPP::TriMesh* triMesh = GetScriptMesh(luaState);
+        if (triMesh == NULL)
+        {
+            lua_pushnil(luaState);
+            return 1;
+        }
+        GPP::Int count = (type == ScriptBuffer::BUFFER_INDEX) ? triMesh->GetTriangleCount() : triMesh->GetVertexCount();
+        ScriptBuffer* buffer = ScriptBuffer::PushBuffer(luaState, type, count);
+        if (buffer->GatherMesh(triMesh) != GPP_NO_ERROR)
+        {
+            lua_pop(luaState, 1);
+            lua_pushnil(luaState);
+        }
+        return 1;
+    }
+
+    // GetPointCloudBuffer(typeName): coord, normal or color per point. Return nil if not available
+    static int GetPointCloudBuffer(lua_State* luaState)
+    {
+        ScriptBuffer::BufferType type = ScriptBuffer::BufferType(luaL_checkoption(luaState, 1, NULL, SCRIPT_BUFFER_TYPE_NAMES));
+        GPP::PointCloud* pointCloud = GetScriptPointCloud(luaState);
+        if (pointCloud == NULL)
+        {
+            lua_pushnil(luaState);
+            return 1;
+        }
+        ScriptBuffer* buffer = ScriptBuffer::PushBuffer(luaState, type, pointCloud->GetPointCount());
+        if (buffer->GatherPointCloud(pointCloud) != GPP_NO_ERROR)
+        {
+            lua_pop(luaState, 1);
+            lua_pushnil(luaState);
+        }
+        return 1;
+    }
+
+    void ScriptBuffer::Registrate(lua_State* luaState)
+    {
+        static const luaL_Reg bufferMethods[] = {
+            { "Count", BufferCount },
+            { "Components", BufferComponents },
+            { "Type", BufferTypeName },
+            { "Get", BufferGet },
+            { "Set", BufferSet },
+            { "Fill", BufferFill },
+            { "Transform", BufferTransform },
+            { "Threshold", BufferThreshold },
+            { "Statistics", BufferStatistics },
+            { "CountSelected", BufferCountSelected },
+            { "Commit", BufferCommit },
+            { NULL, NULL }
+        };
+        luaL_newmetatable(luaState, SCRIPT_BUFFER_META_NAME);
+        lua_newtable(luaState);
+        luaL_setfuncs(luaState, bufferMethods, 0);
+        lua_pushcclosure(luaState, BufferIndex, 1);
+        lua_setfield(luaState, -2, "__index");
+        lua_pushcfunction(luaState, BufferNewIndex);
+        lua_setfield(luaState, -2, "__newindex");
+        lua_pushcfunction(luaState, BufferLength);
+        lua_setfield(luaState, -2, "__len");
+        lua_pushcfunction(luaState, BufferGc);
+        lua_setfield(luaState, -2, "__gc");
+        lua_pushcfunction(luaState, BufferToString);
+        lua_setfield(luaState, -2, "__tostring");
+        lua_pop(luaState, 1);
+
+        lua_register(luaState, "NewBuffer", NewBuffer);
+        lua_register(luaState, "GetMeshBuffer", GetMeshBuffer);
+        lua_register(luaState, "GetPointCloudBuffer", GetPointCloudBuffer);
+    }
+}
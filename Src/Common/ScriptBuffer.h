@@ -0,0 +1,91 @@
+#pragma once
+#include "lua.hpp"
+#include "Gpp.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // Models which the buffer functions of a lua state work on. A state without a context uses ModelManager
+    class ScriptModelContext
+    {
+    public:
+        ScriptModelContext() {}
+        virtual GPP::TriMesh* GetMesh(void) = 0;
+        virtual GPP::PointCloud* GetPointCloud(void) = 0;
+        virtual void MarkMeshChanged(void) {}
+        virtual ~ScriptModelContext() {}
+    };
+
+    // Typed array userdata which Lua reads and writes in place: buffer[i], 1 <= i <= #buffer, is the flat element array.
+    // Model data is gathered into the buffer once, bulk operations run in C++ and Commit writes the buffer back once,
+    // so a script never crosses lua_tinker per vertex.
+    // USAGE: local coords = GetMeshBuffer("coord")
+    //        coords:Transform(1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0.5)
+    //        local selection = coords:Threshold(3, 0.0, 1.0)
+    //        coords:Commit()
+    //        SelectMeshVertices(selection)
+    class ScriptBuffer
+    {
+    public:
+        enum BufferType
+        {
+            BUFFER_COORD = 0,
+            BUFFER_NORMAL,
+            BUFFER_COLOR,
+            BUFFER_INDEX,
+            BUFFER_SELECTION,
+            BUFFER_SCALAR
+        };
+
+        enum BufferSource
+        {
+            SOURCE_NONE = 0,
+            SOURCE_MESH,
+            SOURCE_POINTCLOUD
+        };
+
+        ScriptBuffer(BufferType type, GPP::Int count);
+        ~ScriptBuffer();
+
+        // Register the userdata metatable and the buffer functions into luaState
+        static void Registrate(lua_State* luaState);
+        // Raise a lua error if the value at index is not a buffer
+        static ScriptBuffer* CheckBuffer(lua_State* luaState, int index);
+        // The new buffer is pushed on the lua stack and owned by lua
+        static ScriptBuffer* PushBuffer(lua_State* luaState, BufferType type, GPP::Int count);
+        // context is not owned by luaState, NULL restores ModelManager
+        static void SetModelContext(lua_State* luaState, ScriptModelContext* context);
+        static ScriptModelContext* GetModelContext(lua_State* luaState);
+
+        BufferType GetType(void) const;
+        BufferSource GetSource(void) const;
+        GPP::Int GetCount(void) const;
+        GPP::Int GetComponentCount(void) const;
+        bool IsInteger(void) const;
+        GPP::Real GetValue(GPP::Int elementId, GPP::Int componentId) const;
+        void SetValue(GPP::Int elementId, GPP::Int componentId, GPP::Real value);
+        GPP::Real* GetRealData(void);
+        GPP::Int* GetIntData(void);
+
+        GPP::ErrorCode GatherMesh(const GPP::TriMesh* triMesh);
+        GPP::ErrorCode GatherPointCloud(const GPP::PointCloud* pointCloud);
+        // Write back to the model the buffer was gathered from
+        GPP::ErrorCode Commit(GPP::TriMesh* triMesh, GPP::PointCloud* pointCloud) const;
+
+        // matrix: row major 3x4 [R|t]. Coordinates are transformed by R * p + t, normals by R and normalized
+        void Transform(const GPP::Real matrix[12]);
+        // componentId < 0 uses the element length. Result has one 0/1 value per element
+        void Threshold(GPP::Int componentId, GPP::Real minValue, GPP::Real maxValue, std::vector<GPP::Int>& selectFlags) const;
+        // componentId < 0 uses the element length
+        void Statistics(GPP::Int componentId, GPP::Real& minValue, GPP::Real& maxValue, GPP::Real& meanValue) const;
+
+    private:
+        BufferType mType;
+        BufferSource mSource;
+        const void* mpSourceModel;
+        GPP::Int mCount;
+        GPP::Int mComponentCount;
+        std::vector<GPP::Real> mRealData;
+        std::vector<GPP::Int> mIntData;
+    };
+}
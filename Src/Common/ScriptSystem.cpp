@@ -1,6 +1,7 @@
 #include "ScriptSystem.h"
 #include "lua_tinker.h"
 #include "LogSystem.h"
+#include "ScriptBuffer.h"
 #include "../Application/ModelManager.h"
 #include "../Application/AppApi.h"
 #include "../Application/MeshShopApp.h"
@@ -10,6 +11,27 @@ namespace MagicCore
 {
     ScriptSystem* ScriptSystem::mpScriptSystem = NULL;
 
+    // SelectMeshVertices(selectionBuffer): set the vertex selection of MeshShopApp
+    static int SelectMeshVertices(lua_State* luaState)
+    {
+        ScriptBuffer* buffer = ScriptBuffer::CheckBuffer(luaState, 1);
+        MagicApp::MeshShopApp* shopApp = MagicApp::AppApi::GetMeshShopApp();
+        if (shopApp == NULL || buffer->GetType() != ScriptBuffer::BUFFER_SELECTION)
+        {
+            lua_pushboolean(luaState, 0);
+            return 1;
+        }
+        GPP::Int vertexCount = buffer->GetCount();
+        const GPP::Int* selectValues = buffer->GetIntData();
+        std::vector<bool> selectFlags(vertexCount, false);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            selectFlags.at(vid) = (selectValues[vid] != 0);
+        }
+        lua_pushboolean(luaState, shopApp->SetVertexSelectFlags(selectFlags));
+        return 1;
+    }
+
     ScriptSystem::ScriptSystem() : mpLuaState(NULL), mIsOnRunning(false)
     {
 
@@ -65,6 +87,24 @@ namespace MagicCore
         lua_tinker::class_add<GPP::TriMesh>(mpLuaState, "TriMesh");
         lua_tinker::class_def<GPP::TriMesh>(mpLuaState, "GetVertexCount", &GPP::TriMesh::GetVertexCount);
         lua_tinker::class_def<GPP::TriMesh>(mpLuaState, "GetTriangleCount", &GPP::TriMesh::GetTriangleCount);
+        lua_tinker::class_def<GPP::TriMesh>(mpLuaState, "UpdateNormal", &GPP::TriMesh::UpdateNormal);
+
+        // open models, see ModelRegistry
+        lua_tinker::def(mpLuaState, "StashMesh", &MagicApp::AppApi::StashMesh);
+        lua_tinker::def(mpLuaState, "SwitchMesh", &MagicApp::AppApi::SwitchMesh);
+        lua_tinker::def(mpLuaState, "StashPointCloud", &MagicApp::AppApi::StashPointCloud);
+        lua_tinker::def(mpLuaState, "SwitchPointCloud", &MagicApp::AppApi::SwitchPointCloud);
+        lua_tinker::def(mpLuaState, "SwitchNextMesh", &MagicApp::AppApi::SwitchNextMesh);
+        lua_tinker::def(mpLuaState, "SwitchNextPointCloud", &MagicApp::AppApi::SwitchNextPointCloud);
+        lua_tinker::def(mpLuaState, "ReleaseModel", &MagicApp::AppApi::ReleaseModel);
+        lua_tinker::def(mpLuaState, "SetModelMemoryBudget", &MagicApp::AppApi::SetModelMemoryBudget);
+        lua_tinker::def(mpLuaState, "ListModels", &MagicApp::AppApi::ListModels);
+        lua_tinker::def(mpLuaState, "GetModelHandle", &MagicApp::AppApi::GetModelHandle);
+        lua_tinker::def(mpLuaState, "GetModelName", &MagicApp::AppApi::GetModelName);
+
+        // bulk array access, see ScriptBuffer
+        ScriptBuffer::Registrate(mpLuaState);
+        lua_register(mpLuaState, "SelectMeshVertices", SelectMeshVertices);
 
         lua_tinker::def(mpLuaState, "GetMeshShopApp", &MagicApp::AppApi::GetMeshShopApp);
         lua_tinker::class_add<MagicApp::MeshShopApp>(mpLuaState, "MeshShopApp");
@@ -81,6 +121,7 @@ namespace MagicCore
         lua_tinker::class_def<MagicApp::MeshShopApp>(mpLuaState, "RefineMesh", &MagicApp::MeshShopApp::RefineMesh);
         lua_tinker::class_def<MagicApp::MeshShopApp>(mpLuaState, "SimplifyMesh", &MagicApp::MeshShopApp::SimplifyMesh);
         lua_tinker::class_def<MagicApp::MeshShopApp>(mpLuaState, "SimplifySelectedVertices", &MagicApp::MeshShopApp::SimplifySelectedVertices);
+        lua_tinker::class_def<MagicApp::MeshShopApp>(mpLuaState, "SetComparePatchSimplification", &MagicApp::MeshShopApp::SetComparePatchSimplification);
         lua_tinker::class_def<MagicApp::MeshShopApp>(mpLuaState, "UniformRemesh", &MagicApp::MeshShopApp::UniformRemesh);
         lua_tinker::class_def<MagicApp::MeshShopApp>(mpLuaState, "UniformSampleMesh", &MagicApp::MeshShopApp::UniformSampleMesh);
         lua_tinker::class_def<MagicApp::MeshShopApp>(mpLuaState, "FillHole", &MagicApp::MeshShopApp::FillHole);